@@ -17,9 +17,11 @@
  */
 
 #include <sys/types.h>
+#include <sys/time.h>
 
 #include <event.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "tmux.h"
 
@@ -40,13 +42,41 @@ static void	alerts_set_message(struct winlink *, const char *,
 
 static TAILQ_HEAD(, window) alerts_list = TAILQ_HEAD_INITIALIZER(alerts_list);
 
+/*
+ * The silence timer is not reset on every burst of output - that would mean
+ * timer churn on each read from a busy pane. Instead it is left to expire
+ * and compares the window activity time when it fires: if there was
+ * activity in the meantime, it re-arms itself for the remainder.
+ */
 static void
 alerts_timer(__unused int fd, __unused short events, void *arg)
 {
 	struct window	*w = arg;
-
-	log_debug("@%u alerts timer expired", w->id);
-	alerts_queue(w, WINDOW_SILENCE);
+	struct timeval	 tv, now;
+	int		 silence;
+
+	silence = options_get_number(w->options, "monitor-silence");
+	if (silence == 0)
+		return;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &w->activity_time, &tv);
+	if (tv.tv_sec >= silence) {
+		log_debug("@%u alerts timer expired", w->id);
+		alerts_queue(w, WINDOW_SILENCE);
+		timerclear(&tv);
+		tv.tv_sec = silence;
+	} else {
+		log_debug("@%u alerts timer deferred, %lld since activity",
+		    w->id, (long long)tv.tv_sec);
+		tv.tv_sec = silence - tv.tv_sec;
+		tv.tv_usec = 1000000 - tv.tv_usec;
+		if (tv.tv_usec == 1000000)
+			tv.tv_usec = 0;
+		else
+			tv.tv_sec--;
+	}
+	evtimer_add(&w->alerts_timer, &tv);
 }
 
 static void
@@ -158,7 +188,19 @@ alerts_reset(struct window *w)
 void
 alerts_queue(struct window *w, int flags)
 {
-	alerts_reset(w);
+	if (flags & WINDOW_ACTIVITY) {
+		w->flags &= ~WINDOW_SILENCE;
+
+		/*
+		 * Arm the silence timer if it is not running; it re-arms
+		 * itself from the activity time, so output does not have to
+		 * touch it again.
+		 */
+		if ((!event_initialized(&w->alerts_timer) ||
+		    !evtimer_pending(&w->alerts_timer, NULL)) &&
+		    options_get_number(w->options, "monitor-silence") != 0)
+			alerts_reset(w);
+	}
 
 	if ((w->flags & flags) != flags) {
 		w->flags |= flags;
@@ -185,12 +227,28 @@ alerts_check_bell(struct window *w)
 {
 	struct winlink	*wl;
 	struct session	*s;
+	struct timeval	 now, elapsed;
 
 	if (~w->flags & WINDOW_BELL)
 		return (0);
 	if (!options_get_number(w->options, "monitor-bell"))
 		return (0);
 
+	/*
+	 * Repeated bells are allowed, so a pane beeping in a loop would run
+	 * the notify, message and status redraw chain once per event loop.
+	 * Deliver at most one chain per window per second; the bells in
+	 * between are folded into the one that was already delivered.
+	 */
+	gettimeofday(&now, NULL);
+	timersub(&now, &w->alerts_bell_time, &elapsed);
+	if (elapsed.tv_sec < 1) {
+		log_debug("@%u bell suppressed, %lld.%06lld since last", w->id,
+		    (long long)elapsed.tv_sec, (long long)elapsed.tv_usec);
+		return (WINDOW_BELL);
+	}
+	memcpy(&w->alerts_bell_time, &now, sizeof w->alerts_bell_time);
+
 	TAILQ_FOREACH(wl, &w->winlinks, wentry)
 		wl->session->flags &= ~SESSION_ALERTED;
 
@@ -25,13 +25,29 @@
 const char *
 attributes_tostring(int attr)
 {
-	static char	buf[512];
+	/*
+	 * Formats seen before are remembered: styles are reformatted over and
+	 * over with the same few attribute sets, so most calls are a hit.
+	 */
+	static struct {
+		int	attr;
+		char	buf[256];
+	} cache[16];
+	u_int		idx;
 	size_t		len;
+	char		*buf;
 
 	if (attr == 0)
 		return ("none");
 
-	len = xsnprintf(buf, sizeof buf, "%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
+	idx = (((u_int)attr >> 4) ^ (u_int)attr) & 15;
+	if (cache[idx].attr == attr)
+		return (cache[idx].buf);
+	cache[idx].attr = attr;
+	buf = cache[idx].buf;
+
+	len = xsnprintf(buf, sizeof cache[idx].buf,
+	    "%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
 	    (attr & GRID_ATTR_CHARSET) ? "acs," : "",
 	    (attr & GRID_ATTR_BRIGHT) ? "bright," : "",
 	    (attr & GRID_ATTR_DIM) ? "dim," : "",
@@ -99,6 +99,8 @@ start_cfg(void)
 	} else
 		load_cfg(cfg_file, c, NULL, 0, NULL);
 
+	snapshot_check_restore();
+
 	cmdq_append(NULL, cmdq_get_callback(cfg_done, NULL));
 }
 
@@ -129,7 +131,7 @@ load_cfg(const char *path, struct client *c, struct cmdq_item *item, int flags,
 	pi.item = item;
 	pi.c = c;
 
-	pr = cmd_parse_from_file(f, &pi);
+	pr = cmd_parse_from_file_cached(f, path, &pi);
 	fclose(f);
 	if (pr->status == CMD_PARSE_EMPTY)
 		return (0);
@@ -412,8 +412,8 @@ static void
 client_send_identify(const char *ttynam, const char *cwd, int feat)
 {
 	const char	 *s;
-	char		**ss;
-	size_t		  sslen;
+	char		**ss, *env;
+	size_t		  sslen, envlen, used;
 	int		  fd, flags = client_flags;
 	pid_t		  pid;
 
@@ -435,12 +435,32 @@ client_send_identify(const char *ttynam, const char *cwd, int feat)
 	pid = getpid();
 	proc_send(client_peer, MSG_IDENTIFY_CLIENTPID, -1, &pid, sizeof pid);
 
+	/*
+	 * The environment is eighty-odd variables and the per-message
+	 * overhead dominates if each is sent on its own, so pack them as
+	 * NUL-terminated strings into as few messages as will hold them.
+	 * Variables too long for one message are dropped as before.
+	 */
+	envlen = MAX_IMSGSIZE - IMSG_HEADER_SIZE;
+	env = xmalloc(envlen);
+	used = 0;
 	for (ss = environ; *ss != NULL; ss++) {
 		sslen = strlen(*ss) + 1;
-		if (sslen > MAX_IMSGSIZE - IMSG_HEADER_SIZE)
+		if (sslen > envlen)
 			continue;
-		proc_send(client_peer, MSG_IDENTIFY_ENVIRON, -1, *ss, sslen);
+		if (used + sslen > envlen) {
+			proc_send(client_peer, MSG_IDENTIFY_ENVIRONBLOCK, -1,
+			    env, used);
+			used = 0;
+		}
+		memcpy(env + used, *ss, sslen);
+		used += sslen;
+	}
+	if (used != 0) {
+		proc_send(client_peer, MSG_IDENTIFY_ENVIRONBLOCK, -1, env,
+		    used);
 	}
+	free(env);
 
 	proc_send(client_peer, MSG_IDENTIFY_DONE, -1, NULL, 0);
 }
@@ -32,8 +32,12 @@ static enum cmd_retval	cmd_capture_pane_exec(struct cmd *, struct cmdq_item *);
 static char	*cmd_capture_pane_append(char *, size_t *, char *, size_t);
 static char	*cmd_capture_pane_pending(struct args *, struct window_pane *,
 		     size_t *);
+static int	 cmd_capture_pane_bounds(struct args *, struct cmdq_item *,
+		     struct window_pane *, struct grid **, u_int *, u_int *);
 static char	*cmd_capture_pane_history(struct args *, struct cmdq_item *,
 		     struct window_pane *, size_t *);
+static enum cmd_retval cmd_capture_pane_print(struct args *,
+		     struct cmdq_item *, struct window_pane *);
 
 const struct cmd_entry cmd_capture_pane_entry = {
 	.name = "capture-pane",
@@ -103,70 +107,94 @@ cmd_capture_pane_pending(struct args *args, struct window_pane *wp,
 	return (buf);
 }
 
-static char *
-cmd_capture_pane_history(struct args *args, struct cmdq_item *item,
-    struct window_pane *wp, size_t *len)
+/*
+ * Work out the grid and line range to capture. Returns -1 and reports an
+ * error on failure; on success the grid may still be NULL if there is
+ * nothing to capture (missing alternate screen with -q).
+ */
+static int
+cmd_capture_pane_bounds(struct args *args, struct cmdq_item *item,
+    struct window_pane *wp, struct grid **gdp, u_int *top, u_int *bottom)
 {
-	struct grid		*gd;
-	const struct grid_line	*gl;
-	struct grid_cell	*gc = NULL;
-	int			 n, with_codes, escape_c0, join_lines, no_trim;
-	u_int			 i, sx, top, bottom, tmp;
-	char			*cause, *buf, *line;
-	const char		*Sflag, *Eflag;
-	size_t			 linelen;
+	struct grid	*gd;
+	int		 n;
+	u_int		 tmp;
+	char		*cause;
+	const char	*Sflag, *Eflag;
 
-	sx = screen_size_x(&wp->base);
 	if (args_has(args, 'a')) {
 		gd = wp->base.saved_grid;
 		if (gd == NULL) {
 			if (!args_has(args, 'q')) {
 				cmdq_error(item, "no alternate screen");
-				return (NULL);
+				return (-1);
 			}
-			return (xstrdup(""));
+			*gdp = NULL;
+			return (0);
 		}
 	} else
 		gd = wp->base.grid;
 
 	Sflag = args_get(args, 'S');
 	if (Sflag != NULL && strcmp(Sflag, "-") == 0)
-		top = 0;
+		*top = 0;
 	else {
 		n = args_strtonum(args, 'S', INT_MIN, SHRT_MAX, &cause);
 		if (cause != NULL) {
-			top = gd->hsize;
+			*top = gd->hsize;
 			free(cause);
 		} else if (n < 0 && (u_int) -n > gd->hsize)
-			top = 0;
+			*top = 0;
 		else
-			top = gd->hsize + n;
-		if (top > gd->hsize + gd->sy - 1)
-			top = gd->hsize + gd->sy - 1;
+			*top = gd->hsize + n;
+		if (*top > gd->hsize + gd->sy - 1)
+			*top = gd->hsize + gd->sy - 1;
 	}
 
 	Eflag = args_get(args, 'E');
 	if (Eflag != NULL && strcmp(Eflag, "-") == 0)
-		bottom = gd->hsize + gd->sy - 1;
+		*bottom = gd->hsize + gd->sy - 1;
 	else {
 		n = args_strtonum(args, 'E', INT_MIN, SHRT_MAX, &cause);
 		if (cause != NULL) {
-			bottom = gd->hsize + gd->sy - 1;
+			*bottom = gd->hsize + gd->sy - 1;
 			free(cause);
 		} else if (n < 0 && (u_int) -n > gd->hsize)
-			bottom = 0;
+			*bottom = 0;
 		else
-			bottom = gd->hsize + n;
-		if (bottom > gd->hsize + gd->sy - 1)
-			bottom = gd->hsize + gd->sy - 1;
+			*bottom = gd->hsize + n;
+		if (*bottom > gd->hsize + gd->sy - 1)
+			*bottom = gd->hsize + gd->sy - 1;
 	}
 
-	if (bottom < top) {
-		tmp = bottom;
-		bottom = top;
-		top = tmp;
+	if (*bottom < *top) {
+		tmp = *bottom;
+		*bottom = *top;
+		*top = tmp;
 	}
 
+	*gdp = gd;
+	return (0);
+}
+
+static char *
+cmd_capture_pane_history(struct args *args, struct cmdq_item *item,
+    struct window_pane *wp, size_t *len)
+{
+	struct grid		*gd;
+	const struct grid_line	*gl;
+	struct grid_cell	*gc = NULL;
+	int			 with_codes, escape_c0, join_lines, no_trim;
+	u_int			 i, sx, top, bottom;
+	char			*buf, *line;
+	size_t			 linelen;
+
+	if (cmd_capture_pane_bounds(args, item, wp, &gd, &top, &bottom) != 0)
+		return (NULL);
+	if (gd == NULL)
+		return (xstrdup(""));
+	sx = screen_size_x(&wp->base);
+
 	with_codes = args_has(args, 'e');
 	escape_c0 = args_has(args, 'C');
 	join_lines = args_has(args, 'J');
@@ -189,6 +217,48 @@ cmd_capture_pane_history(struct args *args, struct cmdq_item *item,
 	return (buf);
 }
 
+/*
+ * Print the capture to the client a line at a time rather than building the
+ * whole thing in one buffer first, so capturing a large history does not
+ * hold a second copy of it in the server.
+ */
+static enum cmd_retval
+cmd_capture_pane_print(struct args *args, struct cmdq_item *item,
+    struct window_pane *wp)
+{
+	struct client		*c = cmdq_get_client(item);
+	struct grid		*gd;
+	const struct grid_line	*gl;
+	struct grid_cell	*gc = NULL;
+	int			 with_codes, escape_c0, join_lines, no_trim;
+	u_int			 i, sx, top, bottom;
+	char			*line;
+
+	if (cmd_capture_pane_bounds(args, item, wp, &gd, &top, &bottom) != 0)
+		return (CMD_RETURN_ERROR);
+	if (gd == NULL)
+		return (CMD_RETURN_NORMAL);
+	sx = screen_size_x(&wp->base);
+
+	with_codes = args_has(args, 'e');
+	escape_c0 = args_has(args, 'C');
+	join_lines = args_has(args, 'J');
+	no_trim = args_has(args, 'N');
+
+	for (i = top; i <= bottom; i++) {
+		line = grid_string_cells(gd, 0, i, sx, &gc, with_codes,
+		    escape_c0, !join_lines && !no_trim);
+		file_print_buffer(c, line, strlen(line));
+
+		gl = grid_peek_line(gd, i);
+		if (!join_lines || !(gl->flags & GRID_LINE_WRAPPED))
+			file_print(c, "\n");
+
+		free(line);
+	}
+	return (CMD_RETURN_NORMAL);
+}
+
 static enum cmd_retval
 cmd_capture_pane_exec(struct cmd *self, struct cmdq_item *item)
 {
@@ -205,6 +275,14 @@ cmd_capture_pane_exec(struct cmd *self, struct cmdq_item *item)
 		return (CMD_RETURN_NORMAL);
 	}
 
+	if (args_has(args, 'p') && !args_has(args, 'P')) {
+		if (!file_can_print(c)) {
+			cmdq_error(item, "can't write output to client");
+			return (CMD_RETURN_ERROR);
+		}
+		return (cmd_capture_pane_print(args, item, wp));
+	}
+
 	len = 0;
 	if (args_has(args, 'P'))
 		buf = cmd_capture_pane_pending(args, wp, &len);
@@ -46,6 +46,46 @@ struct cmd_display_panes_data {
 	char			*command;
 };
 
+/*
+ * Runs of set cells in each row of the digit glyphs, precomputed from
+ * window_clock_table so redraws emit one cursor move per run rather than per
+ * cell.
+ */
+struct cmd_display_panes_run {
+	u_char	start;
+	u_char	len;
+};
+static struct cmd_display_panes_run	cmd_display_panes_runs[10][5][3];
+static int				cmd_display_panes_runs_built;
+
+static void
+cmd_display_panes_build_runs(void)
+{
+	u_int				 idx, j, i, n;
+	struct cmd_display_panes_run	*run;
+
+	for (idx = 0; idx < 10; idx++) {
+		for (j = 0; j < 5; j++) {
+			n = 0;
+			for (i = 0; i < 5; i++) {
+				if (!window_clock_table[idx][j][i])
+					continue;
+				run = &cmd_display_panes_runs[idx][j][n];
+				if (run->len != 0 &&
+				    run->start + run->len == i) {
+					run->len++;
+					continue;
+				}
+				if (run->len != 0)
+					run = &cmd_display_panes_runs[idx][j][++n];
+				run->start = i;
+				run->len = 1;
+			}
+		}
+	}
+	cmd_display_panes_runs_built = 1;
+}
+
 static void
 cmd_display_panes_draw_pane(struct screen_redraw_ctx *ctx,
     struct window_pane *wp)
@@ -56,7 +96,8 @@ cmd_display_panes_draw_pane(struct screen_redraw_ctx *ctx,
 	struct options		*oo = s->options;
 	struct window		*w = wp->window;
 	struct grid_cell	 gc;
-	u_int			 idx, px, py, i, j, xoff, yoff, sx, sy;
+	struct cmd_display_panes_run *run;
+	u_int			 idx, px, py, i, j, k, xoff, yoff, sx, sy;
 	int			 colour, active_colour;
 	char			 buf[16], *ptr;
 	size_t			 len;
@@ -132,15 +173,21 @@ cmd_display_panes_draw_pane(struct screen_redraw_ctx *ctx,
 	else
 		gc.bg = colour;
 	tty_attributes(tty, &gc, &grid_default_cell, NULL);
+	if (!cmd_display_panes_runs_built)
+		cmd_display_panes_build_runs();
 	for (ptr = buf; *ptr != '\0'; ptr++) {
 		if (*ptr < '0' || *ptr > '9')
 			continue;
 		idx = *ptr - '0';
 
 		for (j = 0; j < 5; j++) {
-			for (i = px; i < px + 5; i++) {
-				tty_cursor(tty, xoff + i, yoff + py + j);
-				if (window_clock_table[idx][j][i - px])
+			for (i = 0; i < 3; i++) {
+				run = &cmd_display_panes_runs[idx][j][i];
+				if (run->len == 0)
+					break;
+				tty_cursor(tty, xoff + px + run->start,
+				    yoff + py + j);
+				for (k = 0; k < run->len; k++)
 					tty_putc(tty, ' ');
 			}
 		}
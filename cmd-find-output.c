@@ -0,0 +1,133 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2009 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+
+#include <fnmatch.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tmux.h"
+
+/*
+ * Search the contents of every pane on the server, including history, and
+ * print matching lines with their pane and line number.
+ */
+
+static enum cmd_retval	cmd_find_output_exec(struct cmd *, struct cmdq_item *);
+
+const struct cmd_entry cmd_find_output_entry = {
+	.name = "find-output",
+	.alias = "findo",
+
+	.args = { "il:r", 1, 1 },
+	.usage = "[-ir] [-l limit] match-string",
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_find_output_exec
+};
+
+static u_int
+cmd_find_output_pane(struct cmdq_item *item, struct window_pane *wp,
+    const char *pattern, regex_t *r, int flags, uint64_t mask, u_int limit)
+{
+	struct grid		*gd = wp->base.grid;
+	char			*line;
+	u_int			 y, found = 0;
+	int			 matched;
+
+	for (y = 0; y < gd->hsize + gd->sy; y++) {
+		if (!grid_line_may_contain(gd, y, mask))
+			continue;
+		line = grid_string_cells(gd, 0, y, gd->sx, NULL, 0, 0, 1);
+		if (r == NULL)
+			matched = (fnmatch(pattern, line, flags) == 0);
+		else
+			matched = (regexec(r, line, 0, NULL, 0) == 0);
+		if (matched) {
+			cmdq_print(item, "%%%u:%d: %s", wp->id,
+			    (int)y - (int)gd->hsize, line);
+			found++;
+		}
+		free(line);
+		if (limit != 0 && found == limit)
+			break;
+	}
+	return (found);
+}
+
+static enum cmd_retval
+cmd_find_output_exec(struct cmd *self, struct cmdq_item *item)
+{
+	struct args		*args = cmd_get_args(self);
+	const char		*s = args->argv[0];
+	struct window		*w;
+	struct window_pane	*wp;
+	regex_t			 r;
+	char			*pattern = NULL, *cause;
+	int			 flags = 0;
+	uint64_t		 mask = 0;
+	u_int			 limit = 0, found = 0;
+
+	if (args_has(args, 'l')) {
+		limit = args_strtonum(args, 'l', 1, INT_MAX, &cause);
+		if (cause != NULL) {
+			cmdq_error(item, "limit %s", cause);
+			free(cause);
+			return (CMD_RETURN_ERROR);
+		}
+	}
+
+	if (!args_has(args, 'r')) {
+		if (args_has(args, 'i'))
+			flags |= FNM_CASEFOLD;
+		xasprintf(&pattern, "*%s*", s);
+	} else {
+		if (args_has(args, 'i'))
+			flags |= REG_ICASE;
+		if (regcomp(&r, s, flags|REG_EXTENDED) != 0) {
+			cmdq_error(item, "invalid regular expression");
+			return (CMD_RETURN_ERROR);
+		}
+	}
+
+	/*
+	 * A plain literal query can consult the trigram signatures kept by
+	 * the history-index option to skip lines that cannot match.
+	 */
+	if (!args_has(args, 'r') && strpbrk(s, "*?[\\") == NULL)
+		mask = grid_trigram_mask(s);
+
+	RB_FOREACH(w, windows, &windows) {
+		TAILQ_FOREACH(wp, &w->panes, entry) {
+			found += cmd_find_output_pane(item, wp, pattern,
+			    args_has(args, 'r') ? &r : NULL, flags, mask,
+			    limit == 0 ? 0 : limit - found);
+			if (limit != 0 && found >= limit)
+				goto out;
+		}
+	}
+
+out:
+	if (!args_has(args, 'r'))
+		free(pattern);
+	else
+		regfree(&r);
+	return (CMD_RETURN_NORMAL);
+}
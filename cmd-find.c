@@ -75,6 +75,165 @@ static const char *cmd_find_pane_table[][2] = {
 	{ NULL, NULL }
 };
 
+/*
+ * Cache of resolved targets. Only targets anchored to a session, window or
+ * pane id (or an exact session name) are cached since anything else depends
+ * on the current state of the client or queue. Entries hold ids rather than
+ * pointers and are revalidated on lookup; the generation is bumped from
+ * notify.c whenever anything is created, destroyed or renamed.
+ */
+struct cmd_find_cache_entry {
+	char				*target;
+	enum cmd_find_type		 type;
+	int				 flags;
+
+	u_int				 generation;
+
+	u_int				 session_id;
+	int				 wl_idx;	/* -1 if no winlink */
+	u_int				 window_id;
+	int				 has_wp;
+	u_int				 pane_id;
+	int				 idx;
+	int				 fsflags;
+
+	RB_ENTRY(cmd_find_cache_entry)	 entry;
+};
+RB_HEAD(cmd_find_cache_tree, cmd_find_cache_entry);
+
+static int	cmd_find_cache_cmp(struct cmd_find_cache_entry *,
+		    struct cmd_find_cache_entry *);
+RB_GENERATE_STATIC(cmd_find_cache_tree, cmd_find_cache_entry, entry,
+    cmd_find_cache_cmp);
+
+static struct cmd_find_cache_tree cmd_find_cache =
+    RB_INITIALIZER(&cmd_find_cache);
+static u_int	cmd_find_generation;
+static u_int	cmd_find_cache_count;
+#define CMD_FIND_CACHE_LIMIT 1000
+
+/* Compare two cache entries. */
+static int
+cmd_find_cache_cmp(struct cmd_find_cache_entry *a,
+    struct cmd_find_cache_entry *b)
+{
+	if (a->type != b->type)
+		return (a->type < b->type ? -1 : 1);
+	if (a->flags != b->flags)
+		return (a->flags < b->flags ? -1 : 1);
+	return (strcmp(a->target, b->target));
+}
+
+/* Remove one entry from the cache. */
+static void
+cmd_find_cache_remove(struct cmd_find_cache_entry *ce)
+{
+	RB_REMOVE(cmd_find_cache_tree, &cmd_find_cache, ce);
+	free(ce->target);
+	free(ce);
+	cmd_find_cache_count--;
+}
+
+/* Invalidate all cached targets after a lifecycle change. */
+void
+cmd_find_invalidate(void)
+{
+	cmd_find_generation++;
+}
+
+/* Look up a target in the cache and rebuild the state from it. */
+static int
+cmd_find_cache_get(struct cmd_find_state *fs, const char *target,
+    enum cmd_find_type type, int flags)
+{
+	struct cmd_find_cache_entry	 find, *ce;
+	struct session			*s;
+	struct winlink			*wl = NULL;
+	struct window_pane		*wp = NULL;
+
+	find.target = (char *)target;
+	find.type = type;
+	find.flags = flags;
+	ce = RB_FIND(cmd_find_cache_tree, &cmd_find_cache, &find);
+	if (ce == NULL)
+		return (-1);
+	if (ce->generation != cmd_find_generation)
+		goto stale;
+
+	s = session_find_by_id(ce->session_id);
+	if (s == NULL)
+		goto stale;
+	if (ce->wl_idx != -1) {
+		wl = winlink_find_by_index(&s->windows, ce->wl_idx);
+		if (wl == NULL || wl->window->id != ce->window_id)
+			goto stale;
+	}
+	if (ce->has_wp) {
+		wp = window_pane_find_by_id(ce->pane_id);
+		if (wp == NULL || (wl != NULL && wp->window != wl->window))
+			goto stale;
+	}
+
+	fs->s = s;
+	fs->wl = wl;
+	fs->w = (wl != NULL) ? wl->window : NULL;
+	fs->wp = wp;
+	fs->idx = ce->idx;
+	fs->flags = ce->fsflags;
+	log_debug("%s: cached target %s", __func__, target);
+	return (0);
+
+stale:
+	cmd_find_cache_remove(ce);
+	return (-1);
+}
+
+/* Store a resolved target in the cache. */
+static void
+cmd_find_cache_add(struct cmd_find_state *fs, const char *target,
+    enum cmd_find_type type, int flags)
+{
+	struct cmd_find_cache_entry	 find, *ce, *ce1;
+
+	if (fs->s == NULL)
+		return;
+	if (fs->wl != NULL && fs->wl->window != fs->w)
+		return;
+
+	find.target = (char *)target;
+	find.type = type;
+	find.flags = flags;
+	ce = RB_FIND(cmd_find_cache_tree, &cmd_find_cache, &find);
+	if (ce == NULL) {
+		if (cmd_find_cache_count == CMD_FIND_CACHE_LIMIT) {
+			RB_FOREACH_SAFE(ce, cmd_find_cache_tree,
+			    &cmd_find_cache, ce1)
+				cmd_find_cache_remove(ce);
+		}
+		ce = xcalloc(1, sizeof *ce);
+		ce->target = xstrdup(target);
+		ce->type = type;
+		ce->flags = flags;
+		RB_INSERT(cmd_find_cache_tree, &cmd_find_cache, ce);
+		cmd_find_cache_count++;
+	}
+
+	ce->generation = cmd_find_generation;
+	ce->session_id = fs->s->id;
+	if (fs->wl != NULL) {
+		ce->wl_idx = fs->wl->idx;
+		ce->window_id = fs->w->id;
+	} else
+		ce->wl_idx = -1;
+	if (fs->wp != NULL) {
+		ce->has_wp = 1;
+		ce->pane_id = fs->wp->id;
+	} else
+		ce->has_wp = 0;
+	ce->idx = fs->idx;
+	ce->fsflags = fs->flags;
+}
+
 /* Find pane containing client if any. */
 static struct window_pane *
 cmd_find_inside_pane(struct client *c)
@@ -927,7 +1086,7 @@ cmd_find_target(struct cmd_find_state *fs, struct cmdq_item *item,
 	struct cmd_find_state	 current;
 	char			*colon, *period, *copy = NULL, tmp[256];
 	const char		*session, *window, *pane, *s;
-	int			 window_only = 0, pane_only = 0;
+	int			 window_only = 0, pane_only = 0, cacheable = 0;
 
 	/* Can fail flag implies quiet. */
 	if (flags & CMD_FIND_CANFAIL)
@@ -1031,6 +1190,10 @@ cmd_find_target(struct cmd_find_state *fs, struct cmdq_item *item,
 		goto found;
 	}
 
+	/* Try the cache of previously resolved targets. */
+	if (cmd_find_cache_get(fs, target, type, flags) == 0)
+		goto found;
+
 	/* Find separators if they exist. */
 	copy = xstrdup(target);
 	colon = strchr(copy, ':');
@@ -1107,6 +1270,19 @@ cmd_find_target(struct cmd_find_state *fs, struct cmdq_item *item,
 	if (pane != NULL)
 		pane = cmd_find_map_table(cmd_find_pane_table, pane);
 
+	/*
+	 * The result can be cached if it cannot depend on the current state:
+	 * the session part must be an id or exact name, or the target must be
+	 * a bare window or pane id.
+	 */
+	if (session != NULL) {
+		cacheable = ((fs->flags & CMD_FIND_EXACT_SESSION) ||
+		    *session == '$');
+	} else if (window != NULL)
+		cacheable = (*window == '@' && pane == NULL);
+	else if (pane != NULL)
+		cacheable = (*pane == '%');
+
 	if (session != NULL || window != NULL || pane != NULL) {
 		log_debug("%s: target %s is %s%s%s%s%s%s",
 		    __func__, target,
@@ -1219,6 +1395,9 @@ found:
 	fs->current = NULL;
 	cmd_find_log_state(__func__, fs);
 
+	if (cacheable)
+		cmd_find_cache_add(fs, target, type, flags);
+
 	free(copy);
 	return (0);
 
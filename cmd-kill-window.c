@@ -71,10 +71,11 @@ cmd_kill_window_exec(struct cmd *self, struct cmdq_item *item)
 		if (args_has(args, 'a')) {
 			RB_FOREACH_SAFE(wl2, winlinks, &s->windows, wl3) {
 				if (wl != wl2)
-					server_kill_window(wl2->window);
+					server_kill_window(wl2->window, 0);
 			}
 		} else
-			server_kill_window(wl->window);
+			server_kill_window(wl->window, 0);
+		server_renumber_all();
 	}
 
 	recalculate_sizes();
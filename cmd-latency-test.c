@@ -0,0 +1,217 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2021 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tmux.h"
+
+/*
+ * Measure keystroke echo latency in a pane. A key is written to the pane and
+ * the time until the pane next produces output - the echo coming back from
+ * the program inside - is recorded, repeated for a number of iterations and
+ * reported as a percentile breakdown. The pane must be running something
+ * that echoes input, such as a shell.
+ */
+
+struct cmd_latency_test_data {
+	struct cmdq_item	*item;
+	u_int			 wp_id;
+
+	u_int			 count;
+	u_int			 n;
+	uint64_t		*samples;
+
+	int			 waiting;
+	struct timeval		 sent;
+	struct event		 timer;
+};
+
+static enum cmd_retval	cmd_latency_test_exec(struct cmd *,
+			    struct cmdq_item *);
+
+static void	cmd_latency_test_send(struct cmd_latency_test_data *);
+static void	cmd_latency_test_finish(struct cmd_latency_test_data *,
+		    const char *);
+static void	cmd_latency_test_probe(struct window_pane *, void *);
+static void	cmd_latency_test_timer(int, short, void *);
+
+const struct cmd_entry cmd_latency_test_entry = {
+	.name = "latency-test",
+	.alias = NULL,
+
+	.args = { "n:t:", 0, 0 },
+	.usage = "[-n count] " CMD_TARGET_PANE_USAGE,
+
+	.target = { 't', CMD_FIND_PANE, 0 },
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_latency_test_exec
+};
+
+static int
+cmd_latency_test_cmp(const void *p1, const void *p2)
+{
+	const uint64_t	*u1 = p1, *u2 = p2;
+
+	if (*u1 < *u2)
+		return (-1);
+	if (*u1 > *u2)
+		return (1);
+	return (0);
+}
+
+/* Detach the probe from the pane and report the collected samples. */
+static void
+cmd_latency_test_finish(struct cmd_latency_test_data *data, const char *error)
+{
+	struct window_pane	*wp;
+	uint64_t		 sum = 0;
+	u_int			 i;
+
+	wp = window_pane_find_by_id(data->wp_id);
+	if (wp != NULL && wp->probe_data == data) {
+		wp->probe_cb = NULL;
+		wp->probe_data = NULL;
+	}
+	evtimer_del(&data->timer);
+
+	if (error != NULL)
+		cmdq_error(data->item, "%s", error);
+	else {
+		qsort(data->samples, data->n, sizeof *data->samples,
+		    cmd_latency_test_cmp);
+		for (i = 0; i < data->n; i++)
+			sum += data->samples[i];
+		cmdq_print(data->item, "echo latency: %u samples: "
+		    "min=%lluus avg=%lluus p50=%lluus p90=%lluus p99=%lluus "
+		    "max=%lluus", data->n,
+		    (unsigned long long)data->samples[0],
+		    (unsigned long long)(sum / data->n),
+		    (unsigned long long)data->samples[(data->n - 1) / 2],
+		    (unsigned long long)data->samples[(data->n - 1) * 9 / 10],
+		    (unsigned long long)data->samples[(data->n - 1) * 99 /
+		    100],
+		    (unsigned long long)data->samples[data->n - 1]);
+	}
+	cmdq_continue(data->item);
+
+	free(data->samples);
+	free(data);
+}
+
+/* Send the marker key and arm the echo timeout. */
+static void
+cmd_latency_test_send(struct cmd_latency_test_data *data)
+{
+	struct window_pane	*wp;
+	struct timeval		 tv = { .tv_sec = 2 };
+
+	wp = window_pane_find_by_id(data->wp_id);
+	if (wp == NULL || wp->probe_data != data) {
+		cmd_latency_test_finish(data, "pane closed");
+		return;
+	}
+
+	gettimeofday(&data->sent, NULL);
+	data->waiting = 1;
+	evtimer_add(&data->timer, &tv);
+
+	if (window_pane_key(wp, NULL, NULL, NULL, ' ', NULL) != 0)
+		cmd_latency_test_finish(data, "cannot write to pane");
+}
+
+/* Pane produced output after the marker key: record one sample. */
+static void
+cmd_latency_test_probe(__unused struct window_pane *wp, void *arg)
+{
+	struct cmd_latency_test_data	*data = arg;
+	struct timeval			 now, since;
+	struct timeval			 tv = { .tv_usec = 10000 };
+
+	if (!data->waiting)
+		return;
+	data->waiting = 0;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &data->sent, &since);
+	data->samples[data->n++] = (uint64_t)since.tv_sec * 1000000 +
+	    since.tv_usec;
+
+	evtimer_del(&data->timer);
+	if (data->n == data->count) {
+		cmd_latency_test_finish(data, NULL);
+		return;
+	}
+	evtimer_add(&data->timer, &tv);
+}
+
+/* Waiting for an echo this is a timeout, otherwise time for the next key. */
+static void
+cmd_latency_test_timer(__unused int fd, __unused short events, void *arg)
+{
+	struct cmd_latency_test_data	*data = arg;
+
+	if (data->waiting)
+		cmd_latency_test_finish(data, "no echo from pane");
+	else
+		cmd_latency_test_send(data);
+}
+
+static enum cmd_retval
+cmd_latency_test_exec(struct cmd *self, struct cmdq_item *item)
+{
+	struct args			*args = cmd_get_args(self);
+	struct cmd_find_state		*target = cmdq_get_target(item);
+	struct window_pane		*wp = target->wp;
+	struct cmd_latency_test_data	*data;
+	const char			*errstr;
+	u_int				 count = 10;
+
+	if (args_has(args, 'n')) {
+		count = strtonum(args_get(args, 'n'), 1, 1000, &errstr);
+		if (errstr != NULL) {
+			cmdq_error(item, "count %s", errstr);
+			return (CMD_RETURN_ERROR);
+		}
+	}
+	if (wp->fd == -1 || (wp->flags & PANE_INPUTOFF)) {
+		cmdq_error(item, "pane is not accepting input");
+		return (CMD_RETURN_ERROR);
+	}
+	if (wp->probe_cb != NULL) {
+		cmdq_error(item, "latency test already running");
+		return (CMD_RETURN_ERROR);
+	}
+
+	data = xcalloc(1, sizeof *data);
+	data->item = item;
+	data->wp_id = wp->id;
+	data->count = count;
+	data->samples = xcalloc(count, sizeof *data->samples);
+	evtimer_set(&data->timer, cmd_latency_test_timer, data);
+
+	wp->probe_cb = cmd_latency_test_probe;
+	wp->probe_data = data;
+
+	cmd_latency_test_send(data);
+	return (CMD_RETURN_WAIT);
+}
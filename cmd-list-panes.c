@@ -28,18 +28,28 @@
 
 static enum cmd_retval	cmd_list_panes_exec(struct cmd *, struct cmdq_item *);
 
-static void	cmd_list_panes_server(struct cmd *, struct cmdq_item *);
+/* State shared across the walk for -c cursor and -n limit. */
+struct cmd_list_panes_data {
+	u_int	 cursor;	/* pane id to resume after */
+	int	 found;		/* cursor seen, printing output */
+	int	 left;		/* entries left to print, -1 for no limit */
+};
+
+static void	cmd_list_panes_server(struct cmd *, struct cmdq_item *,
+		    struct cmd_list_panes_data *);
 static void	cmd_list_panes_session(struct cmd *, struct session *,
-		    struct cmdq_item *, int);
+		    struct cmdq_item *, int, struct cmd_list_panes_data *);
 static void	cmd_list_panes_window(struct cmd *, struct session *,
-		    struct winlink *, struct cmdq_item *, int);
+		    struct winlink *, struct cmdq_item *, int,
+		    struct cmd_list_panes_data *);
 
 const struct cmd_entry cmd_list_panes_entry = {
 	.name = "list-panes",
 	.alias = "lsp",
 
-	.args = { "asF:f:t:", 0, 0 },
-	.usage = "[-as] [-F format] [-f filter] " CMD_TARGET_WINDOW_USAGE,
+	.args = { "ac:sF:f:n:t:", 0, 0 },
+	.usage = "[-as] [-c cursor] [-F format] [-f filter] [-n number] "
+		 CMD_TARGET_WINDOW_USAGE,
 
 	.target = { 't', CMD_FIND_WINDOW, 0 },
 
@@ -52,41 +62,73 @@ cmd_list_panes_exec(struct cmd *self, struct cmdq_item *item)
 {
 	struct args		*args = cmd_get_args(self);
 	struct cmd_find_state	*target = cmdq_get_target(item);
-	struct session		*s = target->s;
-	struct winlink		*wl = target->wl;
+	struct session			*s = target->s;
+	struct winlink			*wl = target->wl;
+	struct cmd_list_panes_data	 data;
+	struct window_pane		*wp;
+	const char			*cursor;
+	char				*cause;
+
+	data.cursor = 0;
+	data.found = 1;
+	data.left = -1;
+
+	if ((cursor = args_get(args, 'c')) != NULL) {
+		if ((wp = window_pane_find_by_id_str(cursor)) == NULL) {
+			cmdq_error(item, "cursor pane not found: %s", cursor);
+			return (CMD_RETURN_ERROR);
+		}
+		data.cursor = wp->id;
+		data.found = 0;
+	}
+	if (args_has(args, 'n')) {
+		data.left = args_strtonum(args, 'n', 1, INT_MAX, &cause);
+		if (cause != NULL) {
+			cmdq_error(item, "number %s", cause);
+			free(cause);
+			return (CMD_RETURN_ERROR);
+		}
+	}
 
 	if (args_has(args, 'a'))
-		cmd_list_panes_server(self, item);
+		cmd_list_panes_server(self, item, &data);
 	else if (args_has(args, 's'))
-		cmd_list_panes_session(self, s, item, 1);
+		cmd_list_panes_session(self, s, item, 1, &data);
 	else
-		cmd_list_panes_window(self, s, wl, item, 0);
+		cmd_list_panes_window(self, s, wl, item, 0, &data);
 
 	return (CMD_RETURN_NORMAL);
 }
 
 static void
-cmd_list_panes_server(struct cmd *self, struct cmdq_item *item)
+cmd_list_panes_server(struct cmd *self, struct cmdq_item *item,
+    struct cmd_list_panes_data *data)
 {
 	struct session	*s;
 
-	RB_FOREACH(s, sessions, &sessions)
-		cmd_list_panes_session(self, s, item, 2);
+	RB_FOREACH(s, sessions, &sessions) {
+		if (data->left == 0)
+			break;
+		cmd_list_panes_session(self, s, item, 2, data);
+	}
 }
 
 static void
 cmd_list_panes_session(struct cmd *self, struct session *s,
-    struct cmdq_item *item, int type)
+    struct cmdq_item *item, int type, struct cmd_list_panes_data *data)
 {
 	struct winlink	*wl;
 
-	RB_FOREACH(wl, winlinks, &s->windows)
-		cmd_list_panes_window(self, s, wl, item, type);
+	RB_FOREACH(wl, winlinks, &s->windows) {
+		if (data->left == 0)
+			break;
+		cmd_list_panes_window(self, s, wl, item, type, data);
+	}
 }
 
 static void
 cmd_list_panes_window(struct cmd *self, struct session *s, struct winlink *wl,
-    struct cmdq_item *item, int type)
+    struct cmdq_item *item, int type, struct cmd_list_panes_data *data)
 {
 	struct args		*args = cmd_get_args(self);
 	struct window_pane	*wp;
@@ -126,6 +168,19 @@ cmd_list_panes_window(struct cmd *self, struct session *s, struct winlink *wl,
 
 	n = 0;
 	TAILQ_FOREACH(wp, &wl->window->panes, entry) {
+		/*
+		 * Panes before the cursor and after the limit are skipped
+		 * before any format tree is built for them.
+		 */
+		if (!data->found) {
+			if (wp->id == data->cursor)
+				data->found = 1;
+			n++;
+			continue;
+		}
+		if (data->left == 0)
+			break;
+
 		ft = format_create(cmdq_get_client(item), item, FORMAT_NONE, 0);
 		format_add(ft, "line", "%u", n);
 		format_defaults(ft, NULL, s, wl, wp);
@@ -140,6 +195,8 @@ cmd_list_panes_window(struct cmd *self, struct session *s, struct winlink *wl,
 			line = format_expand(ft, template);
 			cmdq_print(item, "%s", line);
 			free(line);
+			if (data->left > 0)
+				data->left--;
 		}
 
 		format_free(ft);
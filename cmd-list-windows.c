@@ -41,16 +41,25 @@
 
 static enum cmd_retval	cmd_list_windows_exec(struct cmd *, struct cmdq_item *);
 
-static void	cmd_list_windows_server(struct cmd *, struct cmdq_item *);
+/* State shared across the walk for -c cursor and -n limit. */
+struct cmd_list_windows_data {
+	u_int	 cursor;	/* window id to resume after */
+	int	 found;		/* cursor seen, printing output */
+	int	 left;		/* entries left to print, -1 for no limit */
+};
+
+static void	cmd_list_windows_server(struct cmd *, struct cmdq_item *,
+		    struct cmd_list_windows_data *);
 static void	cmd_list_windows_session(struct cmd *, struct session *,
-		    struct cmdq_item *, int);
+		    struct cmdq_item *, int, struct cmd_list_windows_data *);
 
 const struct cmd_entry cmd_list_windows_entry = {
 	.name = "list-windows",
 	.alias = "lsw",
 
-	.args = { "F:f:at:", 0, 0 },
-	.usage = "[-a] [-F format] [-f filter] " CMD_TARGET_SESSION_USAGE,
+	.args = { "ac:F:f:n:t:", 0, 0 },
+	.usage = "[-a] [-c cursor] [-F format] [-f filter] [-n number] "
+		 CMD_TARGET_SESSION_USAGE,
 
 	.target = { 't', CMD_FIND_SESSION, 0 },
 
@@ -61,29 +70,59 @@ const struct cmd_entry cmd_list_windows_entry = {
 static enum cmd_retval
 cmd_list_windows_exec(struct cmd *self, struct cmdq_item *item)
 {
-	struct args		*args = cmd_get_args(self);
-	struct cmd_find_state	*target = cmdq_get_target(item);
+	struct args			*args = cmd_get_args(self);
+	struct cmd_find_state		*target = cmdq_get_target(item);
+	struct cmd_list_windows_data	 data;
+	struct window			*w;
+	const char			*cursor;
+	char				*cause;
+
+	data.cursor = 0;
+	data.found = 1;
+	data.left = -1;
+
+	if ((cursor = args_get(args, 'c')) != NULL) {
+		if ((w = window_find_by_id_str(cursor)) == NULL) {
+			cmdq_error(item, "cursor window not found: %s",
+			    cursor);
+			return (CMD_RETURN_ERROR);
+		}
+		data.cursor = w->id;
+		data.found = 0;
+	}
+	if (args_has(args, 'n')) {
+		data.left = args_strtonum(args, 'n', 1, INT_MAX, &cause);
+		if (cause != NULL) {
+			cmdq_error(item, "number %s", cause);
+			free(cause);
+			return (CMD_RETURN_ERROR);
+		}
+	}
 
 	if (args_has(args, 'a'))
-		cmd_list_windows_server(self, item);
+		cmd_list_windows_server(self, item, &data);
 	else
-		cmd_list_windows_session(self, target->s, item, 0);
+		cmd_list_windows_session(self, target->s, item, 0, &data);
 
 	return (CMD_RETURN_NORMAL);
 }
 
 static void
-cmd_list_windows_server(struct cmd *self, struct cmdq_item *item)
+cmd_list_windows_server(struct cmd *self, struct cmdq_item *item,
+    struct cmd_list_windows_data *data)
 {
 	struct session	*s;
 
-	RB_FOREACH(s, sessions, &sessions)
-		cmd_list_windows_session(self, s, item, 1);
+	RB_FOREACH(s, sessions, &sessions) {
+		if (data->left == 0)
+			break;
+		cmd_list_windows_session(self, s, item, 1, data);
+	}
 }
 
 static void
 cmd_list_windows_session(struct cmd *self, struct session *s,
-    struct cmdq_item *item, int type)
+    struct cmdq_item *item, int type, struct cmd_list_windows_data *data)
 {
 	struct args		*args = cmd_get_args(self);
 	struct winlink		*wl;
@@ -108,6 +147,19 @@ cmd_list_windows_session(struct cmd *self, struct session *s,
 
 	n = 0;
 	RB_FOREACH(wl, winlinks, &s->windows) {
+		/*
+		 * Windows before the cursor and after the limit are skipped
+		 * before any format tree is built for them.
+		 */
+		if (!data->found) {
+			if (wl->window->id == data->cursor)
+				data->found = 1;
+			n++;
+			continue;
+		}
+		if (data->left == 0)
+			break;
+
 		ft = format_create(cmdq_get_client(item), item, FORMAT_NONE, 0);
 		format_add(ft, "line", "%u", n);
 		format_defaults(ft, NULL, s, wl, NULL);
@@ -122,6 +174,8 @@ cmd_list_windows_session(struct cmd *self, struct session *s,
 			line = format_expand(ft, template);
 			cmdq_print(item, "%s", line);
 			free(line);
+			if (data->left > 0)
+				data->left--;
 		}
 
 		format_free(ft);
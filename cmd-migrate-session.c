@@ -0,0 +1,142 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2021 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tmux.h"
+
+/*
+ * Move a session to the server at another socket path: write a
+ * single-session snapshot and run a client to load it into the peer.
+ * The socket carries the usual ownership checks, and a forwarded socket
+ * extends that to another host. Processes are not migrated - the peer's
+ * panes hold the scrollback above fresh shells, as restore-server does.
+ */
+
+static enum cmd_retval	cmd_migrate_session_exec(struct cmd *,
+			    struct cmdq_item *);
+
+static void	cmd_migrate_session_callback(struct job *);
+static void	cmd_migrate_session_free(void *);
+
+const struct cmd_entry cmd_migrate_session_entry = {
+	.name = "migrate-session",
+	.alias = NULL,
+
+	.args = { "kt:", 1, 1 },
+	.usage = "[-k] " CMD_TARGET_SESSION_USAGE " socket-path",
+
+	.target = { 't', CMD_FIND_SESSION, 0 },
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_migrate_session_exec
+};
+
+struct cmd_migrate_session_data {
+	char			*path;
+	char			*cmd;
+	struct cmdq_item	*item;
+	u_int			 sid;
+	int			 kill;
+};
+
+static enum cmd_retval
+cmd_migrate_session_exec(struct cmd *self, struct cmdq_item *item)
+{
+	struct args			*args = cmd_get_args(self);
+	struct cmd_find_state		*target = cmdq_get_target(item);
+	struct session			*s = target->s;
+	struct cmd_migrate_session_data	*cdata;
+	char				*cause, *socket, *file;
+
+	cdata = xcalloc(1, sizeof *cdata);
+	cdata->item = item;
+	cdata->sid = s->id;
+	cdata->kill = args_has(args, 'k');
+
+	xasprintf(&cdata->path, "%s-migrate-%u", socket_path, s->id);
+	if (snapshot_write_session(s, cdata->path, &cause) != 0) {
+		cmdq_error(item, "%s", cause);
+		free(cause);
+		cmd_migrate_session_free(cdata);
+		return (CMD_RETURN_ERROR);
+	}
+
+	socket = args_escape(args->argv[0]);
+	file = args_escape(cdata->path);
+	xasprintf(&cdata->cmd, "exec tmux -S %s restore-server %s", socket,
+	    file);
+	free(file);
+	free(socket);
+
+	if (job_run(cdata->cmd, s, NULL, NULL, cmd_migrate_session_callback,
+	    cmd_migrate_session_free, cdata, 0, -1, -1) == NULL) {
+		cmdq_error(item, "failed to run %s", cdata->cmd);
+		cmd_migrate_session_free(cdata);
+		return (CMD_RETURN_ERROR);
+	}
+	return (CMD_RETURN_WAIT);
+}
+
+static void
+cmd_migrate_session_callback(struct job *job)
+{
+	struct cmd_migrate_session_data	*cdata = job_get_data(job);
+	struct cmdq_item		*item = cdata->item;
+	struct session			*s;
+	int				 status = job_get_status(job);
+	int				 retcode = -1;
+
+	if (WIFEXITED(status))
+		retcode = WEXITSTATUS(status);
+	if (retcode != 0) {
+		if (item != NULL) {
+			cmdq_error(item, "migration failed: '%s' returned %d",
+			    cdata->cmd, retcode);
+		}
+	} else {
+		/*
+		 * The peer has the session; only now is it safe to drop the
+		 * local copy if asked to.
+		 */
+		if (cdata->kill &&
+		    (s = session_find_by_id(cdata->sid)) != NULL) {
+			server_destroy_session(s);
+			session_destroy(s, 1, __func__);
+		}
+	}
+
+	if (item != NULL)
+		cmdq_continue(item);
+}
+
+static void
+cmd_migrate_session_free(void *data)
+{
+	struct cmd_migrate_session_data	*cdata = data;
+
+	if (cdata->path != NULL)
+		unlink(cdata->path);
+	free(cdata->path);
+	free(cdata->cmd);
+	free(cdata);
+}
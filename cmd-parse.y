@@ -19,10 +19,12 @@
 %{
 
 #include <sys/types.h>
+#include <sys/stat.h>
 
 #include <ctype.h>
 #include <errno.h>
 #include <pwd.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -60,6 +62,7 @@ struct cmd_parse_state {
 	size_t				 off;
 
 	int				 condition;
+	int				 uncacheable;
 	int				 eol;
 	int				 eof;
 	struct cmd_parse_input		*input;
@@ -73,10 +76,18 @@ struct cmd_parse_state {
 };
 static struct cmd_parse_state parse_state;
 
+static void	 cmd_parse_arena_push(void);
+static void	 cmd_parse_arena_pop(void);
+static void	*cmd_parse_arena_alloc(size_t);
+static char	*cmd_parse_arena_strdup(const char *);
+static void	 cmd_parse_arena_argv_append(int *, char ***, char *);
+static void	 cmd_parse_arena_argv_prepend(int *, char ***, char *);
 static char	*cmd_parse_get_error(const char *, u_int, const char *);
-static void	 cmd_parse_free_command(struct cmd_parse_command *);
 static struct cmd_parse_commands *cmd_parse_new_commands(void);
-static void	 cmd_parse_free_commands(struct cmd_parse_commands *);
+static struct cmd_parse_commands *cmd_parse_cache_read(const char *,
+		     struct stat *);
+static void	 cmd_parse_cache_write(const char *, struct stat *,
+		     struct cmd_parse_commands *);
 static void	 cmd_parse_print_commands(struct cmd_parse_input *, u_int,
 		     struct cmd_list *);
 
@@ -131,18 +142,15 @@ statements	: statement '\n'
 		{
 			$$ = $1;
 			TAILQ_CONCAT($$, $2, entry);
-			free($2);
 		}
 
 statement	: /* empty */
 		{
-			$$ = xmalloc (sizeof *$$);
-			TAILQ_INIT($$);
+			$$ = cmd_parse_new_commands();
 		}
 		| hidden_assignment
 		{
-			$$ = xmalloc (sizeof *$$);
-			TAILQ_INIT($$);
+			$$ = cmd_parse_new_commands();
 		}
 		| condition
 		{
@@ -150,10 +158,8 @@ statement	: /* empty */
 
 			if (ps->scope == NULL || ps->scope->flag)
 				$$ = $1;
-			else {
+			else
 				$$ = cmd_parse_new_commands();
-				cmd_parse_free_commands($1);
-			}
 		}
 		| commands
 		{
@@ -161,10 +167,8 @@ statement	: /* empty */
 
 			if (ps->scope == NULL || ps->scope->flag)
 				$$ = $1;
-			else {
+			else
 				$$ = cmd_parse_new_commands();
-				cmd_parse_free_commands($1);
-			}
 		}
 
 format		: FORMAT
@@ -197,7 +201,6 @@ expanded	: format
 
 			$$ = format_expand(ft, $1);
 			format_free(ft);
-			free($1);
 		}
 
 optional_assignment	: /* empty */
@@ -208,10 +211,10 @@ assignment	: EQUALS
 			struct cmd_parse_state	*ps = &parse_state;
 			int			 flags = ps->input->flags;
 
+			ps->uncacheable = 1;
 			if ((~flags & CMD_PARSE_PARSEONLY) &&
 			    (ps->scope == NULL || ps->scope->flag))
 				environ_put(global_environ, $1, 0);
-			free($1);
 		}
 
 hidden_assignment : HIDDEN EQUALS
@@ -219,10 +222,10 @@ hidden_assignment : HIDDEN EQUALS
 			struct cmd_parse_state	*ps = &parse_state;
 			int			 flags = ps->input->flags;
 
+			ps->uncacheable = 1;
 			if ((~flags & CMD_PARSE_PARSEONLY) &&
 			    (ps->scope == NULL || ps->scope->flag))
 				environ_put(global_environ, $2, ENVIRON_HIDDEN);
-			free($2);
 		}
 
 if_open		: IF expanded
@@ -230,7 +233,7 @@ if_open		: IF expanded
 			struct cmd_parse_state	*ps = &parse_state;
 			struct cmd_parse_scope	*scope;
 
-			scope = xmalloc(sizeof *scope);
+			scope = cmd_parse_arena_alloc(sizeof *scope);
 			$$ = scope->flag = format_true($2);
 			free($2);
 
@@ -244,10 +247,9 @@ if_else		: ELSE
 			struct cmd_parse_state	*ps = &parse_state;
 			struct cmd_parse_scope	*scope;
 
-			scope = xmalloc(sizeof *scope);
+			scope = cmd_parse_arena_alloc(sizeof *scope);
 			scope->flag = !ps->scope->flag;
 
-			free(ps->scope);
 			ps->scope = scope;
 		}
 
@@ -256,11 +258,10 @@ if_elif		: ELIF expanded
 			struct cmd_parse_state	*ps = &parse_state;
 			struct cmd_parse_scope	*scope;
 
-			scope = xmalloc(sizeof *scope);
+			scope = cmd_parse_arena_alloc(sizeof *scope);
 			$$ = scope->flag = format_true($2);
 			free($2);
 
-			free(ps->scope);
 			ps->scope = scope;
 		}
 
@@ -268,7 +269,6 @@ if_close	: ENDIF
 		{
 			struct cmd_parse_state	*ps = &parse_state;
 
-			free(ps->scope);
 			ps->scope = TAILQ_FIRST(&ps->stack);
 			if (ps->scope != NULL)
 				TAILQ_REMOVE(&ps->stack, ps->scope, entry);
@@ -278,50 +278,33 @@ condition	: if_open '\n' statements if_close
 		{
 			if ($1)
 				$$ = $3;
-			else {
+			else
 				$$ = cmd_parse_new_commands();
-				cmd_parse_free_commands($3);
-			}
 		}
 		| if_open '\n' statements if_else '\n' statements if_close
 		{
-			if ($1) {
+			if ($1)
 				$$ = $3;
-				cmd_parse_free_commands($6);
-			} else {
+			else
 				$$ = $6;
-				cmd_parse_free_commands($3);
-			}
 		}
 		| if_open '\n' statements elif if_close
 		{
-			if ($1) {
+			if ($1)
 				$$ = $3;
-				cmd_parse_free_commands($4.commands);
-			} else if ($4.flag) {
+			else if ($4.flag)
 				$$ = $4.commands;
-				cmd_parse_free_commands($3);
-			} else {
+			else
 				$$ = cmd_parse_new_commands();
-				cmd_parse_free_commands($3);
-				cmd_parse_free_commands($4.commands);
-			}
 		}
 		| if_open '\n' statements elif if_else '\n' statements if_close
 		{
-			if ($1) {
+			if ($1)
 				$$ = $3;
-				cmd_parse_free_commands($4.commands);
-				cmd_parse_free_commands($7);
-			} else if ($4.flag) {
+			else if ($4.flag)
 				$$ = $4.commands;
-				cmd_parse_free_commands($3);
-				cmd_parse_free_commands($7);
-			} else {
+			else
 				$$ = $7;
-				cmd_parse_free_commands($3);
-				cmd_parse_free_commands($4.commands);
-			}
 		}
 
 elif		: if_elif '\n' statements
@@ -332,7 +315,6 @@ elif		: if_elif '\n' statements
 			} else {
 				$$.flag = 0;
 				$$.commands = cmd_parse_new_commands();
-				cmd_parse_free_commands($3);
 			}
 		}
 		| if_elif '\n' statements elif
@@ -340,16 +322,12 @@ elif		: if_elif '\n' statements
 			if ($1) {
 				$$.flag = 1;
 				$$.commands = $3;
-				cmd_parse_free_commands($4.commands);
 			} else if ($4.flag) {
 				$$.flag = 1;
 				$$.commands = $4.commands;
-				cmd_parse_free_commands($3);
 			} else {
 				$$.flag = 0;
 				$$.commands = cmd_parse_new_commands();
-				cmd_parse_free_commands($3);
-				cmd_parse_free_commands($4.commands);
 			}
 		}
 
@@ -361,8 +339,6 @@ commands	: command
 			if ($1->name != NULL &&
 			    (ps->scope == NULL || ps->scope->flag))
 				TAILQ_INSERT_TAIL($$, $1, entry);
-			else
-				cmd_parse_free_command($1);
 		}
 		| commands ';'
 		{
@@ -372,7 +348,6 @@ commands	: command
 		{
 			$$ = $1;
 			TAILQ_CONCAT($$, $3, entry);
-			free($3);
 		}
 		| commands ';' command
 		{
@@ -382,11 +357,8 @@ commands	: command
 			    (ps->scope == NULL || ps->scope->flag)) {
 				$$ = $1;
 				TAILQ_INSERT_TAIL($$, $3, entry);
-			} else {
+			} else
 				$$ = cmd_parse_new_commands();
-				cmd_parse_free_commands($1);
-				cmd_parse_free_command($3);
-			}
 		}
 		| condition1
 		{
@@ -397,7 +369,7 @@ command		: assignment
 		{
 			struct cmd_parse_state	*ps = &parse_state;
 
-			$$ = xcalloc(1, sizeof *$$);
+			$$ = cmd_parse_arena_alloc(sizeof *$$);
 			$$->name = NULL;
 			$$->line = ps->input->line;
 		}
@@ -405,7 +377,7 @@ command		: assignment
 		{
 			struct cmd_parse_state	*ps = &parse_state;
 
-			$$ = xcalloc(1, sizeof *$$);
+			$$ = cmd_parse_arena_alloc(sizeof *$$);
 			$$->name = $2;
 			$$->line = ps->input->line;
 
@@ -414,7 +386,7 @@ command		: assignment
 		{
 			struct cmd_parse_state	*ps = &parse_state;
 
-			$$ = xcalloc(1, sizeof *$$);
+			$$ = cmd_parse_arena_alloc(sizeof *$$);
 			$$->name = $2;
 			$$->line = ps->input->line;
 
@@ -426,50 +398,33 @@ condition1	: if_open commands if_close
 		{
 			if ($1)
 				$$ = $2;
-			else {
+			else
 				$$ = cmd_parse_new_commands();
-				cmd_parse_free_commands($2);
-			}
 		}
 		| if_open commands if_else commands if_close
 		{
-			if ($1) {
+			if ($1)
 				$$ = $2;
-				cmd_parse_free_commands($4);
-			} else {
+			else
 				$$ = $4;
-				cmd_parse_free_commands($2);
-			}
 		}
 		| if_open commands elif1 if_close
 		{
-			if ($1) {
+			if ($1)
 				$$ = $2;
-				cmd_parse_free_commands($3.commands);
-			} else if ($3.flag) {
+			else if ($3.flag)
 				$$ = $3.commands;
-				cmd_parse_free_commands($2);
-			} else {
+			else
 				$$ = cmd_parse_new_commands();
-				cmd_parse_free_commands($2);
-				cmd_parse_free_commands($3.commands);
-			}
 		}
 		| if_open commands elif1 if_else commands if_close
 		{
-			if ($1) {
+			if ($1)
 				$$ = $2;
-				cmd_parse_free_commands($3.commands);
-				cmd_parse_free_commands($5);
-			} else if ($3.flag) {
+			else if ($3.flag)
 				$$ = $3.commands;
-				cmd_parse_free_commands($2);
-				cmd_parse_free_commands($5);
-			} else {
+			else
 				$$ = $5;
-				cmd_parse_free_commands($2);
-				cmd_parse_free_commands($3.commands);
-			}
 		}
 
 elif1		: if_elif commands
@@ -480,7 +435,6 @@ elif1		: if_elif commands
 			} else {
 				$$.flag = 0;
 				$$.commands = cmd_parse_new_commands();
-				cmd_parse_free_commands($2);
 			}
 		}
 		| if_elif commands elif1
@@ -488,30 +442,25 @@ elif1		: if_elif commands
 			if ($1) {
 				$$.flag = 1;
 				$$.commands = $2;
-				cmd_parse_free_commands($3.commands);
 			} else if ($3.flag) {
 				$$.flag = 1;
 				$$.commands = $3.commands;
-				cmd_parse_free_commands($2);
 			} else {
 				$$.flag = 0;
 				$$.commands = cmd_parse_new_commands();
-				cmd_parse_free_commands($2);
-				cmd_parse_free_commands($3.commands);
 			}
 		}
 
 arguments	: argument
 		{
-			$$.argc = 1;
-			$$.argv = xreallocarray(NULL, 1, sizeof *$$.argv);
+			$$.argc = 0;
+			$$.argv = NULL;
 
-			$$.argv[0] = $1;
+			cmd_parse_arena_argv_append(&$$.argc, &$$.argv, $1);
 		}
 		| argument arguments
 		{
-			cmd_prepend_argv(&$2.argc, &$2.argv, $1);
-			free($1);
+			cmd_parse_arena_argv_prepend(&$2.argc, &$2.argv, $1);
 			$$ = $2;
 		}
 
@@ -554,12 +503,113 @@ cmd_parse_print_commands(struct cmd_parse_input *pi, u_int line,
 	}
 }
 
+/*
+ * Parse-time allocations - tokens, argument vectors, command structs and
+ * command lists - come from a bump-pointer arena and are freed in one sweep
+ * when the parse finishes, instead of piecemeal as the grammar discards
+ * them. The arena is pushed at each public entry point and popped when the
+ * outermost parse completes, so nested parses (alias expansion) share the
+ * enclosing arena. Only results that outlive the parse - the built command
+ * list and any error string - use the heap.
+ */
+#define CMD_PARSE_ARENA_BLOCK 16384
+
+struct cmd_parse_arena_block {
+	size_t					 size;
+	size_t					 used;
+	TAILQ_ENTRY(cmd_parse_arena_block)	 entry;
+};
+static TAILQ_HEAD(, cmd_parse_arena_block) cmd_parse_arena =
+    TAILQ_HEAD_INITIALIZER(cmd_parse_arena);
+static u_int cmd_parse_arena_depth;
+
+static void
+cmd_parse_arena_push(void)
+{
+	cmd_parse_arena_depth++;
+}
+
 static void
-cmd_parse_free_command(struct cmd_parse_command *cmd)
+cmd_parse_arena_pop(void)
 {
-	free(cmd->name);
-	cmd_free_argv(cmd->argc, cmd->argv);
-	free(cmd);
+	struct cmd_parse_arena_block	*b, *b1;
+
+	if (--cmd_parse_arena_depth != 0)
+		return;
+	TAILQ_FOREACH_SAFE(b, &cmd_parse_arena, entry, b1) {
+		TAILQ_REMOVE(&cmd_parse_arena, b, entry);
+		free(b);
+	}
+}
+
+static void *
+cmd_parse_arena_alloc(size_t size)
+{
+	struct cmd_parse_arena_block	*b;
+	size_t				 want;
+	void				*p;
+
+	size = (size + 7) & ~(size_t)7;
+	b = TAILQ_FIRST(&cmd_parse_arena);
+	if (b == NULL || b->size - b->used < size) {
+		want = CMD_PARSE_ARENA_BLOCK;
+		if (want < size)
+			want = size;
+		b = xmalloc(sizeof *b + want);
+		b->size = want;
+		b->used = 0;
+		TAILQ_INSERT_HEAD(&cmd_parse_arena, b, entry);
+	}
+	p = (char *)(b + 1) + b->used;
+	b->used += size;
+	memset(p, 0, size);
+	return (p);
+}
+
+static char *
+cmd_parse_arena_strdup(const char *s)
+{
+	size_t	 size = strlen(s) + 1;
+	char	*copy;
+
+	copy = cmd_parse_arena_alloc(size);
+	memcpy(copy, s, size);
+	return (copy);
+}
+
+/*
+ * Argument vectors are sized in powers of two (with a floor of eight) so
+ * strings already in the arena can be appended or prepended without copying
+ * the whole vector each time.
+ */
+static char **
+cmd_parse_arena_argv_grow(int argc, char **argv)
+{
+	char	**new;
+
+	if (argc == 0)
+		return (cmd_parse_arena_alloc(8 * sizeof *new));
+	if (argc < 8 || (argc & (argc - 1)) != 0)
+		return (argv);
+	new = cmd_parse_arena_alloc(2 * argc * sizeof *new);
+	memcpy(new, argv, argc * sizeof *argv);
+	return (new);
+}
+
+static void
+cmd_parse_arena_argv_append(int *argc, char ***argv, char *s)
+{
+	*argv = cmd_parse_arena_argv_grow(*argc, *argv);
+	(*argv)[(*argc)++] = s;
+}
+
+static void
+cmd_parse_arena_argv_prepend(int *argc, char ***argv, char *s)
+{
+	*argv = cmd_parse_arena_argv_grow(*argc, *argv);
+	memmove(*argv + 1, *argv, *argc * sizeof **argv);
+	(*argv)[0] = s;
+	(*argc)++;
 }
 
 static struct cmd_parse_commands *
@@ -567,38 +617,178 @@ cmd_parse_new_commands(void)
 {
 	struct cmd_parse_commands	*cmds;
 
-	cmds = xmalloc(sizeof *cmds);
+	cmds = cmd_parse_arena_alloc(sizeof *cmds);
 	TAILQ_INIT (cmds);
 	return (cmds);
 }
 
+/*
+ * Compiled-config cache. After a successful parse the token lists are
+ * serialized to a binary file next to the original and reused on the next
+ * load if the original is unchanged. Files using %if or variable assignment
+ * have side effects at parse time, and $VAR, ${VAR} and ~ expand from the
+ * parse-time environment, so files using any of them are never cached.
+ * The config-cache server option turns the cache off entirely.
+ */
+#define CMD_PARSE_CACHE_MAGIC	0x746d6378
+#define CMD_PARSE_CACHE_VERSION	2
+
+struct cmd_parse_cache_header {
+	u_int		magic;
+	u_int		version;
+	long long	mtime;
+	long long	size;
+	u_int		ncmds;
+};
+
+static char *
+cmd_parse_cache_name(const char *path)
+{
+	char	*name;
+
+	xasprintf(&name, "%s.compiled", path);
+	return (name);
+}
+
+static int
+cmd_parse_cache_get(FILE *f, char **s)
+{
+	u_int	n;
+
+	if (fread(&n, sizeof n, 1, f) != 1)
+		return (-1);
+	if (n == UINT_MAX) {
+		*s = NULL;
+		return (0);
+	}
+	if (n > 1048576)
+		return (-1);
+	*s = cmd_parse_arena_alloc(n + 1);
+	if (n != 0 && fread(*s, n, 1, f) != 1)
+		return (-1);
+	(*s)[n] = '\0';
+	return (0);
+}
+
 static void
-cmd_parse_free_commands(struct cmd_parse_commands *cmds)
+cmd_parse_cache_put(FILE *f, const char *s)
 {
-	struct cmd_parse_command	*cmd, *cmd1;
+	u_int	n;
 
-	TAILQ_FOREACH_SAFE(cmd, cmds, entry, cmd1) {
-		TAILQ_REMOVE(cmds, cmd, entry);
-		cmd_parse_free_command(cmd);
+	if (s == NULL) {
+		n = UINT_MAX;
+		fwrite(&n, sizeof n, 1, f);
+		return;
 	}
-	free(cmds);
+	n = strlen(s);
+	fwrite(&n, sizeof n, 1, f);
+	fwrite(s, 1, n, f);
+}
+
+static struct cmd_parse_commands *
+cmd_parse_cache_read(const char *path, struct stat *sb)
+{
+	struct cmd_parse_cache_header	 h;
+	struct cmd_parse_commands	*cmds;
+	struct cmd_parse_command	*cmd;
+	char				*name, *arg;
+	FILE				*f;
+	u_int				 i;
+	int				 argc, j;
+
+	name = cmd_parse_cache_name(path);
+	f = fopen(name, "rb");
+	free(name);
+	if (f == NULL)
+		return (NULL);
+
+	if (fread(&h, sizeof h, 1, f) != 1 ||
+	    h.magic != CMD_PARSE_CACHE_MAGIC ||
+	    h.version != CMD_PARSE_CACHE_VERSION ||
+	    h.mtime != (long long)sb->st_mtime ||
+	    h.size != (long long)sb->st_size) {
+		fclose(f);
+		return (NULL);
+	}
+
+	cmds = cmd_parse_new_commands();
+	for (i = 0; i < h.ncmds; i++) {
+		cmd = cmd_parse_arena_alloc(sizeof *cmd);
+		TAILQ_INSERT_TAIL(cmds, cmd, entry);
+		if (fread(&cmd->line, sizeof cmd->line, 1, f) != 1 ||
+		    fread(&argc, sizeof argc, 1, f) != 1 ||
+		    argc < 0 ||
+		    argc > 65536 ||
+		    cmd_parse_cache_get(f, &cmd->name) != 0)
+			goto bad;
+		for (j = 0; j < argc; j++) {
+			if (cmd_parse_cache_get(f, &arg) != 0 || arg == NULL)
+				goto bad;
+			cmd_parse_arena_argv_append(&cmd->argc, &cmd->argv,
+			    arg);
+		}
+	}
+	fclose(f);
+	log_debug("%s: %u commands for %s", __func__, h.ncmds, path);
+	return (cmds);
+
+bad:
+	fclose(f);
+	return (NULL);
+}
+
+static void
+cmd_parse_cache_write(const char *path, struct stat *sb,
+    struct cmd_parse_commands *cmds)
+{
+	struct cmd_parse_cache_header	 h;
+	struct cmd_parse_command	*cmd;
+	char				*name, *tmp;
+	FILE				*f;
+	int				 i, error;
+
+	memset(&h, 0, sizeof h);
+	h.magic = CMD_PARSE_CACHE_MAGIC;
+	h.version = CMD_PARSE_CACHE_VERSION;
+	h.mtime = (long long)sb->st_mtime;
+	h.size = (long long)sb->st_size;
+	TAILQ_FOREACH(cmd, cmds, entry)
+		h.ncmds++;
+
+	name = cmd_parse_cache_name(path);
+	xasprintf(&tmp, "%s.new", name);
+	if ((f = fopen(tmp, "wb")) == NULL) {
+		free(tmp);
+		free(name);
+		return;
+	}
+	fwrite(&h, sizeof h, 1, f);
+	TAILQ_FOREACH(cmd, cmds, entry) {
+		fwrite(&cmd->line, sizeof cmd->line, 1, f);
+		fwrite(&cmd->argc, sizeof cmd->argc, 1, f);
+		cmd_parse_cache_put(f, cmd->name);
+		for (i = 0; i < cmd->argc; i++)
+			cmd_parse_cache_put(f, cmd->argv[i]);
+	}
+	error = ferror(f);
+	if (fclose(f) != 0)
+		error = 1;
+	if (error || rename(tmp, name) != 0)
+		unlink(tmp);
+	free(tmp);
+	free(name);
 }
 
 static struct cmd_parse_commands *
 cmd_parse_run_parser(char **cause)
 {
 	struct cmd_parse_state	*ps = &parse_state;
-	struct cmd_parse_scope	*scope, *scope1;
 	int			 retval;
 
 	ps->commands = NULL;
 	TAILQ_INIT(&ps->stack);
 
 	retval = yyparse();
-	TAILQ_FOREACH_SAFE(scope, &ps->stack, entry, scope1) {
-		TAILQ_REMOVE(&ps->stack, scope, entry);
-		free(scope);
-	}
 	if (retval != 0) {
 		*cause = ps->error;
 		return (NULL);
@@ -648,9 +838,8 @@ cmd_parse_build_commands(struct cmd_parse_commands *cmds,
 
 	/* Check for an empty list. */
 	if (TAILQ_EMPTY(cmds)) {
-		cmd_parse_free_commands(cmds);
 		pr.status = CMD_PARSE_EMPTY;
-		return (&pr);
+		goto out;
 	}
 
 	/*
@@ -679,11 +868,12 @@ cmd_parse_build_commands(struct cmd_parse_commands *cmds,
 		cmd2 = TAILQ_LAST(cmds2, cmd_parse_commands);
 		if (cmd2 == NULL) {
 			TAILQ_REMOVE(cmds, cmd, entry);
-			cmd_parse_free_command(cmd);
 			continue;
 		}
-		for (i = 0; i < cmd->argc; i++)
-			cmd_append_argv(&cmd2->argc, &cmd2->argv, cmd->argv[i]);
+		for (i = 0; i < cmd->argc; i++) {
+			cmd_parse_arena_argv_append(&cmd2->argc, &cmd2->argv,
+			    cmd->argv[i]);
+		}
 
 		after = cmd;
 		TAILQ_FOREACH_SAFE(cmd2, cmds2, entry, next2) {
@@ -692,10 +882,8 @@ cmd_parse_build_commands(struct cmd_parse_commands *cmds,
 			TAILQ_INSERT_AFTER(cmds, after, cmd2, entry);
 			after = cmd2;
 		}
-		cmd_parse_free_commands(cmds2);
 
 		TAILQ_REMOVE(cmds, cmd, entry);
-		cmd_parse_free_command(cmd);
 	}
 
 	/*
@@ -720,7 +908,7 @@ cmd_parse_build_commands(struct cmd_parse_commands *cmds,
 		}
 		line = cmd->line;
 
-		cmd_prepend_argv(&cmd->argc, &cmd->argv, cmd->name);
+		cmd_parse_arena_argv_prepend(&cmd->argc, &cmd->argv, cmd->name);
 		add = cmd_parse(cmd->argc, cmd->argv, pi->file, line, &cause);
 		if (add == NULL) {
 			cmd_list_free(result);
@@ -746,7 +934,7 @@ cmd_parse_build_commands(struct cmd_parse_commands *cmds,
 	pr.cmdlist = result;
 
 out:
-	cmd_parse_free_commands(cmds);
+	cmd_parse_arena_pop();
 
 	return (&pr);
 }
@@ -765,8 +953,10 @@ cmd_parse_from_file(FILE *f, struct cmd_parse_input *pi)
 	}
 	memset(&pr, 0, sizeof pr);
 
+	cmd_parse_arena_push();
 	cmds = cmd_parse_do_file(f, pi, &cause);
 	if (cmds == NULL) {
+		cmd_parse_arena_pop();
 		pr.status = CMD_PARSE_ERROR;
 		pr.error = cause;
 		return (&pr);
@@ -774,6 +964,46 @@ cmd_parse_from_file(FILE *f, struct cmd_parse_input *pi)
 	return (cmd_parse_build_commands(cmds, pi));
 }
 
+struct cmd_parse_result *
+cmd_parse_from_file_cached(FILE *f, const char *path,
+    struct cmd_parse_input *pi)
+{
+	static struct cmd_parse_result	 pr;
+	struct cmd_parse_state		*ps = &parse_state;
+	struct cmd_parse_input		 input;
+	struct cmd_parse_commands	*cmds;
+	struct stat			 sb;
+	char				*cause;
+
+	if (pi == NULL) {
+		memset(&input, 0, sizeof input);
+		pi = &input;
+	}
+	memset(&pr, 0, sizeof pr);
+
+	if (fstat(fileno(f), &sb) != 0)
+		return (cmd_parse_from_file(f, pi));
+	if (global_options != NULL &&
+	    !options_get_number(global_options, "config-cache"))
+		return (cmd_parse_from_file(f, pi));
+
+	cmd_parse_arena_push();
+	cmds = cmd_parse_cache_read(path, &sb);
+	if (cmds != NULL)
+		return (cmd_parse_build_commands(cmds, pi));
+
+	cmds = cmd_parse_do_file(f, pi, &cause);
+	if (cmds == NULL) {
+		cmd_parse_arena_pop();
+		pr.status = CMD_PARSE_ERROR;
+		pr.error = cause;
+		return (&pr);
+	}
+	if (!ps->uncacheable)
+		cmd_parse_cache_write(path, &sb, cmds);
+	return (cmd_parse_build_commands(cmds, pi));
+}
+
 struct cmd_parse_result *
 cmd_parse_from_string(const char *s, struct cmd_parse_input *pi)
 {
@@ -866,8 +1096,10 @@ cmd_parse_from_buffer(const void *buf, size_t len, struct cmd_parse_input *pi)
 		return (&pr);
 	}
 
+	cmd_parse_arena_push();
 	cmds = cmd_parse_do_buffer(buf, len, pi, &cause);
 	if (cmds == NULL) {
+		cmd_parse_arena_pop();
 		pr.status = CMD_PARSE_ERROR;
 		pr.error = cause;
 		return (&pr);
@@ -883,7 +1115,7 @@ cmd_parse_from_arguments(int argc, char **argv, struct cmd_parse_input *pi)
 	struct cmd_parse_command	 *cmd;
 	char				**copy, **new_argv;
 	size_t				  size;
-	int				  i, last, new_argc;
+	int				  i, j, last, new_argc;
 
 	/*
 	 * The commands are already split up into arguments, so just separate
@@ -896,6 +1128,7 @@ cmd_parse_from_arguments(int argc, char **argv, struct cmd_parse_input *pi)
 	}
 	cmd_log_argv(argc, argv, "%s", __func__);
 
+	cmd_parse_arena_push();
 	cmds = cmd_parse_new_commands();
 	copy = cmd_copy_argv(argc, argv);
 
@@ -919,12 +1152,15 @@ cmd_parse_from_arguments(int argc, char **argv, struct cmd_parse_input *pi)
 			cmd_log_argv(new_argc, new_argv, "%s: at %u", __func__,
 			    i);
 
-			cmd = xcalloc(1, sizeof *cmd);
-			cmd->name = xstrdup(new_argv[0]);
+			cmd = cmd_parse_arena_alloc(sizeof *cmd);
+			cmd->name = cmd_parse_arena_strdup(new_argv[0]);
 			cmd->line = pi->line;
 
-			cmd->argc = new_argc - 1;
-			cmd->argv = cmd_copy_argv(new_argc - 1, new_argv + 1);
+			for (j = 1; j < new_argc; j++) {
+				cmd_parse_arena_argv_append(&cmd->argc,
+				    &cmd->argv,
+				    cmd_parse_arena_strdup(new_argv[j]));
+			}
 
 			TAILQ_INSERT_TAIL(cmds, cmd, entry);
 		}
@@ -939,12 +1175,15 @@ cmd_parse_from_arguments(int argc, char **argv, struct cmd_parse_input *pi)
 			cmd_log_argv(new_argc, new_argv, "%s: at %u", __func__,
 			    last);
 
-			cmd = xcalloc(1, sizeof *cmd);
-			cmd->name = xstrdup(new_argv[0]);
+			cmd = cmd_parse_arena_alloc(sizeof *cmd);
+			cmd->name = cmd_parse_arena_strdup(new_argv[0]);
 			cmd->line = pi->line;
 
-			cmd->argc = new_argc - 1;
-			cmd->argv = cmd_copy_argv(new_argc - 1, new_argv + 1);
+			for (j = 1; j < new_argc; j++) {
+				cmd_parse_arena_argv_append(&cmd->argc,
+				    &cmd->argv,
+				    cmd_parse_arena_strdup(new_argv[j]));
+			}
 
 			TAILQ_INSERT_TAIL(cmds, cmd, entry);
 		}
@@ -1062,7 +1301,7 @@ yylex_getc(void)
 static char *
 yylex_get_word(int ch)
 {
-	char	*buf;
+	char	*buf, *token;
 	size_t	 len;
 
 	len = 0;
@@ -1075,7 +1314,10 @@ yylex_get_word(int ch)
 
 	buf[len] = '\0';
 	log_debug("%s: %s", __func__, buf);
-	return (buf);
+
+	token = cmd_parse_arena_strdup(buf);
+	free(buf);
+	return (token);
 }
 
 static int
@@ -1163,27 +1405,17 @@ yylex(void)
 			if (*cp == '\0')
 				return (TOKEN);
 			ps->condition = 1;
-			if (strcmp(yylval.token, "%hidden") == 0) {
-				free(yylval.token);
+			ps->uncacheable = 1;
+			if (strcmp(yylval.token, "%hidden") == 0)
 				return (HIDDEN);
-			}
-			if (strcmp(yylval.token, "%if") == 0) {
-				free(yylval.token);
+			if (strcmp(yylval.token, "%if") == 0)
 				return (IF);
-			}
-			if (strcmp(yylval.token, "%else") == 0) {
-				free(yylval.token);
+			if (strcmp(yylval.token, "%else") == 0)
 				return (ELSE);
-			}
-			if (strcmp(yylval.token, "%elif") == 0) {
-				free(yylval.token);
+			if (strcmp(yylval.token, "%elif") == 0)
 				return (ELIF);
-			}
-			if (strcmp(yylval.token, "%endif") == 0) {
-				free(yylval.token);
+			if (strcmp(yylval.token, "%endif") == 0)
 				return (ENDIF);
-			}
-			free(yylval.token);
 			return (ERROR);
 		}
 
@@ -1211,7 +1443,7 @@ yylex(void)
 static char *
 yylex_format(void)
 {
-	char	*buf;
+	char	*buf, *token;
 	size_t	 len;
 	int	 ch, brackets = 1;
 
@@ -1241,7 +1473,10 @@ yylex_format(void)
 
 	buf[len] = '\0';
 	log_debug("%s: %s", __func__, buf);
-	return (buf);
+
+	token = cmd_parse_arena_strdup(buf);
+	free(buf);
+	return (token);
 
 error:
 	free(buf);
@@ -1350,6 +1585,7 @@ unicode:
 static int
 yylex_token_variable(char **buf, size_t *len)
 {
+	struct cmd_parse_state	*ps = &parse_state;
 	struct environ_entry	*envent;
 	int			 ch, brackets = 0;
 	char			 name[1024];
@@ -1390,6 +1626,12 @@ yylex_token_variable(char **buf, size_t *len)
 	}
 	name[namelen] = '\0';
 
+	/*
+	 * The expansion depends on the environment at parse time, which the
+	 * compiled cache cannot see, so the file must be reparsed next load.
+	 */
+	ps->uncacheable = 1;
+
 	envent = environ_find(global_environ, name);
 	if (envent != NULL) {
 		value = envent->value;
@@ -1402,6 +1644,7 @@ yylex_token_variable(char **buf, size_t *len)
 static int
 yylex_token_tilde(char **buf, size_t *len)
 {
+	struct cmd_parse_state	*ps = &parse_state;
 	struct environ_entry	*envent;
 	int			 ch;
 	char			 name[1024];
@@ -1423,6 +1666,9 @@ yylex_token_tilde(char **buf, size_t *len)
 	}
 	name[namelen] = '\0';
 
+	/* Like $VAR, the result depends on the parse-time environment. */
+	ps->uncacheable = 1;
+
 	if (*name == '\0') {
 		envent = environ_find(global_environ, "HOME");
 		if (envent != NULL && *envent->value != '\0')
@@ -1557,7 +1803,7 @@ yylex_token_brace(char **buf, size_t *len)
 static char *
 yylex_token(int ch)
 {
-	char			*buf;
+	char			*buf, *token;
 	size_t			 len;
 	enum { START,
 	       NONE,
@@ -1647,7 +1893,10 @@ yylex_token(int ch)
 
 	buf[len] = '\0';
 	log_debug("%s: %s", __func__, buf);
-	return (buf);
+
+	token = cmd_parse_arena_strdup(buf);
+	free(buf);
+	return (token);
 
 error:
 	free(buf);
@@ -79,7 +79,7 @@ cmd_paste_buffer_exec(struct cmd *self, struct cmdq_item *item)
 		seplen = strlen(sepstr);
 
 		if (bracket && (wp->screen->mode & MODE_BRACKETPASTE))
-			bufferevent_write(wp->event, "\033[200~", 6);
+			window_pane_paste(wp, "\033[200~", 6);
 
 		bufdata = paste_buffer_data(pb, &bufsize);
 		bufend = bufdata + bufsize;
@@ -89,16 +89,16 @@ cmd_paste_buffer_exec(struct cmd *self, struct cmdq_item *item)
 			if (line == NULL)
 				break;
 
-			bufferevent_write(wp->event, bufdata, line - bufdata);
-			bufferevent_write(wp->event, sepstr, seplen);
+			window_pane_paste(wp, bufdata, line - bufdata);
+			window_pane_paste(wp, sepstr, seplen);
 
 			bufdata = line + 1;
 		}
 		if (bufdata != bufend)
-			bufferevent_write(wp->event, bufdata, bufend - bufdata);
+			window_pane_paste(wp, bufdata, bufend - bufdata);
 
 		if (bracket && (wp->screen->mode & MODE_BRACKETPASTE))
-			bufferevent_write(wp->event, "\033[201~", 6);
+			window_pane_paste(wp, "\033[201~", 6);
 	}
 
 	if (pb != NULL && args_has(args, 'd'))
@@ -17,6 +17,7 @@
  */
 
 #include <sys/types.h>
+#include <sys/time.h>
 
 #include <ctype.h>
 #include <stdlib.h>
@@ -49,6 +50,7 @@ struct cmdq_item {
 
 	u_int			 number;
 	time_t			 time;
+	struct timeval		 queued;
 
 	int			 flags;
 
@@ -66,6 +68,135 @@ struct cmdq_item {
 };
 TAILQ_HEAD(cmdq_item_list, cmdq_item);
 
+/*
+ * Accumulated timing per command, so that when automation reports slowness
+ * it can be attributed to a command. A ring of the most recent times per
+ * command gives the percentiles without keeping every sample; anything over
+ * the command-time-limit option goes to the message log as it happens.
+ */
+#define CMDQ_STAT_SAMPLES 128
+
+static const char	*cmdq_name(struct client *);
+
+struct cmdq_stat {
+	const struct cmd_entry	*entry;
+
+	unsigned long long	 count;
+	uint64_t		 total;
+	uint64_t		 worst;
+
+	uint64_t		 sample[CMDQ_STAT_SAMPLES];
+	u_int			 next;
+
+	RB_ENTRY(cmdq_stat)	 tree_entry;
+};
+RB_HEAD(cmdq_stats, cmdq_stat);
+
+static int	cmdq_stat_cmp(struct cmdq_stat *, struct cmdq_stat *);
+RB_GENERATE_STATIC(cmdq_stats, cmdq_stat, tree_entry, cmdq_stat_cmp);
+static struct cmdq_stats cmdq_stats = RB_INITIALIZER(&cmdq_stats);
+
+static int
+cmdq_stat_cmp(struct cmdq_stat *cs1, struct cmdq_stat *cs2)
+{
+	return (strcmp(cs1->entry->name, cs2->entry->name));
+}
+
+/* Microseconds from tv to now, or zero if tv was never set. */
+static uint64_t
+cmdq_usec_since(const struct timeval *tv, const struct timeval *now)
+{
+	struct timeval	since;
+
+	if (!timerisset(tv))
+		return (0);
+	timersub(now, tv, &since);
+	return ((uint64_t)since.tv_sec * 1000000 + since.tv_usec);
+}
+
+/* Record how long a fired command took and report it if too slow. */
+static void
+cmdq_stat_record(struct cmdq_item *item, uint64_t wait, uint64_t resolve,
+    uint64_t run)
+{
+	struct cmdq_stat	 find, *cs;
+	const struct cmd_entry	*entry = cmd_get_entry(item->cmd);
+	long long		 limit;
+	char			*tmp;
+
+	find.entry = entry;
+	cs = RB_FIND(cmdq_stats, &cmdq_stats, &find);
+	if (cs == NULL) {
+		cs = xcalloc(1, sizeof *cs);
+		cs->entry = entry;
+		RB_INSERT(cmdq_stats, &cmdq_stats, cs);
+	}
+	cs->count++;
+	cs->total += resolve + run;
+	if (resolve + run > cs->worst)
+		cs->worst = resolve + run;
+	cs->sample[cs->next] = resolve + run;
+	cs->next = (cs->next + 1) % CMDQ_STAT_SAMPLES;
+
+	limit = options_get_number(global_options, "command-time-limit");
+	if (limit == 0 || resolve + run < (uint64_t)limit * 1000)
+		return;
+	tmp = cmd_print(item->cmd);
+	server_add_message("%s slow command: %s (queued %llu.%03llums, "
+	    "finding targets %llu.%03llums, running %llu.%03llums)",
+	    cmdq_name(item->client), tmp,
+	    (unsigned long long)wait / 1000, (unsigned long long)wait % 1000,
+	    (unsigned long long)resolve / 1000,
+	    (unsigned long long)resolve % 1000,
+	    (unsigned long long)run / 1000, (unsigned long long)run % 1000);
+	free(tmp);
+}
+
+static int
+cmdq_stat_sample_cmp(const void *p1, const void *p2)
+{
+	const uint64_t	*u1 = p1, *u2 = p2;
+
+	if (*u1 < *u2)
+		return (-1);
+	if (*u1 > *u2)
+		return (1);
+	return (0);
+}
+
+/* Print command timing statistics (for show-perf). */
+void
+cmdq_print_stats(struct cmdq_item *item)
+{
+	struct cmdq_stat	*cs;
+	uint64_t		 copy[CMDQ_STAT_SAMPLES], mean, p50, p99;
+	u_int			 n, i;
+
+	RB_FOREACH(cs, cmdq_stats, &cmdq_stats) {
+		if (cs->count < CMDQ_STAT_SAMPLES)
+			n = cs->count;
+		else
+			n = CMDQ_STAT_SAMPLES;
+		for (i = 0; i < n; i++)
+			copy[i] = cs->sample[i];
+		qsort(copy, n, sizeof *copy, cmdq_stat_sample_cmp);
+		mean = cs->total / cs->count;
+		p50 = copy[n / 2];
+		p99 = copy[(n * 99) / 100];
+		cmdq_print(item, "%s: %llu runs, mean %llu.%03llums, "
+		    "p50 %llu.%03llums, p99 %llu.%03llums, "
+		    "worst %llu.%03llums", cs->entry->name, cs->count,
+		    (unsigned long long)mean / 1000,
+		    (unsigned long long)mean % 1000,
+		    (unsigned long long)p50 / 1000,
+		    (unsigned long long)p50 % 1000,
+		    (unsigned long long)p99 / 1000,
+		    (unsigned long long)p99 % 1000,
+		    (unsigned long long)cs->worst / 1000,
+		    (unsigned long long)cs->worst % 1000);
+	}
+}
+
 /*
  * Command queue state. This is the context for commands on the command queue.
  * It holds information about how the commands were fired (the key and flags),
@@ -89,6 +220,44 @@ struct cmdq_list {
 	struct cmdq_item_list	 list;
 };
 
+/*
+ * Pool of free items. Command lists create and destroy an item per command,
+ * so recently freed items are kept for reuse rather than going back to the
+ * allocator each time.
+ */
+static struct cmdq_item_list cmdq_item_pool = TAILQ_HEAD_INITIALIZER(
+    cmdq_item_pool);
+static u_int		 cmdq_item_pool_count;
+#define CMDQ_ITEM_POOL_LIMIT 64
+
+/* Allocate an item, from the pool if possible. */
+static struct cmdq_item *
+cmdq_item_alloc(void)
+{
+	struct cmdq_item	*item;
+
+	item = TAILQ_FIRST(&cmdq_item_pool);
+	if (item != NULL) {
+		TAILQ_REMOVE(&cmdq_item_pool, item, entry);
+		cmdq_item_pool_count--;
+		memset(item, 0, sizeof *item);
+	} else
+		item = xcalloc(1, sizeof *item);
+	return (item);
+}
+
+/* Return an item to the pool or free it. */
+static void
+cmdq_item_free(struct cmdq_item *item)
+{
+	if (cmdq_item_pool_count == CMDQ_ITEM_POOL_LIMIT) {
+		free(item);
+		return;
+	}
+	TAILQ_INSERT_HEAD(&cmdq_item_pool, item, entry);
+	cmdq_item_pool_count++;
+}
+
 /* Get command queue name. */
 static const char *
 cmdq_name(struct client *c)
@@ -307,6 +476,25 @@ cmdq_append(struct client *c, struct cmdq_item *item)
 	return (TAILQ_LAST(&queue->list, cmdq_item_list));
 }
 
+/* Append an item to a detached queue (one not owned by a client). */
+struct cmdq_item *
+cmdq_append_queue(struct cmdq_list *queue, struct cmdq_item *item)
+{
+	struct cmdq_item	*next;
+
+	do {
+		next = item->next;
+		item->next = NULL;
+
+		item->queue = queue;
+		TAILQ_INSERT_TAIL(&queue->list, item, entry);
+		log_debug("%s: %s", __func__, item->name);
+
+		item = next;
+	} while (item != NULL);
+	return (TAILQ_LAST(&queue->list, cmdq_item_list));
+}
+
 /* Insert an item. */
 struct cmdq_item *
 cmdq_insert_after(struct cmdq_item *after, struct cmdq_item *item)
@@ -355,6 +543,7 @@ cmdq_insert_hook(struct session *s, struct cmdq_item *item,
 	struct options_entry		*o;
 	struct options_array_item	*a;
 	struct cmd_list			*cmdlist;
+	struct cmdq_list		*queue;
 
 	if (item->state->flags & CMDQ_STATE_NOHOOKS)
 		return;
@@ -412,12 +601,16 @@ cmdq_insert_hook(struct session *s, struct cmdq_item *item,
 		flag = args_next(&entryp);
 	}
 
+	queue = notify_async_queue(name);
+
 	a = options_array_first(o);
 	while (a != NULL) {
 		cmdlist = options_array_item_value(a)->cmdlist;
 		if (cmdlist != NULL) {
 			new_item = cmdq_get_command(cmdlist, new_state);
-			if (item != NULL)
+			if (queue != NULL)
+				cmdq_append_queue(queue, new_item);
+			else if (item != NULL)
 				item = cmdq_insert_after(item, new_item);
 			else
 				item = cmdq_append(NULL, new_item);
@@ -449,7 +642,7 @@ cmdq_remove(struct cmdq_item *item)
 	TAILQ_REMOVE(&item->queue->list, item, entry);
 
 	free(item->name);
-	free(item);
+	cmdq_item_free(item);
 }
 
 /* Remove all subsequent items that match this item's group. */
@@ -487,9 +680,10 @@ cmdq_get_command(struct cmd_list *cmdlist, struct cmdq_state *state)
 	while (cmd != NULL) {
 		entry = cmd_get_entry(cmd);
 
-		item = xcalloc(1, sizeof *item);
+		item = cmdq_item_alloc();
 		xasprintf(&item->name, "[%s/%p]", entry->name, item);
 		item->type = CMDQ_COMMAND;
+		gettimeofday(&item->queued, NULL);
 
 		item->group = cmd_get_group(cmd);
 		item->state = cmdq_link_state(state);
@@ -568,9 +762,12 @@ cmdq_fire_command(struct cmdq_item *item)
 	struct client		*tc, *saved = item->client;
 	enum cmd_retval		 retval;
 	struct cmd_find_state	*fsp, fs;
+	struct timeval		 t0, t1, t2;
 	int			 flags, quiet = 0;
 	char			*tmp;
 
+	gettimeofday(&t0, NULL);
+
 	if (cfg_finished)
 		cmdq_add_message(item);
 	if (log_get_level() > 1) {
@@ -578,6 +775,7 @@ cmdq_fire_command(struct cmdq_item *item)
 		log_debug("%s %s: (%u) %s", __func__, name, item->group, tmp);
 		free(tmp);
 	}
+	log_record("command %s: %s", name, entry->name);
 
 	flags = !!(state->flags & CMDQ_STATE_CONTROL);
 	cmdq_guard(item, "begin", flags);
@@ -610,7 +808,11 @@ cmdq_fire_command(struct cmdq_item *item)
 	if (retval == CMD_RETURN_ERROR)
 		goto out;
 
+	gettimeofday(&t1, NULL);
 	retval = entry->exec(cmd, item);
+	gettimeofday(&t2, NULL);
+	cmdq_stat_record(item, cmdq_usec_since(&item->queued, &t0),
+	    cmdq_usec_since(&t0, &t1), cmdq_usec_since(&t1, &t2));
 	if (retval == CMD_RETURN_ERROR)
 		goto out;
 
@@ -641,7 +843,7 @@ cmdq_get_callback1(const char *name, cmdq_cb cb, void *data)
 {
 	struct cmdq_item	*item;
 
-	item = xcalloc(1, sizeof *item);
+	item = cmdq_item_alloc();
 	xasprintf(&item->name, "[%s/%p]", name, item);
 	item->type = CMDQ_CALLBACK;
 
@@ -680,12 +882,10 @@ cmdq_fire_callback(struct cmdq_item *item)
 	return (item->cb(item, item->data));
 }
 
-/* Process next item on command queue. */
-u_int
-cmdq_next(struct client *c)
+/* Process queue items until empty or waiting. */
+static u_int
+cmdq_next_list(struct cmdq_list *queue, const char *name)
 {
-	struct cmdq_list	*queue = cmdq_get(c);
-	const char		*name = cmdq_name(c);
 	struct cmdq_item	*item;
 	enum cmd_retval		 retval;
 	u_int			 items = 0;
@@ -762,6 +962,20 @@ waiting:
 	return (items);
 }
 
+/* Process next item on command queue. */
+u_int
+cmdq_next(struct client *c)
+{
+	return (cmdq_next_list(cmdq_get(c), cmdq_name(c)));
+}
+
+/* Process next item on a detached queue. */
+u_int
+cmdq_next_queue(struct cmdq_list *queue, const char *name)
+{
+	return (cmdq_next_list(queue, name));
+}
+
 /* Get running item if any. */
 struct cmdq_item *
 cmdq_running(struct client *c)
@@ -780,7 +994,7 @@ cmdq_guard(struct cmdq_item *item, const char *guard, int flags)
 	u_int		 number = item->number;
 
 	if (c != NULL && (c->flags & CLIENT_CONTROL))
-		file_print(c, "%%%s %ld %u %d\n", guard, t, number, flags);
+		control_write(c, "%%%s %ld %u %d", guard, t, number, flags);
 }
 
 /* Show message from command. */
@@ -807,7 +1021,10 @@ cmdq_print(struct cmdq_item *item, const char *fmt, ...)
 			msg = utf8_sanitize(tmp);
 			free(tmp);
 		}
-		file_print(c, "%s\n", msg);
+		if (c->flags & CLIENT_CONTROL)
+			control_write(c, "%s", msg);
+		else
+			file_print(c, "%s\n", msg);
 	} else {
 		wp = server_client_get_pane(c);
 		wme = TAILQ_FIRST(&wp->modes);
@@ -849,7 +1066,7 @@ cmdq_error(struct cmdq_item *item, const char *fmt, ...)
 			free(tmp);
 		}
 		if (c->flags & CLIENT_CONTROL)
-			file_print(c, "%s\n", msg);
+			control_write(c, "%s", msg);
 		else
 			file_error(c, "%s\n", msg);
 		c->retval = 1;
@@ -0,0 +1,225 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2021 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tmux.h"
+
+/*
+ * Record raw pane output to a file with per-chunk timestamps, and replay a
+ * recording back through the input parser at full speed or with the original
+ * timing. Recordings give reproducible workloads for profiling.
+ */
+
+static enum cmd_retval	cmd_record_pane_exec(struct cmd *,
+			    struct cmdq_item *);
+static enum cmd_retval	cmd_replay_pane_exec(struct cmd *,
+			    struct cmdq_item *);
+
+static void		cmd_replay_pane_timer(int, short, void *);
+static void		cmd_replay_pane_done(void *);
+
+/* Frames larger than this can only come from a corrupt file. */
+#define CMD_REPLAY_PANE_MAXFRAME (16 * 1024 * 1024)
+
+const struct cmd_entry cmd_record_pane_entry = {
+	.name = "record-pane",
+	.alias = NULL,
+
+	.args = { "t:", 0, 1 },
+	.usage = CMD_TARGET_PANE_USAGE " [path]",
+
+	.target = { 't', CMD_FIND_PANE, 0 },
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_record_pane_exec
+};
+
+const struct cmd_entry cmd_replay_pane_entry = {
+	.name = "replay-pane",
+	.alias = NULL,
+
+	.args = { "Ft:", 1, 1 },
+	.usage = "[-F] " CMD_TARGET_PANE_USAGE " path",
+
+	.target = { 't', CMD_FIND_PANE, 0 },
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_replay_pane_exec
+};
+
+struct cmd_replay_pane_data {
+	u_int				 wp_id;
+	FILE				*f;
+	struct event			 timer;
+	struct cmdq_item		*item;
+
+	int				 have_next;
+	struct window_pane_record_frame	 next;
+};
+
+static enum cmd_retval
+cmd_record_pane_exec(struct cmd *self, struct cmdq_item *item)
+{
+	struct args		*args = cmd_get_args(self);
+	struct cmd_find_state	*target = cmdq_get_target(item);
+	struct window_pane	*wp = target->wp;
+	char			*path;
+
+	if (args->argc == 0) {
+		window_pane_record_stop(wp);
+		return (CMD_RETURN_NORMAL);
+	}
+
+	path = format_single_from_target(item, args->argv[0]);
+	if (window_pane_record_start(wp, path) != 0) {
+		cmdq_error(item, "%s: %s", path, strerror(errno));
+		free(path);
+		return (CMD_RETURN_ERROR);
+	}
+	free(path);
+	return (CMD_RETURN_NORMAL);
+}
+
+/* Read the next frame header, if there is one. */
+static int
+cmd_replay_pane_header(FILE *f, struct window_pane_record_frame *frame)
+{
+	if (fread(frame, sizeof *frame, 1, f) != 1)
+		return (-1);
+	if (frame->size == 0 || frame->size > CMD_REPLAY_PANE_MAXFRAME)
+		return (-1);
+	return (0);
+}
+
+/* Read one frame of data and feed it through the input parser. */
+static int
+cmd_replay_pane_frame(FILE *f, struct window_pane_record_frame *frame,
+    struct window_pane *wp)
+{
+	u_char	*buf;
+
+	buf = xmalloc(frame->size);
+	if (fread(buf, frame->size, 1, f) != 1) {
+		free(buf);
+		return (-1);
+	}
+	input_parse_buffer(wp, buf, frame->size);
+	free(buf);
+	return (0);
+}
+
+static void
+cmd_replay_pane_done(void *data)
+{
+	struct cmd_replay_pane_data	*cdata = data;
+
+	if (cdata->item != NULL)
+		cmdq_continue(cdata->item);
+	fclose(cdata->f);
+	free(cdata);
+}
+
+static void
+cmd_replay_pane_timer(__unused int fd, __unused short events, void *data)
+{
+	struct cmd_replay_pane_data	*cdata = data;
+	struct window_pane		*wp;
+	struct window_pane_record_frame	 frame;
+	struct timeval			 now, next, tv;
+
+	wp = window_pane_find_by_id(cdata->wp_id);
+	if (wp == NULL) {
+		cmd_replay_pane_done(cdata);
+		return;
+	}
+
+	frame = cdata->next;
+	if (cmd_replay_pane_frame(cdata->f, &frame, wp) != 0) {
+		cmd_replay_pane_done(cdata);
+		return;
+	}
+
+	if (cmd_replay_pane_header(cdata->f, &cdata->next) != 0) {
+		cmd_replay_pane_done(cdata);
+		return;
+	}
+
+	/* Wait for the gap between the two frames in the recording. */
+	now.tv_sec = frame.tv_sec;
+	now.tv_usec = frame.tv_usec;
+	next.tv_sec = cdata->next.tv_sec;
+	next.tv_usec = cdata->next.tv_usec;
+	if (timercmp(&next, &now, <))
+		timerclear(&tv);
+	else
+		timersub(&next, &now, &tv);
+	evtimer_add(&cdata->timer, &tv);
+}
+
+static enum cmd_retval
+cmd_replay_pane_exec(struct cmd *self, struct cmdq_item *item)
+{
+	struct args			*args = cmd_get_args(self);
+	struct cmd_find_state		*target = cmdq_get_target(item);
+	struct window_pane		*wp = target->wp;
+	struct cmd_replay_pane_data	*cdata;
+	struct window_pane_record_frame	 frame;
+	struct timeval			 tv;
+	char				*path;
+	FILE				*f;
+
+	path = format_single_from_target(item, args->argv[0]);
+	f = fopen(path, "r");
+	if (f == NULL) {
+		cmdq_error(item, "%s: %s", path, strerror(errno));
+		free(path);
+		return (CMD_RETURN_ERROR);
+	}
+	free(path);
+
+	/* At full speed, just push the whole file through now. */
+	if (args_has(args, 'F')) {
+		while (cmd_replay_pane_header(f, &frame) == 0) {
+			if (cmd_replay_pane_frame(f, &frame, wp) != 0)
+				break;
+		}
+		fclose(f);
+		return (CMD_RETURN_NORMAL);
+	}
+
+	cdata = xcalloc(1, sizeof *cdata);
+	cdata->wp_id = wp->id;
+	cdata->f = f;
+	cdata->item = item;
+
+	if (cmd_replay_pane_header(f, &cdata->next) != 0) {
+		fclose(f);
+		free(cdata);
+		return (CMD_RETURN_NORMAL);
+	}
+
+	evtimer_set(&cdata->timer, cmd_replay_pane_timer, cdata);
+	timerclear(&tv);
+	evtimer_add(&cdata->timer, &tv);
+	return (CMD_RETURN_WAIT);
+}
@@ -29,28 +29,92 @@
 
 static enum cmd_retval	cmd_refresh_client_exec(struct cmd *,
 			    struct cmdq_item *);
+static int		cmd_refresh_client_subscribe(struct cmdq_item *,
+			    struct client *, const char *);
 
 const struct cmd_entry cmd_refresh_client_entry = {
 	.name = "refresh-client",
 	.alias = "refresh",
 
-	.args = { "cC:Df:F:lLRSt:U", 0, 1 },
-	.usage = "[-cDlLRSU] [-C XxY] [-f flags] " CMD_TARGET_CLIENT_USAGE
-		" [adjustment]",
+	.args = { "A:B:cC:Df:F:lLRs:St:TU", 0, 1 },
+	.usage = "[-cDlLRSTU] [-A pane:offset] [-B bytes] [-C XxY] [-f flags] "
+		"[-s subscription] "
+		CMD_TARGET_CLIENT_USAGE " [adjustment]",
 
 	.flags = CMD_AFTERHOOK|CMD_CLIENT_TFLAG,
 	.exec = cmd_refresh_client_exec
 };
 
+/*
+ * Parse a subscription argument: a name alone removes the subscription, or
+ * name:what:format adds one, where what is empty for the client's session or
+ * a pane, window or session id.
+ */
+static int
+cmd_refresh_client_subscribe(struct cmdq_item *item, struct client *tc,
+    const char *value)
+{
+	enum control_sub_type	 type;
+	char			*copy, *split;
+	const char		*what, *format, *errstr;
+	u_int			 id = 0;
+
+	copy = xstrdup(value);
+	if ((split = strchr(copy, ':')) == NULL) {
+		control_remove_sub(tc, copy);
+		free(copy);
+		return (0);
+	}
+	*split++ = '\0';
+
+	what = split;
+	if ((split = strchr(split, ':')) == NULL) {
+		cmdq_error(item, "invalid subscription: %s", value);
+		free(copy);
+		return (-1);
+	}
+	*split++ = '\0';
+	format = split;
+
+	if (*what == '\0')
+		type = CONTROL_SUB_NONE;
+	else {
+		if (*what == '%' || *what == '@' || *what == '$')
+			errstr = NULL;
+		else
+			errstr = "invalid";
+		if (errstr == NULL)
+			id = strtonum(what + 1, 0, UINT_MAX, &errstr);
+		if (errstr != NULL) {
+			cmdq_error(item, "invalid subscription target: %s",
+			    what);
+			free(copy);
+			return (-1);
+		}
+		if (*what == '%')
+			type = CONTROL_SUB_PANE;
+		else if (*what == '@')
+			type = CONTROL_SUB_WINDOW;
+		else
+			type = CONTROL_SUB_SESSION;
+	}
+
+	control_add_sub(tc, copy, type, id, format);
+	free(copy);
+	return (0);
+}
+
 static enum cmd_retval
 cmd_refresh_client_exec(struct cmd *self, struct cmdq_item *item)
 {
-	struct args	*args = cmd_get_args(self);
-	struct client	*tc = cmdq_get_target_client(item);
-	struct tty	*tty = &tc->tty;
-	struct window	*w;
-	const char	*size, *errstr;
-	u_int		 x, y, adjust;
+	struct args		*args = cmd_get_args(self);
+	struct client		*tc = cmdq_get_target_client(item);
+	struct tty		*tty = &tc->tty;
+	struct window		*w;
+	struct window_pane	*wp;
+	const char		*size, *errstr, *colon;
+	u_int			 x, y, adjust, pane;
+	long long		 bytes;
 
 	if (args_has(args, 'c') ||
 	    args_has(args, 'L') ||
@@ -102,11 +166,70 @@ cmd_refresh_client_exec(struct cmd *self, struct cmdq_item *item)
 		return (CMD_RETURN_NORMAL);
 	}
 
+	if (args_has(args, 'B')) {
+		if (~tc->flags & CLIENT_CONTROL) {
+			cmdq_error(item, "not a control client");
+			return (CMD_RETURN_ERROR);
+		}
+		bytes = strtonum(args_get(args, 'B'), 0, LLONG_MAX, &errstr);
+		if (errstr != NULL) {
+			cmdq_error(item, "bytes %s", errstr);
+			return (CMD_RETURN_ERROR);
+		}
+		control_set_flow_window(tc, bytes);
+		return (CMD_RETURN_NORMAL);
+	}
+
+	if (args_has(args, 's')) {
+		if (~tc->flags & CLIENT_CONTROL) {
+			cmdq_error(item, "not a control client");
+			return (CMD_RETURN_ERROR);
+		}
+		if (cmd_refresh_client_subscribe(item, tc,
+		    args_get(args, 's')) != 0)
+			return (CMD_RETURN_ERROR);
+		return (CMD_RETURN_NORMAL);
+	}
+
+	if (args_has(args, 'A')) {
+		if (~tc->flags & CLIENT_CONTROL) {
+			cmdq_error(item, "not a control client");
+			return (CMD_RETURN_ERROR);
+		}
+		size = args_get(args, 'A');
+		if (*size == '%')
+			size++;
+		colon = strchr(size, ':');
+		if (colon == NULL ||
+		    sscanf(size, "%u:%lld", &pane, &bytes) != 2 ||
+		    bytes < 0) {
+			cmdq_error(item, "bad acknowledgement argument");
+			return (CMD_RETURN_ERROR);
+		}
+		wp = window_pane_find_by_id(pane);
+		if (wp == NULL) {
+			cmdq_error(item, "unknown pane");
+			return (CMD_RETURN_ERROR);
+		}
+		control_acknowledge(tc, wp, bytes);
+		return (CMD_RETURN_NORMAL);
+	}
+
 	if (args_has(args, 'l')) {
 		tty_putcode_ptr2(&tc->tty, TTYC_MS, "", "?");
 		return (CMD_RETURN_NORMAL);
 	}
 
+	if (args_has(args, 'T')) {
+		if (tc->flags & CLIENT_CONTROL) {
+			cmdq_error(item, "not a terminal client");
+			return (CMD_RETURN_ERROR);
+		}
+		tc->redraw_trace = 1;
+		server_redraw_client(tc);
+		return (CMD_RETURN_NORMAL);
+	}
+
 	if (args_has(args, 'F')) /* -F is an alias for -f */
 		server_client_set_flags(tc, args_get(args, 'F'));
 	if (args_has(args, 'f'))
@@ -131,7 +254,7 @@ cmd_refresh_client_exec(struct cmd *self, struct cmdq_item *item)
 			}
 			tty_set_size(&tc->tty, x, y, 0, 0);
 			tc->flags |= CLIENT_SIZECHANGED;
-			recalculate_sizes();
+			recalculate_sizes_for_client(tc);
 		}
 		return (CMD_RETURN_NORMAL);
 	}
@@ -195,6 +195,7 @@ cmd_select_pane_exec(struct cmd *self, struct cmdq_item *item)
 	if (args_has(args, 'T')) {
 		title = format_single_from_target(item, args_get(args, 'T'));
 		if (screen_set_title(&wp->base, title)) {
+			wp->generation++;
 			server_redraw_window_borders(wp->window);
 			server_status_window(wp->window);
 		}
@@ -86,6 +86,54 @@ cmd_send_keys_inject_key(struct cmdq_item *item, struct cmdq_item *after,
 	return (after);
 }
 
+/*
+ * Fast path for literal strings. When the pane is not in a mode, each key of
+ * valid UTF-8 text ends up written to the pane as its own bytes, so the
+ * whole string can be written in one go rather than one key at a time.
+ * Returns -1 if the string needs the key-by-key path.
+ */
+static int
+cmd_send_keys_inject_literal(struct cmdq_item *item, const char *s)
+{
+	struct cmd_find_state	*target = cmdq_get_target(item);
+	struct window_pane	*wp = target->wp, *wp2;
+	struct utf8_data	 ud;
+	enum utf8_state		 more;
+	const char		*cp;
+	size_t			 len;
+
+	if (TAILQ_FIRST(&wp->modes) != NULL)
+		return (-1);
+
+	for (cp = s; *cp != '\0'; cp++) {
+		if ((u_char)*cp <= 0x7f)
+			continue;
+		more = utf8_open(&ud, (u_char)*cp);
+		while (more == UTF8_MORE && *++cp != '\0')
+			more = utf8_append(&ud, (u_char)*cp);
+		if (more != UTF8_DONE)
+			return (-1);
+	}
+
+	if (wp->fd == -1 || wp->flags & PANE_INPUTOFF)
+		return (0);
+	len = strlen(s);
+	log_debug("%s: %zu literal bytes to %%%u", __func__, len, wp->id);
+	bufferevent_write(wp->event, s, len);
+
+	if (options_get_number(wp->window->options, "synchronize-panes")) {
+		TAILQ_FOREACH(wp2, &wp->window->panes, entry) {
+			if (wp2 != wp &&
+			    TAILQ_EMPTY(&wp2->modes) &&
+			    wp2->fd != -1 &&
+			    (~wp2->flags & PANE_INPUTOFF) &&
+			    window_pane_visible(wp2))
+				bufferevent_write(wp2->event, s, len);
+		}
+	}
+	return (0);
+}
+
 static struct cmdq_item *
 cmd_send_keys_inject_string(struct cmdq_item *item, struct cmdq_item *after,
     struct args *args, int i)
@@ -116,6 +164,8 @@ cmd_send_keys_inject_string(struct cmdq_item *item, struct cmdq_item *after,
 		literal = 1;
 	}
 	if (literal) {
+		if (cmd_send_keys_inject_literal(item, s) == 0)
+			return (after);
 		ud = utf8_fromcstr(s);
 		for (uc = ud; uc->size != 0; uc++) {
 			if (utf8_combine(uc, &wc) != UTF8_DONE)
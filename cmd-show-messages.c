@@ -33,6 +33,9 @@
 
 static enum cmd_retval	cmd_show_messages_exec(struct cmd *,
 			    struct cmdq_item *);
+static enum cmd_retval	cmd_show_perf_exec(struct cmd *, struct cmdq_item *);
+static enum cmd_retval	cmd_show_flight_recorder_exec(struct cmd *,
+			    struct cmdq_item *);
 
 const struct cmd_entry cmd_show_messages_entry = {
 	.name = "show-messages",
@@ -45,6 +48,28 @@ const struct cmd_entry cmd_show_messages_entry = {
 	.exec = cmd_show_messages_exec
 };
 
+const struct cmd_entry cmd_show_perf_entry = {
+	.name = "show-perf",
+	.alias = NULL,
+
+	.args = { "", 0, 0 },
+	.usage = "",
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_show_perf_exec
+};
+
+const struct cmd_entry cmd_show_flight_recorder_entry = {
+	.name = "show-flight-recorder",
+	.alias = NULL,
+
+	.args = { "", 0, 0 },
+	.usage = "",
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_show_flight_recorder_exec
+};
+
 static int
 cmd_show_messages_terminals(struct cmd *self, struct cmdq_item *item, int blank)
 {
@@ -105,3 +130,58 @@ cmd_show_messages_exec(struct cmd *self, struct cmdq_item *item)
 
 	return (CMD_RETURN_NORMAL);
 }
+
+static enum cmd_retval
+cmd_show_perf_exec(__unused struct cmd *self, struct cmdq_item *item)
+{
+	struct window_pane	*wp;
+	struct session		*s;
+	struct winlink		*wl;
+	size_t			 size;
+
+	cmdq_print(item, "loops: %llu", server_perf.loops);
+	cmdq_print(item, "input: %llu calls, %llu bytes",
+	    server_perf.input_calls, server_perf.input_bytes);
+	cmdq_print(item, "tty: %llu writes, %llu bytes",
+	    server_perf.tty_writes, server_perf.tty_bytes);
+	cmdq_print(item, "formats expanded: %llu", server_perf.format_expands);
+	cmdq_print(item, "grids reflowed: %llu", server_perf.grid_reflows);
+	cmdq_print(item, "allocations: %llu", server_perf.xallocs);
+	cmdq_print(item, "compaction: %llu passes, %llu bytes reclaimed",
+	    server_perf.compact_runs, server_perf.compact_bytes);
+	cmdq_print(item, "memory: %llu bytes in grids, %llu budget passes, "
+	    "%llu bytes reclaimed", server_perf.memory_bytes,
+	    server_perf.memory_runs, server_perf.memory_reclaimed);
+
+	RB_FOREACH(s, sessions, &sessions) {
+		size = 0;
+		RB_FOREACH(wl, winlinks, &s->windows) {
+			TAILQ_FOREACH(wp, &wl->window->panes, entry)
+				size += window_pane_memory(wp);
+		}
+		cmdq_print(item, "%s: %zu bytes", s->name, size);
+	}
+
+	RB_FOREACH(wp, window_pane_tree, &all_window_panes) {
+		cmdq_print(item, "%%%u: %zu bytes/second (watermark %zu)",
+		    wp->id, wp->read_rate, wp->read_size);
+	}
+
+	cmdq_print_stats(item);
+
+	return (CMD_RETURN_NORMAL);
+}
+
+static void
+cmd_show_flight_recorder_print(void *arg, const char *line)
+{
+	cmdq_print(arg, "%s", line);
+}
+
+static enum cmd_retval
+cmd_show_flight_recorder_exec(__unused struct cmd *self,
+    struct cmdq_item *item)
+{
+	log_record_dump(cmd_show_flight_recorder_print, item);
+	return (CMD_RETURN_NORMAL);
+}
@@ -0,0 +1,95 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2021 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+
+#include <stdlib.h>
+
+#include "tmux.h"
+
+/*
+ * Write a snapshot of the server state, or restore one. The default path is
+ * next to the server socket and a snapshot there is restored automatically
+ * when the server starts.
+ */
+
+static enum cmd_retval	cmd_snapshot_server_exec(struct cmd *,
+			    struct cmdq_item *);
+static enum cmd_retval	cmd_restore_server_exec(struct cmd *,
+			    struct cmdq_item *);
+
+const struct cmd_entry cmd_snapshot_server_entry = {
+	.name = "snapshot-server",
+	.alias = NULL,
+
+	.args = { "", 0, 1 },
+	.usage = "[path]",
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_snapshot_server_exec
+};
+
+const struct cmd_entry cmd_restore_server_entry = {
+	.name = "restore-server",
+	.alias = NULL,
+
+	.args = { "", 0, 1 },
+	.usage = "[path]",
+
+	.flags = CMD_AFTERHOOK,
+	.exec = cmd_restore_server_exec
+};
+
+static enum cmd_retval
+cmd_snapshot_server_exec(struct cmd *self, struct cmdq_item *item)
+{
+	struct args	*args = cmd_get_args(self);
+	const char	*path = NULL;
+	char		*cause;
+
+	if (args->argc == 1)
+		path = args->argv[0];
+	if (snapshot_write(path, &cause) != 0) {
+		cmdq_error(item, "%s", cause);
+		free(cause);
+		return (CMD_RETURN_ERROR);
+	}
+	return (CMD_RETURN_NORMAL);
+}
+
+static enum cmd_retval
+cmd_restore_server_exec(struct cmd *self, struct cmdq_item *item)
+{
+	struct args	*args = cmd_get_args(self);
+	const char	*path = NULL;
+	char		*cause;
+
+	if (args->argc == 1)
+		path = args->argv[0];
+	if (snapshot_restore(item, path, &cause) != 0) {
+		cmdq_error(item, "%s", cause);
+		free(cause);
+		return (CMD_RETURN_ERROR);
+	}
+	if (journal_replay(item, NULL, &cause) != 0) {
+		cmdq_error(item, "%s", cause);
+		free(cause);
+		return (CMD_RETURN_ERROR);
+	}
+	return (CMD_RETURN_NORMAL);
+}
@@ -49,9 +49,19 @@ struct cmd_source_file_data {
 	struct cmdq_item	 *after;
 	enum cmd_retval		  retval;
 
-	u_int			  current;
+	u_int			  done;
 	char			**files;
 	u_int			  nfiles;
+
+	void			**contents;
+	size_t			 *csizes;
+	int			 *errors;
+};
+
+/* Maps a single file's read completion back to its slot in the batch. */
+struct cmd_source_file_ref {
+	struct cmd_source_file_data	*cdata;
+	u_int				 i;
 };
 
 static enum cmd_retval
@@ -66,6 +76,8 @@ cmd_source_file_complete(struct client *c, struct cmd_source_file_data *cdata)
 {
 	struct cmdq_item	*new_item;
 
+	u_int			 i;
+
 	if (cfg_finished) {
 		if (cdata->retval == CMD_RETURN_ERROR && c->session == NULL)
 			c->retval = 1;
@@ -73,41 +85,68 @@ cmd_source_file_complete(struct client *c, struct cmd_source_file_data *cdata)
 		cmdq_insert_after(cdata->after, new_item);
 	}
 
+	for (i = 0; i < cdata->nfiles; i++) {
+		free(cdata->files[i]);
+		free(cdata->contents[i]);
+	}
 	free(cdata->files);
+	free(cdata->contents);
+	free(cdata->csizes);
+	free(cdata->errors);
 	free(cdata);
 }
 
+/* All reads have completed; parse and queue the files in their given order. */
+static void
+cmd_source_file_parse(struct client *c, struct cmd_source_file_data *cdata)
+{
+	struct cmdq_item	*item = cdata->item;
+	struct cmdq_item	*new_item;
+	u_int			 i;
+
+	for (i = 0; i < cdata->nfiles; i++) {
+		if (cdata->errors[i] != 0) {
+			cmdq_error(item, "%s: %s", cdata->files[i],
+			    strerror(cdata->errors[i]));
+			continue;
+		}
+		if (cdata->csizes[i] == 0)
+			continue;
+		if (load_cfg_from_buffer(cdata->contents[i], cdata->csizes[i],
+		    cdata->files[i], c, cdata->after, cdata->flags,
+		    &new_item) < 0)
+			cdata->retval = CMD_RETURN_ERROR;
+		else if (new_item != NULL)
+			cdata->after = new_item;
+	}
+
+	cmd_source_file_complete(c, cdata);
+	cmdq_continue(item);
+}
+
 static void
-cmd_source_file_done(struct client *c, const char *path, int error,
+cmd_source_file_done(struct client *c, __unused const char *path, int error,
     int closed, struct evbuffer *buffer, void *data)
 {
-	struct cmd_source_file_data	*cdata = data;
-	struct cmdq_item		*item = cdata->item;
+	struct cmd_source_file_ref	*ref = data;
+	struct cmd_source_file_data	*cdata = ref->cdata;
 	void				*bdata = EVBUFFER_DATA(buffer);
 	size_t				 bsize = EVBUFFER_LENGTH(buffer);
-	u_int				 n;
-	struct cmdq_item		*new_item;
+	u_int				 i = ref->i;
 
 	if (!closed)
 		return;
+	free(ref);
 
-	if (error != 0)
-		cmdq_error(item, "%s: %s", path, strerror(error));
-	else if (bsize != 0) {
-		if (load_cfg_from_buffer(bdata, bsize, path, c, cdata->after,
-		    cdata->flags, &new_item) < 0)
-			cdata->retval = CMD_RETURN_ERROR;
-		else if (new_item != NULL)
-			cdata->after = new_item;
+	cdata->errors[i] = error;
+	if (error == 0 && bsize != 0) {
+		cdata->contents[i] = xmalloc(bsize);
+		memcpy(cdata->contents[i], bdata, bsize);
+		cdata->csizes[i] = bsize;
 	}
 
-	n = ++cdata->current;
-	if (n < cdata->nfiles)
-		file_read(c, cdata->files[n], cmd_source_file_done, cdata);
-	else {
-		cmd_source_file_complete(c, cdata);
-		cmdq_continue(item);
-	}
+	if (++cdata->done == cdata->nfiles)
+		cmd_source_file_parse(c, cdata);
 }
 
 static void
@@ -124,6 +163,7 @@ cmd_source_file_exec(struct cmd *self, struct cmdq_item *item)
 {
 	struct args			*args = cmd_get_args(self);
 	struct cmd_source_file_data	*cdata;
+	struct cmd_source_file_ref	*ref;
 	struct client			*c = cmdq_get_client(item);
 	enum cmd_retval			 retval = CMD_RETURN_NORMAL;
 	char				*pattern, *cwd;
@@ -181,8 +221,23 @@ cmd_source_file_exec(struct cmd *self, struct cmdq_item *item)
 	cdata->after = item;
 	cdata->retval = retval;
 
+	/*
+	 * Start every read at once rather than chaining them off each other's
+	 * completion, so reads from the client are in flight together; the
+	 * files are parsed in order once the last one arrives.
+	 */
 	if (cdata->nfiles != 0) {
-		file_read(c, cdata->files[0], cmd_source_file_done, cdata);
+		cdata->contents = xcalloc(cdata->nfiles,
+		    sizeof *cdata->contents);
+		cdata->csizes = xcalloc(cdata->nfiles, sizeof *cdata->csizes);
+		cdata->errors = xcalloc(cdata->nfiles, sizeof *cdata->errors);
+		for (j = 0; j < cdata->nfiles; j++) {
+			ref = xcalloc(1, sizeof *ref);
+			ref->cdata = cdata;
+			ref->i = j;
+			file_read(c, cdata->files[j], cmd_source_file_done,
+			    ref);
+		}
 		retval = CMD_RETURN_WAIT;
 	} else
 		cmd_source_file_complete(c, cdata);
@@ -34,8 +34,8 @@ const struct cmd_entry cmd_wait_for_entry = {
 	.name = "wait-for",
 	.alias = "wait",
 
-	.args = { "LSU", 1, 1 },
-	.usage = "[-L|-S|-U] channel",
+	.args = { "LSUn:", 1, 1 },
+	.usage = "[-L|-S|-U] [-n number] channel",
 
 	.flags = 0,
 	.exec = cmd_wait_for_exec
@@ -43,6 +43,7 @@ const struct cmd_entry cmd_wait_for_entry = {
 
 struct wait_item {
 	struct cmdq_item	*item;
+	u_int			 need;
 	TAILQ_ENTRY(wait_item)	 entry;
 };
 
@@ -50,6 +51,7 @@ struct wait_channel {
 	const char	       *name;
 	int			locked;
 	int			woken;
+	u_int			 count;
 
 	TAILQ_HEAD(, wait_item)	waiters;
 	TAILQ_HEAD(, wait_item)	lockers;
@@ -69,9 +71,9 @@ wait_channel_cmp(struct wait_channel *wc1, struct wait_channel *wc2)
 }
 
 static enum cmd_retval	cmd_wait_for_signal(struct cmdq_item *, const char *,
-			    struct wait_channel *);
+			    struct wait_channel *, u_int);
 static enum cmd_retval	cmd_wait_for_wait(struct cmdq_item *, const char *,
-			    struct wait_channel *);
+			    struct wait_channel *, u_int);
 static enum cmd_retval	cmd_wait_for_lock(struct cmdq_item *, const char *,
 			    struct wait_channel *);
 static enum cmd_retval	cmd_wait_for_unlock(struct cmdq_item *, const char *,
@@ -90,6 +92,7 @@ cmd_wait_for_add(const char *name)
 
 	wc->locked = 0;
 	wc->woken = 0;
+	wc->count = 0;
 
 	TAILQ_INIT(&wc->waiters);
 	TAILQ_INIT(&wc->lockers);
@@ -108,6 +111,8 @@ cmd_wait_for_remove(struct wait_channel *wc)
 		return;
 	if (!TAILQ_EMPTY(&wc->waiters) || !wc->woken)
 		return;
+	if (wc->count != 0)
+		return;
 
 	log_debug("remove wait channel %s", wc->name);
 
@@ -123,28 +128,74 @@ cmd_wait_for_exec(struct cmd *self, struct cmdq_item *item)
 	struct args     	*args = cmd_get_args(self);
 	const char		*name = args->argv[0];
 	struct wait_channel	*wc, wc0;
+	u_int			 number = 0;
+	char			*cause;
+
+	if (args_has(args, 'n')) {
+		if (args_has(args, 'L') || args_has(args, 'U')) {
+			cmdq_error(item, "-n not compatible with -L or -U");
+			return (CMD_RETURN_ERROR);
+		}
+		number = args_strtonum(args, 'n', 1, INT_MAX, &cause);
+		if (cause != NULL) {
+			cmdq_error(item, "number %s", cause);
+			free(cause);
+			return (CMD_RETURN_ERROR);
+		}
+	}
 
 	wc0.name = name;
 	wc = RB_FIND(wait_channels, &wait_channels, &wc0);
 
 	if (args_has(args, 'S'))
-		return (cmd_wait_for_signal(item, name, wc));
+		return (cmd_wait_for_signal(item, name, wc, number));
 	if (args_has(args, 'L'))
 		return (cmd_wait_for_lock(item, name, wc));
 	if (args_has(args, 'U'))
 		return (cmd_wait_for_unlock(item, name, wc));
-	return (cmd_wait_for_wait(item, name, wc));
+	return (cmd_wait_for_wait(item, name, wc, number));
+}
+
+/* Wake waiters whose requested count is covered, in one pass. */
+static void
+cmd_wait_for_service(struct wait_channel *wc)
+{
+	struct wait_item	*wi, *wi1;
+
+	TAILQ_FOREACH_SAFE(wi, &wc->waiters, entry, wi1) {
+		if (wi->need == 0 || wi->need > wc->count)
+			continue;
+		wc->count -= wi->need;
+
+		cmdq_continue(wi->item);
+
+		TAILQ_REMOVE(&wc->waiters, wi, entry);
+		free(wi);
+	}
 }
 
 static enum cmd_retval
 cmd_wait_for_signal(__unused struct cmdq_item *item, const char *name,
-    struct wait_channel *wc)
+    struct wait_channel *wc, u_int number)
 {
 	struct wait_item	*wi, *wi1;
 
 	if (wc == NULL)
 		wc = cmd_wait_for_add(name);
 
+	/*
+	 * With -n the channel is a counting semaphore: add the tokens and
+	 * wake any waiters they cover, keeping the rest for later.
+	 */
+	if (number != 0) {
+		wc->count += number;
+		log_debug("signal wait channel %s, count now %u", wc->name,
+		    wc->count);
+		cmd_wait_for_service(wc);
+		cmd_wait_for_remove(wc);
+		return (CMD_RETURN_NORMAL);
+	}
+
 	if (TAILQ_EMPTY(&wc->waiters) && !wc->woken) {
 		log_debug("signal wait channel %s, no waiters", wc->name);
 		wc->woken = 1;
@@ -165,7 +216,7 @@ cmd_wait_for_signal(__unused struct cmdq_item *item, const char *name,
 
 static enum cmd_retval
 cmd_wait_for_wait(struct cmdq_item *item, const char *name,
-    struct wait_channel *wc)
+    struct wait_channel *wc, u_int number)
 {
 	struct client		*c = cmdq_get_client(item);
 	struct wait_item	*wi;
@@ -183,10 +234,18 @@ cmd_wait_for_wait(struct cmdq_item *item, const char *name,
 		cmd_wait_for_remove(wc);
 		return (CMD_RETURN_NORMAL);
 	}
+	if (number != 0 && wc->count >= number) {
+		wc->count -= number;
+		log_debug("wait channel %s had %u tokens (%p)", wc->name,
+		    wc->count + number, c);
+		cmd_wait_for_remove(wc);
+		return (CMD_RETURN_NORMAL);
+	}
 	log_debug("wait channel %s not woken (%p)", wc->name, c);
 
 	wi = xcalloc(1, sizeof *wi);
 	wi->item = item;
+	wi->need = number;
 	TAILQ_INSERT_TAIL(&wc->waiters, wi, entry);
 
 	return (CMD_RETURN_WAIT);
@@ -253,6 +312,7 @@ cmd_wait_for_flush(void)
 			free(wi);
 		}
 		wc->woken = 1;
+		wc->count = 0;
 		TAILQ_FOREACH_SAFE(wi, &wc->lockers, entry, wi1) {
 			cmdq_continue(wi->item);
 			TAILQ_REMOVE(&wc->lockers, wi, entry);
@@ -47,6 +47,7 @@ extern const struct cmd_entry cmd_display_message_entry;
 extern const struct cmd_entry cmd_display_popup_entry;
 extern const struct cmd_entry cmd_display_panes_entry;
 extern const struct cmd_entry cmd_down_pane_entry;
+extern const struct cmd_entry cmd_find_output_entry;
 extern const struct cmd_entry cmd_find_window_entry;
 extern const struct cmd_entry cmd_has_session_entry;
 extern const struct cmd_entry cmd_if_shell_entry;
@@ -55,6 +56,7 @@ extern const struct cmd_entry cmd_kill_pane_entry;
 extern const struct cmd_entry cmd_kill_server_entry;
 extern const struct cmd_entry cmd_kill_session_entry;
 extern const struct cmd_entry cmd_kill_window_entry;
+extern const struct cmd_entry cmd_latency_test_entry;
 extern const struct cmd_entry cmd_last_pane_entry;
 extern const struct cmd_entry cmd_last_window_entry;
 extern const struct cmd_entry cmd_link_window_entry;
@@ -69,6 +71,7 @@ extern const struct cmd_entry cmd_load_buffer_entry;
 extern const struct cmd_entry cmd_lock_client_entry;
 extern const struct cmd_entry cmd_lock_server_entry;
 extern const struct cmd_entry cmd_lock_session_entry;
+extern const struct cmd_entry cmd_migrate_session_entry;
 extern const struct cmd_entry cmd_move_pane_entry;
 extern const struct cmd_entry cmd_move_window_entry;
 extern const struct cmd_entry cmd_new_session_entry;
@@ -79,13 +82,16 @@ extern const struct cmd_entry cmd_paste_buffer_entry;
 extern const struct cmd_entry cmd_pipe_pane_entry;
 extern const struct cmd_entry cmd_previous_layout_entry;
 extern const struct cmd_entry cmd_previous_window_entry;
+extern const struct cmd_entry cmd_record_pane_entry;
 extern const struct cmd_entry cmd_refresh_client_entry;
 extern const struct cmd_entry cmd_rename_session_entry;
 extern const struct cmd_entry cmd_rename_window_entry;
+extern const struct cmd_entry cmd_replay_pane_entry;
 extern const struct cmd_entry cmd_resize_pane_entry;
 extern const struct cmd_entry cmd_resize_window_entry;
 extern const struct cmd_entry cmd_respawn_pane_entry;
 extern const struct cmd_entry cmd_respawn_window_entry;
+extern const struct cmd_entry cmd_restore_server_entry;
 extern const struct cmd_entry cmd_rotate_window_entry;
 extern const struct cmd_entry cmd_run_shell_entry;
 extern const struct cmd_entry cmd_save_buffer_entry;
@@ -101,10 +107,13 @@ extern const struct cmd_entry cmd_set_option_entry;
 extern const struct cmd_entry cmd_set_window_option_entry;
 extern const struct cmd_entry cmd_show_buffer_entry;
 extern const struct cmd_entry cmd_show_environment_entry;
+extern const struct cmd_entry cmd_show_flight_recorder_entry;
 extern const struct cmd_entry cmd_show_hooks_entry;
 extern const struct cmd_entry cmd_show_messages_entry;
 extern const struct cmd_entry cmd_show_options_entry;
+extern const struct cmd_entry cmd_show_perf_entry;
 extern const struct cmd_entry cmd_show_window_options_entry;
+extern const struct cmd_entry cmd_snapshot_server_entry;
 extern const struct cmd_entry cmd_source_file_entry;
 extern const struct cmd_entry cmd_split_window_entry;
 extern const struct cmd_entry cmd_start_server_entry;
@@ -137,6 +146,7 @@ const struct cmd_entry *cmd_table[] = {
 	&cmd_display_message_entry,
 	&cmd_display_popup_entry,
 	&cmd_display_panes_entry,
+	&cmd_find_output_entry,
 	&cmd_find_window_entry,
 	&cmd_has_session_entry,
 	&cmd_if_shell_entry,
@@ -145,6 +155,7 @@ const struct cmd_entry *cmd_table[] = {
 	&cmd_kill_server_entry,
 	&cmd_kill_session_entry,
 	&cmd_kill_window_entry,
+	&cmd_latency_test_entry,
 	&cmd_last_pane_entry,
 	&cmd_last_window_entry,
 	&cmd_link_window_entry,
@@ -159,6 +170,7 @@ const struct cmd_entry *cmd_table[] = {
 	&cmd_lock_client_entry,
 	&cmd_lock_server_entry,
 	&cmd_lock_session_entry,
+	&cmd_migrate_session_entry,
 	&cmd_move_pane_entry,
 	&cmd_move_window_entry,
 	&cmd_new_session_entry,
@@ -169,13 +181,16 @@ const struct cmd_entry *cmd_table[] = {
 	&cmd_pipe_pane_entry,
 	&cmd_previous_layout_entry,
 	&cmd_previous_window_entry,
+	&cmd_record_pane_entry,
 	&cmd_refresh_client_entry,
 	&cmd_rename_session_entry,
 	&cmd_rename_window_entry,
+	&cmd_replay_pane_entry,
 	&cmd_resize_pane_entry,
 	&cmd_resize_window_entry,
 	&cmd_respawn_pane_entry,
 	&cmd_respawn_window_entry,
+	&cmd_restore_server_entry,
 	&cmd_rotate_window_entry,
 	&cmd_run_shell_entry,
 	&cmd_save_buffer_entry,
@@ -191,10 +206,13 @@ const struct cmd_entry *cmd_table[] = {
 	&cmd_set_window_option_entry,
 	&cmd_show_buffer_entry,
 	&cmd_show_environment_entry,
+	&cmd_show_flight_recorder_entry,
 	&cmd_show_hooks_entry,
 	&cmd_show_messages_entry,
 	&cmd_show_options_entry,
+	&cmd_show_perf_entry,
 	&cmd_show_window_options_entry,
+	&cmd_snapshot_server_entry,
 	&cmd_source_file_entry,
 	&cmd_split_window_entry,
 	&cmd_start_server_entry,
@@ -441,47 +459,117 @@ cmd_get_alias(const char *name)
 	return (NULL);
 }
 
-/* Look up a command entry by name. */
+/* Sorted indices over cmd_table for name and alias lookup. */
+static const struct cmd_entry	**cmd_name_index;
+static const struct cmd_entry	**cmd_alias_index;
+static u_int			  cmd_name_count;
+static u_int			  cmd_alias_count;
+
+/* Compare two index slots by entry name. */
+static int
+cmd_name_index_cmp(const void *a, const void *b)
+{
+	const struct cmd_entry	*ea = *(const struct cmd_entry **)a;
+	const struct cmd_entry	*eb = *(const struct cmd_entry **)b;
+
+	return (strcmp(ea->name, eb->name));
+}
+
+/* Compare two index slots by entry alias. */
+static int
+cmd_alias_index_cmp(const void *a, const void *b)
+{
+	const struct cmd_entry	*ea = *(const struct cmd_entry **)a;
+	const struct cmd_entry	*eb = *(const struct cmd_entry **)b;
+
+	return (strcmp(ea->alias, eb->alias));
+}
+
+/* Build the sorted lookup indices on first use. */
+static void
+cmd_build_index(void)
+{
+	const struct cmd_entry	**loop;
+
+	if (cmd_name_index != NULL)
+		return;
+
+	for (loop = cmd_table; *loop != NULL; loop++)
+		cmd_name_count++;
+	cmd_name_index = xreallocarray(NULL, cmd_name_count,
+	    sizeof *cmd_name_index);
+	cmd_alias_index = xreallocarray(NULL, cmd_name_count,
+	    sizeof *cmd_alias_index);
+
+	cmd_name_count = 0;
+	for (loop = cmd_table; *loop != NULL; loop++) {
+		cmd_name_index[cmd_name_count++] = *loop;
+		if ((*loop)->alias != NULL)
+			cmd_alias_index[cmd_alias_count++] = *loop;
+	}
+	qsort(cmd_name_index, cmd_name_count, sizeof *cmd_name_index,
+	    cmd_name_index_cmp);
+	qsort(cmd_alias_index, cmd_alias_count, sizeof *cmd_alias_index,
+	    cmd_alias_index_cmp);
+}
+
+/*
+ * Look up a command entry by name. An exact alias or name match wins,
+ * otherwise the name may be a unique prefix of one command name. Both
+ * indices are sorted so exact matches are binary searches and all prefix
+ * matches form a contiguous run starting at the lower bound of the name.
+ */
 static const struct cmd_entry *
 cmd_find(const char *name, char **cause)
 {
-	const struct cmd_entry	**loop, *entry, *found = NULL;
-	int			  ambiguous;
+	const struct cmd_entry	 *entry;
+	u_int			  lo, hi, mid, first, last;
+	int			  result;
+	size_t			  namelen;
 	char			  s[8192];
 
-	ambiguous = 0;
-	for (loop = cmd_table; *loop != NULL; loop++) {
-		entry = *loop;
-		if (entry->alias != NULL && strcmp(entry->alias, name) == 0) {
-			ambiguous = 0;
-			found = entry;
-			break;
-		}
-
-		if (strncmp(entry->name, name, strlen(name)) != 0)
-			continue;
-		if (found != NULL)
-			ambiguous = 1;
-		found = entry;
+	cmd_build_index();
+
+	lo = 0;
+	hi = cmd_alias_count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		entry = cmd_alias_index[mid];
+		result = strcmp(name, entry->alias);
+		if (result == 0)
+			return (entry);
+		if (result < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
 
-		if (strcmp(entry->name, name) == 0)
-			break;
+	lo = 0;
+	hi = cmd_name_count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(name, cmd_name_index[mid]->name) > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	if (ambiguous)
-		goto ambiguous;
-	if (found == NULL) {
+	namelen = strlen(name);
+	first = lo;
+	last = first;
+	while (last < cmd_name_count &&
+	    strncmp(cmd_name_index[last]->name, name, namelen) == 0)
+		last++;
+	if (first == last) {
 		xasprintf(cause, "unknown command: %s", name);
 		return (NULL);
 	}
-	return (found);
+	entry = cmd_name_index[first];
+	if (last == first + 1 || strcmp(entry->name, name) == 0)
+		return (entry);
 
-ambiguous:
 	*s = '\0';
-	for (loop = cmd_table; *loop != NULL; loop++) {
-		entry = *loop;
-		if (strncmp(entry->name, name, strlen(name)) != 0)
-			continue;
-		if (strlcat(s, entry->name, sizeof s) >= sizeof s)
+	for (mid = first; mid < last; mid++) {
+		if (strlcat(s, cmd_name_index[mid]->name, sizeof s) >= sizeof s)
 			break;
 		if (strlcat(s, ", ", sizeof s) >= sizeof s)
 			break;
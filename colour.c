@@ -53,37 +53,58 @@ colour_to_6cube(int v)
  * (95), 0x87 (135), 0xaf (175), 0xd7 (215) and 0xff (255). Greys are more
  * evenly spread (8, 18, 28 ... 238).
  */
+/*
+ * Cache of recent conversions. Redraws for 256-colour terminals convert the
+ * same few RGB values over and over, so remember them in a direct-mapped
+ * table. A cached index always has COLOUR_FLAG_256 set so zero means an
+ * empty slot.
+ */
+static struct {
+	int	rgb;
+	int	idx;
+} colour_rgb_cache[4096];
+
 int
 colour_find_rgb(u_char r, u_char g, u_char b)
 {
 	static const int	q2c[6] = { 0x00, 0x5f, 0x87, 0xaf, 0xd7, 0xff };
 	int			qr, qg, qb, cr, cg, cb, d, idx;
-	int			grey_avg, grey_idx, grey;
+	int			grey_avg, grey_idx, grey, rgb;
+	u_int			h;
+
+	rgb = ((int)r << 16) | ((int)g << 8) | (int)b;
+	h = ((u_int)rgb * 2654435769U) >> 20;
+	if (colour_rgb_cache[h].idx != 0 && colour_rgb_cache[h].rgb == rgb)
+		return (colour_rgb_cache[h].idx);
 
 	/* Map RGB to 6x6x6 cube. */
 	qr = colour_to_6cube(r); cr = q2c[qr];
 	qg = colour_to_6cube(g); cg = q2c[qg];
 	qb = colour_to_6cube(b); cb = q2c[qb];
 
-	/* If we have hit the colour exactly, return early. */
+	/* If we have hit the colour exactly, use it. */
 	if (cr == r && cg == g && cb == b)
-		return ((16 + (36 * qr) + (6 * qg) + qb) | COLOUR_FLAG_256);
+		idx = 16 + (36 * qr) + (6 * qg) + qb;
+	else {
+		/* Work out the closest grey (average of RGB). */
+		grey_avg = (r + g + b) / 3;
+		if (grey_avg > 238)
+			grey_idx = 23;
+		else
+			grey_idx = (grey_avg - 3) / 10;
+		grey = 8 + (10 * grey_idx);
 
-	/* Work out the closest grey (average of RGB). */
-	grey_avg = (r + g + b) / 3;
-	if (grey_avg > 238)
-		grey_idx = 23;
-	else
-		grey_idx = (grey_avg - 3) / 10;
-	grey = 8 + (10 * grey_idx);
+		/* Is grey or 6x6x6 colour closest? */
+		d = colour_dist_sq(cr, cg, cb, r, g, b);
+		if (colour_dist_sq(grey, grey, grey, r, g, b) < d)
+			idx = 232 + grey_idx;
+		else
+			idx = 16 + (36 * qr) + (6 * qg) + qb;
+	}
 
-	/* Is grey or 6x6x6 colour closest? */
-	d = colour_dist_sq(cr, cg, cb, r, g, b);
-	if (colour_dist_sq(grey, grey, grey, r, g, b) < d)
-		idx = 232 + grey_idx;
-	else
-		idx = 16 + (36 * qr) + (6 * qg) + qb;
-	return (idx | COLOUR_FLAG_256);
+	colour_rgb_cache[h].rgb = rgb;
+	colour_rgb_cache[h].idx = idx | COLOUR_FLAG_256;
+	return (colour_rgb_cache[h].idx);
 }
 
 /* Join RGB into a colour. */
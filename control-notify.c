@@ -27,37 +27,64 @@
 	((c) != NULL && ((c)->flags & CLIENT_CONTROL))
 
 void
-control_notify_input(struct client *c, struct window_pane *wp,
-    const u_char *buf, size_t len)
+control_notify_input(struct window_pane *wp, const u_char *buf, size_t len)
 {
-	struct evbuffer *message;
-	u_int		 i;
+	struct client	*c;
+	struct evbuffer	*message = NULL;
+	size_t		 i, start;
 
-	if (c->session == NULL)
-	    return;
+	TAILQ_FOREACH(c, &clients, entry) {
+		if (!CONTROL_SHOULD_NOTIFY_CLIENT(c) || c->session == NULL)
+			continue;
+		if (c->flags & CLIENT_CONTROL_NOOUTPUT)
+			continue;
 
-	if (c->flags & CLIENT_CONTROL_NOOUTPUT)
-		return;
+		/*
+		 * Only write input if the window pane is linked to a window
+		 * belonging to the client's session.
+		 */
+		if (winlink_find_by_window(&c->session->windows,
+		    wp->window) == NULL)
+			continue;
 
-	/*
-	 * Only write input if the window pane is linked to a window belonging
-	 * to the client's session.
-	 */
-	if (winlink_find_by_window(&c->session->windows, wp->window) != NULL) {
-		message = evbuffer_new();
-		if (message == NULL)
-			fatalx("out of memory");
-		evbuffer_add_printf(message, "%%output %%%u ", wp->id);
-		for (i = 0; i < len; i++) {
-			if (buf[i] < ' ' || buf[i] == '\\')
-			    evbuffer_add_printf(message, "\\%03o", buf[i]);
-			else
-			    evbuffer_add_printf(message, "%c", buf[i]);
+		/* Binary clients take the output unescaped in one frame. */
+		if (c->flags & CLIENT_CONTROL_BINARY) {
+			control_write_frame(c, CONTROL_FRAME_OUTPUT, wp->id,
+			    buf, len);
+			control_add_output(c, wp,
+			    len + sizeof (struct control_frame));
+			continue;
 		}
-		evbuffer_add(message, "", 1);
-		control_write(c, "%s", EVBUFFER_DATA(message));
-		evbuffer_free(message);
+
+		/*
+		 * Escape the output once for all the clients, appending runs
+		 * of printable bytes in one go.
+		 */
+		if (message == NULL) {
+			message = evbuffer_new();
+			if (message == NULL)
+				fatalx("out of memory");
+			evbuffer_add_printf(message, "%%output %%%u ", wp->id);
+			start = 0;
+			for (i = 0; i < len; i++) {
+				if (buf[i] >= ' ' && buf[i] != '\\')
+					continue;
+				if (i != start) {
+					evbuffer_add(message, buf + start,
+					    i - start);
+				}
+				evbuffer_add_printf(message, "\\%03o",
+				    buf[i]);
+				start = i + 1;
+			}
+			if (i != start)
+				evbuffer_add(message, buf + start, i - start);
+		}
+		control_write_buffer(c, message);
+		control_add_output(c, wp, EVBUFFER_LENGTH(message) + 1);
 	}
+	if (message != NULL)
+		evbuffer_free(message);
 }
 
 void
@@ -26,18 +26,335 @@
 
 #include "tmux.h"
 
-/* Write a line. */
+/*
+ * Flow control accounting for one pane. The sent count is the number of bytes
+ * of %output written for the pane and the acked count is how far the client
+ * has acknowledged with refresh-client -A.
+ */
+struct control_pane {
+	u_int			 pane;
+
+	size_t			 sent;
+	size_t			 acked;
+
+	RB_ENTRY(control_pane)	 entry;
+};
+RB_HEAD(control_panes, control_pane);
+
+/*
+ * A subscription: a named format the client wants to be told about when its
+ * value changes. Pane subscriptions are only re-evaluated when the pane's
+ * generation counters move, so idle panes cost nothing.
+ */
+struct control_sub {
+	char			*name;
+	char			*format;
+
+	enum control_sub_type	 type;
+	u_int			 id;
+
+	char			*last;
+	u_int			 last_gen;
+
+	RB_ENTRY(control_sub)	 entry;
+};
+RB_HEAD(control_subs, control_sub);
+
+/* Flow control state for a control client. */
+struct control_state {
+	struct control_panes	 panes;
+	size_t			 window; /* zero if flow control is off */
+
+	struct control_subs	 subs;
+};
+
+static int
+control_pane_cmp(struct control_pane *cp1, struct control_pane *cp2)
+{
+	if (cp1->pane < cp2->pane)
+		return (-1);
+	if (cp1->pane > cp2->pane)
+		return (1);
+	return (0);
+}
+RB_GENERATE_STATIC(control_panes, control_pane, entry, control_pane_cmp);
+
+static int
+control_sub_cmp(struct control_sub *csub1, struct control_sub *csub2)
+{
+	return (strcmp(csub1->name, csub2->name));
+}
+RB_GENERATE_STATIC(control_subs, control_sub, entry, control_sub_cmp);
+
+/* Free a subscription. */
+static void
+control_free_sub(struct control_state *cs, struct control_sub *csub)
+{
+	RB_REMOVE(control_subs, &cs->subs, csub);
+	free(csub->last);
+	free(csub->name);
+	free(csub->format);
+	free(csub);
+}
+
+/* Find the flow control entry for a pane, if any. */
+static struct control_pane *
+control_get_pane(struct client *c, u_int pane)
+{
+	struct control_pane	 cp;
+
+	cp.pane = pane;
+	return (RB_FIND(control_panes, &c->control_state->panes, &cp));
+}
+
+/* Add the flow control entry for a pane. */
+static struct control_pane *
+control_add_pane(struct client *c, u_int pane)
+{
+	struct control_pane	*cp;
+
+	cp = control_get_pane(c, pane);
+	if (cp != NULL)
+		return (cp);
+
+	cp = xcalloc(1, sizeof *cp);
+	cp->pane = pane;
+	RB_INSERT(control_panes, &c->control_state->panes, cp);
+	return (cp);
+}
+
+/* Has this client exhausted its window for the pane? */
+static int
+control_pane_exhausted(struct client *c, u_int pane)
+{
+	struct control_state	*cs = c->control_state;
+	struct control_pane	*cp;
+
+	if (cs == NULL || cs->window == 0)
+		return (0);
+	cp = control_get_pane(c, pane);
+	if (cp == NULL)
+		return (0);
+	return (cp->sent - cp->acked > cs->window);
+}
+
+/* Pause or resume a pane based on the remaining credit of every client. */
+static void
+control_update_pane(struct window_pane *wp)
+{
+	struct client	*c;
+
+	TAILQ_FOREACH(c, &clients, entry) {
+		if (~c->flags & CLIENT_CONTROL)
+			continue;
+		if (control_pane_exhausted(c, wp->id)) {
+			window_pane_pause(wp);
+			return;
+		}
+	}
+	window_pane_resume(wp);
+}
+
+/* Set the flow control window for a client, zero to turn it off. */
+void
+control_set_flow_window(struct client *c, size_t window)
+{
+	struct control_state	*cs = c->control_state;
+	struct control_pane	*cp;
+	struct window_pane	*wp;
+
+	log_debug("%s: %s: window is %zu", __func__, c->name, window);
+
+	cs->window = window;
+	RB_FOREACH(cp, control_panes, &cs->panes) {
+		wp = window_pane_find_by_id(cp->pane);
+		if (wp != NULL)
+			control_update_pane(wp);
+	}
+}
+
+/* Acknowledge output for a pane up to the given offset. */
+void
+control_acknowledge(struct client *c, struct window_pane *wp, size_t offset)
+{
+	struct control_pane	*cp;
+
+	cp = control_get_pane(c, wp->id);
+	if (cp == NULL)
+		return;
+
+	if (offset > cp->acked)
+		cp->acked = offset;
+	if (cp->acked > cp->sent)
+		cp->acked = cp->sent;
+	log_debug("%s: %s: %%%u acked %zu of %zu", __func__, c->name, wp->id,
+	    cp->acked, cp->sent);
+
+	control_update_pane(wp);
+}
+
+/* Account for output written to a client and pause the pane if needed. */
+void
+control_add_output(struct client *c, struct window_pane *wp, size_t len)
+{
+	struct control_state	*cs = c->control_state;
+	struct control_pane	*cp;
+
+	if (cs->window == 0)
+		return;
+
+	cp = control_add_pane(c, wp->id);
+	cp->sent += len;
+	if (cp->sent - cp->acked > cs->window)
+		window_pane_pause(wp);
+}
+
+/* Add or replace a subscription. */
+void
+control_add_sub(struct client *c, const char *name,
+    enum control_sub_type type, u_int id, const char *format)
+{
+	struct control_state	*cs = c->control_state;
+	struct control_sub	 find, *csub;
+
+	find.name = (char *)name;
+	if ((csub = RB_FIND(control_subs, &cs->subs, &find)) != NULL)
+		control_free_sub(cs, csub);
+
+	csub = xcalloc(1, sizeof *csub);
+	csub->name = xstrdup(name);
+	csub->format = xstrdup(format);
+	csub->type = type;
+	csub->id = id;
+	RB_INSERT(control_subs, &cs->subs, csub);
+}
+
+/* Remove a subscription. */
+void
+control_remove_sub(struct client *c, const char *name)
+{
+	struct control_state	*cs = c->control_state;
+	struct control_sub	 find, *csub;
+
+	find.name = (char *)name;
+	if ((csub = RB_FIND(control_subs, &cs->subs, &find)) != NULL)
+		control_free_sub(cs, csub);
+}
+
+/* Check one subscription, reporting the value if it has changed. */
+static void
+control_check_sub(struct client *c, struct control_sub *csub)
+{
+	struct window_pane	*wp = NULL;
+	struct window		*w = NULL;
+	struct format_tree	*ft;
+	char			*value;
+	u_int			 gen;
+
+	switch (csub->type) {
+	case CONTROL_SUB_NONE:
+		break;
+	case CONTROL_SUB_SESSION:
+		if (session_find_by_id(csub->id) == NULL) {
+			control_free_sub(c->control_state, csub);
+			return;
+		}
+		break;
+	case CONTROL_SUB_WINDOW:
+		w = window_find_by_id(csub->id);
+		if (w == NULL) {
+			control_free_sub(c->control_state, csub);
+			return;
+		}
+		break;
+	case CONTROL_SUB_PANE:
+		wp = window_pane_find_by_id(csub->id);
+		if (wp == NULL) {
+			control_free_sub(c->control_state, csub);
+			return;
+		}
+		gen = wp->generation + wp->current_cmd_gen;
+		if (csub->last != NULL && gen == csub->last_gen)
+			return;
+		csub->last_gen = gen;
+		break;
+	}
+
+	ft = format_create(c, NULL, FORMAT_NONE, 0);
+	if (wp != NULL)
+		format_defaults(ft, c, NULL, NULL, wp);
+	else if (w != NULL)
+		format_defaults_window(ft, w);
+	else
+		format_defaults(ft, c, c->session, NULL, NULL);
+	value = format_expand(ft, csub->format);
+	format_free(ft);
+
+	if (csub->last != NULL && strcmp(value, csub->last) == 0) {
+		free(value);
+		return;
+	}
+	free(csub->last);
+	csub->last = value;
+
+	control_write(c, "%%subscription-changed %s %s", csub->name, value);
+}
+
+/* Check all subscriptions for a client. */
+void
+control_check_subs(struct client *c)
+{
+	struct control_state	*cs = c->control_state;
+	struct control_sub	*csub, *csub1;
+
+	if (cs == NULL)
+		return;
+	RB_FOREACH_SAFE(csub, control_subs, &cs->subs, csub1)
+		control_check_sub(c, csub);
+}
+
+/* Write a binary frame to a client. */
+void
+control_write_frame(struct client *c, u_int type, u_int pane,
+    const void *data, size_t length)
+{
+	struct control_frame	frame;
+
+	frame.type = type;
+	frame.pane = pane;
+	frame.length = length;
+	file_print_buffer(c, &frame, sizeof frame);
+	if (length != 0)
+		file_print_buffer(c, (void *)data, length);
+}
+
+/* Write a line, or a TEXT frame for a binary client. */
 void
 control_write(struct client *c, const char *fmt, ...)
 {
-	va_list	ap;
+	va_list	 ap;
+	char	*s;
 
 	va_start(ap, fmt);
-	file_vprint(c, fmt, ap);
-	file_print(c, "\n");
+	if (c->flags & CLIENT_CONTROL_BINARY) {
+		xvasprintf(&s, fmt, ap);
+		control_write_frame(c, CONTROL_FRAME_TEXT, 0, s, strlen(s));
+		free(s);
+	} else {
+		file_vprint(c, fmt, ap);
+		file_print(c, "\n");
+	}
 	va_end(ap);
 }
 
+/* Write a buffer, adding a newline. */
+void
+control_write_buffer(struct client *c, struct evbuffer *buffer)
+{
+	file_print_buffer(c, EVBUFFER_DATA(buffer), EVBUFFER_LENGTH(buffer));
+	file_print(c, "\n");
+}
+
 /* Control error callback. */
 static enum cmd_retval
 control_error(struct cmdq_item *item, void *data)
@@ -89,8 +406,36 @@ control_callback(__unused struct client *c, __unused const char *path,
 void
 control_start(struct client *c)
 {
+	c->control_state = xcalloc(1, sizeof *c->control_state);
+	RB_INIT(&c->control_state->panes);
+	RB_INIT(&c->control_state->subs);
+
 	file_read(c, "-", control_callback, c);
 
 	if (c->flags & CLIENT_CONTROLCONTROL)
 		file_print(c, "\033P1000p");
 }
+
+void
+control_stop(struct client *c)
+{
+	struct control_state	*cs = c->control_state;
+	struct control_pane	*cp, *cp1;
+	struct control_sub	*csub, *csub1;
+	struct window_pane	*wp;
+
+	c->control_state = NULL;
+
+	RB_FOREACH_SAFE(csub, control_subs, &cs->subs, csub1)
+		control_free_sub(cs, csub);
+
+	RB_FOREACH_SAFE(cp, control_panes, &cs->panes, cp1) {
+		RB_REMOVE(control_panes, &cs->panes, cp);
+
+		wp = window_pane_find_by_id(cp->pane);
+		if (wp != NULL)
+			control_update_pane(wp);
+		free(cp);
+	}
+	free(cs);
+}
@@ -81,7 +81,27 @@ environ_next(struct environ_entry *envent)
 void
 environ_copy(struct environ *srcenv, struct environ *dstenv)
 {
-	struct environ_entry	*envent;
+	struct environ_entry	*envent, *new_envent;
+
+	/*
+	 * Copying into an empty environment cannot hit an existing name, so
+	 * clone the entries directly instead of looking each one up and
+	 * formatting the value again. This is the common case: every spawned
+	 * pane starts from a copy of the global environment.
+	 */
+	if (RB_EMPTY(dstenv)) {
+		RB_FOREACH(envent, environ, srcenv) {
+			new_envent = xmalloc(sizeof *new_envent);
+			new_envent->name = xstrdup(envent->name);
+			if (envent->value != NULL)
+				new_envent->value = xstrdup(envent->value);
+			else
+				new_envent->value = NULL;
+			new_envent->flags = envent->flags;
+			RB_INSERT(environ, dstenv, new_envent);
+		}
+		return;
+	}
 
 	RB_FOREACH(envent, environ, srcenv) {
 		if (envent->value == NULL)
@@ -29,6 +29,9 @@
 
 static int	file_next_stream = 3;
 
+static void	file_push_cb(int, short, void *);
+static void	file_defer_push(struct client_file *);
+
 RB_GENERATE(client_files, client_file, entry, file_cmp);
 
 static char *
@@ -162,7 +165,7 @@ file_vprint(struct client *c, const char *fmt, va_list ap)
 		proc_send(c->peer, MSG_WRITE_OPEN, -1, &msg, sizeof msg);
 	} else {
 		evbuffer_add_vprintf(cf->buffer, fmt, ap);
-		file_push(cf);
+		file_defer_push(cf);
 	}
 }
 
@@ -188,7 +191,7 @@ file_print_buffer(struct client *c, void *data, size_t size)
 		proc_send(c->peer, MSG_WRITE_OPEN, -1, &msg, sizeof msg);
 	} else {
 		evbuffer_add(cf->buffer, data, size);
-		file_push(cf);
+		file_defer_push(cf);
 	}
 }
 
@@ -217,7 +220,7 @@ file_error(struct client *c, const char *fmt, ...)
 		proc_send(c->peer, MSG_WRITE_OPEN, -1, &msg, sizeof msg);
 	} else {
 		evbuffer_add_vprintf(cf->buffer, fmt, ap);
-		file_push(cf);
+		file_defer_push(cf);
 	}
 
 	va_end(ap);
@@ -249,24 +252,30 @@ file_write(struct client *c, const char *path, int flags, const void *bdata,
 	cf = file_create(c, file_next_stream++, cb, cbdata);
 	cf->path = file_get_path(c, path);
 
-	if (c == NULL || c->flags & CLIENT_ATTACHED) {
-		if (flags & O_APPEND)
-			mode = "ab";
-		else
-			mode = "wb";
-		f = fopen(cf->path, mode);
-		if (f == NULL) {
+	/*
+	 * Try to write the file directly in one go; for a command client fall
+	 * back to passing it over imsg in chunks if it cannot be opened, for
+	 * example if only the client can reach the path.
+	 */
+	if (flags & O_APPEND)
+		mode = "ab";
+	else
+		mode = "wb";
+	f = fopen(cf->path, mode);
+	if (f == NULL) {
+		if (c == NULL || c->flags & CLIENT_ATTACHED) {
 			cf->error = errno;
 			goto done;
 		}
-		if (fwrite(bdata, 1, bsize, f) != bsize) {
-			fclose(f);
-			cf->error = EIO;
-			goto done;
-		}
+		goto skip;
+	}
+	if (fwrite(bdata, 1, bsize, f) != bsize) {
 		fclose(f);
+		cf->error = EIO;
 		goto done;
 	}
+	fclose(f);
+	goto done;
 
 skip:
 	evbuffer_add(cf->buffer, bdata, bsize);
@@ -318,28 +327,30 @@ file_read(struct client *c, const char *path, client_file_cb cb, void *cbdata)
 	cf = file_create(c, file_next_stream++, cb, cbdata);
 	cf->path = file_get_path(c, path);
 
-	if (c == NULL || c->flags & CLIENT_ATTACHED) {
-		f = fopen(cf->path, "rb");
-		if (f == NULL) {
+	/* As for writing, try to read the file directly first. */
+	f = fopen(cf->path, "rb");
+	if (f == NULL) {
+		if (c == NULL || c->flags & CLIENT_ATTACHED) {
 			cf->error = errno;
 			goto done;
 		}
-		for (;;) {
-			size = fread(buffer, 1, sizeof buffer, f);
-			if (evbuffer_add(cf->buffer, buffer, size) != 0) {
-				cf->error = ENOMEM;
-				goto done;
-			}
-			if (size != sizeof buffer)
-				break;
-		}
-		if (ferror(f)) {
-			cf->error = EIO;
+		goto skip;
+	}
+	for (;;) {
+		size = fread(buffer, 1, sizeof buffer, f);
+		if (evbuffer_add(cf->buffer, buffer, size) != 0) {
+			cf->error = ENOMEM;
 			goto done;
 		}
-		fclose(f);
+		if (size != sizeof buffer)
+			break;
+	}
+	if (ferror(f)) {
+		cf->error = EIO;
 		goto done;
 	}
+	fclose(f);
+	goto done;
 
 skip:
 	msglen = strlen(cf->path) + 1 + sizeof *msg;
@@ -369,11 +380,27 @@ file_push_cb(__unused int fd, __unused short events, void *arg)
 	struct client_file	*cf = arg;
 	struct client		*c = cf->c;
 
+	cf->queued = 0;
 	if (~c->flags & CLIENT_DEAD)
 		file_push(cf);
 	file_free(cf);
 }
 
+/*
+ * Queue a push for the next pass of the event loop rather than sending at
+ * once, so that a burst of prints is coalesced into full-sized messages
+ * instead of one message per line.
+ */
+static void
+file_defer_push(struct client_file *cf)
+{
+	if (cf->queued)
+		return;
+	cf->queued = 1;
+	cf->references++;
+	event_once(-1, EV_TIMEOUT, file_push_cb, cf, NULL);
+}
+
 void
 file_push(struct client_file *cf)
 {
@@ -402,8 +429,11 @@ file_push(struct client_file *cf)
 		    sent, left);
 	}
 	if (left != 0) {
-		cf->references++;
-		event_once(-1, EV_TIMEOUT, file_push_cb, cf, NULL);
+		if (!cf->queued) {
+			cf->queued = 1;
+			cf->references++;
+			event_once(-1, EV_TIMEOUT, file_push_cb, cf, NULL);
+		}
 	} else if (cf->stream > 2) {
 		close.stream = cf->stream;
 		proc_send(c->peer, MSG_WRITE_CLOSE, -1, &close, sizeof close);
@@ -507,7 +507,9 @@ format_draw(struct screen_write_ctx *octx, const struct grid_cell *base,
 					     "LIST_RIGHT",
 					     "AFTER" };
 	size_t			 size = strlen(expanded);
-	struct screen		*os = octx->s, s[TOTAL];
+	static struct screen	 s[TOTAL];
+	static int		 s_initialized;
+	struct screen		*os = octx->s;
 	struct screen_write_ctx	 ctx[TOTAL];
 	u_int			 ocx = os->cx, ocy = os->cy, i, width[TOTAL];
 	u_int			 map[] = { LEFT, LEFT, CENTRE, RIGHT };
@@ -532,14 +534,21 @@ format_draw(struct screen_write_ctx *octx, const struct grid_cell *base,
 	/*
 	 * We build three screens for left, right, centre alignment, one for
 	 * the list, one for anything after the list and two for the list left
-	 * and right markers.
+	 * and right markers. The screens are kept between calls (format_draw
+	 * does not recurse) and grown when needed, rather than allocated and
+	 * freed each time; clearing the first line is enough to reset them.
 	 */
 	for (i = 0; i < TOTAL; i++) {
-		screen_init(&s[i], size, 1, 0);
+		if (!s_initialized)
+			screen_init(&s[i], size == 0 ? 1 : size, 1, 0);
+		else if (screen_size_x(&s[i]) < size)
+			screen_resize(&s[i], size, 1, 0);
 		screen_write_start(&ctx[i], &s[i]);
+		screen_write_cursormove(&ctx[i], 0, 0, 0);
 		screen_write_clearendofline(&ctx[i], current_default.bg);
 		width[i] = 0;
 	}
+	s_initialized = 1;
 
 	/*
 	 * Walk the string and add to the corresponding screens,
@@ -783,10 +792,6 @@ format_draw(struct screen_write_ctx *octx, const struct grid_cell *base,
 	}
 
 out:
-	/* Free the screens. */
-	for (i = 0; i < TOTAL; i++)
-		screen_free(&s[i]);
-
 	/* Restore the original cursor position. */
 	screen_write_cursormove(octx, ocx, ocy, 0);
 }
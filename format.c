@@ -63,12 +63,32 @@ struct format_job {
 	char			*out;
 	int			 updated;
 
-	struct job		*job;
+	struct format_job_share	*share;
+	TAILQ_ENTRY(format_job)	 sentry;
 	int			 status;
 
 	RB_ENTRY(format_job)	 entry;
 };
 
+/*
+ * A running job, shared between format entries. The same #() command used to
+ * run one process per format job tree, so one per client; instead the
+ * expanded command and working directory are looked up here and every entry
+ * waiting on the same command shares a single process.
+ */
+struct format_job_share {
+	char				*expanded;
+	char				*cwd;
+	struct job			*job;
+
+	TAILQ_HEAD(, format_job)	 waiters;
+
+	RB_ENTRY(format_job_share)	 entry;
+};
+
+/* Longest job output kept without seeing a newline. */
+#define FORMAT_JOB_OUTPUT_MAXIMUM 8192
+
 /* Format job tree. */
 static struct event format_job_event;
 static int format_job_cmp(struct format_job *, struct format_job *);
@@ -86,6 +106,25 @@ format_job_cmp(struct format_job *fj1, struct format_job *fj2)
 	return (strcmp(fj1->cmd, fj2->cmd));
 }
 
+/* Shared job tree. */
+static int format_job_share_cmp(struct format_job_share *,
+    struct format_job_share *);
+static RB_HEAD(format_job_share_tree, format_job_share) format_job_shares =
+    RB_INITIALIZER();
+RB_GENERATE_STATIC(format_job_share_tree, format_job_share, entry,
+    format_job_share_cmp);
+
+/* Shared job tree comparison function. */
+static int
+format_job_share_cmp(struct format_job_share *s1, struct format_job_share *s2)
+{
+	int	r;
+
+	if ((r = strcmp(s1->expanded, s2->expanded)) != 0)
+		return (r);
+	return (strcmp(s1->cwd, s2->cwd));
+}
+
 /* Format modifiers. */
 #define FORMAT_TIMESTRING 0x1
 #define FORMAT_BASENAME 0x2
@@ -98,6 +137,9 @@ format_job_cmp(struct format_job *fj1, struct format_job *fj2)
 #define FORMAT_WINDOWS 0x100
 #define FORMAT_PANES 0x200
 #define FORMAT_PRETTY 0x400
+#define FORMAT_LENGTH 0x800
+#define FORMAT_UPPER 0x1000
+#define FORMAT_LOWER 0x2000
 
 /* Limit on recursion. */
 #define FORMAT_LOOP_LIMIT 10
@@ -106,10 +148,19 @@ format_job_cmp(struct format_job *fj1, struct format_job *fj2)
 struct format_entry {
 	char			*key;
 	char			*value;
+	char			 store[24];
 	time_t			 t;
 	format_cb		 cb;
-	RB_ENTRY(format_entry)	 entry;
+	TAILQ_ENTRY(format_entry) entry;
 };
+TAILQ_HEAD(format_entry_list, format_entry);
+
+/*
+ * Number of hash buckets for the entries in a tree. Trees are populated with
+ * a few hundred variables and looked up far more often than iterated, so a
+ * small hash table beats a balanced tree here.
+ */
+#define FORMAT_HASH_SIZE 64
 
 /* Format entry tree. */
 struct format_tree {
@@ -125,13 +176,13 @@ struct format_tree {
 	u_int			 tag;
 	time_t			 time;
 	u_int			 loop;
+	int			 unstable;
+	int			 clientdep;
 
 	struct mouse_event	 m;
 
-	RB_HEAD(format_entry_tree, format_entry) tree;
+	struct format_entry_list table[FORMAT_HASH_SIZE];
 };
-static int format_entry_cmp(struct format_entry *, struct format_entry *);
-RB_GENERATE_STATIC(format_entry_tree, format_entry, entry, format_entry_cmp);
 
 /* Format modifier. */
 struct format_modifier {
@@ -142,11 +193,116 @@ struct format_modifier {
 	int	  argc;
 };
 
-/* Format entry tree comparison function. */
+/* Hash a format variable name (FNV-1a). */
+static u_int
+format_entry_hash(const char *key)
+{
+	u_int	h = 2166136261U;
+
+	for (; *key != '\0'; key++) {
+		h ^= (u_char)*key;
+		h *= 16777619U;
+	}
+	return (h & (FORMAT_HASH_SIZE - 1));
+}
+
+/* Find an entry in a tree. */
+static struct format_entry *
+format_entry_find(struct format_tree *ft, const char *key)
+{
+	struct format_entry	*fe;
+
+	TAILQ_FOREACH(fe, &ft->table[format_entry_hash(key)], entry) {
+		if (strcmp(fe->key, key) == 0)
+			return (fe);
+	}
+	return (NULL);
+}
+
+/*
+ * Pools of free entries and trees. Nearly every command builds a tree, adds
+ * a hundred-odd entries and frees the lot after one expansion, so recently
+ * freed structures are kept for reuse rather than going back to the
+ * allocator each time.
+ */
+static struct format_entry_list format_entry_pool = TAILQ_HEAD_INITIALIZER(
+    format_entry_pool);
+static u_int		 format_entry_pool_count;
+#define FORMAT_ENTRY_POOL_LIMIT 1024
+static struct format_tree *format_tree_pool[4];
+static u_int		 format_tree_pool_count;
+
+/* Allocate an entry, from the pool if possible. */
+static struct format_entry *
+format_entry_alloc(void)
+{
+	struct format_entry	*fe;
+
+	fe = TAILQ_FIRST(&format_entry_pool);
+	if (fe != NULL) {
+		TAILQ_REMOVE(&format_entry_pool, fe, entry);
+		format_entry_pool_count--;
+	} else
+		fe = xmalloc(sizeof *fe);
+	return (fe);
+}
+
+/*
+ * Free an entry's value. Most values are flags or small numbers and live in
+ * the entry's inline store rather than on the heap.
+ */
+static void
+format_entry_clear_value(struct format_entry *fe)
+{
+	if (fe->value != fe->store)
+		free(fe->value);
+	fe->value = NULL;
+}
+
+/* Return an entry to the pool or free it. */
+static void
+format_entry_free(struct format_entry *fe)
+{
+	format_entry_clear_value(fe);
+	free(fe->key);
+
+	if (format_entry_pool_count == FORMAT_ENTRY_POOL_LIMIT) {
+		free(fe);
+		return;
+	}
+	TAILQ_INSERT_HEAD(&format_entry_pool, fe, entry);
+	format_entry_pool_count++;
+}
+
+/* Find or create an entry, clearing any existing value. */
+static struct format_entry *
+format_entry_add(struct format_tree *ft, const char *key)
+{
+	struct format_entry	*fe;
+
+	fe = format_entry_find(ft, key);
+	if (fe != NULL)
+		format_entry_clear_value(fe);
+	else {
+		fe = format_entry_alloc();
+		fe->key = xstrdup(key);
+		TAILQ_INSERT_TAIL(&ft->table[format_entry_hash(key)], fe,
+		    entry);
+	}
+	fe->value = NULL;
+	fe->cb = NULL;
+	fe->t = 0;
+	return (fe);
+}
+
+/* Sort entries by name for iteration. */
 static int
-format_entry_cmp(struct format_entry *fe1, struct format_entry *fe2)
+format_entry_sort_cmp(const void *a, const void *b)
 {
-	return (strcmp(fe1->key, fe2->key));
+	const struct format_entry *const *fe1 = a;
+	const struct format_entry *const *fe2 = b;
+
+	return (strcmp((*fe1)->key, (*fe2)->key));
 }
 
 /* Single-character uppercase aliases. */
@@ -239,70 +395,168 @@ format_log1(struct format_tree *ft, const char *from, const char *fmt, ...)
 }
 #define format_log(ft, fmt, ...) format_log1(ft, __func__, fmt, ##__VA_ARGS__)
 
+/*
+ * Extract the last complete line of job output and drain what was consumed.
+ * Output that never contains a newline is only left to accumulate up to a
+ * limit, then truncated and taken as a line, so a misbehaving job cannot
+ * grow the buffer without bound.
+ */
+static char *
+format_job_line(struct job *job)
+{
+	struct evbuffer	*evb = job_get_event(job)->input;
+	char		*data = EVBUFFER_DATA(evb), *line;
+	size_t		 len = EVBUFFER_LENGTH(evb), eol, sol;
+
+	eol = len;
+	while (eol > 0 && data[eol - 1] != '\n')
+		eol--;
+	if (eol == 0) {
+		if (len <= FORMAT_JOB_OUTPUT_MAXIMUM)
+			return (NULL);
+		line = xstrndup(data, FORMAT_JOB_OUTPUT_MAXIMUM);
+		evbuffer_drain(evb, len);
+		return (line);
+	}
+
+	sol = eol - 1;
+	while (sol > 0 && data[sol - 1] != '\n')
+		sol--;
+
+	len = eol - 1 - sol;
+	if (len != 0 && data[sol + len - 1] == '\r')
+		len--;
+	line = xstrndup(data + sol, len);
+	evbuffer_drain(evb, eol);
+	return (line);
+}
+
 /* Format job update callback. */
 static void
 format_job_update(struct job *job)
 {
-	struct format_job	*fj = job_get_data(job);
-	struct evbuffer		*evb = job_get_event(job)->input;
-	char			*line = NULL, *next;
+	struct format_job_share	*share = job_get_data(job);
+	struct format_job	*fj;
+	char			*line;
 	time_t			 t;
 
-	while ((next = evbuffer_readline(evb)) != NULL) {
-		free(line);
-		line = next;
-	}
-	if (line == NULL)
+	if ((line = format_job_line(job)) == NULL)
 		return;
-	fj->updated = 1;
+	log_debug("%s: %s: %s", __func__, share->expanded, line);
 
-	free(fj->out);
-	fj->out = line;
+	t = time(NULL);
+	TAILQ_FOREACH(fj, &share->waiters, sentry) {
+		fj->updated = 1;
 
-	log_debug("%s: %p %s: %s", __func__, fj, fj->cmd, fj->out);
+		free(fj->out);
+		fj->out = xstrdup(line);
 
-	t = time(NULL);
-	if (fj->status && fj->last != t) {
-		if (fj->client != NULL)
-			server_status_client(fj->client);
-		fj->last = t;
+		if (fj->status && fj->last != t) {
+			if (fj->client != NULL)
+				server_status_client(fj->client);
+			fj->last = t;
+		}
 	}
+	free(line);
 }
 
 /* Format job complete callback. */
 static void
 format_job_complete(struct job *job)
 {
-	struct format_job	*fj = job_get_data(job);
+	struct format_job_share	*share = job_get_data(job);
 	struct evbuffer		*evb = job_get_event(job)->input;
-	char			*line, *buf;
+	struct format_job	*fj, *fj1;
+	char			*buf;
 	size_t			 len;
 
-	fj->job = NULL;
-
-	buf = NULL;
-	if ((line = evbuffer_readline(evb)) == NULL) {
+	if ((buf = format_job_line(job)) == NULL) {
 		len = EVBUFFER_LENGTH(evb);
+		if (len > FORMAT_JOB_OUTPUT_MAXIMUM)
+			len = FORMAT_JOB_OUTPUT_MAXIMUM;
 		buf = xmalloc(len + 1);
 		if (len != 0)
 			memcpy(buf, EVBUFFER_DATA(evb), len);
 		buf[len] = '\0';
-	} else
-		buf = line;
+	}
+	log_debug("%s: %s: %s", __func__, share->expanded, buf);
 
-	log_debug("%s: %p %s: %s", __func__, fj, fj->cmd, buf);
+	TAILQ_FOREACH_SAFE(fj, &share->waiters, sentry, fj1) {
+		TAILQ_REMOVE(&share->waiters, fj, sentry);
+		fj->share = NULL;
 
-	if (*buf != '\0' || !fj->updated) {
-		free(fj->out);
-		fj->out = buf;
-	} else
-		free(buf);
+		if (*buf != '\0' || !fj->updated) {
+			free(fj->out);
+			fj->out = xstrdup(buf);
+		}
 
-	if (fj->status) {
-		if (fj->client != NULL)
-			server_status_client(fj->client);
-		fj->status = 0;
+		if (fj->status) {
+			if (fj->client != NULL)
+				server_status_client(fj->client);
+			fj->status = 0;
+		}
 	}
+	free(buf);
+
+	share->job = NULL;
+	RB_REMOVE(format_job_share_tree, &format_job_shares, share);
+	free(share->expanded);
+	free(share->cwd);
+	free(share);
+}
+
+/* Detach a format job from its shared job, stopping it if now unused. */
+static void
+format_job_share_detach(struct format_job *fj)
+{
+	struct format_job_share	*share = fj->share;
+
+	if (share == NULL)
+		return;
+	fj->share = NULL;
+	TAILQ_REMOVE(&share->waiters, fj, sentry);
+	if (!TAILQ_EMPTY(&share->waiters))
+		return;
+
+	log_debug("%s: %s stopped", __func__, share->expanded);
+	RB_REMOVE(format_job_share_tree, &format_job_shares, share);
+	if (share->job != NULL)
+		job_free(share->job);
+	free(share->expanded);
+	free(share->cwd);
+	free(share);
+}
+
+/* Find or start the shared job for a command. */
+static struct format_job_share *
+format_job_share_get(const char *expanded, const char *cwd)
+{
+	struct format_job_share	 find, *share;
+
+	if (cwd == NULL)
+		cwd = "";
+
+	find.expanded = (char *)expanded;
+	find.cwd = (char *)cwd;
+	share = RB_FIND(format_job_share_tree, &format_job_shares, &find);
+	if (share != NULL) {
+		log_debug("%s: %s shared", __func__, expanded);
+		return (share);
+	}
+
+	share = xcalloc(1, sizeof *share);
+	TAILQ_INIT(&share->waiters);
+	share->job = job_run(expanded, NULL, *cwd != '\0' ? cwd : NULL,
+	    format_job_update, format_job_complete, NULL, share,
+	    JOB_NOWAIT|JOB_POOLED, -1, -1);
+	if (share->job == NULL) {
+		free(share);
+		return (NULL);
+	}
+	share->expanded = xstrdup(expanded);
+	share->cwd = xstrdup(cwd);
+	RB_INSERT(format_job_share_tree, &format_job_shares, share);
+	return (share);
 }
 
 /* Find a job. */
@@ -336,6 +590,12 @@ format_job_get(struct format_tree *ft, const char *cmd)
 		xasprintf(&fj->out, "<'%s' not ready>", fj->cmd);
 
 		RB_INSERT(format_job_tree, jobs, fj);
+
+		/* The tidy timer only runs while there are jobs to tidy. */
+		if (!evtimer_pending(&format_job_event, NULL)) {
+			struct timeval	tv = { .tv_sec = 60 };
+			evtimer_add(&format_job_event, &tv);
+		}
 	}
 
 	expanded = format_expand(ft, cmd);
@@ -347,16 +607,16 @@ format_job_get(struct format_tree *ft, const char *cmd)
 		force = (ft->flags & FORMAT_FORCE);
 
 	t = time(NULL);
-	if (force && fj->job != NULL)
-	       job_free(fj->job);
-	if (force || (fj->job == NULL && fj->last != t)) {
-		fj->job = job_run(expanded, NULL,
-		    server_client_get_cwd(ft->client, NULL), format_job_update,
-		    format_job_complete, NULL, fj, JOB_NOWAIT, -1, -1);
-		if (fj->job == NULL) {
+	if (force && fj->share != NULL)
+		format_job_share_detach(fj);
+	if (force || (fj->share == NULL && fj->last != t)) {
+		fj->share = format_job_share_get(expanded,
+		    server_client_get_cwd(ft->client, NULL));
+		if (fj->share == NULL) {
 			free(fj->out);
 			xasprintf(&fj->out, "<'%s' didn't start>", fj->cmd);
-		}
+		} else
+			TAILQ_INSERT_TAIL(&fj->share->waiters, fj, sentry);
 		fj->last = t;
 		fj->updated = 0;
 	}
@@ -383,8 +643,7 @@ format_job_tidy(struct format_job_tree *jobs, int force)
 
 		log_debug("%s: %s", __func__, fj->cmd);
 
-		if (fj->job != NULL)
-			job_free(fj->job);
+		format_job_share_detach(fj);
 
 		free((void *)fj->expanded);
 		free((void *)fj->cmd);
@@ -403,21 +662,29 @@ format_lost_client(struct client *c)
 	free(c->jobs);
 }
 
-/* Remove old jobs periodically. */
+/* Remove old jobs periodically, while there are any jobs at all. */
 static void
 format_job_timer(__unused int fd, __unused short events, __unused void *arg)
 {
 	struct client	*c;
 	struct timeval	 tv = { .tv_sec = 60 };
+	int		 empty;
+
+	/* Offset by the server phase so servers do not tidy in step. */
+	tv.tv_usec = server_tick_phase();
 
 	format_job_tidy(&format_jobs, 0);
+	empty = RB_EMPTY(&format_jobs);
 	TAILQ_FOREACH(c, &clients, entry) {
-		if (c->jobs != NULL)
+		if (c->jobs != NULL) {
 			format_job_tidy(c->jobs, 0);
+			if (!RB_EMPTY(c->jobs))
+				empty = 0;
+		}
 	}
 
-	evtimer_del(&format_job_event);
-	evtimer_add(&format_job_event, &tv);
+	if (!empty)
+		evtimer_add(&format_job_event, &tv);
 }
 
 /* Callback for host. */
@@ -682,14 +949,15 @@ static void
 format_cb_window_layout(struct format_tree *ft, struct format_entry *fe)
 {
 	struct window	*w = ft->w;
+	const char	*value;
 
 	if (w == NULL)
 		return;
 
 	if (w->saved_layout_root != NULL)
 		fe->value = layout_dump(w->saved_layout_root);
-	else
-		fe->value = layout_dump(w->layout_root);
+	else if ((value = layout_dump_cached(w)) != NULL)
+		fe->value = xstrdup(value);
 }
 
 /* Callback for window_visible_layout. */
@@ -697,11 +965,13 @@ static void
 format_cb_window_visible_layout(struct format_tree *ft, struct format_entry *fe)
 {
 	struct window	*w = ft->w;
+	const char	*value;
 
 	if (w == NULL)
 		return;
 
-	fe->value = layout_dump(w->layout_root);
+	if ((value = layout_dump_cached(w)) != NULL)
+		fe->value = xstrdup(value);
 }
 
 /* Callback for pane_start_command. */
@@ -722,10 +992,26 @@ format_cb_current_command(struct format_tree *ft, struct format_entry *fe)
 {
 	struct window_pane	*wp = ft->wp;
 	char			*cmd;
+	pid_t			 pgrp;
 
 	if (wp == NULL || wp->shell == NULL)
 		return;
 
+	/*
+	 * Getting the name means reading /proc (or the kernel tables) so
+	 * cache it: while the foreground process group is the same and the
+	 * pane has produced no new output, the command cannot have visibly
+	 * changed.
+	 */
+	pgrp = tcgetpgrp(wp->fd);
+	if (wp->current_cmd != NULL &&
+	    pgrp != -1 &&
+	    pgrp == wp->current_pgrp &&
+	    wp->generation == wp->current_cmd_gen) {
+		fe->value = xstrdup(wp->current_cmd);
+		return;
+	}
+
 	cmd = osdep_get_name(wp->fd, wp->tty);
 	if (cmd == NULL || *cmd == '\0') {
 		free(cmd);
@@ -737,6 +1023,11 @@ format_cb_current_command(struct format_tree *ft, struct format_entry *fe)
 	}
 	fe->value = parse_window_name(cmd);
 	free(cmd);
+
+	free(wp->current_cmd);
+	wp->current_cmd = xstrdup(fe->value);
+	wp->current_pgrp = pgrp;
+	wp->current_cmd_gen = wp->generation;
 }
 
 /* Callback for pane_current_path. */
@@ -745,13 +1036,30 @@ format_cb_current_path(struct format_tree *ft, struct format_entry *fe)
 {
 	struct window_pane	*wp = ft->wp;
 	char			*cwd;
+	pid_t			 pgrp;
 
 	if (wp == NULL)
 		return;
 
+	/* Cached in the same way as pane_current_command. */
+	pgrp = tcgetpgrp(wp->fd);
+	if (wp->current_cwd != NULL &&
+	    pgrp != -1 &&
+	    pgrp == wp->current_cwd_pgrp &&
+	    wp->generation == wp->current_cwd_gen) {
+		fe->value = xstrdup(wp->current_cwd);
+		return;
+	}
+
 	cwd = osdep_get_cwd(wp->fd);
-	if (cwd != NULL)
+	if (cwd != NULL) {
 		fe->value = xstrdup(cwd);
+
+		free(wp->current_cwd);
+		wp->current_cwd = xstrdup(cwd);
+		wp->current_cwd_pgrp = pgrp;
+		wp->current_cwd_gen = wp->generation;
+	}
 }
 
 /* Callback for history_bytes. */
@@ -807,6 +1115,46 @@ format_cb_pane_tabs(struct format_tree *ft, struct format_entry *fe)
 	evbuffer_free(buffer);
 }
 
+/* Callback for pane_memory. */
+static void
+format_cb_pane_memory(struct format_tree *ft, struct format_entry *fe)
+{
+	if (ft->wp == NULL)
+		return;
+	xasprintf(&fe->value, "%zu", window_pane_memory(ft->wp));
+}
+
+/* Callback for window_memory. */
+static void
+format_cb_window_memory(struct format_tree *ft, struct format_entry *fe)
+{
+	struct window_pane	*wp;
+	size_t			 size = 0;
+
+	if (ft->w == NULL)
+		return;
+	TAILQ_FOREACH(wp, &ft->w->panes, entry)
+		size += window_pane_memory(wp);
+	xasprintf(&fe->value, "%zu", size);
+}
+
+/* Callback for session_memory. */
+static void
+format_cb_session_memory(struct format_tree *ft, struct format_entry *fe)
+{
+	struct winlink		*wl;
+	struct window_pane	*wp;
+	size_t			 size = 0;
+
+	if (ft->s == NULL)
+		return;
+	RB_FOREACH(wl, winlinks, &ft->s->windows) {
+		TAILQ_FOREACH(wp, &wl->window->panes, entry)
+			size += window_pane_memory(wp);
+	}
+	xasprintf(&fe->value, "%zu", size);
+}
+
 /* Callback for session_group_list. */
 static void
 format_cb_session_group_list(struct format_tree *ft, struct format_entry *fe)
@@ -1112,9 +1460,13 @@ format_merge(struct format_tree *ft, struct format_tree *from)
 {
 	struct format_entry	*fe;
 
-	RB_FOREACH(fe, format_entry_tree, &from->tree) {
-		if (fe->value != NULL)
-			format_add(ft, fe->key, "%s", fe->value);
+	u_int			 i;
+
+	for (i = 0; i < FORMAT_HASH_SIZE; i++) {
+		TAILQ_FOREACH(fe, &from->table[i], entry) {
+			if (fe->value != NULL)
+				format_add(ft, fe->key, "%s", fe->value);
+		}
 	}
 }
 
@@ -1148,14 +1500,18 @@ format_create(struct client *c, struct cmdq_item *item, int tag, int flags)
 	struct format_tree		 *ft;
 	const struct window_mode	**wm;
 	char				  tmp[64];
+	u_int				  i;
 
-	if (!event_initialized(&format_job_event)) {
+	if (!event_initialized(&format_job_event))
 		evtimer_set(&format_job_event, format_job_timer, NULL);
-		format_job_timer(-1, 0, NULL);
-	}
 
-	ft = xcalloc(1, sizeof *ft);
-	RB_INIT(&ft->tree);
+	if (format_tree_pool_count != 0) {
+		ft = format_tree_pool[--format_tree_pool_count];
+		memset(ft, 0, sizeof *ft);
+	} else
+		ft = xcalloc(1, sizeof *ft);
+	for (i = 0; i < FORMAT_HASH_SIZE; i++)
+		TAILQ_INIT(&ft->table[i]);
 
 	if (c != NULL) {
 		ft->client = c;
@@ -1174,6 +1530,13 @@ format_create(struct client *c, struct cmdq_item *item, int tag, int flags)
 	format_add(ft, "socket_path", "%s", socket_path);
 	format_add_tv(ft, "start_time", &start_time);
 
+	format_add(ft, "server_loops", "%llu", server_perf.loops);
+	format_add(ft, "server_input_bytes", "%llu", server_perf.input_bytes);
+	format_add(ft, "server_tty_bytes", "%llu", server_perf.tty_bytes);
+	format_add(ft, "server_format_expands", "%llu",
+	    server_perf.format_expands);
+	format_add(ft, "server_allocations", "%llu", server_perf.xallocs);
+
 	for (wm = all_window_modes; *wm != NULL; wm++) {
 		if ((*wm)->default_format != NULL) {
 			xsnprintf(tmp, sizeof tmp, "%s_format", (*wm)->name);
@@ -1194,16 +1557,21 @@ format_free(struct format_tree *ft)
 {
 	struct format_entry	*fe, *fe1;
 
-	RB_FOREACH_SAFE(fe, format_entry_tree, &ft->tree, fe1) {
-		RB_REMOVE(format_entry_tree, &ft->tree, fe);
-		free(fe->value);
-		free(fe->key);
-		free(fe);
+	u_int			 i;
+
+	for (i = 0; i < FORMAT_HASH_SIZE; i++) {
+		TAILQ_FOREACH_SAFE(fe, &ft->table[i], entry, fe1) {
+			TAILQ_REMOVE(&ft->table[i], fe, entry);
+			format_entry_free(fe);
+		}
 	}
 
 	if (ft->client != NULL)
 		server_client_unref(ft->client);
-	free(ft);
+	if (format_tree_pool_count != nitems(format_tree_pool))
+		format_tree_pool[format_tree_pool_count++] = ft;
+	else
+		free(ft);
 }
 
 /* Walk each format. */
@@ -1211,22 +1579,43 @@ void
 format_each(struct format_tree *ft, void (*cb)(const char *, const char *,
     void *), void *arg)
 {
-	struct format_entry	*fe;
-	char			 s[64];
+	struct format_entry	 *fe, **all;
+	char			  s[64];
+	u_int			  i, n;
+
+	/* Sort the entries so the output order is stable. */
+	n = 0;
+	for (i = 0; i < FORMAT_HASH_SIZE; i++) {
+		TAILQ_FOREACH(fe, &ft->table[i], entry)
+			n++;
+	}
+	if (n == 0)
+		return;
+	all = xreallocarray(NULL, n, sizeof *all);
+	n = 0;
+	for (i = 0; i < FORMAT_HASH_SIZE; i++) {
+		TAILQ_FOREACH(fe, &ft->table[i], entry)
+			all[n++] = fe;
+	}
+	qsort(all, n, sizeof *all, format_entry_sort_cmp);
 
-	RB_FOREACH(fe, format_entry_tree, &ft->tree) {
+	for (i = 0; i < n; i++) {
+		fe = all[i];
 		if (fe->t != 0) {
 			xsnprintf(s, sizeof s, "%lld", (long long)fe->t);
 			cb(fe->key, s, arg);
 		} else {
 			if (fe->value == NULL && fe->cb != NULL) {
 				fe->cb(ft, fe);
-				if (fe->value == NULL)
-					fe->value = xstrdup("");
+				if (fe->value == NULL) {
+					*fe->store = '\0';
+					fe->value = fe->store;
+				}
 			}
 			cb(fe->key, fe->value, arg);
 		}
 	}
+	free(all);
 }
 
 /* Add a key-value pair. */
@@ -1234,49 +1623,30 @@ void
 format_add(struct format_tree *ft, const char *key, const char *fmt, ...)
 {
 	struct format_entry	*fe;
-	struct format_entry	*fe_now;
 	va_list			 ap;
+	int			 n;
 
-	fe = xmalloc(sizeof *fe);
-	fe->key = xstrdup(key);
-
-	fe_now = RB_INSERT(format_entry_tree, &ft->tree, fe);
-	if (fe_now != NULL) {
-		free(fe->key);
-		free(fe);
-		free(fe_now->value);
-		fe = fe_now;
-	}
-
-	fe->cb = NULL;
-	fe->t = 0;
+	fe = format_entry_add(ft, key);
 
 	va_start(ap, fmt);
-	xvasprintf(&fe->value, fmt, ap);
+	n = vsnprintf(fe->store, sizeof fe->store, fmt, ap);
 	va_end(ap);
+	if (n < 0 || n >= (int)sizeof fe->store) {
+		va_start(ap, fmt);
+		xvasprintf(&fe->value, fmt, ap);
+		va_end(ap);
+	} else
+		fe->value = fe->store;
 }
 
 /* Add a key and time. */
 void
 format_add_tv(struct format_tree *ft, const char *key, struct timeval *tv)
 {
-	struct format_entry	*fe, *fe_now;
-
-	fe = xmalloc(sizeof *fe);
-	fe->key = xstrdup(key);
-
-	fe_now = RB_INSERT(format_entry_tree, &ft->tree, fe);
-	if (fe_now != NULL) {
-		free(fe->key);
-		free(fe);
-		free(fe_now->value);
-		fe = fe_now;
-	}
+	struct format_entry	*fe;
 
-	fe->cb = NULL;
+	fe = format_entry_add(ft, key);
 	fe->t = tv->tv_sec;
-
-	fe->value = NULL;
 }
 
 /* Add a key and function. */
@@ -1284,23 +1654,9 @@ static void
 format_add_cb(struct format_tree *ft, const char *key, format_cb cb)
 {
 	struct format_entry	*fe;
-	struct format_entry	*fe_now;
-
-	fe = xmalloc(sizeof *fe);
-	fe->key = xstrdup(key);
-
-	fe_now = RB_INSERT(format_entry_tree, &ft->tree, fe);
-	if (fe_now != NULL) {
-		free(fe->key);
-		free(fe);
-		free(fe_now->value);
-		fe = fe_now;
-	}
 
+	fe = format_entry_add(ft, key);
 	fe->cb = cb;
-	fe->t = 0;
-
-	fe->value = NULL;
 }
 
 /* Quote special characters in string. */
@@ -1371,7 +1727,7 @@ static char *
 format_find(struct format_tree *ft, const char *key, int modifiers,
     const char *time_format)
 {
-	struct format_entry	*fe, fe_find;
+	struct format_entry	*fe;
 	struct environ_entry	*envent;
 	struct options_entry	*o;
 	int			 idx;
@@ -1380,6 +1736,9 @@ format_find(struct format_tree *ft, const char *key, int modifiers,
 	time_t			 t = 0;
 	struct tm		 tm;
 
+	if (strncmp(key, "client_", 7) == 0)
+		ft->clientdep = 1;
+
 	o = options_parse_get(global_options, key, &idx, 0);
 	if (o == NULL && ft->wp != NULL)
 		o = options_parse_get(ft->wp->options, key, &idx, 0);
@@ -1396,8 +1755,7 @@ format_find(struct format_tree *ft, const char *key, int modifiers,
 		goto found;
 	}
 
-	fe_find.key = (char *)key;
-	fe = RB_FIND(format_entry_tree, &ft->tree, &fe_find);
+	fe = format_entry_find(ft, key);
 	if (fe != NULL) {
 		if (fe->t != 0) {
 			t = fe->t;
@@ -1405,8 +1763,10 @@ format_find(struct format_tree *ft, const char *key, int modifiers,
 		}
 		if (fe->value == NULL && fe->cb != NULL)
 			fe->cb(ft, fe);
-		if (fe->value == NULL)
-			fe->value = xstrdup("");
+		if (fe->value == NULL) {
+			*fe->store = '\0';
+			fe->value = fe->store;
+		}
 		found = xstrdup(fe->value);
 		goto found;
 	}
@@ -1427,6 +1787,7 @@ format_find(struct format_tree *ft, const char *key, int modifiers,
 
 found:
 	if (modifiers & FORMAT_TIMESTRING) {
+		ft->unstable = 1;
 		if (t == 0 && found != NULL) {
 			t = strtonum(found, 0, INT64_MAX, &errstr);
 			if (errstr != NULL)
@@ -1601,7 +1962,7 @@ format_build_modifiers(struct format_tree *ft, const char **s, u_int *count)
 
 	/*
 	 * Modifiers are a ; separated list of the forms:
-	 *      l,m,C,b,d,t,q,E,T,S,W,P,<,>
+	 *      l,m,C,b,d,n,t,q,E,T,S,U,L,W,P,<,>
 	 *	=a
 	 *	=/a
 	 *      =/a/
@@ -1618,7 +1979,7 @@ format_build_modifiers(struct format_tree *ft, const char **s, u_int *count)
 			cp++;
 
 		/* Check single character modifiers with no arguments. */
-		if (strchr("lbdqETSWP<>", cp[0]) != NULL &&
+		if (strchr("lbdnqETSULWP<>", cp[0]) != NULL &&
 		    format_is_end(cp[1])) {
 			format_add_modifier(&list, count, cp, 1, NULL, 0);
 			cp++;
@@ -1905,7 +2266,17 @@ format_replace_expression(struct format_modifier *mexp, struct format_tree *ft,
 	int		 use_fp = 0;
 	u_int		 prec = 0;
 	double		 mleft, mright, result;
-	enum { ADD, SUBTRACT, MULTIPLY, DIVIDE, MODULUS } operator;
+	enum { ADD,
+	       SUBTRACT,
+	       MULTIPLY,
+	       DIVIDE,
+	       MODULUS,
+	       EQUAL,
+	       NOT_EQUAL,
+	       GREATER_THAN,
+	       GREATER_THAN_EQUAL,
+	       LESS_THAN,
+	       LESS_THAN_EQUAL } operator;
 
 	if (strcmp(mexp->argv[0], "+") == 0)
 		operator = ADD;
@@ -1918,6 +2289,18 @@ format_replace_expression(struct format_modifier *mexp, struct format_tree *ft,
 	else if (strcmp(mexp->argv[0], "%") == 0 ||
 	    strcmp(mexp->argv[0], "m") == 0)
 		operator = MODULUS;
+	else if (strcmp(mexp->argv[0], "==") == 0)
+		operator = EQUAL;
+	else if (strcmp(mexp->argv[0], "!=") == 0)
+		operator = NOT_EQUAL;
+	else if (strcmp(mexp->argv[0], ">") == 0)
+		operator = GREATER_THAN;
+	else if (strcmp(mexp->argv[0], "<") == 0)
+		operator = LESS_THAN;
+	else if (strcmp(mexp->argv[0], ">=") == 0)
+		operator = GREATER_THAN_EQUAL;
+	else if (strcmp(mexp->argv[0], "<=") == 0)
+		operator = LESS_THAN_EQUAL;
 	else {
 		format_log(ft, "expression has no valid operator: '%s'",
 		    mexp->argv[0]);
@@ -1980,6 +2363,30 @@ format_replace_expression(struct format_modifier *mexp, struct format_tree *ft,
 	case MODULUS:
 		result = fmod(mleft, mright);
 		break;
+	case EQUAL:
+		result = fabs(mleft - mright) < 1e-9;
+		break;
+	case NOT_EQUAL:
+		result = fabs(mleft - mright) > 1e-9;
+		break;
+	case GREATER_THAN:
+		if (fabs(mleft - mright) < 1e-9)
+			result = 0;
+		else
+			result = (mleft > mright);
+		break;
+	case GREATER_THAN_EQUAL:
+		result = (mleft >= mright);
+		break;
+	case LESS_THAN:
+		if (fabs(mleft - mright) < 1e-9)
+			result = 0;
+		else
+			result = (mleft < mright);
+		break;
+	case LESS_THAN_EQUAL:
+		result = (mleft <= mright);
+		break;
 	}
 	if (use_fp)
 		xasprintf(&value, "%.*f", prec, result);
@@ -2006,7 +2413,8 @@ format_replace(struct format_tree *ft, const char *key, size_t keylen,
 	const char		 *errptr, *copy, *cp, *marker = NULL;
 	const char		 *time_format = NULL;
 	char			 *copy0, *condition, *found, *new;
-	char			 *value, *left, *right;
+	char			 *value, *left, *right, *vp;
+	struct utf8_data	 *ud;
 	size_t			  valuelen;
 	int			  modifiers = 0, limit = 0, width = 0, j;
 	struct format_modifier   *list, *fm, *cmp = NULL, *search = NULL;
@@ -2073,6 +2481,15 @@ format_replace(struct format_tree *ft, const char *key, size_t keylen,
 			case 'b':
 				modifiers |= FORMAT_BASENAME;
 				break;
+			case 'n':
+				modifiers |= FORMAT_LENGTH;
+				break;
+			case 'U':
+				modifiers |= FORMAT_UPPER;
+				break;
+			case 'L':
+				modifiers |= FORMAT_LOWER;
+				break;
 			case 'd':
 				modifiers |= FORMAT_DIRNAME;
 				break;
@@ -2277,6 +2694,24 @@ done:
 		value = new;
 	}
 
+	/* Apply case conversion and length if required. */
+	if (modifiers & FORMAT_UPPER) {
+		for (vp = value; *vp != '\0'; vp++)
+			*vp = toupper((u_char)*vp);
+	}
+	if (modifiers & FORMAT_LOWER) {
+		for (vp = value; *vp != '\0'; vp++)
+			*vp = tolower((u_char)*vp);
+	}
+	if (modifiers & FORMAT_LENGTH) {
+		ud = utf8_fromcstr(value);
+		xasprintf(&new, "%zu", utf8_strlen(ud));
+		free(ud);
+		format_log(ft, "applied length of '%s': %s", value, new);
+		free(value);
+		value = new;
+	}
+
 	/* Perform substitution if any. */
 	for (i = 0; i < nsub; i++) {
 		left = format_expand(ft, sub[i]->argv[0]);
@@ -2351,50 +2786,96 @@ fail:
 	return (-1);
 }
 
-/* Expand keys in a template. */
-static char *
-format_expand1(struct format_tree *ft, const char *fmt, int time)
+
+/*
+ * Compiled format cache. Scanning a template for #-constructs and matching
+ * nested braces is repeated for the same strings (status lines, options)
+ * many times a second, so split each template once into a list of parts and
+ * cache the result keyed by the template string. Values substituted at
+ * expansion time are not cached, only the shape of the template.
+ */
+struct format_part {
+	enum {
+		FORMAT_PART_LITERAL,
+		FORMAT_PART_JOB,
+		FORMAT_PART_REPLACE,
+		FORMAT_PART_STOP
+	} type;
+	char			*s;
+	size_t			 n;
+	TAILQ_ENTRY(format_part) entry;
+};
+struct format_compiled {
+	char				*fmt;
+	TAILQ_HEAD(, format_part)	 parts;
+	RB_ENTRY(format_compiled)	 entry;
+};
+RB_HEAD(format_compiled_tree, format_compiled);
+static int format_compiled_cmp(struct format_compiled *,
+	    struct format_compiled *);
+RB_GENERATE_STATIC(format_compiled_tree, format_compiled, entry,
+    format_compiled_cmp);
+static struct format_compiled_tree format_compiled_cache = RB_INITIALIZER();
+static u_int format_compiled_count;
+#define FORMAT_COMPILED_LIMIT 1000
+
+/* Compiled format cache comparison function. */
+static int
+format_compiled_cmp(struct format_compiled *fc1, struct format_compiled *fc2)
 {
-	char		*buf, *out, *name;
-	const char	*ptr, *s;
-	size_t		 off, len, n, outlen;
-	int     	 ch, brackets;
-	struct tm	*tm;
-	char		 expanded[8192];
+	return (strcmp(fc1->fmt, fc2->fmt));
+}
 
-	if (fmt == NULL || *fmt == '\0')
-		return (xstrdup(""));
+/* Add a part to a compiled format. */
+static void
+format_part_add(struct format_compiled *fc, int type, const char *s, size_t n)
+{
+	struct format_part	*fp;
 
-	if (ft->loop == FORMAT_LOOP_LIMIT)
-		return (xstrdup(""));
-	ft->loop++;
+	fp = xcalloc(1, sizeof *fp);
+	fp->type = type;
+	if (s != NULL)
+		fp->s = xstrndup(s, n);
+	fp->n = n;
+	TAILQ_INSERT_TAIL(&fc->parts, fp, entry);
+}
 
-	format_log(ft, "expanding format: %s", fmt);
+/* Free a compiled format. */
+static void
+format_compiled_free(struct format_compiled *fc)
+{
+	struct format_part	*fp, *fp1;
 
-	if (time) {
-		tm = localtime(&ft->time);
-		if (strftime(expanded, sizeof expanded, fmt, tm) == 0) {
-			format_log(ft, "format is too long");
-			return (xstrdup(""));
-		}
-		if (format_logging(ft) && strcmp(expanded, fmt) != 0)
-			format_log(ft, "after time expanded: %s", expanded);
-		fmt = expanded;
+	TAILQ_FOREACH_SAFE(fp, &fc->parts, entry, fp1) {
+		TAILQ_REMOVE(&fc->parts, fp, entry);
+		free(fp->s);
+		free(fp);
 	}
+	free(fc->fmt);
+	free(fc);
+}
 
-	len = 64;
-	buf = xmalloc(len);
-	off = 0;
+/* Split a template into a list of parts. */
+static struct format_compiled *
+format_compile(const char *fmt)
+{
+	struct format_compiled	*fc;
+	const char		*ptr, *s, *lit;
+	size_t			 n;
+	int			 ch, brackets;
 
+	fc = xcalloc(1, sizeof *fc);
+	fc->fmt = xstrdup(fmt);
+	TAILQ_INIT(&fc->parts);
+
+	lit = fmt;
 	while (*fmt != '\0') {
 		if (*fmt != '#') {
-			while (len - off < 2) {
-				buf = xreallocarray(buf, 2, len);
-				len *= 2;
-			}
-			buf[off++] = *fmt++;
+			fmt++;
 			continue;
 		}
+		if (fmt != lit)
+			format_part_add(fc, FORMAT_PART_LITERAL, lit, fmt - lit);
 		fmt++;
 
 		ch = (u_char)*fmt++;
@@ -2411,29 +2892,9 @@ format_expand1(struct format_tree *ft, const char *fmt, int time)
 				break;
 			n = ptr - fmt;
 
-			name = xstrndup(fmt, n);
-			format_log(ft, "found #(): %s", name);
-
-			if (ft->flags & FORMAT_NOJOBS) {
-				out = xstrdup("");
-				format_log(ft, "#() is disabled");
-			} else {
-				out = format_job_get(ft, name);
-				format_log(ft, "#() result: %s", out);
-			}
-			free(name);
-
-			outlen = strlen(out);
-			while (len - off < outlen + 1) {
-				buf = xreallocarray(buf, 2, len);
-				len *= 2;
-			}
-			memcpy(buf + off, out, outlen);
-			off += outlen;
-
-			free(out);
-
+			format_part_add(fc, FORMAT_PART_JOB, fmt, n);
 			fmt += n + 1;
+			lit = fmt;
 			continue;
 		case '{':
 			ptr = format_skip((char *)fmt - 2, "}");
@@ -2441,20 +2902,17 @@ format_expand1(struct format_tree *ft, const char *fmt, int time)
 				break;
 			n = ptr - fmt;
 
-			format_log(ft, "found #{}: %.*s", (int)n, fmt);
-			if (format_replace(ft, fmt, n, &buf, &len, &off) != 0)
-				break;
+			format_part_add(fc, FORMAT_PART_REPLACE, fmt, n);
 			fmt += n + 1;
+			lit = fmt;
 			continue;
+		case '\0':
+			break;
 		case '}':
 		case '#':
 		case ',':
-			format_log(ft, "found #%c", ch);
-			while (len - off < 2) {
-				buf = xreallocarray(buf, 2, len);
-				len *= 2;
-			}
-			buf[off++] = ch;
+			format_part_add(fc, FORMAT_PART_LITERAL, fmt - 1, 1);
+			lit = fmt;
 			continue;
 		default:
 			s = NULL;
@@ -2463,25 +2921,150 @@ format_expand1(struct format_tree *ft, const char *fmt, int time)
 			else if (ch >= 'a' && ch <= 'z')
 				s = format_lower[ch - 'a'];
 			if (s == NULL) {
-				while (len - off < 3) {
-					buf = xreallocarray(buf, 2, len);
-					len *= 2;
-				}
-				buf[off++] = '#';
-				buf[off++] = ch;
+				format_part_add(fc, FORMAT_PART_LITERAL,
+				    fmt - 2, 2);
+				lit = fmt;
 				continue;
 			}
-			n = strlen(s);
-			format_log(ft, "found #%c: %s", ch, s);
-			if (format_replace(ft, s, n, &buf, &len, &off) != 0)
-				break;
+			format_part_add(fc, FORMAT_PART_REPLACE, s, strlen(s));
+			lit = fmt;
 			continue;
 		}
 
+		/* Malformed construct: stop expanding here, as before. */
+		format_part_add(fc, FORMAT_PART_STOP, NULL, 0);
+		return (fc);
+	}
+	if (fmt != lit)
+		format_part_add(fc, FORMAT_PART_LITERAL, lit, fmt - lit);
+	return (fc);
+}
+
+/* Look up a compiled format in the cache, compiling if necessary. */
+static struct format_compiled *
+format_compiled_get(const char *fmt)
+{
+	struct format_compiled	search, *fc, *fc1;
+
+	search.fmt = (char *)fmt;
+	fc = RB_FIND(format_compiled_tree, &format_compiled_cache, &search);
+	if (fc != NULL)
+		return (fc);
+
+	/* Expanded values pass through here too, so cap the cache. */
+	if (format_compiled_count >= FORMAT_COMPILED_LIMIT) {
+		RB_FOREACH_SAFE(fc, format_compiled_tree, &format_compiled_cache,
+		    fc1) {
+			RB_REMOVE(format_compiled_tree, &format_compiled_cache,
+			    fc);
+			format_compiled_free(fc);
+		}
+		format_compiled_count = 0;
+	}
+
+	fc = format_compile(fmt);
+	RB_INSERT(format_compiled_tree, &format_compiled_cache, fc);
+	format_compiled_count++;
+	return (fc);
+}
+
+/* Expand keys in a template. */
+static char *
+format_expand1(struct format_tree *ft, const char *fmt, int time)
+{
+	struct format_compiled	*fc;
+	struct format_part	*fp;
+	char			*buf, *out;
+	size_t			 off, len, outlen;
+	struct tm		*tm;
+	char			 expanded[8192];
+	int			 cached = 1;
+
+	if (fmt == NULL || *fmt == '\0')
+		return (xstrdup(""));
+
+	if (ft->loop == FORMAT_LOOP_LIMIT)
+		return (xstrdup(""));
+	if (ft->loop == 0)
+		ft->unstable = ft->clientdep = 0;
+	ft->loop++;
+
+	format_log(ft, "expanding format: %s", fmt);
+
+	if (time) {
+		tm = localtime(&ft->time);
+		if (strftime(expanded, sizeof expanded, fmt, tm) == 0) {
+			format_log(ft, "format is too long");
+			return (xstrdup(""));
+		}
+		if (strcmp(expanded, fmt) != 0) {
+			if (format_logging(ft))
+				format_log(ft, "after time expanded: %s",
+				    expanded);
+			ft->unstable = 1;
+		}
+		fmt = expanded;
+
+		/* The expanded string changes per call, don't cache it. */
+		cached = 0;
+	}
+
+	if (cached)
+		fc = format_compiled_get(fmt);
+	else
+		fc = format_compile(fmt);
+
+	len = 64;
+	buf = xmalloc(len);
+	off = 0;
+
+	TAILQ_FOREACH(fp, &fc->parts, entry) {
+		switch (fp->type) {
+		case FORMAT_PART_LITERAL:
+			while (len - off < fp->n + 1) {
+				buf = xreallocarray(buf, 2, len);
+				len *= 2;
+			}
+			memcpy(buf + off, fp->s, fp->n);
+			off += fp->n;
+			continue;
+		case FORMAT_PART_JOB:
+			format_log(ft, "found #(): %s", fp->s);
+			ft->unstable = 1;
+			if (ft->flags & FORMAT_NOJOBS) {
+				out = xstrdup("");
+				format_log(ft, "#() is disabled");
+			} else {
+				out = format_job_get(ft, fp->s);
+				format_log(ft, "#() result: %s", out);
+			}
+
+			outlen = strlen(out);
+			while (len - off < outlen + 1) {
+				buf = xreallocarray(buf, 2, len);
+				len *= 2;
+			}
+			memcpy(buf + off, out, outlen);
+			off += outlen;
+
+			free(out);
+			continue;
+		case FORMAT_PART_REPLACE:
+			format_log(ft, "found #{}: %.*s", (int)fp->n, fp->s);
+			if (format_replace(ft, fp->s, fp->n, &buf, &len,
+			    &off) != 0)
+				break;
+			continue;
+		case FORMAT_PART_STOP:
+			break;
+		}
 		break;
 	}
 	buf[off] = '\0';
 
+	if (!cached)
+		format_compiled_free(fc);
+
 	format_log(ft, "result is: %s", buf);
 	ft->loop--;
 
@@ -2499,9 +3082,24 @@ format_expand_time(struct format_tree *ft, const char *fmt)
 char *
 format_expand(struct format_tree *ft, const char *fmt)
 {
+	server_perf.format_expands++;
 	return (format_expand1(ft, fmt, 0));
 }
 
+/* Did the last expansion read anything unstable (time or #() jobs)? */
+int
+format_unstable(struct format_tree *ft)
+{
+	return (ft->unstable);
+}
+
+/* Did the last expansion read any client-specific variables? */
+int
+format_client_dependent(struct format_tree *ft)
+{
+	return (ft->clientdep);
+}
+
 /* Expand a single string. */
 char *
 format_single(struct cmdq_item *item, const char *fmt, struct client *c,
@@ -2628,6 +3226,7 @@ format_defaults_session(struct format_tree *ft, struct session *s)
 	format_add(ft, "session_name", "%s", s->name);
 	format_add(ft, "session_path", "%s", s->cwd);
 	format_add(ft, "session_windows", "%u", winlink_count(&s->windows));
+	format_add_cb(ft, "session_memory", format_cb_session_memory);
 	format_add(ft, "session_id", "$%u", s->id);
 
 	sg = session_group_contains(s);
@@ -2742,6 +3341,7 @@ format_defaults_window(struct format_tree *ft, struct window *w)
 	format_add(ft, "window_panes", "%u", window_count_panes(w));
 	format_add(ft, "window_zoomed_flag", "%d",
 	    !!(w->flags & WINDOW_ZOOMED));
+	format_add_cb(ft, "window_memory", format_cb_window_memory);
 }
 
 /* Set default format keys for a winlink. */
@@ -2823,6 +3423,7 @@ format_defaults_pane(struct format_tree *ft, struct window_pane *wp)
 	format_add(ft, "history_size", "%u", gd->hsize);
 	format_add(ft, "history_limit", "%u", gd->hlimit);
 	format_add_cb(ft, "history_bytes", format_cb_history_bytes);
+	format_add_cb(ft, "pane_memory", format_cb_pane_memory);
 
 	format_add(ft, "pane_written", "%zu", wp->written);
 	format_add(ft, "pane_skipped", "%zu", wp->skipped);
@@ -2840,6 +3441,7 @@ format_defaults_pane(struct format_tree *ft, struct window_pane *wp)
 	format_add(ft, "pane_active", "%d", wp == w->active);
 	format_add(ft, "pane_input_off", "%d", !!(wp->flags & PANE_INPUTOFF));
 	format_add(ft, "pane_pipe", "%d", wp->pipe_fd != -1);
+	format_add(ft, "pane_read_rate", "%zu", wp->read_rate);
 
 	if ((wp->flags & PANE_STATUSREADY) && WIFEXITED(status))
 		format_add(ft, "pane_dead_status", "%d", WEXITSTATUS(status));
@@ -18,8 +18,11 @@
 
 #include <sys/types.h>
 
+#include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "tmux.h"
 
@@ -37,17 +40,71 @@
 
 /* Default grid cell data. */
 const struct grid_cell grid_default_cell = {
-	{ { ' ' }, 0, 1, 1 }, 0, 0, 8, 8, 0
+	{ { ' ' }, 0, 1, 1 }, 0, 0, 8, 8, 0, 0
 };
 
 /* Cleared grid cell data. */
 const struct grid_cell grid_cleared_cell = {
-	{ { ' ' }, 0, 1, 1 }, 0, GRID_FLAG_CLEARED, 8, 8, 0
+	{ { ' ' }, 0, 1, 1 }, 0, GRID_FLAG_CLEARED, 8, 8, 0, 0
 };
 static const struct grid_cell_entry grid_cleared_entry = {
 	GRID_FLAG_CLEARED, { .data = { 0, 8, 8, ' ' } }
 };
 
+/*
+ * Pending incremental reflow. The lines below the stored position have been
+ * reflowed to the new width; those above are still wrapped at the old width
+ * and are reflowed a chunk at a time from a timer so that resizing a grid
+ * with a large history does not block the server. Unreflowed lines are still
+ * valid lines, they are just wrapped differently, so the grid may be read
+ * and written as normal while a reflow is pending.
+ */
+struct grid_reflow {
+	struct grid	*gd;
+	u_int		 sx;	/* new width */
+	u_int		 yy;	/* next line to reflow */
+	u_int		 left;	/* lines still to reflow */
+	struct event	 event;
+};
+#define GRID_REFLOW_CHUNK 1000
+
+static void	grid_reflow_cancel(struct grid *);
+
+/*
+ * Lines this far into the history are packed into a compact run-length
+ * encoding: most history is only ever touched again by copy mode search, so
+ * there is no point keeping a fully expanded cell array for every line. A
+ * packed line is expanded again (and stays expanded) the first time it is
+ * read or written.
+ */
+#define GRID_PACK_DEPTH 500
+
+/*
+ * Packed lines deeper than this are spilled to an unlinked temporary file,
+ * one per grid, created only once a grid actually has this much history.
+ * Spilled lines are read back the first time they are needed. The file is
+ * append-only; the space held by dead lines is reclaimed by rewriting the
+ * file when most of it is dead.
+ */
+#define GRID_SPILL_DEPTH 5000
+#define GRID_SPILL_COMPACT (16 * 1024 * 1024)
+
+static u_char	*grid_shared_put(u_char *, size_t);
+static void	grid_shared_ref(u_char *);
+static void	grid_shared_drop(u_char *);
+static void	grid_free_packed(struct grid_line *);
+static void	grid_reserve_lines(struct grid *, u_int);
+static void	grid_pack_line(struct grid_line *);
+static void	grid_unpack_line(struct grid *, struct grid_line *);
+static void	grid_spill_line(struct grid *, struct grid_line *);
+static void	grid_trisig_line(struct grid_line *);
+static void	grid_trisig_queue(struct grid *);
+
+static TAILQ_HEAD(, grid) grid_trisig_grids =
+    TAILQ_HEAD_INITIALIZER(grid_trisig_grids);
+static struct event	grid_trisig_event;
+#define GRID_TRISIG_LINES_PER_RUN 256
+
 /* Store cell in entry. */
 static void
 grid_store_cell(struct grid_cell_entry *gce, const struct grid_cell *gc,
@@ -82,9 +139,29 @@ grid_need_extended_cell(const struct grid_cell_entry *gce,
 		return (1);
 	if (gc->us != 0) /* only supports 256 or RGB */
 		return (1);
+	if (gc->link != 0)
+		return (1);
 	return (0);
 }
 
+/*
+ * Extended cell arrays are allocated with power-of-two capacity so that
+ * appending is amortized rather than a realloc per cell. The capacity is
+ * always derived from the size with grid_extended_alloc, so every place that
+ * allocates an array must size it the same way.
+ */
+static u_int
+grid_extended_alloc(u_int n)
+{
+	u_int	size = 1;
+
+	if (n == 0)
+		return (0);
+	while (size < n)
+		size <<= 1;
+	return (size);
+}
+
 /* Get an extended cell. */
 static void
 grid_get_extended_cell(struct grid_line *gl, struct grid_cell_entry *gce,
@@ -92,30 +169,89 @@ grid_get_extended_cell(struct grid_line *gl, struct grid_cell_entry *gce,
 {
 	u_int at = gl->extdsize + 1;
 
-	gl->extddata = xreallocarray(gl->extddata, at, sizeof *gl->extddata);
+	if (grid_extended_alloc(at) != grid_extended_alloc(gl->extdsize)) {
+		gl->extddata = xreallocarray(gl->extddata,
+		    grid_extended_alloc(at), sizeof *gl->extddata);
+	}
 	gl->extdsize = at;
 
 	gce->offset = at - 1;
 	gce->flags = (flags | GRID_FLAG_EXTENDED);
 }
 
-/* Set cell as extended. */
+/* Find an existing extended cell with the same contents. */
+static int
+grid_find_extended_cell(struct grid_line *gl, const struct grid_cell *gc,
+    u_int *at)
+{
+	u_int	i;
+
+	for (i = 0; i < gl->extdsize; i++) {
+		if (grid_cells_equal(&gl->extddata[i], gc) &&
+		    gl->extddata[i].us == gc->us) {
+			*at = i;
+			return (1);
+		}
+	}
+	return (0);
+}
+
+/* Is this entry's extended slot also referenced by another entry? */
+static int
+grid_extended_cell_shared(const struct grid_line *gl,
+    const struct grid_cell_entry *gce)
+{
+	const struct grid_cell_entry	*other;
+	u_int				 px;
+
+	for (px = 0; px < gl->cellsize; px++) {
+		other = &gl->celldata[px];
+		if (other != gce &&
+		    (other->flags & GRID_FLAG_EXTENDED) &&
+		    other->offset == gce->offset)
+			return (1);
+	}
+	return (0);
+}
+
+/*
+ * Set cell as extended. Identical extended cells are common - for example a
+ * whole line styled with one RGB colour - so share a single slot between them
+ * rather than appending a copy for each cell. Shared slots are never modified
+ * in place: changing a cell repoints its entry at a different slot, leaving
+ * other entries untouched. A slot referenced only by the entry being changed
+ * is overwritten in place, so a visible cell restyled over and over does not
+ * grow the array; slots orphaned despite this are reclaimed by
+ * grid_compact_line() when the line is scrolled into the history.
+ */
 static struct grid_cell *
 grid_extended_cell(struct grid_line *gl, struct grid_cell_entry *gce,
     const struct grid_cell *gc)
 {
 	struct grid_cell	*gcp;
+	struct grid_cell	 tmp;
+	u_int			 at;
 	int			 flags = (gc->flags & ~GRID_FLAG_CLEARED);
 
-	if (~gce->flags & GRID_FLAG_EXTENDED)
+	memcpy(&tmp, gc, sizeof tmp);
+	tmp.flags = flags;
+
+	if (grid_find_extended_cell(gl, &tmp, &at)) {
+		gce->offset = at;
+		gce->flags = (flags | GRID_FLAG_EXTENDED);
+	} else if ((gce->flags & GRID_FLAG_EXTENDED) &&
+	    gce->offset < gl->extdsize &&
+	    !grid_extended_cell_shared(gl, gce)) {
+		at = gce->offset;
+		gce->flags = (flags | GRID_FLAG_EXTENDED);
+	} else {
 		grid_get_extended_cell(gl, gce, flags);
-	else if (gce->offset >= gl->extdsize)
-		fatalx("offset too big");
+		at = gce->offset;
+	}
 	gl->flags |= GRID_LINE_EXTENDED;
 
-	gcp = &gl->extddata[gce->offset];
-	memcpy(gcp, gc, sizeof *gcp);
-	gcp->flags = flags;
+	gcp = &gl->extddata[at];
+	memcpy(gcp, &tmp, sizeof *gcp);
 	return (gcp);
 }
 
@@ -144,7 +280,8 @@ grid_compact_line(struct grid_line *gl)
 		gl->extdsize = 0;
 		return;
 	}
-	new_extddata = xreallocarray(NULL, new_extdsize, sizeof *gl->extddata);
+	new_extddata = xreallocarray(NULL, grid_extended_alloc(new_extdsize),
+	    sizeof *gl->extddata);
 
 	idx = 0;
 	for (px = 0; px < gl->cellsize; px++) {
@@ -161,10 +298,404 @@ grid_compact_line(struct grid_line *gl)
 	gl->extdsize = new_extdsize;
 }
 
+/*
+ * Content-addressed store for packed history lines. Workloads like CI logs
+ * produce many identical lines across panes and over time, so when the
+ * history-dedup option is on, identical packed blobs are shared through this
+ * refcounted server-wide table instead of each line keeping its own copy.
+ * Shared blobs are immutable; lines holding one have GRID_LINE_SHARED set
+ * and drop their reference instead of freeing.
+ */
+struct grid_shared {
+	u_char			*data;
+	size_t			 size;
+	uint64_t		 hash;
+	u_int			 references;
+
+	RB_ENTRY(grid_shared)	 by_content_entry;
+	RB_ENTRY(grid_shared)	 by_data_entry;
+};
+
+static int	grid_shared_cmp_content(struct grid_shared *,
+		    struct grid_shared *);
+static int	grid_shared_cmp_data(struct grid_shared *,
+		    struct grid_shared *);
+
+RB_HEAD(grid_shared_by_content, grid_shared);
+RB_GENERATE_STATIC(grid_shared_by_content, grid_shared, by_content_entry,
+    grid_shared_cmp_content);
+RB_HEAD(grid_shared_by_data, grid_shared);
+RB_GENERATE_STATIC(grid_shared_by_data, grid_shared, by_data_entry,
+    grid_shared_cmp_data);
+
+static struct grid_shared_by_content	grid_shared_by_content =
+    RB_INITIALIZER(&grid_shared_by_content);
+static struct grid_shared_by_data	grid_shared_by_data =
+    RB_INITIALIZER(&grid_shared_by_data);
+
+static int
+grid_shared_cmp_content(struct grid_shared *gs1, struct grid_shared *gs2)
+{
+	if (gs1->hash < gs2->hash)
+		return (-1);
+	if (gs1->hash > gs2->hash)
+		return (1);
+	if (gs1->size < gs2->size)
+		return (-1);
+	if (gs1->size > gs2->size)
+		return (1);
+	return (memcmp(gs1->data, gs2->data, gs1->size));
+}
+
+static int
+grid_shared_cmp_data(struct grid_shared *gs1, struct grid_shared *gs2)
+{
+	if (gs1->data < gs2->data)
+		return (-1);
+	if (gs1->data > gs2->data)
+		return (1);
+	return (0);
+}
+
+/* FNV-1a hash of a packed blob. */
+static uint64_t
+grid_shared_hash(const u_char *data, size_t size)
+{
+	uint64_t	hash = 0xcbf29ce484222325ULL;
+	size_t		i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return (hash);
+}
+
+/*
+ * Intern a packed blob, taking ownership of it. Returns the shared copy,
+ * which is the blob itself if it was not seen before.
+ */
+static u_char *
+grid_shared_put(u_char *data, size_t size)
+{
+	struct grid_shared	 find, *gs;
+
+	find.data = data;
+	find.size = size;
+	find.hash = grid_shared_hash(data, size);
+
+	gs = RB_FIND(grid_shared_by_content, &grid_shared_by_content, &find);
+	if (gs != NULL) {
+		gs->references++;
+		free(data);
+		return (gs->data);
+	}
+
+	gs = xmalloc(sizeof *gs);
+	gs->data = data;
+	gs->size = size;
+	gs->hash = find.hash;
+	gs->references = 1;
+
+	RB_INSERT(grid_shared_by_content, &grid_shared_by_content, gs);
+	RB_INSERT(grid_shared_by_data, &grid_shared_by_data, gs);
+	return (data);
+}
+
+/* Take another reference to a shared blob. */
+static void
+grid_shared_ref(u_char *data)
+{
+	struct grid_shared	 find, *gs;
+
+	find.data = data;
+	gs = RB_FIND(grid_shared_by_data, &grid_shared_by_data, &find);
+	if (gs == NULL)
+		fatalx("unknown shared line");
+	gs->references++;
+}
+
+/* Drop a reference to a shared blob, freeing it at zero. */
+static void
+grid_shared_drop(u_char *data)
+{
+	struct grid_shared	 find, *gs;
+
+	find.data = data;
+	gs = RB_FIND(grid_shared_by_data, &grid_shared_by_data, &find);
+	if (gs == NULL)
+		fatalx("unknown shared line");
+	if (--gs->references != 0)
+		return;
+	RB_REMOVE(grid_shared_by_content, &grid_shared_by_content, gs);
+	RB_REMOVE(grid_shared_by_data, &grid_shared_by_data, gs);
+	free(gs->data);
+	free(gs);
+}
+
+/* Free or unshare a line's packed data, whichever applies. */
+static void
+grid_free_packed(struct grid_line *gl)
+{
+	if (gl->flags & GRID_LINE_SHARED) {
+		grid_shared_drop(gl->packdata);
+		gl->flags &= ~GRID_LINE_SHARED;
+	} else
+		free(gl->packdata);
+	gl->packdata = NULL;
+}
+
+/*
+ * Pack a cold history line. Cells are stored as runs: a flags byte with
+ * GRID_FLAG_EXTENDED clear is followed by a count, the shared attr, fg and
+ * bg and then one character per cell; a flags byte with GRID_FLAG_EXTENDED
+ * set is followed by a count and then an entry flags byte and a full
+ * grid_cell for each cell.
+ */
+static void
+grid_pack_line(struct grid_line *gl)
+{
+	struct grid_cell_entry	*gce;
+	const struct grid_cell	*gc;
+	u_char			*out;
+	size_t			 size;
+	u_int			 px, i, n;
+
+	if (gl->flags & (GRID_LINE_PACKED|GRID_LINE_DEAD))
+		return;
+	if (gl->celldata == NULL || gl->cellsize == 0)
+		return;
+
+	/* Sign the line first so the index never needs to unpack it. */
+	if ((~gl->flags & GRID_LINE_TRISIG) &&
+	    options_get_number(global_options, "history-index"))
+		grid_trisig_line(gl);
+
+	/* First pass: work out the packed size. */
+	size = 0;
+	for (px = 0; px < gl->cellsize; px += n) {
+		gce = &gl->celldata[px];
+		if (gce->flags & GRID_FLAG_EXTENDED) {
+			for (n = 1; n < 255 && px + n < gl->cellsize; n++) {
+				if (~gl->celldata[px + n].flags &
+				    GRID_FLAG_EXTENDED)
+					break;
+			}
+			size += 2 + n * (1 + sizeof *gc);
+		} else {
+			for (n = 1; n < 255 && px + n < gl->cellsize; n++) {
+				if (gl->celldata[px + n].flags != gce->flags ||
+				    gl->celldata[px + n].data.attr !=
+				    gce->data.attr ||
+				    gl->celldata[px + n].data.fg !=
+				    gce->data.fg ||
+				    gl->celldata[px + n].data.bg !=
+				    gce->data.bg)
+					break;
+			}
+			size += 5 + n;
+		}
+	}
+
+	/* Second pass: write the runs out. */
+	gl->packdata = out = xmalloc(size);
+	for (px = 0; px < gl->cellsize; px += n) {
+		gce = &gl->celldata[px];
+		if (gce->flags & GRID_FLAG_EXTENDED) {
+			for (n = 1; n < 255 && px + n < gl->cellsize; n++) {
+				if (~gl->celldata[px + n].flags &
+				    GRID_FLAG_EXTENDED)
+					break;
+			}
+			*out++ = GRID_FLAG_EXTENDED;
+			*out++ = n;
+			for (i = 0; i < n; i++) {
+				gce = &gl->celldata[px + i];
+				if (gce->offset >= gl->extdsize)
+					gc = &grid_default_cell;
+				else
+					gc = &gl->extddata[gce->offset];
+				*out++ = gce->flags;
+				memcpy(out, gc, sizeof *gc);
+				out += sizeof *gc;
+			}
+		} else {
+			for (n = 1; n < 255 && px + n < gl->cellsize; n++) {
+				if (gl->celldata[px + n].flags != gce->flags ||
+				    gl->celldata[px + n].data.attr !=
+				    gce->data.attr ||
+				    gl->celldata[px + n].data.fg !=
+				    gce->data.fg ||
+				    gl->celldata[px + n].data.bg !=
+				    gce->data.bg)
+					break;
+			}
+			*out++ = gce->flags;
+			*out++ = n;
+			*out++ = gce->data.attr;
+			*out++ = gce->data.fg;
+			*out++ = gce->data.bg;
+			for (i = 0; i < n; i++)
+				*out++ = gl->celldata[px + i].data.data;
+		}
+	}
+	gl->packsize = size;
+
+	/* Share the blob with any identical lines if dedup is on. */
+	if (options_get_number(global_options, "history-dedup")) {
+		gl->packdata = grid_shared_put(gl->packdata, size);
+		gl->flags |= GRID_LINE_SHARED;
+	}
+
+	free(gl->celldata);
+	gl->celldata = NULL;
+	free(gl->extddata);
+	gl->extddata = NULL;
+	gl->extdsize = 0;
+	gl->flags |= GRID_LINE_PACKED;
+}
+
+/* Expand a packed line back into cell arrays. */
+static void
+grid_unpack_line(struct grid *gd, struct grid_line *gl)
+{
+	struct grid_cell_entry	*gce;
+	u_char			*in, flags, attr, fg, bg, eflags;
+	u_int			 px, i, n;
+
+	if (~gl->flags & GRID_LINE_PACKED)
+		return;
+
+	/* Read the packed data back from the spill file if necessary. */
+	if (gl->flags & GRID_LINE_SPILLED) {
+		gl->packdata = xmalloc(gl->packsize);
+		if (pread(gd->spillfd, gl->packdata, gl->packsize,
+		    gl->packoffset) != (ssize_t)gl->packsize)
+			fatal("pread failed");
+		gd->spilllive -= gl->packsize;
+		gl->flags &= ~GRID_LINE_SPILLED;
+	}
+
+	gl->celldata = xcalloc(gl->cellsize, sizeof *gl->celldata);
+	in = gl->packdata;
+	px = 0;
+	while (px < gl->cellsize) {
+		flags = *in++;
+		n = *in++;
+		if (flags & GRID_FLAG_EXTENDED) {
+			for (i = 0; i < n; i++, px++) {
+				eflags = *in++;
+				gce = &gl->celldata[px];
+				grid_get_extended_cell(gl, gce, eflags);
+				memcpy(&gl->extddata[gce->offset], in,
+				    sizeof *gl->extddata);
+				in += sizeof *gl->extddata;
+			}
+		} else {
+			attr = *in++;
+			fg = *in++;
+			bg = *in++;
+			for (i = 0; i < n; i++, px++) {
+				gce = &gl->celldata[px];
+				gce->flags = flags;
+				gce->data.attr = attr;
+				gce->data.fg = fg;
+				gce->data.bg = bg;
+				gce->data.data = *in++;
+			}
+		}
+	}
+
+	grid_free_packed(gl);
+	gl->packsize = 0;
+	gl->flags &= ~GRID_LINE_PACKED;
+}
+
+/* Rewrite the spill file to drop space held by dead lines. */
+static void
+grid_spill_compact(struct grid *gd)
+{
+	struct grid_line	*gl;
+	u_char			*buf;
+	u_int			 yy;
+	off_t			 size = 0;
+	FILE			*f;
+	int			 fd;
+
+	if ((f = tmpfile()) == NULL)
+		return;
+	fd = dup(fileno(f));
+	fclose(f);
+	if (fd == -1)
+		return;
+
+	for (yy = 0; yy < gd->hsize + gd->sy; yy++) {
+		gl = &gd->linedata[yy];
+		if (~gl->flags & GRID_LINE_SPILLED)
+			continue;
+		buf = xmalloc(gl->packsize);
+		if (pread(gd->spillfd, buf, gl->packsize,
+		    gl->packoffset) != (ssize_t)gl->packsize ||
+		    pwrite(fd, buf, gl->packsize, size) !=
+		    (ssize_t)gl->packsize) {
+			free(buf);
+			close(fd);
+			return;
+		}
+		free(buf);
+		gl->packoffset = size;
+		size += gl->packsize;
+	}
+
+	close(gd->spillfd);
+	gd->spillfd = fd;
+	gd->spillsize = size;
+	gd->spilllive = size;
+}
+
+/* Spill a packed line out to the grid's spill file. */
+static void
+grid_spill_line(struct grid *gd, struct grid_line *gl)
+{
+	FILE	*f;
+
+	if (gd->flags & GRID_SPILLFROZEN)
+		return;
+	if (gl->flags & (GRID_LINE_SPILLED|GRID_LINE_DEAD))
+		return;
+	if (~gl->flags & GRID_LINE_PACKED)
+		grid_pack_line(gl);
+	if (~gl->flags & GRID_LINE_PACKED)
+		return;
+
+	if (gd->spillfd == -1) {
+		if ((f = tmpfile()) == NULL)
+			return;
+		gd->spillfd = dup(fileno(f));
+		fclose(f);
+		if (gd->spillfd == -1)
+			return;
+	}
+	if (gd->spillsize > GRID_SPILL_COMPACT &&
+	    gd->spilllive < gd->spillsize / 4)
+		grid_spill_compact(gd);
+
+	if (pwrite(gd->spillfd, gl->packdata, gl->packsize,
+	    gd->spillsize) != (ssize_t)gl->packsize)
+		return;
+	gl->packoffset = gd->spillsize;
+	gd->spillsize += gl->packsize;
+	gd->spilllive += gl->packsize;
+
+	grid_free_packed(gl);
+	gl->flags |= GRID_LINE_SPILLED;
+}
+
 /* Get line data. */
 struct grid_line *
 grid_get_line(struct grid *gd, u_int line)
 {
+	grid_unpack_line(gd, &gd->linedata[line]);
 	return (&gd->linedata[line]);
 }
 
@@ -173,6 +704,22 @@ void
 grid_adjust_lines(struct grid *gd, u_int lines)
 {
 	gd->linedata = xreallocarray(gd->linedata, lines, sizeof *gd->linedata);
+	gd->lalloc = lines;
+}
+
+/*
+ * Make sure at least n line slots are allocated. Grown geometrically so a
+ * burst of scrolling costs one reallocation rather than one per line.
+ */
+static void
+grid_reserve_lines(struct grid *gd, u_int n)
+{
+	if (n <= gd->lalloc)
+		return;
+	if (n < gd->lalloc * 2)
+		n = gd->lalloc * 2;
+	gd->linedata = xreallocarray(gd->linedata, n, sizeof *gd->linedata);
+	gd->lalloc = n;
 }
 
 /* Copy default into a cell. */
@@ -219,6 +766,8 @@ grid_cells_look_equal(const struct grid_cell *gc1, const struct grid_cell *gc2)
 		return (0);
 	if (gc1->attr != gc2->attr || gc1->flags != gc2->flags)
 		return (0);
+	if (gc1->link != gc2->link)
+		return (0);
 	return (1);
 }
 
@@ -239,10 +788,16 @@ grid_cells_equal(const struct grid_cell *gc1, const struct grid_cell *gc2)
 static void
 grid_free_line(struct grid *gd, u_int py)
 {
+	if (gd->linedata[py].flags & GRID_LINE_SPILLED) {
+		gd->spilllive -= gd->linedata[py].packsize;
+		gd->linedata[py].flags &= ~GRID_LINE_SPILLED;
+	}
 	free(gd->linedata[py].celldata);
 	gd->linedata[py].celldata = NULL;
 	free(gd->linedata[py].extddata);
 	gd->linedata[py].extddata = NULL;
+	if (gd->linedata[py].packdata != NULL)
+		grid_free_packed(&gd->linedata[py]);
 }
 
 /* Free several lines. */
@@ -273,11 +828,17 @@ grid_create(u_int sx, u_int sy, u_int hlimit)
 	gd->hscrolled = 0;
 	gd->hsize = 0;
 	gd->hlimit = hlimit;
+	gd->reflow = NULL;
+	gd->images = NULL;
+	gd->spillfd = -1;
+	gd->spillsize = gd->spilllive = 0;
+	gd->trisig_queued = 0;
 
 	if (gd->sy != 0)
 		gd->linedata = xcalloc(gd->sy, sizeof *gd->linedata);
 	else
 		gd->linedata = NULL;
+	gd->lalloc = gd->sy;
 
 	return (gd);
 }
@@ -286,8 +847,18 @@ grid_create(u_int sx, u_int sy, u_int hlimit)
 void
 grid_destroy(struct grid *gd)
 {
+	grid_reflow_cancel(gd);
+
+	if (gd->trisig_queued)
+		TAILQ_REMOVE(&grid_trisig_grids, gd, trisig_entry);
+
+	image_free_all(gd);
+
 	grid_free_lines(gd, 0, gd->hsize + gd->sy);
 
+	if (gd->spillfd != -1)
+		close(gd->spillfd);
+
 	free(gd->linedata);
 
 	free(gd);
@@ -320,15 +891,217 @@ grid_compare(struct grid *ga, struct grid *gb)
 	return (0);
 }
 
+/*
+ * Lines trimmed from the history are not freed inline: trims fire while
+ * input is being processed and freeing thousands of cell arrays there shows
+ * up as a latency spike. The line structures are copied aside and their
+ * contents freed in batches from a timeout once the server is idle again.
+ */
+struct grid_defer_batch {
+	struct grid_line		*lines;
+	u_int				 count;
+	TAILQ_ENTRY(grid_defer_batch)	 entry;
+};
+static TAILQ_HEAD(, grid_defer_batch) grid_defer_batches =
+    TAILQ_HEAD_INITIALIZER(grid_defer_batches);
+static struct event	grid_defer_event;
+#define GRID_DEFER_BATCHES_PER_RUN 4
+
+/* Free deferred lines, a few batches at a time. */
+static void
+grid_defer_free_callback(__unused int fd, __unused short events,
+    __unused void *data)
+{
+	struct grid_defer_batch	*gdb;
+	struct timeval		 tv = { .tv_usec = 10000 };
+	u_int			 i, runs = 0;
+
+	while ((gdb = TAILQ_FIRST(&grid_defer_batches)) != NULL) {
+		if (runs++ == GRID_DEFER_BATCHES_PER_RUN) {
+			evtimer_add(&grid_defer_event, &tv);
+			return;
+		}
+		TAILQ_REMOVE(&grid_defer_batches, gdb, entry);
+
+		log_debug("%s: freeing %u lines", __func__, gdb->count);
+		for (i = 0; i < gdb->count; i++) {
+			free(gdb->lines[i].celldata);
+			free(gdb->lines[i].extddata);
+			if (gdb->lines[i].packdata != NULL)
+				grid_free_packed(&gdb->lines[i]);
+		}
+		free(gdb->lines);
+		free(gdb);
+	}
+}
+
 /* Trim lines from the history. */
 static void
 grid_trim_history(struct grid *gd, u_int ny)
 {
-	grid_free_lines(gd, 0, ny);
+	struct grid_defer_batch	*gdb;
+	struct timeval		 tv = { .tv_usec = 10000 };
+	u_int			 yy;
+
+	if (ny == 0)
+		return;
+
+	gdb = xmalloc(sizeof *gdb);
+	gdb->lines = xmalloc(ny * sizeof *gdb->lines);
+	memcpy(gdb->lines, &gd->linedata[0], ny * sizeof *gdb->lines);
+	gdb->count = ny;
+
+	/* Spill accounting belongs to the grid, so settle it now. */
+	for (yy = 0; yy < ny; yy++) {
+		if (gdb->lines[yy].flags & GRID_LINE_SPILLED) {
+			gd->spilllive -= gdb->lines[yy].packsize;
+			gdb->lines[yy].flags &= ~GRID_LINE_SPILLED;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&grid_defer_batches, gdb, entry);
+	if (!evtimer_initialized(&grid_defer_event))
+		evtimer_set(&grid_defer_event, grid_defer_free_callback, NULL);
+	if (!evtimer_pending(&grid_defer_event, NULL))
+		evtimer_add(&grid_defer_event, &tv);
+
 	memmove(&gd->linedata[0], &gd->linedata[ny],
 	    (gd->hsize + gd->sy - ny) * (sizeof *gd->linedata));
 }
 
+
+/*
+ * Optional trigram index over history lines (the history-index option). A
+ * line scrolled into the history gets a 64-bit signature with one bit set
+ * per trigram of its lowercased text; a search for a literal string can then
+ * skip lines whose signature is missing any of the query's trigrams without
+ * building the line text. Signatures are computed from a timeout once the
+ * server is idle, except for lines about to be packed, which are signed
+ * inline so they never need unpacking for it.
+ */
+/* Add one byte to a rolling trigram window, setting a bit when full. */
+static void
+grid_trisig_byte(u_char *win, u_int *n, u_char c, uint64_t *sig)
+{
+	uint64_t	h;
+
+	win[0] = win[1];
+	win[1] = win[2];
+	win[2] = tolower(c);
+	if (++(*n) < 3)
+		return;
+	h = 0xcbf29ce484222325ULL;
+	h = (h ^ win[0]) * 0x100000001b3ULL;
+	h = (h ^ win[1]) * 0x100000001b3ULL;
+	h = (h ^ win[2]) * 0x100000001b3ULL;
+	*sig |= 1ULL << (h & 63);
+}
+
+/* Build the signature of an unpacked line. */
+static void
+grid_trisig_line(struct grid_line *gl)
+{
+	struct grid_cell_entry	*gce;
+	struct grid_cell	*gc;
+	uint64_t		 sig = 0;
+	u_char			 win[3] = { 0 };
+	u_int			 px, i, n = 0;
+
+	for (px = 0; px < gl->cellused; px++) {
+		gce = &gl->celldata[px];
+		if (gce->flags & GRID_FLAG_EXTENDED) {
+			if (gce->offset >= gl->extdsize)
+				continue;
+			gc = &gl->extddata[gce->offset];
+			for (i = 0; i < gc->data.size; i++) {
+				grid_trisig_byte(win, &n, gc->data.data[i],
+				    &sig);
+			}
+		} else
+			grid_trisig_byte(win, &n, gce->data.data, &sig);
+	}
+	gl->trisig = sig;
+	gl->flags |= GRID_LINE_TRISIG;
+}
+
+/* Build the trigram mask of a query string. */
+uint64_t
+grid_trigram_mask(const char *s)
+{
+	uint64_t	 mask = 0;
+	u_char		 win[3] = { 0 };
+	u_int		 n = 0;
+
+	for (; *s != '\0'; s++)
+		grid_trisig_byte(win, &n, *s, &mask);
+	return (mask);
+}
+
+/* Could the line at py contain every trigram in mask? */
+int
+grid_line_may_contain(struct grid *gd, u_int py, uint64_t mask)
+{
+	struct grid_line	*gl = &gd->linedata[py];
+
+	if (gl->cellused == 0)
+		return (0);
+	if (mask == 0 || py >= gd->hsize || (~gl->flags & GRID_LINE_TRISIG))
+		return (1);
+	return ((gl->trisig & mask) == mask);
+}
+
+/* Sign pending history lines, a bounded batch per run. */
+static void
+grid_trisig_callback(__unused int fd, __unused short events,
+    __unused void *data)
+{
+	struct grid		*gd;
+	struct grid_line	*gl;
+	struct timeval		 tv = { .tv_usec = 10000 };
+	u_int			 py, done = 0;
+
+	while ((gd = TAILQ_FIRST(&grid_trisig_grids)) != NULL) {
+		for (py = gd->hsize; py > 0; py--) {
+			gl = &gd->linedata[py - 1];
+			if (gl->flags & (GRID_LINE_TRISIG|GRID_LINE_PACKED))
+				continue;
+			if (gl->celldata == NULL) {
+				gl->trisig = 0;
+				gl->flags |= GRID_LINE_TRISIG;
+				continue;
+			}
+			grid_trisig_line(gl);
+			if (++done == GRID_TRISIG_LINES_PER_RUN) {
+				log_debug("%s: signed %u lines", __func__,
+				    done);
+				evtimer_add(&grid_trisig_event, &tv);
+				return;
+			}
+		}
+		TAILQ_REMOVE(&grid_trisig_grids, gd, trisig_entry);
+		gd->trisig_queued = 0;
+	}
+	log_debug("%s: signed %u lines, queue empty", __func__, done);
+}
+
+/* Queue a grid for signing once the server is idle. */
+static void
+grid_trisig_queue(struct grid *gd)
+{
+	struct timeval	tv = { .tv_usec = 10000 };
+
+	if (!options_get_number(global_options, "history-index"))
+		return;
+	if (gd->trisig_queued)
+		return;
+	gd->trisig_queued = 1;
+	TAILQ_INSERT_TAIL(&grid_trisig_grids, gd, trisig_entry);
+	if (!evtimer_initialized(&grid_trisig_event))
+		evtimer_set(&grid_trisig_event, grid_trisig_callback, NULL);
+	if (!evtimer_pending(&grid_trisig_event, NULL))
+		evtimer_add(&grid_trisig_event, &tv);
+}
+
 /*
  * Collect lines from the history if at the limit. Free the top (oldest) 10%
  * and shift up.
@@ -347,6 +1120,12 @@ grid_collect_history(struct grid *gd)
 	if (ny > gd->hsize)
 		ny = gd->hsize;
 
+	/* The oldest lines are going away, so stop reflowing them. */
+	grid_reflow_cancel(gd);
+
+	/* Evict image placements anchored on the lines going away. */
+	image_trim(gd, ny);
+
 	/*
 	 * Free the lines from 0 to ny then move the remaining lines over
 	 * them.
@@ -366,6 +1145,9 @@ grid_remove_history(struct grid *gd, u_int ny)
 
 	if (ny > gd->hsize)
 		return;
+	if (gd->reflow != NULL &&
+	    gd->reflow->yy + gd->reflow->left > gd->hsize - ny)
+		grid_reflow_cancel(gd);
 	for (yy = 0; yy < ny; yy++)
 		grid_free_line(gd, gd->hsize + gd->sy - 1 - yy);
 	gd->hsize -= ny;
@@ -381,26 +1163,159 @@ grid_scroll_history(struct grid *gd, u_int bg)
 	u_int	yy;
 
 	yy = gd->hsize + gd->sy;
-	gd->linedata = xreallocarray(gd->linedata, yy + 1,
-	    sizeof *gd->linedata);
+	grid_reserve_lines(gd, yy + 1);
 	grid_empty_line(gd, yy, bg);
 
 	gd->hscrolled++;
 	grid_compact_line(&gd->linedata[gd->hsize]);
 	gd->hsize++;
+
+	/* Pack the line now falling past the hot depth. */
+	if (gd->hsize > GRID_PACK_DEPTH)
+		grid_pack_line(&gd->linedata[gd->hsize - 1 - GRID_PACK_DEPTH]);
+
+	/* And spill the line now falling past the spill depth. */
+	if (gd->hsize > GRID_SPILL_DEPTH) {
+		grid_spill_line(gd,
+		    &gd->linedata[gd->hsize - 1 - GRID_SPILL_DEPTH]);
+	}
+
+	grid_trisig_queue(gd);
+}
+
+/*
+ * Pack the whole history regardless of depth, for a pane that has been idle
+ * long enough to hibernate. Lines are unpacked again on first access so
+ * this is transparent.
+ */
+void
+grid_hibernate(struct grid *gd)
+{
+	u_int	py;
+
+	for (py = 0; py < gd->hsize; py++)
+		grid_pack_line(&gd->linedata[py]);
+}
+
+/*
+ * Spill the whole packed history to the spill file, when a memory budget
+ * demands it. Spilled lines are read back on first access so this is
+ * transparent, just slower than memory. Shared blobs stay: their cost is
+ * already split between every line referencing them.
+ */
+size_t
+grid_spill(struct grid *gd)
+{
+	struct grid_line	*gl;
+	size_t			 before, reclaimed = 0;
+	u_int			 py;
+
+	for (py = 0; py < gd->hsize; py++) {
+		gl = &gd->linedata[py];
+		if (~gl->flags & GRID_LINE_PACKED)
+			grid_pack_line(gl);
+		if (~gl->flags & GRID_LINE_PACKED)
+			continue;
+		if (gl->flags & GRID_LINE_SHARED)
+			continue;
+		before = gl->packsize;
+		grid_spill_line(gd, gl);
+		if (gl->flags & GRID_LINE_SPILLED)
+			reclaimed += before;
+	}
+	return (reclaimed);
+}
+
+/*
+ * Repack history lines that reads (copy mode, searches, capture-pane) have
+ * expanded back into cell arrays and left that way. Only lines below the
+ * pack depth are touched so recent history stays cheap to read. Returns the
+ * number of bytes reclaimed.
+ */
+size_t
+grid_compact(struct grid *gd)
+{
+	struct grid_line	*gl;
+	size_t			 reclaimed = 0, before;
+	u_int			 py;
+
+	if (gd->hsize <= GRID_PACK_DEPTH)
+		return (0);
+	for (py = 0; py < gd->hsize - GRID_PACK_DEPTH; py++) {
+		gl = &gd->linedata[py];
+		if (gl->flags & (GRID_LINE_PACKED|GRID_LINE_DEAD))
+			continue;
+		if (gl->celldata == NULL || gl->cellsize == 0)
+			continue;
+		before = gl->cellsize * sizeof *gl->celldata +
+		    gl->extdsize * sizeof *gl->extddata;
+		grid_pack_line(gl);
+		if ((gl->flags & GRID_LINE_PACKED) && before > gl->packsize)
+			reclaimed += before - gl->packsize;
+	}
+	return (reclaimed);
+}
+
+/*
+ * Approximate heap memory held by a grid: line headers, cell and extended
+ * arrays and packed blobs. A shared blob is divided between its references
+ * and spilled lines live on disk, so the total is what this grid alone
+ * keeps resident.
+ */
+size_t
+grid_memory(struct grid *gd)
+{
+	struct grid_line	*gl;
+	struct grid_shared	*gs, find;
+	size_t			 size;
+	u_int			 py;
+
+	size = gd->lalloc * sizeof *gd->linedata;
+	for (py = 0; py < gd->hsize + gd->sy; py++) {
+		gl = &gd->linedata[py];
+		if (gl->flags & (GRID_LINE_DEAD|GRID_LINE_SPILLED))
+			continue;
+		if (gl->flags & GRID_LINE_PACKED) {
+			if (gl->flags & GRID_LINE_SHARED) {
+				find.data = gl->packdata;
+				gs = RB_FIND(grid_shared_by_data,
+				    &grid_shared_by_data, &find);
+				if (gs != NULL && gs->references != 0)
+					size += gs->size / gs->references;
+			} else
+				size += gl->packsize;
+			continue;
+		}
+		size += gl->cellsize * sizeof *gl->celldata;
+		size += grid_extended_alloc(gl->extdsize) *
+		    sizeof *gl->extddata;
+	}
+	return (size);
 }
 
 /* Clear the history. */
 void
 grid_clear_history(struct grid *gd)
 {
+	grid_reflow_cancel(gd);
+
+	image_trim(gd, gd->hsize);
+
 	grid_trim_history(gd, gd->hsize);
 
+	if (gd->spillfd != -1) {
+		close(gd->spillfd);
+		gd->spillfd = -1;
+		gd->spillsize = gd->spilllive = 0;
+		gd->flags &= ~GRID_SPILLFROZEN;
+	}
+
 	gd->hscrolled = 0;
 	gd->hsize = 0;
 
 	gd->linedata = xreallocarray(gd->linedata, gd->sy,
 	    sizeof *gd->linedata);
+	gd->lalloc = gd->sy;
 }
 
 /* Scroll a region up, moving the top line into the history. */
@@ -412,8 +1327,7 @@ grid_scroll_history_region(struct grid *gd, u_int upper, u_int lower, u_int bg)
 
 	/* Create a space for a new line. */
 	yy = gd->hsize + gd->sy;
-	gd->linedata = xreallocarray(gd->linedata, yy + 1,
-	    sizeof *gd->linedata);
+	grid_reserve_lines(gd, yy + 1);
 
 	/* Move the entire screen down to free a space for this line. */
 	gl_history = &gd->linedata[gd->hsize];
@@ -444,6 +1358,8 @@ grid_expand_line(struct grid *gd, u_int py, u_int sx, u_int bg)
 	u_int			 xx;
 
 	gl = &gd->linedata[py];
+	grid_unpack_line(gd, gl);
+	gl->flags &= ~GRID_LINE_TRISIG;
 	if (sx <= gl->cellsize)
 		return;
 
@@ -475,14 +1391,19 @@ grid_peek_line(struct grid *gd, u_int py)
 {
 	if (grid_check_y(gd, __func__, py) != 0)
 		return (NULL);
+	grid_unpack_line(gd, &gd->linedata[py]);
 	return (&gd->linedata[py]);
 }
 
 /* Get cell from line. */
 static void
-grid_get_cell1(struct grid_line *gl, u_int px, struct grid_cell *gc)
+grid_get_cell1(struct grid *gd, struct grid_line *gl, u_int px,
+    struct grid_cell *gc)
 {
-	struct grid_cell_entry	*gce = &gl->celldata[px];
+	struct grid_cell_entry	*gce;
+
+	grid_unpack_line(gd, gl);
+	gce = &gl->celldata[px];
 
 	if (gce->flags & GRID_FLAG_EXTENDED) {
 		if (gce->offset >= gl->extdsize)
@@ -501,6 +1422,7 @@ grid_get_cell1(struct grid_line *gl, u_int px, struct grid_cell *gc)
 	if (gce->flags & GRID_FLAG_BG256)
 		gc->bg |= COLOUR_FLAG_256;
 	gc->us = 0;
+	gc->link = 0;
 	utf8_set(&gc->data, gce->data.data);
 }
 
@@ -512,7 +1434,27 @@ grid_get_cell(struct grid *gd, u_int px, u_int py, struct grid_cell *gc)
 	    px >= gd->linedata[py].cellsize)
 		memcpy(gc, &grid_default_cell, sizeof *gc);
 	else
-		grid_get_cell1(&gd->linedata[py], px, gc);
+		grid_get_cell1(gd, &gd->linedata[py], px, gc);
+}
+
+/*
+ * Get a cell from a line the caller has already validated, either with
+ * grid_peek_line or by bounding the loop with the line's cellsize. The
+ * per-cell size check is kept by default but compiled out when built with
+ * --enable-unchecked-grid, where the audited callers guarantee px is inside
+ * the line.
+ */
+void
+grid_get_line_cell(struct grid *gd, const struct grid_line *gl, u_int px,
+    struct grid_cell *gc)
+{
+#ifndef GRID_UNCHECKED
+	if (px >= gl->cellsize) {
+		memcpy(gc, &grid_default_cell, sizeof *gc);
+		return;
+	}
+#endif
+	grid_get_cell1(gd, (struct grid_line *)gl, px, gc);
 }
 
 /* Set cell at relative position. */
@@ -544,8 +1486,8 @@ grid_set_cells(struct grid *gd, u_int px, u_int py, const struct grid_cell *gc,
     const char *s, size_t slen)
 {
 	struct grid_line	*gl;
-	struct grid_cell_entry	*gce;
-	struct grid_cell	*gcp;
+	struct grid_cell_entry	*gce, tmpl;
+	struct grid_cell	 tmp;
 	u_int			 i;
 
 	if (grid_check_y(gd, __func__, py) != 0)
@@ -557,11 +1499,35 @@ grid_set_cells(struct grid *gd, u_int px, u_int py, const struct grid_cell *gc,
 	if (px + slen > gl->cellused)
 		gl->cellused = px + slen;
 
+	/*
+	 * The whole run shares one style, so whether it needs extended cells
+	 * and the entry layout can be decided once rather than per cell. Only
+	 * entries already marked extended still go through the slow path, to
+	 * keep their slot bookkeeping intact.
+	 */
+	memset(&tmpl, 0, sizeof tmpl);
+	if (!grid_need_extended_cell(&tmpl, gc)) {
+		grid_store_cell(&tmpl, gc, ' ');
+		for (i = 0; i < slen; i++) {
+			gce = &gl->celldata[px + i];
+			if (gce->flags & GRID_FLAG_EXTENDED) {
+				memcpy(&tmp, gc, sizeof tmp);
+				utf8_set(&tmp.data, s[i]);
+				grid_extended_cell(gl, gce, &tmp);
+			} else {
+				memcpy(gce, &tmpl, sizeof *gce);
+				gce->data.data = s[i];
+			}
+		}
+		return;
+	}
+
 	for (i = 0; i < slen; i++) {
 		gce = &gl->celldata[px + i];
 		if (grid_need_extended_cell(gce, gc)) {
-			gcp = grid_extended_cell(gl, gce, gc);
-			utf8_set(&gcp->data, s[i]);
+			memcpy(&tmp, gc, sizeof tmp);
+			utf8_set(&tmp.data, s[i]);
+			grid_extended_cell(gl, gce, &tmp);
 		} else
 			grid_store_cell(gce, gc, s[i]);
 	}
@@ -793,17 +1759,13 @@ grid_string_cells_bg(const struct grid_cell *gc, int *values)
 	return (n);
 }
 
-/*
- * Returns ANSI code to set particular attributes (colour, bold and so on)
- * given a current state.
- */
-static void
-grid_string_cells_code(const struct grid_cell *lastgc,
-    const struct grid_cell *gc, char *buf, size_t len, int escape_c0)
+/* Build the SGR string for an attribute transition. Returns 1 if it resets. */
+static int
+grid_string_cells_attrs(u_int lastattr, u_int attr, int escape_c0, char *buf,
+    size_t len)
 {
-	int	oldc[64], newc[64], s[128];
-	size_t	noldc, nnewc, n, i;
-	u_int	attr = gc->attr, lastattr = lastgc->attr;
+	int	s[128], reset = 0;
+	size_t	n, i;
 	char	tmp[64];
 
 	struct {
@@ -830,6 +1792,7 @@ grid_string_cells_code(const struct grid_cell *lastgc,
 	for (i = 0; i < nitems(attrs); i++) {
 		if (!(attr & attrs[i].mask) && (lastattr & attrs[i].mask)) {
 			s[n++] = 0;
+			reset = 1;
 			lastattr &= GRID_ATTR_CHARSET;
 			break;
 		}
@@ -860,13 +1823,65 @@ grid_string_cells_code(const struct grid_cell *lastgc,
 		}
 		strlcat(buf, "m", len);
 	}
+	return (reset);
+}
+
+/*
+ * Attribute transitions come from a small working set - status lines and
+ * coloured panes replay the same few deltas continuously - so keep the built
+ * SGR strings for the pairs seen rather than reassembling them every run.
+ */
+static int
+grid_string_cells_attrs_cached(u_int lastattr, u_int attr, int escape_c0,
+    char *buf, size_t len)
+{
+	static struct {
+		u_int	lastattr;
+		u_int	attr;
+		int	escape_c0;
+		int	used;
+		int	reset;
+		char	buf[128];
+	} cache[64], *entry;
+
+	entry = &cache[(lastattr ^ (attr * 3) ^ (u_int)escape_c0) & 63];
+	if (!entry->used ||
+	    entry->lastattr != lastattr ||
+	    entry->attr != attr ||
+	    entry->escape_c0 != escape_c0) {
+		entry->lastattr = lastattr;
+		entry->attr = attr;
+		entry->escape_c0 = escape_c0;
+		entry->used = 1;
+		entry->reset = grid_string_cells_attrs(lastattr, attr,
+		    escape_c0, entry->buf, sizeof entry->buf);
+	}
+	strlcpy(buf, entry->buf, len);
+	return (entry->reset);
+}
+
+/*
+ * Returns ANSI code to set particular attributes (colour, bold and so on)
+ * given a current state.
+ */
+static void
+grid_string_cells_code(const struct grid_cell *lastgc,
+    const struct grid_cell *gc, char *buf, size_t len, int escape_c0)
+{
+	int	oldc[64], newc[64], reset;
+	size_t	noldc, nnewc, i;
+	u_int	attr = gc->attr, lastattr = lastgc->attr;
+	char	tmp[64];
+
+	reset = grid_string_cells_attrs_cached(lastattr, attr, escape_c0, buf,
+	    len);
 
 	/* If the foreground colour changed, write its parameters. */
 	nnewc = grid_string_cells_fg(gc, newc);
 	noldc = grid_string_cells_fg(lastgc, oldc);
 	if (nnewc != noldc ||
 	    memcmp(newc, oldc, nnewc * sizeof newc[0]) != 0 ||
-	    (n != 0 && s[0] == 0)) {
+	    reset) {
 		if (escape_c0)
 			strlcat(buf, "\\033[", len);
 		else
@@ -886,7 +1901,7 @@ grid_string_cells_code(const struct grid_cell *lastgc,
 	noldc = grid_string_cells_bg(lastgc, oldc);
 	if (nnewc != noldc ||
 	    memcmp(newc, oldc, nnewc * sizeof newc[0]) != 0 ||
-	    (n != 0 && s[0] == 0)) {
+	    reset) {
 		if (escape_c0)
 			strlcat(buf, "\\033[", len);
 		else
@@ -942,7 +1957,7 @@ grid_string_cells(struct grid *gd, u_int px, u_int py, u_int nx,
 	for (xx = px; xx < px + nx; xx++) {
 		if (gl == NULL || xx >= gl->cellsize)
 			break;
-		grid_get_cell(gd, xx, py, &gc);
+		grid_get_line_cell(gd, gl, xx, &gc);
 		if (gc.flags & GRID_FLAG_PADDING)
 			continue;
 
@@ -983,6 +1998,37 @@ grid_string_cells(struct grid *gd, u_int px, u_int py, u_int nx,
 	return (buf);
 }
 
+/*
+ * Copy a run of cells between two lines with a single memcpy. Fails (returns
+ * -1) if the run needs per-cell handling: packed or spilled source lines, or
+ * extended cells, which reference their line's extended array by offset.
+ */
+int
+grid_copy_cells(struct grid *dst, u_int dx, u_int dy, struct grid *src,
+    u_int px, u_int py, u_int nx)
+{
+	struct grid_line	*srcl, *dstl;
+	u_int			 xx;
+
+	srcl = &src->linedata[py];
+	if (srcl->flags & (GRID_LINE_PACKED|GRID_LINE_SPILLED))
+		return (-1);
+	if (nx == 0 || srcl->celldata == NULL || srcl->cellsize < px + nx)
+		return (-1);
+	for (xx = px; xx < px + nx; xx++) {
+		if (srcl->celldata[xx].flags & GRID_FLAG_EXTENDED)
+			return (-1);
+	}
+
+	grid_expand_line(dst, dy, dx + nx, 8);
+	dstl = &dst->linedata[dy];
+	memcpy(&dstl->celldata[dx], &srcl->celldata[px],
+	    nx * sizeof *dstl->celldata);
+	if (dstl->cellused < dx + nx)
+		dstl->cellused = dx + nx;
+	return (0);
+}
+
 /*
  * Duplicate a set of lines between two grids. Both source and destination
  * should be big enough.
@@ -1005,7 +2051,22 @@ grid_duplicate_lines(struct grid *dst, u_int dy, struct grid *src, u_int sy,
 		dstl = &dst->linedata[dy];
 
 		memcpy(dstl, srcl, sizeof *dstl);
-		if (srcl->cellsize != 0) {
+		if (srcl->flags & GRID_LINE_SPILLED) {
+			dstl->packdata = xmalloc(srcl->packsize);
+			if (pread(src->spillfd, dstl->packdata, srcl->packsize,
+			    srcl->packoffset) != (ssize_t)srcl->packsize)
+				fatal("pread failed");
+			dstl->flags &= ~GRID_LINE_SPILLED;
+		} else if (srcl->flags & GRID_LINE_PACKED) {
+			if (srcl->flags & GRID_LINE_SHARED) {
+				grid_shared_ref(srcl->packdata);
+				dstl->packdata = srcl->packdata;
+			} else {
+				dstl->packdata = xmalloc(srcl->packsize);
+				memcpy(dstl->packdata, srcl->packdata,
+				    srcl->packsize);
+			}
+		} else if (srcl->cellsize != 0) {
 			dstl->celldata = xreallocarray(NULL,
 			    srcl->cellsize, sizeof *dstl->celldata);
 			memcpy(dstl->celldata, srcl->celldata,
@@ -1015,7 +2076,8 @@ grid_duplicate_lines(struct grid *dst, u_int dy, struct grid *src, u_int sy,
 
 		if (srcl->extdsize != 0) {
 			dstl->extdsize = srcl->extdsize;
-			dstl->extddata = xreallocarray(NULL, dstl->extdsize,
+			dstl->extddata = xreallocarray(NULL,
+			    grid_extended_alloc(dstl->extdsize),
 			    sizeof *dstl->extddata);
 			memcpy(dstl->extddata, srcl->extddata, dstl->extdsize *
 			    sizeof *dstl->extddata);
@@ -1026,6 +2088,85 @@ grid_duplicate_lines(struct grid *dst, u_int dy, struct grid *src, u_int sy,
 	}
 }
 
+/*
+ * Copy-on-write version of grid_duplicate_lines. Each source line is packed
+ * if it is still held as a cell array and its packed blob is then shared
+ * with the destination through the shared blob store; lines spilled to the
+ * source's spill file are shared by duplicating the descriptor. A write to
+ * either grid expands the shared blob back into a private cell array, so
+ * neither side can see the other's changes. The destination must not have a
+ * spill file of its own.
+ */
+void
+grid_snapshot_lines(struct grid *dst, u_int dy, struct grid *src, u_int sy,
+    u_int ny)
+{
+	struct grid_line	*dstl, *srcl;
+	u_int			 yy;
+
+	if (dy + ny > dst->hsize + dst->sy)
+		ny = dst->hsize + dst->sy - dy;
+	if (sy + ny > src->hsize + src->sy)
+		ny = src->hsize + src->sy - sy;
+	grid_free_lines(dst, dy, ny);
+
+	for (yy = 0; yy < ny; yy++) {
+		srcl = &src->linedata[sy];
+		dstl = &dst->linedata[dy];
+
+		grid_pack_line(srcl);
+		memcpy(dstl, srcl, sizeof *dstl);
+		if (srcl->flags & GRID_LINE_SPILLED) {
+			if (dst->spillfd == -1) {
+				dst->spillfd = dup(src->spillfd);
+				if (dst->spillfd != -1) {
+					dst->spillsize = src->spillsize;
+					dst->spilllive = src->spilllive;
+					dst->flags |= GRID_SPILLFROZEN;
+				}
+			}
+			if (dst->spillfd == -1) {
+				/* No descriptor to share, take a copy. */
+				dstl->packdata = xmalloc(srcl->packsize);
+				if (pread(src->spillfd, dstl->packdata,
+				    srcl->packsize, srcl->packoffset) !=
+				    (ssize_t)srcl->packsize)
+					fatal("pread failed");
+				dstl->flags &= ~GRID_LINE_SPILLED;
+			}
+		} else if (srcl->flags & GRID_LINE_PACKED) {
+			if (~srcl->flags & GRID_LINE_SHARED) {
+				srcl->packdata = grid_shared_put(
+				    srcl->packdata, srcl->packsize);
+				srcl->flags |= GRID_LINE_SHARED;
+				dstl->flags |= GRID_LINE_SHARED;
+			}
+			grid_shared_ref(srcl->packdata);
+			dstl->packdata = srcl->packdata;
+		} else if (srcl->cellsize != 0) {
+			/* The line could not be packed, take a copy. */
+			dstl->celldata = xreallocarray(NULL,
+			    srcl->cellsize, sizeof *dstl->celldata);
+			memcpy(dstl->celldata, srcl->celldata,
+			    srcl->cellsize * sizeof *dstl->celldata);
+			if (srcl->extdsize != 0) {
+				dstl->extddata = xreallocarray(NULL,
+				    grid_extended_alloc(dstl->extdsize),
+				    sizeof *dstl->extddata);
+				memcpy(dstl->extddata, srcl->extddata,
+				    srcl->extdsize * sizeof *dstl->extddata);
+			} else
+				dstl->extddata = NULL;
+		} else {
+			dstl->celldata = NULL;
+			dstl->extddata = NULL;
+		}
+
+		sy++;
+		dy++;
+	}
+}
+
 /* Mark line as dead. */
 static void
 grid_reflow_dead(struct grid_line *gl)
@@ -1041,7 +2182,7 @@ grid_reflow_add(struct grid *gd, u_int n)
 	struct grid_line	*gl;
 	u_int			 sy = gd->sy + n;
 
-	gd->linedata = xreallocarray(gd->linedata, sy, sizeof *gd->linedata);
+	grid_reserve_lines(gd, sy);
 	gl = &gd->linedata[gd->sy];
 	memset(gl, 0, n * (sizeof *gl));
 	gd->sy = sy;
@@ -1060,10 +2201,14 @@ grid_reflow_move(struct grid *gd, struct grid_line *from)
 	return (to);
 }
 
+static u_int	grid_reflow_range(struct grid *, struct grid *, u_int, u_int,
+		    u_int);
+static void	grid_reflow_splice(struct grid *, struct grid *, u_int, u_int);
+
 /* Join line below onto this one. */
 static void
 grid_reflow_join(struct grid *target, struct grid *gd, u_int sx, u_int yy,
-    u_int width, int already)
+    u_int offset, u_int width, int already)
 {
 	struct grid_line	*gl, *from = NULL;
 	struct grid_cell	 gc;
@@ -1111,7 +2256,7 @@ grid_reflow_join(struct grid *target, struct grid *gd, u_int sx, u_int yy,
 		 * separately because we need to leave "from" set to the last
 		 * line if this line is full.
 		 */
-		grid_get_cell1(&gd->linedata[line], 0, &gc);
+		grid_get_cell1(gd, &gd->linedata[line], 0, &gc);
 		if (width + gc.data.width > sx)
 			break;
 		width += gc.data.width;
@@ -1121,7 +2266,7 @@ grid_reflow_join(struct grid *target, struct grid *gd, u_int sx, u_int yy,
 		/* Join as much more as possible onto the current line. */
 		from = &gd->linedata[line];
 		for (want = 1; want < from->cellused; want++) {
-			grid_get_cell1(from, want, &gc);
+			grid_get_cell1(gd, from, want, &gc);
 			if (width + gc.data.width > sx)
 				break;
 			width += gc.data.width;
@@ -1162,16 +2307,16 @@ grid_reflow_join(struct grid *target, struct grid *gd, u_int sx, u_int yy,
 	}
 
 	/* Adjust scroll position. */
-	if (gd->hscrolled > to + lines)
+	if (gd->hscrolled > offset + to + lines)
 		gd->hscrolled -= lines;
-	else if (gd->hscrolled > to)
-		gd->hscrolled = to;
+	else if (gd->hscrolled > offset + to)
+		gd->hscrolled = offset + to;
 }
 
 /* Split this line into several new ones */
 static void
 grid_reflow_split(struct grid *target, struct grid *gd, u_int sx, u_int yy,
-    u_int at)
+    u_int offset, u_int at)
 {
 	struct grid_line	*gl = &gd->linedata[yy], *first;
 	struct grid_cell	 gc;
@@ -1186,7 +2331,7 @@ grid_reflow_split(struct grid *target, struct grid *gd, u_int sx, u_int yy,
 		lines = 2;
 		width = 0;
 		for (i = at; i < used; i++) {
-			grid_get_cell1(gl, i, &gc);
+			grid_get_cell1(gd, gl, i, &gc);
 			if (width + gc.data.width > sx) {
 				lines++;
 				width = 0;
@@ -1203,7 +2348,7 @@ grid_reflow_split(struct grid *target, struct grid *gd, u_int sx, u_int yy,
 	width = 0;
 	xx = 0;
 	for (i = at; i < used; i++) {
-		grid_get_cell1(gl, i, &gc);
+		grid_get_cell1(gd, gl, i, &gc);
 		if (width + gc.data.width > sx) {
 			target->linedata[line].flags |= GRID_LINE_WRAPPED;
 
@@ -1233,31 +2378,29 @@ grid_reflow_split(struct grid *target, struct grid *gd, u_int sx, u_int yy,
 	 * in the last new line, try to join with the next lines.
 	 */
 	if (width < sx && (flags & GRID_LINE_WRAPPED))
-		grid_reflow_join(target, gd, sx, yy, width, 1);
+		grid_reflow_join(target, gd, sx, yy, offset, width, 1);
 }
 
-/* Reflow lines on grid to new width. */
-void
-grid_reflow(struct grid *gd, u_int sx)
+/*
+ * Reflow a range of source lines into the target grid. Processing may run
+ * past the to line if a join consumes lines beyond it; the index of the first
+ * unprocessed line is returned. from is also where the first target line will
+ * end up in the final grid, for scroll position adjustment.
+ */
+static u_int
+grid_reflow_range(struct grid *gd, struct grid *target, u_int sx, u_int from,
+    u_int to)
 {
-	struct grid		*target;
 	struct grid_line	*gl;
 	struct grid_cell	 gc;
 	u_int			 yy, width, i, at, first;
 
-	/*
-	 * Create a destination grid. This is just used as a container for the
-	 * line data and may not be fully valid.
-	 */
-	target = grid_create(gd->sx, 0, 0);
-
-	/*
-	 * Loop over each source line.
-	 */
-	for (yy = 0; yy < gd->hsize + gd->sy; yy++) {
+	for (yy = from; yy < gd->hsize + gd->sy; yy++) {
 		gl = &gd->linedata[yy];
 		if (gl->flags & GRID_LINE_DEAD)
 			continue;
+		if (yy >= to)
+			break;
 
 		/*
 		 * Work out the width of this line. first is the width of the
@@ -1274,7 +2417,7 @@ grid_reflow(struct grid *gd, u_int sx)
 				at = width;
 		} else {
 			for (i = 0; i < gl->cellused; i++) {
-				grid_get_cell1(gl, i, &gc);
+				grid_get_cell1(gd, gl, i, &gc);
 				if (i == 0)
 					first = gc.data.width;
 				if (at == 0 && width + gc.data.width > sx)
@@ -1297,7 +2440,7 @@ grid_reflow(struct grid *gd, u_int sx)
 		 * it was previously wrapped.
 		 */
 		if (width > sx) {
-			grid_reflow_split(target, gd, sx, yy, at);
+			grid_reflow_split(target, gd, sx, yy, from, at);
 			continue;
 		}
 
@@ -1306,22 +2449,162 @@ grid_reflow(struct grid *gd, u_int sx)
 		 * of the next line.
 		 */
 		if (gl->flags & GRID_LINE_WRAPPED)
-			grid_reflow_join(target, gd, sx, yy, width, 0);
+			grid_reflow_join(target, gd, sx, yy, from, width, 0);
 		else
 			grid_reflow_move(target, gl);
 	}
+	return (yy);
+}
 
-	/*
-	 * Replace the old grid with the new.
-	 */
-	if (target->sy < gd->sy)
-		grid_reflow_add(target, gd->sy - target->sy);
-	gd->hsize = target->sy - gd->sy;
+/* Replace the source lines from from to next with the reflowed target. */
+static void
+grid_reflow_splice(struct grid *gd, struct grid *target, u_int from,
+    u_int next)
+{
+	struct grid_line	*linedata;
+	u_int			 total, size;
+
+	total = gd->hsize + gd->sy;
+
+	/* If the whole tail was consumed, pad the grid back to at least sy. */
+	size = from + target->sy + (total - next);
+	if (size < gd->sy)
+		grid_reflow_add(target, gd->sy - size);
+	size = from + target->sy + (total - next);
+
+	linedata = xreallocarray(NULL, size, sizeof *linedata);
+	memcpy(linedata, gd->linedata, from * sizeof *linedata);
+	memcpy(linedata + from, target->linedata,
+	    target->sy * sizeof *linedata);
+	memcpy(linedata + from + target->sy, gd->linedata + next,
+	    (total - next) * sizeof *linedata);
+	free(gd->linedata);
+	gd->linedata = linedata;
+	gd->lalloc = size;
+
+	gd->hsize = size - gd->sy;
 	if (gd->hscrolled > gd->hsize)
 		gd->hscrolled = gd->hsize;
-	free(gd->linedata);
-	gd->linedata = target->linedata;
+}
+
+/* Cancel a pending incremental reflow, leaving remaining lines as-is. */
+static void
+grid_reflow_cancel(struct grid *gd)
+{
+	if (gd->reflow == NULL)
+		return;
+	evtimer_del(&gd->reflow->event);
+	free(gd->reflow);
+	gd->reflow = NULL;
+}
+
+/* Reflow the next chunk of history for a pending reflow. */
+static void
+grid_reflow_timer(__unused int fd, __unused short events, void *data)
+{
+	struct grid_reflow	*gr = data;
+	struct grid		*gd = gr->gd;
+	struct grid		*target;
+	struct timeval		 tv = { .tv_usec = 10000 };
+	u_int			 to, next;
+
+	to = gr->yy + GRID_REFLOW_CHUNK;
+	if (to > gr->yy + gr->left)
+		to = gr->yy + gr->left;
+
+	target = grid_create(gd->sx, 0, 0);
+	next = grid_reflow_range(gd, target, gr->sx, gr->yy, to);
+	gr->left -= next - gr->yy;
+	grid_reflow_splice(gd, target, gr->yy, next);
+	gr->yy += target->sy;
+	free(target);
+
+	if (gr->left == 0)
+		grid_reflow_cancel(gd);
+	else
+		evtimer_add(&gr->event, &tv);
+}
+
+/*
+ * Reflow lines on grid to new width. The visible lines and any wrapped line
+ * immediately above them are reflowed at once so the screen and cursor are
+ * correct; older history is reflowed in the background a chunk at a time.
+ */
+void
+grid_reflow(struct grid *gd, u_int sx)
+{
+	struct grid		*target;
+	struct grid_reflow	*gr;
+	struct timeval		 tv = { .tv_usec = 10000 };
+	u_int			 from, next, to;
+
+	server_perf.grid_reflows++;
+
+	grid_reflow_cancel(gd);
+
+	/*
+	 * Find the first line of the unwrapped line which extends into the
+	 * visible area; lines from there down must be reflowed now.
+	 */
+	from = gd->hsize;
+	while (from != 0 &&
+	    (gd->linedata[from - 1].flags & GRID_LINE_WRAPPED))
+		from--;
+
+	/*
+	 * Create a destination grid. This is just used as a container for the
+	 * line data and may not be fully valid.
+	 */
+	target = grid_create(gd->sx, 0, 0);
+	next = grid_reflow_range(gd, target, sx, from, gd->hsize + gd->sy);
+	grid_reflow_splice(gd, target, from, next);
 	free(target);
+
+	/*
+	 * If the tail shrank - fragments join when the grid is widened - part
+	 * of the old history is now visible at the old width. Reflow it too,
+	 * repeating if that pulls yet more history into view, so the visible
+	 * area always matches what a full reflow would have produced. Each
+	 * region starts and ends on an unwrapped line so joins never cross a
+	 * region boundary and the pieces concatenate to the full result.
+	 */
+	while (from > gd->hsize) {
+		to = from;
+		from = gd->hsize;
+		while (from != 0 &&
+		    (gd->linedata[from - 1].flags & GRID_LINE_WRAPPED))
+			from--;
+		target = grid_create(gd->sx, 0, 0);
+		next = grid_reflow_range(gd, target, sx, from, to);
+		grid_reflow_splice(gd, target, from, next);
+		free(target);
+	}
+	if (from == 0)
+		return;
+
+	/*
+	 * Finish a small remainder now. The timer would do it in a single
+	 * chunk anyway, and a pending reflow may be cancelled part way by a
+	 * structural change, which would leave the history wrapped at the old
+	 * width for good.
+	 */
+	if (from <= GRID_REFLOW_CHUNK) {
+		target = grid_create(gd->sx, 0, 0);
+		next = grid_reflow_range(gd, target, sx, 0, from);
+		grid_reflow_splice(gd, target, 0, next);
+		free(target);
+		return;
+	}
+
+	/* Leave the rest of the history to be reflowed from a timer. */
+	gr = xcalloc(1, sizeof *gr);
+	gr->gd = gd;
+	gr->sx = sx;
+	gr->yy = 0;
+	gr->left = from;
+	evtimer_set(&gr->event, grid_reflow_timer, gr);
+	evtimer_add(&gr->event, &tv);
+	gd->reflow = gr;
 }
 
 /* Convert to position based on wrapped lines. */
@@ -0,0 +1,152 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2021 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tmux.h"
+
+/*
+ * OSC 8 hyperlink URIs are long and the same URI typically covers a run of
+ * many cells, so they are not stored in the cells themselves. Instead each
+ * distinct (URI, id) pair is interned once in this server-wide table and
+ * cells carry only the small number referring to it. The table is capped:
+ * when it is full the least recently used link is dropped, and any cells in
+ * old scrollback still holding its number are simply drawn without a link.
+ */
+
+struct hyperlink {
+	u_int				 number;
+	char				*uri;
+	char				*id; /* may be empty */
+
+	RB_ENTRY(hyperlink)		 by_number_entry;
+	RB_ENTRY(hyperlink)		 by_uri_entry;
+	TAILQ_ENTRY(hyperlink)		 list_entry;
+};
+
+/* Most links to remember; oldest are dropped when the table is full. */
+#define HYPERLINKS_MAX 5000
+
+static int	hyperlinks_cmp_number(struct hyperlink *, struct hyperlink *);
+static int	hyperlinks_cmp_uri(struct hyperlink *, struct hyperlink *);
+
+RB_HEAD(hyperlinks_by_number, hyperlink);
+RB_GENERATE_STATIC(hyperlinks_by_number, hyperlink, by_number_entry,
+    hyperlinks_cmp_number);
+RB_HEAD(hyperlinks_by_uri, hyperlink);
+RB_GENERATE_STATIC(hyperlinks_by_uri, hyperlink, by_uri_entry,
+    hyperlinks_cmp_uri);
+
+static struct hyperlinks_by_number	 hyperlinks_by_number =
+    RB_INITIALIZER(&hyperlinks_by_number);
+static struct hyperlinks_by_uri		 hyperlinks_by_uri =
+    RB_INITIALIZER(&hyperlinks_by_uri);
+static TAILQ_HEAD(, hyperlink)		 hyperlinks_list =
+    TAILQ_HEAD_INITIALIZER(hyperlinks_list);
+static u_int				 hyperlinks_count;
+static u_int				 hyperlinks_next = 1;
+
+static int
+hyperlinks_cmp_number(struct hyperlink *hl1, struct hyperlink *hl2)
+{
+	if (hl1->number < hl2->number)
+		return (-1);
+	if (hl1->number > hl2->number)
+		return (1);
+	return (0);
+}
+
+static int
+hyperlinks_cmp_uri(struct hyperlink *hl1, struct hyperlink *hl2)
+{
+	int	r;
+
+	if ((r = strcmp(hl1->uri, hl2->uri)) != 0)
+		return (r);
+	return (strcmp(hl1->id, hl2->id));
+}
+
+/* Remove a link from the table. */
+static void
+hyperlinks_remove(struct hyperlink *hl)
+{
+	RB_REMOVE(hyperlinks_by_number, &hyperlinks_by_number, hl);
+	RB_REMOVE(hyperlinks_by_uri, &hyperlinks_by_uri, hl);
+	TAILQ_REMOVE(&hyperlinks_list, hl, list_entry);
+	hyperlinks_count--;
+
+	free(hl->uri);
+	free(hl->id);
+	free(hl);
+}
+
+/* Intern a link, returning its (nonzero) number. */
+u_int
+hyperlinks_put(const char *uri, const char *id)
+{
+	struct hyperlink	 find, *hl;
+
+	find.uri = (char *)uri;
+	find.id = (char *)id;
+	hl = RB_FIND(hyperlinks_by_uri, &hyperlinks_by_uri, &find);
+	if (hl != NULL) {
+		TAILQ_REMOVE(&hyperlinks_list, hl, list_entry);
+		TAILQ_INSERT_TAIL(&hyperlinks_list, hl, list_entry);
+		return (hl->number);
+	}
+
+	if (hyperlinks_count == HYPERLINKS_MAX)
+		hyperlinks_remove(TAILQ_FIRST(&hyperlinks_list));
+
+	hl = xcalloc(1, sizeof *hl);
+	hl->number = hyperlinks_next++;
+	if (hyperlinks_next == 0) /* do not hand out zero after a wrap */
+		hyperlinks_next = 1;
+	hl->uri = xstrdup(uri);
+	hl->id = xstrdup(id);
+
+	RB_INSERT(hyperlinks_by_number, &hyperlinks_by_number, hl);
+	RB_INSERT(hyperlinks_by_uri, &hyperlinks_by_uri, hl);
+	TAILQ_INSERT_TAIL(&hyperlinks_list, hl, list_entry);
+	hyperlinks_count++;
+
+	log_debug("%s: %u = \"%s\" (id \"%s\")", __func__, hl->number, uri,
+	    id);
+	return (hl->number);
+}
+
+/*
+ * Look up a link by number. Returns 0 if the link has been dropped from the
+ * table, in which case the cell is drawn without it.
+ */
+int
+hyperlinks_get(u_int number, const char **uri, const char **id)
+{
+	struct hyperlink	 find, *hl;
+
+	find.number = number;
+	hl = RB_FIND(hyperlinks_by_number, &hyperlinks_by_number, &find);
+	if (hl == NULL)
+		return (0);
+	*uri = hl->uri;
+	*id = hl->id;
+	return (1);
+}
@@ -0,0 +1,258 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2021 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tmux.h"
+
+/*
+ * Sixel image payloads are large and often repeated (animations resend the
+ * same frames), so they are not stored with their grid. Each distinct
+ * payload is interned once in this server-wide refcounted store and grids
+ * hold placement records - an anchor cell and a blob reference - which cost
+ * a few bytes however big the image is. Placements are replayed to capable
+ * terminals when their anchor line is drawn and are dropped when the
+ * anchor scrolls off the history or the store grows too large.
+ */
+
+/* One distinct image payload (a complete escape sequence). */
+struct image_blob {
+	uint64_t		 hash;
+	char			*data;
+	size_t			 size;
+	u_int			 references;
+
+	RB_ENTRY(image_blob)	 entry;
+};
+
+/* Most bytes of payload to keep; oldest placements go when over. */
+#define IMAGES_BYTES_MAX (32 * 1024 * 1024)
+
+/* Most placements to keep on one grid. */
+#define IMAGES_PER_GRID_MAX 64
+
+static int	image_blob_cmp(struct image_blob *, struct image_blob *);
+static void	image_enforce_limits(struct grid *);
+
+RB_HEAD(image_blobs, image_blob);
+RB_GENERATE_STATIC(image_blobs, image_blob, entry, image_blob_cmp);
+
+static struct image_blobs	 image_blobs = RB_INITIALIZER(&image_blobs);
+static size_t			 image_bytes;
+static TAILQ_HEAD(, image)	 image_age_list =
+    TAILQ_HEAD_INITIALIZER(image_age_list);
+
+static int
+image_blob_cmp(struct image_blob *ib1, struct image_blob *ib2)
+{
+	if (ib1->hash < ib2->hash)
+		return (-1);
+	if (ib1->hash > ib2->hash)
+		return (1);
+	if (ib1->size < ib2->size)
+		return (-1);
+	if (ib1->size > ib2->size)
+		return (1);
+	return (memcmp(ib1->data, ib2->data, ib1->size));
+}
+
+/* Hash a payload (FNV-1a). */
+static uint64_t
+image_blob_hash(const char *data, size_t size)
+{
+	uint64_t	hash = 0xcbf29ce484222325ULL;
+	size_t		i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= (u_char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return (hash);
+}
+
+/* Drop a reference on a blob, freeing it at zero. */
+static void
+image_blob_unref(struct image_blob *ib)
+{
+	if (--ib->references != 0)
+		return;
+
+	RB_REMOVE(image_blobs, &image_blobs, ib);
+	image_bytes -= ib->size;
+
+	free(ib->data);
+	free(ib);
+}
+
+/* Does any other placement anchor on the same line? */
+static int
+image_line_shared(struct grid *gd, struct image *img)
+{
+	struct image	*loop;
+
+	TAILQ_FOREACH(loop, gd->images, entry) {
+		if (loop != img && loop->py == img->py)
+			return (1);
+	}
+	return (0);
+}
+
+/* Free one placement. */
+static void
+image_free(struct grid *gd, struct image *img)
+{
+	if (img->py < gd->hsize + gd->sy && !image_line_shared(gd, img))
+		grid_get_line(gd, img->py)->flags &= ~GRID_LINE_IMAGE;
+
+	TAILQ_REMOVE(gd->images, img, entry);
+	TAILQ_REMOVE(&image_age_list, img, age_entry);
+
+	image_blob_unref(img->blob);
+	free(img);
+}
+
+/*
+ * Add a placement for a payload at the given (absolute) grid position.
+ * Takes ownership of data, which must be the complete escape sequence.
+ */
+struct image *
+image_place(struct grid *gd, u_int px, u_int py, char *data, size_t size)
+{
+	struct image_blob	 find, *ib;
+	struct image		*img;
+
+	find.hash = image_blob_hash(data, size);
+	find.data = data;
+	find.size = size;
+
+	if ((ib = RB_FIND(image_blobs, &image_blobs, &find)) != NULL) {
+		log_debug("%s: duplicate payload of %zu bytes", __func__,
+		    size);
+		free(data);
+		ib->references++;
+	} else {
+		ib = xcalloc(1, sizeof *ib);
+		ib->hash = find.hash;
+		ib->data = data;
+		ib->size = size;
+		ib->references = 1;
+		RB_INSERT(image_blobs, &image_blobs, ib);
+
+		image_bytes += size;
+		log_debug("%s: new payload of %zu bytes (%zu total)",
+		    __func__, size, image_bytes);
+	}
+
+	if (gd->images == NULL) {
+		gd->images = xmalloc(sizeof *gd->images);
+		TAILQ_INIT(gd->images);
+	}
+
+	img = xcalloc(1, sizeof *img);
+	img->gd = gd;
+	img->blob = ib;
+	img->px = px;
+	img->py = py;
+	TAILQ_INSERT_TAIL(gd->images, img, entry);
+	TAILQ_INSERT_TAIL(&image_age_list, img, age_entry);
+
+	if (py < gd->hsize + gd->sy)
+		grid_get_line(gd, py)->flags |= GRID_LINE_IMAGE;
+
+	image_enforce_limits(gd);
+	return (img);
+}
+
+/* Evict the oldest placements while over the limits. */
+static void
+image_enforce_limits(struct grid *gd)
+{
+	struct image	*img;
+	u_int		 count = 0;
+
+	TAILQ_FOREACH(img, gd->images, entry)
+		count++;
+	while (count > IMAGES_PER_GRID_MAX) {
+		image_free(gd, TAILQ_FIRST(gd->images));
+		count--;
+	}
+
+	while (image_bytes > IMAGES_BYTES_MAX &&
+	    (img = TAILQ_FIRST(&image_age_list)) != NULL)
+		image_free(img->gd, img);
+}
+
+/* Free all placements on a grid. */
+void
+image_free_all(struct grid *gd)
+{
+	if (gd->images == NULL)
+		return;
+
+	while (!TAILQ_EMPTY(gd->images))
+		image_free(gd, TAILQ_FIRST(gd->images));
+
+	free(gd->images);
+	gd->images = NULL;
+}
+
+/* Free placements anchored in the visible area. */
+void
+image_free_visible(struct grid *gd)
+{
+	struct image	*img, *img1;
+
+	if (gd->images == NULL)
+		return;
+
+	TAILQ_FOREACH_SAFE(img, gd->images, entry, img1) {
+		if (img->py >= gd->hsize)
+			image_free(gd, img);
+	}
+}
+
+/*
+ * The top ny lines of the history have been trimmed; drop placements
+ * anchored there and shift the rest up.
+ */
+void
+image_trim(struct grid *gd, u_int ny)
+{
+	struct image	*img, *img1;
+
+	if (gd->images == NULL)
+		return;
+
+	TAILQ_FOREACH_SAFE(img, gd->images, entry, img1) {
+		if (img->py < ny)
+			image_free(gd, img);
+		else
+			img->py -= ny;
+	}
+}
+
+/* Get the payload for a placement. */
+const char *
+image_data(struct image *img, size_t *size)
+{
+	*size = img->blob->size;
+	return (img->blob->data);
+}
@@ -436,6 +436,16 @@ input_key(struct screen *s, struct bufferevent *bev, key_code key)
 	struct utf8_data	 ud;
 	char			 tmp[64], modifier;
 
+	/*
+	 * Plain printable ASCII with no flags or modifiers is the
+	 * overwhelmingly common case: send it before any other tests.
+	 */
+	if (key >= 0x20 && key < 0x7f) {
+		ud.data[0] = key;
+		bufferevent_write(bev, &ud.data[0], 1);
+		return (0);
+	}
+
 	/* Mouse keys need a pane. */
 	if (KEYC_IS_MOUSE(key))
 		return (0);
@@ -461,18 +471,25 @@ input_key(struct screen *s, struct bufferevent *bev, key_code key)
 	 */
 	justkey = (key & ~(KEYC_META|KEYC_IMPLIED_META));
 	if (justkey <= 0x7f) {
-		if (key & KEYC_META)
-			bufferevent_write(bev, "\033", 1);
-		ud.data[0] = justkey;
-		bufferevent_write(bev, &ud.data[0], 1);
+		if (key & KEYC_META) {
+			tmp[0] = '\033';
+			tmp[1] = justkey;
+			bufferevent_write(bev, tmp, 2);
+		} else {
+			ud.data[0] = justkey;
+			bufferevent_write(bev, &ud.data[0], 1);
+		}
 		return (0);
 	}
 	if (justkey > 0x7f && justkey < KEYC_BASE) {
 		if (utf8_split(justkey, &ud) != UTF8_DONE)
 			return (-1);
-		if (key & KEYC_META)
-			bufferevent_write(bev, "\033", 1);
-		bufferevent_write(bev, ud.data, ud.size);
+		if (key & KEYC_META) {
+			tmp[0] = '\033';
+			memcpy(tmp + 1, ud.data, ud.size);
+			bufferevent_write(bev, tmp, ud.size + 1);
+		} else
+			bufferevent_write(bev, ud.data, ud.size);
 		return (0);
 	}
 
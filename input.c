@@ -92,6 +92,7 @@ struct input_ctx {
 	size_t			param_len;
 
 #define INPUT_BUF_START 32
+#define INPUT_BUF_POOL 8192
 #define INPUT_BUF_LIMIT 1048576
 	u_char		       *input_buf;
 	size_t			input_len;
@@ -107,6 +108,9 @@ struct input_ctx {
 	struct utf8_data	utf8data;
 	int			utf8started;
 
+	int			ambiguous_width;
+	int			emoji_width;
+
 	int			ch;
 	int			last;
 
@@ -114,6 +118,7 @@ struct input_ctx {
 #define INPUT_DISCARD 0x1
 
 	const struct input_state *state;
+	const struct input_transition *const *map;
 
 	struct event		timer;
 
@@ -125,15 +130,21 @@ struct input_ctx {
 };
 
 /* Helper functions. */
+struct input_state;
 struct input_transition;
 static int	input_split(struct input_ctx *);
 static int	input_get(struct input_ctx *, u_int, int, int);
+static void	input_build_maps(void);
+static const struct input_transition *const *input_map_for_state(
+		    const struct input_state *);
 static void printflike(2, 3) input_reply(struct input_ctx *, const char *, ...);
 static void	input_set_state(struct input_ctx *,
 		    const struct input_transition *);
+static int	input_osc_input(struct input_ctx *);
 static void	input_reset_cell(struct input_ctx *);
 
 static void	input_osc_4(struct input_ctx *, const char *);
+static void	input_osc_8(struct input_ctx *, const char *);
 static void	input_osc_10(struct input_ctx *, const char *);
 static void	input_osc_11(struct input_ctx *, const char *);
 static void	input_osc_52(struct input_ctx *, const char *);
@@ -152,6 +163,7 @@ static void	input_exit_rename(struct input_ctx *);
 
 /* Input state handlers. */
 static int	input_print(struct input_ctx *);
+static void	input_print_run(struct input_ctx *, u_char *, size_t);
 static int	input_intermediate(struct input_ctx *);
 static int	input_parameter(struct input_ctx *);
 static int	input_input(struct input_ctx *);
@@ -167,6 +179,7 @@ static void	input_csi_dispatch_sgr_256(struct input_ctx *, int, u_int *);
 static void	input_csi_dispatch_sgr_rgb(struct input_ctx *, int, u_int *);
 static void	input_csi_dispatch_sgr(struct input_ctx *);
 static int	input_dcs_dispatch(struct input_ctx *);
+static void	input_dcs_sixel(struct input_ctx *);
 static int	input_top_bit_set(struct input_ctx *);
 static int	input_end_bel(struct input_ctx *);
 
@@ -463,6 +476,35 @@ static const struct input_state input_state_consume_st = {
 	input_state_consume_st_table
 };
 
+/* List of all the states, used to build the flat transition maps. */
+static const struct input_state *input_states[] = {
+	&input_state_ground,
+	&input_state_esc_enter,
+	&input_state_esc_intermediate,
+	&input_state_csi_enter,
+	&input_state_csi_parameter,
+	&input_state_csi_intermediate,
+	&input_state_csi_ignore,
+	&input_state_dcs_enter,
+	&input_state_dcs_parameter,
+	&input_state_dcs_intermediate,
+	&input_state_dcs_handler,
+	&input_state_dcs_escape,
+	&input_state_dcs_ignore,
+	&input_state_osc_string,
+	&input_state_apc_string,
+	&input_state_rename_string,
+	&input_state_consume_st
+};
+
+/*
+ * Flat 256-entry transition maps, built from the range tables on first use so
+ * looking up the transition for a byte is a single indexed load rather than a
+ * walk over the ranges.
+ */
+static const struct input_transition *input_state_maps[nitems(input_states)][256];
+static int input_state_maps_built;
+
 /* ground state table. */
 static const struct input_transition input_state_ground_table[] = {
 	INPUT_STATE_ANYWHERE,
@@ -677,7 +719,7 @@ static const struct input_transition input_state_osc_string_table[] = {
 	{ 0x08, 0x17, NULL,	     NULL },
 	{ 0x19, 0x19, NULL,	     NULL },
 	{ 0x1c, 0x1f, NULL,	     NULL },
-	{ 0x20, 0xff, input_input,   NULL },
+	{ 0x20, 0xff, input_osc_input, NULL },
 
 	{ -1, -1, NULL, NULL }
 };
@@ -802,6 +844,7 @@ input_init(struct window_pane *wp, struct bufferevent *bev)
 	ictx = xcalloc(1, sizeof *ictx);
 	ictx->wp = wp;
 	ictx->event = bev;
+	input_update_widths(ictx);
 
 	ictx->input_space = INPUT_BUF_START;
 	ictx->input_buf = xmalloc(INPUT_BUF_START);
@@ -858,6 +901,7 @@ input_reset(struct input_ctx *ictx, int clear)
 	ictx->last = -1;
 
 	ictx->state = &input_state_ground;
+	ictx->map = input_map_for_state(ictx->state);
 	ictx->flags = 0;
 }
 
@@ -868,6 +912,57 @@ input_pending(struct input_ctx *ictx)
 	return (ictx->since_ground);
 }
 
+/* Release parser scratch memory before a pane hibernates. */
+void
+input_hibernate(struct input_ctx *ictx)
+{
+	evbuffer_free(ictx->since_ground);
+	ictx->since_ground = evbuffer_new();
+	if (ictx->since_ground == NULL)
+		fatalx("out of memory");
+}
+
+/* Build the flat per-byte transition maps from the range tables. */
+static void
+input_build_maps(void)
+{
+	const struct input_state	*state;
+	const struct input_transition	*itr;
+	u_int				 i;
+	int				 ch;
+
+	for (i = 0; i < nitems(input_states); i++) {
+		state = input_states[i];
+		for (itr = state->transitions;
+		    itr->first != -1 && itr->last != -1;
+		    itr++) {
+			for (ch = itr->first; ch <= itr->last; ch++) {
+				if (ch < 0 || ch > 0xff)
+					continue;
+				/* The first matching range wins. */
+				if (input_state_maps[i][ch] == NULL)
+					input_state_maps[i][ch] = itr;
+			}
+		}
+	}
+	input_state_maps_built = 1;
+}
+
+/* Get the flat transition map for a state. */
+static const struct input_transition *const *
+input_map_for_state(const struct input_state *state)
+{
+	u_int	i;
+
+	if (!input_state_maps_built)
+		input_build_maps();
+	for (i = 0; i < nitems(input_states); i++) {
+		if (input_states[i] == state)
+			return (input_state_maps[i]);
+	}
+	fatalx("unknown input state");
+}
+
 /* Change input state. */
 static void
 input_set_state(struct input_ctx *ictx, const struct input_transition *itr)
@@ -875,6 +970,7 @@ input_set_state(struct input_ctx *ictx, const struct input_transition *itr)
 	if (ictx->state->exit != NULL)
 		ictx->state->exit(ictx);
 	ictx->state = itr->state;
+	ictx->map = input_map_for_state(ictx->state);
 	if (ictx->state->enter != NULL)
 		ictx->state->enter(ictx);
 }
@@ -884,32 +980,35 @@ static void
 input_parse(struct input_ctx *ictx, u_char *buf, size_t len)
 {
 	struct screen_write_ctx		*sctx = &ictx->ctx;
-	const struct input_state	*state = NULL;
-	const struct input_transition	*itr = NULL;
-	size_t				 off = 0;
+	const struct input_transition	*itr;
+	size_t				 off = 0, end;
 
 	/* Parse the input. */
 	while (off < len) {
+		/*
+		 * In the ground state, printable ASCII is overwhelmingly the
+		 * common case, so scan the whole run of it ahead and print it
+		 * in one go instead of walking the state table per byte. The
+		 * simple byte loop also lets the compiler vectorize the scan.
+		 */
+		if (ictx->state == &input_state_ground &&
+		    buf[off] >= 0x20 && buf[off] <= 0x7e) {
+			end = off + 1;
+			while (end < len && buf[end] >= 0x20 &&
+			    buf[end] <= 0x7e)
+				end++;
+			input_print_run(ictx, buf + off, end - off);
+			off = end;
+			continue;
+		}
+
 		ictx->ch = buf[off++];
 
 		/* Find the transition. */
-		if (ictx->state != state ||
-		    itr == NULL ||
-		    ictx->ch < itr->first ||
-		    ictx->ch > itr->last) {
-			itr = ictx->state->transitions;
-			while (itr->first != -1 && itr->last != -1) {
-				if (ictx->ch >= itr->first &&
-				    ictx->ch <= itr->last)
-					break;
-				itr++;
-			}
-			if (itr->first == -1 || itr->last == -1) {
-				/* No transition? Eh? */
-				fatalx("no transition from state");
-			}
+		if ((itr = ictx->map[ictx->ch]) == NULL) {
+			/* No transition? Eh? */
+			fatalx("no transition from state");
 		}
-		state = ictx->state;
 
 		/*
 		 * Any state except print stops the current collection. This is
@@ -957,9 +1056,14 @@ input_parse_buffer(struct window_pane *wp, u_char *buf, size_t len)
 
 	if (len == 0)
 		return;
+	server_perf.input_calls++;
+	server_perf.input_bytes += len;
+	log_record("input %%%u: %zu bytes", wp->id, len);
 
 	window_update_activity(wp->window);
 	wp->flags |= PANE_CHANGED;
+	wp->flags &= ~PANE_HIBERNATED;
+	wp->generation++;
 	notify_input(wp, buf, len);
 
 	/* NULL wp if there is a mode set as don't want to update the tty. */
@@ -1105,9 +1209,14 @@ input_ground(struct input_ctx *ictx)
 	event_del(&ictx->timer);
 	evbuffer_drain(ictx->since_ground, EVBUFFER_LENGTH(ictx->since_ground));
 
-	if (ictx->input_space > INPUT_BUF_START) {
-		ictx->input_space = INPUT_BUF_START;
-		ictx->input_buf = xrealloc(ictx->input_buf, INPUT_BUF_START);
+	/*
+	 * Keep a moderately sized buffer across sequences rather than
+	 * shrinking it every time, so the common case of repeated OSC or DCS
+	 * sequences does not reallocate for each one.
+	 */
+	if (ictx->input_space > INPUT_BUF_POOL) {
+		ictx->input_space = INPUT_BUF_POOL;
+		ictx->input_buf = xrealloc(ictx->input_buf, INPUT_BUF_POOL);
 	}
 }
 
@@ -1135,6 +1244,28 @@ input_print(struct input_ctx *ictx)
 	return (0);
 }
 
+/* Output a run of printable characters in the ground state. */
+static void
+input_print_run(struct input_ctx *ictx, u_char *buf, size_t len)
+{
+	struct screen_write_ctx	*sctx = &ictx->ctx;
+	int			 set;
+
+	ictx->utf8started = 0; /* can't be valid UTF-8 */
+
+	set = ictx->cell.set == 0 ? ictx->cell.g0set : ictx->cell.g1set;
+	if (set == 1)
+		ictx->cell.cell.attr |= GRID_ATTR_CHARSET;
+	else
+		ictx->cell.cell.attr &= ~GRID_ATTR_CHARSET;
+
+	utf8_set(&ictx->cell.cell.data, buf[0]);
+	screen_write_collect_add_run(sctx, &ictx->cell.cell, buf, len);
+	ictx->last = buf[len - 1];
+
+	ictx->cell.cell.attr &= ~GRID_ATTR_CHARSET;
+}
+
 /* Collect intermediate string. */
 static int
 input_intermediate(struct input_ctx *ictx)
@@ -1169,6 +1300,9 @@ input_input(struct input_ctx *ictx)
 {
 	size_t available;
 
+	if (ictx->flags & INPUT_DISCARD)
+		return (0);
+
 	available = ictx->input_space;
 	while (ictx->input_len + 1 >= available) {
 		available *= 2;
@@ -1185,6 +1319,46 @@ input_input(struct input_ctx *ictx)
 	return (0);
 }
 
+/*
+ * Collect an OSC string. Once the option number is complete, unsupported
+ * options are discarded immediately rather than buffering a payload which
+ * will only be thrown away when the sequence ends.
+ */
+static int
+input_osc_input(struct input_ctx *ictx)
+{
+	u_char	*p;
+	u_int	 option;
+
+	if (ictx->ch == ';' && ictx->input_len != 0 && ictx->input_len <= 6) {
+		option = 0;
+		for (p = ictx->input_buf; *p >= '0' && *p <= '9'; p++)
+			option = option * 10 + *p - '0';
+		if (*p == '\0') {
+			switch (option) {
+			case 0:
+			case 2:
+			case 4:
+			case 7:
+			case 8:
+			case 10:
+			case 11:
+			case 12:
+			case 52:
+			case 104:
+			case 112:
+				break;
+			default:
+				log_debug("%s: discarding '%u'", __func__,
+				    option);
+				ictx->flags |= INPUT_DISCARD;
+				return (0);
+			}
+		}
+	}
+	return (input_input(ictx));
+}
+
 /* Execute C0 control sequence. */
 static int
 input_c0_dispatch(struct input_ctx *ictx)
@@ -2216,12 +2390,46 @@ input_dcs_dispatch(struct input_ctx *ictx)
 
 	log_debug("%s: \"%s\"", __func__, buf);
 
+	if (len != 0 && buf[0] == 'q') {
+		input_dcs_sixel(ictx);
+		return (0);
+	}
+
 	if (len >= prefixlen && strncmp(buf, prefix, prefixlen) == 0)
 		screen_write_rawstring(sctx, buf + prefixlen, len - prefixlen);
 
 	return (0);
 }
 
+/*
+ * Store a sixel image as a placement record anchored at the cursor and pass
+ * it through to any capable terminals showing the pane. The payload is
+ * interned once however many times it is drawn or repeated.
+ */
+static void
+input_dcs_sixel(struct input_ctx *ictx)
+{
+	struct screen_write_ctx	*sctx = &ictx->ctx;
+	struct screen		*s = sctx->s;
+	struct grid		*gd = s->grid;
+	struct image		*img;
+	char			*data;
+	size_t			 size;
+
+	size = 2 + ictx->param_len + ictx->input_len + 2;
+	data = xmalloc(size + 1);
+	data[0] = '\033';
+	data[1] = 'P';
+	memcpy(data + 2, ictx->param_buf, ictx->param_len);
+	memcpy(data + 2 + ictx->param_len, ictx->input_buf, ictx->input_len);
+	data[size - 2] = '\033';
+	data[size - 1] = '\\';
+	data[size] = '\0';
+
+	img = image_place(gd, s->cx, gd->hsize + s->cy, data, size);
+	screen_write_sixel(sctx, img);
+}
+
 /* OSC string started. */
 static void
 input_enter_osc(struct input_ctx *ictx)
@@ -2276,6 +2484,9 @@ input_exit_osc(struct input_ctx *ictx)
 			}
 		}
 		break;
+	case 8:
+		input_osc_8(ictx, p);
+		break;
 	case 10:
 		input_osc_10(ictx, p);
 		break;
@@ -2371,6 +2582,22 @@ input_exit_rename(struct input_ctx *ictx)
 	server_status_window(wp->window);
 }
 
+/* Refresh the cached width override modes from the pane options. */
+void
+input_update_widths(struct input_ctx *ictx)
+{
+	struct window_pane	*wp = ictx->wp;
+
+	if (wp == NULL) {
+		ictx->ambiguous_width = 0;
+		ictx->emoji_width = 0;
+		return;
+	}
+	ictx->ambiguous_width = options_get_number(wp->options,
+	    "ambiguous-width");
+	ictx->emoji_width = options_get_number(wp->options, "emoji-width");
+}
+
 /* Open UTF-8 character. */
 static int
 input_top_bit_set(struct input_ctx *ictx)
@@ -2398,6 +2625,9 @@ input_top_bit_set(struct input_ctx *ictx)
 	}
 	ictx->utf8started = 0;
 
+	if (ictx->ambiguous_width != 0 || ictx->emoji_width != 0)
+		utf8_apply_width(ud, ictx->ambiguous_width, ictx->emoji_width);
+
 	log_debug("%s %hhu '%*s' (width %hhu)", __func__, ud->size,
 	    (int)ud->size, ud->data, ud->width);
 
@@ -2493,6 +2723,46 @@ bad:
 	free(copy);
 }
 
+/* Handle the OSC 8 sequence for embedding hyperlinks. */
+static void
+input_osc_8(struct input_ctx *ictx, const char *p)
+{
+	struct grid_cell	*gc = &ictx->cell.cell;
+	const char		*start, *end, *uri;
+	char			*id = NULL;
+
+	for (start = p; (end = strpbrk(start, ":;")) != NULL; start = end + 1) {
+		if (end - start >= 4 && strncmp(start, "id=", 3) == 0) {
+			if (id != NULL)
+				goto bad;
+			id = xstrndup(start + 3, end - start - 3);
+		}
+
+		/* The first ; is the end of parameters and start of URI. */
+		if (*end == ';')
+			break;
+	}
+	if (end == NULL || *end != ';')
+		goto bad;
+	uri = end + 1;
+	if (*uri == '\0') {
+		gc->link = 0;
+		free(id);
+		return;
+	}
+	if (!utf8_isvalid(uri))
+		goto bad;
+	gc->link = hyperlinks_put(uri, id == NULL ? "" : id);
+	log_debug("%s: hyperlink %u \"%s\" (id \"%s\")", __func__, gc->link,
+	    uri, id == NULL ? "" : id);
+	free(id);
+	return;
+
+bad:
+	log_debug("bad OSC 8 %s", p);
+	free(id);
+}
+
 /* Handle the OSC 10 sequence for setting foreground colour. */
 static void
 input_osc_10(struct input_ctx *ictx, const char *p)
@@ -0,0 +1,447 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2009 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+#include <sys/queue.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <errno.h>
+#include <event.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tmux.h"
+
+/*
+ * Persistent job runner. Forking a #() format command out of the server means
+ * duplicating the server's whole address space for every status refresh,
+ * which gets expensive as scrollback accumulates. Instead a small helper
+ * process is forked once at startup - before any server state exists, so its
+ * image stays tiny and its own forks are cheap - and jobs are handed to it
+ * over imsg with the output socket, command, working directory and
+ * environment attached. The helper forks the shell, reaps it and reports the
+ * exit status back with MSG_JOB_DIED, which job.c routes to the job.
+ */
+
+/* A child spawned by the runner, so its exit can be matched to a job. */
+struct job_runner_child {
+	u_int				 id;
+	pid_t				 pid;
+
+	LIST_ENTRY(job_runner_child)	 entry;
+};
+static LIST_HEAD(, job_runner_child) job_runner_children =
+    LIST_HEAD_INITIALIZER(job_runner_children);
+
+/* Server side state. */
+static int		 job_runner_fd = -1;
+static struct tmuxpeer	*job_runner_peer;
+static u_int		 job_runner_lastid;
+
+/* Runner side state. */
+static struct imsgbuf	 job_runner_ibuf;
+static int		 job_runner_sigchld[2];
+
+static void	job_runner_loop(int);
+static void	job_runner_send_died(u_int, int);
+static void	job_runner_killmsg(struct imsg *);
+static void	job_runner_spawn(struct imsg *);
+static void	job_runner_reap(void);
+static void	job_runner_dispatch(struct imsg *, void *);
+
+/* SIGCHLD handler: poke the poll loop through the self-pipe. */
+static void
+job_runner_signal(__unused int sig)
+{
+	int	saved_errno = errno;
+
+	write(job_runner_sigchld[1], "", 1);
+	errno = saved_errno;
+}
+
+/*
+ * Fork the runner process. Called once from the server before any state is
+ * built up, with all signals blocked. If it fails, jobs just fork from the
+ * server as before.
+ */
+void
+job_runner_fork(void)
+{
+	int	pair[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, PF_UNSPEC, pair) != 0)
+		return;
+	switch (fork()) {
+	case -1:
+		close(pair[0]);
+		close(pair[1]);
+		return;
+	case 0:
+		close(pair[0]);
+		job_runner_loop(pair[1]);
+		/* NOTREACHED */
+	}
+	close(pair[1]);
+	job_runner_fd = pair[0];
+}
+
+/* Runner process: receive jobs, fork them, report deaths. Never returns. */
+static void
+job_runner_loop(int fd)
+{
+	struct pollfd		 pfd[2];
+	struct imsg		 imsg;
+	struct job_runner_child	*jrc;
+	struct sigaction	 sa;
+	sigset_t		 set;
+	ssize_t			 n;
+	char			 c;
+
+	setproctitle("job runner (%s)", socket_path);
+
+	memset(&sa, 0, sizeof sa);
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sa.sa_handler = SIG_DFL;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+	sigaction(SIGCONT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGUSR1, &sa, NULL);
+	sigaction(SIGUSR2, &sa, NULL);
+	sigaction(SIGWINCH, &sa, NULL);
+	sigaction(SIGTSTP, &sa, NULL);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+	sigaction(SIGTTIN, &sa, NULL);
+	sigaction(SIGTTOU, &sa, NULL);
+
+	if (pipe(job_runner_sigchld) != 0)
+		_exit(1);
+	setblocking(job_runner_sigchld[0], 0);
+	setblocking(job_runner_sigchld[1], 0);
+
+	sa.sa_flags = 0;
+	sa.sa_handler = job_runner_signal;
+	sigaction(SIGCHLD, &sa, NULL);
+
+	sigemptyset(&set);
+	sigprocmask(SIG_SETMASK, &set, NULL);
+
+	imsg_init(&job_runner_ibuf, fd);
+	for (;;) {
+		pfd[0].fd = fd;
+		pfd[0].events = POLLIN;
+		if (job_runner_ibuf.w.queued > 0)
+			pfd[0].events |= POLLOUT;
+		pfd[1].fd = job_runner_sigchld[0];
+		pfd[1].events = POLLIN;
+
+		if (poll(pfd, 2, -1) == -1) {
+			if (errno != EINTR && errno != EAGAIN)
+				break;
+		}
+		if (pfd[1].revents & POLLIN) {
+			while (read(job_runner_sigchld[0], &c, 1) == 1)
+				/* nothing */;
+		}
+		job_runner_reap();
+
+		if (pfd[0].revents & (POLLIN|POLLHUP)) {
+			if ((n = imsg_read(&job_runner_ibuf)) == -1 &&
+			    errno != EAGAIN)
+				break;
+			if (n == 0)
+				break;
+			for (;;) {
+				if ((n = imsg_get(&job_runner_ibuf,
+				    &imsg)) == -1)
+					goto out;
+				if (n == 0)
+					break;
+				switch (imsg.hdr.type) {
+				case MSG_JOB_RUN:
+					job_runner_spawn(&imsg);
+					break;
+				case MSG_JOB_KILL:
+					job_runner_killmsg(&imsg);
+					break;
+				}
+				imsg_free(&imsg);
+			}
+		}
+		if (pfd[0].revents & POLLOUT) {
+			if (msgbuf_write(&job_runner_ibuf.w) <= 0 &&
+			    errno != EAGAIN)
+				break;
+		}
+	}
+
+out:
+	/* The server has gone: take the children with us, as job_free would. */
+	LIST_FOREACH(jrc, &job_runner_children, entry)
+		kill(jrc->pid, SIGTERM);
+	_exit(0);
+}
+
+/* Queue a death report back to the server. */
+static void
+job_runner_send_died(u_int id, int status)
+{
+	struct msg_job_died	msg;
+
+	msg.id = id;
+	msg.status = status;
+	imsg_compose(&job_runner_ibuf, MSG_JOB_DIED, PROTOCOL_VERSION, -1, -1,
+	    &msg, sizeof msg);
+}
+
+/* Handle MSG_JOB_KILL: kill a running child by id. */
+static void
+job_runner_killmsg(struct imsg *imsg)
+{
+	struct msg_job_kill	 msg;
+	struct job_runner_child	*jrc;
+
+	if (imsg->hdr.len - IMSG_HEADER_SIZE != sizeof msg)
+		return;
+	memcpy(&msg, imsg->data, sizeof msg);
+
+	LIST_FOREACH(jrc, &job_runner_children, entry) {
+		if (jrc->id == msg.id) {
+			kill(jrc->pid, SIGTERM);
+			break;
+		}
+	}
+}
+
+/* Handle MSG_JOB_RUN: fork the command with the attached output socket. */
+static void
+job_runner_spawn(struct imsg *imsg)
+{
+	struct msg_job_run	 msg;
+	struct job_runner_child	*jrc;
+	struct environ		*env;
+	const char		*data = imsg->data, *cmd, *cwd, *home;
+	size_t			 len = imsg->hdr.len - IMSG_HEADER_SIZE;
+	pid_t			 pid;
+	int			 nullfd, parsed = 0;
+
+	if (len <= sizeof msg || data[len - 1] != '\0')
+		goto fail;
+	memcpy(&msg, data, sizeof msg);
+	parsed = 1;
+	data += sizeof msg;
+	len -= sizeof msg;
+
+	if (imsg->fd == -1)
+		goto fail;
+	cmd = data;
+	if (strlen(cmd) + 1 >= len)
+		goto fail;
+	cwd = cmd + strlen(cmd) + 1;
+	data = cwd + strlen(cwd) + 1;
+	len -= (data - cmd);
+
+	switch (pid = fork()) {
+	case -1:
+		goto fail;
+	case 0:
+		if (*cwd == '\0' || chdir(cwd) != 0) {
+			if ((home = find_home()) == NULL || chdir(home) != 0)
+				chdir("/");
+		}
+
+		env = environ_create();
+		while (len > 0) {
+			environ_put(env, data, 0);
+			len -= strlen(data) + 1;
+			data += strlen(data) + 1;
+		}
+		environ_push(env);
+		environ_free(env);
+
+		if (dup2(imsg->fd, STDIN_FILENO) == -1)
+			fatal("dup2 failed");
+		if (dup2(imsg->fd, STDOUT_FILENO) == -1)
+			fatal("dup2 failed");
+
+		nullfd = open(_PATH_DEVNULL, O_RDWR, 0);
+		if (nullfd == -1)
+			fatal("open failed");
+		if (dup2(nullfd, STDERR_FILENO) == -1)
+			fatal("dup2 failed");
+		if (nullfd != STDERR_FILENO)
+			close(nullfd);
+		closefrom(STDERR_FILENO + 1);
+
+		execl(_PATH_BSHELL, "sh", "-c", cmd, (char *) NULL);
+		fatal("execl failed");
+	}
+	close(imsg->fd);
+
+	jrc = xmalloc(sizeof *jrc);
+	jrc->id = msg.id;
+	jrc->pid = pid;
+	LIST_INSERT_HEAD(&job_runner_children, jrc, entry);
+	return;
+
+fail:
+	if (imsg->fd != -1)
+		close(imsg->fd);
+	if (parsed)
+		job_runner_send_died(msg.id, 1 << 8); /* exit status 1 */
+}
+
+/* Reap dead children and report them, mirroring server_child_signal. */
+static void
+job_runner_reap(void)
+{
+	struct job_runner_child	*jrc;
+	int			 status;
+	pid_t			 pid;
+
+	for (;;) {
+		switch (pid = waitpid(WAIT_ANY, &status, WNOHANG|WUNTRACED)) {
+		case -1:
+			if (errno == EINTR)
+				continue;
+			return;
+		case 0:
+			return;
+		}
+		if (WIFSTOPPED(status)) {
+			if (WSTOPSIG(status) == SIGTTIN ||
+			    WSTOPSIG(status) == SIGTTOU)
+				continue;
+			killpg(pid, SIGCONT);
+			continue;
+		}
+		LIST_FOREACH(jrc, &job_runner_children, entry) {
+			if (jrc->pid == pid)
+				break;
+		}
+		if (jrc != NULL) {
+			job_runner_send_died(jrc->id, status);
+			LIST_REMOVE(jrc, entry);
+			free(jrc);
+		}
+	}
+}
+
+/* Server side: handle messages from the runner. */
+static void
+job_runner_dispatch(struct imsg *imsg, __unused void *arg)
+{
+	struct msg_job_died	msg;
+	size_t			datalen;
+
+	if (imsg == NULL) {
+		/* The runner has died; new jobs fall back to forking. */
+		log_debug("%s: job runner lost", __func__);
+		proc_remove_peer(job_runner_peer);
+		job_runner_peer = NULL;
+		job_runner_fd = -1;
+		return;
+	}
+
+	switch (imsg->hdr.type) {
+	case MSG_JOB_DIED:
+		datalen = imsg->hdr.len - IMSG_HEADER_SIZE;
+		if (datalen != sizeof msg)
+			fatalx("bad MSG_JOB_DIED size");
+		memcpy(&msg, imsg->data, sizeof msg);
+		job_runner_died(msg.id, msg.status);
+		break;
+	}
+}
+
+/*
+ * Server side: hand a job to the runner with a copy of the output socket.
+ * Returns the nonzero job id, or zero if the runner is not available and the
+ * caller should fork the job itself.
+ */
+u_int
+job_runner_run(const char *cmd, const char *cwd, struct environ *env, int fd)
+{
+	struct msg_job_run	 msg;
+	struct environ_entry	*envent;
+	struct evbuffer		*buf;
+	char			*s;
+	u_int			 id;
+	int			 retval;
+
+	if (job_runner_fd == -1)
+		return (0);
+	if (job_runner_peer == NULL) {
+		job_runner_peer = proc_add_peer(server_proc, job_runner_fd,
+		    job_runner_dispatch, NULL);
+	}
+
+	if (++job_runner_lastid == 0)
+		++job_runner_lastid;
+	id = job_runner_lastid;
+
+	if ((buf = evbuffer_new()) == NULL)
+		fatalx("out of memory");
+	msg.id = id;
+	evbuffer_add(buf, &msg, sizeof msg);
+	evbuffer_add(buf, cmd, strlen(cmd) + 1);
+	if (cwd == NULL)
+		cwd = "";
+	evbuffer_add(buf, cwd, strlen(cwd) + 1);
+	for (envent = environ_first(env); envent != NULL;
+	    envent = environ_next(envent)) {
+		if (envent->value == NULL ||
+		    *envent->name == '\0' ||
+		    (envent->flags & ENVIRON_HIDDEN))
+			continue;
+		xasprintf(&s, "%s=%s", envent->name, envent->value);
+		evbuffer_add(buf, s, strlen(s) + 1);
+		free(s);
+	}
+	if (EVBUFFER_LENGTH(buf) > MAX_IMSGSIZE - IMSG_HEADER_SIZE) {
+		evbuffer_free(buf);
+		return (0);
+	}
+
+	retval = proc_send(job_runner_peer, MSG_JOB_RUN, dup(fd),
+	    EVBUFFER_DATA(buf), EVBUFFER_LENGTH(buf));
+	evbuffer_free(buf);
+	if (retval != 0)
+		return (0);
+	log_debug("%s: id %u: %s", __func__, id, cmd);
+	return (id);
+}
+
+/* Server side: ask the runner to kill a job. */
+void
+job_runner_kill(u_int id)
+{
+	struct msg_job_kill	msg;
+
+	if (job_runner_peer == NULL)
+		return;
+	msg.id = id;
+	proc_send(job_runner_peer, MSG_JOB_KILL, -1, &msg, sizeof msg);
+}
@@ -50,6 +50,7 @@ struct job {
 
 	char			*cmd;
 	pid_t			 pid;
+	u_int			 runnerid;
 	int			 status;
 
 	int			 fd;
@@ -74,7 +75,8 @@ job_run(const char *cmd, struct session *s, const char *cwd,
 {
 	struct job	*job;
 	struct environ	*env;
-	pid_t		 pid;
+	pid_t		 pid = -1;
+	u_int		 runnerid = 0;
 	int		 nullfd, out[2], master;
 	const char	*home;
 	sigset_t	 set, oldset;
@@ -89,7 +91,23 @@ job_run(const char *cmd, struct session *s, const char *cwd,
 	sigfillset(&set);
 	sigprocmask(SIG_BLOCK, &set, &oldset);
 
-	if (flags & JOB_PTY) {
+	/*
+	 * Pooled jobs go to the job runner process, which forks them from its
+	 * small image instead of duplicating the whole server. If the runner
+	 * is not available, fall back to forking here.
+	 */
+	if ((flags & JOB_POOLED) && (~flags & JOB_PTY)) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, PF_UNSPEC, out) != 0)
+			goto fail;
+		runnerid = job_runner_run(cmd, cwd, env, out[1]);
+		if (runnerid == 0) {
+			close(out[0]);
+			close(out[1]);
+		}
+	}
+	if (runnerid != 0)
+		pid = -1;
+	else if (flags & JOB_PTY) {
 		memset(&ws, 0, sizeof ws);
 		ws.ws_col = sx;
 		ws.ws_row = sy;
@@ -101,6 +119,8 @@ job_run(const char *cmd, struct session *s, const char *cwd,
 	}
 	log_debug("%s: cmd=%s, cwd=%s", __func__, cmd, cwd == NULL ? "" : cwd);
 
+	if (runnerid != 0)
+		goto skip;
 	switch (pid) {
 	case -1:
 		if (~flags & JOB_PTY) {
@@ -143,6 +163,7 @@ job_run(const char *cmd, struct session *s, const char *cwd,
 		fatal("execl failed");
 	}
 
+skip:
 	sigprocmask(SIG_SETMASK, &oldset, NULL);
 	environ_free(env);
 
@@ -152,6 +173,7 @@ job_run(const char *cmd, struct session *s, const char *cwd,
 
 	job->cmd = xstrdup(cmd);
 	job->pid = pid;
+	job->runnerid = runnerid;
 	job->status = 0;
 
 	LIST_INSERT_HEAD(&all_jobs, job, entry);
@@ -197,6 +219,8 @@ job_free(struct job *job)
 
 	if (job->pid != -1)
 		kill(job->pid, SIGTERM);
+	else if (job->runnerid != 0)
+		job_runner_kill(job->runnerid);
 	if (job->event != NULL)
 		bufferevent_free(job->event);
 	if (job->fd != -1)
@@ -304,6 +328,31 @@ job_check_died(pid_t pid, int status)
 	}
 }
 
+/* Pooled job died (the job runner reported its exit status). */
+void
+job_runner_died(u_int id, int status)
+{
+	struct job	*job;
+
+	LIST_FOREACH(job, &all_jobs, entry) {
+		if (id == job->runnerid)
+			break;
+	}
+	if (job == NULL)
+		return;
+	log_debug("pooled job died %p: %s, id %u", job, job->cmd, id);
+
+	job->runnerid = 0;
+	job->status = status;
+
+	if (job->state == JOB_CLOSED) {
+		if (job->completecb != NULL)
+			job->completecb(job);
+		job_free(job);
+	} else
+		job->state = JOB_DEAD;
+}
+
 /* Get job status. */
 int
 job_get_status(struct job *job)
@@ -334,6 +383,8 @@ job_kill_all(void)
 	LIST_FOREACH(job, &all_jobs, entry) {
 		if (job->pid != -1)
 			kill(job->pid, SIGTERM);
+		else if (job->runnerid != 0)
+			job_runner_kill(job->runnerid);
 	}
 }
 
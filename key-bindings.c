@@ -72,6 +72,9 @@ static int key_table_cmp(struct key_table *, struct key_table *);
 RB_GENERATE_STATIC(key_tables, key_table, entry, key_table_cmp);
 static struct key_tables key_tables = RB_INITIALIZER(&key_tables);
 
+/* Most recently looked up table, since lookups cluster on one table. */
+static struct key_table *key_bindings_last_table;
+
 static int
 key_table_cmp(struct key_table *table1, struct key_table *table2)
 {
@@ -96,24 +99,55 @@ key_bindings_free(struct key_binding *bd)
 	free(bd);
 }
 
+/* Rebuild the sorted array of bindings for fast lookup. */
+static void
+key_bindings_sort(struct key_table *table)
+{
+	struct key_binding	*bd;
+	u_int			 n = 0;
+
+	RB_FOREACH(bd, key_bindings, &table->key_bindings)
+		n++;
+	table->sorted = xreallocarray(table->sorted, n,
+	    sizeof *table->sorted);
+	table->sorted_count = n;
+
+	n = 0;
+	RB_FOREACH(bd, key_bindings, &table->key_bindings)
+		table->sorted[n++] = bd;
+	table->sorted_dirty = 0;
+}
+
 struct key_table *
 key_bindings_get_table(const char *name, int create)
 {
 	struct key_table	table_find, *table;
 
+	table = key_bindings_last_table;
+	if (table != NULL && strcmp(table->name, name) == 0)
+		return (table);
+
 	table_find.name = name;
 	table = RB_FIND(key_tables, &key_tables, &table_find);
-	if (table != NULL || !create)
+	if (table != NULL || !create) {
+		if (table != NULL)
+			key_bindings_last_table = table;
 		return (table);
+	}
 
 	table = xmalloc(sizeof *table);
 	table->name = xstrdup(name);
 	RB_INIT(&table->key_bindings);
 	RB_INIT(&table->default_key_bindings);
 
+	table->sorted = NULL;
+	table->sorted_count = 0;
+	table->sorted_dirty = 0;
+
 	table->references = 1; /* one reference in key_tables */
 	RB_INSERT(key_tables, &key_tables, table);
 
+	key_bindings_last_table = table;
 	return (table);
 }
 
@@ -147,6 +181,10 @@ key_bindings_unref_table(struct key_table *table)
 		key_bindings_free(bd);
 	}
 
+	if (key_bindings_last_table == table)
+		key_bindings_last_table = NULL;
+
+	free(table->sorted);
 	free((void *)table->name);
 	free(table);
 }
@@ -154,10 +192,25 @@ key_bindings_unref_table(struct key_table *table)
 struct key_binding *
 key_bindings_get(struct key_table *table, key_code key)
 {
-	struct key_binding	bd;
-
-	bd.key = key;
-	return (RB_FIND(key_bindings, &table->key_bindings, &bd));
+	struct key_binding	*bd;
+	u_int			 lo, hi, mid;
+
+	if (table->sorted_dirty)
+		key_bindings_sort(table);
+
+	lo = 0;
+	hi = table->sorted_count;
+	while (lo != hi) {
+		mid = lo + (hi - lo) / 2;
+		bd = table->sorted[mid];
+		if (bd->key == key)
+			return (bd);
+		if (bd->key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (NULL);
 }
 
 struct key_binding *
@@ -201,6 +254,7 @@ key_bindings_add(const char *name, key_code key, const char *note, int repeat,
 	if (note != NULL)
 		bd->note = xstrdup(note);
 	RB_INSERT(key_bindings, &table->key_bindings, bd);
+	table->sorted_dirty = 1;
 
 	if (repeat)
 		bd->flags |= KEY_BINDING_REPEAT;
@@ -223,9 +277,12 @@ key_bindings_remove(const char *name, key_code key)
 
 	RB_REMOVE(key_bindings, &table->key_bindings, bd);
 	key_bindings_free(bd);
+	table->sorted_dirty = 1;
 
 	if (RB_EMPTY(&table->key_bindings) &&
 	    RB_EMPTY(&table->default_key_bindings)) {
+		if (key_bindings_last_table == table)
+			key_bindings_last_table = NULL;
 		RB_REMOVE(key_tables, &key_tables, table);
 		key_bindings_unref_table(table);
 	}
@@ -239,6 +296,8 @@ key_bindings_remove_table(const char *name)
 
 	table = key_bindings_get_table(name, 0);
 	if (table != NULL) {
+		if (key_bindings_last_table == table)
+			key_bindings_last_table = NULL;
 		RB_REMOVE(key_tables, &key_tables, table);
 		key_bindings_unref_table(table);
 	}
@@ -18,6 +18,7 @@
 
 #include <sys/types.h>
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "tmux.h"
@@ -158,9 +159,102 @@ key_string_get_modifiers(const char **string)
 	return (modifiers);
 }
 
-/* Lookup a string and convert to a key value. */
+/*
+ * Cache of previous lookups. Key strings are parsed character by character
+ * and named keys searched with strcasecmp, which adds up when automation
+ * sends the same keys over and over, so remember the results.
+ */
+struct key_string_cache_entry {
+	char				*string;
+	key_code			 key;
+
+	RB_ENTRY(key_string_cache_entry) entry;
+};
+RB_HEAD(key_string_cache, key_string_cache_entry);
+
+static int
+key_string_cache_cmp(struct key_string_cache_entry *e1,
+    struct key_string_cache_entry *e2)
+{
+	return (strcmp(e1->string, e2->string));
+}
+RB_GENERATE_STATIC(key_string_cache, key_string_cache_entry, entry,
+    key_string_cache_cmp);
+
+static struct key_string_cache	key_string_cache = RB_INITIALIZER(NULL);
+static u_int			key_string_cache_size;
+#define KEY_STRING_CACHE_MAXIMUM 1024
+
+static key_code	key_string_lookup_string1(const char *);
+
+/*
+ * Cache of key names in the other direction, for listing bindings and
+ * formats. Building a name walks the key table linearly so the results are
+ * kept, which also gives callers a stable string rather than a static
+ * buffer.
+ */
+struct key_string_name_entry {
+	key_code			 key;
+	int				 with_flags;
+	char				*name;
+
+	RB_ENTRY(key_string_name_entry)	 entry;
+};
+RB_HEAD(key_string_names, key_string_name_entry);
+
+static int
+key_string_name_cmp(struct key_string_name_entry *e1,
+    struct key_string_name_entry *e2)
+{
+	if (e1->key < e2->key)
+		return (-1);
+	if (e1->key > e2->key)
+		return (1);
+	if (e1->with_flags < e2->with_flags)
+		return (-1);
+	if (e1->with_flags > e2->with_flags)
+		return (1);
+	return (0);
+}
+RB_GENERATE_STATIC(key_string_names, key_string_name_entry, entry,
+    key_string_name_cmp);
+
+static struct key_string_names	key_string_names = RB_INITIALIZER(NULL);
+static u_int			key_string_names_size;
+
+static const char	*key_string_lookup_key1(key_code, int);
+
+/* Lookup a string and convert to a key value, with caching. */
 key_code
 key_string_lookup_string(const char *string)
+{
+	struct key_string_cache_entry	 find, *e, *e1;
+
+	find.string = (char *)string;
+	e = RB_FIND(key_string_cache, &key_string_cache, &find);
+	if (e != NULL)
+		return (e->key);
+
+	if (key_string_cache_size >= KEY_STRING_CACHE_MAXIMUM) {
+		RB_FOREACH_SAFE(e, key_string_cache, &key_string_cache, e1) {
+			RB_REMOVE(key_string_cache, &key_string_cache, e);
+			free(e->string);
+			free(e);
+		}
+		key_string_cache_size = 0;
+	}
+
+	e = xmalloc(sizeof *e);
+	e->string = xstrdup(string);
+	e->key = key_string_lookup_string1(string);
+	RB_INSERT(key_string_cache, &key_string_cache, e);
+	key_string_cache_size++;
+	return (e->key);
+}
+
+/* Parse a string into a key value. */
+static key_code
+key_string_lookup_string1(const char *string)
 {
 	static const char	*other = "!#()+,-.0123456789:;<=>'\r\t";
 	key_code		 key;
@@ -240,8 +334,8 @@ key_string_lookup_string(const char *string)
 }
 
 /* Convert a key code into string format, with prefix if necessary. */
-const char *
-key_string_lookup_key(key_code key, int with_flags)
+static const char *
+key_string_lookup_key1(key_code key, int with_flags)
 {
 	key_code		 saved = key;
 	static char		 out[64];
@@ -400,3 +494,33 @@ out:
 	}
 	return (out);
 }
+
+/* Convert a key code into string format, with caching. */
+const char *
+key_string_lookup_key(key_code key, int with_flags)
+{
+	struct key_string_name_entry	 find, *e, *e1;
+
+	find.key = key;
+	find.with_flags = with_flags;
+	e = RB_FIND(key_string_names, &key_string_names, &find);
+	if (e != NULL)
+		return (e->name);
+
+	if (key_string_names_size >= KEY_STRING_CACHE_MAXIMUM) {
+		RB_FOREACH_SAFE(e, key_string_names, &key_string_names, e1) {
+			RB_REMOVE(key_string_names, &key_string_names, e);
+			free(e->name);
+			free(e);
+		}
+		key_string_names_size = 0;
+	}
+
+	e = xmalloc(sizeof *e);
+	e->key = key;
+	e->with_flags = with_flags;
+	e->name = xstrdup(key_string_lookup_key1(key, with_flags));
+	RB_INSERT(key_string_names, &key_string_names, e);
+	key_string_names_size++;
+	return (e->name);
+}
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "tmux.h"
@@ -70,6 +71,27 @@ layout_dump(struct layout_cell *root)
 	return (out);
 }
 
+/*
+ * Dump a window's layout, caching the string on the window. The formats that
+ * expand to the layout are evaluated every status interval but the layout
+ * itself rarely changes; anything changing it invalidates the cache.
+ */
+const char *
+layout_dump_cached(struct window *w)
+{
+	if (w->layout_cache == NULL)
+		w->layout_cache = layout_dump(w->layout_root);
+	return (w->layout_cache);
+}
+
+/* Discard a window's cached layout string after the layout has changed. */
+void
+layout_invalidate(struct window *w)
+{
+	free(w->layout_cache);
+	w->layout_cache = NULL;
+}
+
 /* Append information for a single cell. */
 static int
 layout_append(struct layout_cell *lc, char *buf, size_t len)
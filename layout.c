@@ -33,6 +33,7 @@
  * cell a pointer to its parent cell.
  */
 
+static void	layout_fix_panes1(struct window *, struct layout_cell *, int);
 static u_int	layout_resize_check(struct window *, struct layout_cell *,
 		    enum layout_type);
 static int	layout_resize_pane_grow(struct window *, struct layout_cell *,
@@ -236,6 +237,7 @@ layout_fix_offsets(struct window *w)
 	lc->yoff = 0;
 
 	layout_fix_offsets1(lc);
+	layout_invalidate(w);
 }
 
 /* Is this a top cell? */
@@ -284,29 +286,42 @@ layout_add_border(struct window *w, struct layout_cell *lc, int status)
 	return (0);
 }
 
+/* Update pane offsets and sizes for the panes below a cell. */
+static void
+layout_fix_panes1(struct window *w, struct layout_cell *lc, int status)
+{
+	struct layout_cell	*lcchild;
+	struct window_pane	*wp;
+
+	if (lc->type != LAYOUT_WINDOWPANE) {
+		TAILQ_FOREACH(lcchild, &lc->cells, entry)
+			layout_fix_panes1(w, lcchild, status);
+		return;
+	}
+	if ((wp = lc->wp) == NULL)
+		return;
+
+	wp->xoff = lc->xoff;
+	wp->yoff = lc->yoff;
+
+	if (layout_add_border(w, lc, status)) {
+		if (status == PANE_STATUS_TOP)
+			wp->yoff++;
+		window_pane_resize(wp, lc->sx, lc->sy - 1);
+	} else
+		window_pane_resize(wp, lc->sx, lc->sy);
+}
+
 /* Update pane offsets and sizes based on their cells. */
 void
 layout_fix_panes(struct window *w)
 {
-	struct window_pane	*wp;
-	struct layout_cell	*lc;
-	int			 status;
+	int	status;
 
 	status = options_get_number(w->options, "pane-border-status");
-	TAILQ_FOREACH(wp, &w->panes, entry) {
-		if ((lc = wp->layout_cell) == NULL)
-			continue;
-
-		wp->xoff = lc->xoff;
-		wp->yoff = lc->yoff;
-
-		if (layout_add_border(w, lc, status)) {
-			if (status == PANE_STATUS_TOP)
-				wp->yoff++;
-			window_pane_resize(wp, lc->sx, lc->sy - 1);
-		} else
-			window_pane_resize(wp, lc->sx, lc->sy);
-	}
+	if (w->layout_root != NULL)
+		layout_fix_panes1(w, w->layout_root, status);
+	layout_invalidate(w);
 }
 
 /* Count the number of available cells in a layout. */
@@ -598,9 +613,21 @@ layout_resize_layout(struct window *w, struct layout_cell *lc,
 			break;
 	}
 
-	/* Fix cell offsets. */
-	layout_fix_offsets(w);
-	layout_fix_panes(w);
+	/*
+	 * Fix cell offsets and pane sizes. The adjustment only moved space
+	 * between cells under lc's parent - the parent's own size and offset
+	 * are unchanged - so only that subtree needs to be walked, not the
+	 * whole tree.
+	 */
+	if (lc->parent != NULL) {
+		layout_fix_offsets1(lc->parent);
+		layout_fix_panes1(w, lc->parent,
+		    options_get_number(w->options, "pane-border-status"));
+		layout_invalidate(w);
+	} else {
+		layout_fix_offsets(w);
+		layout_fix_panes(w);
+	}
 	notify_window("window-layout-changed", w);
 }
 
@@ -26,10 +26,41 @@
 
 #include "tmux.h"
 
-static FILE	*log_file;
-static int	 log_level;
+static FILE		*log_file;
+static int		 log_level;
+static struct evbuffer	*log_buffer;
+static struct timeval	 log_last_flush;
+
+/*
+ * Writing and flushing the log file for every message is expensive enough to
+ * change the timing being debugged when verbose logging is left on under
+ * load. Batch messages in a buffer and flush when it grows past a size or
+ * when the oldest message reaches an age; fatal errors and closing flush
+ * immediately so nothing is lost.
+ */
+#define LOG_FLUSH_BYTES	8192
+#define LOG_FLUSH_USEC	100000
+
+/*
+ * Flight recorder: a fixed ring of recent noteworthy events (commands fired,
+ * tty flushes, input batches, resizes). Recording is always on and cheap so
+ * there is something to look at after a hiccup even when verbose logging was
+ * off; the ring is dumped by show-flight-recorder and appended to the log by
+ * fatal errors.
+ */
+#define LOG_RECORD_ENTRIES	1024
+#define LOG_RECORD_LENGTH	120
+
+struct log_record_entry {
+	struct timeval	tv;
+	char		msg[LOG_RECORD_LENGTH];
+};
+static struct log_record_entry	log_records[LOG_RECORD_ENTRIES];
+static u_int			log_record_count;
 
 static void	 log_event_cb(int, const char *);
+static void	 log_flush(void);
+static void	 log_record_fatal(void);
 static void	 log_vwrite(const char *, va_list);
 
 /* Log callback for libevent. */
@@ -69,6 +100,10 @@ log_open(const char *name)
 	if (log_file == NULL)
 		return;
 
+	if (log_buffer == NULL)
+		log_buffer = evbuffer_new();
+	gettimeofday(&log_last_flush, NULL);
+
 	setvbuf(log_file, NULL, _IOLBF, 0);
 	event_set_log_callback(log_event_cb);
 }
@@ -92,19 +127,100 @@ log_toggle(const char *name)
 void
 log_close(void)
 {
-	if (log_file != NULL)
+	if (log_file != NULL) {
+		log_flush();
 		fclose(log_file);
+	}
 	log_file = NULL;
 
 	event_set_log_callback(NULL);
 }
 
+/* Flush any buffered log messages to the file. */
+static void
+log_flush(void)
+{
+	size_t	len;
+
+	if (log_file == NULL || log_buffer == NULL)
+		return;
+	len = EVBUFFER_LENGTH(log_buffer);
+	if (len == 0)
+		return;
+
+	if (fwrite(EVBUFFER_DATA(log_buffer), 1, len, log_file) != len)
+		exit(1);
+	fflush(log_file);
+	evbuffer_drain(log_buffer, len);
+}
+
+/* Record an event in the flight recorder ring. */
+void
+log_record(const char *fmt, ...)
+{
+	struct log_record_entry	*e;
+	va_list			 ap;
+
+	e = &log_records[log_record_count % LOG_RECORD_ENTRIES];
+	log_record_count++;
+
+	gettimeofday(&e->tv, NULL);
+	va_start(ap, fmt);
+	vsnprintf(e->msg, sizeof e->msg, fmt, ap);
+	va_end(ap);
+}
+
+/* Pass each recorded event, oldest first, to a callback. */
+void
+log_record_dump(void (*cb)(void *, const char *), void *arg)
+{
+	struct log_record_entry	*e;
+	u_int			 i, n;
+	char			 line[LOG_RECORD_LENGTH + 32];
+
+	n = log_record_count;
+	if (n > LOG_RECORD_ENTRIES)
+		i = n - LOG_RECORD_ENTRIES;
+	else
+		i = 0;
+	for (; i < n; i++) {
+		e = &log_records[i % LOG_RECORD_ENTRIES];
+		snprintf(line, sizeof line, "%lld.%06d %s",
+		    (long long)e->tv.tv_sec, (int)e->tv.tv_usec, e->msg);
+		cb(arg, line);
+	}
+}
+
+/* Append the flight recorder to the log file on a fatal error. */
+static void
+log_record_fatal(void)
+{
+	struct log_record_entry	*e;
+	u_int			 i, n;
+
+	if (log_file == NULL || log_record_count == 0)
+		return;
+
+	n = log_record_count;
+	if (n > LOG_RECORD_ENTRIES)
+		i = n - LOG_RECORD_ENTRIES;
+	else
+		i = 0;
+	fprintf(log_file, "flight recorder (%u events):\n", n - i);
+	for (; i < n; i++) {
+		e = &log_records[i % LOG_RECORD_ENTRIES];
+		fprintf(log_file, "%lld.%06d %s\n", (long long)e->tv.tv_sec,
+		    (int)e->tv.tv_usec, e->msg);
+	}
+	fflush(log_file);
+}
+
 /* Write a log message. */
 static void
 log_vwrite(const char *msg, va_list ap)
 {
 	char		*fmt, *out;
-	struct timeval	 tv;
+	struct timeval	 tv, age;
 
 	if (log_file == NULL)
 		return;
@@ -115,10 +231,16 @@ log_vwrite(const char *msg, va_list ap)
 		exit(1);
 
 	gettimeofday(&tv, NULL);
-	if (fprintf(log_file, "%lld.%06d %s\n", (long long)tv.tv_sec,
-	    (int)tv.tv_usec, out) == -1)
+	if (evbuffer_add_printf(log_buffer, "%lld.%06d %s\n",
+	    (long long)tv.tv_sec, (int)tv.tv_usec, out) == -1)
 		exit(1);
-	fflush(log_file);
+
+	timersub(&tv, &log_last_flush, &age);
+	if (EVBUFFER_LENGTH(log_buffer) >= LOG_FLUSH_BYTES ||
+	    age.tv_sec != 0 || age.tv_usec >= LOG_FLUSH_USEC) {
+		log_flush();
+		memcpy(&log_last_flush, &tv, sizeof log_last_flush);
+	}
 
 	free(out);
 	free(fmt);
@@ -150,6 +272,8 @@ fatal(const char *msg, ...)
 		exit(1);
 	log_vwrite(fmt, ap);
 	va_end(ap);
+	log_flush();
+	log_record_fatal();
 	exit(1);
 }
 
@@ -165,5 +289,7 @@ fatalx(const char *msg, ...)
 		exit(1);
 	log_vwrite(fmt, ap);
 	va_end(ap);
+	log_flush();
+	log_record_fatal();
 	exit(1);
 }
@@ -35,6 +35,7 @@ struct menu_data {
 
 	struct menu		*menu;
 	int			 choice;
+	int			 drawn;
 
 	menu_choice_cb		 cb;
 	void			*data;
@@ -160,6 +161,47 @@ menu_draw_cb(struct client *c, __unused struct screen_redraw_ctx *ctx0)
 		tty_draw_line(tty, s, 0, i, menu->width + 4, px, py + i,
 		    &grid_default_cell, NULL);
 	}
+	md->drawn = 1;
+}
+
+/*
+ * Redraw only the menu lines affected by a change of choice, rather than
+ * forcing a full overlay redraw for every navigation key.
+ */
+static void
+menu_redraw_choice(struct client *c, struct menu_data *md, int old)
+{
+	struct tty		*tty = &c->tty;
+	struct screen		*s = &md->s;
+	struct menu		*menu = md->menu;
+	struct screen_write_ctx	 ctx;
+	struct grid_cell	 gc;
+
+	if (md->choice == old)
+		return;
+	if (!md->drawn || (c->flags & CLIENT_REDRAWOVERLAY)) {
+		c->flags |= CLIENT_REDRAWOVERLAY;
+		return;
+	}
+	style_apply(&gc, c->session->curw->window->options, "mode-style", NULL);
+
+	screen_write_start(&ctx, s);
+	screen_write_cursormove(&ctx, 0, 0, 0);
+	if (old != -1)
+		screen_write_menu_line(&ctx, menu, old, md->choice, &gc);
+	if (md->choice != -1)
+		screen_write_menu_line(&ctx, menu, md->choice, md->choice,
+		    &gc);
+	screen_write_stop(&ctx);
+
+	if (old != -1) {
+		tty_draw_line(tty, s, 0, 1 + old, menu->width + 4, md->px,
+		    md->py + 1 + old, &grid_default_cell, NULL);
+	}
+	if (md->choice != -1) {
+		tty_draw_line(tty, s, 0, 1 + md->choice, menu->width + 4,
+		    md->px, md->py + 1 + md->choice, &grid_default_cell, NULL);
+	}
 }
 
 static void
@@ -186,6 +228,7 @@ menu_key_cb(struct client *c, struct key_event *event)
 	struct mouse_event		*m = &event->m;
 	u_int				 i;
 	int				 count = menu->count, old = md->choice;
+	int				 stop;
 	const char			*name;
 	const struct menu_item		*item;
 	struct cmdq_state		*state;
@@ -206,15 +249,14 @@ menu_key_cb(struct client *c, struct key_event *event)
 				return (1);
 			if (md->choice != -1) {
 				md->choice = -1;
-				c->flags |= CLIENT_REDRAWOVERLAY;
+				menu_redraw_choice(c, md, old);
 			}
 			return (0);
 		}
 		if (MOUSE_RELEASE(m->b))
 			goto chosen;
 		md->choice = m->y - (md->py + 1);
-		if (md->choice != old)
-			c->flags |= CLIENT_REDRAWOVERLAY;
+		menu_redraw_choice(c, md, old);
 		return (0);
 	}
 	for (i = 0; i < (u_int)count; i++) {
@@ -229,16 +271,15 @@ menu_key_cb(struct client *c, struct key_event *event)
 	switch (event->key & ~KEYC_MASK_FLAGS) {
 	case KEYC_UP:
 	case 'k':
-		if (old == -1)
-			old = 0;
+		stop = (old == -1) ? 0 : old;
 		do {
 			if (md->choice == -1 || md->choice == 0)
 				md->choice = count - 1;
 			else
 				md->choice--;
 			name = menu->items[md->choice].name;
-		} while ((name == NULL || *name == '-') && md->choice != old);
-		c->flags |= CLIENT_REDRAWOVERLAY;
+		} while ((name == NULL || *name == '-') && md->choice != stop);
+		menu_redraw_choice(c, md, old);
 		return (0);
 	case KEYC_BSPACE:
 		if (~md->flags & MENU_TAB)
@@ -252,16 +293,15 @@ menu_key_cb(struct client *c, struct key_event *event)
 		/* FALLTHROUGH */
 	case KEYC_DOWN:
 	case 'j':
-		if (old == -1)
-			old = 0;
+		stop = (old == -1) ? 0 : old;
 		do {
 			if (md->choice == -1 || md->choice == count - 1)
 				md->choice = 0;
 			else
 				md->choice++;
 			name = menu->items[md->choice].name;
-		} while ((name == NULL || *name == '-') && md->choice != old);
-		c->flags |= CLIENT_REDRAWOVERLAY;
+		} while ((name == NULL || *name == '-') && md->choice != stop);
+		menu_redraw_choice(c, md, old);
 		return (0);
 	case 'g':
 	case KEYC_PPAGE:
@@ -274,7 +314,7 @@ menu_key_cb(struct client *c, struct key_event *event)
 			md->choice++;
 		if (md->choice == count)
 			md->choice = -1;
-		c->flags |= CLIENT_REDRAWOVERLAY;
+		menu_redraw_choice(c, md, old);
 		break;
 	case 'G':
 	case KEYC_NPAGE:
@@ -284,7 +324,7 @@ menu_key_cb(struct client *c, struct key_event *event)
 			md->choice += 5;
 		while (md->choice != -1 && (name == NULL || *name == '-'))
 			md->choice--;
-		c->flags |= CLIENT_REDRAWOVERLAY;
+		menu_redraw_choice(c, md, old);
 		break;
 	case '\006': /* C-f */
 		break;
@@ -375,5 +415,7 @@ menu_display(struct menu *menu, int flags, struct cmdq_item *item, u_int px,
 
 	server_client_set_overlay(c, 0, NULL, menu_mode_cb, menu_draw_cb,
 	    menu_key_cb, menu_free_cb, md);
+	server_client_set_overlay_box(c, md->px, md->py, menu->width + 4,
+	    screen_size_y(&md->s));
 	return (0);
 }
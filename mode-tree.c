@@ -28,6 +28,16 @@
 struct mode_tree_item;
 TAILQ_HEAD(mode_tree_list, mode_tree_item);
 
+RB_HEAD(mode_tree_saved, mode_tree_item);
+
+/* Fuzzy filter match for one item, indexed by tag. */
+struct mode_tree_match {
+	uint64_t			 tag;
+	int				 score;
+	RB_ENTRY(mode_tree_match)	 entry;
+};
+RB_HEAD(mode_tree_matches, mode_tree_match);
+
 struct mode_tree_data {
 	int			  dead;
 	u_int			  references;
@@ -49,6 +59,7 @@ struct mode_tree_data {
 
 	struct mode_tree_list	  children;
 	struct mode_tree_list	  saved;
+	struct mode_tree_saved	  saved_by_tag;
 
 	struct mode_tree_line	 *line_list;
 	u_int			  line_size;
@@ -67,6 +78,9 @@ struct mode_tree_data {
 	char			 *search;
 	char			 *filter;
 	int			  no_matches;
+
+	struct mode_tree_matches  matches;
+	char			 *matched_filter;
 };
 
 struct mode_tree_item {
@@ -84,6 +98,7 @@ struct mode_tree_item {
 
 	struct mode_tree_list		 children;
 	TAILQ_ENTRY(mode_tree_item)	 entry;
+	RB_ENTRY(mode_tree_item)	 saved_entry;
 };
 
 struct mode_tree_line {
@@ -102,6 +117,43 @@ struct mode_tree_menu {
 
 static void mode_tree_free_items(struct mode_tree_list *);
 
+/* Saved items from the last build indexed by tag so reuse is O(log n). */
+static int
+mode_tree_saved_cmp(struct mode_tree_item *mti1, struct mode_tree_item *mti2)
+{
+	if (mti1->tag < mti2->tag)
+		return (-1);
+	if (mti1->tag > mti2->tag)
+		return (1);
+	return (0);
+}
+RB_GENERATE_STATIC(mode_tree_saved, mode_tree_item, saved_entry,
+    mode_tree_saved_cmp);
+
+static int
+mode_tree_match_cmp(struct mode_tree_match *mtm1, struct mode_tree_match *mtm2)
+{
+	if (mtm1->tag < mtm2->tag)
+		return (-1);
+	if (mtm1->tag > mtm2->tag)
+		return (1);
+	return (0);
+}
+RB_GENERATE_STATIC(mode_tree_matches, mode_tree_match, entry,
+    mode_tree_match_cmp);
+
+/* Add saved items to the tag index, keeping the first of duplicate tags. */
+static void
+mode_tree_index_saved(struct mode_tree_data *mtd, struct mode_tree_list *mtl)
+{
+	struct mode_tree_item	*mti;
+
+	TAILQ_FOREACH(mti, mtl, entry) {
+		RB_INSERT(mode_tree_saved, &mtd->saved_by_tag, mti);
+		mode_tree_index_saved(mtd, &mti->children);
+	}
+}
+
 static const struct menu_item mode_tree_menu_items[] = {
 	{ "Scroll Left", '<', NULL },
 	{ "Scroll Right", '>', NULL },
@@ -111,21 +163,6 @@ static const struct menu_item mode_tree_menu_items[] = {
 	{ NULL, KEYC_NONE, NULL }
 };
 
-static struct mode_tree_item *
-mode_tree_find_item(struct mode_tree_list *mtl, uint64_t tag)
-{
-	struct mode_tree_item	*mti, *child;
-
-	TAILQ_FOREACH(mti, mtl, entry) {
-		if (mti->tag == tag)
-			return (mti);
-		child = mode_tree_find_item(&mti->children, tag);
-		if (child != NULL)
-			return (child);
-	}
-	return (NULL);
-}
-
 static void
 mode_tree_free_item(struct mode_tree_item *mti)
 {
@@ -148,6 +185,158 @@ mode_tree_free_items(struct mode_tree_list *mtl)
 	}
 }
 
+/*
+ * A filter typed at the prompt without any #{} is treated as a fuzzy query
+ * rather than a format: each character must appear in order in the item name
+ * or text, with matches at word starts and consecutive matches scoring
+ * higher. Matches are scored against the text materialized by the build
+ * callback so nothing is expanded per keystroke, and the surviving tags are
+ * kept so that when another character is typed only the previous survivors
+ * are rescored (adding a character can only narrow a subsequence match).
+ */
+static int
+mode_tree_fuzzy_score(const char *text, const char *query)
+{
+	const char	*cp;
+	int		 score = 0, boundary = 1, run = 0;
+
+	if (text == NULL)
+		return (-1);
+	for (cp = text; *query != '\0'; cp++) {
+		if (*cp == '\0')
+			return (-1);
+		if (tolower((u_char)*cp) != tolower((u_char)*query)) {
+			boundary = (strchr(" -_.,:/", *cp) != NULL);
+			run = 0;
+			continue;
+		}
+		score += 1 + run;
+		if (boundary)
+			score += 2;
+		boundary = 0;
+		run++;
+		query++;
+	}
+	return (score);
+}
+
+static int
+mode_tree_fuzzy_match(struct mode_tree_data *mtd, struct mode_tree_item *mti,
+    int narrowed)
+{
+	struct mode_tree_match	 find;
+	int			 score, text_score;
+
+	if (narrowed) {
+		find.tag = mti->tag;
+		if (RB_FIND(mode_tree_matches, &mtd->matches, &find) == NULL)
+			return (-1);
+	}
+
+	score = mode_tree_fuzzy_score(mti->name, mtd->filter);
+	text_score = mode_tree_fuzzy_score(mti->text, mtd->filter);
+	if (text_score > score)
+		score = text_score;
+	return (score);
+}
+
+static void
+mode_tree_fuzzy_clear(struct mode_tree_data *mtd)
+{
+	struct mode_tree_match	*mtm, *mtm1;
+
+	RB_FOREACH_SAFE(mtm, mode_tree_matches, &mtd->matches, mtm1) {
+		RB_REMOVE(mode_tree_matches, &mtd->matches, mtm);
+		free(mtm);
+	}
+	free(mtd->matched_filter);
+	mtd->matched_filter = NULL;
+}
+
+/* Prune items that do not match, keeping parents of items that do. */
+static u_int
+mode_tree_fuzzy_prune(struct mode_tree_data *mtd, struct mode_tree_list *mtl,
+    struct mode_tree_matches *new_matches, int narrowed)
+{
+	struct mode_tree_item	*mti, *mti1;
+	struct mode_tree_match	*mtm;
+	u_int			 kept = 0;
+	int			 score;
+
+	TAILQ_FOREACH_SAFE(mti, mtl, entry, mti1) {
+		score = mode_tree_fuzzy_match(mtd, mti, narrowed);
+		if (score >= 0) {
+			mtm = xcalloc(1, sizeof *mtm);
+			mtm->tag = mti->tag;
+			mtm->score = score;
+			if (RB_INSERT(mode_tree_matches, new_matches,
+			    mtm) != NULL)
+				free(mtm);
+		}
+		if (mode_tree_fuzzy_prune(mtd, &mti->children, new_matches,
+		    narrowed) == 0 && score < 0) {
+			TAILQ_REMOVE(mtl, mti, entry);
+			mode_tree_free_item(mti);
+			continue;
+		}
+		if (!TAILQ_EMPTY(&mti->children))
+			mti->expanded = 1;
+		kept++;
+	}
+	return (kept);
+}
+
+static void
+mode_tree_fuzzy_filter(struct mode_tree_data *mtd)
+{
+	struct mode_tree_matches	 new_matches = RB_INITIALIZER();
+	struct mode_tree_match		*mtm, *mtm1;
+	int				 narrowed;
+
+	narrowed = (mtd->matched_filter != NULL &&
+	    strncmp(mtd->matched_filter, mtd->filter,
+	    strlen(mtd->matched_filter)) == 0);
+
+	mode_tree_fuzzy_prune(mtd, &mtd->children, &new_matches, narrowed);
+
+	RB_FOREACH_SAFE(mtm, mode_tree_matches, &mtd->matches, mtm1) {
+		RB_REMOVE(mode_tree_matches, &mtd->matches, mtm);
+		free(mtm);
+	}
+	RB_FOREACH_SAFE(mtm, mode_tree_matches, &new_matches, mtm1) {
+		RB_REMOVE(mode_tree_matches, &new_matches, mtm);
+		RB_INSERT(mode_tree_matches, &mtd->matches, mtm);
+	}
+	free(mtd->matched_filter);
+	mtd->matched_filter = xstrdup(mtd->filter);
+}
+
+/* Move the current line to the highest-scoring fuzzy match. */
+static void
+mode_tree_fuzzy_best(struct mode_tree_data *mtd)
+{
+	struct mode_tree_match	*mtm, find;
+	u_int			 i, best_line = 0;
+	int			 best = -1, current = -1;
+
+	for (i = 0; i < mtd->line_size; i++) {
+		find.tag = mtd->line_list[i].item->tag;
+		mtm = RB_FIND(mode_tree_matches, &mtd->matches, &find);
+		if (mtm == NULL)
+			continue;
+		if (i == mtd->current)
+			current = mtm->score;
+		if (mtm->score > best) {
+			best = mtm->score;
+			best_line = i;
+		}
+	}
+	if (best > current) {
+		mtd->current = best_line;
+		mtd->offset = 0;
+	}
+}
+
 static void
 mode_tree_check_selected(struct mode_tree_data *mtd)
 {
@@ -402,6 +591,7 @@ mode_tree_start(struct window_pane *wp, struct args *args,
 	mtd->heightcb = heightcb;
 
 	TAILQ_INIT(&mtd->children);
+	RB_INIT(&mtd->matches);
 
 	*s = &mtd->screen;
 	screen_init(*s, screen_size_x(&wp->base), screen_size_y(&wp->base), 0);
@@ -457,14 +647,29 @@ mode_tree_build(struct mode_tree_data *mtd)
 
 	TAILQ_CONCAT(&mtd->saved, &mtd->children, entry);
 	TAILQ_INIT(&mtd->children);
+	RB_INIT(&mtd->saved_by_tag);
+	mode_tree_index_saved(mtd, &mtd->saved);
 
-	mtd->buildcb(mtd->modedata, &mtd->sort_crit, &tag, mtd->filter);
-	mtd->no_matches = TAILQ_EMPTY(&mtd->children);
-	if (mtd->no_matches)
+	if (mtd->filter != NULL && strstr(mtd->filter, "#{") == NULL) {
 		mtd->buildcb(mtd->modedata, &mtd->sort_crit, &tag, NULL);
+		mode_tree_fuzzy_filter(mtd);
+		mtd->no_matches = TAILQ_EMPTY(&mtd->children);
+		if (mtd->no_matches)
+			mtd->buildcb(mtd->modedata, &mtd->sort_crit, &tag,
+			    NULL);
+	} else {
+		mode_tree_fuzzy_clear(mtd);
+		mtd->buildcb(mtd->modedata, &mtd->sort_crit, &tag,
+		    mtd->filter);
+		mtd->no_matches = TAILQ_EMPTY(&mtd->children);
+		if (mtd->no_matches)
+			mtd->buildcb(mtd->modedata, &mtd->sort_crit, &tag,
+			    NULL);
+	}
 
 	mode_tree_free_items(&mtd->saved);
 	TAILQ_INIT(&mtd->saved);
+	RB_INIT(&mtd->saved_by_tag);
 
 	mode_tree_clear_lines(mtd);
 	mode_tree_build_lines(mtd, &mtd->children, 0);
@@ -472,6 +677,8 @@ mode_tree_build(struct mode_tree_data *mtd)
 	if (tag == UINT64_MAX)
 		tag = mtd->line_list[mtd->current].item->tag;
 	mode_tree_set_current(mtd, tag);
+	if (mtd->matched_filter != NULL)
+		mode_tree_fuzzy_best(mtd);
 
 	mtd->width = screen_size_x(s);
 	if (mtd->preview)
@@ -502,6 +709,7 @@ mode_tree_free(struct mode_tree_data *mtd)
 
 	free(mtd->search);
 	free(mtd->filter);
+	mode_tree_fuzzy_clear(mtd);
 
 	mtd->dead = 1;
 	mode_tree_remove_ref(mtd);
@@ -525,7 +733,7 @@ mode_tree_add(struct mode_tree_data *mtd, struct mode_tree_item *parent,
     void *itemdata, uint64_t tag, const char *name, const char *text,
     int expanded)
 {
-	struct mode_tree_item	*mti, *saved;
+	struct mode_tree_item	*mti, *saved, find;
 
 	log_debug("%s: %llu, %s %s", __func__, (unsigned long long)tag,
 	    name, (text == NULL ? "" : text));
@@ -539,7 +747,8 @@ mode_tree_add(struct mode_tree_data *mtd, struct mode_tree_item *parent,
 	if (text != NULL)
 		mti->text = xstrdup(text);
 
-	saved = mode_tree_find_item(&mtd->saved, tag);
+	find.tag = tag;
+	saved = RB_FIND(mode_tree_saved, &mtd->saved_by_tag, &find);
 	if (saved != NULL) {
 		if (parent == NULL || parent->expanded)
 			mti->tagged = saved->tagged;
@@ -840,18 +1049,21 @@ mode_tree_search_free(void *data)
 
 static int
 mode_tree_filter_callback(__unused struct client *c, void *data, const char *s,
-    __unused int done)
+    int done)
 {
 	struct mode_tree_data	*mtd = data;
 
 	if (mtd->dead)
 		return (0);
 
+	if (!done && s != NULL && (*s == '=' || *s == '+' || *s == '-'))
+		s++;
 	if (mtd->filter != NULL)
 		free(mtd->filter);
-	if (s == NULL || *s == '\0')
+	if (s == NULL || *s == '\0') {
 		mtd->filter = NULL;
-	else
+		mode_tree_fuzzy_clear(mtd);
+	} else
 		mtd->filter = xstrdup(s);
 
 	mode_tree_build(mtd);
@@ -1136,7 +1348,7 @@ mode_tree_key(struct mode_tree_data *mtd, struct client *c, key_code *key,
 		mtd->references++;
 		status_prompt_set(c, NULL, "(filter) ", mtd->filter,
 		    mode_tree_filter_callback, mode_tree_filter_free, mtd,
-		    PROMPT_NOFORMAT);
+		    PROMPT_NOFORMAT|PROMPT_INCREMENTAL);
 		break;
 	case 'v':
 		mtd->preview = !mtd->preview;
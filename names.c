@@ -30,13 +30,19 @@ static int	 name_time_expired(struct window *, struct timeval *);
 
 static char	*format_window_name(struct window *);
 
+/*
+ * One timer is shared by all windows and armed for whichever throttled
+ * window is due soonest, instead of a pending timer per window. Its only job
+ * is to wake the event loop, which checks every window on the way out.
+ */
+static struct event	 name_timer;
+
 static void
-name_time_callback(__unused int fd, __unused short events, void *arg)
+name_time_callback(__unused int fd, __unused short events,
+    __unused void *arg)
 {
-	struct window	*w = arg;
-
 	/* The event loop will call check_window_name for us on the way out. */
-	log_debug("@%u name timer expired", w->id);
+	log_debug("name timer expired");
 }
 
 static int
@@ -53,7 +59,7 @@ name_time_expired(struct window *w, struct timeval *tv)
 void
 check_window_name(struct window *w)
 {
-	struct timeval	 tv, next;
+	struct timeval	 tv, next, due, pending;
 	char		*name;
 	int		 left;
 
@@ -72,14 +78,18 @@ check_window_name(struct window *w)
 	gettimeofday(&tv, NULL);
 	left = name_time_expired(w, &tv);
 	if (left != 0) {
-		if (!event_initialized(&w->name_event))
-			evtimer_set(&w->name_event, name_time_callback, w);
-		if (!evtimer_pending(&w->name_event, NULL)) {
+		if (!event_initialized(&name_timer))
+			evtimer_set(&name_timer, name_time_callback, NULL);
+
+		/* Move the shared timer forward if this window is sooner. */
+		timerclear(&next);
+		next.tv_usec = left;
+		timeradd(&tv, &next, &due);
+		if (!evtimer_pending(&name_timer, &pending) ||
+		    timercmp(&due, &pending, <)) {
 			log_debug("@%u name timer queued (%d left)", w->id,
 			    left);
-			timerclear(&next);
-			next.tv_usec = left;
-			event_add(&w->name_event, &next);
+			event_add(&name_timer, &next);
 		} else {
 			log_debug("@%u name timer already queued (%d left)",
 			    w->id, left);
@@ -87,8 +97,6 @@ check_window_name(struct window *w)
 		return;
 	}
 	memcpy(&w->name_time, &tv, sizeof w->name_time);
-	if (event_initialized(&w->name_event))
-		evtimer_del(&w->name_event);
 
 	w->active->flags &= ~PANE_CHANGED;
 
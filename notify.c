@@ -18,6 +18,7 @@
 
 #include <sys/types.h>
 
+#include <fnmatch.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -34,6 +35,112 @@ struct notify_entry {
 	struct cmd_find_state	 fs;
 };
 
+/*
+ * Hooks matched by the async-hooks option run on their own queues, drained
+ * alongside the client queues, so a slow hook command does not stall other
+ * commands. Each hook name has one queue: a hook's firings stay ordered with
+ * respect to each other but not to anything else.
+ */
+struct notify_async {
+	char			 *name;
+	struct cmdq_list	 *queue;
+	TAILQ_ENTRY(notify_async) entry;
+};
+#define NOTIFY_ASYNC_MAX 8
+static TAILQ_HEAD(, notify_async) notify_async_queues =
+    TAILQ_HEAD_INITIALIZER(notify_async_queues);
+static u_int notify_async_count;
+
+/* Does the async-hooks option match this hook? */
+static int
+notify_hook_is_async(const char *name)
+{
+	struct options_entry		*o;
+	struct options_array_item	*a;
+	const char			*value;
+
+	o = options_get_only(global_options, "async-hooks");
+	if (o == NULL)
+		return (0);
+	a = options_array_first(o);
+	while (a != NULL) {
+		value = options_array_item_value(a)->string;
+		if (value != NULL && fnmatch(value, name, 0) == 0)
+			return (1);
+		a = options_array_next(a);
+	}
+	return (0);
+}
+
+/*
+ * Get the queue for a hook, or NULL if it is not async (or if too many
+ * distinct async hooks exist already).
+ */
+struct cmdq_list *
+notify_async_queue(const char *name)
+{
+	struct notify_async	*na;
+
+	if (!notify_hook_is_async(name))
+		return (NULL);
+
+	TAILQ_FOREACH(na, &notify_async_queues, entry) {
+		if (strcmp(na->name, name) == 0)
+			return (na->queue);
+	}
+	if (notify_async_count == NOTIFY_ASYNC_MAX)
+		return (NULL);
+
+	na = xcalloc(1, sizeof *na);
+	na->name = xstrdup(name);
+	na->queue = cmdq_new();
+	TAILQ_INSERT_TAIL(&notify_async_queues, na, entry);
+	notify_async_count++;
+	return (na->queue);
+}
+
+/* Process the next item on each async hook queue. */
+u_int
+notify_async_next(void)
+{
+	struct notify_async	*na;
+	u_int			 items = 0;
+
+	TAILQ_FOREACH(na, &notify_async_queues, entry)
+		items += cmdq_next_queue(na->queue, na->name);
+	return (items);
+}
+
+/* Is there a hook for this event anywhere it could be found? */
+static int
+notify_hook_set(const char *name, struct cmd_find_state *fs)
+{
+	if (fs->s != NULL) {
+		if (options_get(fs->s->options, name) != NULL)
+			return (1);
+	} else if (options_get(global_s_options, name) != NULL)
+		return (1);
+	if (fs->wp != NULL && options_get(fs->wp->options, name) != NULL)
+		return (1);
+	if (fs->wl != NULL &&
+	    options_get(fs->wl->window->options, name) != NULL)
+		return (1);
+	return (0);
+}
+
+/* Is any control client attached that may want this event? */
+static int
+notify_any_control_client(void)
+{
+	struct client	*c;
+
+	TAILQ_FOREACH(c, &clients, entry) {
+		if (c->flags & CLIENT_CONTROL)
+			return (1);
+	}
+	return (0);
+}
+
 static void
 notify_hook_formats(struct cmdq_state *state, struct session *s,
     struct window *w, int pane)
@@ -62,6 +169,7 @@ notify_insert_hook(struct cmdq_item *item, struct notify_entry *ne)
 	struct options_entry		*o;
 	struct options_array_item	*a;
 	struct cmd_list			*cmdlist;
+	struct cmdq_list		*queue;
 
 	log_debug("%s: %s", __func__, ne->name);
 
@@ -91,12 +199,17 @@ notify_insert_hook(struct cmdq_item *item, struct notify_entry *ne)
 	cmdq_add_format(new_state, "hook", "%s", ne->name);
 	notify_hook_formats(new_state, s, w, ne->pane);
 
+	queue = notify_async_queue(ne->name);
+
 	a = options_array_first(o);
 	while (a != NULL) {
 		cmdlist = options_array_item_value(a)->cmdlist;
 		if (cmdlist != NULL) {
 			new_item = cmdq_get_command(cmdlist, new_state);
-			item = cmdq_insert_after(item, new_item);
+			if (queue != NULL)
+				cmdq_append_queue(queue, new_item);
+			else
+				item = cmdq_insert_after(item, new_item);
 		}
 		a = options_array_next(a);
 	}
@@ -159,10 +272,22 @@ notify_add(const char *name, struct cmd_find_state *fs, struct client *c,
 	struct notify_entry	*ne;
 	struct cmdq_item	*item;
 
+	cmd_find_invalidate();
+	status_invalidate();
+	journal_event(name, s, w);
+
 	item = cmdq_running(NULL);
 	if (item != NULL && (cmdq_get_flags(item) & CMDQ_STATE_NOHOOKS))
 		return;
 
+	/*
+	 * If nothing subscribes to this event - no control client attached
+	 * and no hook set where notify_insert_hook would look for one - then
+	 * skip the allocation and queued callback entirely.
+	 */
+	if (!notify_any_control_client() && !notify_hook_set(name, fs))
+		return;
+
 	ne = xcalloc(1, sizeof *ne);
 	ne->name = xstrdup(name);
 
@@ -211,12 +336,7 @@ notify_hook(struct cmdq_item *item, const char *name)
 void
 notify_input(struct window_pane *wp, const u_char *buf, size_t len)
 {
-	struct client	*c;
-
-	TAILQ_FOREACH(c, &clients, entry) {
-		if (c->flags & CLIENT_CONTROL)
-			control_notify_input(c, wp, buf, len);
-	}
+	control_notify_input(wp, buf, len);
 }
 
 void
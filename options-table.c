@@ -56,6 +56,9 @@ static const char *options_table_bell_action_list[] = {
 static const char *options_table_visual_bell_list[] = {
 	"off", "on", "both", NULL
 };
+static const char *options_table_width_list[] = {
+	"default", "narrow", "wide", NULL
+};
 static const char *options_table_pane_status_list[] = {
 	"off", "top", "bottom", NULL
 };
@@ -173,6 +176,18 @@ static const char *options_table_status_format_default[] = {
 /* Top-level options. */
 const struct options_table_entry options_table[] = {
 	/* Server options. */
+	{ .name = "async-hooks",
+	  .type = OPTIONS_TABLE_STRING,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .flags = OPTIONS_TABLE_IS_ARRAY,
+	  .default_str = "",
+	  .separator = ",",
+	  .text = "List of patterns matched against hook names. "
+		  "Commands for matching hooks run on a separate queue and "
+		  "do not delay other commands; ordering is preserved for "
+		  "each hook but not between hooks and other commands."
+	},
+
 	{ .name = "backspace",
 	  .type = OPTIONS_TABLE_KEY,
 	  .scope = OPTIONS_TABLE_SERVER,
@@ -190,6 +205,17 @@ const struct options_table_entry options_table[] = {
 		  "When this is reached, the oldest buffer is deleted."
 	},
 
+	{ .name = "buffer-size-limit",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .minimum = 0,
+	  .maximum = INT_MAX,
+	  .default_num = 0,
+	  .text = "The maximum total size of automatic buffers in bytes. "
+		  "When this is exceeded, the oldest buffers are deleted. "
+		  "Zero means no limit."
+	},
+
 	{ .name = "command-alias",
 	  .type = OPTIONS_TABLE_STRING,
 	  .scope = OPTIONS_TABLE_SERVER,
@@ -205,6 +231,27 @@ const struct options_table_entry options_table[] = {
 		  "Each entry is an alias and a command separated by '='."
 	},
 
+	{ .name = "command-time-limit",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .minimum = 0,
+	  .maximum = INT_MAX,
+	  .default_num = 100,
+	  .unit = "milliseconds",
+	  .text = "Time a command may spend finding its targets and running "
+		  "before it is reported to the message log. "
+		  "Zero turns the reports off."
+	},
+
+	{ .name = "config-cache",
+	  .type = OPTIONS_TABLE_FLAG,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .default_num = 1,
+	  .text = "Whether configuration files are cached in a compiled "
+		  "form next to the original and reused while it is "
+		  "unchanged."
+	},
+
 	{ .name = "copy-command",
 	  .type = OPTIONS_TABLE_STRING,
 	  .scope = OPTIONS_TABLE_SERVER,
@@ -266,6 +313,25 @@ const struct options_table_entry options_table[] = {
 	  .text = "Whether to send focus events to applications."
 	},
 
+	{ .name = "hibernate-time",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .minimum = 0,
+	  .maximum = INT_MAX,
+	  .default_num = 300,
+	  .text = "Time in seconds a pane must be idle before its history "
+		  "is packed to save memory. Zero disables packing."
+	},
+
+	{ .name = "history-dedup",
+	  .type = OPTIONS_TABLE_FLAG,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .default_num = 1,
+	  .text = "Whether identical history lines are stored once and "
+		  "shared between panes. Repetitive output such as build "
+		  "logs uses much less memory with this on."
+	},
+
 	{ .name = "history-file",
 	  .type = OPTIONS_TABLE_STRING,
 	  .scope = OPTIONS_TABLE_SERVER,
@@ -274,6 +340,48 @@ const struct options_table_entry options_table[] = {
 		  "Empty does not write a history file."
 	},
 
+	{ .name = "history-index",
+	  .type = OPTIONS_TABLE_FLAG,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .default_num = 0,
+	  .text = "Whether to maintain trigram signatures over pane history "
+		  "so find-output can skip lines that cannot match. "
+		  "Signatures are built in the background while the server "
+		  "is idle."
+	},
+
+	{ .name = "journal-file",
+	  .type = OPTIONS_TABLE_STRING,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .default_str = "",
+	  .text = "Where to journal structural changes - sessions and "
+		  "windows created, closed, renamed and relaid out - "
+		  "between snapshots, for replay by restore-server. "
+		  "Empty does not write a journal."
+	},
+
+	{ .name = "journal-interval",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .minimum = 0,
+	  .maximum = INT_MAX,
+	  .default_num = 1,
+	  .text = "Seconds of journal records batched into a single sync. "
+		  "Zero syncs after every record."
+	},
+
+	{ .name = "memory-limit",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .minimum = 0,
+	  .maximum = INT_MAX,
+	  .default_num = 0,
+	  .text = "Server-wide budget in megabytes for pane history memory. "
+		  "Over budget, the biggest histories are packed down and "
+		  "panes in windows not on any client hibernated; nothing "
+		  "is discarded. Zero means no budget."
+	},
+
 	{ .name = "message-limit",
 	  .type = OPTIONS_TABLE_NUMBER,
 	  .scope = OPTIONS_TABLE_SERVER,
@@ -293,6 +401,19 @@ const struct options_table_entry options_table[] = {
 		  "paste buffers with an escape sequence ('on' only)."
 	},
 
+	{ .name = "status-phase",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_SERVER,
+	  .minimum = 0,
+	  .maximum = 1000,
+	  .default_num = 1000,
+	  .unit = "milliseconds",
+	  .text = "Offset of this server's periodic ticks within the second, "
+		  "so servers sharing a host do not all wake together. "
+		  "The default of 1000 derives a stable offset from the "
+		  "server's pid."
+	},
+
 	{ .name = "terminal-overrides",
 	  .type = OPTIONS_TABLE_STRING,
 	  .scope = OPTIONS_TABLE_SERVER,
@@ -499,6 +620,16 @@ const struct options_table_entry options_table[] = {
 		  "Applications inside panes can use the mouse even when 'off'."
 	},
 
+	{ .name = "pane-pool-size",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_SESSION,
+	  .minimum = 0,
+	  .maximum = 16,
+	  .default_num = 0,
+	  .text = "Number of default shells kept spawned in advance so new "
+		  "panes can start instantly."
+	},
+
 	{ .name = "prefix",
 	  .type = OPTIONS_TABLE_KEY,
 	  .scope = OPTIONS_TABLE_SESSION,
@@ -741,6 +872,18 @@ const struct options_table_entry options_table[] = {
 		  "linked to ('off')."
 	},
 
+	{ .name = "backpressure-limit",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_WINDOW,
+	  .minimum = 0,
+	  .maximum = INT_MAX,
+	  .default_num = 0,
+	  .text = "Number of bytes of output that may be buffered for a "
+		  "client before tmux stops reading from panes in the window "
+		  "and the kernel applies flow control to the applications "
+		  "inside. Zero means no limit."
+	},
+
 	{ .name = "allow-rename",
 	  .type = OPTIONS_TABLE_FLAG,
 	  .scope = OPTIONS_TABLE_WINDOW|OPTIONS_TABLE_PANE,
@@ -757,6 +900,16 @@ const struct options_table_entry options_table[] = {
 		  "screen."
 	},
 
+	{ .name = "ambiguous-width",
+	  .type = OPTIONS_TABLE_CHOICE,
+	  .scope = OPTIONS_TABLE_WINDOW|OPTIONS_TABLE_PANE,
+	  .choices = options_table_width_list,
+	  .default_num = 0,
+	  .text = "Width used for East Asian ambiguous characters in the "
+		  "pane: the wcwidth(3) answer, or forced narrow or wide to "
+		  "match the terminal font."
+	},
+
 	{ .name = "automatic-rename",
 	  .type = OPTIONS_TABLE_FLAG,
 	  .scope = OPTIONS_TABLE_WINDOW,
@@ -814,6 +967,35 @@ const struct options_table_entry options_table[] = {
 	  .text = "Style of the marked line in copy mode."
 	},
 
+	{ .name = "emoji-width",
+	  .type = OPTIONS_TABLE_CHOICE,
+	  .scope = OPTIONS_TABLE_WINDOW|OPTIONS_TABLE_PANE,
+	  .choices = options_table_width_list,
+	  .default_num = 0,
+	  .text = "Width used for emoji and other pictographs in the pane: "
+		  "the wcwidth(3) answer, or forced narrow or wide to match "
+		  "how the terminal renders them."
+	},
+
+	{ .name = "log-file",
+	  .type = OPTIONS_TABLE_STRING,
+	  .scope = OPTIONS_TABLE_WINDOW|OPTIONS_TABLE_PANE,
+	  .default_str = "",
+	  .text = "File to append pane output to, or empty to turn logging "
+		  "off. Expanded as a format, so each pane can have its own "
+		  "file. Output is written in batches."
+	},
+
+	{ .name = "log-file-limit",
+	  .type = OPTIONS_TABLE_NUMBER,
+	  .scope = OPTIONS_TABLE_WINDOW|OPTIONS_TABLE_PANE,
+	  .minimum = 0,
+	  .maximum = INT_MAX,
+	  .default_num = 0,
+	  .text = "Size in bytes at which the pane log file is rotated, or 0 "
+		  "for no limit."
+	},
+
 	{ .name = "main-pane-height",
 	  .type = OPTIONS_TABLE_STRING,
 	  .scope = OPTIONS_TABLE_WINDOW,
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 
 #include <ctype.h>
+#include <event.h>
 #include <fnmatch.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -63,9 +64,29 @@ struct options_entry {
 struct options {
 	RB_HEAD(options_tree, options_entry)	 tree;
 	struct options				*parent;
+
+	/*
+	 * Resolved lookup cache, indexed by table option. Entries are only
+	 * valid while their generation matches options_generation, which is
+	 * bumped whenever an option is added or removed anywhere or a parent
+	 * changes.
+	 */
+	struct options_entry			**cache;
+	u_int					*cache_gen;
+
+	/* Bumped on any change to this tree, for callers that snapshot it. */
+	u_int					 changes;
 };
 
 static struct options_entry	*options_add(struct options *, const char *);
+static int			 options_table_find(const char *);
+static void			 options_apply_change(const char *);
+static void			 options_changes_callback(int, short, void *);
+
+static u_int	 options_generation = 1;
+
+static const struct options_table_entry **options_table_sorted;
+static u_int	 options_table_count;
 
 #define OPTIONS_IS_STRING(o)						\
 	((o)->tableentry == NULL ||					\
@@ -94,6 +115,55 @@ options_cmp(struct options_entry *lhs, struct options_entry *rhs)
 	return (strcmp(lhs->name, rhs->name));
 }
 
+static int
+options_table_sort_cmp(const void *a1, const void *a2)
+{
+	const struct options_table_entry *const *oe1 = a1, *const *oe2 = a2;
+
+	return (strcmp((*oe1)->name, (*oe2)->name));
+}
+
+static void
+options_table_index(void)
+{
+	const struct options_table_entry	*oe;
+	u_int					 i;
+
+	for (oe = options_table; oe->name != NULL; oe++)
+		options_table_count++;
+	options_table_sorted = xreallocarray(NULL, options_table_count,
+	    sizeof *options_table_sorted);
+	i = 0;
+	for (oe = options_table; oe->name != NULL; oe++)
+		options_table_sorted[i++] = oe;
+	qsort(options_table_sorted, options_table_count,
+	    sizeof *options_table_sorted, options_table_sort_cmp);
+}
+
+/* Look up a name in the option table, returning a stable index or -1. */
+static int
+options_table_find(const char *name)
+{
+	int	lo, hi, mid, cmp;
+
+	if (options_table_sorted == NULL)
+		options_table_index();
+
+	lo = 0;
+	hi = options_table_count - 1;
+	while (lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = strcmp(name, options_table_sorted[mid]->name);
+		if (cmp == 0)
+			return (mid);
+		if (cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+	return (-1);
+}
+
 static const struct options_table_entry *
 options_parent_table_entry(struct options *oo, const char *s)
 {
@@ -173,6 +243,8 @@ options_free(struct options *oo)
 
 	RB_FOREACH_SAFE(o, options_tree, &oo->tree, tmp)
 		options_remove(o);
+	free(oo->cache);
+	free(oo->cache_gen);
 	free(oo);
 }
 
@@ -186,6 +258,7 @@ void
 options_set_parent(struct options *oo, struct options *parent)
 {
 	oo->parent = parent;
+	options_generation++;
 }
 
 struct options_entry *
@@ -213,13 +286,31 @@ struct options_entry *
 options_get(struct options *oo, const char *name)
 {
 	struct options_entry	*o;
-
-	o = options_get_only(oo, name);
-	while (o == NULL) {
-		oo = oo->parent;
-		if (oo == NULL)
+	struct options		*loop;
+	int			 idx;
+
+	idx = options_table_find(name);
+	if (idx != -1 &&
+	    oo->cache != NULL &&
+	    oo->cache_gen[idx] == options_generation)
+		return (oo->cache[idx]);
+
+	o = NULL;
+	for (loop = oo; loop != NULL; loop = loop->parent) {
+		o = options_get_only(loop, name);
+		if (o != NULL)
 			break;
-		o = options_get_only(oo, name);
+	}
+
+	if (idx != -1) {
+		if (oo->cache == NULL) {
+			oo->cache = xcalloc(options_table_count,
+			    sizeof *oo->cache);
+			oo->cache_gen = xcalloc(options_table_count,
+			    sizeof *oo->cache_gen);
+		}
+		oo->cache[idx] = o;
+		oo->cache_gen[idx] = options_generation;
 	}
 	return (o);
 }
@@ -312,6 +403,8 @@ options_add(struct options *oo, const char *name)
 	o->name = xstrdup(name);
 
 	RB_INSERT(options_tree, &oo->tree, o);
+	options_generation++;
+	oo->changes++;
 	return (o);
 }
 
@@ -325,6 +418,8 @@ options_remove(struct options_entry *o)
 	else
 		options_value_free(o, &o->value);
 	RB_REMOVE(options_tree, &oo->tree, o);
+	options_generation++;
+	oo->changes++;
 	free((void *)o->name);
 	free(o);
 }
@@ -418,6 +513,8 @@ options_array_set(struct options_entry *o, u_int idx, const char *value,
 		a = options_array_item(o, idx);
 		if (a != NULL)
 			options_array_free(o, a);
+		o->owner->changes++;
+		status_invalidate();
 		return (0);
 	}
 
@@ -444,6 +541,7 @@ options_array_set(struct options_entry *o, u_int idx, const char *value,
 		else
 			options_value_free(o, &a->value);
 		a->value.cmdlist = pr->cmdlist;
+		o->owner->changes++;
 		return (0);
 	}
 
@@ -458,6 +556,8 @@ options_array_set(struct options_entry *o, u_int idx, const char *value,
 		else
 			options_value_free(o, &a->value);
 		a->value.string = new;
+		o->owner->changes++;
+		status_invalidate();
 		return (0);
 	}
 
@@ -688,6 +788,20 @@ options_get_number(struct options *oo, const char *name)
 	return (o->value.number);
 }
 
+/* Get the global generation, for caches invalidated by option changes. */
+u_int
+options_get_generation(void)
+{
+	return (options_generation);
+}
+
+/* Get the change count of one tree, for callers that snapshot its state. */
+u_int
+options_get_changes(struct options *oo)
+{
+	return (oo->changes);
+}
+
 struct options_entry *
 options_set_string(struct options *oo, const char *name, int append,
     const char *fmt, ...)
@@ -725,6 +839,8 @@ options_set_string(struct options *oo, const char *name, int append,
 	free(o->value.string);
 	o->value.string = value;
 	o->cached = 0;
+	oo->changes++;
+	status_invalidate();
 	return (o);
 }
 
@@ -746,6 +862,8 @@ options_set_number(struct options *oo, const char *name, long long value)
 	if (!OPTIONS_IS_NUMBER(o))
 		fatalx("option %s is not a number", name);
 	o->value.number = value;
+	oo->changes++;
+	status_invalidate();
 	return (o);
 }
 
@@ -760,18 +878,17 @@ options_scope_from_name(struct args *args, int window,
 	const char				*target = args_get(args, 't');
 	const struct options_table_entry	*oe;
 	int					 scope = OPTIONS_TABLE_NONE;
+	int					 idx;
 
 	if (*name == '@')
 		return (options_scope_from_flags(args, window, fs, oo, cause));
 
-	for (oe = options_table; oe->name != NULL; oe++) {
-		if (strcmp(oe->name, name) == 0)
-			break;
-	}
-	if (oe->name == NULL) {
+	idx = options_table_find(name);
+	if (idx == -1) {
 		xasprintf(cause, "unknown option: %s", name);
 		return (OPTIONS_TABLE_NONE);
 	}
+	oe = options_table_sorted[idx];
 	switch (oe->scope) {
 	case OPTIONS_TABLE_SERVER:
 		*oo = global_options;
@@ -1057,11 +1174,26 @@ options_from_string(struct options *oo, const struct options_table_entry *oe,
 	return (-1);
 }
 
-void
-options_push_changes(const char *name)
+/*
+ * Changed option names collected for one batch of invalidations. A theme is
+ * applied as a command list of dozens of set-option calls; recalculating
+ * sizes and redrawing every client once per option would repaint the lot
+ * dozens of times, so the changes are collected and pushed in one go when
+ * the callback fires.
+ */
+struct options_changed {
+	char				*name;
+	TAILQ_ENTRY(options_changed)	 entry;
+};
+static TAILQ_HEAD(, options_changed) options_changes = TAILQ_HEAD_INITIALIZER(
+    options_changes);
+static int	options_changes_fired;
+
+/* Invalidate whatever state is derived from one option. */
+static void
+options_apply_change(const char *name)
 {
 	struct client		*loop;
-	struct session		*s;
 	struct window		*w;
 	struct window_pane	*wp;
 
@@ -1097,6 +1229,45 @@ options_push_changes(const char *name)
 		RB_FOREACH(w, windows, &windows)
 			layout_fix_panes(w);
 	}
+	if (strcmp(name, "ambiguous-width") == 0 ||
+	    strcmp(name, "emoji-width") == 0) {
+		RB_FOREACH(wp, window_pane_tree, &all_window_panes) {
+			if (wp->ictx != NULL)
+				input_update_widths(wp->ictx);
+		}
+	}
+	if (strcmp(name, "log-file") == 0) {
+		RB_FOREACH(wp, window_pane_tree, &all_window_panes)
+			window_pane_update_log(wp);
+	}
+	if (strcmp(name, "hibernate-time") == 0 ||
+	    strcmp(name, "memory-limit") == 0)
+		server_wake_timers();
+	if (strcmp(name, "journal-file") == 0)
+		journal_update();
+}
+
+/* Push the collected changes: per-option work, then one redraw pass. */
+static void
+options_changes_callback(__unused int fd, __unused short events,
+    __unused void *arg)
+{
+	struct options_changed	*oc, *oc1;
+	struct client		*loop;
+	struct session		*s;
+	u_int			 n = 0;
+
+	TAILQ_FOREACH_SAFE(oc, &options_changes, entry, oc1) {
+		options_apply_change(oc->name);
+
+		TAILQ_REMOVE(&options_changes, oc, entry);
+		free(oc->name);
+		free(oc);
+		n++;
+	}
+	options_changes_fired = 0;
+	log_debug("%s: %u options changed", __func__, n);
+
 	RB_FOREACH(s, sessions, &sessions)
 		status_update_cache(s);
 
@@ -1106,3 +1277,23 @@ options_push_changes(const char *name)
 			server_redraw_client(loop);
 	}
 }
+
+void
+options_push_changes(const char *name)
+{
+	struct options_changed	*oc;
+
+	TAILQ_FOREACH(oc, &options_changes, entry) {
+		if (strcmp(oc->name, name) == 0)
+			return;
+	}
+	oc = xmalloc(sizeof *oc);
+	oc->name = xstrdup(name);
+	TAILQ_INSERT_TAIL(&options_changes, oc, entry);
+
+	if (!options_changes_fired) {
+		event_once(-1, EV_TIMEOUT, options_changes_callback, NULL,
+		    NULL);
+		options_changes_fired = 1;
+	}
+}
@@ -45,6 +45,7 @@ struct paste_buffer {
 static u_int	paste_next_index;
 static u_int	paste_next_order;
 static u_int	paste_num_automatic;
+static size_t	paste_size_automatic;
 static RB_HEAD(paste_name_tree, paste_buffer) paste_by_name;
 static RB_HEAD(paste_time_tree, paste_buffer) paste_by_time;
 
@@ -144,8 +145,10 @@ paste_free(struct paste_buffer *pb)
 {
 	RB_REMOVE(paste_name_tree, &paste_by_name, pb);
 	RB_REMOVE(paste_time_tree, &paste_by_time, pb);
-	if (pb->automatic)
+	if (pb->automatic) {
 		paste_num_automatic--;
+		paste_size_automatic -= pb->size;
+	}
 
 	free(pb->data);
 	free(pb->name);
@@ -161,6 +164,7 @@ paste_add(const char *prefix, char *data, size_t size)
 {
 	struct paste_buffer	*pb, *pb1;
 	u_int			 limit;
+	long long		 size_limit;
 
 	if (prefix == NULL)
 		prefix = "buffer";
@@ -178,6 +182,21 @@ paste_add(const char *prefix, char *data, size_t size)
 			paste_free(pb);
 	}
 
+	/*
+	 * If there is a total size limit as well, free the oldest automatic
+	 * buffers until the new buffer fits.
+	 */
+	size_limit = options_get_number(global_options, "buffer-size-limit");
+	if (size_limit != 0) {
+		RB_FOREACH_REVERSE_SAFE(pb, paste_time_tree, &paste_by_time,
+		    pb1) {
+			if (paste_size_automatic + size <= (size_t)size_limit)
+				break;
+			if (pb->automatic)
+				paste_free(pb);
+		}
+	}
+
 	pb = xmalloc(sizeof *pb);
 
 	pb->name = NULL;
@@ -192,6 +211,7 @@ paste_add(const char *prefix, char *data, size_t size)
 
 	pb->automatic = 1;
 	paste_num_automatic++;
+	paste_size_automatic += size;
 
 	pb->created = time(NULL);
 
@@ -239,8 +259,10 @@ paste_rename(const char *oldname, const char *newname, char **cause)
 	free(pb->name);
 	pb->name = xstrdup(newname);
 
-	if (pb->automatic)
+	if (pb->automatic) {
 		paste_num_automatic--;
+		paste_size_automatic -= pb->size;
+	}
 	pb->automatic = 0;
 
 	RB_INSERT(paste_name_tree, &paste_by_name, pb);
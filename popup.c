@@ -38,6 +38,12 @@ struct popup_data {
 	struct cmd_find_state	  fs;
 	struct screen		  s;
 
+	int			  flushed; /* popup has been drawn in full */
+	u_int			  flush_px;
+	u_int			  flush_py;
+	u_int			  flush_sx;
+	u_int			  flush_sy;
+
 	struct job		 *job;
 	struct input_ctx	 *ictx;
 	int			  status;
@@ -177,6 +183,14 @@ popup_draw_cb(struct client *c, __unused struct screen_redraw_ctx *ctx0)
 	struct screen		 s;
 	struct screen_write_ctx	 ctx;
 	u_int			 i, px = pd->px, py = pd->py;
+	int			 full;
+
+	full = (!pd->flushed ||
+	    (c->flags & CLIENT_REDRAWWINDOW) ||
+	    px != pd->flush_px ||
+	    py != pd->flush_py ||
+	    pd->sx != pd->flush_sx ||
+	    pd->sy != pd->flush_sy);
 
 	screen_init(&s, pd->sx, pd->sy, 0);
 	screen_write_start(&ctx, &s);
@@ -186,12 +200,32 @@ popup_draw_cb(struct client *c, __unused struct screen_redraw_ctx *ctx0)
 	screen_write_fast_copy(&ctx, &pd->s, 0, 0, pd->sx - 2, pd->sy - 2);
 	screen_write_stop(&ctx);
 
+	/*
+	 * If the popup has already been flushed at this position and size,
+	 * the border cannot have changed and interior lines not marked
+	 * dirty in the popup screen are as last transmitted, so only send
+	 * the lines which have changed.
+	 */
 	c->overlay_check = NULL;
 	for (i = 0; i < pd->sy; i++){
+		if (!full &&
+		    (i == 0 ||
+		    i == pd->sy - 1 ||
+		    !screen_line_dirty(&pd->s, i - 1)))
+			continue;
 		tty_draw_line(tty, &s, 0, i, pd->sx, px, py + i,
 		    &grid_default_cell, NULL);
 	}
 	c->overlay_check = popup_check_cb;
+
+	server_client_set_overlay_box(c, px, py, pd->sx, pd->sy);
+
+	screen_dirty_clear(&pd->s);
+	pd->flushed = 1;
+	pd->flush_px = px;
+	pd->flush_py = py;
+	pd->flush_sx = pd->sx;
+	pd->flush_sy = pd->sy;
 }
 
 static void
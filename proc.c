@@ -50,6 +50,7 @@ struct tmuxpeer {
 
 	struct imsgbuf	 ibuf;
 	struct event	 event;
+	short		 events;
 
 	int		 flags;
 #define PEER_BAD 0x1
@@ -135,17 +136,28 @@ peer_check_version(struct tmuxpeer *peer, struct imsg *imsg)
 	return (0);
 }
 
+/*
+ * Update the peer event. The event is persistent and only re-registered when
+ * the wanted set of events changes, so composing many messages in one command
+ * does not touch the event loop for each: the first enables EV_WRITE and they
+ * are all flushed together in one writev when the loop runs.
+ */
 static void
 proc_update_event(struct tmuxpeer *peer)
 {
 	short	events;
 
-	event_del(&peer->event);
-
 	events = EV_READ;
 	if (peer->ibuf.w.queued > 0)
 		events |= EV_WRITE;
-	event_set(&peer->event, peer->ibuf.fd, events, proc_event_cb, peer);
+	if (events == peer->events)
+		return;
+	peer->events = events;
+
+	event_del(&peer->event);
+	event_set(&peer->event, peer->ibuf.fd, events|EV_PERSIST, proc_event_cb,
+	    peer);
+	event_priority_set(&peer->event, 0);
 
 	event_add(&peer->event, NULL);
 }
@@ -0,0 +1,117 @@
+#!/bin/sh
+
+# Microbenchmarks for the server hot paths: the input parser, grid reflow
+# and format expansion. Not run as part of the regress suite; use the
+# top-level "make bench" target. Results are rough wall-clock figures
+# meant for comparing builds, not absolute numbers.
+
+PATH=/bin:/usr/bin
+TERM=screen
+
+[ -z "$TEST_TMUX" ] && TEST_TMUX=$(readlink -f ../../tmux)
+TMUX="$TEST_TMUX -Lbench"
+
+TMP=$(mktemp -d)
+trap "rm -rf $TMP; $TMUX kill-server 2>/dev/null" 0 1 15
+
+# How many lines in each recorded stream and how many reflow/format
+# iterations; sized so each phase runs for a few seconds.
+LINES=200000
+REFLOWS=200
+EXPANDS=2000
+
+counter()
+{
+	$TMUX display -p "#{$1}"
+}
+
+# report $name $bytes $t0 $t1 $a0 $a1
+report()
+{
+	awk "BEGIN {
+		t = $4 - $3; if (t < 1) t = 1;
+		printf \"%-12s %10d bytes %3ds %12.0f bytes/sec %10d allocs\n\",
+		    \"$1\", $2, t, $2 / t, $6 - $5
+	}"
+}
+
+# Recorded pty streams: plain text, SGR-heavy and UTF-8-heavy.
+awk 'BEGIN {
+	for (i = 0; i < '$LINES'; i++)
+		print "the quick brown fox jumps over the lazy dog 0123456789"
+}' >$TMP/plain
+awk 'BEGIN {
+	for (i = 0; i < '$LINES'; i++)
+		printf "\033[31mred\033[1;42mbold green bg\033[4;35munder" \
+		    "\033[0mplain\033[38;5;123m256\033[48;2;1;2;3mrgb\033[0m\n"
+}' >$TMP/sgr
+awk 'BEGIN {
+	for (i = 0; i < '$LINES'; i++)
+		print "\343\201\262\343\202\211\343\201\214\343\201\252" \
+		    "\303\251\303\250\303\240\342\224\200\342\224\202" \
+		    "\344\270\255\346\226\207\345\255\227"
+}' >$TMP/utf8
+
+$TMUX kill-server 2>/dev/null
+$TMUX -f/dev/null new -x 80 -y 24 -d || exit 1
+sleep 1
+
+# Feed each stream through a pane and measure the input parser.
+for f in plain sgr utf8; do
+	b0=$(counter server_input_bytes)
+	a0=$(counter server_allocations)
+	t0=$(date +%s)
+	$TMUX neww -d "cat $TMP/$f; $TMUX wait -S bench-$f"
+	$TMUX wait bench-$f
+	t1=$(date +%s)
+	b1=$(counter server_input_bytes)
+	a1=$(counter server_allocations)
+	report "input-$f" $(($b1 - $b0)) $t0 $t1 $a0 $a1
+done
+
+# Reflow a synthetic history by resizing the window back and forth.
+$TMUX neww -d "awk 'BEGIN {
+	for (i = 0; i < 5000; i++)
+		print i \": a fairly long line that wraps when the\" \
+		    \" window is narrowed below its natural width\"
+}'; $TMUX wait -S bench-fill; sleep 600"
+$TMUX wait bench-fill
+a0=$(counter server_allocations)
+t0=$(date +%s)
+i=0
+while [ $i -lt $REFLOWS ]; do
+	$TMUX resizew -t ':$' -x 40
+	$TMUX resizew -t ':$' -x 80
+	i=$(($i + 1))
+done
+t1=$(date +%s)
+a1=$(counter server_allocations)
+awk "BEGIN {
+	t = $t1 - $t0; if (t < 1) t = 1;
+	printf \"%-12s %10d reflows %2ds %12.0f reflows/sec %10d allocs\n\",
+	    \"reflow\", 2 * $REFLOWS, t, 2 * $REFLOWS / t, $a1 - $a0
+}"
+$TMUX kill-window -t ':$' 2>/dev/null
+
+# Expand a status-line-like format repeatedly.
+FMT='#[align=left]#{session_name} #{?pane_in_mode,[mode],}#{window_index}:'
+FMT="$FMT"'#{window_name} #{pane_title} #{t:window_activity} '
+FMT="$FMT"'#{?#{==:#{client_key_table},root},,[#{client_key_table}]}'
+e0=$(counter server_format_expands)
+a0=$(counter server_allocations)
+t0=$(date +%s)
+i=0
+while [ $i -lt $EXPANDS ]; do
+	$TMUX display -p "$FMT" >/dev/null
+	i=$(($i + 1))
+done
+t1=$(date +%s)
+e1=$(counter server_format_expands)
+a1=$(counter server_allocations)
+awk "BEGIN {
+	t = $t1 - $t0; if (t < 1) t = 1;
+	printf \"%-12s %10d expands %2ds %12.0f expands/sec %10d allocs\n\",
+	    \"format\", $e1 - $e0, t, ($e1 - $e0) / t, $a1 - $a0
+}"
+
+exit 0
@@ -0,0 +1,166 @@
+#!/bin/sh
+
+# Terminal emulation replay suite. Feeds recorded escape-sequence corpora
+# (an erase/scroll/insert feature reel, vim-style full-screen scrolling,
+# an htop-style in-place refresh and a plain build log) through panes on
+# a headless server, then checks the final grid contents against the
+# recorded .result files and that the parser kept a minimum throughput.
+# Not run as part of the regress suite; use the top-level "make emu"
+# target (or "make check EMU=1").
+
+PATH=/bin:/usr/bin
+TERM=screen
+
+[ -z "$TEST_TMUX" ] && TEST_TMUX=$(readlink -f ../../tmux)
+TMUX="$TEST_TMUX -Lemulation"
+
+# Minimum acceptable parser throughput in bytes per second. Deliberately
+# conservative so only order-of-magnitude regressions fail the suite; set
+# EMU_FLOOR higher when comparing two builds on the same machine.
+[ -z "$EMU_FLOOR" ] && EMU_FLOOR=50000
+
+# Corpus sizes; sized so each stream runs for a few seconds.
+REELS=500
+FRAMES=2000
+REFRESHES=1000
+LOGLINES=100000
+
+TMP=$(mktemp -d)
+trap "rm -rf $TMP; $TMUX kill-server 2>/dev/null" 0 1 15
+
+# Feature reel: erase, scroll regions, insert/delete line and character,
+# erase character and SGR, the sequences the esctest/vttest suites lean
+# on. Every frame starts by clearing the screen so the final grid only
+# depends on the last frame.
+awk 'BEGIN {
+	for (i = 0; i < '$REELS'; i++) {
+		printf "\033[2J\033[H"
+		printf "\033[1;4;31mfeature reel\033[0m"
+
+		printf "\033[3;10r\033[10;1H"
+		for (j = 0; j < 14; j++)
+			printf "\nscrolled line %d", j
+		printf "\033[r"
+
+		printf "\033[12;1Habcdefghij"
+		printf "\033[12;3H\033[3@KLM"
+		printf "\033[12;9H\033[2P"
+
+		printf "\033[14;1Hline one\nline two\nline three"
+		printf "\033[14;1H\033[1L"
+		printf "inserted\033[16;1H\033[1M"
+
+		printf "\033[17;1H0123456789\033[17;4H\033[3X"
+
+		printf "\033[19;1H\033[7mreverse\033[27m"
+		printf " \033[38;5;45mx256\033[0m"
+		printf " \033[48;2;10;20;30mrgb\033[0m"
+
+		printf "\033[21;1H"
+		for (j = 0; j < 100; j++)
+			printf "w"
+	}
+}' >$TMP/vtfeatures
+
+# Editor-style scrolling: every frame repaints the whole screen with
+# cursor addressing, erase to end of line and an inverse status line.
+awk 'BEGIN {
+	printf "\033[2J"
+	for (i = 0; i < '$FRAMES'; i++) {
+		printf "\033[H"
+		for (j = 0; j < 23; j++) {
+			printf "%5d  if (line%d != NULL)\tfree(line%d);" \
+			    "\033[K\n", i + j + 1, i + j, i + j
+		}
+		printf "\033[7m main.c  %d,1  12%%\033[0m\033[K", i + 1
+	}
+}' >$TMP/vim
+
+# Monitor-style refresh: rewrites the same rows in place with heavy SGR
+# but no scrolling.
+awk 'BEGIN {
+	printf "\033[2J"
+	for (i = 0; i < '$REFRESHES'; i++) {
+		for (r = 0; r < 8; r++) {
+			load = (i * 7 + r * 13) % 51
+			printf "\033[%d;1H\033[1;36mCPU%d\033[0m[\033[32m",
+			    r + 1, r
+			for (j = 0; j < load; j++)
+				printf "|"
+			printf "\033[0m\033[K\033[%d;57H]", r + 1
+		}
+		printf "\033[10;1H\033[7m  PID USER     CPU%% COMMAND" \
+		    "\033[0m\033[K"
+		for (r = 0; r < 12; r++) {
+			printf "\033[%d;1H%5d user%d    %2d.%d cc -O2" \
+			    " -c file%d.c\033[K", r + 11, 1000 + r, r,
+			    (i + r) % 100, r % 10, r
+		}
+	}
+}' >$TMP/htop
+
+# Build-log style output: plain scrolling text with occasional SGR and
+# the odd long line that wraps.
+awk 'BEGIN {
+	for (i = 0; i < '$LOGLINES'; i++) {
+		if (i % 97 == 0) {
+			printf "\033[1;35mwarning: \033[0munused variable" \
+			    " (tmp%d) [-Wunused-variable]\n", i
+		} else if (i % 41 == 0) {
+			printf "cc -O2 -Wall -Wextra -I. -Iinclude" \
+			    " -DPACKAGE=build -o obj/module%d/file%d.o" \
+			    " -c src/module%d/file%d.c\n", i % 7, i,
+			    i % 7, i
+		} else
+			printf "  CC       src/module%d/file%d.o\n", i % 7, i
+	}
+	printf "  LD       tmux\n"
+}' >$TMP/buildlog
+
+$TMUX kill-server 2>/dev/null
+$TMUX -f/dev/null new -x80 -y24 -d || exit 1
+$TMUX set -g window-size manual || exit 1
+sleep 1
+
+ret=0
+for f in vtfeatures vim htop buildlog; do
+	b0=$($TMUX display -p '#{server_input_bytes}')
+	t0=$(date +%s)
+	$TMUX neww -d "cat $TMP/$f; $TMUX wait -S emu-$f; sleep 600"
+	$TMUX wait emu-$f
+	t1=$(date +%s)
+	b1=$($TMUX display -p '#{server_input_bytes}')
+
+	ok=ok
+	$TMUX capturep -pe -t ':$' >$TMP/$f.out
+	if [ -n "$EMU_RECORD" ]; then
+		# Rerecord the expected grids after an intentional
+		# behaviour change; inspect the diff before committing.
+		cp $TMP/$f.out emulation-$f.result
+	fi
+	if ! cmp -s $TMP/$f.out emulation-$f.result; then
+		echo "$f: grid mismatch:"
+		diff emulation-$f.result $TMP/$f.out | sed 's/^/	/'
+		ok=FAILED
+		ret=1
+	fi
+
+	b=$(($b1 - $b0))
+	t=$(($t1 - $t0))
+	[ $t -lt 1 ] && t=1
+	if awk "BEGIN { exit !($b / $t < $EMU_FLOOR) }"; then
+		echo "$f: throughput $(($b / $t)) bytes/sec" \
+		    "below floor $EMU_FLOOR"
+		ok=FAILED
+		ret=1
+	fi
+	awk "BEGIN {
+		printf \"%-12s %10d bytes %3ds %12.0f bytes/sec %s\n\",
+		    \"$f\", $b, $t, $b / $t, \"$ok\"
+	}"
+
+	$TMUX killw -t ':$' 2>/dev/null
+done
+
+$TMUX kill-server 2>/dev/null
+exit $ret
@@ -19,10 +19,83 @@
 #include <sys/types.h>
 
 #include <regex.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "tmux.h"
 
+/*
+ * Cache of compiled patterns. Format modifiers like #{s/foo/bar/:} substitute
+ * with the same few patterns on every status refresh for every client, so
+ * keep the compiled form rather than running regcomp each time. Entries are
+ * kept in most-recently-used order and the oldest dropped when full.
+ */
+struct regsub_cache_entry {
+	char				 *pattern;
+	int				  flags;
+	regex_t				  r;
+
+	RB_ENTRY(regsub_cache_entry)	  entry;
+	TAILQ_ENTRY(regsub_cache_entry)	  lentry;
+};
+RB_HEAD(regsub_cache, regsub_cache_entry);
+
+static int
+regsub_cache_cmp(struct regsub_cache_entry *e1, struct regsub_cache_entry *e2)
+{
+	if (e1->flags < e2->flags)
+		return (-1);
+	if (e1->flags > e2->flags)
+		return (1);
+	return (strcmp(e1->pattern, e2->pattern));
+}
+RB_GENERATE_STATIC(regsub_cache, regsub_cache_entry, entry, regsub_cache_cmp);
+
+static struct regsub_cache	regsub_cache = RB_INITIALIZER(NULL);
+static TAILQ_HEAD(regsub_cache_list, regsub_cache_entry) regsub_cache_list =
+    TAILQ_HEAD_INITIALIZER(regsub_cache_list);
+static u_int			regsub_cache_size;
+#define REGSUB_CACHE_MAXIMUM 100
+
+/* Look up a compiled pattern, compiling and caching it if necessary. */
+static regex_t *
+regsub_compile(const char *pattern, int flags)
+{
+	struct regsub_cache_entry	 find, *e, *e1;
+
+	find.pattern = (char *)pattern;
+	find.flags = flags;
+	e = RB_FIND(regsub_cache, &regsub_cache, &find);
+	if (e != NULL) {
+		TAILQ_REMOVE(&regsub_cache_list, e, lentry);
+		TAILQ_INSERT_HEAD(&regsub_cache_list, e, lentry);
+		return (&e->r);
+	}
+
+	e = xmalloc(sizeof *e);
+	if (regcomp(&e->r, pattern, flags) != 0) {
+		free(e);
+		return (NULL);
+	}
+	e->pattern = xstrdup(pattern);
+	e->flags = flags;
+
+	if (regsub_cache_size >= REGSUB_CACHE_MAXIMUM) {
+		e1 = TAILQ_LAST(&regsub_cache_list, regsub_cache_list);
+		TAILQ_REMOVE(&regsub_cache_list, e1, lentry);
+		RB_REMOVE(regsub_cache, &regsub_cache, e1);
+		regfree(&e1->r);
+		free(e1->pattern);
+		free(e1);
+		regsub_cache_size--;
+	}
+
+	RB_INSERT(regsub_cache, &regsub_cache, e);
+	TAILQ_INSERT_HEAD(&regsub_cache_list, e, lentry);
+	regsub_cache_size++;
+	return (&e->r);
+}
+
 static void
 regsub_copy(char **buf, size_t *len, const char *text, size_t start, size_t end)
 {
@@ -57,10 +130,34 @@ regsub_expand(char **buf, size_t *len, const char *with, const char *text,
 	}
 }
 
+/*
+ * Substitute a pattern with no regex metacharacters: a plain strstr loop,
+ * with no need to compile anything.
+ */
+static char *
+regsub_literal(const char *pattern, const char *with, const char *text)
+{
+	char		*buf = NULL;
+	const char	*cp, *next;
+	size_t		 len = 0, plen = strlen(pattern), wlen = strlen(with);
+
+	cp = text;
+	while ((next = strstr(cp, pattern)) != NULL) {
+		regsub_copy(&buf, &len, cp, 0, next - cp);
+		buf = xrealloc(buf, len + wlen + 1);
+		memcpy(buf + len, with, wlen);
+		len += wlen;
+		cp = next + plen;
+	}
+	regsub_copy(&buf, &len, cp, 0, strlen(cp));
+	buf[len] = '\0';
+	return (buf);
+}
+
 char *
 regsub(const char *pattern, const char *with, const char *text, int flags)
 {
-	regex_t		 r;
+	regex_t		*r;
 	regmatch_t	 m[10];
 	ssize_t		 start, end, last, len = 0;
 	int		 empty = 0;
@@ -68,7 +165,12 @@ regsub(const char *pattern, const char *with, const char *text, int flags)
 
 	if (*text == '\0')
 		return (xstrdup(""));
-	if (regcomp(&r, pattern, flags) != 0)
+	if (*pattern != '\0' &&
+	    (~flags & REG_ICASE) &&
+	    strcspn(pattern, "^$.[]()|*+?{}\\") == strlen(pattern) &&
+	    strchr(with, '\\') == NULL)
+		return (regsub_literal(pattern, with, text));
+	if ((r = regsub_compile(pattern, flags)) == NULL)
 		return (NULL);
 
 	start = 0;
@@ -76,7 +178,7 @@ regsub(const char *pattern, const char *with, const char *text, int flags)
 	end = strlen(text);
 
 	while (start <= end) {
-		if (regexec(&r, text + start, nitems(m), m, 0) != 0) {
+		if (regexec(r, text + start, nitems(m), m, 0) != 0) {
 			regsub_copy(&buf, &len, text, start, end);
 			break;
 		}
@@ -115,6 +217,5 @@ regsub(const char *pattern, const char *with, const char *text, int flags)
 	}
 	buf[len] = '\0';
 
-	regfree(&r);
 	return (buf);
 }
@@ -409,3 +409,33 @@ recalculate_sizes(void)
 	RB_FOREACH(w, windows, &windows)
 		recalculate_size(w);
 }
+
+/*
+ * Recalculate sizes for the windows one client can affect: those linked
+ * into its session. A resize of one client cannot change the size of a
+ * window in a session it is not attached to, so there is no need for the
+ * full walk recalculate_sizes() does. Attach and detach still use the full
+ * walk since they change the attached counts.
+ */
+void
+recalculate_sizes_for_client(struct client *c)
+{
+	struct session	*s = c->session;
+	struct winlink	*wl;
+
+	if (s == NULL) {
+		recalculate_sizes();
+		return;
+	}
+
+	status_update_cache(s);
+	if (!ignore_client_size(c)) {
+		if (c->tty.sy <= s->statuslines || (c->flags & CLIENT_CONTROL))
+			c->flags |= CLIENT_STATUSOFF;
+		else
+			c->flags &= ~CLIENT_STATUSOFF;
+	}
+
+	RB_FOREACH(wl, winlinks, &s->windows)
+		recalculate_size(wl->window);
+}
@@ -368,6 +368,106 @@ screen_redraw_check_cell(struct client *c, u_int px, u_int py, int pane_status,
 	return (CELL_OUTSIDE);
 }
 
+/* Mix a value into a border map fingerprint. */
+static uint64_t
+screen_redraw_border_key_mix(uint64_t key, u_int v)
+{
+	u_int	i;
+
+	for (i = 0; i < 4; i++) {
+		key ^= (v >> (i * 8)) & 0xff;
+		key *= 0x100000001b3ULL;
+	}
+	return (key);
+}
+
+/* Fingerprint everything the border map depends on. */
+static uint64_t
+screen_redraw_border_key(struct client *c, int pane_status)
+{
+	struct window		*w = c->session->curw->window;
+	struct window_pane	*wp, *active = server_client_get_pane(c);
+	uint64_t		 key = 0xcbf29ce484222325ULL;
+
+	key = screen_redraw_border_key_mix(key, w->sx);
+	key = screen_redraw_border_key_mix(key, w->sy);
+	key = screen_redraw_border_key_mix(key, pane_status);
+	key = screen_redraw_border_key_mix(key, w->flags & WINDOW_ZOOMED);
+	key = screen_redraw_border_key_mix(key, active->id);
+	TAILQ_FOREACH(wp, &w->panes, entry) {
+		key = screen_redraw_border_key_mix(key, wp->id);
+		key = screen_redraw_border_key_mix(key, wp->xoff);
+		key = screen_redraw_border_key_mix(key, wp->yoff);
+		key = screen_redraw_border_key_mix(key, wp->sx);
+		key = screen_redraw_border_key_mix(key, wp->sy);
+		key = screen_redraw_border_key_mix(key, wp->status_size);
+		key = screen_redraw_border_key_mix(key,
+		    window_pane_visible(wp));
+	}
+	return (key);
+}
+
+/*
+ * Make sure the window's cached map of border cell types is up to date. The
+ * map only changes when the layout does, so working out the type of every
+ * cell can be skipped on the redraws in between.
+ */
+static void
+screen_redraw_update_border_map(struct client *c, int pane_status)
+{
+	struct window		*w = c->session->curw->window;
+	struct window_pane	*wp;
+	uint64_t		 key = screen_redraw_border_key(c, pane_status);
+	u_int			 x, y;
+
+	if (w->border_map != NULL &&
+	    w->border_map_sx == w->sx &&
+	    w->border_map_sy == w->sy &&
+	    w->border_map_key == key)
+		return;
+	log_debug("%s: @%u rebuilding border map", __func__, w->id);
+
+	w->border_map = xreallocarray(w->border_map, w->sx + 1, w->sy + 1);
+	for (y = 0; y <= w->sy; y++) {
+		for (x = 0; x <= w->sx; x++) {
+			w->border_map[y * (w->sx + 1) + x] =
+			    screen_redraw_check_cell(c, x, y, pane_status,
+			    &wp);
+		}
+	}
+	w->border_map_sx = w->sx;
+	w->border_map_sy = w->sy;
+	w->border_map_key = key;
+}
+
+/* Find the pane a border cell belongs to, as screen_redraw_check_cell does. */
+static struct window_pane *
+screen_redraw_cell_pane(struct client *c, u_int px, u_int py, int pane_status)
+{
+	struct window		*w = c->session->curw->window;
+	struct window_pane	*wp, *active, *last = NULL;
+
+	if (px == w->sx || py == w->sy) /* window border */
+		return (NULL);
+
+	active = wp = server_client_get_pane(c);
+	do {
+		if (!window_pane_visible(wp))
+			goto next;
+		last = wp;
+		if (screen_redraw_pane_border(wp, px, py, pane_status) !=
+		    SCREEN_REDRAW_OUTSIDE)
+			return (wp);
+
+	next:
+		wp = TAILQ_NEXT(wp, entry);
+		if (wp == NULL)
+			wp = TAILQ_FIRST(&w->panes);
+	} while (wp != active);
+
+	return (last);
+}
+
 /* Check if the border of a particular pane. */
 static int
 screen_redraw_check_is(u_int px, u_int py, int pane_status,
@@ -393,6 +493,21 @@ screen_redraw_make_pane_status(struct client *c, struct window *w,
 	u_int			 width, i;
 	struct screen_write_ctx	 ctx;
 	struct screen		 old;
+	int			 active;
+
+	/*
+	 * The built status screen is a pure function of the pane state,
+	 * options and width, so when none of those have changed since it was
+	 * last built, skip the expansion and rebuild entirely. The screen is
+	 * shared across clients as before.
+	 */
+	active = (w->active == wp);
+	if (wp->border_text != NULL &&
+	    wp->border_gen == wp->generation &&
+	    wp->border_opts_gen == options_get_generation() &&
+	    wp->border_active == active &&
+	    wp->border_sx == wp->sx)
+		return (0);
 
 	ft = format_create(c, NULL, FORMAT_PANE|wp->id, FORMAT_STATUS);
 	format_defaults(ft, c, c->session, c->session->curw, wp);
@@ -424,7 +539,13 @@ screen_redraw_make_pane_status(struct client *c, struct window *w,
 	format_draw(&ctx, &gc, width, expanded, NULL);
 	screen_write_stop(&ctx);
 
-	free(expanded);
+	free(wp->border_text);
+	wp->border_text = expanded;
+	wp->border_gen = wp->generation;
+	wp->border_opts_gen = options_get_generation();
+	wp->border_active = active;
+	wp->border_sx = wp->sx;
+
 	format_free(ft);
 
 	if (grid_compare(wp->status_screen.grid, old.grid) == 0) {
@@ -601,9 +722,9 @@ screen_redraw_screen(struct client *c)
 	tty_reset(&c->tty);
 }
 
-/* Redraw a single pane. */
+/* Redraw a single pane, possibly only the lines marked as changed. */
 void
-screen_redraw_pane(struct client *c, struct window_pane *wp)
+screen_redraw_pane(struct client *c, struct window_pane *wp, int only_dirty)
 {
 	struct screen_redraw_ctx	 ctx;
 
@@ -611,6 +732,7 @@ screen_redraw_pane(struct client *c, struct window_pane *wp)
 		return;
 
 	screen_redraw_set_context(c, &ctx);
+	ctx.only_dirty = only_dirty;
 	tty_update_mode(&c->tty, c->tty.mode, NULL);
 	tty_sync_start(&c->tty);
 
@@ -651,6 +773,7 @@ screen_redraw_draw_borders_cell(struct screen_redraw_ctx *ctx, u_int i, u_int j)
 {
 	struct client		*c = ctx->c;
 	struct session		*s = c->session;
+	struct window		*w = s->curw->window;
 	struct tty		*tty = &c->tty;
 	struct window_pane	*wp;
 	u_int			 cell_type, x = ctx->ox + i, y = ctx->oy + j;
@@ -661,10 +784,18 @@ screen_redraw_draw_borders_cell(struct screen_redraw_ctx *ctx, u_int i, u_int j)
 	if (c->overlay_check != NULL && !c->overlay_check(c, x, y))
 		return;
 
-	cell_type = screen_redraw_check_cell(c, x, y, pane_status, &wp);
+	if (x > w->sx || y > w->sy)
+		cell_type = CELL_OUTSIDE;
+	else
+		cell_type = w->border_map[y * (w->sx + 1) + x];
 	if (cell_type == CELL_INSIDE)
 		return;
 
+	if (x > w->sx || y > w->sy)
+		wp = NULL;
+	else
+		wp = screen_redraw_cell_pane(c, x, y, pane_status);
+
 	if (wp == NULL)
 		memcpy(&gc, &grid_default_cell, sizeof gc);
 	else {
@@ -698,6 +829,8 @@ screen_redraw_draw_borders(struct screen_redraw_ctx *ctx)
 
 	log_debug("%s: %s @%u", __func__, c->name, w->id);
 
+	screen_redraw_update_border_map(c, ctx->pane_status);
+
 	TAILQ_FOREACH(wp, &w->panes, entry)
 		wp->border_gc_set = 0;
 
@@ -731,7 +864,7 @@ screen_redraw_draw_status(struct screen_redraw_ctx *ctx)
 	struct window	*w = c->session->curw->window;
 	struct tty	*tty = &c->tty;
 	struct screen	*s = c->status.active;
-	u_int		 i, y;
+	u_int		 i, y, px, nx;
 
 	log_debug("%s: %s @%u", __func__, c->name, w->id);
 
@@ -740,9 +873,28 @@ screen_redraw_draw_status(struct screen_redraw_ctx *ctx)
 	else
 		y = c->tty.sy - ctx->statuslines;
 	for (i = 0; i < ctx->statuslines; i++) {
-		tty_draw_line(tty, s, 0, i, UINT_MAX, 0, y + i,
+		/*
+		 * The prompt marks the cells it changed as dirty; if only
+		 * those changed, send them rather than the whole line.
+		 */
+		if (!s->dirty_all) {
+			if (!screen_line_dirty(s, i))
+				continue;
+			px = s->dirty_x1;
+			nx = s->dirty_x2 - s->dirty_x1 + 1;
+		} else {
+			px = 0;
+			nx = UINT_MAX;
+		}
+		tty_draw_line(tty, s, px, i, nx, px, y + i,
 		    &grid_default_cell, NULL);
 	}
+
+	/*
+	 * Reset to all dirty so the partial state is consumed once: forced
+	 * redraws (closing the prompt, reattaching) must send whole lines.
+	 */
+	screen_dirty_all(s);
 }
 
 /* Draw one pane. */
@@ -754,7 +906,7 @@ screen_redraw_draw_pane(struct screen_redraw_ctx *ctx, struct window_pane *wp)
 	struct tty	*tty = &c->tty;
 	struct screen	*s;
 	struct grid_cell defaults;
-	u_int		 i, j, top, x, y, width;
+	u_int		 i, j, top, x, y, width, dirty;
 
 	log_debug("%s: %s @%u %%%u", __func__, c->name, w->id, wp->id);
 
@@ -766,7 +918,33 @@ screen_redraw_draw_pane(struct screen_redraw_ctx *ctx, struct window_pane *wp)
 		top = 0;
 
 	s = wp->screen;
+
+	/*
+	 * If the whole pane is visible, check whether this redraw is mostly
+	 * the previous content shifted up or down - an application that
+	 * repaints every frame scrolls this way - and if so have the tty
+	 * scroll the matching rows into place so the loop below only sends
+	 * the rows that are really new. A dirty-lines redraw with most lines
+	 * clean cannot have scrolled, so skip the check for those.
+	 */
+	if (wp->xoff >= ctx->ox && wp->xoff + wp->sx <= ctx->ox + ctx->sx &&
+	    wp->yoff >= ctx->oy && wp->yoff + wp->sy <= ctx->oy + ctx->sy) {
+		dirty = 0;
+		for (j = 0; j < wp->sy; j++) {
+			if (!ctx->only_dirty || screen_line_dirty(s, j))
+				dirty++;
+		}
+		if (dirty >= wp->sy / 2 && wp->sy >= 4) {
+			tty_default_colours(&defaults, wp);
+			tty_infer_scroll(tty, s, wp->sx, wp->xoff - ctx->ox,
+			    top + wp->yoff - ctx->oy, wp->sy, &defaults,
+			    wp->palette);
+		}
+	}
+
 	for (j = 0; j < wp->sy; j++) {
+		if (ctx->only_dirty && !screen_line_dirty(s, j))
+			continue;
 		if (wp->yoff + j < ctx->oy || wp->yoff + j >= ctx->oy + ctx->sy)
 			continue;
 		y = top + wp->yoff + j - ctx->oy;
@@ -798,7 +976,10 @@ screen_redraw_draw_pane(struct screen_redraw_ctx *ctx, struct window_pane *wp)
 		    __func__, c->name, wp->id, i, j, x, y, width);
 
 		tty_default_colours(&defaults, wp);
-		tty_draw_line(tty, s, i, j, width, x, y, &defaults,
-		    wp->palette);
+		if (tty_draw_line(tty, s, i, j, width, x, y, &defaults,
+		    wp->palette) &&
+		    (grid_get_line(s->grid, s->grid->hsize + j)->flags &
+		    GRID_LINE_IMAGE))
+			tty_draw_images(tty, s, j, x - i, y);
 	}
 }
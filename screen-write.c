@@ -23,6 +23,8 @@
 
 #include "tmux.h"
 
+static struct screen_write_collect_item *screen_write_get_citem(void);
+static void	screen_write_free_citem(struct screen_write_collect_item *);
 static void	screen_write_collect_clear(struct screen_write_ctx *, u_int,
 		    u_int);
 static int	screen_write_collect_clear_end(struct screen_write_ctx *, u_int,
@@ -35,11 +37,15 @@ static void	screen_write_collect_flush(struct screen_write_ctx *, int,
 
 static int	screen_write_overwrite(struct screen_write_ctx *,
 		    struct grid_cell *, u_int);
+static int	screen_write_cluster_continues(struct screen_write_ctx *,
+		    const struct utf8_data *);
+static int	screen_write_combine_inplace(struct screen_write_ctx *,
+		    const struct utf8_data *);
 static const struct grid_cell *screen_write_combine(struct screen_write_ctx *,
 		    const struct utf8_data *, u_int *);
 
 static const struct grid_cell screen_write_pad_cell = {
-	{ { 0 }, 0, 0, 0 }, 0, GRID_FLAG_PADDING, 0, 8, 8
+	{ { 0 }, 0, 0, 0 }, 0, GRID_FLAG_PADDING, 0, 8, 8, 0
 };
 
 struct screen_write_collect_item {
@@ -60,6 +66,45 @@ struct screen_write_collect_line {
 	TAILQ_HEAD(, screen_write_collect_item)  items;
 };
 
+/*
+ * Pool of free collect items. The write path takes one item per run of
+ * characters and frees the whole list on every flush, so recently freed
+ * items are kept for reuse rather than going back to the allocator for
+ * each run.
+ */
+static TAILQ_HEAD(, screen_write_collect_item) screen_write_citem_pool =
+    TAILQ_HEAD_INITIALIZER(screen_write_citem_pool);
+static u_int	screen_write_citem_pool_count;
+#define SCREEN_WRITE_CITEM_POOL_LIMIT 256
+
+/* Allocate a collect item, from the pool if possible. */
+static struct screen_write_collect_item *
+screen_write_get_citem(void)
+{
+	struct screen_write_collect_item	*ci;
+
+	ci = TAILQ_FIRST(&screen_write_citem_pool);
+	if (ci != NULL) {
+		TAILQ_REMOVE(&screen_write_citem_pool, ci, entry);
+		screen_write_citem_pool_count--;
+		memset(ci, 0, sizeof *ci);
+		return (ci);
+	}
+	return (xcalloc(1, sizeof *ci));
+}
+
+/* Return a collect item to the pool or free it. */
+static void
+screen_write_free_citem(struct screen_write_collect_item *ci)
+{
+	if (screen_write_citem_pool_count == SCREEN_WRITE_CITEM_POOL_LIMIT) {
+		free(ci);
+		return;
+	}
+	TAILQ_INSERT_HEAD(&screen_write_citem_pool, ci, entry);
+	screen_write_citem_pool_count++;
+}
+
 static void
 screen_write_offset_timer(__unused int fd, __unused short events, void *data)
 {
@@ -176,7 +221,15 @@ screen_write_initctx(struct screen_write_ctx *ctx, struct tty_ctx *ttyctx,
 		ctx->init_ctx_cb(ctx, ttyctx);
 	else {
 		ttyctx->redraw_cb = screen_write_redraw_cb;
-		if (ctx->wp == NULL)
+		/*
+		 * If the window is not visible on any client, skip all tty
+		 * bookkeeping and only update the grid - tty_write() would
+		 * reject every client anyway. The flag is refreshed by the
+		 * server loop and a full redraw follows whenever the window
+		 * becomes visible again.
+		 */
+		if (ctx->wp == NULL ||
+		    (~ctx->wp->window->flags & WINDOW_VISIBLE))
 			ttyctx->set_client_cb = NULL;
 		else
 			ttyctx->set_client_cb = screen_write_set_client_cb;
@@ -223,7 +276,7 @@ screen_write_init(struct screen_write_ctx *ctx, struct screen *s)
 
 	if (ctx->s->write_list == NULL)
 		screen_write_make_list(ctx->s);
-	ctx->item = xcalloc(1, sizeof *ctx->item);
+	ctx->item = screen_write_get_citem();
 
 	ctx->scrolled = 0;
 	ctx->bg = 8;
@@ -289,7 +342,7 @@ screen_write_stop(struct screen_write_ctx *ctx)
 		ctx->wp->skipped += ctx->skipped;
 	}
 
-	free(ctx->item);
+	screen_write_free_citem(ctx->item);
 }
 
 /* Reset screen state. */
@@ -538,21 +591,41 @@ screen_write_fast_copy(struct screen_write_ctx *ctx, struct screen *src,
 {
 	struct screen		*s = ctx->s;
 	struct grid		*gd = src->grid;
+	struct grid_line	*gl;
 	struct grid_cell	 gc;
-	u_int		 	 xx, yy, cx, cy;
+	u_int		 	 xx, yy, cx, cy, ncopy;
 
 	if (nx == 0 || ny == 0)
 		return;
 
+	ctx->combine_valid = 0;
+	screen_dirty_cells(s, s->cx, s->cy, nx, ny);
+
 	cy = s->cy;
 	for (yy = py; yy < py + ny; yy++) {
 		if (yy >= gd->hsize + gd->sy)
 			break;
 		cx = s->cx;
+
+		/*
+		 * Copy the whole row in one go if it is all plain cells;
+		 * otherwise fall through to the cell loop.
+		 */
+		ncopy = grid_get_line(gd, yy)->cellsize;
+		if (ncopy > px + nx)
+			ncopy = px + nx;
+		if (ncopy > px &&
+		    grid_copy_cells(s->grid, cx, s->grid->hsize + cy, gd, px,
+		    yy, ncopy - px) == 0) {
+			cy++;
+			continue;
+		}
+
+		gl = grid_get_line(gd, yy);
 		for (xx = px; xx < px + nx; xx++) {
-			if (xx >= grid_get_line(gd, yy)->cellsize)
+			if (xx >= gl->cellsize)
 				break;
-			grid_get_cell(gd, xx, yy, &gc);
+			grid_get_line_cell(gd, gl, xx, &gc);
 			if (xx + gc.data.width > px + nx)
 				break;
 			grid_view_set_cell(ctx->s->grid, cx, cy, &gc);
@@ -616,9 +689,7 @@ screen_write_menu(struct screen_write_ctx *ctx, struct menu *menu,
 {
 	struct screen		*s = ctx->s;
 	struct grid_cell	 default_gc;
-	const struct grid_cell	*gc = &default_gc;
-	u_int			 cx, cy, i, j;
-	const char		*name;
+	u_int			 cx, cy, i;
 
 	cx = s->cx;
 	cy = s->cy;
@@ -629,27 +700,46 @@ screen_write_menu(struct screen_write_ctx *ctx, struct menu *menu,
 	screen_write_cursormove(ctx, cx + 2, cy, 0);
 	format_draw(ctx, &default_gc, menu->width, menu->title, NULL);
 
-	for (i = 0; i < menu->count; i++) {
-		name = menu->items[i].name;
-		if (name == NULL) {
-			screen_write_cursormove(ctx, cx, cy + 1 + i, 0);
-			screen_write_hline(ctx, menu->width + 4, 1, 1);
-		} else {
-			if (choice >= 0 && i == (u_int)choice && *name != '-')
-				gc = choice_gc;
-			screen_write_cursormove(ctx, cx + 2, cy + 1 + i, 0);
-			for (j = 0; j < menu->width; j++)
-				screen_write_putc(ctx, gc, ' ');
-			screen_write_cursormove(ctx, cx + 2, cy + 1 + i, 0);
-			if (*name == '-') {
-				name++;
-				default_gc.attr |= GRID_ATTR_DIM;
-				format_draw(ctx, gc, menu->width, name, NULL);
-				default_gc.attr &= ~GRID_ATTR_DIM;
-			} else
-				format_draw(ctx, gc, menu->width, name, NULL);
-			gc = &default_gc;
-		}
+	screen_write_set_cursor(ctx, cx, cy);
+	for (i = 0; i < menu->count; i++)
+		screen_write_menu_line(ctx, menu, i, choice, choice_gc);
+
+	screen_write_set_cursor(ctx, cx, cy);
+}
+
+/* Draw one menu item line; the cursor gives the menu's top left. */
+void
+screen_write_menu_line(struct screen_write_ctx *ctx, struct menu *menu,
+    u_int i, int choice, const struct grid_cell *choice_gc)
+{
+	struct screen		*s = ctx->s;
+	struct grid_cell	 default_gc;
+	const struct grid_cell	*gc = &default_gc;
+	u_int			 cx, cy, j;
+	const char		*name = menu->items[i].name;
+
+	cx = s->cx;
+	cy = s->cy;
+
+	memcpy(&default_gc, &grid_default_cell, sizeof default_gc);
+
+	if (name == NULL) {
+		screen_write_cursormove(ctx, cx, cy + 1 + i, 0);
+		screen_write_hline(ctx, menu->width + 4, 1, 1);
+	} else {
+		if (choice >= 0 && i == (u_int)choice && *name != '-')
+			gc = choice_gc;
+		screen_write_cursormove(ctx, cx + 2, cy + 1 + i, 0);
+		for (j = 0; j < menu->width; j++)
+			screen_write_putc(ctx, gc, ' ');
+		screen_write_cursormove(ctx, cx + 2, cy + 1 + i, 0);
+		if (*name == '-') {
+			name++;
+			default_gc.attr |= GRID_ATTR_DIM;
+			format_draw(ctx, gc, menu->width, name, NULL);
+			default_gc.attr &= ~GRID_ATTR_DIM;
+		} else
+			format_draw(ctx, gc, menu->width, name, NULL);
 	}
 
 	screen_write_set_cursor(ctx, cx, cy);
@@ -902,6 +992,7 @@ screen_write_alignmenttest(struct screen_write_ctx *ctx)
 		for (xx = 0; xx < screen_size_x(s); xx++)
 			grid_view_set_cell(s->grid, xx, yy, &gc);
 	}
+	screen_dirty_all(s);
 
 	screen_write_set_cursor(ctx, 0, 0);
 
@@ -936,6 +1027,7 @@ screen_write_insertcharacter(struct screen_write_ctx *ctx, u_int nx, u_int bg)
 	ttyctx.bg = bg;
 
 	grid_view_insert_cells(s->grid, s->cx, s->cy, nx, bg);
+	screen_dirty_cells(s, s->cx, s->cy, screen_size_x(s) - s->cx, 1);
 
 	screen_write_collect_flush(ctx, 0, __func__);
 	ttyctx.num = nx;
@@ -964,6 +1056,7 @@ screen_write_deletecharacter(struct screen_write_ctx *ctx, u_int nx, u_int bg)
 	ttyctx.bg = bg;
 
 	grid_view_delete_cells(s->grid, s->cx, s->cy, nx, bg);
+	screen_dirty_cells(s, s->cx, s->cy, screen_size_x(s) - s->cx, 1);
 
 	screen_write_collect_flush(ctx, 0, __func__);
 	ttyctx.num = nx;
@@ -992,6 +1085,7 @@ screen_write_clearcharacter(struct screen_write_ctx *ctx, u_int nx, u_int bg)
 	ttyctx.bg = bg;
 
 	grid_view_clear(s->grid, s->cx, s->cy, nx, 1, bg);
+	screen_dirty_cells(s, s->cx, s->cy, nx, 1);
 
 	screen_write_collect_flush(ctx, 0, __func__);
 	ttyctx.num = nx;
@@ -1019,6 +1113,7 @@ screen_write_insertline(struct screen_write_ctx *ctx, u_int ny, u_int bg)
 		ttyctx.bg = bg;
 
 		grid_view_insert_lines(gd, s->cy, ny, bg);
+		screen_dirty_lines(s, s->cy, screen_size_y(s) - s->cy);
 
 		screen_write_collect_flush(ctx, 0, __func__);
 		ttyctx.num = ny;
@@ -1038,6 +1133,7 @@ screen_write_insertline(struct screen_write_ctx *ctx, u_int ny, u_int bg)
 		grid_view_insert_lines(gd, s->cy, ny, bg);
 	else
 		grid_view_insert_lines_region(gd, s->rlower, s->cy, ny, bg);
+	screen_dirty_lines(s, s->cy, s->rlower + 1 - s->cy);
 
 	screen_write_collect_flush(ctx, 0, __func__);
 
@@ -1066,6 +1162,7 @@ screen_write_deleteline(struct screen_write_ctx *ctx, u_int ny, u_int bg)
 		ttyctx.bg = bg;
 
 		grid_view_delete_lines(gd, s->cy, ny, bg);
+		screen_dirty_lines(s, s->cy, screen_size_y(s) - s->cy);
 
 		screen_write_collect_flush(ctx, 0, __func__);
 		ttyctx.num = ny;
@@ -1085,6 +1182,7 @@ screen_write_deleteline(struct screen_write_ctx *ctx, u_int ny, u_int bg)
 		grid_view_delete_lines(gd, s->cy, ny, bg);
 	else
 		grid_view_delete_lines_region(gd, s->rlower, s->cy, ny, bg);
+	screen_dirty_lines(s, s->cy, s->rlower + 1 - s->cy);
 
 	screen_write_collect_flush(ctx, 0, __func__);
 	ttyctx.num = ny;
@@ -1104,6 +1202,7 @@ screen_write_clearline(struct screen_write_ctx *ctx, u_int bg)
 		return;
 
 	grid_view_clear(s->grid, 0, s->cy, sx, 1, bg);
+	screen_dirty_lines(s, s->cy, 1);
 
 	screen_write_collect_clear(ctx, s->cy, 1);
 	ctx->s->write_list[s->cy].bg = 1 + bg;
@@ -1129,13 +1228,14 @@ screen_write_clearendofline(struct screen_write_ctx *ctx, u_int bg)
 		return;
 
 	grid_view_clear(s->grid, s->cx, s->cy, sx - s->cx, 1, bg);
+	screen_dirty_cells(s, s->cx, s->cy, sx - s->cx, 1);
 
 	if (!screen_write_collect_clear_end(ctx, s->cy, s->cx, bg)) {
 		ci->x = s->cx;
 		ci->type = CLEAR_END;
 		ci->bg = bg;
 		TAILQ_INSERT_TAIL(&ctx->s->write_list[s->cy].items, ci, entry);
-		ctx->item = xcalloc(1, sizeof *ctx->item);
+		ctx->item = screen_write_get_citem();
 	}
 }
 
@@ -1152,17 +1252,20 @@ screen_write_clearstartofline(struct screen_write_ctx *ctx, u_int bg)
 		return;
 	}
 
+	ctx->combine_valid = 0;
+
 	if (s->cx > sx - 1)
 		grid_view_clear(s->grid, 0, s->cy, sx, 1, bg);
 	else
 		grid_view_clear(s->grid, 0, s->cy, s->cx + 1, 1, bg);
+	screen_dirty_cells(s, 0, s->cy, s->cx + 1, 1);
 
 	if (!screen_write_collect_clear_start(ctx, s->cy, s->cx, bg)) {
 		ci->x = s->cx;
 		ci->type = CLEAR_START;
 		ci->bg = bg;
 		TAILQ_INSERT_TAIL(&ctx->s->write_list[s->cy].items, ci, entry);
-		ctx->item = xcalloc(1, sizeof *ctx->item);
+		ctx->item = screen_write_get_citem();
 	}
 }
 
@@ -1197,6 +1300,7 @@ screen_write_reverseindex(struct screen_write_ctx *ctx, u_int bg)
 
 	if (s->cy == s->rupper) {
 		grid_view_scroll_region_down(s->grid, s->rupper, s->rlower, bg);
+		screen_dirty_lines(s, s->rupper, s->rlower + 1 - s->rupper);
 		screen_write_collect_flush(ctx, 0, __func__);
 
 		screen_write_initctx(ctx, &ttyctx, 1);
@@ -1255,6 +1359,7 @@ screen_write_linefeed(struct screen_write_ctx *ctx, int wrapped, u_int bg)
 
 	if (s->cy == s->rlower) {
 		grid_view_scroll_region_up(gd, s->rupper, s->rlower, bg);
+		screen_dirty_lines(s, s->rupper, s->rlower + 1 - s->rupper);
 		screen_write_collect_scroll(ctx);
 		ctx->scrolled++;
 	} else if (s->cy < screen_size_y(s) - 1)
@@ -1283,6 +1388,7 @@ screen_write_scrollup(struct screen_write_ctx *ctx, u_int lines, u_int bg)
 		grid_view_scroll_region_up(gd, s->rupper, s->rlower, bg);
 		screen_write_collect_scroll(ctx);
 	}
+	screen_dirty_lines(s, s->rupper, s->rlower + 1 - s->rupper);
 	ctx->scrolled += lines;
 }
 
@@ -1305,6 +1411,7 @@ screen_write_scrolldown(struct screen_write_ctx *ctx, u_int lines, u_int bg)
 
 	for (i = 0; i < lines; i++)
 		grid_view_scroll_region_down(gd, s->rupper, s->rlower, bg);
+	screen_dirty_lines(s, s->rupper, s->rlower + 1 - s->rupper);
 
 	screen_write_collect_flush(ctx, 0, __func__);
 	ttyctx.num = lines;
@@ -1339,6 +1446,7 @@ screen_write_clearendofscreen(struct screen_write_ctx *ctx, u_int bg)
 		grid_view_clear(gd, 0, s->cy + 1, sx, sy - (s->cy + 1), bg);
 	}
 
+	screen_dirty_lines(s, s->cy, sy - s->cy);
 	screen_write_collect_clear(ctx, s->cy + 1, sy - (s->cy + 1));
 	screen_write_collect_flush(ctx, 0, __func__);
 	tty_write(tty_cmd_clearendofscreen, &ttyctx);
@@ -1357,11 +1465,14 @@ screen_write_clearstartofscreen(struct screen_write_ctx *ctx, u_int bg)
 
 	if (s->cy > 0)
 		grid_view_clear(s->grid, 0, 0, sx, s->cy, bg);
+	ctx->combine_valid = 0;
+
 	if (s->cx > sx - 1)
 		grid_view_clear(s->grid, 0, s->cy, sx, 1, bg);
 	else
 		grid_view_clear(s->grid, 0, s->cy, s->cx + 1, 1, bg);
 
+	screen_dirty_lines(s, 0, s->cy + 1);
 	screen_write_collect_clear(ctx, 0, s->cy);
 	screen_write_collect_flush(ctx, 0, __func__);
 	tty_write(tty_cmd_clearstartofscreen, &ttyctx);
@@ -1381,9 +1492,12 @@ screen_write_clearscreen(struct screen_write_ctx *ctx, u_int bg)
 	/* Scroll into history if it is enabled. */
 	if (s->grid->flags & GRID_HISTORY)
 		grid_view_clear_history(s->grid, bg);
-	else
+	else {
 		grid_view_clear(s->grid, 0, 0, sx, sy, bg);
+		image_free_visible(s->grid);
+	}
 
+	screen_dirty_all(s);
 	screen_write_collect_clear(ctx, 0, sy);
 	tty_write(tty_cmd_clearscreen, &ttyctx);
 }
@@ -1428,7 +1542,7 @@ screen_write_collect_clear_start(struct screen_write_ctx *ctx, u_int y, u_int x,
 		items++;
 		size += ci->used;
 		TAILQ_REMOVE(&ctx->s->write_list[y].items, ci, entry);
-		free(ci);
+		screen_write_free_citem(ci);
 	}
 	ctx->skipped += size;
 	log_debug("%s: dropped %u items (%zu bytes) (line %u)", __func__, items,
@@ -1469,7 +1583,7 @@ screen_write_collect_clear_end(struct screen_write_ctx *ctx, u_int y, u_int x,
 		items++;
 		size += ci->used;
 		TAILQ_REMOVE(&ctx->s->write_list[y].items, ci, entry);
-		free(ci);
+		screen_write_free_citem(ci);
 	}
 	ctx->skipped += size;
 	log_debug("%s: dropped %u items (%zu bytes) (line %u)", __func__, items,
@@ -1486,6 +1600,8 @@ screen_write_collect_clear(struct screen_write_ctx *ctx, u_int y, u_int n)
 	u_int					 i, items;
 	size_t					 size;
 
+	ctx->combine_valid = 0;
+
 	for (i = y; i < y + n; i++) {
 		if (TAILQ_EMPTY(&ctx->s->write_list[i].items))
 			continue;
@@ -1496,7 +1612,7 @@ screen_write_collect_clear(struct screen_write_ctx *ctx, u_int y, u_int n)
 			items++;
 			size += ci->used;
 			TAILQ_REMOVE(&cl->items, ci, entry);
-			free(ci);
+			screen_write_free_citem(ci);
 		}
 		ctx->skipped += size;
 		log_debug("%s: dropped %u items (%zu bytes) (line %u)",
@@ -1516,6 +1632,8 @@ screen_write_collect_scroll(struct screen_write_ctx *ctx)
 	log_debug("%s: at %u,%u (region %u-%u)", __func__, s->cx, s->cy,
 	    s->rupper, s->rlower);
 
+	ctx->combine_valid = 0;
+
 	screen_write_collect_clear(ctx, s->rupper, 1);
 	saved = ctx->s->write_list[s->rupper].data;
 	for (y = s->rupper; y < s->rlower; y++) {
@@ -1540,6 +1658,8 @@ screen_write_collect_flush(struct screen_write_ctx *ctx, int scroll_only,
 	struct tty_ctx				 ttyctx;
 	size_t					 written = 0;
 
+	ctx->combine_valid = 0;
+
 	if (ctx->scrolled != 0) {
 		log_debug("%s: scrolled %u (region %u-%u)", __func__,
 		    ctx->scrolled, s->rupper, s->rlower);
@@ -1566,6 +1686,26 @@ screen_write_collect_flush(struct screen_write_ctx *ctx, int scroll_only,
 			ttyctx.bg = cl->bg - 1;
 			tty_write(tty_cmd_clearline, &ttyctx);
 		}
+		/*
+		 * Merge adjacent runs of text with the same style into a
+		 * single item so that fewer commands reach the tty layer.
+		 * The character data is indexed by x in the line buffer, so
+		 * adjacent items are already contiguous there.
+		 */
+		ci = TAILQ_FIRST(&cl->items);
+		while (ci != NULL && (tmp = TAILQ_NEXT(ci, entry)) != NULL) {
+			if (ci->type == TEXT && tmp->type == TEXT &&
+			    !tmp->wrapped &&
+			    tmp->x == ci->x + ci->used &&
+			    tmp->gc.us == ci->gc.us &&
+			    grid_cells_look_equal(&ci->gc, &tmp->gc)) {
+				ci->used += tmp->used;
+				TAILQ_REMOVE(&cl->items, tmp, entry);
+				screen_write_free_citem(tmp);
+			} else
+				ci = tmp;
+		}
+
 		TAILQ_FOREACH_SAFE(ci, &cl->items, entry, tmp) {
 			screen_write_set_cursor(ctx, ci->x, y);
 			if (ci->type == CLEAR_END) {
@@ -1589,7 +1729,7 @@ screen_write_collect_flush(struct screen_write_ctx *ctx, int scroll_only,
 			written += ci->used;
 
 			TAILQ_REMOVE(&cl->items, ci, entry);
-			free(ci);
+			screen_write_free_citem(ci);
 		}
 		cl->bg = 0;
 	}
@@ -1615,7 +1755,7 @@ screen_write_collect_end(struct screen_write_ctx *ctx)
 
 	ci->x = s->cx;
 	TAILQ_INSERT_TAIL(&cl->items, ci, entry);
-	ctx->item = xcalloc(1, sizeof *ctx->item);
+	ctx->item = screen_write_get_citem();
 
 	log_debug("%s: %u %.*s (at %u,%u)", __func__, ci->used,
 	    (int)ci->used, cl->data + ci->x, s->cx, s->cy);
@@ -1636,6 +1776,7 @@ screen_write_collect_end(struct screen_write_ctx *ctx)
 
 	grid_view_set_cells(s->grid, s->cx, s->cy, &ci->gc, cl->data + ci->x,
 	    ci->used);
+	screen_dirty_cells(s, s->cx, s->cy, ci->used, 1);
 	screen_write_set_cursor(ctx, s->cx + ci->used, -1);
 
 	for (xx = s->cx; xx < screen_size_x(s); xx++) {
@@ -1646,6 +1787,62 @@ screen_write_collect_end(struct screen_write_ctx *ctx)
 	}
 }
 
+/* Collect a run of identically styled printable ASCII characters. */
+void
+screen_write_collect_add_run(struct screen_write_ctx *ctx,
+    const struct grid_cell *gc, const u_char *buf, size_t len)
+{
+	struct screen				*s = ctx->s;
+	struct screen_write_collect_item	*ci;
+	struct grid_cell			 tmp;
+	u_int					 sx = screen_size_x(s), n;
+	size_t					 i;
+
+	/*
+	 * If the characters cannot be collected, fall back to adding them one
+	 * at a time.
+	 */
+	if ((gc->attr & GRID_ATTR_CHARSET) ||
+	    (~s->mode & MODE_WRAP) ||
+	    (s->mode & MODE_INSERT) ||
+	    s->sel != NULL) {
+		memcpy(&tmp, gc, sizeof tmp);
+		for (i = 0; i < len; i++) {
+			utf8_set(&tmp.data, buf[i]);
+			screen_write_collect_add(ctx, &tmp);
+		}
+		return;
+	}
+
+	ctx->cells += len;
+	while (len > 0) {
+		if (s->cx > sx - 1 || ctx->item->used > sx - 1 - s->cx)
+			screen_write_collect_end(ctx);
+		ci = ctx->item; /* may have changed */
+
+		if (s->cx > sx - 1) {
+			log_debug("%s: wrapped at %u,%u", __func__, s->cx,
+			    s->cy);
+			ci->wrapped = 1;
+			screen_write_linefeed(ctx, 1, 8);
+			screen_write_set_cursor(ctx, 0, -1);
+		}
+
+		if (ci->used == 0)
+			memcpy(&ci->gc, gc, sizeof ci->gc);
+		if (s->write_list[s->cy].data == NULL)
+			s->write_list[s->cy].data = xmalloc(sx);
+
+		n = sx - s->cx - ci->used;
+		if (n > len)
+			n = len;
+		memcpy(s->write_list[s->cy].data + s->cx + ci->used, buf, n);
+		ci->used += n;
+		buf += n;
+		len -= n;
+	}
+}
+
 /* Write cell data, collecting if necessary. */
 void
 screen_write_collect_add(struct screen_write_ctx *ctx,
@@ -1656,6 +1853,14 @@ screen_write_collect_add(struct screen_write_ctx *ctx,
 	u_int					 sx = screen_size_x(s);
 	int					 collect;
 
+	/*
+	 * Zero-width characters combine onto the previous cell; try to do so
+	 * in place before falling through to the slow path below.
+	 */
+	if (gc->data.width == 0 &&
+	    screen_write_combine_inplace(ctx, &gc->data))
+		return;
+
 	/*
 	 * Don't need to check that the attributes and whatnot are still the
 	 * same - input_parse will end the collection when anything that isn't
@@ -1718,8 +1923,16 @@ screen_write_cell(struct screen_write_ctx *ctx, const struct grid_cell *gc)
 		return;
 	ctx->cells++;
 
-	/* If the width is zero, combine onto the previous character. */
-	if (width == 0) {
+	/*
+	 * If the width is zero, or this character continues the grapheme
+	 * cluster in the previous cell (a pictograph after a zero-width
+	 * joiner, or the second regional indicator of a flag), combine it
+	 * onto that cell.
+	 */
+	if (width == 0 || (gc->data.size > 1 &&
+	    screen_write_cluster_continues(ctx, &gc->data))) {
+		if (screen_write_combine_inplace(ctx, &gc->data))
+			return;
 		screen_write_collect_flush(ctx, 0, __func__);
 		if ((gc = screen_write_combine(ctx, &gc->data, &xx)) != 0) {
 			cx = s->cx; cy = s->cy;
@@ -1803,20 +2016,29 @@ screen_write_cell(struct screen_write_ctx *ctx, const struct grid_cell *gc)
 		}
 	}
 
-	/* Update the selected flag and set the cell. */
+	/*
+	 * Set the cell. Selection is not written into the grid: it is applied
+	 * as an overlay when the line reaches the terminal, so an unchanged
+	 * cell can be skipped even while selected. Selection changes redraw
+	 * the affected lines through tty_draw_line() instead.
+	 */
 	selected = screen_check_selection(s, s->cx, s->cy);
-	if (selected && (~gc->flags & GRID_FLAG_SELECTED)) {
-		memcpy(&tmp_gc, gc, sizeof tmp_gc);
-		tmp_gc.flags |= GRID_FLAG_SELECTED;
-		grid_view_set_cell(gd, s->cx, s->cy, &tmp_gc);
-	} else if (!selected && (gc->flags & GRID_FLAG_SELECTED)) {
-		memcpy(&tmp_gc, gc, sizeof tmp_gc);
-		tmp_gc.flags &= ~GRID_FLAG_SELECTED;
-		grid_view_set_cell(gd, s->cx, s->cy, &tmp_gc);
-	} else if (!skip)
+	if (!skip)
 		grid_view_set_cell(gd, s->cx, s->cy, gc);
+
+	/*
+	 * Remember the cell so any zero-width characters which follow at once
+	 * can be combined onto it without reading it back from the grid.
+	 */
+	screen_dirty_cells(s, s->cx, s->cy, width, 1);
 	if (selected)
-		skip = 0;
+		ctx->combine_valid = 0;
+	else {
+		memcpy(&ctx->combine_cell, gc, sizeof ctx->combine_cell);
+		ctx->combine_x = s->cx;
+		ctx->combine_y = s->cy;
+		ctx->combine_valid = 1;
+	}
 
 	/*
 	 * Move the cursor. If not wrapping, stick at the last character and
@@ -1848,6 +2070,39 @@ screen_write_cell(struct screen_write_ctx *ctx, const struct grid_cell *gc)
 		ctx->skipped++;
 }
 
+/*
+ * Check whether a character continues the grapheme cluster in the cell
+ * before the cursor, using the remembered last cell when it is still valid
+ * and reading the grid otherwise.
+ */
+static int
+screen_write_cluster_continues(struct screen_write_ctx *ctx,
+    const struct utf8_data *ud)
+{
+	struct screen		*s = ctx->s;
+	struct grid_cell	 gc;
+	u_int			 n;
+
+	if (!utf8_grapheme_continuer(ud))
+		return (0);
+
+	if (ctx->combine_valid &&
+	    s->cy == ctx->combine_y &&
+	    s->cx == ctx->combine_x + ctx->combine_cell.data.width)
+		return (utf8_grapheme_continues(&ctx->combine_cell.data, ud));
+
+	if (s->cx == 0)
+		return (0);
+	for (n = 1; n <= s->cx; n++) {
+		grid_view_get_cell(s->grid, s->cx - n, s->cy, &gc);
+		if (~gc.flags & GRID_FLAG_PADDING)
+			break;
+	}
+	if (n > s->cx)
+		return (0);
+	return (utf8_grapheme_continues(&gc.data, ud));
+}
+
 /* Combine a UTF-8 zero-width character onto the previous. */
 static const struct grid_cell *
 screen_write_combine(struct screen_write_ctx *ctx, const struct utf8_data *ud,
@@ -1889,10 +2144,61 @@ screen_write_combine(struct screen_write_ctx *ctx, const struct utf8_data *ud,
 
 	/* Set the new cell. */
 	grid_view_set_cell(gd, *xx, s->cy, &gc);
+	screen_dirty_cells(s, *xx, s->cy, 1, 1);
 
 	return (&gc);
 }
 
+/*
+ * Combine a zero-width character onto the last cell written, if the cursor
+ * has not moved and nothing else has touched the screen since. This avoids
+ * reading the cell back from the grid and flushing collected output for each
+ * combining character.
+ */
+static int
+screen_write_combine_inplace(struct screen_write_ctx *ctx,
+    const struct utf8_data *ud)
+{
+	struct screen		*s = ctx->s;
+	struct grid_cell	*gc = &ctx->combine_cell;
+	struct tty_ctx		 ttyctx;
+	u_int			 cx, cy;
+
+	if (!ctx->combine_valid ||
+	    ctx->item->used != 0 ||
+	    s->cy != ctx->combine_y ||
+	    s->cx != ctx->combine_x + gc->data.width)
+		return (0);
+
+	/* Empty data is out. */
+	if (ud->size == 0)
+		fatalx("UTF-8 data empty");
+
+	/* Check there is enough space. */
+	if (gc->data.size + ud->size > sizeof gc->data.data)
+		return (0);
+
+	log_debug("%s: %.*s onto %.*s at %u,%u", __func__, (int)ud->size,
+	    ud->data, (int)gc->data.size, gc->data.data, ctx->combine_x,
+	    ctx->combine_y);
+
+	/* Append the data and update the cell. */
+	memcpy(gc->data.data + gc->data.size, ud->data, ud->size);
+	gc->data.size += ud->size;
+	grid_view_set_cell(s->grid, ctx->combine_x, ctx->combine_y, gc);
+	screen_dirty_cells(s, ctx->combine_x, ctx->combine_y, 1, 1);
+
+	/* Write the combined cell from its position. */
+	cx = s->cx; cy = s->cy;
+	screen_write_set_cursor(ctx, ctx->combine_x, ctx->combine_y);
+	screen_write_initctx(ctx, &ttyctx, 0);
+	ttyctx.cell = gc;
+	tty_write(tty_cmd_cell, &ttyctx);
+	s->cx = cx; s->cy = cy;
+
+	return (1);
+}
+
 /*
  * UTF-8 wide characters are a bit of an annoyance. They take up more than one
  * cell on the screen, so following cells must not be drawn by marking them as
@@ -1981,6 +2287,19 @@ screen_write_rawstring(struct screen_write_ctx *ctx, u_char *str, u_int len)
 	tty_write(tty_cmd_rawstring, &ttyctx);
 }
 
+/* Write a sixel image placement through to capable terminals. */
+void
+screen_write_sixel(struct screen_write_ctx *ctx, struct image *img)
+{
+	struct tty_ctx	ttyctx;
+
+	screen_write_collect_flush(ctx, 0, __func__);
+	screen_write_initctx(ctx, &ttyctx, 0);
+	ttyctx.ptr = img;
+
+	tty_write(tty_cmd_sixel, &ttyctx);
+}
+
 /* Turn alternate screen on. */
 void
 screen_write_alternateon(struct screen_write_ctx *ctx, struct grid_cell *gc,
@@ -84,6 +84,10 @@ screen_init(struct screen *s, u_int sx, u_int sy, u_int hlimit)
 	s->tabs = NULL;
 	s->sel = NULL;
 
+	if ((s->dirty = bit_alloc(sy)) == NULL)
+		fatal("bit_alloc failed");
+	screen_dirty_all(s);
+
 	s->write_list = NULL;
 
 	screen_reinit(s);
@@ -112,6 +116,8 @@ screen_reinit(struct screen *s)
 
 	screen_clear_selection(s);
 	screen_free_titles(s);
+
+	screen_dirty_all(s);
 }
 
 /* Destroy a screen. */
@@ -120,6 +126,7 @@ screen_free(struct screen *s)
 {
 	free(s->sel);
 	free(s->tabs);
+	free(s->dirty);
 	free(s->title);
 	free(s->ccolour);
 
@@ -163,6 +170,77 @@ screen_set_cursor_colour(struct screen *s, const char *colour)
 	s->ccolour = xstrdup(colour);
 }
 
+/* Mark a rectangle of cells as changed. */
+void
+screen_dirty_cells(struct screen *s, u_int px, u_int py, u_int nx, u_int ny)
+{
+	u_int	sx = screen_size_x(s), sy = screen_size_y(s), yy;
+
+	if (nx == 0 || ny == 0 || px >= sx || py >= sy)
+		return;
+	if (nx > sx - px)
+		nx = sx - px;
+	if (ny > sy - py)
+		ny = sy - py;
+
+	if (!s->dirty_all) {
+		for (yy = py; yy < py + ny; yy++)
+			bit_set(s->dirty, yy);
+	}
+
+	if (px < s->dirty_x1)
+		s->dirty_x1 = px;
+	if (py < s->dirty_y1)
+		s->dirty_y1 = py;
+	if (px + nx - 1 > s->dirty_x2)
+		s->dirty_x2 = px + nx - 1;
+	if (py + ny - 1 > s->dirty_y2)
+		s->dirty_y2 = py + ny - 1;
+}
+
+/* Mark whole lines as changed. */
+void
+screen_dirty_lines(struct screen *s, u_int py, u_int ny)
+{
+	screen_dirty_cells(s, 0, py, screen_size_x(s), ny);
+}
+
+/* Mark the whole screen as changed. */
+void
+screen_dirty_all(struct screen *s)
+{
+	s->dirty_all = 1;
+	s->dirty_x1 = 0;
+	s->dirty_y1 = 0;
+	s->dirty_x2 = screen_size_x(s) - 1;
+	s->dirty_y2 = screen_size_y(s) - 1;
+}
+
+/* Clear the changed region, after it has been consumed. */
+void
+screen_dirty_clear(struct screen *s)
+{
+	u_int	sy = screen_size_y(s);
+
+	s->dirty_all = 0;
+	bit_nclear(s->dirty, 0, sy - 1);
+	s->dirty_x1 = UINT_MAX;
+	s->dirty_y1 = UINT_MAX;
+	s->dirty_x2 = 0;
+	s->dirty_y2 = 0;
+}
+
+/* Check if a line has changed. */
+int
+screen_line_dirty(struct screen *s, u_int py)
+{
+	if (s->dirty_all)
+		return (1);
+	if (py >= screen_size_y(s))
+		return (0);
+	return (bit_test(s->dirty, py));
+}
+
 /* Set screen title. */
 int
 screen_set_title(struct screen *s, const char *title)
@@ -261,6 +339,11 @@ screen_resize_cursor(struct screen *s, u_int sx, u_int sy, int reflow,
 	log_debug("%s: cursor finished at %u,%u = %u,%u", __func__, s->cx,
 	    s->cy, cx, cy);
 
+	free(s->dirty);
+	if ((s->dirty = bit_alloc(screen_size_y(s))) == NULL)
+		fatal("bit_alloc failed");
+	screen_dirty_all(s);
+
 	if (s->write_list != NULL)
 		screen_write_make_list(s);
 }
@@ -36,12 +36,21 @@ static void	server_client_check_pane_resize(struct window_pane *);
 static void	server_client_check_window_resize(struct window *);
 static key_code	server_client_check_mouse(struct client *, struct key_event *);
 static void	server_client_repeat_timer(int, short, void *);
+static void	server_client_resize_timer(int, short, void *);
 static void	server_client_click_timer(int, short, void *);
 static void	server_client_check_exit(struct client *);
 static void	server_client_check_redraw(struct client *);
 static void	server_client_set_title(struct client *);
 static void	server_client_reset_state(struct client *);
 static int	server_client_assume_paste(struct session *);
+static enum cmd_retval	server_client_paste_callback(struct cmdq_item *,
+		    void *);
+
+/* Bracketed paste data on its way to a pane. */
+struct server_client_paste {
+	char	*buf;
+	size_t	 len;
+};
 static void	server_client_resize_event(int, short, void *);
 
 static void	server_client_dispatch(struct imsg *, void *);
@@ -118,12 +127,108 @@ server_client_set_overlay(struct client *c, u_int delay,
 	c->overlay_free = freecb;
 	c->overlay_data = data;
 
+	c->overlay_box = 0;
+
 	c->tty.flags |= TTY_FREEZE;
 	if (c->overlay_mode == NULL)
 		c->tty.flags |= TTY_NOCURSOR;
 	server_redraw_client(c);
 }
 
+/*
+ * Record (or extend) the bounding box of the screen area an overlay draws
+ * into, so closing it can restore just that area instead of repainting the
+ * whole client.
+ */
+void
+server_client_set_overlay_box(struct client *c, u_int px, u_int py, u_int sx,
+    u_int sy)
+{
+	u_int	ex = px + sx, ey = py + sy;
+
+	if (!c->overlay_box) {
+		c->overlay_box = 1;
+		c->overlay_px = px;
+		c->overlay_py = py;
+		c->overlay_sx = sx;
+		c->overlay_sy = sy;
+		return;
+	}
+	if (c->overlay_px + c->overlay_sx > ex)
+		ex = c->overlay_px + c->overlay_sx;
+	if (c->overlay_py + c->overlay_sy > ey)
+		ey = c->overlay_py + c->overlay_sy;
+	if (px < c->overlay_px)
+		c->overlay_px = px;
+	if (py < c->overlay_py)
+		c->overlay_py = py;
+	c->overlay_sx = ex - c->overlay_px;
+	c->overlay_sy = ey - c->overlay_py;
+}
+
+/*
+ * Redraw what a closed overlay covered. Only panes overlapping the
+ * bounding box are marked, and only for this client; the drawn-line
+ * shadow in the tty layer means rows the overlay did not touch cost
+ * nothing to re-check. Falls back to a full redraw when the box is not
+ * known or the window does not fit the client exactly.
+ */
+static void
+server_client_overlay_redraw(struct client *c)
+{
+	struct window		*w;
+	struct window_pane	*wp;
+	u_int			 lines, top = 0, py, ey, bit = 0;
+	int			 at;
+
+	if (!c->overlay_box || c->session == NULL ||
+	    (c->flags & CLIENT_CONTROL)) {
+		server_redraw_client(c);
+		return;
+	}
+	c->overlay_box = 0;
+
+	w = c->session->curw->window;
+	lines = status_line_size(c);
+	at = status_at_line(c);
+	if (at == 0)
+		top = lines;
+	if (w->sx != c->tty.sx || w->sy + lines != c->tty.sy) {
+		server_redraw_client(c);
+		return;
+	}
+
+	py = c->overlay_py;
+	ey = c->overlay_py + c->overlay_sy;
+	log_debug("%s: %s box %u,%u %ux%u", __func__, c->name, c->overlay_px,
+	    py, c->overlay_sx, c->overlay_sy);
+
+	/* The status line if the box covers any of it. */
+	if (lines != 0 &&
+	    (at == 0 ? py < lines : ey > c->tty.sy - lines))
+		c->flags |= CLIENT_REDRAWSTATUS;
+
+	/* Panes overlapping the box, for this client only. */
+	TAILQ_FOREACH(wp, &w->panes, entry) {
+		if (bit == 64) {
+			server_redraw_client(c);
+			return;
+		}
+		if (window_pane_visible(wp) &&
+		    c->overlay_px < wp->xoff + wp->sx &&
+		    c->overlay_px + c->overlay_sx > wp->xoff &&
+		    py < top + wp->yoff + wp->sy &&
+		    ey > top + wp->yoff)
+			c->redraw_panes |= (1 << bit);
+		bit++;
+	}
+	if (c->redraw_panes != 0)
+		c->flags |= CLIENT_REDRAWPANES;
+
+	/* The box may cross pane borders. */
+	c->flags |= CLIENT_REDRAWBORDERS;
+}
+
 /* Clear overlay mode on client. */
 void
 server_client_clear_overlay(struct client *c)
@@ -145,7 +250,7 @@ server_client_clear_overlay(struct client *c)
 	c->overlay_data = NULL;
 
 	c->tty.flags &= ~(TTY_FREEZE|TTY_NOCURSOR);
-	server_redraw_client(c);
+	server_client_overlay_redraw(c);
 }
 
 /* Check if this client is inside this server. */
@@ -201,6 +306,16 @@ server_client_is_default_key_table(struct client *c, struct key_table *table)
 	return (strcmp(table->name, server_client_get_key_table(c)) == 0);
 }
 
+/*
+ * Pool of free client structures. Monitoring tools open short-lived
+ * connections at a high rate, so keep recently freed clients for reuse
+ * rather than going back to the allocator each time.
+ */
+static TAILQ_HEAD(, client) server_client_pool =
+    TAILQ_HEAD_INITIALIZER(server_client_pool);
+static u_int	server_client_pool_count;
+#define SERVER_CLIENT_POOL_LIMIT 16
+
 /* Create a new client. */
 struct client *
 server_client_create(int fd)
@@ -209,7 +324,13 @@ server_client_create(int fd)
 
 	setblocking(fd, 0);
 
-	c = xcalloc(1, sizeof *c);
+	c = TAILQ_FIRST(&server_client_pool);
+	if (c != NULL) {
+		TAILQ_REMOVE(&server_client_pool, c, entry);
+		server_client_pool_count--;
+		memset(c, 0, sizeof *c);
+	} else
+		c = xcalloc(1, sizeof *c);
 	c->references = 1;
 	c->peer = proc_add_peer(server_proc, fd, server_client_dispatch, c);
 
@@ -239,6 +360,7 @@ server_client_create(int fd)
 	c->keytable->references++;
 
 	evtimer_set(&c->repeat_timer, server_client_repeat_timer, c);
+	evtimer_set(&c->resize_timer, server_client_resize_timer, c);
 	evtimer_set(&c->click_timer, server_client_click_timer, c);
 
 	TAILQ_INSERT_TAIL(&clients, c, entry);
@@ -302,6 +424,9 @@ server_client_lost(struct client *c)
 		free(cw);
 	}
 
+	if (c->flags & CLIENT_CONTROL)
+		control_stop(c);
+
 	TAILQ_REMOVE(&clients, c, entry);
 	log_debug("lost client %p", c);
 
@@ -322,6 +447,7 @@ server_client_lost(struct client *c)
 	free((void *)c->cwd);
 
 	evtimer_del(&c->repeat_timer);
+	evtimer_del(&c->resize_timer);
 	evtimer_del(&c->click_timer);
 
 	key_bindings_unref_table(c->keytable);
@@ -372,7 +498,12 @@ server_client_free(__unused int fd, __unused short events, void *arg)
 
 	if (c->references == 0) {
 		free((void *)c->name);
-		free(c);
+		if (server_client_pool_count == SERVER_CLIENT_POOL_LIMIT)
+			free(c);
+		else {
+			TAILQ_INSERT_HEAD(&server_client_pool, c, entry);
+			server_client_pool_count++;
+		}
 	}
 }
 
@@ -1333,6 +1464,77 @@ server_client_handle_key(struct client *c, struct key_event *event)
 	return (1);
 }
 
+/* Bulk paste data queue callback. Write the data to the active pane. */
+static enum cmd_retval
+server_client_paste_callback(struct cmdq_item *item, void *data)
+{
+	struct client			*c = cmdq_get_client(item);
+	struct server_client_paste	*paste = data;
+	struct session			*s = c->session;
+	struct window_pane		*wp, *loop;
+
+	/* Check the client is good to accept input. */
+	if (s == NULL || (c->flags & CLIENT_UNATTACHEDFLAGS))
+		goto out;
+	if (c->flags & CLIENT_READONLY)
+		goto out;
+
+	/* Update the activity timer. */
+	if (gettimeofday(&c->activity_time, NULL) != 0)
+		fatal("gettimeofday failed");
+	session_update_activity(s, &c->activity_time);
+
+	/* The pane may have changed since the data was queued; check again. */
+	wp = s->curw->window->active;
+	if (wp == NULL ||
+	    TAILQ_FIRST(&wp->modes) != NULL ||
+	    wp->fd == -1 ||
+	    (wp->flags & PANE_INPUTOFF))
+		goto out;
+
+	bufferevent_write(wp->event, paste->buf, paste->len);
+	if (options_get_number(wp->window->options, "synchronize-panes")) {
+		TAILQ_FOREACH(loop, &wp->window->panes, entry) {
+			if (loop != wp &&
+			    TAILQ_EMPTY(&loop->modes) &&
+			    loop->fd != -1 &&
+			    (~loop->flags & PANE_INPUTOFF) &&
+			    window_pane_visible(loop))
+				bufferevent_write(loop->event, paste->buf,
+				    paste->len);
+		}
+	}
+
+out:
+	free(paste->buf);
+	free(paste);
+	return (CMD_RETURN_NORMAL);
+}
+
+/*
+ * Handle a chunk of bracketed paste data. This skips the key processing path
+ * entirely - the data is written to the pane as-is - but goes through the
+ * command queue so it stays ordered with the paste start and end keys.
+ */
+void
+server_client_handle_paste(struct client *c, const char *buf, size_t len)
+{
+	struct session			*s = c->session;
+	struct server_client_paste	*paste;
+	struct cmdq_item		*item;
+
+	if (s == NULL || (c->flags & CLIENT_UNATTACHEDFLAGS))
+		return;
+
+	paste = xmalloc(sizeof *paste);
+	paste->buf = xmalloc(len);
+	memcpy(paste->buf, buf, len);
+	paste->len = len;
+
+	item = cmdq_get_callback(server_client_paste_callback, paste);
+	cmdq_append(c, item);
+}
+
 /* Client functions that need to happen every loop. */
 void
 server_client_loop(void)
@@ -1346,9 +1548,22 @@ server_client_loop(void)
 	RB_FOREACH(w, windows, &windows)
 		server_client_check_window_resize(w);
 
+	/*
+	 * Update which windows are visible on some client, so screen writes
+	 * to the others can skip tty bookkeeping entirely.
+	 */
+	RB_FOREACH(w, windows, &windows)
+		w->flags &= ~WINDOW_VISIBLE;
+	TAILQ_FOREACH(c, &clients, entry) {
+		if (c->session != NULL)
+			c->session->curw->window->flags |= WINDOW_VISIBLE;
+	}
+
 	/* Check clients. */
 	TAILQ_FOREACH(c, &clients, entry) {
 		server_client_check_exit(c);
+		if (c->flags & CLIENT_CONTROL)
+			control_check_subs(c);
 		if (c->session != NULL) {
 			server_client_check_redraw(c);
 			server_client_reset_state(c);
@@ -1366,7 +1581,11 @@ server_client_loop(void)
 				if (focus)
 					server_client_check_pane_focus(wp);
 				server_client_check_pane_resize(wp);
+				if (wp->flags & PANE_BACKPRESSURE)
+					window_pane_check_backpressure(wp);
 			}
+			if (wp->flags & PANE_REDRAW)
+				screen_dirty_clear(wp->screen);
 			wp->flags &= ~PANE_REDRAW;
 		}
 		check_window_name(w);
@@ -1634,6 +1853,38 @@ server_client_reset_state(struct client *c)
 	tty->flags |= flags;
 }
 
+/* Apply a changed client size: recalculate layouts and redraw. */
+static void
+server_client_resize_apply(struct client *c)
+{
+	log_record("resize %s to %ux%u", c->name, c->tty.sx, c->tty.sy);
+	recalculate_sizes_for_client(c);
+	server_redraw_client(c);
+	if (c->session != NULL)
+		notify_client("client-resized", c);
+}
+
+/*
+ * Client resize debounce timer. If more resizes arrived while the timer was
+ * running, only the latest size is applied, and the timer is restarted so a
+ * continuing drag keeps being coalesced.
+ */
+static void
+server_client_resize_timer(__unused int fd, __unused short events, void *data)
+{
+	struct client	*c = data;
+	struct timeval	 tv = { .tv_usec = 100000 };
+
+	if (~c->flags & CLIENT_RESIZEAGAIN)
+		return;
+	c->flags &= ~CLIENT_RESIZEAGAIN;
+
+	log_debug("%s: %s applying deferred resize (%ux%u)", __func__, c->name,
+	    c->tty.sx, c->tty.sy);
+	server_client_resize_apply(c);
+	evtimer_add(&c->resize_timer, &tv);
+}
+
 /* Repeat time callback. */
 static void
 server_client_repeat_timer(__unused int fd, __unused short events, void *data)
@@ -1709,11 +1960,14 @@ server_client_check_redraw(struct client *c)
 	struct window		*w = c->session->curw->window;
 	struct window_pane	*wp;
 	int			 needed, flags, mode = tty->mode, new_flags = 0;
-	int			 redraw;
-	u_int			 bit = 0;
+	int			 redraw, only_dirty, defer = 0, trace;
+	u_int			 bit = 0, traced_panes = 0;
 	struct timeval		 tv = { .tv_usec = 1000 };
+	struct timeval		 interval = { .tv_usec = 16667 };
+	struct timeval		 now, since, trace_panes, trace_screen;
 	static struct event	 ev;
 	size_t			 left;
+	uint64_t		 usec, trace_writes = 0, trace_expands = 0;
 
 	if (c->flags & (CLIENT_CONTROL|CLIENT_SUSPENDED))
 		return;
@@ -1736,7 +1990,8 @@ server_client_check_redraw(struct client *c)
 		needed = 1;
 	else {
 		TAILQ_FOREACH(wp, &w->panes, entry) {
-			if (wp->flags & PANE_REDRAW) {
+			if ((wp->flags & PANE_REDRAW) &&
+			    window_pane_visible(wp)) {
 				needed = 1;
 				break;
 			}
@@ -1744,7 +1999,35 @@ server_client_check_redraw(struct client *c)
 		if (needed)
 			new_flags |= CLIENT_REDRAWPANES;
 	}
-	if (needed && (left = EVBUFFER_LENGTH(tty->out)) != 0) {
+	/*
+	 * Also defer if the last redraw was very recent: during redraw storms
+	 * (for example dragging a resize) there is no point repainting faster
+	 * than about sixty frames a second, the intermediate frames are just
+	 * discarded work. If the client has been measured to drain slower
+	 * than that, stretch the interval to match - a slow client gets
+	 * fewer, fresher frames instead of a backlog of stale ones.
+	 */
+	if (c->redraw_bps != 0 && c->redraw_size != 0) {
+		usec = (uint64_t)c->redraw_size * 1000000 / c->redraw_bps;
+		if (usec > 250000)
+			usec = 250000;
+		if (usec > (uint64_t)interval.tv_usec)
+			interval.tv_usec = usec;
+	}
+	gettimeofday(&now, NULL);
+	if (needed) {
+		if ((left = EVBUFFER_LENGTH(tty->out)) != 0)
+			defer = 1;
+		else {
+			timersub(&now, &c->redraw_time, &since);
+			if (timercmp(&since, &interval, <)) {
+				timersub(&interval, &since, &tv);
+				left = 0;
+				defer = 1;
+			}
+		}
+	}
+	if (defer) {
 		log_debug("%s: redraw deferred (%zu left)", c->name, left);
 		if (!evtimer_initialized(&ev))
 			evtimer_set(&ev, server_client_redraw_timer, NULL);
@@ -1753,9 +2036,28 @@ server_client_check_redraw(struct client *c)
 			evtimer_add(&ev, &tv);
 		}
 
+		/*
+		 * The deferred redraw can wait but the active pane is where
+		 * the user is typing, so repaint it now to keep the cursor
+		 * and echo responsive - unless the client is so far behind
+		 * that adding to the backlog would make things worse. Any
+		 * repeat of this pane in the deferred redraw is caught by
+		 * the drawn-line shadow and costs nothing.
+		 */
+		if (c->overlay_draw == NULL &&
+		    (~c->flags & CLIENT_REDRAWWINDOW) &&
+		    (w->active->flags & PANE_REDRAW) &&
+		    left < 4096) {
+			log_debug("%s: active pane %%%u drawn early", c->name,
+			    w->active->id);
+			screen_redraw_pane(c, w->active,
+			    c->redraw_panes == 0);
+		}
+
 		if (~c->flags & CLIENT_REDRAWWINDOW) {
 			TAILQ_FOREACH(wp, &w->panes, entry) {
-				if (wp->flags & PANE_REDRAW) {
+				if ((wp->flags & PANE_REDRAW) &&
+				    window_pane_visible(wp)) {
 					log_debug("%s: pane %%%u needs redraw",
 					    c->name, wp->id);
 					c->redraw_panes |= (1 << bit);
@@ -1778,6 +2080,13 @@ server_client_check_redraw(struct client *c)
 	} else if (needed)
 		log_debug("%s: redraw needed", c->name);
 
+	trace = (c->redraw_trace == 1 && needed);
+	if (trace) {
+		gettimeofday(&trace_panes, NULL);
+		trace_writes = server_perf.tty_writes;
+		trace_expands = server_perf.format_expands;
+	}
+
 	flags = tty->flags & (TTY_BLOCK|TTY_FREEZE|TTY_NOCURSOR);
 	tty->flags = (tty->flags & ~(TTY_BLOCK|TTY_FREEZE))|TTY_NOCURSOR;
 
@@ -1788,19 +2097,29 @@ server_client_check_redraw(struct client *c)
 		 */
 		TAILQ_FOREACH(wp, &w->panes, entry) {
 			redraw = 0;
-			if (wp->flags & PANE_REDRAW)
+			only_dirty = 0;
+			if (wp->flags & PANE_REDRAW) {
 				redraw = 1;
-			else if (c->flags & CLIENT_REDRAWPANES)
+				/*
+				 * The screen's dirty lines cover this redraw
+				 * unless an earlier deferred redraw of the
+				 * pane is still pending for this client.
+				 */
+				only_dirty = !(c->redraw_panes & (1 << bit));
+			} else if (c->flags & CLIENT_REDRAWPANES)
 				redraw = !!(c->redraw_panes & (1 << bit));
 			bit++;
 			if (!redraw)
 				continue;
 			log_debug("%s: redrawing pane %%%u", __func__, wp->id);
-			screen_redraw_pane(c, wp);
+			screen_redraw_pane(c, wp, only_dirty);
+			traced_panes++;
 		}
 		c->redraw_panes = 0;
 		c->flags &= ~CLIENT_REDRAWPANES;
 	}
+	if (trace)
+		gettimeofday(&trace_screen, NULL);
 
 	if (c->flags & CLIENT_ALLREDRAWFLAGS) {
 		if (options_get_number(s->options, "set-titles"))
@@ -1821,7 +2140,33 @@ server_client_check_redraw(struct client *c)
 		 * generated.
 		 */
 		c->redraw = EVBUFFER_LENGTH(tty->out);
+		c->redraw_size = c->redraw;
 		log_debug("%s: redraw added %zu bytes", c->name, c->redraw);
+		c->redraw_time = now;
+	}
+
+	if (trace) {
+		gettimeofday(&since, NULL);
+		timersub(&since, &trace_screen, &since);
+		usec = (uint64_t)since.tv_sec * 1000000 + since.tv_usec;
+		timersub(&trace_screen, &trace_panes, &trace_screen);
+		server_add_message("%s redraw trace: %u panes in %lluus, "
+		    "screen in %lluus, %llu tty writes, %llu formats, "
+		    "%zu bytes queued", c->name, traced_panes,
+		    (unsigned long long)((uint64_t)trace_screen.tv_sec *
+		    1000000 + trace_screen.tv_usec),
+		    (unsigned long long)usec,
+		    (unsigned long long)(server_perf.tty_writes -
+		    trace_writes),
+		    (unsigned long long)(server_perf.format_expands -
+		    trace_expands), c->redraw);
+		if (c->redraw != 0)
+			c->redraw_trace = 2;
+		else {
+			server_add_message("%s redraw trace: nothing to "
+			    "flush", c->name);
+			c->redraw_trace = 0;
+		}
 	}
 }
 
@@ -1857,6 +2202,8 @@ server_client_dispatch(struct imsg *imsg, void *arg)
 	struct client	*c = arg;
 	ssize_t		 datalen;
 	struct session	*s;
+	u_int		 sx, sy, xpixel, ypixel;
+	struct timeval	 tv = { .tv_usec = 100000 };
 
 	if (c->flags & CLIENT_DEAD)
 		return;
@@ -1876,6 +2223,7 @@ server_client_dispatch(struct imsg *imsg, void *arg)
 	case MSG_IDENTIFY_CWD:
 	case MSG_IDENTIFY_STDIN:
 	case MSG_IDENTIFY_ENVIRON:
+	case MSG_IDENTIFY_ENVIRONBLOCK:
 	case MSG_IDENTIFY_CLIENTPID:
 	case MSG_IDENTIFY_DONE:
 		server_client_dispatch_identify(c, imsg);
@@ -1891,11 +2239,42 @@ server_client_dispatch(struct imsg *imsg, void *arg)
 			break;
 		server_client_update_latest(c);
 		server_client_clear_overlay(c);
+
+		/*
+		 * The client sends a resize message when it first attaches as
+		 * well as on SIGWINCH, so the size frequently hasn't changed;
+		 * don't repaint the whole screen again if so.
+		 */
+		sx = c->tty.sx;
+		sy = c->tty.sy;
+		xpixel = c->tty.xpixel;
+		ypixel = c->tty.ypixel;
 		tty_resize(&c->tty);
-		recalculate_sizes();
-		server_redraw_client(c);
-		if (c->session != NULL)
-			notify_client("client-resized", c);
+		if (c->tty.sx == sx &&
+		    c->tty.sy == sy &&
+		    c->tty.xpixel == xpixel &&
+		    c->tty.ypixel == ypixel) {
+			log_debug("%s: size unchanged at %ux%u", c->name, sx,
+			    sy);
+			break;
+		}
+
+		/*
+		 * Dragging a terminal corner delivers a stream of resizes, and
+		 * recalculating layouts and reflowing every pane for each
+		 * intermediate size is wasted work. Apply the first
+		 * immediately so a single resize feels instant, then debounce:
+		 * while the timer runs only note that the size changed again,
+		 * and let the timer apply the latest size once they stop.
+		 */
+		if (evtimer_pending(&c->resize_timer, NULL)) {
+			log_debug("%s: resize to %ux%u deferred", c->name,
+			    c->tty.sx, c->tty.sy);
+			c->flags |= CLIENT_RESIZEAGAIN;
+			break;
+		}
+		server_client_resize_apply(c);
+		evtimer_add(&c->resize_timer, &tv);
 		break;
 	case MSG_EXITING:
 		if (datalen != 0)
@@ -2092,6 +2471,17 @@ server_client_dispatch_identify(struct client *c, struct imsg *imsg)
 			environ_put(c->environ, data, 0);
 		log_debug("client %p IDENTIFY_ENVIRON %s", c, data);
 		break;
+	case MSG_IDENTIFY_ENVIRONBLOCK:
+		if (datalen == 0 || data[datalen - 1] != '\0')
+			fatalx("bad MSG_IDENTIFY_ENVIRONBLOCK string");
+		while (datalen != 0) {
+			if (strchr(data, '=') != NULL)
+				environ_put(c->environ, data, 0);
+			log_debug("client %p IDENTIFY_ENVIRON %s", c, data);
+			datalen -= strlen(data) + 1;
+			data += strlen(data) + 1;
+		}
+		break;
 	case MSG_IDENTIFY_CLIENTPID:
 		if (datalen != sizeof c->pid)
 			fatalx("bad MSG_IDENTIFY_CLIENTPID size");
@@ -2246,8 +2636,9 @@ server_client_get_cwd(struct client *c, struct session *s)
 void
 server_client_set_flags(struct client *c, const char *flags)
 {
-	char	*s, *copy, *next;
-	int	 flag, not;
+	char		*s, *copy, *next;
+	uint64_t	 flag;
+	int		 not;
 
 	s = copy = xstrdup (flags);
 	while ((next = strsep(&s, ",")) != NULL) {
@@ -2257,6 +2648,11 @@ server_client_set_flags(struct client *c, const char *flags)
 
 		if (strcmp(next, "no-output") == 0)
 			flag = CLIENT_CONTROL_NOOUTPUT;
+		else if (strcmp(next, "binary-output") == 0) {
+			if (~c->flags & CLIENT_CONTROL)
+				continue;
+			flag = CLIENT_CONTROL_BINARY;
+		}
 		else if (strcmp(next, "read-only") == 0)
 			flag = CLIENT_READONLY;
 		else if (strcmp(next, "ignore-size") == 0)
@@ -33,12 +33,14 @@ static void		 server_destroy_session_group(struct session *);
 void
 server_redraw_client(struct client *c)
 {
+	status_invalidate();
 	c->flags |= CLIENT_ALLREDRAWFLAGS;
 }
 
 void
 server_status_client(struct client *c)
 {
+	status_invalidate();
 	c->flags |= CLIENT_REDRAWSTATUS;
 }
 
@@ -181,7 +183,7 @@ server_kill_pane(struct window_pane *wp)
 	struct window	*w = wp->window;
 
 	if (window_count_panes(w) == 1) {
-		server_kill_window(w);
+		server_kill_window(w, 1);
 		recalculate_sizes();
 	} else {
 		server_unzoom_window(w);
@@ -192,12 +194,41 @@ server_kill_pane(struct window_pane *wp)
 	}
 }
 
-void
-server_kill_window(struct window *w)
+/* Renumber the windows across a session's group, if enabled. */
+static void
+server_renumber_session(struct session *s)
 {
-	struct session		*s, *next_s, *target_s;
 	struct session_group	*sg;
-	struct winlink		*wl;
+	struct session		*target_s;
+
+	if (options_get_number(s->options, "renumber-windows")) {
+		if ((sg = session_group_contains(s)) != NULL) {
+			TAILQ_FOREACH(target_s, &sg->sessions, gentry)
+				session_renumber_windows(target_s);
+		} else
+			session_renumber_windows(s);
+	}
+}
+
+/* Renumber windows in every session, for after killing a batch of them. */
+void
+server_renumber_all(void)
+{
+	struct session	*s;
+
+	RB_FOREACH(s, sessions, &sessions)
+		server_renumber_session(s);
+}
+
+/*
+ * Kill a window. Callers killing several windows pass renumber as zero and
+ * renumber and recalculate sizes once at the end instead of per window.
+ */
+void
+server_kill_window(struct window *w, int renumber)
+{
+	struct session	*s, *next_s;
+	struct winlink	*wl;
 
 	next_s = RB_MIN(sessions, &sessions);
 	while (next_s != NULL) {
@@ -215,15 +246,11 @@ server_kill_window(struct window *w)
 				server_redraw_session_group(s);
 		}
 
-		if (options_get_number(s->options, "renumber-windows")) {
-			if ((sg = session_group_contains(s)) != NULL) {
-				TAILQ_FOREACH(target_s, &sg->sessions, gentry)
-					session_renumber_windows(target_s);
-			} else
-				session_renumber_windows(s);
-		}
+		if (renumber)
+			server_renumber_session(s);
 	}
-	recalculate_sizes();
+	if (renumber)
+		recalculate_sizes();
 }
 
 int
@@ -355,7 +382,7 @@ server_destroy_pane(struct window_pane *wp, int notify)
 	window_remove_pane(w, wp);
 
 	if (TAILQ_EMPTY(&w->panes))
-		server_kill_window(w);
+		server_kill_window(w, 1);
 	else
 		server_redraw_window(w);
 }
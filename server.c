@@ -26,6 +26,9 @@
 #include <errno.h>
 #include <event.h>
 #include <fcntl.h>
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,13 +50,21 @@ static int		 server_fd = -1;
 static int		 server_client_flags;
 static int		 server_exit;
 static struct event	 server_ev_accept;
+static struct event	 server_ev_hibernate;
+static struct event	 server_ev_compact;
+static struct event	 server_ev_memory;
 
 struct cmd_find_state	 marked_pane;
 
 static u_int		 message_next;
 struct message_list	 message_log;
 
+struct server_perf	 server_perf;
+
 static int	server_loop(void);
+static void	server_hibernate(int, short, void *);
+static void	server_compact(int, short, void *);
+static void	server_memory(int, short, void *);
 static void	server_send_exit(void);
 static void	server_accept(int, short, void *);
 static void	server_signal(int);
@@ -182,11 +193,27 @@ server_start(struct tmuxproc *client, int flags, struct event_base *base,
 			fatal("daemon failed");
 	}
 
+	/*
+	 * Fork the job runner now, before any server state is built, so its
+	 * image stays small and its own forks are cheap.
+	 */
+	job_runner_fork();
+
 	server_client_flags = flags;
 	proc_clear_signals(client, 0);
 
 	if (event_reinit(base) != 0)
 		fatalx("event_reinit failed");
+
+	/*
+	 * Two event priorities: client input and control messages run at
+	 * priority 0 and everything else - in particular reading from pane
+	 * ptys - at priority 1, so a pane producing output as fast as it can
+	 * cannot starve input handling for every client.
+	 */
+	if (event_base_priority_init(base, 2) != 0)
+		log_debug("unable to set event priorities");
+
 	server_proc = proc_start("server");
 
 	proc_set_signals(server_proc, server_signal);
@@ -229,6 +256,10 @@ server_start(struct tmuxproc *client, int flags, struct event_base *base,
 	}
 
 	server_add_accept(0);
+	evtimer_set(&server_ev_hibernate, server_hibernate, NULL);
+	evtimer_set(&server_ev_compact, server_compact, NULL);
+	evtimer_set(&server_ev_memory, server_memory, NULL);
+	server_wake_timers();
 	proc_loop(server_proc, server_loop);
 
 	job_kill_all();
@@ -237,6 +268,189 @@ server_start(struct tmuxproc *client, int flags, struct event_base *base,
 	exit(0);
 }
 
+/*
+ * Periodic sweep hibernating panes that have been idle past the
+ * hibernate-time option: their history is packed and parser scratch freed,
+ * to be rehydrated transparently on access or output. The sweep stops
+ * re-arming itself once every pane is hibernated (or the option is off) so
+ * an idle server does not keep waking for it; server_wake_timers starts it
+ * again when there is activity.
+ */
+static void
+server_hibernate(__unused int fd, __unused short events, __unused void *data)
+{
+	struct window_pane	*wp;
+	struct timeval		 tv = { .tv_sec = 30 };
+	time_t			 t = time(NULL);
+	int			 idle, waiting = 0;
+
+	idle = options_get_number(global_options, "hibernate-time");
+	if (idle == 0)
+		return;
+	RB_FOREACH(wp, window_pane_tree, &all_window_panes) {
+		if (wp->flags & PANE_HIBERNATED)
+			continue;
+		if (t - wp->window->activity_time.tv_sec < idle) {
+			waiting = 1;
+			continue;
+		}
+		window_pane_hibernate(wp);
+	}
+
+	if (waiting)
+		evtimer_add(&server_ev_hibernate, &tv);
+}
+
+/*
+ * Idle-time compaction. Once the server has been quiet for a minute,
+ * repack any history lines that reads have expanded and ask the allocator
+ * to return freed pages to the system. One pass per idle period: nothing
+ * runs again until there has been activity since the last pass, and the
+ * timer is left unset until then so it costs no wakeups either.
+ */
+static void
+server_compact(__unused int fd, __unused short events, __unused void *data)
+{
+	static time_t		 last;
+	struct window_pane	*wp;
+	struct timeval		 tv = { .tv_sec = 30 };
+	time_t			 t = time(NULL), activity = 0;
+	size_t			 reclaimed = 0;
+
+	RB_FOREACH(wp, window_pane_tree, &all_window_panes) {
+		if (wp->window->activity_time.tv_sec > activity)
+			activity = wp->window->activity_time.tv_sec;
+	}
+	if (activity <= last)
+		return;
+	if (t - activity < 60) {
+		tv.tv_sec = 60 - (t - activity);
+		evtimer_add(&server_ev_compact, &tv);
+		return;
+	}
+	last = t;
+
+	RB_FOREACH(wp, window_pane_tree, &all_window_panes)
+		reclaimed += grid_compact(wp->base.grid);
+	server_perf.compact_runs++;
+	server_perf.compact_bytes += reclaimed;
+	if (reclaimed != 0) {
+		log_debug("%s: reclaimed %zu bytes", __func__, reclaimed);
+#ifdef HAVE_MALLOC_TRIM
+		malloc_trim(0);
+#endif
+	}
+}
+
+/*
+ * Enforce the memory-limit option. While the total grid memory of every
+ * pane is over the budget, pack down the biggest histories and hibernate
+ * panes in windows no client is showing, biggest first. Lines are packed
+ * or spilled, never discarded, so scrollback is intact either way.
+ */
+static void
+server_memory(__unused int fd, __unused short events, __unused void *data)
+{
+	struct window_pane	*wp, *biggest;
+	struct timeval		 tv = { .tv_sec = 30 };
+	long long		 limit;
+	size_t			 total = 0, size, bsize, before, after;
+	size_t			 reclaimed = 0;
+
+	limit = options_get_number(global_options, "memory-limit");
+	if (limit == 0)
+		return;
+	limit *= 1024 * 1024;
+
+	RB_FOREACH(wp, window_pane_tree, &all_window_panes)
+		total += window_pane_memory(wp);
+	server_perf.memory_bytes = total;
+	if (total <= (size_t)limit)
+		return;
+
+	/* First pack any history lines that reads have expanded. */
+	RB_FOREACH(wp, window_pane_tree, &all_window_panes)
+		reclaimed += grid_compact(wp->base.grid);
+
+	/* Then hibernate panes in windows not on any client, biggest first. */
+	while (total - reclaimed > (size_t)limit) {
+		biggest = NULL;
+		bsize = 0;
+		RB_FOREACH(wp, window_pane_tree, &all_window_panes) {
+			if (wp->flags & PANE_HIBERNATED)
+				continue;
+			if (wp->window->flags & WINDOW_VISIBLE)
+				continue;
+			size = window_pane_memory(wp);
+			if (biggest == NULL || size > bsize) {
+				biggest = wp;
+				bsize = size;
+			}
+		}
+		if (biggest == NULL)
+			break;
+		before = window_pane_memory(biggest);
+		window_pane_hibernate(biggest);
+		grid_spill(biggest->base.grid);
+		after = window_pane_memory(biggest);
+		if (before > after)
+			reclaimed += before - after;
+	}
+
+	server_perf.memory_runs++;
+	server_perf.memory_reclaimed += reclaimed;
+	server_perf.memory_bytes = total - reclaimed;
+	if (reclaimed != 0) {
+		log_debug("%s: reclaimed %zu bytes", __func__, reclaimed);
+#ifdef HAVE_MALLOC_TRIM
+		malloc_trim(0);
+#endif
+	}
+	evtimer_add(&server_ev_memory, &tv);
+}
+
+/*
+ * Arm the idle sweeps after activity. They disarm themselves when a pass
+ * finds nothing left to age out, so checking the pending flag here is all
+ * a busy server pays.
+ */
+/*
+ * Phase offset of this server's periodic ticks within the second. With many
+ * servers on a host, ticking exactly on second boundaries means they all
+ * wake at once; spreading each server by a stable sub-second offset keeps
+ * the host load flat. The status-phase option pins the offset, otherwise it
+ * comes from the pid.
+ */
+uint64_t
+server_tick_phase(void)
+{
+	long long	phase;
+
+	phase = options_get_number(global_options, "status-phase");
+	if (phase >= 0 && phase < 1000)
+		return ((uint64_t)phase * 1000);
+	return ((uint64_t)getpid() * 2654435761ULL % 1000000);
+}
+
+void
+server_wake_timers(void)
+{
+	struct timeval	tv = { .tv_sec = 30 };
+
+	if (event_initialized(&server_ev_hibernate) &&
+	    options_get_number(global_options, "hibernate-time") != 0 &&
+	    !evtimer_pending(&server_ev_hibernate, NULL))
+		evtimer_add(&server_ev_hibernate, &tv);
+	if (event_initialized(&server_ev_memory) &&
+	    options_get_number(global_options, "memory-limit") != 0 &&
+	    !evtimer_pending(&server_ev_memory, NULL))
+		evtimer_add(&server_ev_memory, &tv);
+	tv.tv_sec = 60;
+	if (event_initialized(&server_ev_compact) &&
+	    !evtimer_pending(&server_ev_compact, NULL))
+		evtimer_add(&server_ev_compact, &tv);
+}
+
 /* Server loop callback. */
 static int
 server_loop(void)
@@ -244,12 +458,15 @@ server_loop(void)
 	struct client	*c;
 	u_int		 items;
 
+	server_perf.loops++;
+
 	do {
 		items = cmdq_next(NULL);
 		TAILQ_FOREACH(c, &clients, entry) {
 			if (c->flags & CLIENT_IDENTIFIED)
 				items += cmdq_next(c);
 		}
+		items += notify_async_next();
 	} while (items != 0);
 
 	server_client_loop();
@@ -353,22 +570,32 @@ server_accept(int fd, short events, __unused void *data)
 	if (!(events & EV_READ))
 		return;
 
-	newfd = accept(fd, (struct sockaddr *) &sa, &slen);
-	if (newfd == -1) {
-		if (errno == EAGAIN || errno == EINTR || errno == ECONNABORTED)
-			return;
-		if (errno == ENFILE || errno == EMFILE) {
-			/* Delete and don't try again for 1 second. */
-			server_add_accept(1);
+	/*
+	 * Accept until the queue is empty rather than one connection per
+	 * callback; clients connecting at a high rate would otherwise pay a
+	 * trip around the event loop each.
+	 */
+	for (;;) {
+		newfd = accept(fd, (struct sockaddr *) &sa, &slen);
+		if (newfd == -1) {
+			if (errno == EAGAIN ||
+			    errno == EINTR ||
+			    errno == ECONNABORTED)
+				return;
+			if (errno == ENFILE || errno == EMFILE) {
+				/* Delete and don't try again for 1 second. */
+				server_add_accept(1);
+				return;
+			}
+			fatal("accept failed");
+		}
+		if (server_exit) {
+			close(newfd);
 			return;
 		}
-		fatal("accept failed");
-	}
-	if (server_exit) {
-		close(newfd);
-		return;
+		server_client_create(newfd);
+		slen = sizeof sa;
 	}
-	server_client_create(newfd);
 }
 
 /*
@@ -27,7 +27,10 @@
 #include "tmux.h"
 
 struct sessions		sessions;
+struct session_activity_list session_activity_list =
+    TAILQ_HEAD_INITIALIZER(session_activity_list);
 static u_int		next_session_id;
+static struct session	*session_find_cache;
 struct session_groups	session_groups = RB_INITIALIZER(&session_groups);
 
 static void	session_free(int, short, void *);
@@ -38,6 +41,8 @@ static struct winlink *session_next_alert(struct winlink *);
 static struct winlink *session_previous_alert(struct winlink *);
 
 static void	session_group_remove(struct session *);
+static int	session_group_linked_elsewhere(struct session *,
+		    struct winlink *, struct window *);
 static void	session_group_synchronize1(struct session *, struct session *);
 
 int
@@ -70,14 +75,25 @@ session_alive(struct session *s)
 	return (0);
 }
 
-/* Find session by name. */
+/*
+ * Find session by name. The same session is typically looked up many times in
+ * a row (formats, notifys, command targets), so keep the last result and skip
+ * the tree walk with its strcmp at every node when it still matches. Only
+ * destruction invalidates the pointer; a rename leaves it alive and the name
+ * comparison takes care of correctness.
+ */
 struct session *
 session_find(const char *name)
 {
 	struct session	s;
 
+	if (session_find_cache != NULL &&
+	    strcmp(session_find_cache->name, name) == 0)
+		return (session_find_cache);
+
 	s.name = (char *) name;
-	return (RB_FIND(sessions, &sessions, &s));
+	session_find_cache = RB_FIND(sessions, &sessions, &s);
+	return (session_find_cache);
 }
 
 /* Find session by id parsed from a string. */
@@ -150,6 +166,7 @@ session_create(const char *prefix, const char *name, const char *cwd,
 		} while (RB_FIND(sessions, &sessions, s) != NULL);
 	}
 	RB_INSERT(sessions, &sessions, s);
+	TAILQ_INSERT_HEAD(&session_activity_list, s, activity_entry);
 
 	log_debug("new session %s $%u", s->name, s->id);
 
@@ -205,12 +222,17 @@ session_destroy(struct session *s, int notify, const char *from)
 	log_debug("session %s destroyed (%s)", s->name, from);
 	s->curw = NULL;
 
+	if (session_find_cache == s)
+		session_find_cache = NULL;
 	RB_REMOVE(sessions, &sessions, s);
+	TAILQ_REMOVE(&session_activity_list, s, activity_entry);
 	if (notify)
 		notify_session("session-closed", s);
 
 	free(s->tio);
 
+	spawn_pool_discard(s);
+
 	if (event_initialized(&s->lock_timer))
 		event_del(&s->lock_timer);
 
@@ -267,6 +289,7 @@ session_update_activity(struct session *s, struct timeval *from)
 {
 	struct timeval	*last = &s->last_activity_time;
 	struct timeval	 tv;
+	struct session	*s2;
 
 	memcpy(last, &s->activity_time, sizeof *last);
 	if (from == NULL)
@@ -274,6 +297,20 @@ session_update_activity(struct session *s, struct timeval *from)
 	else
 		memcpy(&s->activity_time, from, sizeof s->activity_time);
 
+	/*
+	 * Keep the activity-ordered list current. The new time is almost
+	 * always the most recent so this rarely moves past the head.
+	 */
+	TAILQ_REMOVE(&session_activity_list, s, activity_entry);
+	TAILQ_FOREACH(s2, &session_activity_list, activity_entry) {
+		if (timercmp(&s->activity_time, &s2->activity_time, >=))
+			break;
+	}
+	if (s2 == NULL)
+		TAILQ_INSERT_TAIL(&session_activity_list, s, activity_entry);
+	else
+		TAILQ_INSERT_BEFORE(s2, s, activity_entry);
+
 	log_debug("session $%u %s activity %lld.%06d (last %lld.%06d)", s->id,
 	    s->name, (long long)s->activity_time.tv_sec,
 	    (int)s->activity_time.tv_usec, (long long)last->tv_sec,
@@ -629,16 +666,35 @@ session_group_synchronize_from(struct session *target)
 }
 
 /*
- * Synchronize a session with a target session. This means destroying all
- * winlinks then recreating them, then updating the current window, last window
- * stack and alerts.
+ * Check if a window is linked in a session by a winlink other than the one
+ * given (which may be NULL).
+ */
+static int
+session_group_linked_elsewhere(struct session *s, struct winlink *skip,
+    struct window *w)
+{
+	struct winlink	*wl;
+
+	RB_FOREACH(wl, winlinks, &s->windows) {
+		if (wl != skip && wl->window == w)
+			return (1);
+	}
+	return (0);
+}
+
+/*
+ * Synchronize a session with a target session. Winlinks which already match
+ * the target are left alone, so only changed windows are relinked and only
+ * actual changes are notified, and the last window stack survives for any
+ * windows which remain.
  */
 static void
 session_group_synchronize1(struct session *target, struct session *s)
 {
-	struct winlinks		 old_windows, *ww;
-	struct winlink_stack	 old_lastw;
-	struct winlink		*wl, *wl2;
+	struct winlinks	*ww;
+	struct winlink	*wl, *wl1, *wl2;
+	struct window	*old;
+	int		 linked;
 
 	/* Don't do anything if the session is empty (it'll be destroyed). */
 	ww = &target->windows;
@@ -651,47 +707,52 @@ session_group_synchronize1(struct session *target, struct session *s)
 	    session_last(s) != 0 && session_previous(s, 0) != 0)
 		session_next(s, 0);
 
-	/* Save the old pointer and reset it. */
-	memcpy(&old_windows, &s->windows, sizeof old_windows);
-	RB_INIT(&s->windows);
+	/* Remove winlinks whose index is not in the target. */
+	RB_FOREACH_SAFE(wl, winlinks, &s->windows, wl1) {
+		if (winlink_find_by_index(ww, wl->idx) != NULL)
+			continue;
+		old = wl->window;
+		if (winlink_find_by_window_id(ww, old->id) == NULL &&
+		    !session_group_linked_elsewhere(s, wl, old))
+			notify_session_window("window-unlinked", s, old);
+		if (wl == s->curw)
+			s->curw = NULL;
+		winlink_stack_remove(&s->lastw, wl);
+		winlink_remove(&s->windows, wl);
+	}
 
-	/* Link all the windows from the target. */
+	/* Add or update winlinks to match the target. */
 	RB_FOREACH(wl, winlinks, ww) {
-		wl2 = winlink_add(&s->windows, wl->idx);
-		wl2->session = s;
+		wl2 = winlink_find_by_index(&s->windows, wl->idx);
+		if (wl2 != NULL && wl2->window == wl->window) {
+			wl2->flags |= wl->flags & WINLINK_ALERTFLAGS;
+			continue;
+		}
+		if (wl2 == NULL) {
+			wl2 = winlink_add(&s->windows, wl->idx);
+			wl2->session = s;
+		} else {
+			old = wl2->window;
+			if (winlink_find_by_window_id(ww, old->id) == NULL &&
+			    !session_group_linked_elsewhere(s, wl2, old))
+				notify_session_window("window-unlinked", s,
+				    old);
+		}
+		linked = session_group_linked_elsewhere(s, wl2, wl->window);
 		winlink_set_window(wl2, wl->window);
-		notify_session_window("window-linked", s, wl2->window);
 		wl2->flags |= wl->flags & WINLINK_ALERTFLAGS;
+		if (!linked)
+			notify_session_window("window-linked", s, wl->window);
 	}
 
-	/* Fix up the current window. */
-	if (s->curw != NULL)
-		s->curw = winlink_find_by_index(&s->windows, s->curw->idx);
-	else
+	/* Fix up the current window if it was removed. */
+	if (s->curw == NULL)
 		s->curw = winlink_find_by_index(&s->windows, target->curw->idx);
-
-	/* Fix up the last window stack. */
-	memcpy(&old_lastw, &s->lastw, sizeof old_lastw);
-	TAILQ_INIT(&s->lastw);
-	TAILQ_FOREACH(wl, &old_lastw, sentry) {
-		wl2 = winlink_find_by_index(&s->windows, wl->idx);
-		if (wl2 != NULL)
-			TAILQ_INSERT_TAIL(&s->lastw, wl2, sentry);
-	}
-
-	/* Then free the old winlinks list. */
-	while (!RB_EMPTY(&old_windows)) {
-		wl = RB_ROOT(&old_windows);
-		wl2 = winlink_find_by_window_id(&s->windows, wl->window->id);
-		if (wl2 == NULL)
-			notify_session_window("window-unlinked", s, wl->window);
-		winlink_remove(&old_windows, wl);
-	}
 }
 
-/* Renumber the windows across winlinks attached to a specific session. */
-void
-session_renumber_windows(struct session *s)
+/* Renumber the windows by rebuilding the winlink tree and last stack. */
+static void
+session_renumber_windows_full(struct session *s)
 {
 	struct winlink		*wl, *wl1, *wl_new;
 	struct winlinks		 old_wins;
@@ -735,3 +796,38 @@ session_renumber_windows(struct session *s)
 	RB_FOREACH_SAFE(wl, winlinks, &old_wins, wl1)
 		winlink_remove(&old_wins, wl);
 }
+
+/* Renumber the windows across winlinks attached to a specific session. */
+void
+session_renumber_windows(struct session *s)
+{
+	struct winlink	*wl, *wl1;
+	int		 new_idx;
+
+	/*
+	 * Indexes are assigned in order from the base-index, so the new index
+	 * is normally at or below the old and each winlink can be shifted in
+	 * place, keeping the winlink structures, the last window stack and
+	 * the window references. If the base-index has been raised above an
+	 * existing index, new indexes could collide with windows not yet
+	 * renumbered, so fall back to a full rebuild.
+	 */
+	new_idx = options_get_number(s->options, "base-index");
+	RB_FOREACH(wl, winlinks, &s->windows) {
+		if (new_idx > wl->idx) {
+			session_renumber_windows_full(s);
+			return;
+		}
+		new_idx++;
+	}
+
+	new_idx = options_get_number(s->options, "base-index");
+	RB_FOREACH_SAFE(wl, winlinks, &s->windows, wl1) {
+		if (wl->idx != new_idx) {
+			RB_REMOVE(winlinks, &s->windows, wl);
+			wl->idx = new_idx;
+			RB_INSERT(winlinks, &s->windows, wl);
+		}
+		new_idx++;
+	}
+}
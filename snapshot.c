@@ -0,0 +1,936 @@
+/* $OpenBSD$ */
+
+/*
+ * Copyright (c) 2021 Nicholas Marriott <nicholas.marriott@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF MIND, USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tmux.h"
+
+/*
+ * Save and restore server state - sessions, windows, layouts and pane
+ * contents - so sessions survive a host reboot without replaying commands.
+ *
+ * The snapshot is a versioned text file. Each session records its name and
+ * working directory; each window its index, name and layout string; each
+ * pane its working directory and contents. Pane contents are the history
+ * and visible screen rendered with escape sequences (as capture-pane -e
+ * would produce) and are replayed through the input parser on restore, so
+ * colours and attributes come back without a separate cell format.
+ *
+ * Restored panes run a fresh shell below the saved scrollback; the old
+ * processes died with the old host, so there is nothing else to put in
+ * them.
+ *
+ * Between snapshots an append-only journal (the journal-file option) records
+ * structural changes - sessions and windows created, closed, renamed and
+ * relaid out - as they are reported through notify. Recovery replays the
+ * journal over the last snapshot, so only changes inside the current sync
+ * batch (the journal-interval option) can be lost. The snapshot records the
+ * old server's session and window ids so journal entries can be matched to
+ * the objects the restore created; a successful snapshot supersedes and
+ * truncates the journal.
+ */
+
+#define SNAPSHOT_VERSION 2
+
+static char		*snapshot_pane_content(struct window_pane *,
+			     size_t *);
+static int		 snapshot_write_file(const char *, struct session *,
+			     char **);
+static int		 snapshot_restore_window(struct cmdq_item *, FILE *,
+			     struct session *, int, u_int, char **);
+static struct window_pane *snapshot_biggest_pane(struct window *);
+static enum cmd_retval	 snapshot_restore_cb(struct cmdq_item *, void *);
+
+static char	*journal_default_path(void);
+static void	 journal_record(const char *, ...) printflike(1, 2);
+static void	 journal_flush(void);
+static void	 journal_flush_timer(int, short, void *);
+static void	 journal_close(void);
+static void	 journal_apply(struct cmdq_item *, char *);
+
+/*
+ * Maps from ids in a snapshot or journal - from the server that wrote them -
+ * to the ids of the objects recovery created for them.
+ */
+struct snapshot_map {
+	u_int	*old;
+	u_int	*new;
+	u_int	 n;
+};
+static struct snapshot_map	 snapshot_session_map;
+static struct snapshot_map	 snapshot_window_map;
+
+/*
+ * Spawning a session reports its first window before the session itself, so
+ * replay can meet a window-linked record for a session it has not created
+ * yet. Such records wait here until their session-created arrives.
+ */
+struct journal_pending {
+	u_int				 sid;
+	char				*line;
+	TAILQ_ENTRY(journal_pending)	 entry;
+};
+static TAILQ_HEAD(, journal_pending) journal_pending_list =
+    TAILQ_HEAD_INITIALIZER(journal_pending_list);
+
+static int		 journal_fd = -1;
+static char		*journal_path;
+static struct evbuffer	*journal_buffer;
+static struct event	 journal_flush_event;
+static int		 journal_replaying;
+
+static void
+snapshot_map_add(struct snapshot_map *m, u_int old, u_int new)
+{
+	m->old = xreallocarray(m->old, m->n + 1, sizeof *m->old);
+	m->new = xreallocarray(m->new, m->n + 1, sizeof *m->new);
+	m->old[m->n] = old;
+	m->new[m->n] = new;
+	m->n++;
+}
+
+static int
+snapshot_map_get(struct snapshot_map *m, u_int old, u_int *new)
+{
+	u_int	i;
+
+	for (i = 0; i < m->n; i++) {
+		if (m->old[i] == old) {
+			*new = m->new[i];
+			return (0);
+		}
+	}
+	return (-1);
+}
+
+static struct session *
+snapshot_map_session(u_int old)
+{
+	u_int	new;
+
+	if (snapshot_map_get(&snapshot_session_map, old, &new) != 0)
+		return (NULL);
+	return (session_find_by_id(new));
+}
+
+static struct window *
+snapshot_map_window(u_int old)
+{
+	u_int	new;
+
+	if (snapshot_map_get(&snapshot_window_map, old, &new) != 0)
+		return (NULL);
+	return (window_find_by_id(new));
+}
+
+/* Default snapshot path, next to the server socket. */
+static char *
+snapshot_default_path(void)
+{
+	char	*path;
+
+	xasprintf(&path, "%s.snapshot", socket_path);
+	return (path);
+}
+
+/* Render a pane's history and screen with escape sequences. */
+static char *
+snapshot_pane_content(struct window_pane *wp, size_t *len)
+{
+	struct grid		*gd = wp->base.grid;
+	struct grid_cell	*gc = NULL;
+	const struct grid_line	*gl;
+	char			*buf, *line;
+	size_t			 linelen, size;
+	u_int			 i, sx = screen_size_x(&wp->base);
+	int			 wrapped;
+
+	*len = 0;
+	size = 4096;
+	buf = xmalloc(size);
+
+	for (i = 0; i < gd->hsize + gd->sy; i++) {
+		gl = grid_peek_line(gd, i);
+		wrapped = (gl->flags & GRID_LINE_WRAPPED);
+
+		line = grid_string_cells(gd, 0, i, sx, &gc, 1, 0, !wrapped);
+		linelen = strlen(line);
+
+		while (*len + linelen + 2 > size) {
+			size *= 2;
+			buf = xrealloc(buf, size);
+		}
+		memcpy(buf + *len, line, linelen);
+		*len += linelen;
+		if (!wrapped) {
+			buf[(*len)++] = '\r';
+			buf[(*len)++] = '\n';
+		}
+		free(line);
+	}
+
+	return (buf);
+}
+
+/* Write a snapshot of every session to path. */
+int
+snapshot_write_file(const char *path, struct session *only, char **cause)
+{
+	struct session		*s;
+	struct winlink		*wl;
+	struct window		*w;
+	struct window_pane	*wp;
+	FILE			*f;
+	char			*tmp, *layout, *content;
+	size_t			 len;
+
+	xasprintf(&tmp, "%s.tmp", path);
+
+	if ((f = fopen(tmp, "w")) == NULL) {
+		xasprintf(cause, "%s: %s", tmp, strerror(errno));
+		free(tmp);
+		return (-1);
+	}
+	fprintf(f, "tmux-snapshot %d\n", SNAPSHOT_VERSION);
+
+	RB_FOREACH(s, sessions, &sessions) {
+		if (only != NULL && s != only)
+			continue;
+		fprintf(f, "session %d %u %s\n", s->curw->idx, s->id, s->name);
+		fprintf(f, "cwd %s\n", s->cwd);
+
+		RB_FOREACH(wl, winlinks, &s->windows) {
+			w = wl->window;
+			layout = layout_dump(w->layout_root);
+			if (layout == NULL)
+				continue;
+			fprintf(f, "window %d %u\n", wl->idx, w->id);
+			fprintf(f, "name %s\n", w->name);
+			fprintf(f, "layout %s\n", layout);
+			free(layout);
+
+			TAILQ_FOREACH(wp, &w->panes, entry) {
+				content = snapshot_pane_content(wp, &len);
+				fprintf(f, "pane %zu %d\n", len,
+				    wp == w->active);
+				fprintf(f, "cwd %s\n", wp->cwd);
+				fwrite(content, 1, len, f);
+				fputc('\n', f);
+				free(content);
+			}
+		}
+	}
+
+	if (fclose(f) != 0 || rename(tmp, path) != 0) {
+		xasprintf(cause, "%s: %s", path, strerror(errno));
+		unlink(tmp);
+		free(tmp);
+		return (-1);
+	}
+	log_debug("%s: wrote %s", __func__, path);
+	free(tmp);
+	return (0);
+}
+
+int
+snapshot_write(const char *path, char **cause)
+{
+	char	*used = NULL;
+
+	if (path == NULL)
+		path = used = snapshot_default_path();
+	if (snapshot_write_file(path, NULL, cause) != 0) {
+		free(used);
+		return (-1);
+	}
+	free(used);
+
+	/* The snapshot supersedes anything journalled before it. */
+	if (journal_fd != -1) {
+		if (journal_buffer != NULL) {
+			evbuffer_drain(journal_buffer,
+			    EVBUFFER_LENGTH(journal_buffer));
+		}
+		if (ftruncate(journal_fd, 0) == 0)
+			fdatasync(journal_fd);
+	}
+	return (0);
+}
+
+/*
+ * Write a snapshot of a single session, for handing it to another server.
+ * The journal is not truncated: this is an export, not a local checkpoint.
+ */
+int
+snapshot_write_session(struct session *s, const char *path, char **cause)
+{
+	return (snapshot_write_file(path, s, cause));
+}
+
+/* Find the biggest pane in a window, the best candidate for splitting. */
+static struct window_pane *
+snapshot_biggest_pane(struct window *w)
+{
+	struct window_pane	*wp, *best = NULL;
+
+	TAILQ_FOREACH(wp, &w->panes, entry) {
+		if (best == NULL || wp->sx * wp->sy > best->sx * best->sy)
+			best = wp;
+	}
+	return (best);
+}
+
+/*
+ * Restore one window section: spawn the first pane with the window, split
+ * for the rest, apply the saved layout and replay each pane's contents. If
+ * s is NULL the section is consumed but nothing created. Returns -1 on a
+ * file or spawn error, 0 otherwise.
+ */
+static int
+snapshot_restore_window(struct cmdq_item *item, FILE *f, struct session *s,
+    int idx, u_int wid, char **cause)
+{
+	struct winlink		*wl = NULL;
+	struct window		*w = NULL;
+	struct window_pane	*wp, *active = NULL;
+	struct spawn_context	 sc;
+	struct layout_cell	*lc;
+	enum layout_type	 type;
+	char			*line = NULL, *wname = NULL, *layout = NULL;
+	char			*content;
+	size_t			 linesize = 0, len;
+	ssize_t			 linelen;
+	int			 active_flag, retval = -1;
+
+	if ((linelen = getline(&line, &linesize, f)) <= 0 ||
+	    strncmp(line, "name ", 5) != 0)
+		goto invalid;
+	line[strcspn(line, "\n")] = '\0';
+	wname = xstrdup(line + 5);
+
+	if ((linelen = getline(&line, &linesize, f)) <= 0 ||
+	    strncmp(line, "layout ", 7) != 0)
+		goto invalid;
+	line[strcspn(line, "\n")] = '\0';
+	layout = xstrdup(line + 7);
+
+	for (;;) {
+		if ((linelen = getline(&line, &linesize, f)) <= 0)
+			break;
+		if (sscanf(line, "pane %zu %d", &len, &active_flag) != 2) {
+			/* Not a pane: the next header, put it back. */
+			if (fseek(f, -linelen, SEEK_CUR) != 0)
+				goto invalid;
+			break;
+		}
+		if ((linelen = getline(&line, &linesize, f)) <= 0 ||
+		    strncmp(line, "cwd ", 4) != 0)
+			goto invalid;
+		line[strcspn(line, "\n")] = '\0';
+
+		content = xmalloc(len + 1);
+		if (fread(content, 1, len, f) != len || fgetc(f) != '\n') {
+			free(content);
+			goto invalid;
+		}
+
+		if (s == NULL) {
+			free(content);
+			continue;
+		}
+
+		if (wl == NULL) {
+			memset(&sc, 0, sizeof sc);
+			sc.item = item;
+			sc.s = s;
+			sc.name = wname;
+			sc.idx = idx;
+			sc.cwd = line + 4;
+			if ((wl = spawn_window(&sc, cause)) == NULL) {
+				free(content);
+				goto fail;
+			}
+			w = wl->window;
+			wp = TAILQ_FIRST(&w->panes);
+		} else {
+			wp = snapshot_biggest_pane(w);
+			if (wp->sy >= wp->sx)
+				type = LAYOUT_TOPBOTTOM;
+			else
+				type = LAYOUT_LEFTRIGHT;
+			if ((lc = layout_split_pane(wp, type, -1, 0)) ==
+			    NULL) {
+				/* No space; drop this pane's contents. */
+				free(content);
+				continue;
+			}
+			memset(&sc, 0, sizeof sc);
+			sc.item = item;
+			sc.s = s;
+			sc.wl = wl;
+			sc.wp0 = wp;
+			sc.lc = lc;
+			sc.idx = -1;
+			sc.cwd = line + 4;
+			if ((wp = spawn_pane(&sc, cause)) == NULL) {
+				free(content);
+				goto fail;
+			}
+		}
+
+		input_parse_buffer(wp, content, len);
+		free(content);
+		if (active_flag)
+			active = wp;
+	}
+
+	if (w != NULL) {
+		layout_parse(w, layout);
+		if (active != NULL)
+			window_set_active_pane(w, active, 0);
+		snapshot_map_add(&snapshot_window_map, wid, w->id);
+		log_debug("%s: restored window %s at %d", __func__, w->name,
+		    idx);
+	}
+	retval = 0;
+	goto out;
+
+invalid:
+	xasprintf(cause, "invalid snapshot file");
+
+fail:
+out:
+	free(wname);
+	free(layout);
+	free(line);
+	return (retval);
+}
+
+/* Restore sessions from a snapshot file. */
+int
+snapshot_restore(struct cmdq_item *item, const char *path, char **cause)
+{
+	struct session	*s = NULL, *existing;
+	struct options	*oo;
+	struct environ	*env;
+	FILE		*f;
+	char		*line = NULL, *used = NULL, *name;
+	char		*sname = NULL;
+	size_t		 linesize = 0;
+	ssize_t		 linelen;
+	u_int		 sid = 0, wid;
+	int		 version, idx, curw = 0, retval = -1;
+
+	if (path == NULL)
+		path = used = snapshot_default_path();
+
+	if ((f = fopen(path, "r")) == NULL) {
+		xasprintf(cause, "%s: %s", path, strerror(errno));
+		free(used);
+		return (-1);
+	}
+	if ((linelen = getline(&line, &linesize, f)) <= 0 ||
+	    sscanf(line, "tmux-snapshot %d", &version) != 1 ||
+	    version < 1 || version > SNAPSHOT_VERSION) {
+		xasprintf(cause, "%s: not a snapshot file", path);
+		goto out;
+	}
+
+	while ((linelen = getline(&line, &linesize, f)) > 0) {
+		line[strcspn(line, "\n")] = '\0';
+
+		if (sscanf(line, "session %d ", &idx) == 1 &&
+		    (name = strchr(line + 8, ' ')) != NULL) {
+			/* Finish off the previous session. */
+			if (s != NULL) {
+				session_select(s, curw);
+				notify_session("session-created", s);
+			}
+			s = NULL;
+			curw = idx;
+
+			/* Version 2 has the old session id before the name. */
+			sid = 0;
+			if (version >= 2) {
+				if (sscanf(line, "session %d %u ", &idx,
+				    &sid) != 2 ||
+				    (name = strchr(name + 1, ' ')) == NULL) {
+					xasprintf(cause,
+					    "invalid snapshot file");
+					goto out;
+				}
+			}
+
+			free(sname);
+			sname = xstrdup(name + 1);
+			if ((existing = session_find(sname)) != NULL) {
+				if (version >= 2) {
+					snapshot_map_add(&snapshot_session_map,
+					    sid, existing->id);
+				}
+				log_debug("%s: session %s exists, skipped",
+				    __func__, sname);
+				continue;
+			}
+
+			if ((linelen = getline(&line, &linesize, f)) <= 0 ||
+			    strncmp(line, "cwd ", 4) != 0) {
+				xasprintf(cause, "invalid snapshot file");
+				goto out;
+			}
+			line[strcspn(line, "\n")] = '\0';
+
+			oo = options_create(global_s_options);
+			env = environ_create();
+			environ_copy(global_environ, env);
+			s = session_create(NULL, sname, line + 4, env, oo,
+			    NULL);
+			if (version >= 2)
+				snapshot_map_add(&snapshot_session_map, sid,
+				    s->id);
+			continue;
+		}
+		if (sscanf(line, "window %d", &idx) == 1) {
+			wid = 0;
+			if (version >= 2 &&
+			    sscanf(line, "window %d %u", &idx, &wid) != 2) {
+				xasprintf(cause, "invalid snapshot file");
+				goto out;
+			}
+			if (snapshot_restore_window(item, f, s, idx, wid,
+			    cause) != 0)
+				goto out;
+			continue;
+		}
+	}
+	if (s != NULL) {
+		session_select(s, curw);
+		notify_session("session-created", s);
+	}
+
+	recalculate_sizes();
+	retval = 0;
+	log_debug("%s: restored %s", __func__, path);
+
+out:
+	free(sname);
+	free(line);
+	free(used);
+	fclose(f);
+	return (retval);
+}
+
+/* Callback to restore a snapshot and replay the journal at server start. */
+static enum cmd_retval
+snapshot_restore_cb(struct cmdq_item *item, __unused void *data)
+{
+	char	*cause;
+
+	if (snapshot_restore(item, NULL, &cause) != 0) {
+		log_debug("%s: %s", __func__, cause);
+		free(cause);
+	}
+	if (journal_replay(item, NULL, &cause) != 0) {
+		log_debug("%s: %s", __func__, cause);
+		free(cause);
+	}
+
+	/*
+	 * Snapshot what recovery produced: the journal is truncated now, so
+	 * without this a second crash would fall back to the stale snapshot.
+	 */
+	if (!RB_EMPTY(&sessions) && snapshot_write(NULL, &cause) != 0) {
+		log_debug("%s: %s", __func__, cause);
+		free(cause);
+	}
+	return (CMD_RETURN_NORMAL);
+}
+
+/* Queue a restore at server start if a snapshot or journal exists. */
+void
+snapshot_check_restore(void)
+{
+	char	*path = snapshot_default_path(), *jpath = journal_default_path();
+
+	if (access(path, R_OK) == 0 || access(jpath, R_OK) == 0)
+		cmdq_append(NULL, cmdq_get_callback(snapshot_restore_cb,
+		    NULL));
+	free(path);
+	free(jpath);
+}
+
+/* Default journal path, next to the server socket. */
+static char *
+journal_default_path(void)
+{
+	char	*path;
+
+	xasprintf(&path, "%s.journal", socket_path);
+	return (path);
+}
+
+/* Write out and sync everything journalled so far. */
+static void
+journal_flush(void)
+{
+	ssize_t	n;
+
+	if (journal_fd == -1 || journal_buffer == NULL)
+		return;
+	while (EVBUFFER_LENGTH(journal_buffer) > 0) {
+		n = evbuffer_write(journal_buffer, journal_fd);
+		if (n <= 0)
+			break;
+	}
+	fdatasync(journal_fd);
+}
+
+static void
+journal_flush_timer(__unused int fd, __unused short events,
+    __unused void *arg)
+{
+	journal_flush();
+}
+
+/* Flush and close the journal. */
+static void
+journal_close(void)
+{
+	if (journal_fd == -1)
+		return;
+	journal_flush();
+	if (event_initialized(&journal_flush_event))
+		evtimer_del(&journal_flush_event);
+	close(journal_fd);
+	journal_fd = -1;
+	free(journal_path);
+	journal_path = NULL;
+}
+
+/* Open or close the journal to follow the journal-file option. */
+void
+journal_update(void)
+{
+	const char	*path;
+
+	path = options_get_string(global_options, "journal-file");
+	if (!event_initialized(&journal_flush_event))
+		evtimer_set(&journal_flush_event, journal_flush_timer, NULL);
+	if (*path == '\0') {
+		journal_close();
+		return;
+	}
+	if (journal_fd != -1 && journal_path != NULL &&
+	    strcmp(path, journal_path) == 0)
+		return;
+	journal_close();
+	journal_fd = open(path, O_WRONLY|O_APPEND|O_CREAT, 0600);
+	if (journal_fd == -1) {
+		log_debug("%s: %s: %s", __func__, path, strerror(errno));
+		return;
+	}
+	journal_path = xstrdup(path);
+}
+
+/*
+ * Append one record. Records are batched and synced together after
+ * journal-interval seconds, bounding both the sync rate and how much a
+ * crash can lose.
+ */
+static void
+journal_record(const char *fmt, ...)
+{
+	struct timeval	 tv = { .tv_sec = 0 };
+	va_list		 ap;
+	char		*line;
+	int		 interval;
+
+	if (journal_fd == -1 || journal_replaying)
+		return;
+
+	va_start(ap, fmt);
+	xvasprintf(&line, fmt, ap);
+	va_end(ap);
+
+	if (journal_buffer == NULL)
+		journal_buffer = evbuffer_new();
+	evbuffer_add_printf(journal_buffer, "%lld %s\n",
+	    (long long)time(NULL), line);
+	free(line);
+
+	interval = options_get_number(global_options, "journal-interval");
+	if (interval == 0 || EVBUFFER_LENGTH(journal_buffer) >= 8192)
+		journal_flush();
+	else if (!evtimer_pending(&journal_flush_event, NULL)) {
+		tv.tv_sec = interval;
+		evtimer_add(&journal_flush_event, &tv);
+	}
+}
+
+/* Journal a structural change reported through notify. */
+void
+journal_event(const char *name, struct session *s, struct window *w)
+{
+	struct winlink	*wl;
+	char		*layout;
+
+	if (journal_fd == -1 || journal_replaying)
+		return;
+
+	if (strcmp(name, "session-created") == 0 && s != NULL) {
+		journal_record("session-created $%u\t%s\t%s", s->id, s->cwd,
+		    s->name);
+	} else if (strcmp(name, "session-closed") == 0 && s != NULL)
+		journal_record("session-closed $%u", s->id);
+	else if (strcmp(name, "session-renamed") == 0 && s != NULL)
+		journal_record("session-renamed $%u\t%s", s->id, s->name);
+	else if (strcmp(name, "window-linked") == 0 && s != NULL &&
+	    w != NULL) {
+		wl = winlink_find_by_window(&s->windows, w);
+		if (wl != NULL) {
+			journal_record("window-linked $%u @%u %d\t%s", s->id,
+			    w->id, wl->idx, w->name);
+		}
+	} else if (strcmp(name, "window-unlinked") == 0 && s != NULL &&
+	    w != NULL)
+		journal_record("window-unlinked $%u @%u", s->id, w->id);
+	else if (strcmp(name, "window-renamed") == 0 && w != NULL)
+		journal_record("window-renamed @%u\t%s", w->id, w->name);
+	else if (strcmp(name, "window-layout-changed") == 0 && w != NULL) {
+		layout = layout_dump(w->layout_root);
+		if (layout != NULL) {
+			journal_record("layout @%u %u\t%s", w->id,
+			    window_count_panes(w), layout);
+			free(layout);
+		}
+	}
+}
+
+/* Apply one journal record, best effort: unresolvable targets are skipped. */
+static void
+journal_apply(struct cmdq_item *item, char *line)
+{
+	struct session		*s;
+	struct window		*w;
+	struct winlink		*wl;
+	struct window_pane	*wp;
+	struct spawn_context	 sc;
+	struct options		*oo;
+	struct environ		*env;
+	struct layout_cell	*lc;
+	struct journal_pending	*jp, *jp1;
+	enum layout_type	 type;
+	char			*tail, *name, *cause = NULL;
+	u_int			 sid, wid, count;
+	int			 idx;
+
+	if ((tail = strchr(line, '\t')) != NULL)
+		*tail++ = '\0';
+
+	if (sscanf(line, "session-created $%u", &sid) == 1 && tail != NULL) {
+		if ((name = strchr(tail, '\t')) == NULL)
+			return;
+		*name++ = '\0';
+		if ((s = session_find(name)) == NULL) {
+			oo = options_create(global_s_options);
+			env = environ_create();
+			environ_copy(global_environ, env);
+			s = session_create(NULL, name, tail, env, oo, NULL);
+		}
+		snapshot_map_add(&snapshot_session_map, sid, s->id);
+
+		/* Apply any records that were waiting for this session. */
+		TAILQ_FOREACH_SAFE(jp, &journal_pending_list, entry, jp1) {
+			if (jp->sid != sid)
+				continue;
+			TAILQ_REMOVE(&journal_pending_list, jp, entry);
+			journal_apply(item, jp->line);
+			free(jp->line);
+			free(jp);
+		}
+		return;
+	}
+	if (sscanf(line, "session-closed $%u", &sid) == 1) {
+		if ((s = snapshot_map_session(sid)) != NULL)
+			session_destroy(s, 1, __func__);
+		return;
+	}
+	if (sscanf(line, "session-renamed $%u", &sid) == 1 && tail != NULL) {
+		if ((s = snapshot_map_session(sid)) == NULL ||
+		    session_find(tail) != NULL)
+			return;
+		RB_REMOVE(sessions, &sessions, s);
+		free(s->name);
+		s->name = xstrdup(tail);
+		RB_INSERT(sessions, &sessions, s);
+		return;
+	}
+	if (sscanf(line, "window-linked $%u @%u %d", &sid, &wid, &idx) == 3 &&
+	    tail != NULL) {
+		if ((s = snapshot_map_session(sid)) == NULL) {
+			jp = xmalloc(sizeof *jp);
+			jp->sid = sid;
+			xasprintf(&jp->line, "%s\t%s", line, tail);
+			TAILQ_INSERT_TAIL(&journal_pending_list, jp, entry);
+			return;
+		}
+		if ((w = snapshot_map_window(wid)) != NULL) {
+			if (!session_has(s, w))
+				session_attach(s, w, idx, &cause);
+			free(cause);
+			return;
+		}
+		memset(&sc, 0, sizeof sc);
+		sc.item = item;
+		sc.s = s;
+		sc.name = tail;
+		sc.idx = idx;
+		if ((wl = spawn_window(&sc, &cause)) == NULL) {
+			free(cause);
+			return;
+		}
+		snapshot_map_add(&snapshot_window_map, wid, wl->window->id);
+		return;
+	}
+	if (sscanf(line, "window-unlinked $%u @%u", &sid, &wid) == 2) {
+		if ((s = snapshot_map_session(sid)) == NULL ||
+		    (w = snapshot_map_window(wid)) == NULL)
+			return;
+		wl = winlink_find_by_window(&s->windows, w);
+		if (wl != NULL)
+			session_detach(s, wl);
+		return;
+	}
+	if (sscanf(line, "window-renamed @%u", &wid) == 1 && tail != NULL) {
+		if ((w = snapshot_map_window(wid)) != NULL)
+			window_set_name(w, tail);
+		return;
+	}
+	if (sscanf(line, "layout @%u %u", &wid, &count) == 2 &&
+	    tail != NULL) {
+		if ((w = snapshot_map_window(wid)) == NULL)
+			return;
+		wl = NULL;
+		RB_FOREACH(s, sessions, &sessions) {
+			wl = winlink_find_by_window(&s->windows, w);
+			if (wl != NULL)
+				break;
+		}
+		if (wl == NULL)
+			return;
+		while (window_count_panes(w) < count) {
+			wp = snapshot_biggest_pane(w);
+			if (wp->sy >= wp->sx)
+				type = LAYOUT_TOPBOTTOM;
+			else
+				type = LAYOUT_LEFTRIGHT;
+			if ((lc = layout_split_pane(wp, type, -1, 0)) == NULL)
+				break;
+			memset(&sc, 0, sizeof sc);
+			sc.item = item;
+			sc.s = s;
+			sc.wl = wl;
+			sc.wp0 = wp;
+			sc.lc = lc;
+			sc.idx = -1;
+			if (spawn_pane(&sc, &cause) == NULL) {
+				free(cause);
+				return;
+			}
+		}
+		layout_parse(w, tail);
+		return;
+	}
+}
+
+/*
+ * Replay a journal over whatever the last snapshot restored, then truncate
+ * it so the same records cannot be replayed twice. A missing journal is not
+ * an error: there is just nothing to replay.
+ */
+int
+journal_replay(struct cmdq_item *item, const char *path, char **cause)
+{
+	struct session		*s, *s1;
+	struct journal_pending	*jp;
+	FILE			*f;
+	char			*line = NULL, *used = NULL, *p;
+	const char		*opt;
+	size_t			 linesize = 0;
+
+	if (path == NULL) {
+		opt = options_get_string(global_options, "journal-file");
+		if (*opt != '\0')
+			path = opt;
+		else
+			path = used = journal_default_path();
+	}
+	if ((f = fopen(path, "r")) == NULL) {
+		if (errno == ENOENT) {
+			free(used);
+			return (0);
+		}
+		xasprintf(cause, "%s: %s", path, strerror(errno));
+		free(used);
+		return (-1);
+	}
+
+	journal_replaying = 1;
+	while (getline(&line, &linesize, f) > 0) {
+		line[strcspn(line, "\n")] = '\0';
+		if ((p = strchr(line, ' ')) == NULL)
+			continue;
+		journal_apply(item, p + 1);
+	}
+	journal_replaying = 0;
+	fclose(f);
+
+	/* Drop records whose session never arrived. */
+	while ((jp = TAILQ_FIRST(&journal_pending_list)) != NULL) {
+		TAILQ_REMOVE(&journal_pending_list, jp, entry);
+		free(jp->line);
+		free(jp);
+	}
+
+	/*
+	 * A session whose window records were lost would be windowless and
+	 * nothing can select into it; drop it rather than leave it to trip
+	 * over a NULL current window.
+	 */
+	RB_FOREACH_SAFE(s, sessions, &sessions, s1) {
+		if (s->curw == NULL)
+			session_destroy(s, 1, __func__);
+	}
+
+	if (truncate(path, 0) != 0)
+		log_debug("%s: %s: %s", __func__, path, strerror(errno));
+
+	recalculate_sizes();
+	log_debug("%s: replayed %s", __func__, path);
+	free(line);
+	free(used);
+	return (0);
+}
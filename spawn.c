@@ -19,13 +19,293 @@
 #include <sys/types.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+#include <spawn.h>
+#endif
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "tmux.h"
 
+/*
+ * posix_spawn avoids duplicating the server address space, which makes pane
+ * creation cost independent of how much scrollback the server holds, but it
+ * is only usable here with the extensions for changing directory, closing
+ * high file descriptors and starting a new session (where opening the pty
+ * makes it the controlling terminal).
+ */
+#if defined(HAVE_OPENPTY) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP) && \
+    defined(HAVE_DECL_POSIX_SPAWN_SETSID) && HAVE_DECL_POSIX_SPAWN_SETSID
+#define SPAWN_POSIX_SPAWN 1
+#endif
+
+/*
+ * Pool of shells spawned in advance, controlled by the pane-pool-size
+ * option. An entry is only adopted by a new pane if the session, working
+ * directory, shell and environment it was spawned with all still match, so
+ * the result is indistinguishable from spawning at split time; anything
+ * else falls through to a normal spawn. Each entry reserves its pane id up
+ * front so TMUX_PANE in the pre-spawned shell is correct.
+ */
+struct spawn_pool_entry {
+	u_int				 id;
+	pid_t				 pid;
+	int				 fd;
+	char				 tty[TTY_NAME_MAX];
+
+	u_int				 session_id;
+	char				*cwd;
+	char				*shell;
+	uint64_t			 sig;
+
+	TAILQ_ENTRY(spawn_pool_entry)	 entry;
+};
+TAILQ_HEAD(spawn_pool_entries, spawn_pool_entry);
+static struct spawn_pool_entries spawn_pool =
+    TAILQ_HEAD_INITIALIZER(spawn_pool);
+
+struct spawn_pool_req {
+	u_int	 session_id;
+	char	*cwd;
+};
+
+static void	spawn_pool_fill_cb(int, short, void *);
+
+/*
+ * Signature of a pane environment, used to check a pooled shell was spawned
+ * with the same variables a fresh spawn would use now. TMUX_PANE is skipped
+ * because it is different for every pane by design.
+ */
+static uint64_t
+spawn_pool_environ_sig(struct environ *env)
+{
+	struct environ_entry	*envent;
+	uint64_t		 h = 14695981039346656037ULL;
+	const char		*cp;
+
+	for (envent = environ_first(env); envent != NULL;
+	    envent = environ_next(envent)) {
+		if (envent->value == NULL ||
+		    strcmp(envent->name, "TMUX_PANE") == 0)
+			continue;
+		for (cp = envent->name; *cp != '\0'; cp++)
+			h = (h ^ (u_char)*cp) * 1099511628211ULL;
+		h = (h ^ '=') * 1099511628211ULL;
+		for (cp = envent->value; *cp != '\0'; cp++)
+			h = (h ^ (u_char)*cp) * 1099511628211ULL;
+		h = (h ^ '\0') * 1099511628211ULL;
+	}
+	return (h);
+}
+
+/* Discard a pool entry. Closing the pty hangs the shell up. */
+static void
+spawn_pool_free(struct spawn_pool_entry *e)
+{
+	log_debug("%s: discarding pooled pid %ld (%%%u)", __func__,
+	    (long)e->pid, e->id);
+
+	TAILQ_REMOVE(&spawn_pool, e, entry);
+	close(e->fd);
+	free(e->cwd);
+	free(e->shell);
+	free(e);
+}
+
+/* Discard pooled shells belonging to a session being destroyed. */
+void
+spawn_pool_discard(struct session *s)
+{
+	struct spawn_pool_entry	*e, *e1;
+
+	TAILQ_FOREACH_SAFE(e, &spawn_pool, entry, e1) {
+		if (e->session_id == s->id)
+			spawn_pool_free(e);
+	}
+}
+
+/* Spawn one pooled shell for a session and working directory. */
+static void
+spawn_pool_spawn_one(struct session *s, const char *cwd)
+{
+	struct spawn_pool_entry	*e;
+	struct environ		*child;
+	struct winsize		 ws;
+	struct termios		 now;
+	sigset_t		 set, oldset;
+	const char		*shell, *tmp;
+	char			*argv0, *cp;
+	key_code		 key;
+
+	shell = options_get_string(s->options, "default-shell");
+	if (!checkshell(shell))
+		shell = _PATH_BSHELL;
+
+	e = xcalloc(1, sizeof *e);
+	e->id = window_pane_reserve_id();
+	e->session_id = s->id;
+	e->cwd = xstrdup(cwd);
+	e->shell = xstrdup(shell);
+
+	child = environ_for_session(s, 0);
+	if (environ_find(child, "PATH") == NULL)
+		environ_set(child, "PATH", 0, "%s", _PATH_DEFPATH);
+	environ_set(child, "SHELL", 0, "%s", shell);
+	e->sig = spawn_pool_environ_sig(child);
+	environ_set(child, "TMUX_PANE", 0, "%%%u", e->id);
+
+	/*
+	 * The size is a placeholder: adoption sets the real size before the
+	 * pane is drawn and the shell sees SIGWINCH.
+	 */
+	memset(&ws, 0, sizeof ws);
+	ws.ws_col = 80;
+	ws.ws_row = 24;
+
+	sigfillset(&set);
+	sigprocmask(SIG_BLOCK, &set, &oldset);
+
+	switch (e->pid = forkpty(&e->fd, e->tty, NULL, &ws)) {
+	case -1:
+		sigprocmask(SIG_SETMASK, &oldset, NULL);
+		environ_free(child);
+		free(e->cwd);
+		free(e->shell);
+		free(e);
+		return;
+	case 0:
+		if (chdir(e->cwd) != 0) {
+			if ((tmp = find_home()) == NULL || chdir(tmp) != 0)
+				chdir("/");
+		}
+
+		if (tcgetattr(STDIN_FILENO, &now) != 0)
+			_exit(1);
+		if (s->tio != NULL)
+			memcpy(now.c_cc, s->tio->c_cc, sizeof now.c_cc);
+		key = options_get_number(global_options, "backspace");
+		if (key >= 0x7f)
+			now.c_cc[VERASE] = '\177';
+		else
+			now.c_cc[VERASE] = key;
+		if (tcsetattr(STDIN_FILENO, TCSANOW, &now) != 0)
+			_exit(1);
+
+		closefrom(STDERR_FILENO + 1);
+		proc_clear_signals(server_proc, 1);
+		sigprocmask(SIG_SETMASK, &oldset, NULL);
+		log_close();
+		environ_push(child);
+
+		cp = strrchr(e->shell, '/');
+		if (cp != NULL && cp[1] != '\0')
+			xasprintf(&argv0, "-%s", cp + 1);
+		else
+			xasprintf(&argv0, "-%s", e->shell);
+		execl(e->shell, argv0, (char *)NULL);
+		_exit(1);
+	}
+	sigprocmask(SIG_SETMASK, &oldset, NULL);
+	environ_free(child);
+
+	log_debug("%s: pooled pid %ld (%%%u) for session $%u cwd %s", __func__,
+	    (long)e->pid, e->id, e->session_id, e->cwd);
+	TAILQ_INSERT_TAIL(&spawn_pool, e, entry);
+}
+
+/* Top up the pool for a session outside the current command. */
+static void
+spawn_pool_fill(struct session *s, const char *cwd)
+{
+	struct spawn_pool_req	*req;
+
+	if (cwd == NULL ||
+	    options_get_number(s->options, "pane-pool-size") == 0)
+		return;
+
+	req = xmalloc(sizeof *req);
+	req->session_id = s->id;
+	req->cwd = xstrdup(cwd);
+	event_once(-1, EV_TIMEOUT, spawn_pool_fill_cb, req, NULL);
+}
+
+static void
+spawn_pool_fill_cb(__unused int fd, __unused short events, void *data)
+{
+	struct spawn_pool_req	*req = data;
+	struct spawn_pool_entry	*e, *e1;
+	struct session		*s;
+	u_int			 count = 0, limit;
+
+	s = session_find_by_id(req->session_id);
+	if (s != NULL) {
+		limit = options_get_number(s->options, "pane-pool-size");
+		TAILQ_FOREACH_SAFE(e, &spawn_pool, entry, e1) {
+			if (e->session_id != s->id)
+				continue;
+			if (kill(e->pid, 0) != 0)
+				spawn_pool_free(e);
+			else
+				count++;
+		}
+		while (count < limit) {
+			spawn_pool_spawn_one(s, req->cwd);
+			count++;
+		}
+	}
+	free(req->cwd);
+	free(req);
+}
+
+/*
+ * Adopt a pooled shell into a new pane if one matches what spawning now
+ * would produce. The pane swaps to the id reserved when the shell was
+ * spawned so TMUX_PANE matches.
+ */
+static int
+spawn_pool_adopt(struct window_pane *wp, struct session *s,
+    struct environ *child, struct winsize *ws)
+{
+	struct spawn_pool_entry	*e, *e1;
+	uint64_t		 sig = spawn_pool_environ_sig(child);
+
+	TAILQ_FOREACH_SAFE(e, &spawn_pool, entry, e1) {
+		if (e->session_id != s->id ||
+		    strcmp(e->cwd, wp->cwd) != 0 ||
+		    strcmp(e->shell, wp->shell) != 0 ||
+		    e->sig != sig)
+			continue;
+		if (kill(e->pid, 0) != 0) {
+			spawn_pool_free(e);
+			continue;
+		}
+
+		log_debug("%s: %%%u adopts pooled pid %ld (%%%u)", __func__,
+		    wp->id, (long)e->pid, e->id);
+
+		RB_REMOVE(window_pane_tree, &all_window_panes, wp);
+		wp->id = e->id;
+		RB_INSERT(window_pane_tree, &all_window_panes, wp);
+
+		wp->pid = e->pid;
+		wp->fd = e->fd;
+		memcpy(wp->tty, e->tty, sizeof wp->tty);
+		ioctl(wp->fd, TIOCSWINSZ, ws);
+
+		TAILQ_REMOVE(&spawn_pool, e, entry);
+		free(e->cwd);
+		free(e->shell);
+		free(e);
+		return (1);
+	}
+	return (0);
+}
+
 /*
  * Set up the environment and create a new window and pane or a new pane.
  *
@@ -197,6 +477,166 @@ spawn_window(struct spawn_context *sc, char **cause)
 	return (sc->wl);
 }
 
+#ifdef SPAWN_POSIX_SPAWN
+/*
+ * Start the pane process with posix_spawn. The child setup done between
+ * fork and exec in the fork path happens here instead: the termios changes
+ * are made on the slave side of the pty from the parent, the working
+ * directory fallbacks are resolved before spawning and everything else maps
+ * onto spawn attributes and file actions. An exec failure still creates the
+ * pane with an immediately-dead process, as it would with fork. Returns the
+ * pid with the master fd in new_wp->fd, or -1 with errno set.
+ */
+static pid_t
+spawn_pane_spawn(struct window_pane *new_wp, struct session *s,
+    struct environ *child, struct winsize *ws, sigset_t *oldset)
+{
+	posix_spawn_file_actions_t	 fa;
+	posix_spawnattr_t		 attr;
+	struct termios			 now;
+	struct environ_entry		*ee;
+	sigset_t			 defset;
+	char				**argvp = NULL, **envp, *argv0;
+	char				*shellargv[4];
+	const char			*cwd, *cp;
+	u_int				 n;
+	int				 master, slave, r, saved;
+	key_code			 key;
+	pid_t				 pid;
+
+	if (openpty(&master, &slave, new_wp->tty, NULL, ws) != 0)
+		return (-1);
+
+	/*
+	 * Update terminal escape characters from the session if available and
+	 * force VERASE to tmux's backspace.
+	 */
+	if (tcgetattr(slave, &now) != 0)
+		goto fail;
+	if (s->tio != NULL)
+		memcpy(now.c_cc, s->tio->c_cc, sizeof now.c_cc);
+	key = options_get_number(global_options, "backspace");
+	if (key >= 0x7f)
+		now.c_cc[VERASE] = '\177';
+	else
+		now.c_cc[VERASE] = key;
+	if (tcsetattr(slave, TCSANOW, &now) != 0)
+		goto fail;
+
+	/* Work out the working directory with the usual fallbacks. */
+	cwd = new_wp->cwd;
+	if (access(cwd, X_OK) != 0) {
+		if ((cp = find_home()) == NULL || access(cp, X_OK) != 0)
+			cwd = "/";
+		else
+			cwd = cp;
+	}
+
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID|
+	    POSIX_SPAWN_SETSIGDEF|POSIX_SPAWN_SETSIGMASK);
+	sigfillset(&defset);
+	posix_spawnattr_setsigdefault(&attr, &defset);
+	posix_spawnattr_setsigmask(&attr, oldset);
+
+	/*
+	 * Opening the pty by name after the new session is created makes it
+	 * the controlling terminal.
+	 */
+	posix_spawn_file_actions_init(&fa);
+	posix_spawn_file_actions_addchdir_np(&fa, cwd);
+	posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, new_wp->tty,
+	    O_RDWR, 0);
+	posix_spawn_file_actions_adddup2(&fa, STDIN_FILENO, STDOUT_FILENO);
+	posix_spawn_file_actions_adddup2(&fa, STDIN_FILENO, STDERR_FILENO);
+	posix_spawn_file_actions_addclosefrom_np(&fa, STDERR_FILENO + 1);
+
+	/* Build the environment, with the same filter as environ_push. */
+	n = 0;
+	for (ee = environ_first(child); ee != NULL; ee = environ_next(ee)) {
+		if (ee->value != NULL &&
+		    *ee->name != '\0' &&
+		    (~ee->flags & ENVIRON_HIDDEN))
+			n++;
+	}
+	envp = xcalloc(n + 1, sizeof *envp);
+	n = 0;
+	for (ee = environ_first(child); ee != NULL; ee = environ_next(ee)) {
+		if (ee->value != NULL &&
+		    *ee->name != '\0' &&
+		    (~ee->flags & ENVIRON_HIDDEN))
+			xasprintf(&envp[n++], "%s=%s", ee->name, ee->value);
+	}
+
+	/* The same three exec cases as the fork path. */
+	cp = strrchr(new_wp->shell, '/');
+	if (new_wp->argc != 0 && new_wp->argc != 1) {
+		argvp = cmd_copy_argv(new_wp->argc, new_wp->argv);
+		r = posix_spawnp(&pid, argvp[0], &fa, &attr, argvp, envp);
+	} else if (new_wp->argc == 1) {
+		if (cp != NULL && cp[1] != '\0')
+			xasprintf(&argv0, "%s", cp + 1);
+		else
+			xasprintf(&argv0, "%s", new_wp->shell);
+		shellargv[0] = argv0;
+		shellargv[1] = (char *)"-c";
+		shellargv[2] = new_wp->argv[0];
+		shellargv[3] = NULL;
+		r = posix_spawn(&pid, new_wp->shell, &fa, &attr, shellargv,
+		    envp);
+		free(argv0);
+	} else {
+		if (cp != NULL && cp[1] != '\0')
+			xasprintf(&argv0, "-%s", cp + 1);
+		else
+			xasprintf(&argv0, "-%s", new_wp->shell);
+		shellargv[0] = argv0;
+		shellargv[1] = NULL;
+		r = posix_spawn(&pid, new_wp->shell, &fa, &attr, shellargv,
+		    envp);
+		free(argv0);
+	}
+
+	/*
+	 * If the exec failed rather than the spawn itself, the fork path
+	 * would still have created the pane and the child would have exited
+	 * with status 1 after execvp failed. Preserve those semantics by
+	 * running a shell that exits immediately instead of failing the
+	 * whole pane.
+	 */
+	if (r != 0 && r != EAGAIN && r != ENOMEM) {
+		shellargv[0] = (char *)"sh";
+		shellargv[1] = (char *)"-c";
+		shellargv[2] = (char *)"exit 1";
+		shellargv[3] = NULL;
+		r = posix_spawn(&pid, _PATH_BSHELL, &fa, &attr, shellargv,
+		    envp);
+	}
+
+	posix_spawn_file_actions_destroy(&fa);
+	posix_spawnattr_destroy(&attr);
+	cmd_free_argv(n, envp);
+	if (argvp != NULL)
+		cmd_free_argv(new_wp->argc, argvp);
+
+	close(slave);
+	if (r != 0) {
+		close(master);
+		errno = r;
+		return (-1);
+	}
+	new_wp->fd = master;
+	return (pid);
+
+fail:
+	saved = errno;
+	close(slave);
+	close(master);
+	errno = saved;
+	return (-1);
+}
+#endif /* SPAWN_POSIX_SPAWN */
+
 struct window_pane *
 spawn_pane(struct spawn_context *sc, char **cause)
 {
@@ -208,15 +648,18 @@ spawn_pane(struct spawn_context *sc, char **cause)
 	struct window_pane	 *new_wp;
 	struct environ		 *child;
 	struct environ_entry	 *ee;
-	char			**argv, *cp, **argvp, *argv0, *cwd;
+	char			**argv, *cp, *cwd;
 	const char		 *cmd, *tmp;
-	int			  argc;
+	int			  argc, pool_ok;
 	u_int			  idx;
-	struct termios		  now;
 	u_int			  hlimit;
 	struct winsize		  ws;
 	sigset_t		  set, oldset;
+#ifndef SPAWN_POSIX_SPAWN
+	char			**argvp, *argv0;
+	struct termios		  now;
 	key_code		  key;
+#endif
 
 	spawn_log(__func__, sc);
 
@@ -283,6 +726,7 @@ spawn_pane(struct spawn_context *sc, char **cause)
 		free(new_wp->cwd);
 		new_wp->cwd = cwd;
 	}
+	pool_ok = ((sc->flags & (SPAWN_RESPAWN|SPAWN_EMPTY)) == 0 && argc == 0);
 
 	/*
 	 * Replace the stored arguments if there are new ones. If not, the
@@ -354,10 +798,22 @@ spawn_pane(struct spawn_context *sc, char **cause)
 		goto complete;
 	}
 
-	/* Fork the new process. */
+	/* A pooled shell spawned with matching settings can be used as-is. */
+	if (pool_ok && spawn_pool_adopt(new_wp, s, child, &ws))
+		goto complete;
+
+	/* Start the new process. */
+#ifdef SPAWN_POSIX_SPAWN
+	new_wp->pid = spawn_pane_spawn(new_wp, s, child, &ws, &oldset);
+#else
 	new_wp->pid = fdforkpty(ptm_fd, &new_wp->fd, new_wp->tty, NULL, &ws);
+#endif
 	if (new_wp->pid == -1) {
+#ifdef SPAWN_POSIX_SPAWN
+		xasprintf(cause, "spawn failed: %s", strerror(errno));
+#else
 		xasprintf(cause, "fork failed: %s", strerror(errno));
+#endif
 		new_wp->fd = -1;
 		if (~sc->flags & SPAWN_RESPAWN) {
 			server_client_remove_pane(new_wp);
@@ -369,6 +825,9 @@ spawn_pane(struct spawn_context *sc, char **cause)
 		return (NULL);
 	}
 
+#ifdef SPAWN_POSIX_SPAWN
+	goto complete;
+#else
 	/* In the parent process, everything is done now. */
 	if (new_wp->pid != 0)
 		goto complete;
@@ -435,6 +894,7 @@ spawn_pane(struct spawn_context *sc, char **cause)
 		xasprintf(&argv0, "-%s", new_wp->shell);
 	execl(new_wp->shell, argv0, (char *)NULL);
 	_exit(1);
+#endif /* SPAWN_POSIX_SPAWN */
 
 complete:
 #ifdef HAVE_UTEMPTER
@@ -451,9 +911,13 @@ complete:
 
 	sigprocmask(SIG_SETMASK, &oldset, NULL);
 	window_pane_set_event(new_wp);
+	window_pane_update_log(new_wp);
 
 	environ_free(child);
 
+	if (pool_ok)
+		spawn_pool_fill(s, new_wp->cwd);
+
 	if (sc->flags & SPAWN_RESPAWN)
 		return (new_wp);
 	if ((~sc->flags & SPAWN_DETACHED) || w->active == NULL) {
@@ -36,6 +36,8 @@ static char	*status_prompt_find_history_file(void);
 static const char *status_prompt_up_history(u_int *);
 static const char *status_prompt_down_history(u_int *);
 static void	 status_prompt_add_history(const char *);
+static void	 status_prompt_mark_row(struct screen *, struct screen *,
+		     u_int);
 
 static char	*status_prompt_complete(struct client *, const char *, u_int);
 static char	*status_prompt_complete_window_menu(struct client *,
@@ -54,6 +56,110 @@ struct status_prompt_menu {
 static char	**status_prompt_hlist;
 static u_int	  status_prompt_hsize;
 
+/* Serial bumped whenever something a status line may show has changed. */
+static u_int	  status_serial = 1;
+
+/* Invalidate cached status line entries for all clients. */
+void
+status_invalidate(void)
+{
+	status_serial++;
+}
+
+/*
+ * Status lines rendered once and shared between clients viewing the same
+ * session at the same size. Only lines which did not read any client-specific
+ * variables are shared.
+ */
+struct status_shared {
+	u_int				 session_id;
+	u_int				 width;
+	u_int				 lines;
+
+	u_int				 serial;
+	time_t				 time;
+
+	struct screen			 screen;
+	char				*expanded[STATUS_LINES_LIMIT];
+	int				 unstable[STATUS_LINES_LIMIT];
+	struct style_ranges		 ranges[STATUS_LINES_LIMIT];
+
+	TAILQ_ENTRY(status_shared)	 entry;
+};
+static TAILQ_HEAD(status_shareds, status_shared) status_shared_list =
+    TAILQ_HEAD_INITIALIZER(status_shared_list);
+static u_int	  status_shared_count;
+#define STATUS_SHARED_LIMIT 16
+
+static void	 status_free_ranges(struct style_ranges *);
+
+/* Replace one list of style ranges with a copy of another. */
+static void
+status_copy_ranges(struct style_ranges *dst, struct style_ranges *src)
+{
+	struct style_range	*sr, *new;
+
+	status_free_ranges(dst);
+	TAILQ_FOREACH(sr, src, entry) {
+		new = xmalloc(sizeof *new);
+		memcpy(new, sr, sizeof *new);
+		TAILQ_INSERT_TAIL(dst, new, entry);
+	}
+}
+
+/* Find the shared status line for a session and size, if any. */
+static struct status_shared *
+status_shared_find(u_int session_id, u_int width, u_int lines)
+{
+	struct status_shared	*sh;
+
+	TAILQ_FOREACH(sh, &status_shared_list, entry) {
+		if (sh->session_id == session_id &&
+		    sh->width == width &&
+		    sh->lines == lines)
+			return (sh);
+	}
+	return (NULL);
+}
+
+/* Find or create the shared status line for a session and size. */
+static struct status_shared *
+status_shared_add(u_int session_id, u_int width, u_int lines)
+{
+	struct status_shared	*sh;
+	u_int			 i;
+
+	sh = status_shared_find(session_id, width, lines);
+	if (sh != NULL) {
+		TAILQ_REMOVE(&status_shared_list, sh, entry);
+		TAILQ_INSERT_HEAD(&status_shared_list, sh, entry);
+		return (sh);
+	}
+
+	if (status_shared_count == STATUS_SHARED_LIMIT) {
+		sh = TAILQ_LAST(&status_shared_list, status_shareds);
+		TAILQ_REMOVE(&status_shared_list, sh, entry);
+		screen_free(&sh->screen);
+		for (i = 0; i < STATUS_LINES_LIMIT; i++) {
+			free(sh->expanded[i]);
+			status_free_ranges(&sh->ranges[i]);
+		}
+		free(sh);
+		status_shared_count--;
+	}
+
+	sh = xcalloc(1, sizeof *sh);
+	sh->session_id = session_id;
+	sh->width = width;
+	sh->lines = lines;
+	screen_init(&sh->screen, width, lines, 0);
+	for (i = 0; i < STATUS_LINES_LIMIT; i++)
+		TAILQ_INIT(&sh->ranges[i]);
+	TAILQ_INSERT_HEAD(&status_shared_list, sh, entry);
+	status_shared_count++;
+	return (sh);
+}
+
 /* Find the history file to load/save from/to. */
 static char *
 status_prompt_find_history_file(void)
@@ -143,28 +249,57 @@ status_prompt_save_history(void)
 
 }
 
-/* Status timer callback. */
+/* The one status timer shared by every client. */
+static struct event status_timer_event;
+
+/*
+ * One tick covers every client: flag the clients whose interval has come
+ * around and schedule the next tick for the earliest deadline. Deadlines
+ * sit on interval boundaries shifted by the server phase, so the redraws
+ * of one server land together and different servers on the same host land
+ * apart instead of all waking on the second.
+ */
 static void
-status_timer_callback(__unused int fd, __unused short events, void *arg)
+status_timer_callback(__unused int fd, __unused short events,
+    __unused void *arg)
 {
-	struct client	*c = arg;
-	struct session	*s = c->session;
-	struct timeval	 tv;
-
-	evtimer_del(&c->status.timer);
-
-	if (s == NULL)
+	struct client	*c;
+	struct session	*s;
+	struct timeval	 now, next, tv;
+	time_t		 interval;
+	uint64_t	 phase = server_tick_phase();
+	int		 any = 0;
+
+	evtimer_del(&status_timer_event);
+	gettimeofday(&now, NULL);
+
+	TAILQ_FOREACH(c, &clients, entry) {
+		s = c->session;
+		if (s == NULL || !options_get_number(s->options, "status"))
+			continue;
+		interval = options_get_number(s->options, "status-interval");
+		if (interval == 0)
+			continue;
+		if (!timerisset(&c->status.next) ||
+		    timercmp(&now, &c->status.next, >=)) {
+			if (c->message_string == NULL &&
+			    c->prompt_string == NULL)
+				c->flags |= CLIENT_REDRAWSTATUS;
+			c->status.next.tv_sec = ((now.tv_sec / interval) + 1) *
+			    interval;
+			c->status.next.tv_usec = phase;
+		}
+		if (!any || timercmp(&c->status.next, &next, <)) {
+			next = c->status.next;
+			any = 1;
+		}
+	}
+	if (!any)
 		return;
-
-	if (c->message_string == NULL && c->prompt_string == NULL)
-		c->flags |= CLIENT_REDRAWSTATUS;
-
-	timerclear(&tv);
-	tv.tv_sec = options_get_number(s->options, "status-interval");
-
-	if (tv.tv_sec != 0)
-		evtimer_add(&c->status.timer, &tv);
-	log_debug("client %p, status interval %d", c, (int)tv.tv_sec);
+	timersub(&next, &now, &tv);
+	evtimer_add(&status_timer_event, &tv);
+	log_debug("%s: next status tick in %lld.%06llds", __func__,
+	    (long long)tv.tv_sec, (long long)tv.tv_usec);
 }
 
 /* Start status timer for client. */
@@ -173,13 +308,12 @@ status_timer_start(struct client *c)
 {
 	struct session	*s = c->session;
 
-	if (event_initialized(&c->status.timer))
-		evtimer_del(&c->status.timer);
-	else
-		evtimer_set(&c->status.timer, status_timer_callback, c);
+	if (!event_initialized(&status_timer_event))
+		evtimer_set(&status_timer_event, status_timer_callback, NULL);
+	timerclear(&c->status.next);
 
 	if (s != NULL && options_get_number(s->options, "status"))
-		status_timer_callback(-1, 0, c);
+		status_timer_callback(-1, 0, NULL);
 }
 
 /* Start status timer for all clients. */
@@ -229,19 +363,75 @@ status_line_size(struct client *c)
 	return (s->statuslines);
 }
 
+/* Compare ranges by start for the sorted index. */
+static int
+status_range_cmp(const void *a0, const void *b0)
+{
+	const struct style_range *const	*a = a0;
+	const struct style_range *const	*b = b0;
+
+	if ((*a)->start < (*b)->start)
+		return (-1);
+	if ((*a)->start > (*b)->start)
+		return (1);
+	return (0);
+}
+
+/*
+ * Rebuild the sorted range index for one status line entry. Mouse events
+ * arrive at motion rate, so lookups binary search this rather than walking
+ * the list.
+ */
+static void
+status_build_range_index(struct status_line_entry *sle)
+{
+	struct style_range	*sr;
+	u_int			 n = 0;
+
+	TAILQ_FOREACH(sr, &sle->ranges, entry)
+		n++;
+	if (n == 0) {
+		free(sle->range_index);
+		sle->range_index = NULL;
+		sle->range_count = 0;
+		return;
+	}
+	sle->range_index = xreallocarray(sle->range_index, n,
+	    sizeof *sle->range_index);
+	sle->range_count = 0;
+	TAILQ_FOREACH(sr, &sle->ranges, entry)
+		sle->range_index[sle->range_count++] = sr;
+	qsort(sle->range_index, n, sizeof *sle->range_index,
+	    status_range_cmp);
+}
+
 /* Get window at window list position. */
 struct style_range *
 status_get_range(struct client *c, u_int x, u_int y)
 {
 	struct status_line	*sl = &c->status;
+	struct status_line_entry *sle;
 	struct style_range	*sr;
+	u_int			 lo, hi, mid;
 
 	if (y >= nitems(sl->entries))
 		return (NULL);
-	TAILQ_FOREACH(sr, &sl->entries[y].ranges, entry) {
-		if (x >= sr->start && x < sr->end)
-			return (sr);
+	sle = &sl->entries[y];
+
+	lo = 0;
+	hi = sle->range_count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (sle->range_index[mid]->start <= x)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	if (lo == 0)
+		return (NULL);
+	sr = sle->range_index[lo - 1];
+	if (x < sr->end)
+		return (sr);
 	return (NULL);
 }
 
@@ -306,12 +496,11 @@ status_free(struct client *c)
 
 	for (i = 0; i < nitems(sl->entries); i++) {
 		status_free_ranges(&sl->entries[i].ranges);
+		free(sl->entries[i].range_index);
 		free((void *)sl->entries[i].expanded);
+		free(sl->entries[i].fmt);
 	}
 
-	if (event_initialized(&sl->timer))
-		evtimer_del(&sl->timer);
-
 	if (sl->active != &sl->screen) {
 		screen_free(sl->active);
 		free(sl->active);
@@ -334,6 +523,9 @@ status_redraw(struct client *c)
 	union options_value		*ov;
 	struct format_tree		*ft;
 	char				*expanded;
+	time_t				 now = time(NULL);
+	struct status_shared		*sh;
+	int				 share;
 
 	log_debug("%s enter", __func__);
 
@@ -372,10 +564,53 @@ status_redraw(struct client *c)
 		screen_resize(&sl->screen, width, lines, 0);
 		changed = force = 1;
 	}
+	/* If another client has already rendered this status line, share it. */
+	o = options_get(s->options, "status-format");
+	sh = status_shared_find(s->id, width, lines);
+	if (o != NULL &&
+	    sh != NULL &&
+	    !force &&
+	    (~flags & FORMAT_FORCE) &&
+	    sh->serial == status_serial &&
+	    sh->time == now) {
+		for (i = 0; i < lines; i++) {
+			sle = &sl->entries[i];
+			if (sh->expanded[i] == NULL)
+				continue;
+			if (sle->expanded == NULL ||
+			    strcmp(sle->expanded, sh->expanded[i]) != 0)
+				changed = 1;
+		}
+		if (changed) {
+			screen_write_start(&ctx, &sl->screen);
+			screen_write_fast_copy(&ctx, &sh->screen, 0, 0, width,
+			    lines);
+			screen_write_stop(&ctx);
+		}
+		for (i = 0; i < lines; i++) {
+			sle = &sl->entries[i];
+			ov = options_array_get(o, i);
+			if (ov == NULL || sh->expanded[i] == NULL)
+				continue;
+			free(sle->expanded);
+			sle->expanded = xstrdup(sh->expanded[i]);
+			free(sle->fmt);
+			sle->fmt = xstrdup(ov->string);
+			sle->time = now;
+			sle->serial = status_serial;
+			sle->unstable = sh->unstable[i];
+			sle->clientdep = 0;
+			status_copy_ranges(&sle->ranges, &sh->ranges[i]);
+			status_build_range_index(sle);
+		}
+		format_free(ft);
+		log_debug("%s exit: shared, changed=%d", __func__, changed);
+		return (changed);
+	}
+
 	screen_write_start(&ctx, &sl->screen);
 
 	/* Write the status lines. */
-	o = options_get(s->options, "status-format");
 	if (o == NULL) {
 		for (n = 0; n < width * lines; n++)
 			screen_write_putc(&ctx, &gc, ' ');
@@ -391,7 +626,31 @@ status_redraw(struct client *c)
 			}
 			sle = &sl->entries[i];
 
+			/*
+			 * If nothing the format could read has changed since
+			 * it was last expanded in this same second, the output
+			 * cannot be different so skip expanding it at all.
+			 */
+			if (!force &&
+			    (~flags & FORMAT_FORCE) &&
+			    sle->fmt != NULL &&
+			    sle->serial == status_serial &&
+			    (!sle->unstable || sle->time == now) &&
+			    strcmp(sle->fmt, ov->string) == 0) {
+				log_debug("%s: line %u not expanded", __func__,
+				    i);
+				continue;
+			}
+
 			expanded = format_expand_time(ft, ov->string);
+
+			free(sle->fmt);
+			sle->fmt = xstrdup(ov->string);
+			sle->time = now;
+			sle->serial = status_serial;
+			sle->unstable = format_unstable(ft);
+			sle->clientdep = format_client_dependent(ft);
+
 			if (!force &&
 			    sle->expanded != NULL &&
 			    strcmp(expanded, sle->expanded) == 0) {
@@ -406,6 +665,7 @@ status_redraw(struct client *c)
 
 			status_free_ranges(&sle->ranges);
 			format_draw(&ctx, &gc, width, expanded, &sle->ranges);
+			status_build_range_index(sle);
 
 			free(sle->expanded);
 			sle->expanded = expanded;
@@ -413,6 +673,37 @@ status_redraw(struct client *c)
 	}
 	screen_write_stop(&ctx);
 
+	/* Save for sharing if no client-specific variables were read. */
+	if (o != NULL) {
+		share = 1;
+		for (i = 0; i < lines; i++) {
+			if (options_array_get(o, i) != NULL &&
+			    sl->entries[i].clientdep)
+				share = 0;
+		}
+		if (share) {
+			sh = status_shared_add(s->id, width, lines);
+			sh->serial = status_serial;
+			sh->time = now;
+			screen_write_start(&ctx, &sh->screen);
+			screen_write_fast_copy(&ctx, &sl->screen, 0, 0, width,
+			    lines);
+			screen_write_stop(&ctx);
+			for (i = 0; i < lines; i++) {
+				sle = &sl->entries[i];
+				free(sh->expanded[i]);
+				if (options_array_get(o, i) != NULL &&
+				    sle->expanded != NULL)
+					sh->expanded[i] = xstrdup(sle->expanded);
+				else
+					sh->expanded[i] = NULL;
+				sh->unstable[i] = sle->unstable;
+				status_copy_ranges(&sh->ranges[i],
+				    &sle->ranges);
+			}
+		}
+	}
+
 	/* Free the format tree. */
 	format_free(ft);
 
@@ -635,6 +926,28 @@ status_prompt_update(struct client *c, const char *msg, const char *input)
 	format_free(ft);
 }
 
+/* Mark the span of a row that differs from what was previously drawn. */
+static void
+status_prompt_mark_row(struct screen *s, struct screen *old, u_int py)
+{
+	struct grid_cell	 gc, old_gc;
+	u_int			 px, lo = 0, hi = 0;
+	int			 changed = 0;
+
+	for (px = 0; px < screen_size_x(s); px++) {
+		grid_get_cell(s->grid, px, py, &gc);
+		grid_get_cell(old->grid, px, py, &old_gc);
+		if (grid_cells_equal(&gc, &old_gc))
+			continue;
+		if (!changed)
+			lo = px;
+		hi = px;
+		changed = 1;
+	}
+	if (changed)
+		screen_dirty_cells(s, lo, py, hi - lo + 1, 1);
+}
+
 /* Draw client prompt on status line of present else on last line. */
 int
 status_prompt_redraw(struct client *c)
@@ -728,6 +1041,20 @@ finished:
 		screen_free(&old_screen);
 		return (0);
 	}
+
+	/*
+	 * Typing in the prompt changes a cell or two around the cursor, so
+	 * mark exactly what differs from the previous contents and the
+	 * redraw will send those cells rather than every status line. A
+	 * size change leaves the whole screen dirty.
+	 */
+	if (old_screen.grid->sx == sl->active->grid->sx &&
+	    old_screen.grid->sy == sl->active->grid->sy) {
+		screen_dirty_clear(sl->active);
+		for (i = 0; i < lines; i++)
+			status_prompt_mark_row(sl->active, &old_screen, i);
+	}
+
 	screen_free(&old_screen);
 	return (1);
 }
@@ -30,7 +30,7 @@
 
 /* Default style. */
 static struct style style_default = {
-	{ { { ' ' }, 0, 1, 1 }, 0, 0, 8, 8, 0  },
+	{ { { ' ' }, 0, 1, 1 }, 0, 0, 8, 8, 0, 0 },
 	0,
 
 	8,
@@ -42,6 +42,31 @@ static struct style style_default = {
 	STYLE_DEFAULT_BASE
 };
 
+/*
+ * Cache of recently parsed styles. Because parsing adds onto the given
+ * style, the result depends on the starting style and base as well as the
+ * string, so all three are part of the key. Status lines parse the same few
+ * styles on every redraw; anything else falls through and parses normally.
+ */
+struct style_cache_entry {
+	int			 set;
+	char			 s[64];
+	struct style		 in;
+	struct grid_cell	 base;
+	struct style		 out;
+};
+static struct style_cache_entry	style_cache[64];
+
+static u_int
+style_cache_hash(const char *s)
+{
+	u_int	h = 5381;
+
+	for (; *s != '\0'; s++)
+		h = (h << 5) + h + (u_char)*s;
+	return (h & ((sizeof style_cache / sizeof style_cache[0]) - 1));
+}
+
 /*
  * Parse an embedded style of the form "fg=colour,bg=colour,bright,...".  Note
  * that this adds onto the given style, so it must have been initialized
@@ -50,8 +75,9 @@ static struct style style_default = {
 int
 style_parse(struct style *sy, const struct grid_cell *base, const char *in)
 {
+	struct style_cache_entry	*sce = NULL;
 	struct style	saved;
-	const char	delimiters[] = " ,", *cp;
+	const char	delimiters[] = " ,", *cp, *start = in;
 	char		tmp[256], *found;
 	int		value;
 	size_t		end;
@@ -60,6 +86,17 @@ style_parse(struct style *sy, const struct grid_cell *base, const char *in)
 		return (0);
 	style_copy(&saved, sy);
 
+	if (strlen(in) < sizeof sce->s) {
+		sce = &style_cache[style_cache_hash(in)];
+		if (sce->set &&
+		    strcmp(sce->s, in) == 0 &&
+		    memcmp(&sce->in, sy, sizeof *sy) == 0 &&
+		    memcmp(&sce->base, base, sizeof *base) == 0) {
+			style_copy(sy, &sce->out);
+			return (0);
+		}
+	}
+
 	log_debug("%s: %s", __func__, in);
 	do {
 		while (*in != '\0' && strchr(delimiters, *in) != NULL)
@@ -175,6 +212,13 @@ style_parse(struct style *sy, const struct grid_cell *base, const char *in)
 		in += end + strspn(in + end, delimiters);
 	} while (*in != '\0');
 
+	if (sce != NULL) {
+		sce->set = 1;
+		strlcpy(sce->s, start, sizeof sce->s);
+		memcpy(&sce->in, &saved, sizeof sce->in);
+		memcpy(&sce->base, base, sizeof sce->base);
+		memcpy(&sce->out, sy, sizeof sce->out);
+	}
 	return (0);
 
 error:
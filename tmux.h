@@ -67,7 +67,7 @@ struct tmuxproc;
 struct winlink;
 
 /* Client-server protocol version. */
-#define PROTOCOL_VERSION 8
+#define PROTOCOL_VERSION 9
 
 /* Default configuration files and socket paths. */
 #ifndef TMUX_CONF
@@ -500,6 +500,7 @@ enum msgtype {
 	MSG_IDENTIFY_CLIENTPID,
 	MSG_IDENTIFY_CWD,
 	MSG_IDENTIFY_FEATURES,
+	MSG_IDENTIFY_ENVIRONBLOCK,
 
 	MSG_COMMAND = 200,
 	MSG_DETACH,
@@ -526,7 +527,11 @@ enum msgtype {
 	MSG_WRITE_OPEN,
 	MSG_WRITE,
 	MSG_WRITE_READY,
-	MSG_WRITE_CLOSE
+	MSG_WRITE_CLOSE,
+
+	MSG_JOB_RUN = 400,
+	MSG_JOB_KILL,
+	MSG_JOB_DIED
 };
 
 /*
@@ -571,6 +576,19 @@ struct msg_write_close {
 	int	stream;
 };
 
+struct msg_job_run {
+	u_int	id;
+}; /* followed by command, cwd and environment strings */
+
+struct msg_job_kill {
+	u_int	id;
+};
+
+struct msg_job_died {
+	u_int	id;
+	int	status;
+};
+
 /* Mode keys. */
 #define MODEKEY_EMACS 0
 #define MODEKEY_VI 1
@@ -661,6 +679,11 @@ enum utf8_state {
 #define GRID_LINE_WRAPPED 0x1
 #define GRID_LINE_EXTENDED 0x2
 #define GRID_LINE_DEAD 0x4
+#define GRID_LINE_PACKED 0x8
+#define GRID_LINE_SPILLED 0x10
+#define GRID_LINE_SHARED 0x20
+#define GRID_LINE_IMAGE 0x40
+#define GRID_LINE_TRISIG 0x80
 
 /* Grid cell data. */
 struct grid_cell {
@@ -670,6 +693,7 @@ struct grid_cell {
 	int			fg;
 	int			bg;
 	int			us;
+	u_int			link;
 } __packed;
 struct grid_cell_entry {
 	u_char			flags;
@@ -693,13 +717,34 @@ struct grid_line {
 	u_int			 extdsize;
 	struct grid_cell	*extddata;
 
+	u_int			 packsize;
+	u_char			*packdata;
+	off_t			 packoffset;
+
+	uint64_t		 trisig; /* trigram signature, history-index */
+
 	int			 flags;
 } __packed;
 
+/* An image placement: an anchor cell and a shared payload blob. */
+struct image_blob;
+struct image {
+	struct grid		*gd;
+	struct image_blob	*blob;
+
+	u_int			 px;
+	u_int			 py;	/* absolute (with history) */
+
+	TAILQ_ENTRY(image)	 entry;
+	TAILQ_ENTRY(image)	 age_entry;
+};
+TAILQ_HEAD(images, image);
+
 /* Entire grid of cells. */
 struct grid {
 	int			 flags;
 #define GRID_HISTORY 0x1 /* scroll lines into history */
+#define GRID_SPILLFROZEN 0x2 /* spill file is shared, do not write it */
 
 	u_int			 sx;
 	u_int			 sy;
@@ -709,6 +754,18 @@ struct grid {
 	u_int			 hlimit;
 
 	struct grid_line	*linedata;
+	u_int			 lalloc; /* allocated line slots */
+
+	struct grid_reflow	*reflow; /* pending incremental reflow */
+
+	struct images		*images; /* image placements, if any */
+
+	int			 spillfd; /* history spill file */
+	off_t			 spillsize;
+	off_t			 spilllive;
+
+	TAILQ_ENTRY(grid)	 trisig_entry; /* trigram index queue */
+	int			 trisig_queued;
 };
 
 /* Style alignment. */
@@ -798,6 +855,13 @@ struct screen {
 	bitstr_t		*tabs;
 	struct screen_sel	*sel;
 
+	bitstr_t		*dirty;		/* changed lines */
+	int			 dirty_all;	/* everything changed */
+	u_int			 dirty_x1;	/* changed bounding rectangle */
+	u_int			 dirty_y1;
+	u_int			 dirty_x2;
+	u_int			 dirty_y2;
+
 	struct screen_write_collect_line *write_list;
 };
 
@@ -818,6 +882,12 @@ struct screen_write_ctx {
 	u_int			 scrolled;
 	u_int			 bg;
 
+	/* Last written cell, for combining zero-width characters onto. */
+	struct grid_cell	 combine_cell;
+	u_int			 combine_x;
+	u_int			 combine_y;
+	int			 combine_valid;
+
 	u_int			 cells;
 	u_int			 written;
 	u_int			 skipped;
@@ -833,6 +903,8 @@ struct screen_redraw_ctx {
 	int		 pane_status;
 	int		 pane_lines;
 
+	int		 only_dirty;
+
 	u_int		 sx;
 	u_int		 sy;
 	u_int		 ox;
@@ -898,10 +970,19 @@ struct window_mode_entry {
 	TAILQ_ENTRY (window_mode_entry)	 entry;
 };
 
+/* Control client subscription target. */
+enum control_sub_type {
+	CONTROL_SUB_NONE,
+	CONTROL_SUB_SESSION,
+	CONTROL_SUB_WINDOW,
+	CONTROL_SUB_PANE
+};
+
 /* Child window structure. */
 struct window_pane {
 	u_int		 id;
 	u_int		 active_point;
+	u_int		 generation; /* bumped when content changes */
 
 	struct window	*window;
 	struct options	*options;
@@ -936,6 +1017,9 @@ struct window_pane {
 #define PANE_EMPTY 0x800
 #define PANE_STYLECHANGED 0x1000
 #define PANE_RESIZED 0x2000
+#define PANE_PAUSED 0x4000
+#define PANE_HIBERNATED 0x8000
+#define PANE_BACKPRESSURE 0x10000
 
 	int		 argc;
 	char	       **argv;
@@ -949,6 +1033,15 @@ struct window_pane {
 	int		 fd;
 	struct bufferevent *event;
 
+	/* Probe called when the pane produces output, for latency-test. */
+	void		 (*probe_cb)(struct window_pane *, void *);
+	void		*probe_data;
+
+	size_t		 read_size;
+	size_t		 read_rate;
+	size_t		 read_bytes;
+	struct timeval	 read_time;
+
 	struct event	 resize_timer;
 
 	struct input_ctx *ictx;
@@ -961,12 +1054,46 @@ struct window_pane {
 	struct bufferevent *pipe_event;
 	size_t		 pipe_off;
 
+	FILE		*record_file;
+	size_t		 record_off;
+
+	int		 log_fd;
+	char		*log_path;
+	struct evbuffer	*log_buffer;
+	struct event	 log_event;
+	off_t		 log_size;
+	size_t		 log_off;
+
+	pid_t		 current_pgrp;
+	char		*current_cmd;
+	u_int		 current_cmd_gen;
+
+	pid_t		 current_cwd_pgrp;
+	char		*current_cwd;
+	u_int		 current_cwd_gen;
+
+	struct evbuffer	*paste_pending;
+
+	/* Last content search, kept until new output invalidates it. */
+	char		*search_term;
+	int		 search_regex;
+	int		 search_ignore;
+	u_int		 search_result;
+	int		 search_valid;
+
 	struct screen	*screen;
 	struct screen	 base;
 
 	struct screen	 status_screen;
 	size_t		 status_size;
 
+	/* Pane-border-status inputs when status_screen was last built. */
+	char		*border_text;
+	u_int		 border_gen;
+	u_int		 border_opts_gen;
+	int		 border_active;
+	u_int		 border_sx;
+
 	TAILQ_HEAD (, window_mode_entry) modes;
 
 	char		*searchstr;
@@ -984,13 +1111,24 @@ struct window_pane {
 TAILQ_HEAD(window_panes, window_pane);
 RB_HEAD(window_pane_tree, window_pane);
 
+/*
+ * Frame header for recorded pane output. Each chunk read from the pty is
+ * written as a header followed by the data. Timestamps are absolute so a
+ * replay can recover the original pacing. Host byte order; recordings are
+ * not expected to move between machines.
+ */
+struct window_pane_record_frame {
+	uint64_t	 tv_sec;
+	uint32_t	 tv_usec;
+	uint32_t	 size;
+};
+
 /* Window structure. */
 struct window {
 	u_int		 id;
 	void		*latest;
 
 	char		*name;
-	struct event	 name_event;
 	struct timeval	 name_time;
 
 	struct event	 alerts_timer;
@@ -1006,6 +1144,12 @@ struct window {
 	struct layout_cell *layout_root;
 	struct layout_cell *saved_layout_root;
 	char		*old_layout;
+	char		*layout_cache;
+
+	u_char		*border_map;	/* cached border cell types */
+	u_int		 border_map_sx;
+	u_int		 border_map_sy;
+	uint64_t	 border_map_key;
 
 	u_int		 sx;
 	u_int		 sy;
@@ -1024,10 +1168,12 @@ struct window {
 #define WINDOW_ZOOMED 0x8
 #define WINDOW_WASZOOMED 0x10
 #define WINDOW_RESIZE 0x20
+#define WINDOW_VISIBLE 0x40
 #define WINDOW_ALERTFLAGS (WINDOW_BELL|WINDOW_ACTIVITY|WINDOW_SILENCE)
 
 	int		 alerts_queued;
 	TAILQ_ENTRY(window) alerts_entry;
+	struct timeval	 alerts_bell_time;
 
 	struct options	*options;
 
@@ -1159,8 +1305,12 @@ struct session {
 
 	TAILQ_ENTRY(session) gentry;
 	RB_ENTRY(session)    entry;
+
+	/* Position in the activity-ordered list (most recent first). */
+	TAILQ_ENTRY(session) activity_entry;
 };
 RB_HEAD(sessions, session);
+TAILQ_HEAD(session_activity_list, session);
 
 /* Mouse button masks. */
 #define MOUSE_MASK_BUTTONS 3
@@ -1242,6 +1392,8 @@ struct tty_term {
 #define TERM_DECFRA 0x8
 #define TERM_RGBCOLOURS 0x10
 #define TERM_VT100LIKE 0x20
+#define TERM_HYPERLINKS 0x40
+#define TERM_SIXEL 0x80
 	int		 flags;
 
 	LIST_ENTRY(tty_term) entry;
@@ -1292,7 +1444,7 @@ struct tty {
 #define TTY_NOCURSOR 0x1
 #define TTY_FREEZE 0x2
 #define TTY_TIMER 0x4
-/* 0x8 unused */
+#define TTY_PASTING 0x8
 #define TTY_STARTED 0x10
 #define TTY_OPENED 0x20
 /* 0x40 unused */
@@ -1304,6 +1456,9 @@ struct tty {
 
 	struct tty_term	*term;
 
+	/* Cached tty_acs_needed result, -1 when not yet known. */
+	int		 acs_needed;
+
 	u_int		 mouse_last_x;
 	u_int		 mouse_last_y;
 	u_int		 mouse_last_b;
@@ -1315,6 +1470,12 @@ struct tty {
 
 	struct event	 key_timer;
 	struct tty_key	*key_tree;
+
+	/* Dispatch table for the first byte of a key sequence. */
+	struct tty_key	*key_first[UCHAR_MAX + 1];
+
+	/* Hashes of the line segments last drawn on the terminal. */
+	RB_HEAD(tty_shadows, tty_shadow) shadows;
 };
 
 /* TTY command context. */
@@ -1499,10 +1660,19 @@ struct cmd_entry {
 #define STATUS_LINES_LIMIT 5
 struct status_line_entry {
 	char			*expanded;
+	char			*fmt;
+	time_t			 time;
+	u_int			 serial;
+	int			 unstable;
+	int			 clientdep;
 	struct style_ranges	 ranges;
+
+	/* Ranges sorted by start for binary search, rebuilt with them. */
+	struct style_range	**range_index;
+	u_int			 range_count;
 };
 struct status_line {
-	struct event		 timer;
+	struct timeval		 next;
 
 	struct screen		 screen;
 	struct screen		*active;
@@ -1527,6 +1697,7 @@ struct client_file {
 	int				 fd;
 	int				 error;
 	int				 closed;
+	int				 queued;
 
 	client_file_cb			 cb;
 	void				*data;
@@ -1582,9 +1753,19 @@ struct client {
 	size_t		 written;
 	size_t		 discarded;
 	size_t		 redraw;
+	struct timeval	 redraw_time;
+
+	/* Size of the last full redraw and the measured drain rate. */
+	size_t		 redraw_size;
+	uint64_t	 redraw_bps;
+
+	/* 1 to trace the next redraw, 2 while waiting for it to drain. */
+	int		 redraw_trace;
 
 	struct event	 repeat_timer;
 
+	struct event	 resize_timer;
+
 	struct event	 click_timer;
 	u_int		 click_button;
 	struct mouse_event click_event;
@@ -1623,6 +1804,8 @@ struct client {
 #define CLIENT_REDRAWPANES 0x20000000
 #define CLIENT_NOFORK 0x40000000
 #define CLIENT_ACTIVEPANE 0x80000000ULL
+#define CLIENT_CONTROL_BINARY 0x100000000ULL
+#define CLIENT_RESIZEAGAIN 0x200000000ULL
 #define CLIENT_ALLREDRAWFLAGS		\
 	(CLIENT_REDRAWWINDOW|		\
 	 CLIENT_REDRAWSTATUS|		\
@@ -1683,8 +1866,16 @@ struct client {
 	void		*overlay_data;
 	struct event	 overlay_timer;
 
+	int		 overlay_box;	/* bounding box of overlay known */
+	u_int		 overlay_px;
+	u_int		 overlay_py;
+	u_int		 overlay_sx;
+	u_int		 overlay_sy;
+
 	struct client_files files;
 
+	struct control_state *control_state;
+
 	TAILQ_ENTRY(client) entry;
 };
 TAILQ_HEAD(clients, client);
@@ -1707,6 +1898,14 @@ struct key_table {
 	struct key_bindings	 key_bindings;
 	struct key_bindings	 default_key_bindings;
 
+	/*
+	 * Sorted array of the bindings for fast lookup, rebuilt when a
+	 * binding is added or removed rather than on each key press.
+	 */
+	struct key_binding	**sorted;
+	u_int			  sorted_count;
+	int			  sorted_dirty;
+
 	u_int			 references;
 
 	RB_ENTRY(key_table)	 entry;
@@ -1897,6 +2096,8 @@ void		 format_each(struct format_tree *, void (*)(const char *,
 		     const char *, void *), void *);
 char		*format_expand_time(struct format_tree *, const char *);
 char		*format_expand(struct format_tree *, const char *);
+int		 format_unstable(struct format_tree *);
+int		 format_client_dependent(struct format_tree *);
 char		*format_single(struct cmdq_item *, const char *,
 		     struct client *, struct session *, struct winlink *,
 		     struct window_pane *);
@@ -1929,6 +2130,8 @@ char		*format_trim_right(const char *, u_int);
 
 /* notify.c */
 void	notify_hook(struct cmdq_item *, const char *);
+struct cmdq_list *notify_async_queue(const char *);
+u_int	notify_async_next(void);
 void	notify_input(struct window_pane *, const u_char *, size_t);
 void	notify_client(const char *, struct client *);
 void	notify_session(const char *, struct session *);
@@ -1976,6 +2179,8 @@ struct options_entry *options_match_get(struct options *, const char *, int *,
 		     int, int *);
 const char	*options_get_string(struct options *, const char *);
 long long	 options_get_number(struct options *, const char *);
+u_int		 options_get_generation(void);
+u_int		 options_get_changes(struct options *);
 struct options_entry * printflike(4, 5) options_set_string(struct options *,
 		     const char *, int, const char *, ...);
 struct options_entry *options_set_number(struct options *, const char *,
@@ -2002,12 +2207,14 @@ typedef void (*job_free_cb) (void *);
 #define JOB_NOWAIT 0x1
 #define JOB_KEEPWRITE 0x2
 #define JOB_PTY 0x4
+#define JOB_POOLED 0x8
 struct job	*job_run(const char *, struct session *, const char *,
 		     job_update_cb, job_complete_cb, job_free_cb, void *, int,
 		     int, int);
 void		 job_free(struct job *);
 void		 job_resize(struct job *, u_int, u_int);
 void		 job_check_died(pid_t, int);
+void		 job_runner_died(u_int, int);
 int		 job_get_status(struct job *);
 void		*job_get_data(struct job *);
 struct bufferevent *job_get_event(struct job *);
@@ -2015,6 +2222,12 @@ void		 job_kill_all(void);
 int		 job_still_running(void);
 void		 job_print_summary(struct cmdq_item *, int);
 
+/* job-runner.c */
+void		 job_runner_fork(void);
+u_int		 job_runner_run(const char *, const char *, struct environ *,
+		     int);
+void		 job_runner_kill(u_int);
+
 /* environ.c */
 struct environ *environ_create(void);
 void	environ_free(struct environ *);
@@ -2065,8 +2278,11 @@ void	tty_send_requests(struct tty *);
 void	tty_stop_tty(struct tty *);
 void	tty_set_title(struct tty *, const char *);
 void	tty_update_mode(struct tty *, int, struct screen *);
-void	tty_draw_line(struct tty *, struct screen *, u_int, u_int, u_int,
+int	tty_draw_line(struct tty *, struct screen *, u_int, u_int, u_int,
 	    u_int, u_int, const struct grid_cell *, int *);
+void	tty_draw_images(struct tty *, struct screen *, u_int, u_int, u_int);
+void	tty_infer_scroll(struct tty *, struct screen *, u_int, u_int, u_int,
+	    u_int, const struct grid_cell *, int *);
 void	tty_sync_start(struct tty *);
 void	tty_sync_end(struct tty *);
 int	tty_open(struct tty *, char **);
@@ -2096,6 +2312,7 @@ void	tty_cmd_scrolldown(struct tty *, const struct tty_ctx *);
 void	tty_cmd_reverseindex(struct tty *, const struct tty_ctx *);
 void	tty_cmd_setselection(struct tty *, const struct tty_ctx *);
 void	tty_cmd_rawstring(struct tty *, const struct tty_ctx *);
+void	tty_cmd_sixel(struct tty *, const struct tty_ctx *);
 void	tty_cmd_syncstart(struct tty *, const struct tty_ctx *);
 void	tty_default_colours(struct grid_cell *, struct window_pane *);
 
@@ -2122,6 +2339,8 @@ int		 tty_term_flag(struct tty_term *, enum tty_code_code);
 const char	*tty_term_describe(struct tty_term *, enum tty_code_code);
 
 /* tty-features.c */
+void		 tty_features_cache_store(struct client *);
+int		 tty_features_cache_get(struct client *);
 void		 tty_add_features(int *, const char *, const char *);
 const char	*tty_get_features(int);
 int		 tty_apply_features(struct tty_term *, int);
@@ -2183,6 +2402,7 @@ int		 cmd_find_from_client(struct cmd_find_state *, struct client *,
 int		 cmd_find_from_mouse(struct cmd_find_state *,
 		     struct mouse_event *, int);
 int		 cmd_find_from_nothing(struct cmd_find_state *, int);
+void		 cmd_find_invalidate(void);
 
 /* cmd.c */
 extern const struct cmd_entry *cmd_table[];
@@ -2225,6 +2445,8 @@ enum cmd_retval	 cmd_attach_session(struct cmdq_item *, const char *, int, int,
 /* cmd-parse.c */
 void		 cmd_parse_empty(struct cmd_parse_input *);
 struct cmd_parse_result *cmd_parse_from_file(FILE *, struct cmd_parse_input *);
+struct cmd_parse_result *cmd_parse_from_file_cached(FILE *, const char *,
+		     struct cmd_parse_input *);
 struct cmd_parse_result *cmd_parse_from_string(const char *,
 		     struct cmd_parse_input *);
 enum cmd_parse_status cmd_parse_and_insert(const char *,
@@ -2264,13 +2486,16 @@ struct cmdq_item *cmdq_get_callback1(const char *, cmdq_cb, void *);
 struct cmdq_item *cmdq_get_error(const char *);
 struct cmdq_item *cmdq_insert_after(struct cmdq_item *, struct cmdq_item *);
 struct cmdq_item *cmdq_append(struct client *, struct cmdq_item *);
+struct cmdq_item *cmdq_append_queue(struct cmdq_list *, struct cmdq_item *);
 void		 cmdq_insert_hook(struct session *, struct cmdq_item *,
 		     struct cmd_find_state *, const char *, ...);
 void		 cmdq_continue(struct cmdq_item *);
 u_int		 cmdq_next(struct client *);
+u_int		 cmdq_next_queue(struct cmdq_list *, const char *);
 struct cmdq_item *cmdq_running(struct client *);
 void		 cmdq_guard(struct cmdq_item *, const char *, int);
 void printflike(2, 3) cmdq_print(struct cmdq_item *, const char *, ...);
+void	 cmdq_print_stats(struct cmdq_item *);
 void printflike(2, 3) cmdq_error(struct cmdq_item *, const char *, ...);
 
 /* cmd-wait-for.c */
@@ -2323,11 +2548,29 @@ void	 file_write(struct client *, const char *, int, const void *, size_t,
 void	 file_read(struct client *, const char *, client_file_cb, void *);
 void	 file_push(struct client_file *);
 
+/* Server performance counters. */
+struct server_perf {
+	unsigned long long	 loops;		/* event loop iterations */
+	unsigned long long	 input_calls;	/* calls to parse pane input */
+	unsigned long long	 input_bytes;	/* pane input bytes parsed */
+	unsigned long long	 tty_writes;	/* tty command batches */
+	unsigned long long	 tty_bytes;	/* bytes written to ttys */
+	unsigned long long	 format_expands;/* formats expanded */
+	unsigned long long	 grid_reflows;	/* grids reflowed */
+	unsigned long long	 xallocs;	/* heap allocations */
+	unsigned long long	 compact_runs;	/* idle compaction passes */
+	unsigned long long	 compact_bytes;	/* bytes compaction reclaimed */
+	unsigned long long	 memory_bytes;	/* grid bytes at last check */
+	unsigned long long	 memory_runs;	/* budget enforcement passes */
+	unsigned long long	 memory_reclaimed; /* bytes budget reclaimed */
+};
+
 /* server.c */
 extern struct tmuxproc *server_proc;
 extern struct clients clients;
 extern struct cmd_find_state marked_pane;
 extern struct message_list message_log;
+extern struct server_perf server_perf;
 void	 server_set_marked(struct session *, struct winlink *,
 	     struct window_pane *);
 void	 server_clear_marked(void);
@@ -2337,6 +2580,8 @@ int	 server_check_marked(void);
 int	 server_start(struct tmuxproc *, int, struct event_base *, int, char *);
 void	 server_update_socket(void);
 void	 server_add_accept(int);
+void	 server_wake_timers(void);
+uint64_t server_tick_phase(void);
 void printflike(1, 2) server_add_message(const char *, ...);
 
 /* server-client.c */
@@ -2346,10 +2591,13 @@ void	 server_client_set_overlay(struct client *, u_int, overlay_check_cb,
 	     overlay_mode_cb, overlay_draw_cb, overlay_key_cb,
 	     overlay_free_cb, void *);
 void	 server_client_clear_overlay(struct client *);
+void	 server_client_set_overlay_box(struct client *, u_int, u_int, u_int,
+	     u_int);
 void	 server_client_set_key_table(struct client *, const char *);
 const char *server_client_get_key_table(struct client *);
 int	 server_client_check_nested(struct client *);
 int	 server_client_handle_key(struct client *, struct key_event *);
+void	 server_client_handle_paste(struct client *, const char *, size_t);
 struct client *server_client_create(int);
 int	 server_client_open(struct client *, char **);
 void	 server_client_unref(struct client *);
@@ -2381,7 +2629,8 @@ void	 server_lock(void);
 void	 server_lock_session(struct session *);
 void	 server_lock_client(struct client *);
 void	 server_kill_pane(struct window_pane *);
-void	 server_kill_window(struct window *);
+void	 server_renumber_all(void);
+void	 server_kill_window(struct window *, int);
 int	 server_link_window(struct session *,
 	     struct winlink *, struct session *, int, int, int, char **);
 void	 server_unlink_window(struct session *, struct winlink *);
@@ -2394,6 +2643,7 @@ void	 server_unzoom_window(struct window *);
 void	 status_timer_start(struct client *);
 void	 status_timer_start_all(void);
 void	 status_update_cache(struct session *);
+void	 status_invalidate(void);
 int	 status_at_line(struct client *);
 u_int	 status_line_size(struct client *);
 struct style_range *status_get_range(struct client *, u_int, u_int);
@@ -2420,12 +2670,15 @@ void	 default_window_size(struct client *, struct session *, struct window *,
 	     u_int *, u_int *, u_int *, u_int *, int);
 void	 recalculate_size(struct window *);
 void	 recalculate_sizes(void);
+void	 recalculate_sizes_for_client(struct client *);
 
 /* input.c */
 struct input_ctx *input_init(struct window_pane *, struct bufferevent *);
+void	 input_update_widths(struct input_ctx *);
 void	 input_free(struct input_ctx *);
 void	 input_reset(struct input_ctx *, int);
 struct evbuffer *input_pending(struct input_ctx *);
+void	 input_hibernate(struct input_ctx *);
 void	 input_parse_pane(struct window_pane *);
 void	 input_parse_buffer(struct window_pane *, u_char *, size_t);
 void	 input_parse_screen(struct input_ctx *, struct screen *,
@@ -2465,8 +2718,14 @@ void	 grid_remove_history(struct grid *, u_int );
 void	 grid_scroll_history(struct grid *, u_int);
 void	 grid_scroll_history_region(struct grid *, u_int, u_int, u_int);
 void	 grid_clear_history(struct grid *);
+void	 grid_hibernate(struct grid *);
+size_t	 grid_compact(struct grid *);
+size_t	 grid_memory(struct grid *);
+size_t	 grid_spill(struct grid *);
 const struct grid_line *grid_peek_line(struct grid *, u_int);
 void	 grid_get_cell(struct grid *, u_int, u_int, struct grid_cell *);
+void	 grid_get_line_cell(struct grid *, const struct grid_line *, u_int,
+	     struct grid_cell *);
 void	 grid_set_cell(struct grid *, u_int, u_int, const struct grid_cell *);
 void	 grid_set_cells(struct grid *, u_int, u_int, const struct grid_cell *,
 	     const char *, size_t);
@@ -2478,8 +2737,14 @@ void	 grid_move_lines(struct grid *, u_int, u_int, u_int, u_int);
 void	 grid_move_cells(struct grid *, u_int, u_int, u_int, u_int, u_int);
 char	*grid_string_cells(struct grid *, u_int, u_int, u_int,
 	     struct grid_cell **, int, int, int);
+int	 grid_copy_cells(struct grid *, u_int, u_int, struct grid *, u_int,
+	     u_int, u_int);
+uint64_t grid_trigram_mask(const char *);
+int	 grid_line_may_contain(struct grid *, u_int, uint64_t);
 void	 grid_duplicate_lines(struct grid *, u_int, struct grid *, u_int,
 	     u_int);
+void	 grid_snapshot_lines(struct grid *, u_int, struct grid *, u_int,
+	     u_int);
 void	 grid_reflow(struct grid *, u_int);
 void	 grid_wrap_position(struct grid *, u_int, u_int, u_int *, u_int *);
 void	 grid_unwrap_position(struct grid *, u_int *, u_int *, u_int, u_int);
@@ -2505,6 +2770,17 @@ void	 grid_view_insert_cells(struct grid *, u_int, u_int, u_int, u_int);
 void	 grid_view_delete_cells(struct grid *, u_int, u_int, u_int, u_int);
 char	*grid_view_string_cells(struct grid *, u_int, u_int, u_int);
 
+/* hyperlinks.c */
+u_int	 hyperlinks_put(const char *, const char *);
+int	 hyperlinks_get(u_int, const char **, const char **);
+
+/* image.c */
+struct image *image_place(struct grid *, u_int, u_int, char *, size_t);
+void	 image_free_all(struct grid *);
+void	 image_free_visible(struct grid *);
+void	 image_trim(struct grid *, u_int);
+const char *image_data(struct image *, size_t *);
+
 /* screen-write.c */
 void	 screen_write_make_list(struct screen *);
 void	 screen_write_free_list(struct screen *);
@@ -2532,6 +2808,8 @@ void	 screen_write_hline(struct screen_write_ctx *, u_int, int, int);
 void	 screen_write_vline(struct screen_write_ctx *, u_int, int, int);
 void	 screen_write_menu(struct screen_write_ctx *, struct menu *, int,
 	     const struct grid_cell *);
+void	 screen_write_menu_line(struct screen_write_ctx *, struct menu *,
+	     u_int, int, const struct grid_cell *);
 void	 screen_write_box(struct screen_write_ctx *, u_int, u_int);
 void	 screen_write_preview(struct screen_write_ctx *, struct screen *, u_int,
 	     u_int);
@@ -2565,9 +2843,12 @@ void	 screen_write_clearhistory(struct screen_write_ctx *);
 void	 screen_write_collect_end(struct screen_write_ctx *);
 void	 screen_write_collect_add(struct screen_write_ctx *,
 	     const struct grid_cell *);
+void	 screen_write_collect_add_run(struct screen_write_ctx *,
+	     const struct grid_cell *, const u_char *, size_t);
 void	 screen_write_cell(struct screen_write_ctx *, const struct grid_cell *);
 void	 screen_write_setselection(struct screen_write_ctx *, u_char *, u_int);
 void	 screen_write_rawstring(struct screen_write_ctx *, u_char *, u_int);
+void	 screen_write_sixel(struct screen_write_ctx *, struct image *);
 void	 screen_write_alternateon(struct screen_write_ctx *,
 	     struct grid_cell *, int);
 void	 screen_write_alternateoff(struct screen_write_ctx *,
@@ -2575,13 +2856,18 @@ void	 screen_write_alternateoff(struct screen_write_ctx *,
 
 /* screen-redraw.c */
 void	 screen_redraw_screen(struct client *);
-void	 screen_redraw_pane(struct client *, struct window_pane *);
+void	 screen_redraw_pane(struct client *, struct window_pane *, int);
 
 /* screen.c */
 void	 screen_init(struct screen *, u_int, u_int, u_int);
 void	 screen_reinit(struct screen *);
 void	 screen_free(struct screen *);
 void	 screen_reset_tabs(struct screen *);
+void	 screen_dirty_cells(struct screen *, u_int, u_int, u_int, u_int);
+void	 screen_dirty_lines(struct screen *, u_int, u_int);
+void	 screen_dirty_all(struct screen *);
+void	 screen_dirty_clear(struct screen *);
+int	 screen_line_dirty(struct screen *, u_int);
 void	 screen_set_cursor_style(struct screen *, u_int);
 void	 screen_set_cursor_colour(struct screen *, const char *);
 int	 screen_set_title(struct screen *, const char *);
@@ -2630,6 +2916,14 @@ struct window	*window_find_by_id(u_int);
 void		 window_update_activity(struct window *);
 struct window	*window_create(u_int, u_int, u_int, u_int);
 void		 window_pane_set_event(struct window_pane *);
+void		 window_pane_paste(struct window_pane *, const void *, size_t);
+int		 window_pane_record_start(struct window_pane *, const char *);
+void		 window_pane_record_stop(struct window_pane *);
+void		 window_pane_update_log(struct window_pane *);
+size_t		 window_pane_memory(struct window_pane *);
+void		 window_pane_pause(struct window_pane *);
+void		 window_pane_resume(struct window_pane *);
+void		 window_pane_check_backpressure(struct window_pane *);
 struct window_pane *window_get_active_at(struct window *, u_int, u_int);
 struct window_pane *window_find_string(struct window *, const char *);
 int		 window_has_pane(struct window *, struct window_pane *);
@@ -2657,6 +2951,8 @@ u_int		 window_count_panes(struct window *);
 void		 window_destroy_panes(struct window *);
 struct window_pane *window_pane_find_by_id_str(const char *);
 struct window_pane *window_pane_find_by_id(u_int);
+void		 window_pane_hibernate(struct window_pane *);
+u_int		 window_pane_reserve_id(void);
 int		 window_pane_destroy_ready(struct window_pane *);
 void		 window_pane_resize(struct window_pane *, u_int, u_int);
 void		 window_pane_set_palette(struct window_pane *, u_int, int);
@@ -2721,6 +3017,8 @@ void		 layout_spread_out(struct window_pane *);
 
 /* layout-custom.c */
 char		*layout_dump(struct layout_cell *);
+const char	*layout_dump_cached(struct window *);
+void		 layout_invalidate(struct window *);
 int		 layout_parse(struct window *, const char *);
 
 /* layout-set.c */
@@ -2800,12 +3098,35 @@ char	*default_window_name(struct window *);
 char	*parse_window_name(const char *);
 
 /* control.c */
+/*
+ * Frame header for the binary control protocol, followed by length bytes of
+ * payload. TEXT frames carry one notification or output line without the
+ * trailing newline; OUTPUT frames carry raw pane output without escaping.
+ */
+struct control_frame {
+	u_int	type;
+	u_int	pane;
+	u_int	length;
+};
+#define CONTROL_FRAME_TEXT 0
+#define CONTROL_FRAME_OUTPUT 1
+
 void	control_start(struct client *);
+void	control_stop(struct client *);
+void	control_add_sub(struct client *, const char *, enum control_sub_type,
+	    u_int, const char *);
+void	control_remove_sub(struct client *, const char *);
+void	control_check_subs(struct client *);
+void	control_set_flow_window(struct client *, size_t);
+void	control_acknowledge(struct client *, struct window_pane *, size_t);
+void	control_add_output(struct client *, struct window_pane *, size_t);
 void printflike(2, 3) control_write(struct client *, const char *, ...);
+void	control_write_buffer(struct client *, struct evbuffer *);
+void	control_write_frame(struct client *, u_int, u_int, const void *,
+	    size_t);
 
 /* control-notify.c */
-void	control_notify_input(struct client *, struct window_pane *,
-	    const u_char *, size_t);
+void	control_notify_input(struct window_pane *, const u_char *, size_t);
 void	control_notify_pane_mode_changed(int);
 void	control_notify_window_layout_changed(struct window *);
 void	control_notify_window_pane_changed(struct window *);
@@ -2820,6 +3141,7 @@ void	control_notify_session_window_changed(struct session *);
 
 /* session.c */
 extern struct sessions sessions;
+extern struct session_activity_list session_activity_list;
 int	session_cmp(struct session *, struct session *);
 RB_PROTOTYPE(sessions, session, entry, session_cmp);
 int		 session_alive(struct session *);
@@ -2862,6 +3184,10 @@ void		 utf8_set(struct utf8_data *, u_char);
 void		 utf8_copy(struct utf8_data *, const struct utf8_data *);
 enum utf8_state	 utf8_open(struct utf8_data *, u_char);
 enum utf8_state	 utf8_append(struct utf8_data *, u_char);
+void		 utf8_apply_width(struct utf8_data *, int, int);
+int		 utf8_grapheme_continuer(const struct utf8_data *);
+int		 utf8_grapheme_continues(const struct utf8_data *,
+		     const struct utf8_data *);
 enum utf8_state	 utf8_combine(const struct utf8_data *, wchar_t *);
 enum utf8_state	 utf8_split(wchar_t, struct utf8_data *);
 int		 utf8_isvalid(const char *);
@@ -2889,6 +3215,8 @@ void	log_open(const char *);
 void	log_toggle(const char *);
 void	log_close(void);
 void printflike(1, 2) log_debug(const char *, ...);
+void printflike(1, 2) log_record(const char *, ...);
+void	log_record_dump(void (*)(void *, const char *), void *);
 __dead void printflike(1, 2) fatal(const char *, ...);
 __dead void printflike(1, 2) fatalx(const char *, ...);
 
@@ -2934,9 +3262,21 @@ void		 style_apply(struct grid_cell *, struct options *,
 void		 style_set(struct style *, const struct grid_cell *);
 void		 style_copy(struct style *, struct style *);
 
+/* snapshot.c */
+int		 snapshot_write(const char *, char **);
+int		 snapshot_write_session(struct session *, const char *,
+		     char **);
+int		 snapshot_restore(struct cmdq_item *, const char *, char **);
+void		 snapshot_check_restore(void);
+void		 journal_update(void);
+void		 journal_event(const char *, struct session *,
+		     struct window *);
+int		 journal_replay(struct cmdq_item *, const char *, char **);
+
 /* spawn.c */
 struct winlink	*spawn_window(struct spawn_context *, char **);
 struct window_pane *spawn_pane(struct spawn_context *, char **);
+void		 spawn_pool_discard(struct session *);
 
 /* regsub.c */
 char		*regsub(const char *, const char *, const char *, int);
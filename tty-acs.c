@@ -110,14 +110,9 @@ static const struct tty_acs_reverse_entry tty_acs_reverse3[] = {
 	{ "\342\225\254", 'n' },
 };
 
-static int
-tty_acs_cmp(const void *key, const void *value)
-{
-	const struct tty_acs_entry	*entry = value;
-	int				 test = *(u_char *)key;
-
-	return (test - entry->key);
-}
+/* Direct lookup by character, built from tty_acs_table on first use. */
+static const char	*tty_acs_lookup[UCHAR_MAX + 1];
+static int		 tty_acs_lookup_built;
 
 static int
 tty_acs_reverse_cmp(const void *key, const void *value)
@@ -134,6 +129,8 @@ tty_acs_needed(struct tty *tty)
 {
 	if (tty == NULL)
 		return (0);
+	if (tty->acs_needed != -1)
+		return (tty->acs_needed);
 
 	/*
 	 * If the U8 flag is present, it marks whether a terminal supports
@@ -147,18 +144,19 @@ tty_acs_needed(struct tty *tty)
 	 */
 	if (tty_term_has(tty->term, TTYC_U8) &&
 	    tty_term_number(tty->term, TTYC_U8) == 0)
-		return (1);
-
-	if (tty->client->flags & CLIENT_UTF8)
-		return (0);
-	return (1);
+		tty->acs_needed = 1;
+	else if (tty->client->flags & CLIENT_UTF8)
+		tty->acs_needed = 0;
+	else
+		tty->acs_needed = 1;
+	return (tty->acs_needed);
 }
 
 /* Retrieve ACS to output as UTF-8. */
 const char *
 tty_acs_get(struct tty *tty, u_char ch)
 {
-	const struct tty_acs_entry	*entry;
+	u_int	i;
 
 	/* Use the ACS set instead of UTF-8 if needed. */
 	if (tty_acs_needed(tty)) {
@@ -168,11 +166,13 @@ tty_acs_get(struct tty *tty, u_char ch)
 	}
 
 	/* Otherwise look up the UTF-8 translation. */
-	entry = bsearch(&ch, tty_acs_table, nitems(tty_acs_table),
-	    sizeof tty_acs_table[0], tty_acs_cmp);
-	if (entry == NULL)
-		return (NULL);
-	return (entry->string);
+	if (!tty_acs_lookup_built) {
+		for (i = 0; i < nitems(tty_acs_table); i++)
+			tty_acs_lookup[tty_acs_table[i].key] =
+			    tty_acs_table[i].string;
+		tty_acs_lookup_built = 1;
+	}
+	return (tty_acs_lookup[ch]);
 }
 
 /* Reverse UTF-8 into ACS. */
@@ -144,6 +144,26 @@ static const struct tty_feature tty_feature_focus = {
 	0
 };
 
+/*
+ * Terminal supports OSC 8 hyperlinks. There is no capability for this, it is
+ * always the same sequence.
+ */
+static const struct tty_feature tty_feature_hyperlinks = {
+	"hyperlinks",
+	NULL,
+	TERM_HYPERLINKS
+};
+
+/*
+ * Terminal supports sixel images. There is no capability; images are passed
+ * through as-is.
+ */
+static const struct tty_feature tty_feature_sixel = {
+	"sixel",
+	NULL,
+	TERM_SIXEL
+};
+
 /* Terminal supports cursor styles. */
 static const char *tty_feature_cstyle_capabilities[] = {
 	"Ss=\\E[%p1%d q",
@@ -232,16 +252,136 @@ static const struct tty_feature *tty_features[] = {
 	&tty_feature_cstyle,
 	&tty_feature_extkeys,
 	&tty_feature_focus,
+	&tty_feature_hyperlinks,
 	&tty_feature_margins,
 	&tty_feature_overline,
 	&tty_feature_rectfill,
 	&tty_feature_rgb,
+	&tty_feature_sixel,
 	&tty_feature_strikethrough,
 	&tty_feature_sync,
 	&tty_feature_title,
 	&tty_feature_usstyle
 };
 
+/*
+ * Detection results learned from DA and DSR responses, cached so that a
+ * terminal which has been seen before can skip the request round-trips
+ * (and the timeout for terminals which never answer) when it reattaches.
+ * The tty name has any trailing digits stripped so every pty from the
+ * same source matches, and SSH_CLIENT distinguishes forwarded connections.
+ */
+struct tty_feature_cache_entry {
+	char				*term;
+	char				*ttyname;
+	char				*ssh;
+
+	int				 features;
+	char				*type;
+
+	RB_ENTRY(tty_feature_cache_entry) entry;
+};
+
+static int	tty_feature_cache_cmp(struct tty_feature_cache_entry *,
+		    struct tty_feature_cache_entry *);
+
+RB_HEAD(tty_feature_cache, tty_feature_cache_entry);
+RB_GENERATE_STATIC(tty_feature_cache, tty_feature_cache_entry, entry,
+    tty_feature_cache_cmp);
+
+static struct tty_feature_cache	tty_feature_cache =
+    RB_INITIALIZER(&tty_feature_cache);
+
+static int
+tty_feature_cache_cmp(struct tty_feature_cache_entry *e1,
+    struct tty_feature_cache_entry *e2)
+{
+	int	r;
+
+	if ((r = strcmp(e1->term, e2->term)) != 0)
+		return (r);
+	if ((r = strcmp(e1->ttyname, e2->ttyname)) != 0)
+		return (r);
+	return (strcmp(e1->ssh, e2->ssh));
+}
+
+/* Build the cache key for a client. */
+static void
+tty_feature_cache_key(struct client *c,
+    struct tty_feature_cache_entry *entry)
+{
+	static char		 ttyname[128];
+	struct environ_entry	*envent;
+	size_t			 end;
+
+	if (c->term_name != NULL)
+		entry->term = c->term_name;
+	else
+		entry->term = (char *)"";
+
+	strlcpy(ttyname, c->ttyname == NULL ? "" : c->ttyname,
+	    sizeof ttyname);
+	end = strlen(ttyname);
+	while (end > 0 && ttyname[end - 1] >= '0' && ttyname[end - 1] <= '9')
+		ttyname[--end] = '\0';
+	entry->ttyname = ttyname;
+
+	envent = environ_find(c->environ, "SSH_CLIENT");
+	if (envent != NULL && envent->value != NULL)
+		entry->ssh = envent->value;
+	else
+		entry->ssh = (char *)"";
+}
+
+/* Store the detection results for a client in the cache. */
+void
+tty_features_cache_store(struct client *c)
+{
+	struct tty_feature_cache_entry	 find, *entry;
+
+	tty_feature_cache_key(c, &find);
+
+	entry = RB_FIND(tty_feature_cache, &tty_feature_cache, &find);
+	if (entry == NULL) {
+		entry = xcalloc(1, sizeof *entry);
+		entry->term = xstrdup(find.term);
+		entry->ttyname = xstrdup(find.ttyname);
+		entry->ssh = xstrdup(find.ssh);
+		RB_INSERT(tty_feature_cache, &tty_feature_cache, entry);
+	}
+	entry->features = c->term_features;
+	free(entry->type);
+	entry->type = c->term_type == NULL ? NULL : xstrdup(c->term_type);
+
+	log_debug("%s: %s (%s%s%s) = %s", __func__, entry->term,
+	    entry->ttyname, *entry->ssh != '\0' ? " via " : "", entry->ssh,
+	    tty_get_features(entry->features));
+}
+
+/* Apply cached detection results, if any. Returns 1 on a hit. */
+int
+tty_features_cache_get(struct client *c)
+{
+	struct tty_feature_cache_entry	 find, *entry;
+
+	tty_feature_cache_key(c, &find);
+
+	entry = RB_FIND(tty_feature_cache, &tty_feature_cache, &find);
+	if (entry == NULL)
+		return (0);
+
+	log_debug("%s: %s (%s%s%s) = %s", __func__, entry->term,
+	    entry->ttyname, *entry->ssh != '\0' ? " via " : "", entry->ssh,
+	    tty_get_features(entry->features));
+
+	c->term_features |= entry->features;
+	if (entry->type != NULL) {
+		free(c->term_type);
+		c->term_type = xstrdup(entry->type);
+	}
+	return (1);
+}
+
 void
 tty_add_features(int *feat, const char *s, const char *separators)
 {
@@ -334,7 +474,7 @@ tty_default_features(int *feat, const char *name, u_int version)
 	} table[] = {
 #define TTY_FEATURES_BASE_MODERN_XTERM "256,RGB,bpaste,clipboard,strikethrough,title"
 		{ .name = "mintty",
-		  .features = TTY_FEATURES_BASE_MODERN_XTERM ",ccolour,cstyle,extkeys,margins,overline"
+		  .features = TTY_FEATURES_BASE_MODERN_XTERM ",ccolour,cstyle,extkeys,hyperlinks,margins,overline"
 		},
 		{ .name = "tmux",
 		  .features = TTY_FEATURES_BASE_MODERN_XTERM ",ccolour,cstyle,focus,overline,usstyle"
@@ -343,7 +483,7 @@ tty_default_features(int *feat, const char *name, u_int version)
 		  .features = "256,bpaste,ccolour,cstyle,title"
 		},
 		{ .name = "iTerm2",
-		  .features = TTY_FEATURES_BASE_MODERN_XTERM ",cstyle,margins,sync"
+		  .features = TTY_FEATURES_BASE_MODERN_XTERM ",cstyle,hyperlinks,margins,sync"
 		},
 		{ .name = "XTerm",
 		  .features = TTY_FEATURES_BASE_MODERN_XTERM ",ccolour,cstyle,extkeys,focus,margins,rectfill"
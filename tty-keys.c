@@ -39,6 +39,7 @@
 
 static void	tty_keys_add1(struct tty_key **, const char *, key_code);
 static void	tty_keys_add(struct tty *, const char *, key_code);
+static void	tty_keys_index1(struct tty *, struct tty_key *);
 static void	tty_keys_free1(struct tty_key *);
 static struct tty_key *tty_keys_find1(struct tty_key *, const char *, size_t,
 		    size_t *);
@@ -53,6 +54,7 @@ static int	tty_keys_mouse(struct tty *, const char *, size_t, size_t *,
 		    struct mouse_event *);
 static int	tty_keys_clipboard(struct tty *, const char *, size_t,
 		    size_t *);
+static int	tty_keys_paste(struct tty *, const char *, size_t);
 static int	tty_keys_device_attributes(struct tty *, const char *, size_t,
 		    size_t *);
 static int	tty_keys_extended_device_attributes(struct tty *, const char *,
@@ -402,7 +404,8 @@ tty_keys_add(struct tty *tty, const char *s, key_code key)
 	const char     	*keystr;
 
 	keystr = key_string_lookup_key(key, 1);
-	if ((tk = tty_keys_find(tty, s, strlen(s), &size)) == NULL) {
+	size = 0;
+	if ((tk = tty_keys_find1(tty->key_tree, s, strlen(s), &size)) == NULL) {
 		log_debug("new key %s: 0x%llx (%s)", s, key, keystr);
 		tty_keys_add1(&tty->key_tree, s, key);
 	} else {
@@ -504,6 +507,24 @@ tty_keys_build(struct tty *tty)
 			a = options_array_next(a);
 		}
 	}
+
+	/*
+	 * Index the top level of the tree by first byte so lookups need not
+	 * walk it for every key.
+	 */
+	memset(tty->key_first, 0, sizeof tty->key_first);
+	tty_keys_index1(tty, tty->key_tree);
+}
+
+/* Fill the first byte dispatch table from the top level of the tree. */
+static void
+tty_keys_index1(struct tty *tty, struct tty_key *tk)
+{
+	if (tk == NULL)
+		return;
+	tty->key_first[(u_char)tk->ch] = tk;
+	tty_keys_index1(tty, tk->left);
+	tty_keys_index1(tty, tk->right);
 }
 
 /* Free the entire key tree. */
@@ -511,6 +532,7 @@ void
 tty_keys_free(struct tty *tty)
 {
 	tty_keys_free1(tty->key_tree);
+	memset(tty->key_first, 0, sizeof tty->key_first);
 }
 
 /* Free a single key. */
@@ -526,15 +548,43 @@ tty_keys_free1(struct tty_key *tk)
 	free(tk);
 }
 
-/* Lookup a key in the tree. */
+/*
+ * Lookup a key in the tree, dispatching on the first byte and then walking
+ * byte by byte without recursing.
+ */
 static struct tty_key *
 tty_keys_find(struct tty *tty, const char *buf, size_t len, size_t *size)
 {
+	struct tty_key	*tk;
+
 	*size = 0;
-	return (tty_keys_find1(tty->key_tree, buf, len, size));
+	if (len == 0)
+		return (NULL);
+	tk = tty->key_first[(u_char)*buf];
+	for (;;) {
+		if (tk == NULL)
+			return (NULL);
+
+		/* tk->ch matches *buf; move forward in the string. */
+		buf++; len--;
+		(*size)++;
+
+		/* At the end of the string, return the current node. */
+		if (len == 0 || (tk->next == NULL && tk->key != KEYC_UNKNOWN))
+			return (tk);
+
+		/* Descend for the following character. */
+		tk = tk->next;
+		while (tk != NULL && tk->ch != *buf) {
+			if (*buf < tk->ch)
+				tk = tk->left;
+			else
+				tk = tk->right;
+		}
+	}
 }
 
-/* Find the next node. */
+/* Find the next node, walking from the given node. */
 static struct tty_key *
 tty_keys_find1(struct tty_key *tk, const char *buf, size_t len, size_t *size)
 {
@@ -631,10 +681,11 @@ tty_keys_next(struct tty *tty)
 	struct timeval		 tv;
 	const char		*buf;
 	size_t			 len, size;
+	size_t			 size2;
 	cc_t			 bspace;
 	int			 delay, expired = 0, n;
 	key_code		 key;
-	struct mouse_event	 m = { 0 };
+	struct mouse_event	 m = { 0 }, m2;
 	struct key_event	*event;
 
 	gettimeofday(&tv, NULL);
@@ -646,6 +697,21 @@ tty_keys_next(struct tty *tty)
 		return (0);
 	log_debug("%s: keys are %zu (%.*s)", c->name, len, (int)len, buf);
 
+	/*
+	 * During a bracketed paste the data is passed through to the pane in
+	 * bulk rather than parsed byte-by-byte as keys.
+	 */
+	if (tty->flags & TTY_PASTING) {
+		switch (tty_keys_paste(tty, buf, len)) {
+		case 0:		/* can't pass through, parse as keys */
+			break;
+		case -1:	/* wait for the rest of the end marker */
+			return (0);
+		case 1:		/* data passed through */
+			return (1);
+		}
+	}
+
 	/* Is this a clipboard response? */
 	switch (tty_keys_clipboard(tty, buf, len, &size)) {
 	case 0:		/* yes */
@@ -683,6 +749,29 @@ tty_keys_next(struct tty *tty)
 	switch (tty_keys_mouse(tty, buf, len, &size, &m)) {
 	case 0:		/* yes */
 		key = KEYC_MOUSE;
+
+		/*
+		 * Collapse a run of drag events with the same buttons into
+		 * the last one, so dragging quickly does not pay for a full
+		 * key cycle at every intermediate position. The delivered
+		 * event keeps the last position from before the run.
+		 */
+		while (MOUSE_DRAG(m.b) && size < len &&
+		    tty_keys_mouse(tty, buf + size, len - size, &size2,
+		    &m2) == 0) {
+			if (m2.b != m.b) {
+				/* Not part of the run; replay it next time. */
+				tty->mouse_last_x = m.x;
+				tty->mouse_last_y = m.y;
+				tty->mouse_last_b = m.b;
+				break;
+			}
+			m2.lx = m.lx;
+			m2.ly = m.ly;
+			m2.lb = m.lb;
+			memcpy(&m, &m2, sizeof m);
+			size += size2;
+		}
 		goto complete_key;
 	case -1:	/* no, or not valid */
 		break;
@@ -808,6 +897,12 @@ complete_key:
 		return (1);
 	}
 
+	/* Between the paste keys, data is passed through to the pane. */
+	if (key == KEYC_PASTE_START)
+		tty->flags |= TTY_PASTING;
+	else if (key == KEYC_PASTE_END)
+		tty->flags &= ~TTY_PASTING;
+
 	/* Fire the key. */
 	if (key != KEYC_UNKNOWN) {
 		event = xmalloc(sizeof *event);
@@ -1086,7 +1181,7 @@ static int
 tty_keys_clipboard(__unused struct tty *tty, const char *buf, size_t len,
     size_t *size)
 {
-	size_t	 end, terminator, needed;
+	size_t	 end, terminator = 0, needed;
 	char	*copy, *out;
 	int	 outlen;
 
@@ -1165,6 +1260,86 @@ tty_keys_clipboard(__unused struct tty *tty, const char *buf, size_t len,
 	return (0);
 }
 
+/*
+ * Pass bracketed paste data through to the active pane in bulk, rather than
+ * parsing every byte as a key and queueing it individually. Returns 1 if
+ * some data was consumed, -1 if more data is needed (a possible end marker
+ * is split across reads) and 0 if the paste cannot be passed through and
+ * must be parsed as keys after all.
+ */
+static int
+tty_keys_paste(struct tty *tty, const char *buf, size_t len)
+{
+	struct client		*c = tty->client;
+	struct window_pane	*wp;
+	struct key_event	*event;
+	static const char	 marker[] = "\033[201~";
+	const size_t		 markerlen = sizeof marker - 1;
+	size_t			 off, left;
+	int			 end = 0;
+
+	/*
+	 * Find the pane taking the paste. If there is none, or the keys
+	 * would go somewhere that needs to see each one - the command
+	 * prompt, an overlay, a pane in a mode - fall back to key parsing.
+	 */
+	if (c->session == NULL ||
+	    (c->flags & (CLIENT_READONLY|CLIENT_UNATTACHEDFLAGS)) ||
+	    c->prompt_string != NULL ||
+	    c->overlay_key != NULL) {
+		tty->flags &= ~TTY_PASTING;
+		return (0);
+	}
+	wp = c->session->curw->window->active;
+	if (wp == NULL ||
+	    TAILQ_FIRST(&wp->modes) != NULL ||
+	    wp->fd == -1 ||
+	    (wp->flags & PANE_INPUTOFF)) {
+		tty->flags &= ~TTY_PASTING;
+		return (0);
+	}
+
+	/* Look for the end marker, or a prefix of it at the end. */
+	for (off = 0; off < len; off++) {
+		if (buf[off] != '\033')
+			continue;
+		left = len - off;
+		if (left >= markerlen) {
+			if (memcmp(buf + off, marker, markerlen) == 0) {
+				end = 1;
+				break;
+			}
+		} else if (memcmp(buf + off, marker, left) == 0)
+			break;
+	}
+
+	/*
+	 * Queue everything before the marker as a single item. It has to go
+	 * through the queue rather than straight to the pane so it stays
+	 * ordered with the paste start and end keys and any keys typed just
+	 * before the paste.
+	 */
+	if (off != 0) {
+		log_debug("%s: passing through %zu bytes of paste", c->name,
+		    off);
+		server_client_handle_paste(c, buf, off);
+		evbuffer_drain(tty->in, off);
+	}
+	if (!end)
+		return (off != 0 ? 1 : -1);
+
+	/* The end marker: stop pasting and fire the end key as normal. */
+	evbuffer_drain(tty->in, markerlen);
+	tty->flags &= ~TTY_PASTING;
+
+	event = xmalloc(sizeof *event);
+	event->key = KEYC_PASTE_END;
+	memset(&event->m, 0, sizeof event->m);
+	if (!server_client_handle_key(c, event))
+		free(event);
+	return (1);
+}
+
 /*
  * Handle secondary device attributes input. Returns 0 for success, -1 for
  * failure, 1 for partial.
@@ -1236,6 +1411,8 @@ tty_keys_device_attributes(struct tty *tty, const char *buf, size_t len,
 
 	tty_update_features(tty);
 	tty->flags |= TTY_HAVEDA;
+	if (tty->flags & TTY_HAVEXDA)
+		tty_features_cache_store(c);
 
 	return (0);
 }
@@ -1303,6 +1480,8 @@ tty_keys_extended_device_attributes(struct tty *tty, const char *buf,
 
 	tty_update_features(tty);
 	tty->flags |= TTY_HAVEXDA;
+	if (tty->flags & TTY_HAVEDA)
+		tty_features_cache_store(c);
 
 	return (0);
 }
@@ -31,9 +31,33 @@
 #include "tmux.h"
 
 static char	*tty_term_strip(const char *);
+static void	 tty_term_compile(struct tty_code *);
+static void	 tty_term_uncompile(struct tty_code *);
 
 struct tty_terms tty_terms = LIST_HEAD_INITIALIZER(tty_terms);
 
+/*
+ * Cache of terminfo(5) capabilities keyed by terminal name. setupterm(3)
+ * reads and parses the terminfo file each time it is called, so the first
+ * client with each TERM fills an entry here and later clients copy the
+ * capabilities instead of touching the database. Features and
+ * terminal-overrides are still applied per client on top of the shared
+ * base.
+ */
+struct tty_term_cache_entry {
+	char				*name;
+	struct tty_code			*codes;
+
+	LIST_ENTRY(tty_term_cache_entry) entry;
+};
+static LIST_HEAD(, tty_term_cache_entry) tty_term_cache =
+    LIST_HEAD_INITIALIZER(tty_term_cache);
+
+static void	 tty_term_cache_copy(struct tty_code *,
+		     const struct tty_code *);
+static struct tty_term_cache_entry *tty_term_cache_find(const char *);
+static void	 tty_term_cache_put(const char *, const struct tty_code *);
+
 enum tty_code_type {
 	TTYCODE_NONE = 0,
 	TTYCODE_STRING,
@@ -48,8 +72,30 @@ struct tty_code {
 		int		number;
 		int		flag;
 	} value;
+
+	/*
+	 * Most parameterized strings are literal text around one or two
+	 * numbers, so they are split into their literal parts when the
+	 * terminal is created and emitted with printf rather than running
+	 * tparm(3) on each use. Anything more complicated (conditionals in
+	 * setaf and so on) leaves compiled unset and falls back to tparm.
+	 */
+	int			compiled;
+	u_int			nparams;
+	int			add;	/* %i, added to each parameter */
+	char		       *pre;
+	char		       *mid;
+	char		       *post;
 };
 
+/*
+ * Buffer a compiled capability is expanded into. The literal parts and the
+ * worst-case digits for two int parameters ("-2147483648") must fit;
+ * tty_term_compile refuses anything longer.
+ */
+#define TTY_TERM_COMPILED_BUFFER 128
+#define TTY_TERM_COMPILED_DIGITS 11
+
 struct tty_term_code_entry {
 	enum tty_code_type	type;
 	const char	       *name;
@@ -316,6 +362,145 @@ tty_term_strip(const char *s)
 	return (xstrdup(buf));
 }
 
+/* Split a simple parameterized string into its literal parts. */
+static void
+tty_term_compile(struct tty_code *code)
+{
+	const char	*ptr;
+	char		 buf[8192], *parts[3] = { NULL, NULL, NULL };
+	size_t		 len = 0;
+	u_int		 n = 0, i;
+	int		 add = 0;
+
+	code->compiled = 0;
+	if (strchr(code->value.string, '%') == NULL)
+		return;
+
+	for (ptr = code->value.string; *ptr != '\0'; ptr++) {
+		if (len == (sizeof buf) - 1)
+			goto fail;
+		if (*ptr != '%') {
+			buf[len++] = *ptr;
+			continue;
+		}
+		ptr++;
+		switch (*ptr) {
+		case '%':
+			buf[len++] = '%';
+			break;
+		case 'i':
+			if (n != 0)
+				goto fail;
+			add = 1;
+			break;
+		case 'p':
+			if (n == 2 || ptr[1] != '1' + (int)n)
+				goto fail;
+			if (ptr[2] != '%' || ptr[3] != 'd')
+				goto fail;
+			ptr += 3;
+			buf[len] = '\0';
+			parts[n++] = xstrdup(buf);
+			len = 0;
+			break;
+		default:
+			goto fail;
+		}
+	}
+	if (n == 0)
+		goto fail;
+	buf[len] = '\0';
+	parts[n] = xstrdup(buf);
+
+	/*
+	 * The expansion buffer is a fixed size, so leave anything that might
+	 * not fit - possible with terminal-overrides - to tparm.
+	 */
+	len = strlen(parts[0]) + strlen(parts[1]);
+	if (parts[2] != NULL)
+		len += strlen(parts[2]);
+	if (len + 2 * TTY_TERM_COMPILED_DIGITS >= TTY_TERM_COMPILED_BUFFER)
+		goto fail;
+
+	code->pre = parts[0];
+	if (n == 2) {
+		code->mid = parts[1];
+		code->post = parts[2];
+	} else
+		code->post = parts[1];
+	code->nparams = n;
+	code->add = add;
+	code->compiled = 1;
+	return;
+
+fail:
+	for (i = 0; i < nitems(parts); i++)
+		free(parts[i]);
+}
+
+static void
+tty_term_uncompile(struct tty_code *code)
+{
+	free(code->pre);
+	free(code->mid);
+	free(code->post);
+	code->pre = code->mid = code->post = NULL;
+	code->nparams = 0;
+	code->add = 0;
+	code->compiled = 0;
+}
+
+/* Copy capabilities into a zeroed codes array, recompiling strings. */
+static void
+tty_term_cache_copy(struct tty_code *dst, const struct tty_code *src)
+{
+	u_int	i;
+
+	for (i = 0; i < tty_term_ncodes(); i++) {
+		dst[i].type = src[i].type;
+		switch (src[i].type) {
+		case TTYCODE_NONE:
+			break;
+		case TTYCODE_STRING:
+			dst[i].value.string = xstrdup(src[i].value.string);
+			tty_term_compile(&dst[i]);
+			break;
+		case TTYCODE_NUMBER:
+			dst[i].value.number = src[i].value.number;
+			break;
+		case TTYCODE_FLAG:
+			dst[i].value.flag = src[i].value.flag;
+			break;
+		}
+	}
+}
+
+static struct tty_term_cache_entry *
+tty_term_cache_find(const char *name)
+{
+	struct tty_term_cache_entry	*tce;
+
+	LIST_FOREACH(tce, &tty_term_cache, entry) {
+		if (strcmp(tce->name, name) == 0)
+			return (tce);
+	}
+	return (NULL);
+}
+
+static void
+tty_term_cache_put(const char *name, const struct tty_code *codes)
+{
+	struct tty_term_cache_entry	*tce;
+
+	tce = xcalloc(1, sizeof *tce);
+	tce->name = xstrdup(name);
+	tce->codes = xcalloc(tty_term_ncodes(), sizeof *tce->codes);
+	tty_term_cache_copy(tce->codes, codes);
+	LIST_INSERT_HEAD(&tty_term_cache, tce, entry);
+
+	log_debug("%s: cached terminfo for %s", __func__, name);
+}
+
 static char *
 tty_term_override_next(const char *s, size_t *offset)
 {
@@ -393,6 +578,8 @@ tty_term_apply(struct tty_term *term, const char *capabilities, int quiet)
 			code = &term->codes[i];
 
 			if (remove) {
+				if (code->type == TTYCODE_STRING)
+					tty_term_uncompile(code);
 				code->type = TTYCODE_NONE;
 				continue;
 			}
@@ -400,10 +587,13 @@ tty_term_apply(struct tty_term *term, const char *capabilities, int quiet)
 			case TTYCODE_NONE:
 				break;
 			case TTYCODE_STRING:
-				if (code->type == TTYCODE_STRING)
+				if (code->type == TTYCODE_STRING) {
+					tty_term_uncompile(code);
 					free(code->value.string);
+				}
 				code->value.string = xstrdup(value);
 				code->type = ent->type;
+				tty_term_compile(code);
 				break;
 			case TTYCODE_NUMBER:
 				n = strtonum(value, 0, INT_MAX, &errstr);
@@ -451,6 +641,7 @@ struct tty_term *
 tty_term_create(struct tty *tty, char *name, int *feat, int fd, char **cause)
 {
 	struct tty_term				*term;
+	struct tty_term_cache_entry		*tce;
 	const struct tty_term_code_entry	*ent;
 	struct tty_code				*code;
 	struct options_entry			*o;
@@ -470,58 +661,74 @@ tty_term_create(struct tty *tty, char *name, int *feat, int fd, char **cause)
 	term->codes = xcalloc(tty_term_ncodes(), sizeof *term->codes);
 	LIST_INSERT_HEAD(&tty_terms, term, entry);
 
-	/* Set up curses terminal. */
-	if (setupterm(name, fd, &error) != OK) {
-		switch (error) {
-		case 1:
-			xasprintf(cause, "can't use hardcopy terminal: %s",
-			    name);
-			break;
-		case 0:
-			xasprintf(cause, "missing or unsuitable terminal: %s",
-			    name);
-			break;
-		case -1:
-			xasprintf(cause, "can't find terminfo database");
-			break;
-		default:
-			xasprintf(cause, "unknown error");
-			break;
+	/* Use the cached capabilities if this terminal has been seen. */
+	tce = tty_term_cache_find(name);
+	if (tce != NULL)
+		tty_term_cache_copy(term->codes, tce->codes);
+	else {
+		/* Set up curses terminal. */
+		if (setupterm(name, fd, &error) != OK) {
+			switch (error) {
+			case 1:
+				xasprintf(cause, "can't use hardcopy terminal: %s",
+				    name);
+				break;
+			case 0:
+				xasprintf(cause, "missing or unsuitable terminal: %s",
+				    name);
+				break;
+			case -1:
+				xasprintf(cause, "can't find terminfo database");
+				break;
+			default:
+				xasprintf(cause, "unknown error");
+				break;
+			}
+			goto error;
 		}
-		goto error;
-	}
 
-	/* Fill in codes. */
-	for (i = 0; i < tty_term_ncodes(); i++) {
-		ent = &tty_term_codes[i];
+		/* Fill in codes. */
+		for (i = 0; i < tty_term_ncodes(); i++) {
+			ent = &tty_term_codes[i];
 
-		code = &term->codes[i];
-		code->type = TTYCODE_NONE;
-		switch (ent->type) {
-		case TTYCODE_NONE:
-			break;
-		case TTYCODE_STRING:
-			s = tigetstr((char *) ent->name);
-			if (s == NULL || s == (char *) -1)
+			code = &term->codes[i];
+			code->type = TTYCODE_NONE;
+			switch (ent->type) {
+			case TTYCODE_NONE:
 				break;
-			code->type = TTYCODE_STRING;
-			code->value.string = tty_term_strip(s);
-			break;
-		case TTYCODE_NUMBER:
-			n = tigetnum((char *) ent->name);
-			if (n == -1 || n == -2)
+			case TTYCODE_STRING:
+				s = tigetstr((char *) ent->name);
+				if (s == NULL || s == (char *) -1)
+					break;
+				code->type = TTYCODE_STRING;
+				code->value.string = tty_term_strip(s);
+				tty_term_compile(code);
 				break;
-			code->type = TTYCODE_NUMBER;
-			code->value.number = n;
-			break;
-		case TTYCODE_FLAG:
-			n = tigetflag((char *) ent->name);
-			if (n == -1)
+			case TTYCODE_NUMBER:
+				n = tigetnum((char *) ent->name);
+				if (n == -1 || n == -2)
+					break;
+				code->type = TTYCODE_NUMBER;
+				code->value.number = n;
 				break;
-			code->type = TTYCODE_FLAG;
-			code->value.flag = n;
-			break;
+			case TTYCODE_FLAG:
+				n = tigetflag((char *) ent->name);
+				if (n == -1)
+					break;
+				code->type = TTYCODE_FLAG;
+				code->value.flag = n;
+				break;
+			}
 		}
+
+		/* Delete curses data. */
+#if !defined(NCURSES_VERSION_MAJOR) || NCURSES_VERSION_MAJOR > 5 || \
+    (NCURSES_VERSION_MAJOR == 5 && NCURSES_VERSION_MINOR > 6)
+		del_curterm(cur_term);
+#endif
+
+		/* Cache for the next client with this terminal. */
+		tty_term_cache_put(name, term->codes);
 	}
 
 	/* Apply terminal features. */
@@ -538,12 +745,6 @@ tty_term_create(struct tty *tty, char *name, int *feat, int fd, char **cause)
 		a = options_array_next(a);
 	}
 
-	/* Delete curses data. */
-#if !defined(NCURSES_VERSION_MAJOR) || NCURSES_VERSION_MAJOR > 5 || \
-    (NCURSES_VERSION_MAJOR == 5 && NCURSES_VERSION_MINOR > 6)
-	del_curterm(cur_term);
-#endif
-
 	/* Apply overrides so any capabilities used for features are changed. */
 	tty_term_apply_overrides(term);
 
@@ -626,8 +827,10 @@ tty_term_free(struct tty_term *term)
 	log_debug("removing term %s", term->name);
 
 	for (i = 0; i < tty_term_ncodes(); i++) {
-		if (term->codes[i].type == TTYCODE_STRING)
+		if (term->codes[i].type == TTYCODE_STRING) {
+			tty_term_uncompile(&term->codes[i]);
 			free(term->codes[i].value.string);
+		}
 	}
 	free(term->codes);
 
@@ -655,12 +858,28 @@ tty_term_string(struct tty_term *term, enum tty_code_code code)
 const char *
 tty_term_string1(struct tty_term *term, enum tty_code_code code, int a)
 {
+	struct tty_code	*c = &term->codes[code];
+	static char	 buf[TTY_TERM_COMPILED_BUFFER];
+
+	if (c->compiled && c->nparams == 1) {
+		xsnprintf(buf, sizeof buf, "%s%d%s", c->pre, a + c->add,
+		    c->post);
+		return (buf);
+	}
 	return (tparm((char *) tty_term_string(term, code), a, 0, 0, 0, 0, 0, 0, 0, 0));
 }
 
 const char *
 tty_term_string2(struct tty_term *term, enum tty_code_code code, int a, int b)
 {
+	struct tty_code	*c = &term->codes[code];
+	static char	 buf[TTY_TERM_COMPILED_BUFFER];
+
+	if (c->compiled && c->nparams == 2) {
+		xsnprintf(buf, sizeof buf, "%s%d%s%d%s", c->pre, a + c->add,
+		    c->mid, b + c->add, c->post);
+		return (buf);
+	}
 	return (tparm((char *) tty_term_string(term, code), a, b, 0, 0, 0, 0, 0, 0, 0));
 }
 
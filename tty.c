@@ -45,6 +45,7 @@ static void	tty_cursor_pane_unless_wrap(struct tty *,
 		    const struct tty_ctx *, u_int, u_int);
 static void	tty_invalidate(struct tty *);
 static void	tty_colours(struct tty *, const struct grid_cell *);
+static void	tty_hyperlink(struct tty *, u_int);
 static void	tty_check_fg(struct tty *, int *, struct grid_cell *);
 static void	tty_check_bg(struct tty *, int *, struct grid_cell *);
 static void	tty_check_us(struct tty *, int *, struct grid_cell *);
@@ -68,14 +69,419 @@ static void	tty_draw_pane(struct tty *, const struct tty_ctx *, u_int);
 static void	tty_default_attributes(struct tty *, const struct grid_cell *,
 		    int *, u_int);
 
+static void	tty_measure_drain(struct client *);
+
+static int	tty_shadow_cmp(struct tty_shadow *, struct tty_shadow *);
+static uint64_t	tty_shadow_hash(struct screen *, u_int, u_int, u_int, u_int,
+		    const struct grid_cell *, int *);
+static int	tty_shadow_check(struct tty *, u_int, u_int, u_int, uint64_t);
+static int	tty_shadow_usable(struct tty *, u_int, u_int, u_int);
+static void	tty_shadow_dirty_row(struct tty *, u_int);
+static void	tty_shadow_flush(struct tty *);
+static void	tty_shadow_command(struct tty *,
+		    void (*)(struct tty *, const struct tty_ctx *),
+		    const struct tty_ctx *);
+static uint64_t	tty_shadow_row_hash(struct tty *, struct screen *, u_int,
+		    u_int, const struct grid_cell *, int *);
+
 #define tty_use_margin(tty) \
 	(tty->term->flags & TERM_DECSLRM)
 #define tty_full_width(tty, ctx) \
 	((ctx)->xoff == 0 && (ctx)->sx >= (tty)->sx)
 
 #define TTY_BLOCK_INTERVAL (100000 /* 100 milliseconds */)
-#define TTY_BLOCK_START(tty) (1 + ((tty)->sx * (tty)->sy) * 8)
-#define TTY_BLOCK_STOP(tty) (1 + ((tty)->sx * (tty)->sy) / 8)
+
+/*
+ * Shadow of the content most recently drawn at each terminal position by
+ * tty_draw_line(), stored as a hash of the source cells keyed by the segment
+ * position. A full redraw can then skip any line the terminal is already
+ * showing and only send the lines that differ - a refresh or a menu or popup
+ * closing repaints a handful of lines instead of the whole screen.
+ */
+struct tty_shadow {
+	u_int			 aty;
+	u_int			 atx;
+
+	u_int			 nx;
+	uint64_t		 hash;
+
+	RB_ENTRY(tty_shadow)	 entry;
+};
+
+static int
+tty_shadow_cmp(struct tty_shadow *ts1, struct tty_shadow *ts2)
+{
+	if (ts1->aty < ts2->aty)
+		return (-1);
+	if (ts1->aty > ts2->aty)
+		return (1);
+	if (ts1->atx < ts2->atx)
+		return (-1);
+	if (ts1->atx > ts2->atx)
+		return (1);
+	return (0);
+}
+RB_GENERATE_STATIC(tty_shadows, tty_shadow, entry, tty_shadow_cmp);
+
+/* Mix bytes into a shadow hash (FNV-1a). */
+static uint64_t
+tty_shadow_mix(uint64_t hash, const void *ptr, size_t len)
+{
+	const u_char	*p = ptr;
+	size_t		 i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return (hash);
+}
+
+/* Hash everything that determines what tty_draw_line will show. */
+static uint64_t
+tty_shadow_hash(struct screen *s, u_int px, u_int py, u_int sx, u_int nx,
+    const struct grid_cell *defaults, int *palette)
+{
+	struct grid_cell	 gc;
+	uint64_t		 hash = 0xcbf29ce484222325ULL;
+	u_int			 i;
+	int			 selected;
+
+	hash = tty_shadow_mix(hash, &nx, sizeof nx);
+	hash = tty_shadow_mix(hash, &defaults->attr, sizeof defaults->attr);
+	hash = tty_shadow_mix(hash, &defaults->flags, sizeof defaults->flags);
+	hash = tty_shadow_mix(hash, &defaults->fg, sizeof defaults->fg);
+	hash = tty_shadow_mix(hash, &defaults->bg, sizeof defaults->bg);
+	hash = tty_shadow_mix(hash, &defaults->us, sizeof defaults->us);
+	if (palette != NULL)
+		hash = tty_shadow_mix(hash, palette, 256 * sizeof *palette);
+
+	for (i = 0; i < sx; i++) {
+		grid_view_get_cell(s->grid, px + i, py, &gc);
+		selected = screen_check_selection(s, px + i, py);
+		hash = tty_shadow_mix(hash, &selected, sizeof selected);
+		hash = tty_shadow_mix(hash, &gc.attr, sizeof gc.attr);
+		hash = tty_shadow_mix(hash, &gc.flags, sizeof gc.flags);
+		hash = tty_shadow_mix(hash, &gc.fg, sizeof gc.fg);
+		hash = tty_shadow_mix(hash, &gc.bg, sizeof gc.bg);
+		hash = tty_shadow_mix(hash, &gc.us, sizeof gc.us);
+		hash = tty_shadow_mix(hash, &gc.link, sizeof gc.link);
+		hash = tty_shadow_mix(hash, &gc.data.width,
+		    sizeof gc.data.width);
+		hash = tty_shadow_mix(hash, gc.data.data, gc.data.size);
+	}
+	return (hash);
+}
+
+/*
+ * Look up the segment at atx,aty. Returns 1 if the terminal already shows
+ * this content and the draw can be skipped; otherwise records the new hash
+ * (evicting any segments it overlaps, for example a window line underneath
+ * where a menu is being drawn) and returns 0.
+ */
+static int
+tty_shadow_check(struct tty *tty, u_int atx, u_int aty, u_int nx,
+    uint64_t hash)
+{
+	struct tty_shadow	 find, *ts, *ts1, *found = NULL;
+
+	find.aty = aty;
+	find.atx = 0;
+	ts = RB_NFIND(tty_shadows, &tty->shadows, &find);
+	while (ts != NULL && ts->aty == aty) {
+		ts1 = RB_NEXT(tty_shadows, &tty->shadows, ts);
+		if (ts->atx == atx && ts->nx == nx)
+			found = ts;
+		else if (ts->atx < atx + nx && atx < ts->atx + ts->nx) {
+			RB_REMOVE(tty_shadows, &tty->shadows, ts);
+			free(ts);
+		}
+		ts = ts1;
+	}
+
+	if (found != NULL && found->hash == hash)
+		return (1);
+	if (found == NULL) {
+		found = xcalloc(1, sizeof *found);
+		found->aty = aty;
+		found->atx = atx;
+		found->nx = nx;
+		RB_INSERT(tty_shadows, &tty->shadows, found);
+	}
+	found->hash = hash;
+	return (0);
+}
+
+/*
+ * A segment can only be shadowed if no part of it is hidden by an overlay,
+ * since then the terminal does not show what was drawn.
+ */
+static int
+tty_shadow_usable(struct tty *tty, u_int atx, u_int aty, u_int nx)
+{
+	struct client	*c = tty->client;
+	u_int		 i;
+
+	if (c == NULL || c->overlay_check == NULL)
+		return (1);
+	for (i = 0; i < nx; i++) {
+		if (!c->overlay_check(c, atx + i, aty))
+			return (0);
+	}
+	return (1);
+}
+
+/* Forget what was drawn on one terminal row. */
+static void
+tty_shadow_dirty_row(struct tty *tty, u_int aty)
+{
+	struct tty_shadow	 find, *ts, *ts1;
+
+	find.aty = aty;
+	find.atx = 0;
+	ts = RB_NFIND(tty_shadows, &tty->shadows, &find);
+	while (ts != NULL && ts->aty == aty) {
+		ts1 = RB_NEXT(tty_shadows, &tty->shadows, ts);
+		RB_REMOVE(tty_shadows, &tty->shadows, ts);
+		free(ts);
+		ts = ts1;
+	}
+}
+
+/* Forget everything drawn on the terminal. */
+static void
+tty_shadow_flush(struct tty *tty)
+{
+	struct tty_shadow	*ts, *ts1;
+
+	RB_FOREACH_SAFE(ts, tty_shadows, &tty->shadows, ts1) {
+		RB_REMOVE(tty_shadows, &tty->shadows, ts);
+		free(ts);
+	}
+}
+
+/*
+ * Update the shadow after a command has written to the terminal. Cell writes
+ * and in-line clears only touch one row; anything else (scrolls, screen
+ * clears, raw strings) can move content arbitrarily, so forget everything.
+ */
+static void
+tty_shadow_command(struct tty *tty,
+    void (*cmdfn)(struct tty *, const struct tty_ctx *),
+    const struct tty_ctx *ctx)
+{
+	if (cmdfn == tty_cmd_setselection || cmdfn == tty_cmd_syncstart)
+		return;
+	if ((cmdfn == tty_cmd_cell ||
+	    cmdfn == tty_cmd_cells ||
+	    cmdfn == tty_cmd_clearcharacter ||
+	    cmdfn == tty_cmd_clearendofline ||
+	    cmdfn == tty_cmd_clearstartofline ||
+	    cmdfn == tty_cmd_clearline ||
+	    cmdfn == tty_cmd_insertcharacter ||
+	    cmdfn == tty_cmd_deletecharacter) && !ctx->bigger)
+		tty_shadow_dirty_row(tty, ctx->yoff + ctx->ocy - ctx->woy);
+	else
+		tty_shadow_flush(tty);
+}
+
+/* Hash one screen row exactly as tty_draw_line() would shadow it. */
+static uint64_t
+tty_shadow_row_hash(struct tty *tty, struct screen *s, u_int py, u_int nx,
+    const struct grid_cell *defaults, int *palette)
+{
+	u_int	sx = screen_size_x(s), cellsize;
+
+	cellsize = grid_get_line(s->grid, s->grid->hsize + py)->cellsize;
+	if (sx > cellsize)
+		sx = cellsize;
+	if (sx > tty->sx)
+		sx = tty->sx;
+	if (sx > nx)
+		sx = nx;
+	return (tty_shadow_hash(s, 0, py, sx, nx, defaults, palette));
+}
+
+/*
+ * Before a full-pane redraw, look for rows whose new content is what the
+ * terminal is already showing a few rows lower or higher - the signature of
+ * an application that scrolled by repainting every line instead of using a
+ * scroll region. Emitting one real scroll first moves the matching rows into
+ * place, the shadow is shifted with them, and the per-line check in
+ * tty_draw_line() then skips everything except the rows that truly changed.
+ */
+void
+tty_infer_scroll(struct tty *tty, struct screen *s, u_int nx, u_int atx,
+    u_int aty, u_int ny, const struct grid_cell *defaults, int *palette)
+{
+	struct tty_shadow	  find, *ts, *ts1, **moved;
+	uint64_t		 *new, *old, blank;
+	u_char			 *known;
+	u_int			  j, k, nonblank = 0, base = 0, best = 0;
+	u_int			  bestk = 0, n, nmoved = 0;
+	int			  down = 0, can_down;
+
+	if (ny < 4 || nx < 2)
+		return;
+	if (atx + nx > tty->sx || aty + ny > tty->sy)
+		return;
+	if (!tty_term_has(tty->term, TTYC_CSR))
+		return;
+	if ((atx != 0 || nx < tty->sx) && !tty_use_margin(tty))
+		return;
+	for (j = 0; j < ny; j++) {
+		if (!tty_shadow_usable(tty, atx, aty + j, nx))
+			return;
+	}
+	can_down = tty_term_has(tty->term, TTYC_RI) ||
+	    tty_term_has(tty->term, TTYC_RIN);
+
+	/*
+	 * Hash what each row will show and what the terminal shadow says it
+	 * showed last. Rows with no shadow entry are unknown and never match.
+	 * Rows past the written cells hash identically whatever line they
+	 * came from, so note the all-blank hash and keep such rows out of
+	 * the vote below - trailing blank lines should not pick the shift.
+	 */
+	new = xreallocarray(NULL, ny, sizeof *new);
+	old = xreallocarray(NULL, ny, sizeof *old);
+	known = xcalloc(ny, sizeof *known);
+	moved = xreallocarray(NULL, ny, sizeof *moved);
+
+	blank = tty_shadow_hash(s, 0, 0, 0, nx, defaults, palette);
+	for (j = 0; j < ny; j++) {
+		new[j] = tty_shadow_row_hash(tty, s, j, nx, defaults,
+		    palette);
+		if (new[j] != blank)
+			nonblank++;
+	}
+	find.atx = 0;
+	find.aty = aty;
+	ts = RB_NFIND(tty_shadows, &tty->shadows, &find);
+	for (; ts != NULL && ts->aty < aty + ny; ts = ts1) {
+		ts1 = RB_NEXT(tty_shadows, &tty->shadows, ts);
+		if (ts->atx == atx && ts->nx == nx) {
+			old[ts->aty - aty] = ts->hash;
+			known[ts->aty - aty] = 1;
+		}
+	}
+	if (nonblank < 4)
+		goto out;
+
+	/* How many rows are already right with no scroll at all? */
+	for (j = 0; j < ny; j++) {
+		if (known[j] && new[j] != blank && new[j] == old[j])
+			base++;
+	}
+
+	/* Try each shift in both directions and keep the best. */
+	for (k = 1; k < ny; k++) {
+		n = 0;
+		for (j = 0; j < ny - k; j++) {
+			if (known[j + k] &&
+			    new[j] != blank &&
+			    new[j] == old[j + k])
+				n++;
+		}
+		if (n > best) {
+			best = n;
+			bestk = k;
+			down = 0;
+		}
+		if (!can_down)
+			continue;
+		n = 0;
+		for (j = k; j < ny; j++) {
+			if (known[j - k] &&
+			    new[j] != blank &&
+			    new[j] == old[j - k])
+				n++;
+		}
+		if (n > best) {
+			best = n;
+			bestk = k;
+			down = 1;
+		}
+	}
+	if (best < base + 2 || best - base < nonblank / 2)
+		goto out;
+	log_debug("%s: scroll %s %u at %u-%u (%u of %u rows match, %u now)",
+	    __func__, down ? "down" : "up", bestk, aty, aty + ny - 1, best,
+	    nonblank, base);
+
+	/* Scroll the region, exactly as tty_cmd_scrollup/scrolldown do. */
+	tty_default_attributes(tty, defaults, palette, 8);
+	tty_region(tty, aty, aty + ny - 1);
+	tty_margin(tty, atx, atx + nx - 1);
+	if (!down) {
+		if (bestk == 1 || !tty_term_has(tty->term, TTYC_INDN)) {
+			if (!tty_use_margin(tty))
+				tty_cursor(tty, 0, tty->rlower);
+			else
+				tty_cursor(tty, tty->rright, tty->rlower);
+			for (j = 0; j < bestk; j++)
+				tty_putc(tty, '\n');
+		} else {
+			if (tty->cy == UINT_MAX)
+				tty_cursor(tty, 0, 0);
+			else
+				tty_cursor(tty, 0, tty->cy);
+			tty_putcode1(tty, TTYC_INDN, bestk);
+		}
+	} else {
+		tty_cursor(tty, atx, tty->rupper);
+		if (tty_term_has(tty->term, TTYC_RIN))
+			tty_putcode1(tty, TTYC_RIN, bestk);
+		else {
+			for (j = 0; j < bestk; j++)
+				tty_putcode(tty, TTYC_RI);
+		}
+	}
+
+	/*
+	 * Move the shadow entries inside the region with the content.
+	 * Segments wholly outside the scrolled columns keep their place;
+	 * anything straddling the edge or scrolled out of the region is
+	 * forgotten, as are the rows the scroll exposed.
+	 */
+	find.atx = 0;
+	find.aty = aty;
+	ts = RB_NFIND(tty_shadows, &tty->shadows, &find);
+	for (; ts != NULL && ts->aty < aty + ny; ts = ts1) {
+		ts1 = RB_NEXT(tty_shadows, &tty->shadows, ts);
+		if (ts->atx + ts->nx <= atx || ts->atx >= atx + nx)
+			continue;
+		RB_REMOVE(tty_shadows, &tty->shadows, ts);
+		if (ts->atx < atx || ts->atx + ts->nx > atx + nx) {
+			free(ts);
+			continue;
+		}
+		if (!down) {
+			if (ts->aty < aty + bestk) {
+				free(ts);
+				continue;
+			}
+			ts->aty -= bestk;
+		} else {
+			if (ts->aty + bestk >= aty + ny) {
+				free(ts);
+				continue;
+			}
+			ts->aty += bestk;
+		}
+		moved[nmoved++] = ts;
+	}
+	for (j = 0; j < nmoved; j++) {
+		if (RB_INSERT(tty_shadows, &tty->shadows, moved[j]) != NULL)
+			free(moved[j]);
+	}
+
+out:
+	free(moved);
+	free(known);
+	free(old);
+	free(new);
+}
 
 void
 tty_create_log(void)
@@ -103,6 +509,10 @@ tty_init(struct tty *tty, struct client *c, int fd)
 	tty->cstyle = 0;
 	tty->ccolour = xstrdup("");
 
+	tty->acs_needed = -1;
+
+	RB_INIT(&tty->shadows);
+
 	return (0);
 }
 
@@ -172,6 +582,44 @@ tty_read_callback(__unused int fd, __unused short events, void *data)
 		;
 }
 
+/*
+ * How much output may be buffered before the client is declared too far
+ * behind and discarding starts, and how much may be produced per interval
+ * while blocked before it is safe to resume. Once the drain rate has been
+ * measured these are time budgets: a backlog worth more than half a second
+ * of writing means frames are being produced faster than the terminal can
+ * take them, and resuming is only useful once production per interval fits
+ * in what drains in an interval. Before the first measurement fall back to
+ * multiples of the screen size, as a stand-in for the cost of a full frame.
+ */
+static size_t
+tty_block_start(struct tty *tty)
+{
+	struct client	*c = tty->client;
+	size_t		 frame = 1 + (size_t)tty->sx * tty->sy, size;
+
+	if (c == NULL || c->redraw_bps == 0)
+		return (frame * 8);
+	size = c->redraw_bps / 2;	/* 500 milliseconds of drain */
+	if (size < frame)
+		size = frame;
+	return (size);
+}
+
+static size_t
+tty_block_stop(struct tty *tty)
+{
+	struct client	*c = tty->client;
+	size_t		 frame = 1 + (size_t)tty->sx * tty->sy, size;
+
+	if (c == NULL || c->redraw_bps == 0)
+		return (1 + frame / 8);
+	size = c->redraw_bps / 10;	/* one interval of drain */
+	if (size < 1 + frame / 8)
+		size = 1 + frame / 8;
+	return (size);
+}
+
 static void
 tty_timer_callback(__unused int fd, __unused short events, void *data)
 {
@@ -184,7 +632,7 @@ tty_timer_callback(__unused int fd, __unused short events, void *data)
 	c->flags |= CLIENT_ALLREDRAWFLAGS;
 	c->discarded += tty->discarded;
 
-	if (tty->discarded < TTY_BLOCK_STOP(tty)) {
+	if (tty->discarded < tty_block_stop(tty)) {
 		tty->flags &= ~TTY_BLOCK;
 		tty_invalidate(tty);
 		return;
@@ -200,7 +648,7 @@ tty_block_maybe(struct tty *tty)
 	size_t		 size = EVBUFFER_LENGTH(tty->out);
 	struct timeval	 tv = { .tv_usec = TTY_BLOCK_INTERVAL };
 
-	if (size < TTY_BLOCK_START(tty))
+	if (size < tty_block_start(tty))
 		return (0);
 
 	if (tty->flags & TTY_BLOCK)
@@ -217,6 +665,50 @@ tty_block_maybe(struct tty *tty)
 	return (1);
 }
 
+/*
+ * The last full redraw has drained, so measure how fast this client accepts
+ * output. server_client_check_redraw() uses the rate to avoid producing full
+ * frames faster than the client can consume them.
+ */
+static void
+tty_measure_drain(struct client *c)
+{
+	struct timeval	now, since;
+	uint64_t	usec, bps;
+
+	if (c->redraw_size == 0)
+		return;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &c->redraw_time, &since);
+	usec = (uint64_t)since.tv_sec * 1000000 + since.tv_usec;
+	if (usec == 0)
+		return;
+
+	bps = (uint64_t)c->redraw_size * 1000000 / usec;
+	if (c->redraw_bps == 0)
+		c->redraw_bps = bps;
+	else
+		c->redraw_bps = (7 * c->redraw_bps + bps) / 8;
+	log_debug("%s: drained %zu bytes in %llu usec, %llu bytes/second",
+	    c->name, c->redraw_size, (unsigned long long)usec,
+	    (unsigned long long)c->redraw_bps);
+}
+
+/* Report the flush stage of a traced redraw now it has drained. */
+static void
+tty_trace_flush(struct client *c)
+{
+	struct timeval	now, since;
+	uint64_t	usec;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &c->redraw_time, &since);
+	usec = (uint64_t)since.tv_sec * 1000000 + since.tv_usec;
+	server_add_message("%s redraw trace: flushed %zu bytes in %lluus",
+	    c->name, c->redraw_size, (unsigned long long)usec);
+}
+
 static void
 tty_write_callback(__unused int fd, __unused short events, void *data)
 {
@@ -229,11 +721,17 @@ tty_write_callback(__unused int fd, __unused short events, void *data)
 	if (nwrite == -1)
 		return;
 	log_debug("%s: wrote %d bytes (of %zu)", c->name, nwrite, size);
+	log_record("tty %s: wrote %d of %zu bytes", c->name, nwrite, size);
 
 	if (c->redraw > 0) {
-		if ((size_t)nwrite >= c->redraw)
+		if ((size_t)nwrite >= c->redraw) {
 			c->redraw = 0;
-		else
+			tty_measure_drain(c);
+			if (c->redraw_trace == 2) {
+				c->redraw_trace = 0;
+				tty_trace_flush(c);
+			}
+		} else
 			c->redraw -= nwrite;
 		log_debug("%s: waiting for redraw, %zu bytes left", c->name,
 		    c->redraw);
@@ -256,11 +754,13 @@ tty_open(struct tty *tty, char **cause)
 		return (-1);
 	}
 	tty->flags |= TTY_OPENED;
+	tty->acs_needed = -1;
 
 	tty->flags &= ~(TTY_NOCURSOR|TTY_FREEZE|TTY_BLOCK|TTY_TIMER);
 
 	event_set(&tty->event_in, tty->fd, EV_PERSIST|EV_READ,
 	    tty_read_callback, tty);
+	event_priority_set(&tty->event_in, 0);
 	tty->in = evbuffer_new();
 	if (tty->in == NULL)
 		fatal("out of memory");
@@ -286,8 +786,17 @@ tty_start_timer_callback(__unused int fd, __unused short events, void *data)
 	struct client	*c = tty->client;
 
 	log_debug("%s: start timer fired", c->name);
-	if ((tty->flags & (TTY_HAVEDA|TTY_HAVEXDA)) == 0)
-		tty_update_features(tty);
+	if ((tty->flags & (TTY_HAVEDA|TTY_HAVEXDA)) !=
+	    (TTY_HAVEDA|TTY_HAVEXDA)) {
+		if ((tty->flags & (TTY_HAVEDA|TTY_HAVEXDA)) == 0)
+			tty_update_features(tty);
+
+		/*
+		 * Remember that this terminal did not answer so the next
+		 * attach need not wait for the timer again.
+		 */
+		tty_features_cache_store(c);
+	}
 	tty->flags |= (TTY_HAVEDA|TTY_HAVEXDA);
 }
 
@@ -348,10 +857,24 @@ tty_start_tty(struct tty *tty)
 void
 tty_send_requests(struct tty *tty)
 {
+	struct client	*c = tty->client;
+
 	if (~tty->flags & TTY_STARTED)
 		return;
 
 	if (tty->term->flags & TERM_VT100LIKE) {
+		/*
+		 * If this terminal has been seen before, use the cached
+		 * detection results instead of waiting for the responses
+		 * (or for the timer, if it never answers).
+		 */
+		if ((tty->flags & (TTY_HAVEDA|TTY_HAVEXDA)) !=
+		    (TTY_HAVEDA|TTY_HAVEXDA) &&
+		    tty_features_cache_get(c)) {
+			tty_update_features(tty);
+			tty->flags |= (TTY_HAVEDA|TTY_HAVEXDA);
+			return;
+		}
 		if (~tty->flags & TTY_HAVEDA)
 			tty_puts(tty, "\033[>c");
 		if (~tty->flags & TTY_HAVEXDA)
@@ -451,6 +974,7 @@ void
 tty_free(struct tty *tty)
 {
 	tty_close(tty);
+	tty_shadow_flush(tty);
 	free(tty->ccolour);
 }
 
@@ -461,6 +985,7 @@ tty_update_features(struct tty *tty)
 
 	if (tty_apply_features(tty->term, c->term_features))
 		tty_term_apply_overrides(tty->term);
+	tty->acs_needed = -1;
 
 	if (tty_use_margin(tty))
 		tty_putcode(tty, TTYC_ENMG);
@@ -550,6 +1075,7 @@ tty_add(struct tty *tty, const char *buf, size_t len)
 	evbuffer_add(tty->out, buf, len);
 	log_debug("%s: %.*s", c->name, (int)len, buf);
 	c->written += len;
+	server_perf.tty_bytes += len;
 
 	if (tty_log_fd != -1)
 		write(tty_log_fd, buf, len);
@@ -1267,6 +1793,22 @@ tty_check_codeset(struct tty *tty, const struct grid_cell *gc)
 	return (&new);
 }
 
+/*
+ * Check if a cell is a blank space on which the foreground and underline
+ * colours are invisible, so that runs differing only in those do not need to
+ * be flushed separately.
+ */
+static int
+tty_cell_blank(const struct grid_cell *gc)
+{
+	if (gc->data.size != 1 || *gc->data.data != ' ')
+		return (0);
+	if (gc->attr & (GRID_ATTR_ALL_UNDERSCORE|GRID_ATTR_REVERSE|
+	    GRID_ATTR_STRIKETHROUGH|GRID_ATTR_OVERLINE|GRID_ATTR_CHARSET))
+		return (0);
+	return (1);
+}
+
 static int
 tty_check_overlay(struct tty *tty, u_int px, u_int py)
 {
@@ -1277,12 +1819,12 @@ tty_check_overlay(struct tty *tty, u_int px, u_int py)
 	return (c->overlay_check(c, px, py));
 }
 
-void
+int
 tty_draw_line(struct tty *tty, struct screen *s, u_int px, u_int py, u_int nx,
     u_int atx, u_int aty, const struct grid_cell *defaults, int *palette)
 {
 	struct grid		*gd = s->grid;
-	struct grid_cell	 gc, last;
+	struct grid_cell	 gc, sgc, last;
 	const struct grid_cell	*gcp;
 	struct grid_line	*gl;
 	u_int			 i, j, ux, sx, width;
@@ -1290,6 +1832,7 @@ tty_draw_line(struct tty *tty, struct screen *s, u_int px, u_int py, u_int nx,
 	char			 buf[512];
 	size_t			 len;
 	u_int			 cellsize;
+	uint64_t		 hash;
 
 	log_debug("%s: px=%u py=%u nx=%u atx=%u aty=%u", __func__,
 	    px, py, nx, atx, aty);
@@ -1323,6 +1866,21 @@ tty_draw_line(struct tty *tty, struct screen *s, u_int px, u_int py, u_int nx,
 		sx = nx;
 	ux = 0;
 
+	/*
+	 * If the terminal is already showing exactly this content at this
+	 * position, there is nothing to send.
+	 */
+	if (tty_shadow_usable(tty, atx, aty, nx)) {
+		hash = tty_shadow_hash(s, px, py, sx, nx, defaults, palette);
+		if (tty_shadow_check(tty, atx, aty, nx, hash)) {
+			log_debug("%s: %u,%u unchanged", __func__, atx, aty);
+			tty->flags = (tty->flags & ~TTY_NOCURSOR) | flags;
+			tty_update_mode(tty, tty->mode, s);
+			return (0);
+		}
+	} else
+		tty_shadow_dirty_row(tty, aty);
+
 	if (py == 0)
 		gl = NULL;
 	else
@@ -1353,7 +1911,33 @@ tty_draw_line(struct tty *tty, struct screen *s, u_int px, u_int py, u_int nx,
 
 	for (i = 0; i < sx; i++) {
 		grid_view_get_cell(gd, px + i, py, &gc);
+		if (screen_check_selection(s, px + i, py)) {
+			screen_select_cell(s, &sgc, &gc);
+			memcpy(&gc, &sgc, sizeof gc);
+		}
 		gcp = tty_check_codeset(tty, &gc);
+
+		/*
+		 * If this cell is a blank space, the foreground and underline
+		 * colours make no difference, so take them from the previous
+		 * cell rather than breaking the run to change attributes
+		 * invisibly.
+		 */
+		if (len != 0 &&
+		    gcp->attr == last.attr &&
+		    gcp->bg == last.bg &&
+		    gcp->flags == last.flags &&
+		    gcp->link == last.link &&
+		    (gcp->fg != last.fg || gcp->us != last.us) &&
+		    tty_cell_blank(gcp)) {
+			if (gcp != &gc) {
+				memcpy(&gc, gcp, sizeof gc);
+				gcp = &gc;
+			}
+			gc.fg = last.fg;
+			gc.us = last.us;
+		}
+
 		if (len != 0 &&
 		    (!tty_check_overlay(tty, atx + ux + width, aty) ||
 		    (gcp->attr & GRID_ATTR_CHARSET) ||
@@ -1362,6 +1946,7 @@ tty_draw_line(struct tty *tty, struct screen *s, u_int px, u_int py, u_int nx,
 		    gcp->fg != last.fg ||
 		    gcp->bg != last.bg ||
 		    gcp->us != last.us ||
+		    gcp->link != last.link ||
 		    ux + width + gcp->data.width > nx ||
 		    (sizeof buf) - len < gcp->data.size)) {
 			tty_attributes(tty, &last, defaults, palette);
@@ -1381,10 +1966,7 @@ tty_draw_line(struct tty *tty, struct screen *s, u_int px, u_int py, u_int nx,
 			wrapped = 0;
 		}
 
-		if (gcp->flags & GRID_FLAG_SELECTED)
-			screen_select_cell(s, &last, gcp);
-		else
-			memcpy(&last, gcp, sizeof last);
+		memcpy(&last, gcp, sizeof last);
 		if (!tty_check_overlay(tty, atx + ux, aty))
 			ux += gcp->data.width;
 		else if (ux + gcp->data.width > nx) {
@@ -1431,6 +2013,40 @@ tty_draw_line(struct tty *tty, struct screen *s, u_int px, u_int py, u_int nx,
 
 	tty->flags = (tty->flags & ~TTY_NOCURSOR) | flags;
 	tty_update_mode(tty, tty->mode, s);
+	return (1);
+}
+
+/* Replay any image placements anchored on a line which has been drawn. */
+void
+tty_draw_images(struct tty *tty, struct screen *s, u_int py, u_int atx,
+    u_int aty)
+{
+	struct grid	*gd = s->grid;
+	struct image	*img;
+	const char	*data;
+	size_t		 size;
+
+	if (~tty->term->flags & TERM_SIXEL)
+		return;
+	if (gd->images == NULL)
+		return;
+
+	TAILQ_FOREACH(img, gd->images, entry) {
+		if (img->py != gd->hsize + py)
+			continue;
+		if (atx + img->px >= tty->sx)
+			continue;
+		data = image_data(img, &size);
+		log_debug("%s: %zu bytes at %u,%u", __func__, size,
+		    atx + img->px, aty);
+
+		tty_region_off(tty);
+		tty_margin_off(tty);
+		tty_cursor(tty, atx + img->px, aty);
+
+		tty_add(tty, data, size);
+		tty_invalidate(tty);
+	}
 }
 
 void
@@ -1475,15 +2091,143 @@ tty_client_ready(struct client *c)
 	return (1);
 }
 
+/* State a tty is in before a command is encoded for it. */
+struct tty_write_state {
+	u_int		 cx;
+	u_int		 cy;
+	u_int		 cstyle;
+	char		 ccolour[64];
+	int		 valid;
+
+	u_int		 rupper;
+	u_int		 rlower;
+	u_int		 rleft;
+	u_int		 rright;
+
+	int		 mode;
+	int		 flags;
+
+	struct grid_cell cell;
+	struct grid_cell last_cell;
+};
+
+/* Save the parts of a tty's state that command encoders read and change. */
+static void
+tty_write_save(struct tty_write_state *st, struct tty *a)
+{
+	st->cx = a->cx;
+	st->cy = a->cy;
+	st->cstyle = a->cstyle;
+	st->valid = (strlcpy(st->ccolour, a->ccolour,
+	    sizeof st->ccolour) < sizeof st->ccolour);
+
+	st->rupper = a->rupper;
+	st->rlower = a->rlower;
+	st->rleft = a->rleft;
+	st->rright = a->rright;
+
+	st->mode = a->mode;
+	st->flags = a->flags;
+
+	memcpy(&st->cell, &a->cell, sizeof st->cell);
+	memcpy(&st->last_cell, &a->last_cell, sizeof st->last_cell);
+}
+
+/*
+ * Check if bytes already encoded for tty a would have come out identical on
+ * tty b, so they can be copied instead of encoded again. b is compared with
+ * the state a was in before the command (a has changed since), plus the
+ * fixed per-client properties the encoders read: terminal type and features,
+ * size and status line position. Overlays rule a client out because they
+ * censor output per client.
+ */
+static int
+tty_write_mirror(struct tty_write_state *st, struct tty *a, struct tty *b)
+{
+	if (!st->valid)
+		return (0);
+	if (strcmp(a->term->name, b->term->name) != 0 ||
+	    a->client->term_features != b->client->term_features)
+		return (0);
+	if (a->sx != b->sx || a->sy != b->sy ||
+	    a->xpixel != b->xpixel || a->ypixel != b->ypixel)
+		return (0);
+	if (status_at_line(a->client) != status_at_line(b->client) ||
+	    status_line_size(a->client) != status_line_size(b->client))
+		return (0);
+	if (a->client->overlay_check != NULL ||
+	    b->client->overlay_check != NULL)
+		return (0);
+	if (st->cx != b->cx ||
+	    st->cy != b->cy ||
+	    st->cstyle != b->cstyle ||
+	    strcmp(st->ccolour, b->ccolour) != 0)
+		return (0);
+	if (st->rupper != b->rupper ||
+	    st->rlower != b->rlower ||
+	    st->rleft != b->rleft ||
+	    st->rright != b->rright)
+		return (0);
+	if (st->mode != b->mode || st->flags != b->flags)
+		return (0);
+	if (memcmp(&st->cell, &b->cell, sizeof st->cell) != 0 ||
+	    memcmp(&st->last_cell, &b->last_cell, sizeof st->last_cell) != 0)
+		return (0);
+	return (1);
+}
+
+/*
+ * Copy bytes already encoded for tty a to tty b, with the same bookkeeping
+ * as tty_add, and bring b's software state up to date with a's. b was in the
+ * same state a was in before the command was encoded, so afterwards b
+ * matches a exactly.
+ */
+static void
+tty_write_mirror_copy(struct tty *b, struct tty *a, const char *buf,
+    size_t len)
+{
+	struct client	*c = b->client;
+
+	evbuffer_add(b->out, buf, len);
+	log_debug("%s: %.*s (mirrored)", c->name, (int)len, buf);
+	c->written += len;
+	server_perf.tty_bytes += len;
+
+	if (tty_log_fd != -1)
+		write(tty_log_fd, buf, len);
+	if (b->flags & TTY_STARTED)
+		event_add(&b->event_out, NULL);
+
+	b->cx = a->cx;
+	b->cy = a->cy;
+	b->cstyle = a->cstyle;
+	if (strcmp(b->ccolour, a->ccolour) != 0) {
+		free(b->ccolour);
+		b->ccolour = xstrdup(a->ccolour);
+	}
+	b->rupper = a->rupper;
+	b->rlower = a->rlower;
+	b->rleft = a->rleft;
+	b->rright = a->rright;
+	b->mode = a->mode;
+	b->flags = a->flags;
+	memcpy(&b->cell, &a->cell, sizeof b->cell);
+	memcpy(&b->last_cell, &a->last_cell, sizeof b->last_cell);
+}
+
 void
 tty_write(void (*cmdfn)(struct tty *, const struct tty_ctx *),
     struct tty_ctx *ctx)
 {
-	struct client	*c;
-	int		 state;
+	struct client		*c, *last = NULL;
+	struct tty_write_state	 st;
+	int			 state, bigger = 0;
+	u_int			 wox = 0, woy = 0, wsx = 0, wsy = 0;
+	size_t			 before = 0, added = 0;
 
 	if (ctx->set_client_cb == NULL)
 		return;
+	server_perf.tty_writes++;
 	TAILQ_FOREACH(c, &clients, entry) {
 		if (!tty_client_ready(c))
 			continue;
@@ -1492,7 +2236,45 @@ tty_write(void (*cmdfn)(struct tty *, const struct tty_ctx *),
 			break;
 		if (state == 0)
 			continue;
+
+		/*
+		 * Begin a synchronized update for the first command in this
+		 * batch; it is ended by server_client_reset_state() once the
+		 * event loop has processed all the queued output, so the
+		 * terminal composites each batch as a single frame.
+		 */
+		tty_sync_start(&c->tty);
+
+		/*
+		 * If this client sees the same part of the window as the last
+		 * one encoded and its tty is in an identical state, the bytes
+		 * must come out the same, so copy them instead of encoding
+		 * again. With many same-sized read-only clients mirroring one
+		 * session this does the encode work once rather than once per
+		 * client.
+		 */
+		if (last != NULL && added != 0 &&
+		    ctx->bigger == bigger &&
+		    ctx->wox == wox && ctx->woy == woy &&
+		    ctx->wsx == wsx && ctx->wsy == wsy &&
+		    tty_write_mirror(&st, &last->tty, &c->tty)) {
+			tty_write_mirror_copy(&c->tty, &last->tty,
+			    EVBUFFER_DATA(last->tty.out) + before, added);
+			tty_shadow_command(&c->tty, cmdfn, ctx);
+			continue;
+		}
+
+		tty_write_save(&st, &c->tty);
+		before = EVBUFFER_LENGTH(c->tty.out);
 		cmdfn(&c->tty, ctx);
+		added = EVBUFFER_LENGTH(c->tty.out) - before;
+		tty_shadow_command(&c->tty, cmdfn, ctx);
+		last = c;
+		bigger = ctx->bigger;
+		wox = ctx->wox;
+		woy = ctx->woy;
+		wsx = ctx->wsx;
+		wsy = ctx->wsy;
 	}
 }
 
@@ -1556,9 +2338,10 @@ tty_cmd_clearcharacter(struct tty *tty, const struct tty_ctx *ctx)
 void
 tty_cmd_insertline(struct tty *tty, const struct tty_ctx *ctx)
 {
+	u_int	i;
+
 	if (ctx->bigger ||
 	    !tty_full_width(tty, ctx) ||
-	    tty_fake_bce(tty, &ctx->defaults, ctx->bg) ||
 	    !tty_term_has(tty->term, TTYC_CSR) ||
 	    !tty_term_has(tty->term, TTYC_IL1) ||
 	    ctx->sx == 1 ||
@@ -1575,14 +2358,28 @@ tty_cmd_insertline(struct tty *tty, const struct tty_ctx *ctx)
 
 	tty_emulate_repeat(tty, TTYC_IL, TTYC_IL1, ctx->num);
 	tty->cx = tty->cy = UINT_MAX;
+
+	/*
+	 * Without BCE the inserted lines have the terminal default background
+	 * rather than the pane one, so redraw them from the screen instead of
+	 * giving up on scrolling entirely.
+	 */
+	if (tty_fake_bce(tty, &ctx->defaults, ctx->bg)) {
+		for (i = 0; i < ctx->num; i++) {
+			if (ctx->ocy + i > ctx->orlower)
+				break;
+			tty_draw_pane(tty, ctx, ctx->ocy + i);
+		}
+	}
 }
 
 void
 tty_cmd_deleteline(struct tty *tty, const struct tty_ctx *ctx)
 {
+	u_int	i;
+
 	if (ctx->bigger ||
 	    !tty_full_width(tty, ctx) ||
-	    tty_fake_bce(tty, &ctx->defaults, ctx->bg) ||
 	    !tty_term_has(tty->term, TTYC_CSR) ||
 	    !tty_term_has(tty->term, TTYC_DL1) ||
 	    ctx->sx == 1 ||
@@ -1599,6 +2396,15 @@ tty_cmd_deleteline(struct tty *tty, const struct tty_ctx *ctx)
 
 	tty_emulate_repeat(tty, TTYC_DL, TTYC_DL1, ctx->num);
 	tty->cx = tty->cy = UINT_MAX;
+
+	/* As above, fix the exposed lines up if BCE is being emulated. */
+	if (tty_fake_bce(tty, &ctx->defaults, ctx->bg)) {
+		for (i = 0; i < ctx->num; i++) {
+			if (i > ctx->orlower - ctx->orupper)
+				break;
+			tty_draw_pane(tty, ctx, ctx->orlower - i);
+		}
+	}
 }
 
 void
@@ -1635,7 +2441,6 @@ tty_cmd_reverseindex(struct tty *tty, const struct tty_ctx *ctx)
 
 	if (ctx->bigger ||
 	    (!tty_full_width(tty, ctx) && !tty_use_margin(tty)) ||
-	    tty_fake_bce(tty, &ctx->defaults, 8) ||
 	    !tty_term_has(tty->term, TTYC_CSR) ||
 	    (!tty_term_has(tty->term, TTYC_RI) &&
 	    !tty_term_has(tty->term, TTYC_RIN)) ||
@@ -1655,6 +2460,10 @@ tty_cmd_reverseindex(struct tty *tty, const struct tty_ctx *ctx)
 		tty_putcode(tty, TTYC_RI);
 	else
 		tty_putcode1(tty, TTYC_RIN, 1);
+
+	/* As above, fix the exposed line up if BCE is being emulated. */
+	if (tty_fake_bce(tty, &ctx->defaults, 8))
+		tty_draw_pane(tty, ctx, ctx->orupper);
 }
 
 void
@@ -1665,7 +2474,6 @@ tty_cmd_linefeed(struct tty *tty, const struct tty_ctx *ctx)
 
 	if (ctx->bigger ||
 	    (!tty_full_width(tty, ctx) && !tty_use_margin(tty)) ||
-	    tty_fake_bce(tty, &ctx->defaults, 8) ||
 	    !tty_term_has(tty->term, TTYC_CSR) ||
 	    ctx->sx == 1 ||
 	    ctx->sy == 1) {
@@ -1694,6 +2502,10 @@ tty_cmd_linefeed(struct tty *tty, const struct tty_ctx *ctx)
 		tty_cursor_pane(tty, ctx, ctx->ocx, ctx->ocy);
 
 	tty_putc(tty, '\n');
+
+	/* As above, fix the exposed line up if BCE is being emulated. */
+	if (tty_fake_bce(tty, &ctx->defaults, 8))
+		tty_draw_pane(tty, ctx, ctx->orlower);
 }
 
 void
@@ -1703,7 +2515,6 @@ tty_cmd_scrollup(struct tty *tty, const struct tty_ctx *ctx)
 
 	if (ctx->bigger ||
 	    (!tty_full_width(tty, ctx) && !tty_use_margin(tty)) ||
-	    tty_fake_bce(tty, &ctx->defaults, 8) ||
 	    !tty_term_has(tty->term, TTYC_CSR) ||
 	    ctx->sx == 1 ||
 	    ctx->sy == 1) {
@@ -1730,6 +2541,15 @@ tty_cmd_scrollup(struct tty *tty, const struct tty_ctx *ctx)
 			tty_cursor(tty, 0, tty->cy);
 		tty_putcode1(tty, TTYC_INDN, ctx->num);
 	}
+
+	/* As above, fix the exposed lines up if BCE is being emulated. */
+	if (tty_fake_bce(tty, &ctx->defaults, 8)) {
+		for (i = 0; i < ctx->num; i++) {
+			if (i > ctx->orlower - ctx->orupper)
+				break;
+			tty_draw_pane(tty, ctx, ctx->orlower - i);
+		}
+	}
 }
 
 void
@@ -1739,7 +2559,6 @@ tty_cmd_scrolldown(struct tty *tty, const struct tty_ctx *ctx)
 
 	if (ctx->bigger ||
 	    (!tty_full_width(tty, ctx) && !tty_use_margin(tty)) ||
-	    tty_fake_bce(tty, &ctx->defaults, 8) ||
 	    !tty_term_has(tty->term, TTYC_CSR) ||
 	    (!tty_term_has(tty->term, TTYC_RI) &&
 	    !tty_term_has(tty->term, TTYC_RIN)) ||
@@ -1761,6 +2580,15 @@ tty_cmd_scrolldown(struct tty *tty, const struct tty_ctx *ctx)
 		for (i = 0; i < ctx->num; i++)
 			tty_putcode(tty, TTYC_RI);
 	}
+
+	/* As above, fix the exposed lines up if BCE is being emulated. */
+	if (tty_fake_bce(tty, &ctx->defaults, 8)) {
+		for (i = 0; i < ctx->num; i++) {
+			if (ctx->orupper + i > ctx->orlower)
+				break;
+			tty_draw_pane(tty, ctx, ctx->orupper + i);
+		}
+	}
 }
 
 void
@@ -1922,6 +2750,29 @@ tty_cmd_rawstring(struct tty *tty, const struct tty_ctx *ctx)
 	tty_invalidate(tty);
 }
 
+/* Write a sixel image, only to terminals which support it. */
+void
+tty_cmd_sixel(struct tty *tty, const struct tty_ctx *ctx)
+{
+	struct image	*img = ctx->ptr;
+	const char	*data;
+	size_t		 size;
+
+	if (~tty->term->flags & TERM_SIXEL)
+		return;
+	if (!tty_is_visible(tty, ctx, ctx->ocx, ctx->ocy, 1, 1))
+		return;
+
+	data = image_data(img, &size);
+
+	tty_region_off(tty);
+	tty_margin_off(tty);
+	tty_cursor_pane(tty, ctx, ctx->ocx, ctx->ocy);
+
+	tty_add(tty, data, size);
+	tty_invalidate(tty);
+}
+
 void
 tty_cmd_syncstart(struct tty *tty, __unused const struct tty_ctx *ctx)
 {
@@ -1970,6 +2821,7 @@ tty_reset(struct tty *tty)
 		if ((gc->attr & GRID_ATTR_CHARSET) && tty_acs_needed(tty))
 			tty_putcode(tty, TTYC_RMACS);
 		tty_putcode(tty, TTYC_SGR0);
+		tty_hyperlink(tty, 0); /* SGR 0 does not close hyperlinks */
 		memcpy(gc, &grid_default_cell, sizeof *gc);
 	}
 	memcpy(&tty->last_cell, &grid_default_cell, sizeof tty->last_cell);
@@ -1978,6 +2830,8 @@ tty_reset(struct tty *tty)
 static void
 tty_invalidate(struct tty *tty)
 {
+	tty_shadow_flush(tty);
+
 	memcpy(&tty->cell, &grid_default_cell, sizeof tty->cell);
 	memcpy(&tty->last_cell, &grid_default_cell, sizeof tty->last_cell);
 
@@ -1989,6 +2843,8 @@ tty_invalidate(struct tty *tty)
 		if (tty_use_margin(tty))
 			tty_putcode(tty, TTYC_ENMG);
 		tty_putcode(tty, TTYC_SGR0);
+		if (tty->term->flags & TERM_HYPERLINKS)
+			tty_puts(tty, "\033]8;;\033\\");
 
 		tty->mode = ALL_MODES;
 		tty_update_mode(tty, MODE_CURSOR, NULL);
@@ -2266,7 +3122,8 @@ tty_attributes(struct tty *tty, const struct grid_cell *gc,
 	if (gc2.attr == tty->last_cell.attr &&
 	    gc2.fg == tty->last_cell.fg &&
 	    gc2.bg == tty->last_cell.bg &&
-	    gc2.us == tty->last_cell.us)
+	    gc2.us == tty->last_cell.us &&
+	    gc2.link == tty->last_cell.link)
 		return;
 
 	/*
@@ -2343,9 +3200,42 @@ tty_attributes(struct tty *tty, const struct grid_cell *gc,
 	if ((changed & GRID_ATTR_CHARSET) && tty_acs_needed(tty))
 		tty_putcode(tty, TTYC_SMACS);
 
+	/* Open or close the hyperlink if it has changed. */
+	tty_hyperlink(tty, gc2.link);
+
 	memcpy(&tty->last_cell, &gc2, sizeof tty->last_cell);
 }
 
+/*
+ * Open or close an OSC 8 hyperlink. There is no terminfo capability for
+ * this, so the sequence is written directly when the terminal has announced
+ * support with the "hyperlinks" feature. The URI and id live in the
+ * server-wide table in hyperlinks.c; a number that has been dropped from the
+ * table just closes any open link.
+ */
+static void
+tty_hyperlink(struct tty *tty, u_int link)
+{
+	struct grid_cell	*tc = &tty->cell;
+	const char		*uri, *id;
+	char			*s;
+
+	if (link == tc->link)
+		return;
+	tc->link = link;
+	if (~tty->term->flags & TERM_HYPERLINKS)
+		return;
+
+	if (link == 0 || !hyperlinks_get(link, &uri, &id))
+		tty_puts(tty, "\033]8;;\033\\");
+	else {
+		xasprintf(&s, "\033]8;%s%s;%s\033\\",
+		    *id != '\0' ? "id=" : "", id, uri);
+		tty_puts(tty, s);
+		free(s);
+	}
+}
+
 static void
 tty_colours(struct tty *tty, const struct grid_cell *gc)
 {
@@ -209,39 +209,139 @@ window_buffer_build(void *modedata, struct mode_tree_sort_criteria *sort_crit,
 
 }
 
+/*
+ * Cache of buffer previews. Only the visible prefix of a buffer is sampled,
+ * up to a byte budget, and the result kept until the buffer changes, so
+ * redraws and reordering do not re-read large buffers.
+ */
+struct window_buffer_preview {
+	char				 *name;
+	size_t				  psize;
+	time_t				  created;
+	u_int				  sx;
+	u_int				  sy;
+
+	u_int				  nlines;
+	char				**lines;
+
+	TAILQ_ENTRY(window_buffer_preview) entry;
+};
+#define WINDOW_BUFFER_PREVIEW_MAX 16
+#define WINDOW_BUFFER_PREVIEW_BYTES 65536
+static TAILQ_HEAD(window_buffer_previews, window_buffer_preview)
+    window_buffer_previews = TAILQ_HEAD_INITIALIZER(window_buffer_previews);
+static u_int window_buffer_preview_count;
+
+/* Free one cached preview. */
+static void
+window_buffer_preview_free(struct window_buffer_preview *pv)
+{
+	u_int	i;
+
+	TAILQ_REMOVE(&window_buffer_previews, pv, entry);
+	window_buffer_preview_count--;
+
+	for (i = 0; i < pv->nlines; i++)
+		free(pv->lines[i]);
+	free(pv->lines);
+	free(pv->name);
+	free(pv);
+}
+
+/* Get the preview for a buffer, sampling it if not already cached. */
+static struct window_buffer_preview *
+window_buffer_preview_get(const char *name, struct paste_buffer *pb, u_int sx,
+    u_int sy)
+{
+	struct window_buffer_preview	*pv;
+	const char			*pdata, *start, *end, *limit, *nl;
+	size_t				 psize, len;
+	u_int				 i;
+
+	pdata = paste_buffer_data(pb, &psize);
+
+	TAILQ_FOREACH(pv, &window_buffer_previews, entry) {
+		if (strcmp(pv->name, name) != 0)
+			continue;
+		if (pv->psize == psize &&
+		    pv->created == paste_buffer_created(pb) &&
+		    pv->sx == sx &&
+		    pv->sy >= sy) {
+			TAILQ_REMOVE(&window_buffer_previews, pv, entry);
+			TAILQ_INSERT_HEAD(&window_buffer_previews, pv, entry);
+			return (pv);
+		}
+		window_buffer_preview_free(pv);
+		break;
+	}
+	if (window_buffer_preview_count == WINDOW_BUFFER_PREVIEW_MAX) {
+		window_buffer_preview_free(TAILQ_LAST(&window_buffer_previews,
+		    window_buffer_previews));
+	}
+
+	pv = xcalloc(1, sizeof *pv);
+	pv->name = xstrdup(name);
+	pv->psize = psize;
+	pv->created = paste_buffer_created(pb);
+	pv->sx = sx;
+	pv->sy = sy;
+	pv->lines = xcalloc(sy, sizeof *pv->lines);
+
+	if (psize < WINDOW_BUFFER_PREVIEW_BYTES)
+		limit = pdata + psize;
+	else
+		limit = pdata + WINDOW_BUFFER_PREVIEW_BYTES;
+	end = pdata;
+	for (i = 0; i < sy; i++) {
+		start = end;
+		nl = memchr(start, '\n', limit - start);
+		if (nl == NULL)
+			end = limit;
+		else
+			end = nl;
+
+		/* Only what can be displayed is converted. */
+		len = end - start;
+		if (len > (size_t)sx * 4)
+			len = (size_t)sx * 4;
+		pv->lines[pv->nlines] = xreallocarray(NULL, 4, len + 1);
+		utf8_strvis(pv->lines[pv->nlines], start, len,
+		    VIS_OCTAL|VIS_CSTYLE|VIS_TAB);
+		pv->nlines++;
+
+		if (nl == NULL)
+			break;
+		end = nl + 1;
+		if (end == limit)
+			break;
+	}
+
+	TAILQ_INSERT_HEAD(&window_buffer_previews, pv, entry);
+	window_buffer_preview_count++;
+	return (pv);
+}
+
 static void
 window_buffer_draw(__unused void *modedata, void *itemdata,
     struct screen_write_ctx *ctx, u_int sx, u_int sy)
 {
 	struct window_buffer_itemdata	*item = itemdata;
+	struct window_buffer_preview	*pv;
 	struct paste_buffer		*pb;
-	const char			*pdata, *start, *end;
-	char				*buf = NULL;
-	size_t				 psize;
 	u_int				 i, cx = ctx->s->cx, cy = ctx->s->cy;
 
 	pb = paste_get_name(item->name);
 	if (pb == NULL)
 		return;
 
-	pdata = end = paste_buffer_data(pb, &psize);
-	for (i = 0; i < sy; i++) {
-		start = end;
-		while (end != pdata + psize && *end != '\n')
-			end++;
-		buf = xreallocarray(buf, 4, end - start + 1);
-		utf8_strvis(buf, start, end - start, VIS_OCTAL|VIS_CSTYLE|VIS_TAB);
-		if (*buf != '\0') {
-			screen_write_cursormove(ctx, cx, cy + i, 0);
-			screen_write_nputs(ctx, sx, &grid_default_cell, "%s",
-			    buf);
-		}
-
-		if (end == pdata + psize)
-			break;
-		end++;
+	pv = window_buffer_preview_get(item->name, pb, sx, sy);
+	for (i = 0; i < pv->nlines && i < sy; i++) {
+		if (*pv->lines[i] == '\0')
+			continue;
+		screen_write_cursormove(ctx, cx, cy + i, 0);
+		screen_write_nputs(ctx, sx, &grid_default_cell, "%s",
+		    pv->lines[i]);
 	}
-	free(buf);
 }
 
 static int
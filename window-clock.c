@@ -33,6 +33,11 @@ static void	window_clock_key(struct window_mode_entry *, struct client *,
 		     struct mouse_event *);
 
 static void	window_clock_timer_callback(int, short, void *);
+static void	window_clock_time_string(int, char *, size_t);
+static int	window_clock_table_index(char);
+static void	window_clock_draw_char(struct screen_write_ctx *,
+		    const struct grid_cell *, u_int, u_int, char);
+static void	window_clock_update(struct window_mode_entry *);
 static void	window_clock_draw_screen(struct window_mode_entry *);
 
 const struct window_mode window_clock_mode = {
@@ -48,6 +53,11 @@ struct window_clock_mode_data {
 	struct screen	        screen;
 	time_t			tim;
 	struct event		timer;
+
+	/* What is on the screen, so updates can redraw only changed digits. */
+	char			drawn[64];
+	int			drawn_colour;
+	int			drawn_style;
 };
 
 const char window_clock_table[14][5][5] = {
@@ -146,8 +156,118 @@ window_clock_timer_callback(__unused int fd, __unused short events, void *arg)
 		return;
 	data->tim = t;
 
-	window_clock_draw_screen(wme);
-	wp->flags |= PANE_REDRAW;
+	window_clock_update(wme);
+}
+
+/* Build the time string for the given clock-mode-style. */
+static void
+window_clock_time_string(int style, char *buf, size_t len)
+{
+	time_t		 t;
+	struct tm	*tm;
+
+	t = time(NULL);
+	tm = localtime(&t);
+	if (style == 0) {
+		strftime(buf, len, "%l:%M ", tm);
+		if (tm->tm_hour >= 12)
+			strlcat(buf, "PM", len);
+		else
+			strlcat(buf, "AM", len);
+	} else
+		strftime(buf, len, "%H:%M", tm);
+}
+
+/* Map a time string character to the glyph table, -1 if blank. */
+static int
+window_clock_table_index(char ch)
+{
+	if (ch >= '0' && ch <= '9')
+		return (ch - '0');
+	if (ch == ':')
+		return (10);
+	if (ch == 'A')
+		return (11);
+	if (ch == 'P')
+		return (12);
+	if (ch == 'M')
+		return (13);
+	return (-1);
+}
+
+/* Draw one glyph block, blanking the cells the glyph does not cover. */
+static void
+window_clock_draw_char(struct screen_write_ctx *ctx,
+    const struct grid_cell *gc, u_int px, u_int py, char ch)
+{
+	struct grid_cell	 off;
+	int			 idx;
+	u_int			 i, j;
+
+	memcpy(&off, &grid_default_cell, sizeof off);
+	off.flags |= GRID_FLAG_NOPALETTE;
+
+	idx = window_clock_table_index(ch);
+	for (j = 0; j < 5; j++) {
+		for (i = 0; i < 5; i++) {
+			screen_write_cursormove(ctx, px + i, py + j, 0);
+			if (idx != -1 && window_clock_table[idx][j][i])
+				screen_write_putc(ctx, gc, ' ');
+			else
+				screen_write_putc(ctx, &off, ' ');
+		}
+	}
+}
+
+/*
+ * Update the clock. Usually only a digit or two has changed, so redraw just
+ * those blocks through the pane so viewers get a few cells rather than a
+ * full frame; fall back to a full redraw when the layout or look changed.
+ */
+static void
+window_clock_update(struct window_mode_entry *wme)
+{
+	struct window_pane		*wp = wme->wp;
+	struct window_clock_mode_data	*data = wme->data;
+	struct screen			*s = &data->screen;
+	struct screen_write_ctx		 ctx;
+	struct grid_cell		 gc;
+	char				 tim[64];
+	u_int				 x, y, k;
+	int				 colour, style;
+
+	colour = options_get_number(wp->window->options, "clock-mode-colour");
+	style = options_get_number(wp->window->options, "clock-mode-style");
+	window_clock_time_string(style, tim, sizeof tim);
+
+	if (*data->drawn == '\0' ||
+	    strlen(tim) != strlen(data->drawn) ||
+	    colour != data->drawn_colour ||
+	    style != data->drawn_style ||
+	    screen_size_x(s) < 6 * strlen(tim) ||
+	    screen_size_y(s) < 6) {
+		window_clock_draw_screen(wme);
+		wp->flags |= PANE_REDRAW;
+		return;
+	}
+	if (strcmp(tim, data->drawn) == 0)
+		return;
+
+	x = (screen_size_x(s) / 2) - 3 * strlen(tim);
+	y = (screen_size_y(s) / 2) - 3;
+
+	memcpy(&gc, &grid_default_cell, sizeof gc);
+	gc.flags |= GRID_FLAG_NOPALETTE;
+	gc.bg = colour;
+
+	screen_write_start_pane(&ctx, wp, NULL);
+	for (k = 0; tim[k] != '\0'; k++) {
+		if (tim[k] != data->drawn[k])
+			window_clock_draw_char(&ctx, &gc, x + 6 * k, y, tim[k]);
+	}
+	screen_write_stop(&ctx);
+
+	strlcpy(data->drawn, tim, sizeof data->drawn);
 }
 
 static struct screen *
@@ -161,6 +281,7 @@ window_clock_init(struct window_mode_entry *wme,
 
 	wme->data = data = xmalloc(sizeof *data);
 	data->tim = time(NULL);
+	*data->drawn = '\0';
 
 	evtimer_set(&data->timer, window_clock_timer_callback, wme);
 	evtimer_add(&data->timer, &tv);
@@ -212,25 +333,15 @@ window_clock_draw_screen(struct window_mode_entry *wme)
 	struct screen			*s = &data->screen;
 	struct grid_cell		 gc;
 	char				 tim[64], *ptr;
-	time_t				 t;
-	struct tm			*tm;
-	u_int				 i, j, x, y, idx;
+	u_int				 i, j, x, y;
+	int				 idx;
 
 	colour = options_get_number(wp->window->options, "clock-mode-colour");
 	style = options_get_number(wp->window->options, "clock-mode-style");
 
 	screen_write_start(&ctx, s);
 
-	t = time(NULL);
-	tm = localtime(&t);
-	if (style == 0) {
-		strftime(tim, sizeof tim, "%l:%M ", localtime(&t));
-		if (tm->tm_hour >= 12)
-			strlcat(tim, "PM", sizeof tim);
-		else
-			strlcat(tim, "AM", sizeof tim);
-	} else
-		strftime(tim, sizeof tim, "%H:%M", tm);
+	window_clock_time_string(style, tim, sizeof tim);
 
 	screen_write_clearscreen(&ctx, 8);
 
@@ -247,6 +358,7 @@ window_clock_draw_screen(struct window_mode_entry *wme)
 		}
 
 		screen_write_stop(&ctx);
+		*data->drawn = '\0';
 		return;
 	}
 
@@ -257,17 +369,8 @@ window_clock_draw_screen(struct window_mode_entry *wme)
 	gc.flags |= GRID_FLAG_NOPALETTE;
 	gc.bg = colour;
 	for (ptr = tim; *ptr != '\0'; ptr++) {
-		if (*ptr >= '0' && *ptr <= '9')
-			idx = *ptr - '0';
-		else if (*ptr == ':')
-			idx = 10;
-		else if (*ptr == 'A')
-			idx = 11;
-		else if (*ptr == 'P')
-			idx = 12;
-		else if (*ptr == 'M')
-			idx = 13;
-		else {
+		idx = window_clock_table_index(*ptr);
+		if (idx == -1) {
 			x += 6;
 			continue;
 		}
@@ -283,4 +386,8 @@ window_clock_draw_screen(struct window_mode_entry *wme)
 	}
 
 	screen_write_stop(&ctx);
+
+	strlcpy(data->drawn, tim, sizeof data->drawn);
+	data->drawn_colour = colour;
+	data->drawn_style = style;
 }
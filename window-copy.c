@@ -27,6 +27,8 @@
 #include "tmux.h"
 
 static const char *window_copy_key_table(struct window_mode_entry *);
+struct window_copy_mode_data;
+
 static void	window_copy_command(struct window_mode_entry *, struct client *,
 		    struct session *, struct winlink *, struct args *,
 		    struct mouse_event *);
@@ -53,19 +55,30 @@ static void	window_copy_write_lines(struct window_mode_entry *,
 		    struct screen_write_ctx *, u_int, u_int);
 
 static void	window_copy_scroll_to(struct window_mode_entry *, u_int, u_int);
-static int	window_copy_search_compare(struct grid *, u_int, u_int,
-		    struct grid *, u_int, int);
-static int	window_copy_search_lr(struct grid *, struct grid *, u_int *,
-		    u_int, u_int, u_int, int);
-static int	window_copy_search_rl(struct grid *, struct grid *, u_int *,
-		    u_int, u_int, u_int, int);
+static void	window_copy_search_free_lines(struct window_copy_mode_data *);
+static const char *window_copy_search_line(struct window_copy_mode_data *,
+		    struct grid *, u_int);
+static const char *window_copy_search_text(struct window_copy_mode_data *,
+		    struct grid *, u_int, char **);
+static int	window_copy_search_lr(struct window_copy_mode_data *,
+		    struct grid *, const char *, u_int *, u_int, u_int, u_int,
+		    int);
+static int	window_copy_search_rl(struct window_copy_mode_data *,
+		    struct grid *, const char *, u_int *, u_int, u_int, u_int,
+		    int);
 static int	window_copy_last_regex(struct grid *gd, u_int py, u_int first,
 		    u_int last, u_int len, u_int *ppx, u_int *psx,
 		    const char *buf, const regex_t *preg, int eflags);
+static const char *window_copy_cellstring(const struct grid_line *, u_int,
+		    size_t *);
 static char    *window_copy_stringify(struct grid *, u_int, u_int, u_int,
 		    char *, u_int *);
 static void	window_copy_cstrtocellpos(struct grid *, u_int, u_int *, u_int *,
 		    const char *str);
+static u_int	window_copy_search_mark_line(struct window_mode_entry *,
+		    u_int, int);
+static void	window_copy_search_cancel(struct window_copy_mode_data *);
+static void	window_copy_search_timer(int, short, void *);
 static int	window_copy_search_marks(struct window_mode_entry *,
 		    struct screen *, int);
 static void	window_copy_clear_marks(struct window_mode_entry *);
@@ -101,6 +114,7 @@ static void	window_copy_copy_line(struct window_mode_entry *, char **,
 		    size_t *, u_int, u_int, u_int);
 static int	window_copy_in_set(struct window_mode_entry *, u_int, u_int,
 		    const char *);
+static void	window_copy_word_cache_clear(struct window_copy_mode_data *);
 static u_int	window_copy_find_length(struct window_mode_entry *, u_int);
 static void	window_copy_cursor_start_of_line(struct window_mode_entry *);
 static void	window_copy_cursor_back_to_indentation(
@@ -127,6 +141,7 @@ static void	window_copy_cursor_previous_word(struct window_mode_entry *,
 		    const char *, int);
 static void	window_copy_scroll_up(struct window_mode_entry *, u_int);
 static void	window_copy_scroll_down(struct window_mode_entry *, u_int);
+static void	window_copy_scroll_draw(struct window_mode_entry *, u_int);
 static void	window_copy_rectangle_toggle(struct window_mode_entry *);
 static void	window_copy_move_mouse(struct mouse_event *);
 static void	window_copy_drag_update(struct client *, struct mouse_event *);
@@ -201,6 +216,21 @@ struct window_copy_cmd_state {
  * of output-lines from a command, it points at a newly-allocated screen
  * structure (which is deallocated when the mode ends).
  */
+/*
+ * Cached classification of one backing line against a word separator set.
+ * Word motions test the same cells over and over as they walk along a line,
+ * and each test resolves the cell from the grid; classify the whole line once
+ * instead and answer later tests from the cache. The backing screen only
+ * changes on resize or (in view mode) append, when the cache is dropped.
+ */
+struct window_copy_word_cache {
+	char		*set;		/* separators (NULL if slot unused) */
+	u_int		 py;
+	u_int		 nx;		/* number of cells classified */
+	u_char		*flags;		/* nonzero if cell is in the set */
+};
+#define WINDOW_COPY_WORD_CACHE 8
+
 struct window_copy_mode_data {
 	struct screen	 screen;
 
@@ -263,6 +293,21 @@ struct window_copy_mode_data {
 	int		 searchregex;
 	char		*searchstr;
 	u_char		*searchmark;
+	char		**searchlines;	/* cached line text for searching */
+	u_int		 nsearchlines;
+
+	struct event	 searchtimer;	/* background marks pass */
+	int		 searchrunning;
+	u_int		 searchpy;	/* next row for background pass */
+	u_int		 searchnfound;
+	int		 searchwhich;
+	char		*searchneedle;
+	regex_t		 searchreg;
+	int		 searchhasreg;
+	int		 searchcis;
+	u_int		 searchwidth;
+	uint64_t	 searchspent;	/* time spent searching (ms) */
+#define WINDOW_COPY_SEARCH_CHUNK 2000
 	int		 searchcount;
 	int		 searchmore;
 	int		 searchthis;
@@ -280,6 +325,9 @@ struct window_copy_mode_data {
 
 	struct event	 dragtimer;
 #define WINDOW_COPY_DRAG_REPEAT_TIME 50000
+
+	struct window_copy_word_cache wordcache[WINDOW_COPY_WORD_CACHE];
+	u_int		 wordcachenext;	/* next slot to reuse */
 };
 
 static void
@@ -336,7 +384,7 @@ window_copy_clone_screen(struct screen *src, struct screen *hint, u_int *cx,
 	 * during resizing.
 	 */
 	dst->grid->flags |= GRID_HISTORY;
-	grid_duplicate_lines(dst->grid, 0, src->grid, 0, sy);
+	grid_snapshot_lines(dst->grid, 0, src->grid, 0, sy);
 
 	dst->grid->sy = sy - screen_hsize(src);
 	dst->grid->hsize = screen_hsize(src);
@@ -397,6 +445,7 @@ window_copy_common_init(struct window_mode_entry *wme)
 	data->modekeys = options_get_number(wp->window->options, "mode-keys");
 
 	evtimer_set(&data->dragtimer, window_copy_scroll_timer, wme);
+	evtimer_set(&data->searchtimer, window_copy_search_timer, wme);
 
 	return (data);
 }
@@ -470,6 +519,9 @@ window_copy_free(struct window_mode_entry *wme)
 
 	evtimer_del(&data->dragtimer);
 
+	window_copy_search_cancel(data);
+	window_copy_search_free_lines(data);
+	window_copy_word_cache_clear(data);
 	free(data->searchmark);
 	free(data->searchstr);
 
@@ -500,6 +552,8 @@ window_copy_vadd(struct window_pane *wp, const char *fmt, va_list ap)
 	struct grid_cell		 gc;
 	u_int				 old_hsize, old_cy;
 
+	window_copy_search_free_lines(data);
+	window_copy_word_cache_clear(data);
 	memcpy(&gc, &grid_default_cell, sizeof gc);
 
 	old_hsize = screen_hsize(data->backing);
@@ -545,7 +599,7 @@ window_copy_pageup1(struct window_mode_entry *wme, int half_page)
 {
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*s = &data->screen;
-	u_int				 n, ox, oy, px, py;
+	u_int				 n, ox, oy, px, py, oldoy = data->oy;
 
 	oy = screen_hsize(data->backing) + data->cy - data->oy;
 	ox = window_copy_find_length(wme, oy);
@@ -573,6 +627,11 @@ window_copy_pageup1(struct window_mode_entry *wme, int half_page)
 	} else
 		data->oy += n;
 
+	if (data->searchmark != NULL && !data->timeout)
+		window_copy_search_marks(wme, NULL, data->searchregex);
+	window_copy_update_selection(wme, 0, 0);
+	window_copy_scroll_draw(wme, oldoy);
+
 	if (data->screen.sel == NULL || !data->rectflag) {
 		py = screen_hsize(data->backing) + data->cy - data->oy;
 		px = window_copy_find_length(wme, py);
@@ -580,11 +639,6 @@ window_copy_pageup1(struct window_mode_entry *wme, int half_page)
 		    data->cx > px)
 			window_copy_cursor_end_of_line(wme);
 	}
-
-	if (data->searchmark != NULL && !data->timeout)
-		window_copy_search_marks(wme, NULL, data->searchregex);
-	window_copy_update_selection(wme, 1, 0);
-	window_copy_redraw_screen(wme);
 }
 
 static int
@@ -593,7 +647,7 @@ window_copy_pagedown(struct window_mode_entry *wme, int half_page,
 {
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*s = &data->screen;
-	u_int				 n, ox, oy, px, py;
+	u_int				 n, ox, oy, px, py, oldoy = data->oy;
 
 	oy = screen_hsize(data->backing) + data->cy - data->oy;
 	ox = window_copy_find_length(wme, oy);
@@ -621,6 +675,13 @@ window_copy_pagedown(struct window_mode_entry *wme, int half_page,
 	} else
 		data->oy -= n;
 
+	if (scroll_exit && data->oy == 0)
+		return (1);
+	if (data->searchmark != NULL && !data->timeout)
+		window_copy_search_marks(wme, NULL, data->searchregex);
+	window_copy_update_selection(wme, 0, 0);
+	window_copy_scroll_draw(wme, oldoy);
+
 	if (data->screen.sel == NULL || !data->rectflag) {
 		py = screen_hsize(data->backing) + data->cy - data->oy;
 		px = window_copy_find_length(wme, py);
@@ -628,13 +689,6 @@ window_copy_pagedown(struct window_mode_entry *wme, int half_page,
 		    data->cx > px)
 			window_copy_cursor_end_of_line(wme);
 	}
-
-	if (scroll_exit && data->oy == 0)
-		return (1);
-	if (data->searchmark != NULL && !data->timeout)
-		window_copy_search_marks(wme, NULL, data->searchregex);
-	window_copy_update_selection(wme, 1, 0);
-	window_copy_redraw_screen(wme);
 	return (0);
 }
 
@@ -740,6 +794,7 @@ window_copy_size_changed(struct window_mode_entry *wme)
 	struct screen_write_ctx		 ctx;
 	int				 search = (data->searchmark != NULL);
 
+	window_copy_word_cache_clear(data);
 	window_copy_clear_selection(wme);
 	window_copy_clear_marks(wme);
 
@@ -763,6 +818,7 @@ window_copy_resize(struct window_mode_entry *wme, u_int sx, u_int sy)
 	u_int				 cx, cy, wx, wy;
 	int				 reflow;
 
+	window_copy_search_free_lines(data);
 	screen_resize(s, sx, sy, 0);
 	cx = data->cx;
 	cy = gd->hsize + data->cy - data->oy;
@@ -894,11 +950,16 @@ window_copy_cmd_bottom_line(struct window_copy_cmd_state *cs)
 {
 	struct window_mode_entry	*wme = cs->wme;
 	struct window_copy_mode_data	*data = wme->data;
+	u_int				 old_cy = data->cy;
 
 	data->cx = 0;
 	data->cy = screen_size_y(&data->screen) - 1;
 
-	window_copy_update_selection(wme, 1, 0);
+	/* Only the lines between the old and new cursor have changed. */
+	if (window_copy_update_selection(wme, 1, 0)) {
+		window_copy_redraw_selection(wme, old_cy);
+		return (WINDOW_COPY_CMD_NOTHING);
+	}
 	return (WINDOW_COPY_CMD_REDRAW);
 }
 
@@ -1231,11 +1292,16 @@ window_copy_cmd_middle_line(struct window_copy_cmd_state *cs)
 {
 	struct window_mode_entry	*wme = cs->wme;
 	struct window_copy_mode_data	*data = wme->data;
+	u_int				 old_cy = data->cy;
 
 	data->cx = 0;
 	data->cy = (screen_size_y(&data->screen) - 1) / 2;
 
-	window_copy_update_selection(wme, 1, 0);
+	/* Only the lines between the old and new cursor have changed. */
+	if (window_copy_update_selection(wme, 1, 0)) {
+		window_copy_redraw_selection(wme, old_cy);
+		return (WINDOW_COPY_CMD_NOTHING);
+	}
 	return (WINDOW_COPY_CMD_REDRAW);
 }
 
@@ -1769,11 +1835,16 @@ window_copy_cmd_top_line(struct window_copy_cmd_state *cs)
 {
 	struct window_mode_entry	*wme = cs->wme;
 	struct window_copy_mode_data	*data = wme->data;
+	u_int				 old_cy = data->cy;
 
 	data->cx = 0;
 	data->cy = 0;
 
-	window_copy_update_selection(wme, 1, 0);
+	/* Only the lines between the old and new cursor have changed. */
+	if (window_copy_update_selection(wme, 1, 0)) {
+		window_copy_redraw_selection(wme, old_cy);
+		return (WINDOW_COPY_CMD_NOTHING);
+	}
 	return (WINDOW_COPY_CMD_REDRAW);
 }
 
@@ -2321,7 +2392,7 @@ window_copy_scroll_to(struct window_mode_entry *wme, u_int px, u_int py)
 {
 	struct window_copy_mode_data	*data = wme->data;
 	struct grid			*gd = data->backing->grid;
-	u_int				 offset, gap;
+	u_int				 offset, gap, oldoy = data->oy;
 
 	data->cx = px;
 
@@ -2344,112 +2415,234 @@ window_copy_scroll_to(struct window_mode_entry *wme, u_int px, u_int py)
 
 	if (data->searchmark != NULL && !data->timeout)
 		window_copy_search_marks(wme, NULL, data->searchregex);
-	window_copy_update_selection(wme, 1, 0);
-	window_copy_redraw_screen(wme);
+	window_copy_update_selection(wme, 0, 0);
+	window_copy_scroll_draw(wme, oldoy);
 }
 
-static int
-window_copy_search_compare(struct grid *gd, u_int px, u_int py,
-    struct grid *sgd, u_int spx, int cis)
+/* Free the cached search line text. */
+static void
+window_copy_search_free_lines(struct window_copy_mode_data *data)
 {
-	struct grid_cell	 gc, sgc;
-	const struct utf8_data	*ud, *sud;
+	u_int	i;
 
-	grid_get_cell(gd, px, py, &gc);
-	ud = &gc.data;
-	grid_get_cell(sgd, spx, 0, &sgc);
-	sud = &sgc.data;
+	for (i = 0; i < data->nsearchlines; i++)
+		free(data->searchlines[i]);
+	free(data->searchlines);
+	data->searchlines = NULL;
+	data->nsearchlines = 0;
+}
 
-	if (ud->size != sud->size || ud->width != sud->width)
-		return (0);
+/* Get the cached text of a single grid row, converting it on first use. */
+static const char *
+window_copy_search_line(struct window_copy_mode_data *data, struct grid *gd,
+    u_int py)
+{
+	char	*buf;
+	u_int	 size;
+
+	if (data->searchlines == NULL ||
+	    data->nsearchlines != gd->hsize + gd->sy) {
+		window_copy_search_free_lines(data);
+		data->nsearchlines = gd->hsize + gd->sy;
+		data->searchlines = xcalloc(data->nsearchlines,
+		    sizeof *data->searchlines);
+	}
+	if (data->searchlines[py] == NULL) {
+		size = 1;
+		buf = xmalloc(size);
+		*buf = '\0';
+		data->searchlines[py] = window_copy_stringify(gd, py, 0,
+		    gd->sx, buf, &size);
+	}
+	return (data->searchlines[py]);
+}
+
+/*
+ * Get the text of the whole logical line starting at py. If the line is
+ * wrapped the rows are joined into a new buffer returned in *owned which the
+ * caller must free, otherwise the cached row is returned directly.
+ */
+static const char *
+window_copy_search_text(struct window_copy_mode_data *data, struct grid *gd,
+    u_int py, char **owned)
+{
+	const struct grid_line	*gl;
+	const char		*text;
+	char			*buf = NULL;
+	size_t			 len = 0, n;
+	u_int			 pywrap = py, endline = gd->hsize + gd->sy - 1;
+
+	*owned = NULL;
+	gl = grid_peek_line(gd, py);
+	if (py == endline || (~gl->flags & GRID_LINE_WRAPPED))
+		return (window_copy_search_line(data, gd, py));
+
+	for (;;) {
+		text = window_copy_search_line(data, gd, pywrap);
+		n = strlen(text);
+		buf = xrealloc(buf, len + n + 1);
+		memcpy(buf + len, text, n + 1);
+		len += n;
+		gl = grid_peek_line(gd, pywrap);
+		if (pywrap == endline || (~gl->flags & GRID_LINE_WRAPPED))
+			break;
+		pywrap++;
+	}
+	*owned = buf;
+	return (buf);
+}
 
-	if (cis && ud->size == 1)
-		return (tolower(ud->data[0]) == sud->data[0]);
+/* Find the byte offset of a cell within the row at py. */
+static size_t
+window_copy_search_celloff(struct grid *gd, u_int py, u_int cell)
+{
+	const struct grid_line	*gl = grid_peek_line(gd, py);
+	size_t			 off = 0, dlen;
+	u_int			 px;
 
-	return (memcmp(ud->data, sud->data, ud->size) == 0);
+	for (px = 0; px < cell; px++) {
+		window_copy_cellstring(gl, px, &dlen);
+		off += dlen;
+	}
+	return (off);
 }
 
+/*
+ * Map a byte offset in the logical line starting at py back to a cell index.
+ * Returns -1 if the offset does not fall on a cell boundary.
+ */
 static int
-window_copy_search_lr(struct grid *gd,
-    struct grid *sgd, u_int *ppx, u_int py, u_int first, u_int last, int cis)
+window_copy_search_offset(struct grid *gd, u_int py, size_t off, u_int *pcell)
 {
-	u_int			 ax, bx, px, pywrap, endline;
-	int			 matched;
-	struct grid_line	*gl;
+	const struct grid_line	*gl;
+	size_t			 at = 0, dlen;
+	u_int			 cell = 0, px, pywrap = py;
+	u_int			 endline = gd->hsize + gd->sy - 1;
 
-	endline = gd->hsize + gd->sy - 1;
-	for (ax = first; ax < last; ax++) {
-		for (bx = 0; bx < sgd->sx; bx++) {
-			px = ax + bx;
-			pywrap = py;
-			/* Wrap line. */
-			while (px >= gd->sx && pywrap < endline) {
-				gl = grid_get_line(gd, pywrap);
-				if (~gl->flags & GRID_LINE_WRAPPED)
-					break;
-				px -= gd->sx;
-				pywrap++;
+	for (;;) {
+		gl = grid_peek_line(gd, pywrap);
+		for (px = 0; px < gd->sx; px++) {
+			if (at == off) {
+				*pcell = cell;
+				return (0);
 			}
-			/* We have run off the end of the grid. */
-			if (px >= gd->sx)
-				break;
-			matched = window_copy_search_compare(gd, px, pywrap,
-			    sgd, bx, cis);
-			if (!matched)
-				break;
+			if (at > off)
+				return (-1);
+			window_copy_cellstring(gl, px, &dlen);
+			at += dlen;
+			cell++;
 		}
-		if (bx == sgd->sx) {
-			*ppx = ax;
-			return (1);
+		if (pywrap == endline || (~gl->flags & GRID_LINE_WRAPPED))
+			break;
+		pywrap++;
+	}
+	if (at == off) {
+		*pcell = cell;
+		return (0);
+	}
+	return (-1);
+}
+
+/*
+ * Search the logical line at py for needle, finding the first match starting
+ * in cells [first,last) of the first row. The line text is matched as bytes
+ * and candidates are only accepted if both ends fall on cell boundaries, so
+ * the results are the same as comparing cell by cell.
+ */
+static int
+window_copy_search_lr(struct window_copy_mode_data *data, struct grid *gd,
+    const char *needle, u_int *ppx, u_int py, u_int first, u_int last, int cis)
+{
+	const char	*text, *at, *found;
+	char		*owned;
+	size_t		 nlen = strlen(needle), start;
+	u_int		 cell, ecell;
+
+	if (nlen == 0 || first >= last)
+		return (0);
+
+	text = window_copy_search_text(data, gd, py, &owned);
+	start = window_copy_search_celloff(gd, py, first);
+	if (start > strlen(text)) {
+		free(owned);
+		return (0);
+	}
+
+	at = text + start;
+	for (;;) {
+		if (cis)
+			found = strcasestr(at, needle);
+		else
+			found = strstr(at, needle);
+		if (found == NULL)
+			break;
+		if (window_copy_search_offset(gd, py, found - text,
+		    &cell) == 0) {
+			if (cell >= last)
+				break;
+			if (cell >= first &&
+			    window_copy_search_offset(gd, py,
+			    (found - text) + nlen, &ecell) == 0) {
+				*ppx = cell;
+				free(owned);
+				return (1);
+			}
 		}
+		at = found + 1;
 	}
+	free(owned);
 	return (0);
 }
 
+/* As for window_copy_search_lr but find the last match instead. */
 static int
-window_copy_search_rl(struct grid *gd,
-    struct grid *sgd, u_int *ppx, u_int py, u_int first, u_int last, int cis)
+window_copy_search_rl(struct window_copy_mode_data *data, struct grid *gd,
+    const char *needle, u_int *ppx, u_int py, u_int first, u_int last, int cis)
 {
-	u_int			 ax, bx, px, pywrap, endline;
-	int			 matched;
-	struct grid_line	*gl;
+	const char	*text, *at, *found;
+	char		*owned;
+	size_t		 nlen = strlen(needle);
+	u_int		 cell, ecell;
+	int		 matched = 0;
 
-	endline = gd->hsize + gd->sy - 1;
-	for (ax = last; ax > first; ax--) {
-		for (bx = 0; bx < sgd->sx; bx++) {
-			px = ax - 1 + bx;
-			pywrap = py;
-			/* Wrap line. */
-			while (px >= gd->sx && pywrap < endline) {
-				gl = grid_get_line(gd, pywrap);
-				if (~gl->flags & GRID_LINE_WRAPPED)
-					break;
-				px -= gd->sx;
-				pywrap++;
-			}
-			/* We have run off the end of the grid. */
-			if (px >= gd->sx)
-				break;
-			matched = window_copy_search_compare(gd, px, pywrap,
-			    sgd, bx, cis);
-			if (!matched)
+	if (nlen == 0 || first >= last)
+		return (0);
+
+	text = window_copy_search_text(data, gd, py, &owned);
+	at = text + window_copy_search_celloff(gd, py, first);
+	for (;;) {
+		if (cis)
+			found = strcasestr(at, needle);
+		else
+			found = strstr(at, needle);
+		if (found == NULL)
+			break;
+		if (window_copy_search_offset(gd, py, found - text,
+		    &cell) == 0) {
+			if (cell >= last)
 				break;
+			if (cell >= first &&
+			    window_copy_search_offset(gd, py,
+			    (found - text) + nlen, &ecell) == 0) {
+				*ppx = cell;
+				matched = 1;
+			}
 		}
-		if (bx == sgd->sx) {
-			*ppx = ax - 1;
-			return (1);
-		}
+		at = found + 1;
 	}
-	return (0);
+	free(owned);
+	return (matched);
 }
 
 static int
-window_copy_search_lr_regex(struct grid *gd, u_int *ppx, u_int *psx, u_int py,
-    u_int first, u_int last, regex_t *reg)
+window_copy_search_lr_regex(struct window_copy_mode_data *data,
+    struct grid *gd, u_int *ppx, u_int *psx, u_int py, u_int first, u_int last,
+    regex_t *reg)
 {
 	int			eflags = 0;
-	u_int			endline, foundx, foundy, len, pywrap, size = 1;
-	char		       *buf;
+	u_int			endline, foundx, foundy, len, pywrap;
+	const char	       *text, *buf;
+	char		       *owned;
 	regmatch_t		regmatch;
 	struct grid_line       *gl;
 
@@ -2465,18 +2658,16 @@ window_copy_search_lr_regex(struct grid *gd, u_int *ppx, u_int *psx, u_int py,
 		eflags |= REG_NOTBOL;
 
 	/* Need to look at the entire string. */
-	buf = xmalloc(size);
-	buf[0] = '\0';
-	buf = window_copy_stringify(gd, py, first, gd->sx, buf, &size);
+	text = window_copy_search_text(data, gd, py, &owned);
+	buf = text + window_copy_search_celloff(gd, py, first);
 	len = gd->sx - first;
 	endline = gd->hsize + gd->sy - 1;
 	pywrap = py;
-	while (buf != NULL && pywrap <= endline) {
+	while (pywrap <= endline) {
 		gl = grid_get_line(gd, pywrap);
 		if (~gl->flags & GRID_LINE_WRAPPED)
 			break;
 		pywrap++;
-		buf = window_copy_stringify(gd, pywrap, 0, gd->sx, buf, &size);
 		len += gd->sx;
 	}
 
@@ -2497,24 +2688,26 @@ window_copy_search_lr_regex(struct grid *gd, u_int *ppx, u_int *psx, u_int py,
 				foundy--;
 			}
 			*psx -= *ppx;
-			free(buf);
+			free(owned);
 			return (1);
 		}
 	}
 
-	free(buf);
+	free(owned);
 	*ppx = 0;
 	*psx = 0;
 	return (0);
 }
 
 static int
-window_copy_search_rl_regex(struct grid *gd, u_int *ppx, u_int *psx, u_int py,
-    u_int first, u_int last, regex_t *reg)
+window_copy_search_rl_regex(struct window_copy_mode_data *data,
+    struct grid *gd, u_int *ppx, u_int *psx, u_int py, u_int first, u_int last,
+    regex_t *reg)
 {
 	int			eflags = 0;
-	u_int			endline, len, pywrap, size = 1;
-	char		       *buf;
+	u_int			endline, len, pywrap;
+	const char	       *text, *buf;
+	char		       *owned;
 	struct grid_line       *gl;
 
 	/* Set flags for regex search. */
@@ -2522,29 +2715,27 @@ window_copy_search_rl_regex(struct grid *gd, u_int *ppx, u_int *psx, u_int py,
 		eflags |= REG_NOTBOL;
 
 	/* Need to look at the entire string. */
-	buf = xmalloc(size);
-	buf[0] = '\0';
-	buf = window_copy_stringify(gd, py, first, gd->sx, buf, &size);
+	text = window_copy_search_text(data, gd, py, &owned);
+	buf = text + window_copy_search_celloff(gd, py, first);
 	len = gd->sx - first;
 	endline = gd->hsize + gd->sy - 1;
 	pywrap = py;
-	while (buf != NULL && (pywrap <= endline)) {
+	while (pywrap <= endline) {
 		gl = grid_get_line(gd, pywrap);
 		if (~gl->flags & GRID_LINE_WRAPPED)
 			break;
 		pywrap++;
-		buf = window_copy_stringify(gd, pywrap, 0, gd->sx, buf, &size);
 		len += gd->sx;
 	}
 
 	if (window_copy_last_regex(gd, py, first, last, len, ppx, psx, buf,
 	    reg, eflags))
 	{
-		free(buf);
+		free(owned);
 		return (1);
 	}
 
-	free(buf);
+	free(owned);
 	*ppx = 0;
 	*psx = 0;
 	return (0);
@@ -2797,15 +2988,17 @@ window_copy_search_jump(struct window_mode_entry *wme, struct grid *gd,
     struct grid *sgd, u_int fx, u_int fy, u_int endline, int cis, int wrap,
     int direction, int regex)
 {
+	struct window_copy_mode_data	*data = wme->data;
 	u_int	 i, px, sx, ssize = 1;
 	int	 found = 0, cflags = REG_EXTENDED;
 	char	*sbuf;
 	regex_t	 reg;
 
+	/* Extract the search string once. */
+	sbuf = xmalloc(ssize);
+	sbuf[0] = '\0';
+	sbuf = window_copy_stringify(sgd, 0, 0, sgd->sx, sbuf, &ssize);
 	if (regex) {
-		sbuf = xmalloc(ssize);
-		sbuf[0] = '\0';
-		sbuf = window_copy_stringify(sgd, 0, 0, sgd->sx, sbuf, &ssize);
 		if (cis)
 			cflags |= REG_ICASE;
 		if (regcomp(&reg, sbuf, cflags) != 0) {
@@ -2817,10 +3010,10 @@ window_copy_search_jump(struct window_mode_entry *wme, struct grid *gd,
 	if (direction) {
 		for (i = fy; i <= endline; i++) {
 			if (regex) {
-				found = window_copy_search_lr_regex(gd,
+				found = window_copy_search_lr_regex(data, gd,
 				    &px, &sx, i, fx, gd->sx, &reg);
 			} else {
-				found = window_copy_search_lr(gd, sgd,
+				found = window_copy_search_lr(data, gd, sbuf,
 				    &px, i, fx, gd->sx, cis);
 			}
 			if (found)
@@ -2830,10 +3023,10 @@ window_copy_search_jump(struct window_mode_entry *wme, struct grid *gd,
 	} else {
 		for (i = fy + 1; endline < i; i--) {
 			if (regex) {
-				found = window_copy_search_rl_regex(gd,
+				found = window_copy_search_rl_regex(data, gd,
 				    &px, &sx, i - 1, 0, fx + 1, &reg);
 			} else {
-				found = window_copy_search_rl(gd, sgd,
+				found = window_copy_search_rl(data, gd, sbuf,
 				    &px, i - 1, 0, fx + 1, cis);
 			}
 			if (found) {
@@ -2843,10 +3036,9 @@ window_copy_search_jump(struct window_mode_entry *wme, struct grid *gd,
 			fx = gd->sx - 1;
 		}
 	}
-	if (regex) {
-		free(sbuf);
+	free(sbuf);
+	if (regex)
 		regfree(&reg);
-	}
 
 	if (found) {
 		window_copy_scroll_to(wme, px, i);
@@ -2925,6 +3117,119 @@ window_copy_get_time(void)
 	return ((tv.tv_sec * 1000ULL) + (tv.tv_usec / 1000ULL));
 }
 
+static u_int
+window_copy_search_mark_line(struct window_mode_entry *wme, u_int py,
+    int counting)
+{
+	struct window_copy_mode_data	*data = wme->data;
+	struct grid			*gd = data->backing->grid;
+	u_int				 px = 0, b, i, n = 0;
+	u_int				 width = data->searchwidth;
+	int				 found;
+
+	for (;;) {
+		if (data->searchhasreg) {
+			found = window_copy_search_lr_regex(data, gd,
+			    &px, &width, py, px, gd->sx, &data->searchreg);
+		} else {
+			found = window_copy_search_lr(data, gd,
+			    data->searchneedle, &px, py, px, gd->sx,
+			    data->searchcis);
+		}
+		if (!found)
+			break;
+
+		n++;
+		if (counting &&
+		    px == data->cx &&
+		    py == gd->hsize + data->cy - data->oy)
+			data->searchwhich = data->searchnfound + n;
+
+		b = (py * gd->sx) + px;
+		for (i = b; i < b + width; i++)
+			data->searchmark[i] = data->searchgen;
+		if (data->searchgen == UCHAR_MAX)
+			data->searchgen = 1;
+		else
+			data->searchgen++;
+
+		px++;
+	}
+	return (n);
+}
+
+/* Stop a background marks pass and release the compiled pattern. */
+static void
+window_copy_search_cancel(struct window_copy_mode_data *data)
+{
+	if (data->searchrunning) {
+		evtimer_del(&data->searchtimer);
+		data->searchrunning = 0;
+	}
+	if (data->searchhasreg) {
+		regfree(&data->searchreg);
+		data->searchhasreg = 0;
+	}
+	free(data->searchneedle);
+	data->searchneedle = NULL;
+}
+
+/* Count and mark matches for the next chunk of lines. */
+static void
+window_copy_search_timer(__unused int fd, __unused short events, void *arg)
+{
+	struct window_mode_entry	*wme = arg;
+	struct window_copy_mode_data	*data = wme->data;
+	struct grid			*gd = data->backing->grid;
+	struct timeval			 tv = { .tv_usec = 10000 };
+	u_int				 py, end, chunk;
+	uint64_t			 t;
+
+	if (data->searchmark == NULL) {
+		window_copy_search_cancel(data);
+		return;
+	}
+
+	end = gd->hsize + gd->sy;
+	chunk = data->searchpy + WINDOW_COPY_SEARCH_CHUNK;
+	if (chunk > end)
+		chunk = end;
+
+	t = window_copy_get_time();
+	for (py = data->searchpy; py < chunk; py++)
+		data->searchnfound += window_copy_search_mark_line(wme, py, 1);
+	data->searchpy = chunk;
+	data->searchspent += window_copy_get_time() - t;
+
+	if (data->searchspent > WINDOW_COPY_SEARCH_TIMEOUT) {
+		data->timeout = 1;
+		window_copy_search_cancel(data);
+		window_copy_clear_marks(wme);
+		window_copy_redraw_screen(wme);
+		return;
+	}
+
+	if (chunk == end) {
+		if (data->searchwhich != -1) {
+			data->searchthis = 1 + data->searchnfound -
+			    data->searchwhich;
+		} else
+			data->searchthis = -1;
+		data->searchcount = data->searchnfound;
+		data->searchmore = 0;
+		log_debug("%s: %u matches", __func__, data->searchnfound);
+		window_copy_search_cancel(data);
+		window_copy_redraw_screen(wme);
+		return;
+	}
+
+	/* Stream the count so far into the indicator and continue. */
+	data->searchcount = data->searchnfound;
+	data->searchmore = 1;
+	window_copy_redraw_lines(wme, 0, 1);
+	evtimer_add(&data->searchtimer, &tv);
+}
+
 static int
 window_copy_search_marks(struct window_mode_entry *wme, struct screen *ssp,
     int regex)
@@ -2934,13 +3239,10 @@ window_copy_search_marks(struct window_mode_entry *wme, struct screen *ssp,
 	struct screen_write_ctx		 ctx;
 	struct grid			*gd = s->grid;
 	const struct grid_line		*gl;
-	int				 found, cis, which = -1, stopped = 0;
 	int				 cflags = REG_EXTENDED;
-	u_int				 px, py, i, b, nfound = 0, width;
-	u_int				 ssize = 1, start, end;
+	u_int				 py, width, ssize = 1, start, end;
 	char				*sbuf;
-	regex_t				 reg;
-	uint64_t			 stop = 0, tstart, t;
+	struct timeval			 tv = { 0, 0 };
 
 	if (ssp == NULL) {
 		width = screen_write_strlen("%s", data->searchstr);
@@ -2953,116 +3255,56 @@ window_copy_search_marks(struct window_mode_entry *wme, struct screen *ssp,
 	} else
 		width = screen_size_x(ssp);
 
-	cis = window_copy_is_lowercase(data->searchstr);
+	window_copy_search_cancel(data);
+
+	data->searchcis = window_copy_is_lowercase(data->searchstr);
+	data->searchwidth = width;
 
+	/* Extract the search string once. */
+	sbuf = xmalloc(ssize);
+	sbuf[0] = '\0';
+	sbuf = window_copy_stringify(ssp->grid, 0, 0, ssp->grid->sx, sbuf,
+	    &ssize);
 	if (regex) {
-		sbuf = xmalloc(ssize);
-		sbuf[0] = '\0';
-		sbuf = window_copy_stringify(ssp->grid, 0, 0, ssp->grid->sx,
-		    sbuf, &ssize);
-		if (cis)
+		if (data->searchcis)
 			cflags |= REG_ICASE;
-		if (regcomp(&reg, sbuf, cflags) != 0) {
+		if (regcomp(&data->searchreg, sbuf, cflags) != 0) {
 			free(sbuf);
+			if (ssp == &ss)
+				screen_free(&ss);
 			return (0);
 		}
+		data->searchhasreg = 1;
 	}
-	tstart = window_copy_get_time();
+	data->searchneedle = sbuf;
 
-	start = 0;
-	end = gd->hsize + gd->sy;
-	stop = window_copy_get_time() + WINDOW_COPY_SEARCH_ALL_TIMEOUT;
-
-again:
 	free(data->searchmark);
 	data->searchmark = xcalloc(gd->hsize + gd->sy, gd->sx);
 	data->searchgen = 1;
 
-	for (py = start; py < end; py++) {
-		px = 0;
-		for (;;) {
-			if (regex) {
-				found = window_copy_search_lr_regex(gd,
-				    &px, &width, py, px, gd->sx, &reg);
-				if (!found)
-					break;
-			} else {
-				found = window_copy_search_lr(gd, ssp->grid,
-				    &px, py, px, gd->sx, cis);
-				if (!found)
-					break;
-			}
-
-			nfound++;
-			if (px == data->cx &&
-			    py == gd->hsize + data->cy - data->oy)
-				which = nfound;
-
-			b = (py * gd->sx) + px;
-			for (i = b; i < b + width; i++)
-				data->searchmark[i] = data->searchgen;
-			if (data->searchgen == UCHAR_MAX)
-				data->searchgen = 1;
-			else
-				data->searchgen++;
-
-			px++;
-		}
-
-		t = window_copy_get_time();
-		if (t - tstart > WINDOW_COPY_SEARCH_TIMEOUT) {
-			data->timeout = 1;
-			break;
-		}
-		if (stop != 0 && t > stop) {
-			stopped = 1;
+	/* Mark the visible region first so feedback is immediate. */
+	for (start = gd->hsize - data->oy; start > 0; start--) {
+		gl = grid_peek_line(gd, start - 1);
+		if (~gl->flags & GRID_LINE_WRAPPED)
 			break;
-		}
-	}
-	if (data->timeout) {
-		window_copy_clear_marks(wme);
-		goto out;
-	}
-
-	if (stopped && stop != 0) {
-		/* Try again but just the visible context. */
-		for (start = gd->hsize - data->oy; start > 0; start--) {
-			gl = grid_peek_line(gd, start - 1);
-			if (~gl->flags & GRID_LINE_WRAPPED)
-				break;
-		}
-		end = gd->hsize - data->oy + gd->sy;
-		stop = 0;
-		goto again;
-	}
-
-	if (stopped) {
-		data->searchthis = -1;
-		if (nfound > 1000)
-			data->searchcount = 1000;
-		else if (nfound > 100)
-			data->searchcount = 100;
-		else if (nfound > 10)
-			data->searchcount = 10;
-		else
-			data->searchcount = -1;
-		data->searchmore = 1;
-	} else {
-		if (which != -1)
-			data->searchthis = 1 + nfound - which;
-		else
-			data->searchthis = -1;
-		data->searchcount = nfound;
-		data->searchmore = 0;
 	}
+	end = gd->hsize - data->oy + gd->sy;
+	for (py = start; py < end; py++)
+		window_copy_search_mark_line(wme, py, 0);
+
+	/* Count and mark the whole grid in the background. */
+	data->searchcount = -1;
+	data->searchthis = -1;
+	data->searchmore = 1;
+	data->searchnfound = 0;
+	data->searchwhich = -1;
+	data->searchpy = 0;
+	data->searchspent = 0;
+	data->searchrunning = 1;
+	evtimer_add(&data->searchtimer, &tv);
 
-out:
 	if (ssp == &ss)
 		screen_free(&ss);
-	if (regex) {
-		free(sbuf);
-		regfree(&reg);
-	}
 	return (1);
 }
 
@@ -3071,6 +3313,7 @@ window_copy_clear_marks(struct window_mode_entry *wme)
 {
 	struct window_copy_mode_data	*data = wme->data;
 
+	window_copy_search_cancel(data);
 	free(data->searchmark);
 	data->searchmark = NULL;
 }
@@ -3315,7 +3558,7 @@ window_copy_write_lines(struct window_mode_entry *wme,
 	u_int	yy;
 
 	for (yy = py; yy < py + ny; yy++)
-		window_copy_write_line(wme, ctx, py);
+		window_copy_write_line(wme, ctx, yy);
 }
 
 static void
@@ -3541,15 +3784,15 @@ window_copy_update_selection(struct window_mode_entry *wme, int may_redraw,
 }
 
 static int
-window_copy_set_selection(struct window_mode_entry *wme, int may_redraw,
-    int no_reset)
+window_copy_set_selection(struct window_mode_entry *wme,
+    __unused int may_redraw, int no_reset)
 {
 	struct window_pane		*wp = wme->wp;
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*s = &data->screen;
 	struct options			*oo = wp->window->options;
 	struct grid_cell		 gc;
-	u_int				 sx, sy, cy, endsx, endsy;
+	u_int				 sx, sy, endsx, endsy;
 	int				 startrelpos, endrelpos;
 
 	window_copy_synchronize_cursor(wme, no_reset);
@@ -3568,6 +3811,7 @@ window_copy_set_selection(struct window_mode_entry *wme, int may_redraw,
 	if (startrelpos == endrelpos &&
 	    startrelpos != WINDOW_COPY_REL_POS_ON_SCREEN) {
 		screen_hide_selection(s);
+		wp->flags |= PANE_REDRAW;
 		return (0);
 	}
 
@@ -3577,28 +3821,12 @@ window_copy_set_selection(struct window_mode_entry *wme, int may_redraw,
 	screen_set_selection(s, sx, sy, endsx, endsy, data->rectflag,
 	    data->modekeys, &gc);
 
-	if (data->rectflag && may_redraw) {
-		/*
-		 * Can't rely on the caller to redraw the right lines for
-		 * rectangle selection - find the highest line and the number
-		 * of lines, and redraw just past that in both directions
-		 */
-		cy = data->cy;
-		if (data->cursordrag == CURSORDRAG_ENDSEL) {
-			if (sy < cy)
-				window_copy_redraw_lines(wme, sy, cy - sy + 1);
-			else
-				window_copy_redraw_lines(wme, cy, sy - cy + 1);
-		} else {
-			if (endsy < cy) {
-				window_copy_redraw_lines(wme, endsy,
-				    cy - endsy + 1);
-			} else {
-				window_copy_redraw_lines(wme, cy,
-				    endsy - cy + 1);
-			}
-		}
-	}
+	/*
+	 * Selection is applied as an overlay when lines are drawn to the
+	 * terminal, so changing it only needs the pane redrawn; lines whose
+	 * appearance is unchanged are skipped by the redraw.
+	 */
+	wp->flags |= PANE_REDRAW;
 
 	return (1);
 }
@@ -3836,7 +4064,7 @@ window_copy_copy_line(struct window_mode_entry *wme, char **buf, size_t *off,
 
 	if (sx < ex) {
 		for (i = sx; i < ex; i++) {
-			grid_get_cell(gd, i, sy, &gc);
+			grid_get_line_cell(gd, gl, i, &gc);
 			if (gc.flags & GRID_FLAG_PADDING)
 				continue;
 			utf8_copy(&ud, &gc.data);
@@ -3868,6 +4096,7 @@ window_copy_clear_selection(struct window_mode_entry *wme)
 	u_int				px, py;
 
 	screen_clear_selection(&data->screen);
+	wme->wp->flags |= PANE_REDRAW;
 
 	data->cursordrag = CURSORDRAG_NONE;
 	data->lineflag = LINE_SEL_NONE;
@@ -3880,7 +4109,7 @@ window_copy_clear_selection(struct window_mode_entry *wme)
 }
 
 static int
-window_copy_in_set(struct window_mode_entry *wme, u_int px, u_int py,
+window_copy_in_set1(struct window_mode_entry *wme, u_int px, u_int py,
     const char *set)
 {
 	struct window_copy_mode_data	*data = wme->data;
@@ -3892,6 +4121,53 @@ window_copy_in_set(struct window_mode_entry *wme, u_int px, u_int py,
 	return (utf8_cstrhas(set, &gc.data));
 }
 
+/* Drop all cached word classifications (the backing has changed). */
+static void
+window_copy_word_cache_clear(struct window_copy_mode_data *data)
+{
+	u_int	i;
+
+	for (i = 0; i < WINDOW_COPY_WORD_CACHE; i++) {
+		free(data->wordcache[i].set);
+		data->wordcache[i].set = NULL;
+		free(data->wordcache[i].flags);
+		data->wordcache[i].flags = NULL;
+	}
+}
+
+static int
+window_copy_in_set(struct window_mode_entry *wme, u_int px, u_int py,
+    const char *set)
+{
+	struct window_copy_mode_data	*data = wme->data;
+	struct window_copy_word_cache	*wcc;
+	u_int				 i, nx = data->backing->grid->sx;
+
+	if (px >= nx)
+		return (window_copy_in_set1(wme, px, py, set));
+
+	for (i = 0; i < WINDOW_COPY_WORD_CACHE; i++) {
+		wcc = &data->wordcache[i];
+		if (wcc->set != NULL &&
+		    wcc->py == py &&
+		    strcmp(wcc->set, set) == 0)
+			return (wcc->flags[px]);
+	}
+
+	/* Not cached: classify the whole line into the next slot. */
+	wcc = &data->wordcache[data->wordcachenext];
+	data->wordcachenext = (data->wordcachenext + 1) %
+	    WINDOW_COPY_WORD_CACHE;
+	free(wcc->set);
+	wcc->set = xstrdup(set);
+	wcc->py = py;
+	wcc->nx = nx;
+	wcc->flags = xrealloc(wcc->flags, nx);
+	for (i = 0; i < nx; i++)
+		wcc->flags[i] = window_copy_in_set1(wme, i, py, set);
+	return (wcc->flags[px]);
+}
+
 static u_int
 window_copy_find_length(struct window_mode_entry *wme, u_int py)
 {
@@ -3983,6 +4259,7 @@ window_copy_other_end(struct window_mode_entry *wme)
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*s = &data->screen;
 	u_int				 selx, sely, cy, yy, hsize;
+	u_int				 old_oy = data->oy;
 
 	if (s->sel == NULL && data->lineflag == LINE_SEL_NONE)
 		return;
@@ -4025,7 +4302,14 @@ window_copy_other_end(struct window_mode_entry *wme)
 		data->cy = cy + sely - yy;
 
 	window_copy_update_selection(wme, 1, 1);
-	window_copy_redraw_screen(wme);
+	/*
+	 * If the view didn't scroll, only the lines between the two selection
+	 * ends can have changed.
+	 */
+	if (data->oy == old_oy)
+		window_copy_redraw_selection(wme, cy);
+	else
+		window_copy_redraw_screen(wme);
 }
 
 static void
@@ -4177,28 +4461,88 @@ window_copy_cursor_down(struct window_mode_entry *wme, int scroll_only)
 		window_copy_cursor_start_of_line(wme);
 }
 
+/*
+ * Find the jump character in cells [first, last) of the row at py, searching
+ * backwards if back is set. A row without extended cells is one byte per
+ * cell, so the scan runs over the cached line text instead of fetching every
+ * cell; rows holding UTF-8 or padding fall back to the cell walk.
+ */
+static int
+window_copy_jump_scan(struct window_mode_entry *wme, u_int py, u_int first,
+    u_int last, int back, u_int *ppx)
+{
+	struct window_copy_mode_data	*data = wme->data;
+	struct grid			*gd = data->backing->grid;
+	const struct grid_line		*gl;
+	const char			*text, *found;
+	struct grid_cell		 gc;
+	size_t				 len;
+	u_int				 px;
+
+	if (first >= last)
+		return (0);
+
+	gl = grid_peek_line(gd, py);
+	if (~gl->flags & GRID_LINE_EXTENDED) {
+		text = window_copy_search_line(data, gd, py);
+		len = strlen(text);
+		if (last > len)
+			last = len;
+		if (first >= last)
+			return (0);
+		if (back) {
+			for (px = last; px > first; px--) {
+				if (text[px - 1] == data->jumpchar) {
+					*ppx = px - 1;
+					return (1);
+				}
+			}
+			return (0);
+		}
+		found = memchr(text + first, data->jumpchar, last - first);
+		if (found == NULL)
+			return (0);
+		*ppx = found - text;
+		return (1);
+	}
+
+	if (back) {
+		for (px = last; px > first; px--) {
+			grid_get_cell(gd, px - 1, py, &gc);
+			if (!(gc.flags & GRID_FLAG_PADDING) &&
+			    gc.data.size == 1 &&
+			    *gc.data.data == data->jumpchar) {
+				*ppx = px - 1;
+				return (1);
+			}
+		}
+		return (0);
+	}
+	for (px = first; px < last; px++) {
+		grid_get_cell(gd, px, py, &gc);
+		if (!(gc.flags & GRID_FLAG_PADDING) &&
+		    gc.data.size == 1 && *gc.data.data == data->jumpchar) {
+			*ppx = px;
+			return (1);
+		}
+	}
+	return (0);
+}
+
 static void
 window_copy_cursor_jump(struct window_mode_entry *wme)
 {
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*back_s = data->backing;
-	struct grid_cell		 gc;
 	u_int				 px, py, xx;
 
-	px = data->cx + 1;
 	py = screen_hsize(back_s) + data->cy - data->oy;
 	xx = window_copy_find_length(wme, py);
 
-	while (px < xx) {
-		grid_get_cell(back_s->grid, px, py, &gc);
-		if (!(gc.flags & GRID_FLAG_PADDING) &&
-		    gc.data.size == 1 && *gc.data.data == data->jumpchar) {
-			window_copy_update_cursor(wme, px, data->cy);
-			if (window_copy_update_selection(wme, 1, 0))
-				window_copy_redraw_lines(wme, data->cy, 1);
-			return;
-		}
-		px++;
+	if (window_copy_jump_scan(wme, py, data->cx + 1, xx, 0, &px)) {
+		window_copy_update_cursor(wme, px, data->cy);
+		if (window_copy_update_selection(wme, 1, 0))
+			window_copy_redraw_lines(wme, data->cy, 1);
 	}
 }
 
@@ -4207,27 +4551,15 @@ window_copy_cursor_jump_back(struct window_mode_entry *wme)
 {
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*back_s = data->backing;
-	struct grid_cell		 gc;
-	u_int				 px, py;
+	u_int				 px, py, last;
 
-	px = data->cx;
 	py = screen_hsize(back_s) + data->cy - data->oy;
+	last = (data->cx > 0) ? data->cx : 1;
 
-	if (px > 0)
-		px--;
-
-	for (;;) {
-		grid_get_cell(back_s->grid, px, py, &gc);
-		if (!(gc.flags & GRID_FLAG_PADDING) &&
-		    gc.data.size == 1 && *gc.data.data == data->jumpchar) {
-			window_copy_update_cursor(wme, px, data->cy);
-			if (window_copy_update_selection(wme, 1, 0))
-				window_copy_redraw_lines(wme, data->cy, 1);
-			return;
-		}
-		if (px == 0)
-			break;
-		px--;
+	if (window_copy_jump_scan(wme, py, 0, last, 1, &px)) {
+		window_copy_update_cursor(wme, px, data->cy);
+		if (window_copy_update_selection(wme, 1, 0))
+			window_copy_redraw_lines(wme, data->cy, 1);
 	}
 }
 
@@ -4236,23 +4568,15 @@ window_copy_cursor_jump_to(struct window_mode_entry *wme)
 {
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*back_s = data->backing;
-	struct grid_cell		 gc;
 	u_int				 px, py, xx;
 
-	px = data->cx + 2;
 	py = screen_hsize(back_s) + data->cy - data->oy;
 	xx = window_copy_find_length(wme, py);
 
-	while (px < xx) {
-		grid_get_cell(back_s->grid, px, py, &gc);
-		if (!(gc.flags & GRID_FLAG_PADDING) &&
-		    gc.data.size == 1 && *gc.data.data == data->jumpchar) {
-			window_copy_update_cursor(wme, px - 1, data->cy);
-			if (window_copy_update_selection(wme, 1, 0))
-				window_copy_redraw_lines(wme, data->cy, 1);
-			return;
-		}
-		px++;
+	if (window_copy_jump_scan(wme, py, data->cx + 2, xx, 0, &px)) {
+		window_copy_update_cursor(wme, px - 1, data->cy);
+		if (window_copy_update_selection(wme, 1, 0))
+			window_copy_redraw_lines(wme, data->cy, 1);
 	}
 }
 
@@ -4261,30 +4585,15 @@ window_copy_cursor_jump_to_back(struct window_mode_entry *wme)
 {
 	struct window_copy_mode_data	*data = wme->data;
 	struct screen			*back_s = data->backing;
-	struct grid_cell		 gc;
-	u_int				 px, py;
+	u_int				 px, py, last;
 
-	px = data->cx;
 	py = screen_hsize(back_s) + data->cy - data->oy;
+	last = (data->cx >= 2) ? data->cx - 1 : 1;
 
-	if (px > 0)
-		px--;
-
-	if (px > 0)
-		px--;
-
-	for (;;) {
-		grid_get_cell(back_s->grid, px, py, &gc);
-		if (!(gc.flags & GRID_FLAG_PADDING) &&
-		    gc.data.size == 1 && *gc.data.data == data->jumpchar) {
-			window_copy_update_cursor(wme, px + 1, data->cy);
-			if (window_copy_update_selection(wme, 1, 0))
-				window_copy_redraw_lines(wme, data->cy, 1);
-			return;
-		}
-		if (px == 0)
-			break;
-		px--;
+	if (window_copy_jump_scan(wme, py, 0, last, 1, &px)) {
+		window_copy_update_cursor(wme, px + 1, data->cy);
+		if (window_copy_update_selection(wme, 1, 0))
+			window_copy_redraw_lines(wme, data->cy, 1);
 	}
 }
 
@@ -4594,6 +4903,51 @@ window_copy_scroll_down(struct window_mode_entry *wme, u_int ny)
 	screen_write_stop(&ctx);
 }
 
+/*
+ * Draw after the view offset has moved from oldoy, scrolling the part of the
+ * screen that survives and writing only the newly exposed lines. A selection
+ * is anchored to content, so the rows the cursor crossed would be left stale
+ * by a plain scroll; fall back to a full redraw then, and when the view did
+ * not move or nothing on screen survives the move.
+ */
+static void
+window_copy_scroll_draw(struct window_mode_entry *wme, u_int oldoy)
+{
+	struct window_pane		*wp = wme->wp;
+	struct window_copy_mode_data	*data = wme->data;
+	struct screen			*s = &data->screen;
+	struct screen_write_ctx		 ctx;
+	u_int				 ny, sy = screen_size_y(s);
+
+	ny = (data->oy > oldoy) ? data->oy - oldoy : oldoy - data->oy;
+	if (s->sel != NULL || ny == 0 || ny >= sy) {
+		window_copy_redraw_screen(wme);
+		return;
+	}
+
+	screen_write_start_pane(&ctx, wp, NULL);
+	screen_write_cursormove(&ctx, 0, 0, 0);
+	if (data->oy > oldoy) {
+		/* The view moved up into history: content scrolls down. */
+		screen_write_insertline(&ctx, ny, 8);
+		window_copy_write_lines(wme, &ctx, 0, ny);
+	} else {
+		/* The view moved down: content scrolls up. */
+		screen_write_deleteline(&ctx, ny, 8);
+		window_copy_write_lines(wme, &ctx, sy - ny, ny);
+	}
+
+	/* Rewrite the lines carrying the position indicator. */
+	window_copy_write_line(wme, &ctx, 0);
+	if (sy > 1)
+		window_copy_write_line(wme, &ctx, 1);
+	if (sy > 3)
+		window_copy_write_line(wme, &ctx, sy - 2);
+
+	screen_write_cursormove(&ctx, data->cx, data->cy, 0);
+	screen_write_stop(&ctx);
+}
+
 static void
 window_copy_rectangle_toggle(struct window_mode_entry *wme)
 {
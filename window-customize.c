@@ -88,6 +88,20 @@ struct window_customize_itemdata {
 	int					 idx;
 };
 
+RB_HEAD(window_customize_cache, window_customize_cachedata);
+
+/*
+ * Cached display text for one option, keyed by its tree tag. Expanding the
+ * display format for every option in every scope is what makes a rebuild
+ * expensive, so the result is kept and reused while the owning scope is
+ * unchanged since the last build.
+ */
+struct window_customize_cachedata {
+	uint64_t				  tag;
+	char					 *text;
+	RB_ENTRY(window_customize_cachedata)	  entry;
+};
+
 struct window_customize_modedata {
 	struct window_pane			 *wp;
 	int					  dead;
@@ -100,9 +114,69 @@ struct window_customize_modedata {
 	struct window_customize_itemdata	**item_list;
 	u_int					  item_size;
 
+	struct window_customize_cache		  cache;
+	struct options				 *snap_oo[3][3];
+	u_int					  snap_changes[3];
+	int					  snap_valid[3];
+
 	struct cmd_find_state			  fs;
 };
 
+static int
+window_customize_cache_cmp(struct window_customize_cachedata *wcc1,
+    struct window_customize_cachedata *wcc2)
+{
+	if (wcc1->tag < wcc2->tag)
+		return (-1);
+	if (wcc1->tag > wcc2->tag)
+		return (1);
+	return (0);
+}
+RB_GENERATE_STATIC(window_customize_cache, window_customize_cachedata, entry,
+    window_customize_cache_cmp);
+
+static const char *
+window_customize_cache_get(struct window_customize_modedata *data,
+    uint64_t tag)
+{
+	struct window_customize_cachedata	 find, *wcc;
+
+	find.tag = tag;
+	wcc = RB_FIND(window_customize_cache, &data->cache, &find);
+	if (wcc == NULL)
+		return (NULL);
+	return (wcc->text);
+}
+
+static void
+window_customize_cache_put(struct window_customize_modedata *data,
+    uint64_t tag, const char *text)
+{
+	struct window_customize_cachedata	 find, *wcc;
+
+	find.tag = tag;
+	wcc = RB_FIND(window_customize_cache, &data->cache, &find);
+	if (wcc == NULL) {
+		wcc = xcalloc(1, sizeof *wcc);
+		wcc->tag = tag;
+		RB_INSERT(window_customize_cache, &data->cache, wcc);
+	} else
+		free(wcc->text);
+	wcc->text = xstrdup(text);
+}
+
+static void
+window_customize_cache_free(struct window_customize_modedata *data)
+{
+	struct window_customize_cachedata	*wcc, *wcc1;
+
+	RB_FOREACH_SAFE(wcc, window_customize_cache, &data->cache, wcc1) {
+		RB_REMOVE(window_customize_cache, &data->cache, wcc);
+		free(wcc->text);
+		free(wcc);
+	}
+}
+
 static uint64_t
 window_customize_get_tag(struct options_entry *o, int idx,
     const struct options_table_entry *oe)
@@ -227,12 +301,13 @@ window_customize_free_item(struct window_customize_itemdata *item)
 static void
 window_customize_build_array(struct window_customize_modedata *data,
     struct mode_tree_item *top, enum window_customize_scope scope,
-    struct options_entry *o, struct format_tree *ft)
+    struct options_entry *o, struct format_tree *ft, int cached)
 {
 	const struct options_table_entry	*oe = options_table_entry(o);
 	struct options				*oo = options_owner(o);
 	struct window_customize_itemdata	*item;
 	struct options_array_item		*ai;
+	const char				*cp;
 	char					*name, *value, *text;
 	u_int					 idx;
 	uint64_t				 tag;
@@ -242,9 +317,7 @@ window_customize_build_array(struct window_customize_modedata *data,
 		idx = options_array_item_index(ai);
 
 		xasprintf(&name, "%s[%u]", options_name(o), idx);
-		format_add(ft, "option_name", "%s", name);
-		value = options_to_string(o, idx, 0);
-		format_add(ft, "option_value", "%s", value);
+		tag = window_customize_get_tag(o, idx, oe);
 
 		item = window_customize_add_item(data);
 		item->scope = scope;
@@ -252,8 +325,21 @@ window_customize_build_array(struct window_customize_modedata *data,
 		item->name = xstrdup(options_name(o));
 		item->idx = idx;
 
+		if (cached &&
+		    (cp = window_customize_cache_get(data, tag)) != NULL) {
+			mode_tree_add(data->data, top, item, tag, name, cp,
+			    -1);
+			free(name);
+			ai = options_array_next(ai);
+			continue;
+		}
+
+		format_add(ft, "option_name", "%s", name);
+		value = options_to_string(o, idx, 0);
+		format_add(ft, "option_value", "%s", value);
+
 		text = format_expand(ft, data->format);
-		tag = window_customize_get_tag(o, idx, oe);
+		window_customize_cache_put(data, tag, text);
 		mode_tree_add(data->data, top, item, tag, name, text, -1);
 		free(text);
 
@@ -268,11 +354,11 @@ static void
 window_customize_build_option(struct window_customize_modedata *data,
     struct mode_tree_item *top, enum window_customize_scope scope,
     struct options_entry *o, struct format_tree *ft,
-    const char *filter, struct cmd_find_state *fs)
+    const char *filter, struct cmd_find_state *fs, int cached)
 {
 	const struct options_table_entry	*oe = options_table_entry(o);
 	struct options				*oo = options_owner(o);
-	const char				*name = options_name(o);
+	const char				*name = options_name(o), *cp;
 	struct window_customize_itemdata	*item;
 	char					*text, *expanded, *value;
 	int					 global = 0, array = 0;
@@ -290,6 +376,18 @@ window_customize_build_option(struct window_customize_modedata *data,
 	if (data->hide_global && global)
 		return;
 
+	tag = window_customize_get_tag(o, -1, oe);
+	if (cached && !array &&
+	    (cp = window_customize_cache_get(data, tag)) != NULL) {
+		item = window_customize_add_item(data);
+		item->oo = oo;
+		item->scope = scope;
+		item->name = xstrdup(name);
+		item->idx = -1;
+		mode_tree_add(data->data, top, item, tag, name, cp, 0);
+		return;
+	}
+
 	format_add(ft, "option_name", "%s", name);
 	format_add(ft, "option_is_global", "%d", global);
 	format_add(ft, "option_is_array", "%d", array);
@@ -325,14 +423,15 @@ window_customize_build_option(struct window_customize_modedata *data,
 
 	if (array)
 		text = NULL;
-	else
+	else {
 		text = format_expand(ft, data->format);
-	tag = window_customize_get_tag(o, -1, oe);
+		window_customize_cache_put(data, tag, text);
+	}
 	top = mode_tree_add(data->data, top, item, tag, name, text, 0);
 	free(text);
 
 	if (array)
-		window_customize_build_array(data, top, scope, o, ft);
+		window_customize_build_array(data, top, scope, o, ft, cached);
 }
 
 static void
@@ -367,7 +466,7 @@ window_customize_find_user_options(struct options *oo, const char ***list,
 
 static void
 window_customize_build_options(struct window_customize_modedata *data,
-    const char *title, uint64_t tag,
+    const char *title, uint64_t tag, u_int group,
     enum window_customize_scope scope0, struct options *oo0,
     enum window_customize_scope scope1, struct options *oo1,
     enum window_customize_scope scope2, struct options *oo2,
@@ -376,8 +475,33 @@ window_customize_build_options(struct window_customize_modedata *data,
 	struct mode_tree_item		 *top;
 	struct options_entry		 *o, *loop;
 	const char			**list = NULL, *name;
-	u_int				  size = 0, i;
+	u_int				  size = 0, i, changes;
 	enum window_customize_scope	  scope;
+	int				  cached;
+
+	/*
+	 * If no option in any of the three trees has changed since the last
+	 * build, the expanded text cached for each tag is still valid and the
+	 * format does not need to be expanded again.
+	 */
+	changes = options_get_changes(oo0);
+	if (oo1 != NULL)
+		changes += options_get_changes(oo1);
+	if (oo2 != NULL)
+		changes += options_get_changes(oo2);
+	cached = (filter == NULL &&
+	    data->snap_valid[group] &&
+	    data->snap_oo[group][0] == oo0 &&
+	    data->snap_oo[group][1] == oo1 &&
+	    data->snap_oo[group][2] == oo2 &&
+	    data->snap_changes[group] == changes);
+	if (filter == NULL) {
+		data->snap_valid[group] = 1;
+		data->snap_oo[group][0] = oo0;
+		data->snap_oo[group][1] = oo1;
+		data->snap_oo[group][2] = oo2;
+		data->snap_changes[group] = changes;
+	}
 
 	top = mode_tree_add(data->data, NULL, NULL, tag, title, NULL, 0);
 
@@ -407,7 +531,7 @@ window_customize_build_options(struct window_customize_modedata *data,
 		else
 			scope = scope0;
 		window_customize_build_option(data, top, scope, o, ft, filter,
-		    fs);
+		    fs, cached);
 	}
 	free(list);
 
@@ -431,7 +555,7 @@ window_customize_build_options(struct window_customize_modedata *data,
 		else
 			scope = scope0;
 		window_customize_build_option(data, top, scope, o, ft, filter,
-		    fs);
+		    fs, cached);
 		loop = options_next(loop);
 	}
 }
@@ -540,19 +664,19 @@ window_customize_build(void *modedata,
 	format_add(ft, "is_key", "0");
 
 	window_customize_build_options(data, "Server Options",
-	    (3ULL << 62)|(OPTIONS_TABLE_SERVER << 1)|1,
+	    (3ULL << 62)|(OPTIONS_TABLE_SERVER << 1)|1, 0,
 	    WINDOW_CUSTOMIZE_SERVER, global_options,
 	    WINDOW_CUSTOMIZE_NONE, NULL,
 	    WINDOW_CUSTOMIZE_NONE, NULL,
 	    ft, filter, &fs);
 	window_customize_build_options(data, "Session Options",
-	    (3ULL << 62)|(OPTIONS_TABLE_SESSION << 1)|1,
+	    (3ULL << 62)|(OPTIONS_TABLE_SESSION << 1)|1, 1,
 	    WINDOW_CUSTOMIZE_GLOBAL_SESSION, global_s_options,
 	    WINDOW_CUSTOMIZE_SESSION, fs.s->options,
 	    WINDOW_CUSTOMIZE_NONE, NULL,
 	    ft, filter, &fs);
 	window_customize_build_options(data, "Window & Pane Options",
-	    (3ULL << 62)|(OPTIONS_TABLE_WINDOW << 1)|1,
+	    (3ULL << 62)|(OPTIONS_TABLE_WINDOW << 1)|1, 2,
 	    WINDOW_CUSTOMIZE_GLOBAL_WINDOW, global_w_options,
 	    WINDOW_CUSTOMIZE_WINDOW, fs.w->options,
 	    WINDOW_CUSTOMIZE_PANE, fs.wp->options,
@@ -871,6 +995,7 @@ window_customize_init(struct window_mode_entry *wme, struct cmd_find_state *fs,
 	wme->data = data = xcalloc(1, sizeof *data);
 	data->wp = wp;
 	data->references = 1;
+	RB_INIT(&data->cache);
 
 	memcpy(&data->fs, fs, sizeof data->fs);
 
@@ -902,6 +1027,7 @@ window_customize_destroy(struct window_customize_modedata *data)
 	for (i = 0; i < data->item_size; i++)
 		window_customize_free_item(data->item_list[i]);
 	free(data->item_list);
+	window_customize_cache_free(data);
 
 	free(data->format);
 
@@ -108,11 +108,36 @@ struct window_tree_itemdata {
 	int			pane;
 };
 
+/*
+ * Cached pane preview, only refreshed when the pane content or the preview
+ * size changes.
+ */
+struct window_tree_preview {
+	u_int				 pane_id;
+	u_int				 nx;
+	u_int				 ny;
+
+	u_int				 generation;
+	u_int				 psx;
+	u_int				 psy;
+	u_int				 cx;
+	u_int				 cy;
+	int				 cursor;
+
+	struct screen			 screen;
+	TAILQ_ENTRY(window_tree_preview) entry;
+};
+TAILQ_HEAD(window_tree_previews, window_tree_preview);
+#define WINDOW_TREE_PREVIEW_LIMIT 100
+
 struct window_tree_modedata {
 	struct window_pane		 *wp;
 	int				  dead;
 	int				  references;
 
+	struct window_tree_previews	  previews;
+	u_int				  preview_count;
+
 	struct mode_tree_data		 *data;
 	char				 *format;
 	char				 *command;
@@ -453,20 +478,39 @@ window_tree_build(void *modedata, struct mode_tree_sort_criteria *sort_crit,
 	data->item_list = NULL;
 	data->item_size = 0;
 
+	/*
+	 * When sorting by time, the activity-ordered session list is already
+	 * in order and there is no need to sort.
+	 */
 	l = NULL;
 	n = 0;
-	RB_FOREACH(s, sessions, &sessions) {
-		if (data->squash_groups &&
-		    (sg = session_group_contains(s)) != NULL) {
-			if ((sg == current && s != data->fs.s) ||
-			    (sg != current && s != TAILQ_FIRST(&sg->sessions)))
-				continue;
+	if (sort_crit->field == WINDOW_TREE_BY_TIME)
+		s = TAILQ_FIRST(&session_activity_list);
+	else
+		s = RB_MIN(sessions, &sessions);
+	while (s != NULL) {
+		if (!data->squash_groups ||
+		    (sg = session_group_contains(s)) == NULL ||
+		    !((sg == current && s != data->fs.s) ||
+		    (sg != current && s != TAILQ_FIRST(&sg->sessions)))) {
+			l = xreallocarray(l, n + 1, sizeof *l);
+			l[n++] = s;
 		}
-		l = xreallocarray(l, n + 1, sizeof *l);
-		l[n++] = s;
+		if (sort_crit->field == WINDOW_TREE_BY_TIME)
+			s = TAILQ_NEXT(s, activity_entry);
+		else
+			s = RB_NEXT(sessions, &sessions, s);
 	}
 	window_tree_sort = sort_crit;
-	qsort(l, n, sizeof *l, window_tree_cmp_session);
+	if (sort_crit->field != WINDOW_TREE_BY_TIME)
+		qsort(l, n, sizeof *l, window_tree_cmp_session);
+	else if (sort_crit->reversed) {
+		for (i = 0; i < n / 2; i++) {
+			s = l[i];
+			l[i] = l[n - 1 - i];
+			l[n - 1 - i] = s;
+		}
+	}
 
 	for (i = 0; i < n; i++)
 		window_tree_build_session(l[i], modedata, sort_crit, filter);
@@ -511,6 +555,70 @@ window_tree_draw_label(struct screen_write_ctx *ctx, u_int px, u_int py,
 	screen_write_puts(ctx, gc, "%s", label);
 }
 
+/* Draw a pane preview, reusing the cached copy if the pane is unchanged. */
+static void
+window_tree_draw_preview(struct window_tree_modedata *data,
+    struct window_pane *wp, struct screen_write_ctx *ctx, u_int nx, u_int ny)
+{
+	struct window_tree_preview	*wtp;
+	struct screen			*src = &wp->base;
+	struct screen_write_ctx		 cctx;
+	int				 cursor = !!(src->mode & MODE_CURSOR);
+
+	TAILQ_FOREACH(wtp, &data->previews, entry) {
+		if (wtp->pane_id == wp->id)
+			break;
+	}
+	if (wtp != NULL &&
+	    wtp->nx == nx &&
+	    wtp->ny == ny &&
+	    wtp->generation == wp->generation &&
+	    wtp->psx == screen_size_x(src) &&
+	    wtp->psy == screen_size_y(src) &&
+	    wtp->cx == src->cx &&
+	    wtp->cy == src->cy &&
+	    wtp->cursor == cursor) {
+		log_debug("%s: %%%u hit", __func__, wp->id);
+		TAILQ_REMOVE(&data->previews, wtp, entry);
+		TAILQ_INSERT_HEAD(&data->previews, wtp, entry);
+		screen_write_fast_copy(ctx, &wtp->screen, 0, 0, nx, ny);
+		return;
+	}
+	log_debug("%s: %%%u miss", __func__, wp->id);
+
+	if (wtp != NULL) {
+		TAILQ_REMOVE(&data->previews, wtp, entry);
+		screen_free(&wtp->screen);
+	} else {
+		if (data->preview_count == WINDOW_TREE_PREVIEW_LIMIT) {
+			wtp = TAILQ_LAST(&data->previews,
+			    window_tree_previews);
+			TAILQ_REMOVE(&data->previews, wtp, entry);
+			screen_free(&wtp->screen);
+		} else {
+			wtp = xcalloc(1, sizeof *wtp);
+			data->preview_count++;
+		}
+	}
+	wtp->pane_id = wp->id;
+	wtp->nx = nx;
+	wtp->ny = ny;
+	wtp->generation = wp->generation;
+	wtp->psx = screen_size_x(src);
+	wtp->psy = screen_size_y(src);
+	wtp->cx = src->cx;
+	wtp->cy = src->cy;
+	wtp->cursor = cursor;
+
+	screen_init(&wtp->screen, nx, ny, 0);
+	screen_write_start(&cctx, &wtp->screen);
+	screen_write_preview(&cctx, src, nx, ny);
+	screen_write_stop(&cctx);
+	TAILQ_INSERT_HEAD(&data->previews, wtp, entry);
+
+	screen_write_fast_copy(ctx, &wtp->screen, 0, 0, nx, ny);
+}
+
 static void
 window_tree_draw_session(struct window_tree_modedata *data, struct session *s,
     struct screen_write_ctx *ctx, u_int sx, u_int sy)
@@ -626,7 +734,7 @@ window_tree_draw_session(struct window_tree_modedata *data, struct session *s,
 			width = each - 1;
 
 		screen_write_cursormove(ctx, cx + offset, cy, 0);
-		screen_write_preview(ctx, &w->active->base, width, sy);
+		window_tree_draw_preview(data, w->active, ctx, width, sy);
 
 		xasprintf(&label, " %u:%s ", wl->idx, w->name);
 		if (strlen(label) > width)
@@ -758,7 +866,7 @@ window_tree_draw_window(struct window_tree_modedata *data, struct session *s,
 			width = each - 1;
 
 		screen_write_cursormove(ctx, cx + offset, cy, 0);
-		screen_write_preview(ctx, &wp->base, width, sy);
+		window_tree_draw_preview(data, wp, ctx, width, sy);
 
 		if (window_pane_index(wp, &pane_idx) != 0)
 			pane_idx = loop;
@@ -800,7 +908,7 @@ window_tree_draw(void *modedata, void *itemdata, struct screen_write_ctx *ctx,
 		window_tree_draw_window(modedata, sp, wlp->window, ctx, sx, sy);
 		break;
 	case WINDOW_TREE_PANE:
-		screen_write_preview(ctx, &wp->base, sx, sy);
+		window_tree_draw_preview(modedata, wp, ctx, sx, sy);
 		break;
 	}
 }
@@ -865,6 +973,7 @@ window_tree_init(struct window_mode_entry *wme, struct cmd_find_state *fs,
 	wme->data = data = xcalloc(1, sizeof *data);
 	data->wp = wp;
 	data->references = 1;
+	TAILQ_INIT(&data->previews);
 
 	if (args_has(args, 's'))
 		data->type = WINDOW_TREE_SESSION;
@@ -901,11 +1010,18 @@ window_tree_init(struct window_mode_entry *wme, struct cmd_find_state *fs,
 static void
 window_tree_destroy(struct window_tree_modedata *data)
 {
-	u_int	i;
+	struct window_tree_preview	*wtp, *wtp1;
+	u_int				 i;
 
 	if (--data->references != 0)
 		return;
 
+	TAILQ_FOREACH_SAFE(wtp, &data->previews, entry, wtp1) {
+		TAILQ_REMOVE(&data->previews, wtp, entry);
+		screen_free(&wtp->screen);
+		free(wtp);
+	}
+
 	for (i = 0; i < data->item_size; i++)
 		window_tree_free_item(data->item_list[i]);
 	free(data->item_list);
@@ -1054,7 +1170,7 @@ window_tree_kill_each(__unused void *modedata, void *itemdata,
 		break;
 	case WINDOW_TREE_WINDOW:
 		if (wl != NULL)
-			server_kill_window(wl->window);
+			server_kill_window(wl->window, 0);
 		break;
 	case WINDOW_TREE_PANE:
 		if (wp != NULL)
@@ -1076,6 +1192,8 @@ window_tree_kill_current_callback(struct client *c, void *modedata,
 		return (0);
 
 	window_tree_kill_each(data, mode_tree_get_current(mtd), c, KEYC_NONE);
+	server_renumber_all();
+	recalculate_sizes();
 
 	data->references++;
 	cmdq_append(c, cmdq_get_callback(window_tree_command_done, data));
@@ -1096,6 +1214,8 @@ window_tree_kill_tagged_callback(struct client *c, void *modedata,
 		return (0);
 
 	mode_tree_each_tagged(mtd, window_tree_kill_each, c, KEYC_NONE, 1);
+	server_renumber_all();
+	recalculate_sizes();
 
 	data->references++;
 	cmdq_append(c, cmdq_get_callback(window_tree_command_done, data));
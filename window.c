@@ -61,6 +61,14 @@ static u_int	next_window_pane_id;
 static u_int	next_window_id;
 static u_int	next_active_point;
 
+/*
+ * Last results of the id lookups. The same window or pane is usually looked
+ * up repeatedly (targets, formats, notifys) so checking the cached id avoids
+ * most tree walks; the caches are cleared on destruction.
+ */
+static struct window		*window_find_cache;
+static struct window_pane	*window_pane_find_cache;
+
 /* List of window modes. */
 const struct window_mode *all_window_modes[] = {
 	&window_buffer_mode,
@@ -80,6 +88,11 @@ struct window_pane_input_data {
 static struct window_pane *window_pane_create(struct window *, u_int, u_int,
 		    u_int);
 static void	window_pane_destroy(struct window_pane *);
+static void	window_pane_log_flush(struct window_pane *);
+static void	window_pane_log_stop(struct window_pane *);
+static void	window_pane_log_timer(int, short, void *);
+static void	window_pane_record_write(struct window_pane *, const u_char *,
+		    size_t);
 
 RB_GENERATE(windows, window, entry, window_cmp);
 RB_GENERATE(winlinks, winlink, entry, winlink_cmp);
@@ -143,17 +156,38 @@ winlink_find_by_window_id(struct winlinks *wwl, u_int id)
 static int
 winlink_next_index(struct winlinks *wwl, int idx)
 {
-	int	i;
+	struct winlink	find, *wl;
+	int		 i;
+
+	if (idx < 0)
+		fatalx("bad index");
 
+	/*
+	 * Indexes in use from idx up are contiguous in the tree walk, so the
+	 * first gap is found by walking rather than probing each index with
+	 * its own lookup.
+	 */
+	find.idx = idx;
+	wl = RB_NFIND(winlinks, wwl, &find);
 	i = idx;
-	do {
-		if (winlink_find_by_index(wwl, i) == NULL)
+	for (;;) {
+		if (wl == NULL || wl->idx != i)
 			return (i);
 		if (i == INT_MAX)
-			i = 0;
-		else
-			i++;
-	} while (i != idx);
+			break;
+		i++;
+		wl = RB_NEXT(winlinks, wwl, wl);
+	}
+
+	/* Everything from idx up is in use; wrap and walk from zero. */
+	wl = RB_MIN(winlinks, wwl);
+	i = 0;
+	while (i != idx) {
+		if (wl == NULL || wl->idx != i)
+			return (i);
+		i++;
+		wl = RB_NEXT(winlinks, wwl, wl);
+	}
 	return (-1);
 }
 
@@ -294,8 +328,12 @@ window_find_by_id(u_int id)
 {
 	struct window	w;
 
+	if (window_find_cache != NULL && window_find_cache->id == id)
+		return (window_find_cache);
+
 	w.id = id;
-	return (RB_FIND(windows, &windows, &w));
+	window_find_cache = RB_FIND(windows, &windows, &w);
+	return (window_find_cache);
 }
 
 void
@@ -303,6 +341,7 @@ window_update_activity(struct window *w)
 {
 	gettimeofday(&w->activity_time, NULL);
 	alerts_queue(w, WINDOW_ACTIVITY);
+	server_wake_timers();
 }
 
 struct window *
@@ -317,7 +356,12 @@ window_create(u_int sx, u_int sy, u_int xpixel, u_int ypixel)
 
 	w = xcalloc(1, sizeof *w);
 	w->name = xstrdup("");
-	w->flags = 0;
+
+	/*
+	 * Assume visible until the server loop works out which windows are
+	 * really on a client, so no output is skipped in between.
+	 */
+	w->flags = WINDOW_VISIBLE;
 
 	TAILQ_INIT(&w->panes);
 	w->active = NULL;
@@ -348,6 +392,8 @@ window_destroy(struct window *w)
 {
 	log_debug("window @%u destroyed (%d references)", w->id, w->references);
 
+	if (window_find_cache == w)
+		window_find_cache = NULL;
 	RB_REMOVE(windows, &windows, w);
 
 	if (w->layout_root != NULL)
@@ -355,12 +401,11 @@ window_destroy(struct window *w)
 	if (w->saved_layout_root != NULL)
 		layout_free_cell(w->saved_layout_root);
 	free(w->old_layout);
+	free(w->layout_cache);
+	free(w->border_map);
 
 	window_destroy_panes(w);
 
-	if (event_initialized(&w->name_event))
-		evtimer_del(&w->name_event);
-
 	if (event_initialized(&w->alerts_timer))
 		evtimer_del(&w->alerts_timer);
 	if (event_initialized(&w->offset_timer))
@@ -848,8 +893,36 @@ window_pane_find_by_id(u_int id)
 {
 	struct window_pane	wp;
 
+	if (window_pane_find_cache != NULL &&
+	    window_pane_find_cache->id == id)
+		return (window_pane_find_cache);
+
 	wp.id = id;
-	return (RB_FIND(window_pane_tree, &all_window_panes, &wp));
+	window_pane_find_cache = RB_FIND(window_pane_tree, &all_window_panes,
+	    &wp);
+	return (window_pane_find_cache);
+}
+
+/* Reserve a pane id, for processes spawned before their pane exists. */
+u_int
+window_pane_reserve_id(void)
+{
+	return (next_window_pane_id++);
+}
+
+/*
+ * Hibernate an idle pane: pack its history and drop the input parser
+ * scratch. Everything comes back transparently on access or output.
+ */
+void
+window_pane_hibernate(struct window_pane *wp)
+{
+	log_debug("%s: %%%u", __func__, wp->id);
+
+	grid_hibernate(wp->base.grid);
+	if (wp->ictx != NULL)
+		input_hibernate(wp->ictx);
+	wp->flags |= PANE_HIBERNATED;
 }
 
 static struct window_pane *
@@ -891,6 +964,8 @@ window_pane_create(struct window *w, u_int sx, u_int sy, u_int hlimit)
 	wp->pipe_off = 0;
 	wp->pipe_event = NULL;
 
+	wp->log_fd = -1;
+
 	screen_init(&wp->base, sx, sy, hlimit);
 	wp->screen = &wp->base;
 
@@ -919,6 +994,7 @@ window_pane_destroy(struct window_pane *wp)
 		input_free(wp->ictx);
 
 	screen_free(&wp->status_screen);
+	free(wp->border_text);
 
 	screen_free(&wp->base);
 
@@ -927,9 +1003,26 @@ window_pane_destroy(struct window_pane *wp)
 		close(wp->pipe_fd);
 	}
 
+	if (wp->record_file != NULL)
+		fclose(wp->record_file);
+
+	if (wp->log_fd != -1) {
+		window_pane_log_flush(wp);
+		window_pane_log_stop(wp);
+	}
+
+	free(wp->current_cmd);
+	free(wp->current_cwd);
+	free(wp->search_term);
+
+	if (wp->paste_pending != NULL)
+		evbuffer_free(wp->paste_pending);
+
 	if (event_initialized(&wp->resize_timer))
 		event_del(&wp->resize_timer);
 
+	if (window_pane_find_cache == wp)
+		window_pane_find_cache = NULL;
 	RB_REMOVE(window_pane_tree, &all_window_panes, wp);
 
 	options_free(wp->options);
@@ -940,6 +1033,104 @@ window_pane_destroy(struct window_pane *wp)
 	free(wp);
 }
 
+/* Maximum read watermark when a pane is streaming. */
+#define WINDOW_PANE_READ_MAX (256 * 1024)
+
+/*
+ * Adjust the read watermark for a pane: grow it while the pane is streaming
+ * so each event loop wakeup handles more data, and shrink it again once the
+ * pane goes back to trickling interactive output.
+ */
+static void
+window_pane_adjust_watermark(struct window_pane *wp, size_t added)
+{
+	struct timeval	 now, elapsed;
+	size_t		 rate;
+
+	wp->read_bytes += added;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &wp->read_time, &elapsed);
+	if (elapsed.tv_sec == 0)
+		return;
+	rate = wp->read_bytes / elapsed.tv_sec;
+	wp->read_rate = rate;
+	wp->read_bytes = 0;
+	memcpy(&wp->read_time, &now, sizeof wp->read_time);
+
+	if (rate > 2 * wp->read_size && wp->read_size < WINDOW_PANE_READ_MAX)
+		wp->read_size *= 2;
+	else if (rate < READ_SIZE / 2 && wp->read_size > READ_SIZE)
+		wp->read_size /= 2;
+	else
+		return;
+	log_debug("%s: %%%u watermark now %zu (%zu bytes/second)", __func__,
+	    wp->id, wp->read_size, rate);
+	if (wp->event != NULL)
+		bufferevent_setwatermark(wp->event, EV_READ, 0, wp->read_size);
+}
+
+/* Size of each chunk fed to the pane when pasting a large buffer. */
+#define WINDOW_PANE_PASTE_CHUNK 65536
+
+/*
+ * Feed the next chunk of pending paste data once the output buffer has
+ * drained, so a large paste never sits in the output buffer in one piece.
+ */
+static void
+window_pane_paste_feed(struct window_pane *wp)
+{
+	size_t	used, size;
+
+	if (wp->paste_pending == NULL || wp->event == NULL)
+		return;
+	used = EVBUFFER_LENGTH(wp->event->output);
+	if (used >= WINDOW_PANE_PASTE_CHUNK)
+		return;
+
+	size = EVBUFFER_LENGTH(wp->paste_pending);
+	if (size > WINDOW_PANE_PASTE_CHUNK - used)
+		size = WINDOW_PANE_PASTE_CHUNK - used;
+	log_debug("%s: %%%u feeding %zu of %zu", __func__, wp->id, size,
+	    EVBUFFER_LENGTH(wp->paste_pending));
+	bufferevent_write(wp->event, EVBUFFER_DATA(wp->paste_pending), size);
+	evbuffer_drain(wp->paste_pending, size);
+
+	if (EVBUFFER_LENGTH(wp->paste_pending) == 0) {
+		evbuffer_free(wp->paste_pending);
+		wp->paste_pending = NULL;
+	}
+}
+
+/*
+ * Write paste data to a pane. Anything beyond one chunk is held back and fed
+ * in from the write callback as the pty accepts it.
+ */
+void
+window_pane_paste(struct window_pane *wp, const void *data, size_t size)
+{
+	if (wp->event == NULL)
+		return;
+	if (wp->paste_pending == NULL &&
+	    size + EVBUFFER_LENGTH(wp->event->output) <=
+	    WINDOW_PANE_PASTE_CHUNK) {
+		bufferevent_write(wp->event, data, size);
+		return;
+	}
+	if (wp->paste_pending == NULL)
+		wp->paste_pending = evbuffer_new();
+	evbuffer_add(wp->paste_pending, data, size);
+	window_pane_paste_feed(wp);
+}
+
+static void
+window_pane_write_callback(__unused struct bufferevent *bufev, void *data)
+{
+	struct window_pane	*wp = data;
+
+	window_pane_paste_feed(wp);
+}
+
 static void
 window_pane_read_callback(__unused struct bufferevent *bufev, void *data)
 {
@@ -948,17 +1139,64 @@ window_pane_read_callback(__unused struct bufferevent *bufev, void *data)
 	size_t			 size = EVBUFFER_LENGTH(evb);
 	char			*new_data;
 	size_t			 new_size;
+	ssize_t			 n;
+	struct timeval		 log_tv = { .tv_sec = 1 };
+
+	window_pane_adjust_watermark(wp, size);
 
 	new_size = size - wp->pipe_off;
 	if (wp->pipe_fd != -1 && new_size > 0) {
 		new_data = EVBUFFER_DATA(evb) + wp->pipe_off;
-		bufferevent_write(wp->pipe_event, new_data, new_size);
+
+		/*
+		 * If nothing is queued on the pipe, write directly and only
+		 * buffer whatever does not fit, instead of copying everything
+		 * through the bufferevent and writing it from the event loop.
+		 */
+		if (EVBUFFER_LENGTH(wp->pipe_event->output) == 0) {
+			n = write(wp->pipe_fd, new_data, new_size);
+			if (n > 0) {
+				new_data += n;
+				new_size -= n;
+			}
+		}
+		if (new_size > 0)
+			bufferevent_write(wp->pipe_event, new_data, new_size);
+	}
+
+	new_size = size - wp->record_off;
+	if (wp->record_file != NULL && new_size > 0) {
+		window_pane_record_write(wp,
+		    EVBUFFER_DATA(evb) + wp->record_off, new_size);
+	}
+
+	/*
+	 * Log output is batched: flush once a reasonable amount has built up
+	 * and otherwise leave it for the timer, so continuous logging does
+	 * not mean a write for every read.
+	 */
+	new_size = size - wp->log_off;
+	if (wp->log_fd != -1 && new_size > 0) {
+		evbuffer_add(wp->log_buffer, EVBUFFER_DATA(evb) + wp->log_off,
+		    new_size);
+		if (EVBUFFER_LENGTH(wp->log_buffer) >= 8192)
+			window_pane_log_flush(wp);
+		else if (!evtimer_pending(&wp->log_event, NULL))
+			evtimer_add(&wp->log_event, &log_tv);
 	}
 
 	log_debug("%%%u has %zu bytes", wp->id, size);
+	wp->search_valid = 0;
 	input_parse_pane(wp);
 
+	if (wp->probe_cb != NULL)
+		wp->probe_cb(wp, wp->probe_data);
+
 	wp->pipe_off = EVBUFFER_LENGTH(evb);
+	wp->record_off = EVBUFFER_LENGTH(evb);
+	wp->log_off = EVBUFFER_LENGTH(evb);
+
+	window_pane_check_backpressure(wp);
 }
 
 static void
@@ -974,17 +1212,279 @@ window_pane_error_callback(__unused struct bufferevent *bufev,
 		server_destroy_pane(wp, 1);
 }
 
+/* Stop logging and release the logging state. */
+static void
+window_pane_log_stop(struct window_pane *wp)
+{
+	if (wp->log_fd == -1)
+		return;
+	evtimer_del(&wp->log_event);
+	close(wp->log_fd);
+	wp->log_fd = -1;
+	evbuffer_free(wp->log_buffer);
+	wp->log_buffer = NULL;
+	free(wp->log_path);
+	wp->log_path = NULL;
+}
+
+/* Flush batched log output, rotating or stopping as necessary. */
+static void
+window_pane_log_flush(struct window_pane *wp)
+{
+	ssize_t	 n;
+	long long limit;
+	char	*old;
+
+	while (EVBUFFER_LENGTH(wp->log_buffer) != 0) {
+		n = evbuffer_write(wp->log_buffer, wp->log_fd);
+		if (n <= 0) {
+			log_debug("%%%u log write failed: %s", wp->id,
+			    strerror(errno));
+			window_pane_log_stop(wp);
+			return;
+		}
+		wp->log_size += n;
+	}
+
+	limit = options_get_number(wp->options, "log-file-limit");
+	if (limit == 0 || wp->log_size < limit)
+		return;
+	xasprintf(&old, "%s.old", wp->log_path);
+	if (rename(wp->log_path, old) != 0) {
+		log_debug("%%%u log rename failed: %s", wp->id,
+		    strerror(errno));
+		free(old);
+		window_pane_log_stop(wp);
+		return;
+	}
+	free(old);
+	close(wp->log_fd);
+	wp->log_fd = open(wp->log_path, O_WRONLY|O_APPEND|O_CREAT|O_TRUNC,
+	    0644);
+	wp->log_size = 0;
+	if (wp->log_fd == -1)
+		window_pane_log_stop(wp);
+}
+
+static void
+window_pane_log_timer(__unused int fd, __unused short events, void *data)
+{
+	struct window_pane	*wp = data;
+
+	if (wp->log_fd != -1)
+		window_pane_log_flush(wp);
+}
+
+/* Start, stop or retarget logging to match the log-file option. */
+void
+window_pane_update_log(struct window_pane *wp)
+{
+	struct format_tree	*ft;
+	const char		*value;
+	char			*path;
+	int			 fd;
+
+	value = options_get_string(wp->options, "log-file");
+	if (*value == '\0') {
+		if (wp->log_fd != -1) {
+			window_pane_log_flush(wp);
+			window_pane_log_stop(wp);
+		}
+		return;
+	}
+
+	ft = format_create(NULL, NULL, FORMAT_PANE|wp->id, 0);
+	format_defaults(ft, NULL, NULL, NULL, wp);
+	path = format_expand(ft, value);
+	format_free(ft);
+
+	if (wp->log_path != NULL && strcmp(path, wp->log_path) == 0) {
+		free(path);
+		return;
+	}
+	if (wp->log_fd != -1) {
+		window_pane_log_flush(wp);
+		window_pane_log_stop(wp);
+	}
+
+	fd = open(path, O_WRONLY|O_APPEND|O_CREAT, 0644);
+	if (fd == -1) {
+		log_debug("%%%u log open %s failed: %s", wp->id, path,
+		    strerror(errno));
+		free(path);
+		return;
+	}
+	wp->log_fd = fd;
+	wp->log_path = path;
+	wp->log_size = lseek(fd, 0, SEEK_END);
+	wp->log_buffer = evbuffer_new();
+	if (wp->log_buffer == NULL)
+		fatalx("out of memory");
+	evtimer_set(&wp->log_event, window_pane_log_timer, wp);
+	if (wp->event != NULL)
+		wp->log_off = EVBUFFER_LENGTH(wp->event->input);
+	else
+		wp->log_off = 0;
+	log_debug("%%%u logging to %s", wp->id, path);
+}
+
+/* Total grid memory held by a pane, including the alternate screen. */
+size_t
+window_pane_memory(struct window_pane *wp)
+{
+	size_t	size;
+
+	size = grid_memory(wp->base.grid);
+	if (wp->base.saved_grid != NULL)
+		size += grid_memory(wp->base.saved_grid);
+	return (size);
+}
+
+/* Write one frame of recorded output. Any error stops the recording. */
+static void
+window_pane_record_write(struct window_pane *wp, const u_char *data,
+    size_t size)
+{
+	struct window_pane_record_frame	 f;
+	struct timeval			 tv;
+
+	gettimeofday(&tv, NULL);
+	f.tv_sec = tv.tv_sec;
+	f.tv_usec = tv.tv_usec;
+	f.size = size;
+
+	if (fwrite(&f, sizeof f, 1, wp->record_file) != 1 ||
+	    fwrite(data, size, 1, wp->record_file) != 1 ||
+	    fflush(wp->record_file) != 0) {
+		log_debug("%%%u record error: %s", wp->id, strerror(errno));
+		window_pane_record_stop(wp);
+	}
+}
+
+/* Start recording pane output, replacing any existing recording. */
+int
+window_pane_record_start(struct window_pane *wp, const char *path)
+{
+	window_pane_record_stop(wp);
+
+	wp->record_file = fopen(path, "w");
+	if (wp->record_file == NULL)
+		return (-1);
+	if (wp->fd != -1)
+		wp->record_off = EVBUFFER_LENGTH(wp->event->input);
+	else
+		wp->record_off = 0;
+	log_debug("%%%u recording to %s", wp->id, path);
+	return (0);
+}
+
+void
+window_pane_record_stop(struct window_pane *wp)
+{
+	if (wp->record_file == NULL)
+		return;
+	fclose(wp->record_file);
+	wp->record_file = NULL;
+	log_debug("%%%u recording stopped", wp->id);
+}
+
 void
 window_pane_set_event(struct window_pane *wp)
 {
 	setblocking(wp->fd, 0);
 
 	wp->event = bufferevent_new(wp->fd, window_pane_read_callback,
-	    NULL, window_pane_error_callback, wp);
+	    window_pane_write_callback, window_pane_error_callback, wp);
 	wp->ictx = input_init(wp, wp->event);
 
-	bufferevent_setwatermark(wp->event, EV_READ, 0, READ_SIZE);
+	if (wp->read_size == 0) {
+		wp->read_size = READ_SIZE;
+		gettimeofday(&wp->read_time, NULL);
+	}
+	bufferevent_setwatermark(wp->event, EV_READ, 0, wp->read_size);
 	bufferevent_enable(wp->event, EV_READ|EV_WRITE);
+
+	if (wp->flags & (PANE_PAUSED|PANE_BACKPRESSURE))
+		bufferevent_disable(wp->event, EV_READ);
+}
+
+/* Stop reading from a pane until it is resumed. */
+void
+window_pane_pause(struct window_pane *wp)
+{
+	if (wp->flags & PANE_PAUSED)
+		return;
+	log_debug("%s: %%%u", __func__, wp->id);
+	wp->flags |= PANE_PAUSED;
+	if (wp->event != NULL)
+		bufferevent_disable(wp->event, EV_READ);
+}
+
+/* Resume reading from a paused pane. */
+void
+window_pane_resume(struct window_pane *wp)
+{
+	if (~wp->flags & PANE_PAUSED)
+		return;
+	log_debug("%s: %%%u", __func__, wp->id);
+	wp->flags &= ~PANE_PAUSED;
+	if (wp->event != NULL && (~wp->flags & PANE_BACKPRESSURE))
+		bufferevent_enable(wp->event, EV_READ);
+}
+
+/*
+ * Apply the backpressure-limit option: if the slowest client showing this
+ * pane's window has more output buffered than the limit, stop reading from
+ * the pty. The kernel buffer then fills and the application blocks in
+ * write(2), so server memory stays bounded however fast the pane produces
+ * output. Reading resumes once every client has drained below half the
+ * limit.
+ */
+void
+window_pane_check_backpressure(struct window_pane *wp)
+{
+	struct client	*c;
+	size_t		 limit, size, worst = 0;
+
+	limit = options_get_number(wp->window->options, "backpressure-limit");
+	if (limit == 0) {
+		if (wp->flags & PANE_BACKPRESSURE) {
+			wp->flags &= ~PANE_BACKPRESSURE;
+			if (wp->event != NULL && (~wp->flags & PANE_PAUSED))
+				bufferevent_enable(wp->event, EV_READ);
+		}
+		return;
+	}
+
+	TAILQ_FOREACH(c, &clients, entry) {
+		if (c->session == NULL ||
+		    (c->flags & CLIENT_CONTROL) ||
+		    c->tty.out == NULL)
+			continue;
+		if (c->session->curw->window != wp->window)
+			continue;
+		size = EVBUFFER_LENGTH(c->tty.out);
+		if (size > worst)
+			worst = size;
+	}
+
+	if (~wp->flags & PANE_BACKPRESSURE) {
+		if (worst <= limit)
+			return;
+		log_debug("%s: %%%u stopped, %zu bytes buffered", __func__,
+		    wp->id, worst);
+		wp->flags |= PANE_BACKPRESSURE;
+		if (wp->event != NULL)
+			bufferevent_disable(wp->event, EV_READ);
+	} else {
+		if (worst > limit / 2)
+			return;
+		log_debug("%s: %%%u resumed, %zu bytes buffered", __func__,
+		    wp->id, worst);
+		wp->flags &= ~PANE_BACKPRESSURE;
+		if (wp->event != NULL && (~wp->flags & PANE_PAUSED))
+			bufferevent_enable(wp->event, EV_READ);
+	}
 }
 
 void
@@ -998,6 +1498,7 @@ window_pane_resize(struct window_pane *wp, u_int sx, u_int sy)
 	wp->sy = sy;
 
 	log_debug("%s: %%%u resize %ux%u", __func__, wp->id, sx, sy);
+	wp->search_valid = 0;
 	screen_resize(&wp->base, sx, sy, wp->base.saved_grid == NULL);
 
 	wme = TAILQ_FIRST(&wp->modes);
@@ -1089,6 +1590,7 @@ window_pane_set_mode(struct window_pane *wp, struct window_pane *swp,
 
 	wp->screen = wme->screen;
 	wp->flags |= (PANE_REDRAW|PANE_CHANGED);
+	wp->generation++;
 
 	server_redraw_window_borders(wp->window);
 	server_status_window(wp->window);
@@ -1121,6 +1623,7 @@ window_pane_reset_mode(struct window_pane *wp)
 			next->mode->resize(next, wp->sx, wp->sy);
 	}
 	wp->flags |= (PANE_REDRAW|PANE_CHANGED);
+	wp->generation++;
 
 	server_redraw_window_borders(wp->window);
 	server_status_window(wp->window);
@@ -1186,12 +1689,24 @@ u_int
 window_pane_search(struct window_pane *wp, const char *term, int regex,
     int ignore)
 {
-	struct screen	*s = &wp->base;
-	regex_t		 r;
-	char		*new = NULL, *line;
-	u_int		 i;
-	int		 flags = 0, found;
-	size_t		 n;
+	struct screen		*s = &wp->base;
+	struct grid_line	*gl;
+	regex_t			 r;
+	char			*new = NULL, *line;
+	u_int			 i;
+	int			 flags = 0, found;
+	size_t			 n;
+
+	/*
+	 * The window tree filter expands for every pane on every redraw of
+	 * the mode, so the result is cached; new output or a resize clears
+	 * it.
+	 */
+	if (wp->search_valid &&
+	    wp->search_regex == regex &&
+	    wp->search_ignore == ignore &&
+	    strcmp(wp->search_term, term) == 0)
+		return (wp->search_result);
 
 	if (!regex) {
 		if (ignore)
@@ -1205,6 +1720,11 @@ window_pane_search(struct window_pane *wp, const char *term, int regex,
 	}
 
 	for (i = 0; i < screen_size_y(s); i++) {
+		if (!regex && *term != '\0') {
+			gl = grid_get_line(s->grid, s->grid->hsize + i);
+			if (gl->cellused == 0)
+				continue;
+		}
 		line = grid_view_string_cells(s->grid, 0, i, screen_size_x(s));
 		for (n = strlen(line); n > 0; n--) {
 			if (!isspace((u_char)line[n - 1]))
@@ -1225,9 +1745,16 @@ window_pane_search(struct window_pane *wp, const char *term, int regex,
 	else
 		regfree(&r);
 
+	free(wp->search_term);
+	wp->search_term = xstrdup(term);
+	wp->search_regex = regex;
+	wp->search_ignore = ignore;
 	if (i == screen_size_y(s))
-		return (0);
-	return (i + 1);
+		wp->search_result = 0;
+	else
+		wp->search_result = i + 1;
+	wp->search_valid = 1;
+	return (wp->search_result);
 }
 
 /* Get MRU pane from a list. */
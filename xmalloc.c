@@ -34,6 +34,7 @@ xmalloc(size_t size)
 	if (ptr == NULL)
 		fatalx("xmalloc: allocating %zu bytes: %s",
 		    size, strerror(errno));
+	server_perf.xallocs++;
 	return ptr;
 }
 
@@ -48,6 +49,7 @@ xcalloc(size_t nmemb, size_t size)
 	if (ptr == NULL)
 		fatalx("xcalloc: allocating %zu * %zu bytes: %s",
 		    nmemb, size, strerror(errno));
+	server_perf.xallocs++;
 	return ptr;
 }
 
@@ -68,6 +70,7 @@ xreallocarray(void *ptr, size_t nmemb, size_t size)
 	if (new_ptr == NULL)
 		fatalx("xreallocarray: allocating %zu * %zu bytes: %s",
 		    nmemb, size, strerror(errno));
+	server_perf.xallocs++;
 	return new_ptr;
 }
 
@@ -82,6 +85,7 @@ xrecallocarray(void *ptr, size_t oldnmemb, size_t nmemb, size_t size)
 	if (new_ptr == NULL)
 		fatalx("xrecallocarray: allocating %zu * %zu bytes: %s",
 		    nmemb, size, strerror(errno));
+	server_perf.xallocs++;
 	return new_ptr;
 }
 
@@ -92,6 +96,7 @@ xstrdup(const char *str)
 
 	if ((cp = strdup(str)) == NULL)
 		fatalx("xstrdup: %s", strerror(errno));
+	server_perf.xallocs++;
 	return cp;
 }
 
@@ -102,6 +107,7 @@ xstrndup(const char *str, size_t maxlen)
 
 	if ((cp = strndup(str, maxlen)) == NULL)
 		fatalx("xstrndup: %s", strerror(errno));
+	server_perf.xallocs++;
 	return cp;
 }
 
@@ -127,6 +133,7 @@ xvasprintf(char **ret, const char *fmt, va_list ap)
 
 	if (i == -1)
 		fatalx("xasprintf: %s", strerror(errno));
+	server_perf.xallocs++;
 
 	return i;
 }